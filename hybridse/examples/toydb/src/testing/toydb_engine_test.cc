@@ -48,6 +48,32 @@ TEST_P(EngineTest, TestBatchEngine) {
         LOG(INFO) << "Skip mode " << sql_case.mode();
     }
 }
+TEST_P(EngineTest, TestParallelBatchEngine) {
+    ParamType sql_case = GetParam();
+    EngineOptions options;
+    LOG(INFO) << "ID: " << sql_case.id() << ", DESC: " << sql_case.desc();
+    if (!boost::contains(sql_case.mode(), "batch-unsupport") &&
+        !boost::contains(sql_case.mode(), "rtidb-unsupport") &&
+        !boost::contains(sql_case.mode(), "performance-sensitive-unsupport") &&
+        !boost::contains(sql_case.mode(), "rtidb-batch-unsupport")) {
+        ParallelBatchEngineCheck(sql_case, options);
+    } else {
+        LOG(INFO) << "Skip mode " << sql_case.mode();
+    }
+}
+TEST_P(EngineTest, TestHashJoinBatchEngine) {
+    ParamType sql_case = GetParam();
+    EngineOptions options;
+    LOG(INFO) << "ID: " << sql_case.id() << ", DESC: " << sql_case.desc();
+    if (!boost::contains(sql_case.mode(), "batch-unsupport") &&
+        !boost::contains(sql_case.mode(), "rtidb-unsupport") &&
+        !boost::contains(sql_case.mode(), "performance-sensitive-unsupport") &&
+        !boost::contains(sql_case.mode(), "rtidb-batch-unsupport")) {
+        HashJoinBatchEngineCheck(sql_case, options);
+    } else {
+        LOG(INFO) << "Skip mode " << sql_case.mode();
+    }
+}
 TEST_P(EngineTest, TestBatchRequestEngineForLastRow) {
     ParamType sql_case = GetParam();
     EngineOptions options;
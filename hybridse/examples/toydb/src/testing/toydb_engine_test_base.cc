@@ -15,9 +15,14 @@
  */
 
 #include "testing/toydb_engine_test_base.h"
+#include <algorithm>
+#include "gflags/gflags.h"
 #include "gtest/gtest.h"
 #include "gtest/internal/gtest-param-util.h"
 
+DECLARE_bool(enable_batch_hash_runner);
+DECLARE_uint64(batch_hash_join_memory_limit_mb);
+
 using namespace llvm;       // NOLINT (build/namespaces)
 using namespace llvm::orc;  // NOLINT (build/namespaces)
 
@@ -197,6 +202,71 @@ void BatchRequestEngineCheck(const SqlCase& sql_case,
     }
 }
 
+void ParallelBatchEngineCheck(const SqlCase& sql_case,
+                              const EngineOptions& options) {
+    if (!sql_case.expect().success_) {
+        return;
+    }
+    // the window and group aggregations of the parallel run split the keys into
+    // morsels, and the rows should be the same as the serial run in the same order
+    ToydbBatchEngineTestRunner serial_test(sql_case, options);
+    ToydbBatchEngineTestRunner parallel_test(sql_case, options);
+    auto parallel_session = std::make_shared<BatchRunSession>();
+    parallel_session->SetParallelism(4);
+    parallel_test.SetSession(parallel_session);
+    std::vector<Row> serial_rows;
+    std::vector<Row> parallel_rows;
+    for (auto* test : {&serial_test, &parallel_test}) {
+        ASSERT_TRUE(test->InitEngineCatalog());
+        Status status = test->Compile();
+        ASSERT_TRUE(status.isOK()) << status;
+        status = test->PrepareData();
+        ASSERT_TRUE(status.isOK()) << status;
+        status = test->Compute(test == &serial_test ? &serial_rows
+                                                    : &parallel_rows);
+        ASSERT_TRUE(status.isOK()) << status;
+    }
+    ASSERT_EQ(serial_rows.size(), parallel_rows.size());
+    for (size_t i = 0; i < serial_rows.size(); ++i) {
+        ASSERT_EQ(0, serial_rows[i].compare(parallel_rows[i])) << "row " << i;
+    }
+}
+
+void HashJoinBatchEngineCheck(const SqlCase& sql_case,
+                              const EngineOptions& options) {
+    if (!sql_case.expect().success_) {
+        return;
+    }
+    // the runners are chosen when the sql compiles, and the memory limit is
+    // read when the hash join runs, so a zero limit spills every build table
+    bool enable_hash_runner = FLAGS_enable_batch_hash_runner;
+    uint64_t memory_limit_mb = FLAGS_batch_hash_join_memory_limit_mb;
+    std::vector<Row> rows[2];
+    for (int hash = 0; hash < 2; ++hash) {
+        FLAGS_enable_batch_hash_runner = hash == 1;
+        FLAGS_batch_hash_join_memory_limit_mb = 0;
+        ToydbBatchEngineTestRunner test(sql_case, options);
+        ASSERT_TRUE(test.InitEngineCatalog());
+        Status status = test.Compile();
+        ASSERT_TRUE(status.isOK()) << status;
+        status = test.PrepareData();
+        ASSERT_TRUE(status.isOK()) << status;
+        status = test.Compute(&rows[hash]);
+        ASSERT_TRUE(status.isOK()) << status;
+    }
+    FLAGS_enable_batch_hash_runner = enable_hash_runner;
+    FLAGS_batch_hash_join_memory_limit_mb = memory_limit_mb;
+    // the hash group runner may output the groups in another order
+    for (auto& output : rows) {
+        std::sort(output.begin(), output.end(),
+                  [](const Row& l, const Row& r) { return l.compare(r) < 0; });
+    }
+    ASSERT_EQ(rows[0].size(), rows[1].size());
+    for (size_t i = 0; i < rows[0].size(); ++i) {
+        ASSERT_EQ(0, rows[0][i].compare(rows[1][i])) << "row " << i;
+    }
+}
+
 void EngineCheck(const SqlCase& sql_case, const EngineOptions& options,
                  EngineMode engine_mode) {
     if (engine_mode == kBatchMode) {
@@ -47,6 +47,10 @@ void BatchRequestEngineCheckWithCommonColumnIndices(const SqlCase& sql_case, con
                                                     const std::set<size_t>& common_column_indices);
 void BatchRequestEngineCheck(const SqlCase& sql_case, const EngineOptions options);
 void EngineCheck(const SqlCase& sql_case, const EngineOptions& options, EngineMode engine_mode);
+// compare the rows of the batch run with parallelism 4 to the serial run
+void ParallelBatchEngineCheck(const SqlCase& sql_case, const EngineOptions& options);
+// compare the rows of the hash runners spilling every build table to the index runners
+void HashJoinBatchEngineCheck(const SqlCase& sql_case, const EngineOptions& options);
 
 int GenerateSqliteTestStringCallback(void* s, int argc, char** argv, char** azColName);
 void CheckSqliteCompatible(const SqlCase& sql_case, const vm::Schema& schema, const std::vector<Row>& output);
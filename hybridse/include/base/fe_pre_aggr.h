@@ -0,0 +1,744 @@
+/*
+ * Copyright 2021 4Paradigm
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HYBRIDSE_INCLUDE_BASE_FE_PRE_AGGR_H_
+#define HYBRIDSE_INCLUDE_BASE_FE_PRE_AGGR_H_
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "base/fe_hash.h"
+
+// The aggregates of long window pre-aggregation. The storage encodes the aggregate of each bucket
+// into the agg_val column of the pre-aggr table and the engine merges the buckets, so the function
+// definitions and the encodings of the aggregates are shared by both sides here.
+namespace hybridse {
+namespace base {
+
+constexpr uint32_t kPreAggrHashSeed = 0xe17a1465;
+
+enum class PreAggrKind {
+    kSum,
+    kCount,
+    kAvg,
+    kMin,
+    kMax,
+    kDistinctCount,
+    kTopNFrequency,
+};
+
+struct PreAggrFunc {
+    PreAggrKind kind = PreAggrKind::kSum;
+    // `*_where(value, condition)`
+    bool has_cond = false;
+    // `*_cate(value, category)` or `*_cate_where(value, condition, category)`
+    bool has_cate = false;
+
+    size_t ArgNum() const {
+        switch (kind) {
+            case PreAggrKind::kDistinctCount:
+                return 1;
+            case PreAggrKind::kTopNFrequency:
+                // fz_topn_frequency(key, top_n)
+                return 2;
+            default:
+                return 1 + (has_cond ? 1 : 0) + (has_cate ? 1 : 0);
+        }
+    }
+    size_t CondPos() const { return 1; }
+    size_t CatePos() const { return ArgNum() - 1; }
+
+    // the aggregate is kept as a PreAggrState rather than a single value
+    bool HasState() const {
+        return has_cate || kind == PreAggrKind::kDistinctCount || kind == PreAggrKind::kTopNFrequency;
+    }
+};
+
+// parse the lowercase function name, return false if it can not be pre-aggregated
+inline bool ParsePreAggrFunc(const std::string& name, PreAggrFunc* func) {
+    PreAggrFunc result;
+    if (name == "distinct_count") {
+        result.kind = PreAggrKind::kDistinctCount;
+        *func = result;
+        return true;
+    }
+    if (name == "fz_topn_frequency") {
+        result.kind = PreAggrKind::kTopNFrequency;
+        *func = result;
+        return true;
+    }
+    std::string base = name;
+    auto strip = [&base](const std::string& suffix) {
+        if (base.size() > suffix.size() && base.compare(base.size() - suffix.size(), suffix.size(), suffix) == 0) {
+            base.resize(base.size() - suffix.size());
+            return true;
+        }
+        return false;
+    };
+    result.has_cond = strip("_where");
+    result.has_cate = strip("_cate");
+    if (base == "sum") {
+        result.kind = PreAggrKind::kSum;
+    } else if (base == "count") {
+        result.kind = PreAggrKind::kCount;
+    } else if (base == "avg") {
+        result.kind = PreAggrKind::kAvg;
+    } else if (base == "min") {
+        result.kind = PreAggrKind::kMin;
+    } else if (base == "max") {
+        result.kind = PreAggrKind::kMax;
+    } else {
+        return false;
+    }
+    *func = result;
+    return true;
+}
+
+// the string literal of the condition is quoted by '"', and the '"' and '\\' in it are escaped by '\\'
+inline std::string QuotePreAggrLiteral(const std::string& str) {
+    std::string quoted = "\"";
+    for (char ch : str) {
+        if (ch == '"' || ch == '\\') {
+            quoted.push_back('\\');
+        }
+        quoted.push_back(ch);
+    }
+    quoted.push_back('"');
+    return quoted;
+}
+
+// return the length of the quoted literal at start of str, or 0 if it is not a terminated literal
+inline size_t PreAggrLiteralLength(const std::string& str, size_t start) {
+    if (start >= str.size() || str[start] != '"') {
+        return 0;
+    }
+    for (size_t i = start + 1; i < str.size(); i++) {
+        if (str[i] == '\\') {
+            i++;
+        } else if (str[i] == '"') {
+            return i + 1 - start;
+        }
+    }
+    return 0;
+}
+
+inline bool UnquotePreAggrLiteral(const std::string& quoted, std::string* str) {
+    if (PreAggrLiteralLength(quoted, 0) != quoted.size()) {
+        return false;
+    }
+    str->clear();
+    for (size_t i = 1; i + 1 < quoted.size(); i++) {
+        if (quoted[i] == '\\') {
+            i++;
+        }
+        str->push_back(quoted[i]);
+    }
+    return true;
+}
+
+// the condition of `*_where` in the aggr_col of pre-aggr meta, e.g. `c1 > 5` or `c2 = "a b"`
+inline std::string FormatPreAggrCondition(const std::string& column, const std::string& op,
+                                          const std::string& literal, bool is_string) {
+    return column + " " + op + " " + (is_string ? QuotePreAggrLiteral(literal) : literal);
+}
+
+// the args of the function are joined by ',' in the aggr_col of pre-aggr meta,
+// the ',' in the string literal of the condition doesn't split the args
+inline bool SplitPreAggrArgs(const std::string& aggr_col, const PreAggrFunc& func, std::vector<std::string>* args) {
+    args->clear();
+    size_t start = 0;
+    size_t pos = 0;
+    while (true) {
+        if (pos < aggr_col.size() && aggr_col[pos] == '"') {
+            size_t len = PreAggrLiteralLength(aggr_col, pos);
+            if (len == 0) {
+                return false;
+            }
+            pos += len;
+            continue;
+        }
+        if (pos < aggr_col.size() && aggr_col[pos] != ',') {
+            pos++;
+            continue;
+        }
+        args->push_back(aggr_col.substr(start, pos - start));
+        if (pos == aggr_col.size()) {
+            break;
+        }
+        start = ++pos;
+    }
+    return args->size() == func.ArgNum();
+}
+
+// the key of a value added to the distinct_count, fz_topn_frequency and `*_cate` states
+inline std::string PreAggrKeyOf(int64_t val) { return std::to_string(val); }
+
+inline std::string PreAggrKeyOf(double val) { return std::string(reinterpret_cast<const char*>(&val), sizeof(val)); }
+
+// the types of the key columns, the storage and the engine map their column types to it
+enum class PreAggrKeyType { kUnknown, kBool, kInt16, kInt32, kInt64, kFloat, kDouble, kString };
+
+// Get the key of a column value. read_value(T*) reads the value into the T of the type, and
+// read_string(std::string*) reads the string value, so the storage and the engine get the same keys.
+template <class ReadValue, class ReadString>
+inline bool GetPreAggrKey(PreAggrKeyType type, ReadValue&& read_value, ReadString&& read_string, std::string* key) {
+    switch (type) {
+        case PreAggrKeyType::kBool: {
+            bool val = false;
+            read_value(&val);
+            *key = PreAggrKeyOf(static_cast<int64_t>(val));
+            return true;
+        }
+        case PreAggrKeyType::kInt16: {
+            int16_t val = 0;
+            read_value(&val);
+            *key = PreAggrKeyOf(static_cast<int64_t>(val));
+            return true;
+        }
+        case PreAggrKeyType::kInt32: {
+            int32_t val = 0;
+            read_value(&val);
+            *key = PreAggrKeyOf(static_cast<int64_t>(val));
+            return true;
+        }
+        case PreAggrKeyType::kInt64: {
+            int64_t val = 0;
+            read_value(&val);
+            *key = PreAggrKeyOf(val);
+            return true;
+        }
+        case PreAggrKeyType::kFloat: {
+            float val = 0;
+            read_value(&val);
+            *key = PreAggrKeyOf(static_cast<double>(val));
+            return true;
+        }
+        case PreAggrKeyType::kDouble: {
+            double val = 0;
+            read_value(&val);
+            *key = PreAggrKeyOf(val);
+            return true;
+        }
+        case PreAggrKeyType::kString:
+            read_string(key);
+            return true;
+        default:
+            return false;
+    }
+}
+
+// The condition of `*_where` which can be pre-aggregated, it is a bool column or a column compared
+// with a constant, e.g. `c1 > 10`, in the format of the expression string of sql node.
+class PreAggrCondition {
+ public:
+    enum Op { kIsTrue, kEq, kNeq, kLt, kLe, kGt, kGe };
+
+    bool Parse(const std::string& expr) {
+        *this = PreAggrCondition();
+        // `column op literal`, the string literal is quoted and may contain the spaces
+        size_t col_end = expr.find(' ');
+        if (col_end == std::string::npos) {
+            column_ = expr;
+            op_ = kIsTrue;
+            return !column_.empty();
+        }
+        size_t op_end = expr.find(' ', col_end + 1);
+        if (col_end == 0 || op_end == std::string::npos) {
+            return false;
+        }
+        static const std::map<std::string, Op> ops = {{"=", kEq},  {"!=", kNeq}, {"<", kLt},
+                                                      {"<=", kLe}, {">", kGt},   {">=", kGe}};
+        auto it = ops.find(expr.substr(col_end + 1, op_end - col_end - 1));
+        if (it == ops.end()) {
+            return false;
+        }
+        column_ = expr.substr(0, col_end);
+        op_ = it->second;
+        std::string literal = expr.substr(op_end + 1);
+        if (!literal.empty() && literal[0] == '"') {
+            return UnquotePreAggrLiteral(literal, &literal_);
+        }
+        if (literal.empty() || literal.find(' ') != std::string::npos) {
+            return false;
+        }
+        literal_ = literal;
+        if (literal_ == "true" || literal_ == "false") {
+            is_long_ = true;
+            long_val_ = literal_ == "true" ? 1 : 0;
+        } else {
+            char* end = nullptr;
+            long_val_ = strtoll(literal_.c_str(), &end, 10);
+            is_long_ = *end == '\0';
+            double_val_ = strtod(literal_.c_str(), &end);
+            is_double_ = *end == '\0';
+        }
+        if (is_long_) {
+            double_val_ = static_cast<double>(long_val_);
+            is_double_ = true;
+        }
+        return true;
+    }
+
+    const std::string& column() const { return column_; }
+
+    bool Match(int64_t val) const {
+        if (op_ == kIsTrue) {
+            return val != 0;
+        }
+        if (is_long_) {
+            return Compare(val, long_val_);
+        }
+        return is_double_ && Compare(static_cast<double>(val), double_val_);
+    }
+
+    bool Match(double val) const {
+        if (op_ == kIsTrue) {
+            return val != 0;
+        }
+        return is_double_ && Compare(val, double_val_);
+    }
+
+    bool Match(const std::string& val) const { return op_ != kIsTrue && Compare(val, literal_); }
+
+ private:
+    template <class T>
+    bool Compare(const T& lhs, const T& rhs) const {
+        switch (op_) {
+            case kEq:
+                return lhs == rhs;
+            case kNeq:
+                return lhs != rhs;
+            case kLt:
+                return lhs < rhs;
+            case kLe:
+                return lhs <= rhs;
+            case kGt:
+                return lhs > rhs;
+            case kGe:
+                return lhs >= rhs;
+            default:
+                return false;
+        }
+    }
+
+    std::string column_;
+    Op op_ = kIsTrue;
+    std::string literal_;
+    bool is_long_ = false;
+    bool is_double_ = false;
+    int64_t long_val_ = 0;
+    double double_val_ = 0;
+};
+
+// the aggregate which is more than a single value, e.g. the HyperLogLog of distinct_count
+class PreAggrState {
+ public:
+    virtual ~PreAggrState() {}
+    virtual PreAggrState* Clone() const = 0;
+    virtual bool Empty() const = 0;
+    virtual void Clear() = 0;
+    virtual void Encode(std::string* output) const = 0;
+    virtual bool Decode(const char* data, size_t size) = 0;
+    // merge the encoded state of the same function
+    virtual bool Merge(const std::string& encoded) = 0;
+
+ protected:
+    template <class T>
+    static void Append(const T& val, std::string* output) {
+        output->append(reinterpret_cast<const char*>(&val), sizeof(T));
+    }
+
+    template <class T>
+    static bool Read(const char** data, const char* end, T* val) {
+        if (end - *data < static_cast<int64_t>(sizeof(T))) {
+            return false;
+        }
+        memcpy(val, *data, sizeof(T));
+        *data += sizeof(T);
+        return true;
+    }
+
+    static void AppendString(const std::string& val, std::string* output) {
+        Append(static_cast<uint32_t>(val.size()), output);
+        output->append(val);
+    }
+
+    static bool ReadString(const char** data, const char* end, std::string* val) {
+        uint32_t len = 0;
+        if (!Read(data, end, &len) || static_cast<uint32_t>(end - *data) < len) {
+            return false;
+        }
+        val->assign(*data, len);
+        *data += len;
+        return true;
+    }
+};
+
+// The HyperLogLog sketch of the approximate distinct_count with 4096 registers, whose standard error
+// is about 1.6%. The small cardinalities are estimated by linear counting, which is almost exact.
+class HyperLogLog : public PreAggrState {
+ public:
+    static constexpr uint32_t kPrecision = 12;
+    static constexpr uint32_t kRegisterNum = 1 << kPrecision;
+
+    PreAggrState* Clone() const override { return new HyperLogLog(*this); }
+
+    bool Empty() const override { return registers_.empty(); }
+
+    void Clear() override { registers_.clear(); }
+
+    void Add(const std::string& key) { AddHash(MurmurHash64A(key.data(), key.size(), kPreAggrHashSeed)); }
+
+    void AddHash(uint64_t hash) {
+        if (registers_.empty()) {
+            registers_.resize(kRegisterNum, 0);
+        }
+        uint32_t idx = hash >> (64 - kPrecision);
+        uint64_t rest = hash << kPrecision;
+        uint8_t rank = rest == 0 ? (64 - kPrecision + 1) : (__builtin_clzll(rest) + 1);
+        registers_[idx] = std::max(registers_[idx], rank);
+    }
+
+    int64_t Estimate() const {
+        if (registers_.empty()) {
+            return 0;
+        }
+        double sum = 0;
+        uint32_t zeros = 0;
+        for (auto rank : registers_) {
+            sum += std::ldexp(1.0, -rank);
+            if (rank == 0) {
+                zeros++;
+            }
+        }
+        double m = kRegisterNum;
+        double estimate = 0.7213 / (1 + 1.079 / m) * m * m / sum;
+        if (estimate <= 2.5 * m && zeros > 0) {
+            estimate = m * std::log(m / zeros);
+        }
+        return std::llround(estimate);
+    }
+
+    void MergeFrom(const HyperLogLog& other) {
+        if (other.registers_.empty()) {
+            return;
+        }
+        if (registers_.empty()) {
+            registers_ = other.registers_;
+            return;
+        }
+        for (uint32_t i = 0; i < kRegisterNum; i++) {
+            registers_[i] = std::max(registers_[i], other.registers_[i]);
+        }
+    }
+
+    bool Merge(const std::string& encoded) override {
+        HyperLogLog other;
+        if (!other.Decode(encoded.data(), encoded.size())) {
+            return false;
+        }
+        MergeFrom(other);
+        return true;
+    }
+
+    // the registers are encoded as (index, rank) pairs when few of them are set
+    void Encode(std::string* output) const override {
+        output->clear();
+        if (registers_.empty()) {
+            return;
+        }
+        uint32_t set_cnt = 0;
+        for (auto rank : registers_) {
+            if (rank != 0) {
+                set_cnt++;
+            }
+        }
+        if (set_cnt * 3 < kRegisterNum) {
+            output->push_back(kSparse);
+            for (uint32_t i = 0; i < kRegisterNum; i++) {
+                if (registers_[i] != 0) {
+                    Append(static_cast<uint16_t>(i), output);
+                    Append(registers_[i], output);
+                }
+            }
+        } else {
+            output->push_back(kDense);
+            output->append(reinterpret_cast<const char*>(registers_.data()), kRegisterNum);
+        }
+    }
+
+    bool Decode(const char* data, size_t size) override {
+        registers_.clear();
+        if (size == 0) {
+            return true;
+        }
+        const char* end = data + size;
+        char format = *data++;
+        if (format == kDense) {
+            if (static_cast<uint32_t>(end - data) != kRegisterNum) {
+                return false;
+            }
+            registers_.assign(data, end);
+            return true;
+        }
+        if (format != kSparse || (end - data) % 3 != 0) {
+            return false;
+        }
+        registers_.resize(kRegisterNum, 0);
+        while (data < end) {
+            uint16_t idx = 0;
+            uint8_t rank = 0;
+            Read(&data, end, &idx);
+            Read(&data, end, &rank);
+            if (idx >= kRegisterNum) {
+                registers_.clear();
+                return false;
+            }
+            registers_[idx] = rank;
+        }
+        return true;
+    }
+
+ private:
+    static constexpr char kSparse = 0;
+    static constexpr char kDense = 1;
+    std::vector<uint8_t> registers_;
+};
+
+// The mergeable frequency summary of fz_topn_frequency. The counts are exact until the number of
+// the keys exceeds the capacity, after that only the most frequent keys are kept, so the top keys
+// are approximate if the frequencies are flat.
+class TopNSketch : public PreAggrState {
+ public:
+    explicit TopNSketch(uint32_t capacity) : capacity_(capacity) {}
+
+    static uint32_t CapacityOf(int64_t top_n) {
+        return static_cast<uint32_t>(std::max<int64_t>(top_n * 8, 64));
+    }
+
+    PreAggrState* Clone() const override { return new TopNSketch(*this); }
+
+    bool Empty() const override { return counts_.empty(); }
+
+    void Clear() override { counts_.clear(); }
+
+    const std::unordered_map<std::string, int64_t>& counts() const { return counts_; }
+
+    void Add(const std::string& key, int64_t cnt = 1) {
+        counts_[key] += cnt;
+        // truncate lazily to amortize the cost
+        if (counts_.size() > 2 * capacity_) {
+            auto top = Top();
+            counts_.clear();
+            counts_.insert(top.begin(), top.end());
+        }
+    }
+
+    bool Merge(const std::string& encoded) override {
+        TopNSketch other(capacity_);
+        if (!other.Decode(encoded.data(), encoded.size())) {
+            return false;
+        }
+        for (const auto& kv : other.counts_) {
+            Add(kv.first, kv.second);
+        }
+        return true;
+    }
+
+    void Encode(std::string* output) const override {
+        output->clear();
+        auto top = Top();
+        Append(static_cast<uint32_t>(top.size()), output);
+        for (const auto& kv : top) {
+            AppendString(kv.first, output);
+            Append(kv.second, output);
+        }
+    }
+
+    bool Decode(const char* data, size_t size) override {
+        counts_.clear();
+        if (size == 0) {
+            return true;
+        }
+        const char* end = data + size;
+        uint32_t num = 0;
+        if (!Read(&data, end, &num)) {
+            return false;
+        }
+        for (uint32_t i = 0; i < num; i++) {
+            std::string key;
+            int64_t cnt = 0;
+            if (!ReadString(&data, end, &key) || !Read(&data, end, &cnt)) {
+                counts_.clear();
+                return false;
+            }
+            counts_[key] += cnt;
+        }
+        return true;
+    }
+
+ private:
+    // the most frequent `capacity_` keys
+    std::vector<std::pair<std::string, int64_t>> Top() const {
+        std::vector<std::pair<std::string, int64_t>> top(counts_.begin(), counts_.end());
+        if (top.size() > capacity_) {
+            std::nth_element(top.begin(), top.begin() + capacity_, top.end(),
+                             [](const std::pair<std::string, int64_t>& lhs,
+                                const std::pair<std::string, int64_t>& rhs) {
+                                 return lhs.second > rhs.second ||
+                                        (lhs.second == rhs.second && lhs.first < rhs.first);
+                             });
+            top.resize(capacity_);
+        }
+        return top;
+    }
+
+    uint32_t capacity_;
+    std::unordered_map<std::string, int64_t> counts_;
+};
+
+// the aggregate of each category of `*_cate` functions
+class CateAggrState : public PreAggrState {
+ public:
+    struct Value {
+        int64_t cnt = 0;
+        int64_t lval = 0;
+        double dval = 0;
+    };
+
+    // the values are kept in dval if is_float, or the kind is avg
+    CateAggrState(PreAggrKind kind, bool is_float) : kind_(kind), is_float_(is_float || kind == PreAggrKind::kAvg) {}
+
+    PreAggrState* Clone() const override { return new CateAggrState(*this); }
+
+    bool Empty() const override { return values_.empty(); }
+
+    void Clear() override { values_.clear(); }
+
+    PreAggrKind kind() const { return kind_; }
+
+    bool is_float() const { return is_float_; }
+
+    const std::map<std::string, Value>& values() const { return values_; }
+
+    void Update(const std::string& key, int64_t val) {
+        Value value;
+        value.cnt = 1;
+        value.lval = val;
+        value.dval = static_cast<double>(val);
+        MergeValue(key, value);
+    }
+
+    void Update(const std::string& key, double val) {
+        Value value;
+        value.cnt = 1;
+        value.lval = static_cast<int64_t>(val);
+        value.dval = val;
+        MergeValue(key, value);
+    }
+
+    bool Merge(const std::string& encoded) override {
+        CateAggrState other(kind_, is_float_);
+        if (!other.Decode(encoded.data(), encoded.size())) {
+            return false;
+        }
+        for (const auto& kv : other.values_) {
+            MergeValue(kv.first, kv.second);
+        }
+        return true;
+    }
+
+    void Encode(std::string* output) const override {
+        output->clear();
+        Append(static_cast<uint32_t>(values_.size()), output);
+        for (const auto& kv : values_) {
+            AppendString(kv.first, output);
+            Append(kv.second.cnt, output);
+            Append(kv.second.lval, output);
+            Append(kv.second.dval, output);
+        }
+    }
+
+    bool Decode(const char* data, size_t size) override {
+        values_.clear();
+        if (size == 0) {
+            return true;
+        }
+        const char* end = data + size;
+        uint32_t num = 0;
+        if (!Read(&data, end, &num)) {
+            return false;
+        }
+        for (uint32_t i = 0; i < num; i++) {
+            std::string key;
+            Value value;
+            if (!ReadString(&data, end, &key) || !Read(&data, end, &value.cnt) || !Read(&data, end, &value.lval) ||
+                !Read(&data, end, &value.dval)) {
+                values_.clear();
+                return false;
+            }
+            values_[key] = value;
+        }
+        return true;
+    }
+
+ private:
+    void MergeValue(const std::string& key, const Value& value) {
+        if (value.cnt == 0) {
+            return;
+        }
+        auto it = values_.find(key);
+        if (it == values_.end()) {
+            values_.emplace(key, value);
+            return;
+        }
+        auto& cur = it->second;
+        switch (kind_) {
+            case PreAggrKind::kSum:
+            case PreAggrKind::kAvg:
+                cur.lval += value.lval;
+                cur.dval += value.dval;
+                break;
+            case PreAggrKind::kMin:
+                cur.lval = std::min(cur.lval, value.lval);
+                cur.dval = std::min(cur.dval, value.dval);
+                break;
+            case PreAggrKind::kMax:
+                cur.lval = std::max(cur.lval, value.lval);
+                cur.dval = std::max(cur.dval, value.dval);
+                break;
+            default:
+                break;
+        }
+        cur.cnt += value.cnt;
+    }
+
+    PreAggrKind kind_;
+    bool is_float_;
+    std::map<std::string, Value> values_;
+};
+
+}  // namespace base
+}  // namespace hybridse
+#endif  // HYBRIDSE_INCLUDE_BASE_FE_PRE_AGGR_H_
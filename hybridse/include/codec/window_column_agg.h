@@ -0,0 +1,130 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HYBRIDSE_INCLUDE_CODEC_WINDOW_COLUMN_AGG_H_
+#define HYBRIDSE_INCLUDE_CODEC_WINDOW_COLUMN_AGG_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "codec/list_iterator_codec.h"
+
+namespace hybridse {
+namespace codec {
+
+// Column-wise aggregation of a window.
+//
+// The referenced columns of the window rows are decoded once into contiguous typed
+// arrays, integer columns are widened to int64 and float columns to double, then
+// sum/count/avg/min/max over every column run as the kernels below. The kernels use
+// AVX-512 or AVX2 if the cpu supports them, or the scalar loops otherwise.
+
+enum class ColumnAggType : int64_t { kInt16 = 0, kInt32, kInt64, kFloat, kDouble };
+
+// the comparison of the condition `col <cmp> value` of the *_where aggregations
+enum class ColumnAggCmp : int64_t { kNone = 0, kEq, kNe, kLt, kLe, kGt, kGe };
+
+enum class ColumnAggSimd { kAuto, kScalar, kAvx2, kAvx512 };
+
+// the aggregate of the valid values of a column, sum of the int64 column is in
+// sum_i64 and the min/max of it are in min_i64/max_i64, the double ones are in the
+// *_f64 fields. The min/max are the identities if cnt is 0
+struct ColumnAggResult {
+    int64_t cnt;
+    int64_t sum_i64;
+    double sum_f64;
+    int64_t min_i64;
+    int64_t max_i64;
+    double min_f64;
+    double max_f64;
+};
+
+// the simd level used by ColumnAggSimd::kAuto
+ColumnAggSimd GetColumnAggSimd();
+
+// valid[i] is 0 or 1, values[i] is ignored if valid[i] is 0.
+// simd is downgraded to the level supported by the cpu
+void ColumnAggInt64(const int64_t* values, const uint8_t* valid, size_t n, ColumnAggResult* res,
+                    ColumnAggSimd simd = ColumnAggSimd::kAuto);
+void ColumnAggDouble(const double* values, const uint8_t* valid, size_t n, ColumnAggResult* res,
+                     ColumnAggSimd simd = ColumnAggSimd::kAuto);
+
+// out[i] = valid[i] && values[i] <cmp> rhs
+void ColumnFilterInt64(const int64_t* values, const uint8_t* valid, size_t n, ColumnAggCmp cmp, double rhs,
+                       uint8_t* out);
+void ColumnFilterDouble(const double* values, const uint8_t* valid, size_t n, ColumnAggCmp cmp, double rhs,
+                        uint8_t* out);
+
+// The referenced columns of a window decoded into typed arrays. The buffers are kept
+// between the loads, so a thread local instance does not allocate for every window.
+class WindowColumns {
+ public:
+    WindowColumns() : row_cnt_(0), columns_() {}
+
+    void Clear() { columns_.clear(); }
+
+    // idx and offset are the ones of ColInfo of the column in slice slice_idx,
+    // return the position of the column
+    size_t AddColumn(size_t slice_idx, uint32_t idx, uint32_t offset, ColumnAggType type);
+
+    // set the columns of col_spec, which is laid out as the columns of the spec of
+    // WindowColumnAgg. The columns and their buffers are kept if they are the same
+    void SetColumns(const int64_t* col_spec, size_t col_cnt);
+
+    // decode the columns of the rows of window
+    void Load(ListV<Row>* window);
+
+    size_t GetRowCnt() const { return row_cnt_; }
+    size_t GetColumnCnt() const { return columns_.size(); }
+    bool IsDouble(size_t pos) const {
+        return columns_[pos].type == ColumnAggType::kFloat || columns_[pos].type == ColumnAggType::kDouble;
+    }
+    const int64_t* GetInt64Values(size_t pos) const { return columns_[pos].int64_values.data(); }
+    const double* GetDoubleValues(size_t pos) const { return columns_[pos].double_values.data(); }
+    const uint8_t* GetValid(size_t pos) const { return columns_[pos].valid.data(); }
+
+ private:
+    struct Column {
+        size_t slice_idx;
+        uint32_t idx;
+        uint32_t offset;
+        ColumnAggType type;
+        std::vector<int64_t> int64_values;
+        std::vector<double> double_values;
+        std::vector<uint8_t> valid;
+    };
+
+    size_t row_cnt_;
+    std::vector<Column> columns_;
+};
+
+// the layout of the spec of WindowColumnAgg:
+// [col_cnt, slot_cnt,
+//  col_cnt * (slice_idx, idx, offset, ColumnAggType),
+//  slot_cnt * (col, cond_col, ColumnAggCmp, bits of the double rhs)]
+// cond_col is -1 if the slot has no condition
+static constexpr size_t kWindowColumnSpecWidth = 4;
+static constexpr size_t kWindowSlotSpecWidth = 4;
+
+// aggregate every slot of spec over window into results, it is called by the
+// code generated for the window aggregations if enable_window_column_agg is set.
+// window is the ListRef<Row> of the window, results is ColumnAggResult[slot_cnt]
+void WindowColumnAgg(int8_t* window, const int64_t* spec, int8_t* results);
+
+}  // namespace codec
+}  // namespace hybridse
+#endif  // HYBRIDSE_INCLUDE_CODEC_WINDOW_COLUMN_AGG_H_
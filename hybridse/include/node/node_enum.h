@@ -83,6 +83,7 @@ enum SqlNodeType {
     kReplicaNum,
     kDistributions,
     kStorageMode,
+    kDiskTableOption,
     kCreateSpStmt,
     kInputParameter,
     kPartitionNum,
@@ -383,6 +383,8 @@ class NodeManager {
 
     SqlNode *MakeStorageModeNode(StorageMode storage_mode);
 
+    SqlNode *MakeDiskTableOptionNode(const std::string &name, const std::string &value);
+
     SqlNode *MakePartitionNumNode(int num);
 
     SqlNode *MakeDistributionsNode(SqlNodeList *distribution_list);
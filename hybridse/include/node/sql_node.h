@@ -1853,6 +1853,24 @@ class StorageModeNode : public SqlNode {
     StorageMode storage_mode_;
 };
 
+// options of disk table, e.g. filter_policy, the value of integer option is kept as string
+class DiskTableOptionNode : public SqlNode {
+ public:
+    DiskTableOptionNode(const std::string &name, const std::string &value)
+        : SqlNode(kDiskTableOption, 0, 0), name_(name), value_(value) {}
+
+    ~DiskTableOptionNode() {}
+
+    const std::string &GetName() const { return name_; }
+    const std::string &GetValue() const { return value_; }
+
+    void Print(std::ostream &output, const std::string &org_tab) const;
+
+ private:
+    std::string name_;
+    std::string value_;
+};
+
 class CreateStmt : public SqlNode {
  public:
     CreateStmt()
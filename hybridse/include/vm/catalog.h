@@ -379,6 +379,15 @@ class PartitionHandler : public TableHandler {
         }
         return segments;
     }
+
+    /// Return the aggregate of the rows binding to given key in [start, end]
+    /// which is maintained incrementally by storage. The aggregate is encoded
+    /// as `agg_val` of pre-aggr table and is empty if it is null.
+    /// Return `false` by default, which means it is not available.
+    virtual bool GetIncrementalAggr(const std::string& key, int64_t start,
+                                    int64_t end, std::string* agg_val) {
+        return false;
+    }
     /// Return the name of handler, and return `"PartitionHandler"` by default.
     const std::string GetHandlerTypeName() override {
         return "PartitionHandler";
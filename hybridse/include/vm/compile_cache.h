@@ -0,0 +1,307 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HYBRIDSE_INCLUDE_VM_COMPILE_CACHE_H_
+#define HYBRIDSE_INCLUDE_VM_COMPILE_CACHE_H_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include "base/fe_status.h"
+#include "bthread/countdown_event.h"
+#include "vm/engine_context.h"
+
+namespace hybridse {
+namespace vm {
+
+/// \brief The statistics of a ShardedCompileCache.
+struct CompileCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    /// the compiles run by the cache, the callers waiting for a compile in flight are not counted
+    uint64_t compiles = 0;
+    uint64_t compile_failures = 0;
+    uint64_t compile_time_us = 0;
+    uint64_t evictions = 0;
+    uint64_t entries = 0;
+    uint64_t weight = 0;
+};
+
+/// \brief A concurrent LRU cache of the compile results keyed by db, engine mode and sql.
+///
+/// The entries are spread over shards with their own locks and LRU lists, the limits of the number of entries and
+/// the total weight are split evenly among the shards. The weight of an entry is given by the weigher, e.g. the
+/// estimated memory of a CompileInfo.
+///
+/// GetOrCompile deduplicates the concurrent compiles of the same key: the first caller compiles and the others wait
+/// for its result. The callers may be bthreads, so they wait on a bthread event which does not block the worker.
+template <typename V>
+class ShardedCompileCache {
+ public:
+    using Compiler = std::function<std::shared_ptr<V>(base::Status*)>;
+    using Weigher = std::function<uint64_t(const std::shared_ptr<V>&)>;
+
+    /// \param max_entries: the max number of entries of all the dbs and modes together
+    /// \param max_weight: the max total weight, `0` means no limit
+    /// \param weigher: the weight of an entry, every entry weighs `1` if it is null
+    /// \param shard_num: the number of shards, `0` to choose it by `max_entries`
+    ShardedCompileCache(uint32_t max_entries, uint64_t max_weight, Weigher weigher = nullptr,
+                        uint32_t shard_num = 0)
+        : shard_num_(0 == shard_num ? DefaultShardNum(max_entries) : shard_num),
+          shards_(new Shard[shard_num_]),
+          max_shard_entries_((std::max<uint32_t>(max_entries, 1) + shard_num_ - 1) / shard_num_),
+          max_shard_weight_((max_weight + shard_num_ - 1) / shard_num_),
+          weigher_(weigher) {}
+
+    ShardedCompileCache(const ShardedCompileCache&) = delete;
+    ShardedCompileCache& operator=(const ShardedCompileCache&) = delete;
+
+    /// Return the cached value, null if not found.
+    std::shared_ptr<V> Get(const std::string& db, EngineMode mode, const std::string& sql) {
+        auto key = MakeKey(db, mode, sql);
+        auto& shard = GetShard(key);
+        std::lock_guard<std::mutex> lock(shard.mu);
+        auto value = GetLocked(&shard, key);
+        if (value) {
+            hits_.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            misses_.fetch_add(1, std::memory_order_relaxed);
+        }
+        return value;
+    }
+
+    /// Return the cached value, or compile and cache it if not found.
+    ///
+    /// If the same key is being compiled by another caller, wait for its result instead. The status of the compile
+    /// is returned in `status`, the value is null if the compile fails.
+    std::shared_ptr<V> GetOrCompile(const std::string& db, EngineMode mode, const std::string& sql,
+                                    const Compiler& compiler, base::Status* status) {
+        auto key = MakeKey(db, mode, sql);
+        auto& shard = GetShard(key);
+        std::shared_ptr<Flight> flight;
+        bool leader = false;
+        uint64_t generation = 0;
+        {
+            std::lock_guard<std::mutex> lock(shard.mu);
+            auto value = GetLocked(&shard, key);
+            if (value) {
+                hits_.fetch_add(1, std::memory_order_relaxed);
+                return value;
+            }
+            misses_.fetch_add(1, std::memory_order_relaxed);
+            auto iter = shard.flights.find(key);
+            if (iter == shard.flights.end()) {
+                flight = std::make_shared<Flight>();
+                shard.flights.insert({key, flight});
+                leader = true;
+                generation = shard.generation;
+            } else {
+                flight = iter->second;
+            }
+        }
+        if (!leader) {
+            flight->done.wait();
+            *status = flight->status;
+            return flight->value;
+        }
+
+        base::Status compile_status;
+        auto start = std::chrono::steady_clock::now();
+        std::shared_ptr<V> value;
+        try {
+            value = compiler(&compile_status);
+        } catch (...) {
+            // the waiters get the failure, and the key can be compiled again
+            compile_failures_.fetch_add(1, std::memory_order_relaxed);
+            Publish(&shard, key, db, generation, flight.get(), nullptr,
+                    base::Status(common::kEngineCacheError, "the compile of the sql throws an exception"));
+            throw;
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        compiles_.fetch_add(1, std::memory_order_relaxed);
+        compile_time_us_.fetch_add(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count(),
+                                   std::memory_order_relaxed);
+        if (!value) {
+            compile_failures_.fetch_add(1, std::memory_order_relaxed);
+        }
+        Publish(&shard, key, db, generation, flight.get(), value, compile_status);
+        *status = compile_status;
+        return value;
+    }
+
+    /// Insert or replace the value of the key.
+    void Put(const std::string& db, EngineMode mode, const std::string& sql, const std::shared_ptr<V>& value) {
+        auto key = MakeKey(db, mode, sql);
+        auto& shard = GetShard(key);
+        std::lock_guard<std::mutex> lock(shard.mu);
+        PutLocked(&shard, key, db, value);
+    }
+
+    /// Remove the entries of the db, all the entries if `db` is empty.
+    void Clear(const std::string& db) {
+        for (uint32_t i = 0; i < shard_num_; ++i) {
+            auto& shard = shards_[i];
+            std::lock_guard<std::mutex> lock(shard.mu);
+            shard.generation++;
+            for (auto iter = shard.entries.begin(); iter != shard.entries.end();) {
+                if (db.empty() || iter->second.db == db) {
+                    shard.weight -= iter->second.weight;
+                    shard.lru.erase(iter->second.lru_iter);
+                    iter = shard.entries.erase(iter);
+                } else {
+                    ++iter;
+                }
+            }
+        }
+    }
+
+    CompileCacheStats GetStats() const {
+        CompileCacheStats stats;
+        stats.hits = hits_.load(std::memory_order_relaxed);
+        stats.misses = misses_.load(std::memory_order_relaxed);
+        stats.compiles = compiles_.load(std::memory_order_relaxed);
+        stats.compile_failures = compile_failures_.load(std::memory_order_relaxed);
+        stats.compile_time_us = compile_time_us_.load(std::memory_order_relaxed);
+        stats.evictions = evictions_.load(std::memory_order_relaxed);
+        for (uint32_t i = 0; i < shard_num_; ++i) {
+            auto& shard = shards_[i];
+            std::lock_guard<std::mutex> lock(shard.mu);
+            stats.entries += shard.entries.size();
+            stats.weight += shard.weight;
+        }
+        return stats;
+    }
+
+    uint32_t GetShardNum() const { return shard_num_; }
+
+ private:
+    struct Entry {
+        std::string db;
+        std::shared_ptr<V> value;
+        uint64_t weight;
+        typename std::list<std::string>::iterator lru_iter;
+    };
+
+    struct Flight {
+        // signaled once value and status are set
+        bthread::CountdownEvent done{1};
+        std::shared_ptr<V> value;
+        base::Status status;
+    };
+
+    struct Shard {
+        mutable std::mutex mu;
+        // the keys from the most to the least recently used
+        std::list<std::string> lru;
+        std::unordered_map<std::string, Entry> entries;
+        std::unordered_map<std::string, std::shared_ptr<Flight>> flights;
+        uint64_t weight = 0;
+        // increased by each Clear
+        uint64_t generation = 0;
+    };
+
+    // a shard holds 8 entries at least, so that a small cache still evicts by LRU order mostly
+    static uint32_t DefaultShardNum(uint32_t max_entries) {
+        return std::min<uint32_t>(16, std::max<uint32_t>(1, max_entries / 8));
+    }
+
+    static std::string MakeKey(const std::string& db, EngineMode mode, const std::string& sql) {
+        std::string key;
+        key.reserve(db.size() + sql.size() + 4);
+        key.append(std::to_string(mode));
+        key.push_back('\0');
+        key.append(db);
+        key.push_back('\0');
+        key.append(sql);
+        return key;
+    }
+
+    Shard& GetShard(const std::string& key) { return shards_[std::hash<std::string>()(key) % shard_num_]; }
+
+    // cache the value compiled by the leader of the flight and wake up the waiters
+    void Publish(Shard* shard, const std::string& key, const std::string& db, uint64_t generation, Flight* flight,
+                 const std::shared_ptr<V>& value, const base::Status& status) {
+        {
+            std::lock_guard<std::mutex> lock(shard->mu);
+            // the value compiled before a Clear may be stale, e.g. the table has been altered
+            if (value && generation == shard->generation) {
+                PutLocked(shard, key, db, value);
+            }
+            shard->flights.erase(key);
+        }
+        flight->value = value;
+        flight->status = status;
+        flight->done.signal();
+    }
+
+    std::shared_ptr<V> GetLocked(Shard* shard, const std::string& key) {
+        auto iter = shard->entries.find(key);
+        if (iter == shard->entries.end()) {
+            return nullptr;
+        }
+        shard->lru.splice(shard->lru.begin(), shard->lru, iter->second.lru_iter);
+        return iter->second.value;
+    }
+
+    void PutLocked(Shard* shard, const std::string& key, const std::string& db, const std::shared_ptr<V>& value) {
+        uint64_t weight = weigher_ ? weigher_(value) : 1;
+        auto iter = shard->entries.find(key);
+        if (iter != shard->entries.end()) {
+            shard->weight -= iter->second.weight;
+            shard->lru.splice(shard->lru.begin(), shard->lru, iter->second.lru_iter);
+            iter->second.value = value;
+            iter->second.weight = weight;
+        } else {
+            shard->lru.push_front(key);
+            shard->entries.insert({key, Entry{db, value, weight, shard->lru.begin()}});
+        }
+        shard->weight += weight;
+        // the new entry is kept even if it is heavier than the limit alone
+        while (shard->lru.size() > 1 &&
+               (shard->entries.size() > max_shard_entries_ ||
+                (max_shard_weight_ > 0 && shard->weight > max_shard_weight_))) {
+            auto evict_iter = shard->entries.find(shard->lru.back());
+            shard->weight -= evict_iter->second.weight;
+            shard->entries.erase(evict_iter);
+            shard->lru.pop_back();
+            evictions_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    const uint32_t shard_num_;
+    std::unique_ptr<Shard[]> shards_;
+    const uint64_t max_shard_entries_;
+    const uint64_t max_shard_weight_;
+    Weigher weigher_;
+
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+    std::atomic<uint64_t> compiles_{0};
+    std::atomic<uint64_t> compile_failures_{0};
+    std::atomic<uint64_t> compile_time_us_{0};
+    std::atomic<uint64_t> evictions_{0};
+};
+
+}  // namespace vm
+}  // namespace hybridse
+#endif  // HYBRIDSE_INCLUDE_VM_COMPILE_CACHE_H_
@@ -17,11 +17,14 @@
 #ifndef HYBRIDSE_INCLUDE_VM_ENGINE_H_
 #define HYBRIDSE_INCLUDE_VM_ENGINE_H_
 
+#include <condition_variable>  // NOLINT
+#include <deque>
 #include <map>
 #include <memory>
 #include <mutex>  //NOLINT
 #include <set>
 #include <string>
+#include <thread>  // NOLINT
 #include <utility>
 #include <vector>
 #include <unordered_map>
@@ -33,6 +36,7 @@
 #include "llvm-c/Target.h"
 #include "proto/fe_common.pb.h"
 #include "vm/catalog.h"
+#include "vm/compile_cache.h"
 #include "vm/engine_context.h"
 #include "vm/router.h"
 
@@ -113,15 +117,64 @@ class EngineOptions {
         return enable_window_column_pruning_;
     }
 
-    /// Set the maximum number of cache entries, default is `50`.
+    /// Set `true` to share one scan among the request mode windows over the same
+    /// partition and order, default `false`.
+    ///
+    /// The smaller windows are taken as prefixes of the largest one. It is ignored if
+    /// cluster optimization is enabled.
+    inline EngineOptions* SetEnableWindowScanSharing(bool flag) {
+        enable_window_scan_sharing_ = flag;
+        return this;
+    }
+    /// Return if the request mode windows share their scan.
+    inline bool IsEnableWindowScanSharing() const {
+        return enable_window_scan_sharing_;
+    }
+
+    /// Set `true` to enable tiered jit, default `false`.
+    ///
+    /// If set `true`, the sql is compiled with JitOptLevel::kJitOptFast first. Once a compile result has been hit
+    /// `jit_tier_up_threshold` times, it is recompiled with JitOptLevel::kJitOptAggressive in background and the
+    /// later runs switch to the optimized result. A failed recompiling is retried after `threshold << failures` more
+    /// hits, up to `threshold << 10`.
+    inline EngineOptions* SetEnableTieredJit(bool flag) {
+        enable_tiered_jit_ = flag;
+        return this;
+    }
+    /// Return if the engine support tiered jit.
+    inline bool IsEnableTieredJit() const { return enable_tiered_jit_; }
+
+    /// Set the number of hits of a compile result to recompile it with the aggressive opt level, default is `100`.
+    inline EngineOptions* SetJitTierUpThreshold(uint64_t threshold) {
+        jit_tier_up_threshold_ = threshold;
+        return this;
+    }
+    /// Return the number of hits to recompile a compile result under tiered jit.
+    inline uint64_t GetJitTierUpThreshold() const { return jit_tier_up_threshold_; }
+
+    /// Set the maximum number of cache entries of all the dbs and modes together, default is `500`.
+    ///
+    /// It used to limit each (db, mode) pair. The entries are spread over up to 16 shards with 8 entries at least
+    /// each, so a size below `128` shards the cache less.
     inline void SetMaxSqlCacheSize(uint32_t size) {
         max_sql_cache_size_ = size;
     }
     /// Return the maximum number of entries we can hold for compiling cache.
     inline uint32_t GetMaxSqlCacheSize() const { return max_sql_cache_size_; }
 
+    /// Set the maximum estimated memory in bytes of the cache entries, default is `0`, no limit.
+    ///
+    /// An entry weighs the estimated size of its jit code and plan, see CompileInfo::GetMemoryUsage.
+    inline void SetMaxSqlCacheMemory(uint64_t bytes) {
+        max_sql_cache_memory_ = bytes;
+    }
+    /// Return the maximum estimated memory in bytes of the compiling cache.
+    inline uint64_t GetMaxSqlCacheMemory() const { return max_sql_cache_memory_; }
+
     /// Return JitOptions
     inline hybridse::vm::JitOptions& jit_options() { return jit_options_; }
+    /// Return JitOptions
+    inline const hybridse::vm::JitOptions& jit_options() const { return jit_options_; }
 
  private:
     bool keep_ir_;
@@ -132,7 +185,11 @@ class EngineOptions {
     bool enable_expr_optimize_;
     bool enable_batch_window_parallelization_;
     bool enable_window_column_pruning_;
+    bool enable_window_scan_sharing_;
+    bool enable_tiered_jit_;
+    uint64_t jit_tier_up_threshold_;
     uint32_t max_sql_cache_size_;
+    uint64_t max_sql_cache_memory_;
     JitOptions jit_options_;
 };
 
@@ -211,8 +268,16 @@ class BatchRunSession : public RunSession {
     void SetParameterSchema(const codec::Schema& schema) { parameter_schema_ = schema; }
     /// Return query parameter schema.
     virtual const Schema& GetParameterSchema() const { return parameter_schema_; }
+    /// \brief Set the max number of threads to run the query, default is `1`.
+    ///
+    /// The window and group aggregations split the keys of their partitions
+    /// into morsels, which are run by the shared worker pool in parallel.
+    void SetParallelism(uint32_t parallelism) { parallelism_ = parallelism; }
+    /// Return the max number of threads to run the query.
+    uint32_t GetParallelism() const { return parallelism_; }
  private:
     codec::Schema parameter_schema_;
+    uint32_t parallelism_ = 1;
 };
 
 /// \brief MockRequestRunSession is a kind of mock RuSession design for request query
@@ -334,7 +399,7 @@ struct ExplainOutput {
 /// \brief An engine is responsible to compile SQL on the specific Catalog.
 ///
 /// An engine can be used to `compile sql and explain the compiling result.
-/// It maintains a LRU cache for compiling result.
+/// It maintains a sharded LRU cache for compiling result, the concurrent compiles of the same sql are deduplicated.
 ///
 /// **Example**
 /// ```
@@ -418,15 +483,23 @@ class Engine {
     /// \brief Get engine's options
     EngineOptions GetEngineOptions();
 
+    /// \brief Return the hit, miss and compile time statistics of the compiling result cache
+    CompileCacheStats GetCacheStats() const { return compile_cache_.GetStats(); }
+
+    /// \brief Return the compile info to run in place of a compiled `info` under tiered jit.
+    ///
+    /// It counts the runs of `info` and schedules the recompiling with the aggressive opt level when the count
+    /// reaches the tier up threshold. The recompiled result is returned once it is ready, `info` otherwise.
+    /// `Get` calls it on the cache hits, the callers holding the compile info by themselves, e.g. the procedures,
+    /// call it before each run.
+    std::shared_ptr<CompileInfo> GetTieredCompileInfo(const std::shared_ptr<CompileInfo>& info);
+
  private:
     bool GetDependentTables(const node::PlanNode* node, const std::string& default_db,
                             std::set<std::pair<std::string, std::string>>* db_tables, base::Status& status);  // NOLINT
-    std::shared_ptr<CompileInfo> GetCacheLocked(const std::string& db,
-                                                const std::string& sql,
-                                                EngineMode engine_mode);
-    bool SetCacheLocked(const std::string& db, const std::string& sql,
-                        EngineMode engine_mode,
-                        std::shared_ptr<CompileInfo> info);
+    std::shared_ptr<CompileInfo> Compile(const std::string& sql, const std::string& db,
+                                         RunSession& session,    // NOLINT
+                                         base::Status& status);  // NOLINT
 
     bool IsCompatibleCache(RunSession& session,  // NOLINT
                            std::shared_ptr<CompileInfo> info,
@@ -436,10 +509,21 @@ class Engine {
                  EngineMode engine_mode, const codec::Schema& parameter_schema,
                  const std::set<size_t>& common_column_indices,
                  ExplainOutput* explain_output, base::Status* status);
+
+    // the loop of the background thread recompiling the hot sql
+    void TierUpLoop();
+    bool TierUp(const std::shared_ptr<CompileInfo>& info);
+
     std::shared_ptr<Catalog> cl_;
     EngineOptions options_;
-    base::SpinMutex mu_;
-    EngineLRUCache lru_cache_;
+    ShardedCompileCache<CompileInfo> compile_cache_;
+
+    std::mutex tier_up_mu_;
+    std::condition_variable tier_up_cv_;
+    std::deque<std::shared_ptr<CompileInfo>> tier_up_queue_;
+    bool tier_up_stopped_ = false;
+    // started on the first recompiling
+    std::thread tier_up_thread_;
 };
 
 /// \brief Local tablet is responsible to run a task locally.
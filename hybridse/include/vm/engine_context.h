@@ -19,7 +19,6 @@
 #include <memory>
 #include <set>
 #include <string>
-#include "boost/compute/detail/lru_cache.hpp"
 #include "vm/physical_op.h"
 namespace hybridse {
 namespace vm {
@@ -63,18 +62,10 @@ class CompileInfo {
                                   const std::string& tab) = 0;
     virtual void DumpClusterJob(std::ostream& output,
                                 const std::string& tab) = 0;
+    // the estimated memory footprint, used to weigh the compile cache
+    virtual size_t GetMemoryUsage() { return sizeof(CompileInfo); }
 };
 
-/// @typedef EngineLRUCache
-/// - EngineMode
-///     - DB name
-///       - SQL string
-///           - CompileInfo
-typedef std::map<EngineMode,
-                std::map<std::string,
-                    boost::compute::detail::lru_cache<std::string, std::shared_ptr<CompileInfo>>>>
-    EngineLRUCache;
-
 class CompileInfoCache {
  public:
     virtual ~CompileInfoCache() {}
@@ -87,6 +78,15 @@ class CompileInfoCache {
         base::Status& status) = 0;  // NOLINT
 };
 
+/// The optimization level of the jit compiled functions.
+///
+/// - kJitOptFast: promote allocas and simplify the cfg only, for the sql run
+///   once or a few times
+/// - kJitOptDefault: the default function level passes
+/// - kJitOptAggressive: the O3 module pipeline with inlining and vectorization
+///   on the host cpu, for the hot sql
+enum JitOptLevel { kJitOptFast, kJitOptDefault, kJitOptAggressive };
+
 class JitOptions {
  public:
     bool IsEnableMcjit() const { return enable_mcjit_; }
@@ -101,11 +101,27 @@ class JitOptions {
     bool IsEnablePerf() const { return enable_perf_; }
     void SetEnablePerf(bool flag) { enable_perf_ = flag; }
 
+    JitOptLevel GetOptLevel() const { return opt_level_; }
+    void SetOptLevel(JitOptLevel level) { opt_level_ = level; }
+
+    // the dir of the on-disk cache of the compiled objects, empty to disable
+    // the cache. Only the llvm jit supports the cache
+    const std::string& GetObjectCacheDir() const { return object_cache_dir_; }
+    void SetObjectCacheDir(const std::string& dir) { object_cache_dir_ = dir; }
+
+    // the max bytes of the cached objects, the least recently used ones are
+    // removed once it is exceeded. 0 means unlimited
+    uint64_t GetObjectCacheMaxSize() const { return object_cache_max_size_; }
+    void SetObjectCacheMaxSize(uint64_t size) { object_cache_max_size_ = size; }
+
  private:
     bool enable_mcjit_ = false;
     bool enable_vtune_ = false;
     bool enable_gdb_ = false;
     bool enable_perf_ = false;
+    JitOptLevel opt_level_ = kJitOptDefault;
+    std::string object_cache_dir_;
+    uint64_t object_cache_max_size_ = 0;
 };
 }  // namespace vm
 }  // namespace hybridse
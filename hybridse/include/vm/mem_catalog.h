@@ -167,6 +167,8 @@ class MemTableHandler : public TableHandler {
         const std::string& idx_name);
 
     void AddRow(const Row& row);
+    // Append all the rows of the table
+    void AddRows(const MemTableHandler& table);
     void Reverse();
     virtual const uint64_t GetCount() { return table_.size(); }
     virtual Row At(uint64_t pos) {
@@ -610,6 +612,9 @@ class MemPartitionHandler
     const std::string& GetDatabase() override;
     virtual std::unique_ptr<WindowIterator> GetWindowIterator();
     bool AddRow(const std::string& key, uint64_t ts, const Row& row);
+    // Add the rows of a whole segment, appended to the segment of the key if
+    // it exists
+    void AddSegment(const std::string& key, MemTimeTable&& segment);
     void Sort(const bool is_asc);
     void Reverse();
     void Print();
@@ -1479,6 +1479,12 @@ class PhysicalRequestUnionNode : public PhysicalBinaryNode {
     const RequestWindowUnionList &window_unions() const {
         return window_unions_;
     }
+    // the request union over the same partition and order whose frame covers
+    // this one, the window is taken as a prefix of its scan if not null
+    PhysicalRequestUnionNode *shared_scan() const { return shared_scan_; }
+    void set_shared_scan(PhysicalRequestUnionNode *shared_scan) {
+        shared_scan_ = shared_scan;
+    }
 
     base::Status WithNewChildren(node::NodeManager *nm,
                                  const std::vector<PhysicalOpNode *> &children,
@@ -1489,19 +1495,26 @@ class PhysicalRequestUnionNode : public PhysicalBinaryNode {
     const bool exclude_current_time_;
     const bool output_request_row_;
     RequestWindowUnionList window_unions_;
+    PhysicalRequestUnionNode *shared_scan_ = nullptr;
 };
 
 class PhysicalRequestAggUnionNode : public PhysicalOpNode {
  public:
-    PhysicalRequestAggUnionNode(PhysicalOpNode *request, PhysicalOpNode *raw, PhysicalOpNode *aggr,
-                                const RequestWindowOp &window, const RequestWindowOp &aggr_window,
-                                bool instance_not_in_window, bool exclude_current_time, bool output_request_row,
-                                const node::FnDefNode *func, const node::ExprNode* agg_col)
+    // the aggregate calls over the same window, the i-th call is computed from the pre-aggr table aggrs[i]
+    // with the window aggr_windows[i]
+    PhysicalRequestAggUnionNode(PhysicalOpNode *request, PhysicalOpNode *raw,
+                                const std::vector<PhysicalOpNode *> &aggrs, const RequestWindowOp &window,
+                                const std::vector<RequestWindowOp> &aggr_windows, bool instance_not_in_window,
+                                bool exclude_current_time, bool output_request_row,
+                                const std::vector<const node::FnDefNode *> &funcs,
+                                const std::vector<const node::ExprNode *> &agg_cols,
+                                const std::vector<std::string> &agg_args)
         : PhysicalOpNode(kPhysicalOpRequestAggUnion, true),
           window_(window),
-          agg_window_(aggr_window),
-          func_(func),
-          agg_col_(agg_col),
+          agg_windows_(aggr_windows),
+          funcs_(funcs),
+          agg_cols_(agg_cols),
+          agg_args_(agg_args),
           instance_not_in_window_(instance_not_in_window),
           exclude_current_time_(exclude_current_time),
           output_request_row_(output_request_row) {
@@ -1512,12 +1525,14 @@ class PhysicalRequestAggUnionNode : public PhysicalOpNode {
         fn_infos_.push_back(&window_.range_.fn_info());
         fn_infos_.push_back(&window_.index_key_.fn_info());
 
-        fn_infos_.push_back(&agg_window_.partition_.fn_info());
-        fn_infos_.push_back(&agg_window_.sort_.fn_info());
-        fn_infos_.push_back(&agg_window_.range_.fn_info());
-        fn_infos_.push_back(&agg_window_.index_key_.fn_info());
+        for (auto &agg_window : agg_windows_) {
+            fn_infos_.push_back(&agg_window.partition_.fn_info());
+            fn_infos_.push_back(&agg_window.sort_.fn_info());
+            fn_infos_.push_back(&agg_window.range_.fn_info());
+            fn_infos_.push_back(&agg_window.index_key_.fn_info());
+        }
 
-        AddProducers(request, raw, aggr);
+        AddProducers(request, raw, aggrs);
     }
     virtual ~PhysicalRequestAggUnionNode() {}
     base::Status InitSchema(PhysicalPlanContext *) override;
@@ -1535,6 +1550,8 @@ class PhysicalRequestAggUnionNode : public PhysicalOpNode {
     const bool exclude_current_time() const { return exclude_current_time_; }
     const bool output_request_row() const { return output_request_row_; }
     const RequestWindowOp &window() const { return window_; }
+    // the number of the aggregate calls, the pre-aggr table of the i-th call is the producer i + 2
+    size_t GetAggNum() const { return funcs_.size(); }
 
     base::Status WithNewChildren(node::NodeManager *nm,
                                  const std::vector<PhysicalOpNode *> &children,
@@ -1543,9 +1560,12 @@ class PhysicalRequestAggUnionNode : public PhysicalOpNode {
     }
 
     RequestWindowOp window_;
-    RequestWindowOp agg_window_;
-    const node::FnDefNode* func_ = nullptr;
-    const node::ExprNode* agg_col_;
+    // agg_windows_ is never resized as fn_infos_ refers to its elements
+    std::vector<RequestWindowOp> agg_windows_;
+    std::vector<const node::FnDefNode*> funcs_;
+    std::vector<const node::ExprNode*> agg_cols_;
+    // all the arguments of each aggregate call, in the format of the aggr_col of pre-aggr table
+    std::vector<std::string> agg_args_;
     const SchemasContext* parent_schema_context_ = nullptr;
 
  private:
@@ -1553,10 +1573,12 @@ class PhysicalRequestAggUnionNode : public PhysicalOpNode {
     const bool exclude_current_time_;
     const bool output_request_row_;
 
-    void AddProducers(PhysicalOpNode *request, PhysicalOpNode *raw, PhysicalOpNode *aggr) {
+    void AddProducers(PhysicalOpNode *request, PhysicalOpNode *raw, const std::vector<PhysicalOpNode *> &aggrs) {
         AddProducer(request);
         AddProducer(raw);
-        AddProducer(aggr);
+        for (auto aggr : aggrs) {
+            AddProducer(aggr);
+        }
     }
 
     Schema agg_schema_;
@@ -0,0 +1,212 @@
+/*
+ * Copyright 2021 4Paradigm
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "base/fe_pre_aggr.h"
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace hybridse {
+namespace base {
+
+class PreAggrTest : public ::testing::Test {
+ public:
+    PreAggrTest() {}
+    ~PreAggrTest() {}
+};
+
+TEST_F(PreAggrTest, ParseFunc) {
+    PreAggrFunc func;
+    ASSERT_TRUE(ParsePreAggrFunc("sum", &func));
+    ASSERT_EQ(PreAggrKind::kSum, func.kind);
+    ASSERT_FALSE(func.HasState());
+    ASSERT_EQ(1u, func.ArgNum());
+
+    ASSERT_TRUE(ParsePreAggrFunc("count_where", &func));
+    ASSERT_EQ(PreAggrKind::kCount, func.kind);
+    ASSERT_TRUE(func.has_cond);
+    ASSERT_FALSE(func.has_cate);
+    ASSERT_EQ(2u, func.ArgNum());
+
+    ASSERT_TRUE(ParsePreAggrFunc("avg_cate_where", &func));
+    ASSERT_EQ(PreAggrKind::kAvg, func.kind);
+    ASSERT_TRUE(func.has_cond);
+    ASSERT_TRUE(func.has_cate);
+    ASSERT_TRUE(func.HasState());
+    ASSERT_EQ(3u, func.ArgNum());
+    ASSERT_EQ(2u, func.CatePos());
+
+    ASSERT_TRUE(ParsePreAggrFunc("fz_topn_frequency", &func));
+    ASSERT_EQ(PreAggrKind::kTopNFrequency, func.kind);
+    ASSERT_EQ(2u, func.ArgNum());
+
+    ASSERT_FALSE(ParsePreAggrFunc("top_n_key_count_cate_where", &func));
+    ASSERT_FALSE(ParsePreAggrFunc("where", &func));
+    ASSERT_FALSE(ParsePreAggrFunc("lag", &func));
+
+    std::vector<std::string> args;
+    ASSERT_TRUE(ParsePreAggrFunc("sum_cate_where", &func));
+    ASSERT_TRUE(SplitPreAggrArgs("col1,col2 > 5,col3", func, &args));
+    ASSERT_EQ("col1", args[0]);
+    ASSERT_EQ("col2 > 5", args[1]);
+    ASSERT_EQ("col3", args[2]);
+    ASSERT_FALSE(SplitPreAggrArgs("col1,col2", func, &args));
+
+    // the ',' in the string literal
+    std::string cond = FormatPreAggrCondition("col2", "=", "a,\"b", true);
+    ASSERT_EQ("col2 = \"a,\\\"b\"", cond);
+    ASSERT_TRUE(SplitPreAggrArgs("col1," + cond + ",col3", func, &args));
+    ASSERT_EQ(cond, args[1]);
+    ASSERT_EQ("col3", args[2]);
+    ASSERT_FALSE(SplitPreAggrArgs("col1,col2 = \"a,col3", func, &args));
+}
+
+TEST_F(PreAggrTest, Condition) {
+    PreAggrCondition cond;
+    ASSERT_TRUE(cond.Parse("col1 > 5"));
+    ASSERT_EQ("col1", cond.column());
+    ASSERT_TRUE(cond.Match(static_cast<int64_t>(6)));
+    ASSERT_FALSE(cond.Match(static_cast<int64_t>(5)));
+    ASSERT_TRUE(cond.Match(5.5));
+
+    ASSERT_TRUE(cond.Parse("col2 <= 1.5"));
+    ASSERT_TRUE(cond.Match(static_cast<int64_t>(1)));
+    ASSERT_FALSE(cond.Match(static_cast<int64_t>(2)));
+
+    ASSERT_TRUE(cond.Parse("col3 = abc"));
+    ASSERT_TRUE(cond.Match(std::string("abc")));
+    ASSERT_FALSE(cond.Match(std::string("abd")));
+
+    ASSERT_TRUE(cond.Parse(FormatPreAggrCondition("col3", "!=", "a \\b\"", true)));
+    ASSERT_EQ("col3", cond.column());
+    ASSERT_TRUE(cond.Match(std::string("abc")));
+    ASSERT_FALSE(cond.Match(std::string("a \\b\"")));
+    ASSERT_FALSE(cond.Parse("col3 = \"abc"));
+
+    ASSERT_TRUE(cond.Parse("flag"));
+    ASSERT_TRUE(cond.Match(static_cast<int64_t>(1)));
+    ASSERT_FALSE(cond.Match(static_cast<int64_t>(0)));
+
+    ASSERT_TRUE(cond.Parse("flag != true"));
+    ASSERT_TRUE(cond.Match(static_cast<int64_t>(0)));
+
+    ASSERT_FALSE(cond.Parse("col1 + 1 > 5"));
+    ASSERT_FALSE(cond.Parse("col1 AND col2"));
+}
+
+TEST_F(PreAggrTest, HyperLogLog) {
+    HyperLogLog small;
+    for (int64_t i = 0; i < 100; i++) {
+        small.Add(PreAggrKeyOf(i % 20));
+    }
+    ASSERT_EQ(20, small.Estimate());
+
+    // merge the encoded sketches of the buckets
+    HyperLogLog merged;
+    for (int64_t bucket = 0; bucket < 10; bucket++) {
+        HyperLogLog hll;
+        for (int64_t i = bucket * 5000; i < bucket * 5000 + 10000; i++) {
+            hll.Add(PreAggrKeyOf(i));
+        }
+        std::string encoded;
+        hll.Encode(&encoded);
+        ASSERT_TRUE(merged.Merge(encoded));
+    }
+    int64_t estimate = merged.Estimate();
+    ASSERT_GT(estimate, 55000 * 0.95);
+    ASSERT_LT(estimate, 55000 * 1.05);
+
+    // the sparse encoding
+    std::string encoded;
+    small.Encode(&encoded);
+    ASSERT_EQ(1u + 20 * 3, encoded.size());
+    HyperLogLog decoded;
+    ASSERT_TRUE(decoded.Decode(encoded.data(), encoded.size()));
+    ASSERT_EQ(20, decoded.Estimate());
+    HyperLogLog broken;
+    ASSERT_FALSE(broken.Decode(encoded.data(), encoded.size() - 1));
+
+    HyperLogLog empty;
+    empty.Encode(&encoded);
+    ASSERT_TRUE(encoded.empty());
+    ASSERT_TRUE(decoded.Merge(encoded));
+    ASSERT_EQ(20, decoded.Estimate());
+    ASSERT_EQ(0, empty.Estimate());
+}
+
+TEST_F(PreAggrTest, TopNSketch) {
+    uint32_t capacity = TopNSketch::CapacityOf(2);
+    ASSERT_EQ(64u, capacity);
+    TopNSketch merged(capacity);
+    for (int64_t bucket = 0; bucket < 4; bucket++) {
+        TopNSketch sketch(capacity);
+        // the frequent keys are in every bucket and the rare ones in single bucket
+        for (int64_t i = 0; i < 200; i++) {
+            sketch.Add(PreAggrKeyOf(bucket * 1000 + i));
+        }
+        for (int64_t i = 0; i < 10; i++) {
+            sketch.Add("a");
+            sketch.Add("b");
+        }
+        std::string encoded;
+        sketch.Encode(&encoded);
+        ASSERT_TRUE(merged.Merge(encoded));
+    }
+    ASSERT_EQ(40, merged.counts().at("a"));
+    ASSERT_EQ(40, merged.counts().at("b"));
+    ASSERT_LE(merged.counts().size(), 2 * capacity);
+}
+
+TEST_F(PreAggrTest, CateAggrState) {
+    CateAggrState sum(PreAggrKind::kSum, false);
+    sum.Update("x", static_cast<int64_t>(1));
+    sum.Update("y", static_cast<int64_t>(2));
+    CateAggrState other(PreAggrKind::kSum, false);
+    other.Update("x", static_cast<int64_t>(3));
+    std::string encoded;
+    other.Encode(&encoded);
+    ASSERT_TRUE(sum.Merge(encoded));
+    ASSERT_EQ(2u, sum.values().size());
+    ASSERT_EQ(4, sum.values().at("x").lval);
+    ASSERT_EQ(2, sum.values().at("x").cnt);
+    ASSERT_EQ(2, sum.values().at("y").lval);
+
+    CateAggrState min(PreAggrKind::kMin, true);
+    min.Update("x", 1.5);
+    min.Update("x", -2.5);
+    min.Update("x", 0.5);
+    ASSERT_DOUBLE_EQ(-2.5, min.values().at("x").dval);
+
+    CateAggrState avg(PreAggrKind::kAvg, false);
+    ASSERT_TRUE(avg.is_float());
+    avg.Update("x", static_cast<int64_t>(1));
+    avg.Update("x", static_cast<int64_t>(2));
+    avg.Encode(&encoded);
+    CateAggrState decoded(PreAggrKind::kAvg, false);
+    ASSERT_TRUE(decoded.Decode(encoded.data(), encoded.size()));
+    ASSERT_DOUBLE_EQ(3.0, decoded.values().at("x").dval);
+    ASSERT_EQ(2, decoded.values().at("x").cnt);
+    ASSERT_FALSE(decoded.Decode(encoded.data(), encoded.size() - 1));
+}
+
+}  // namespace base
+}  // namespace hybridse
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "benchmark/benchmark.h"
+#include "benchmark/window_agg_bm_case.h"
+
+namespace hybridse {
+namespace bm {
+static void BM_WindowAggRowWise(benchmark::State& state) {  // NOLINT
+    WindowAggRowWise(&state, BENCHMARK, state.range(0));
+}
+static void BM_WindowAggColumnWise(benchmark::State& state) {  // NOLINT
+    WindowAggColumnWise(&state, BENCHMARK, state.range(0));
+}
+static void BM_WindowAggKernelScalar(benchmark::State& state) {  // NOLINT
+    WindowAggDoubleKernel(&state, BENCHMARK, state.range(0),
+                          codec::ColumnAggSimd::kScalar);
+}
+static void BM_WindowAggKernelAvx2(benchmark::State& state) {  // NOLINT
+    WindowAggDoubleKernel(&state, BENCHMARK, state.range(0),
+                          codec::ColumnAggSimd::kAvx2);
+}
+static void BM_WindowAggKernelAvx512(benchmark::State& state) {  // NOLINT
+    WindowAggDoubleKernel(&state, BENCHMARK, state.range(0),
+                          codec::ColumnAggSimd::kAvx512);
+}
+
+BENCHMARK(BM_WindowAggRowWise)
+    ->Args({100})
+    ->Args({1000})
+    ->Args({10000})
+    ->Args({100000});
+BENCHMARK(BM_WindowAggColumnWise)
+    ->Args({100})
+    ->Args({1000})
+    ->Args({10000})
+    ->Args({100000});
+BENCHMARK(BM_WindowAggKernelScalar)
+    ->Args({100})
+    ->Args({1000})
+    ->Args({10000})
+    ->Args({100000});
+BENCHMARK(BM_WindowAggKernelAvx2)
+    ->Args({100})
+    ->Args({1000})
+    ->Args({10000})
+    ->Args({100000});
+BENCHMARK(BM_WindowAggKernelAvx512)
+    ->Args({100})
+    ->Args({1000})
+    ->Args({10000})
+    ->Args({100000});
+}  // namespace bm
+}  // namespace hybridse
+
+BENCHMARK_MAIN();
@@ -0,0 +1,194 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "benchmark/window_agg_bm_case.h"
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <vector>
+#include "case/case_data_mock.h"
+#include "codec/fe_row_codec.h"
+#include "codec/list_iterator_codec.h"
+#include "codec/type_codec.h"
+#include "gtest/gtest.h"
+namespace hybridse {
+namespace bm {
+using codec::ColumnAggResult;
+using codec::Row;
+using sqlcase::CaseDataMock;
+
+struct WindowAggData {
+    type::TableDef table_def;
+    std::vector<Row> buffer;
+    std::unique_ptr<codec::ArrayListV<Row>> window;
+    codec::ListRef<Row> window_ref;
+    // the ColInfo of col1 and col4
+    codec::ColInfo col1;
+    codec::ColInfo col4;
+
+    explicit WindowAggData(int64_t data_size) {
+        CaseDataMock::BuildOnePkTableData(table_def, buffer, data_size);
+        window.reset(new codec::ArrayListV<Row>(&buffer));
+        window_ref.list = reinterpret_cast<int8_t*>(window.get());
+        codec::SliceFormat format(&table_def.columns());
+        col1 = *format.GetColumnInfo(1);
+        col4 = *format.GetColumnInfo(4);
+    }
+};
+
+static void RunRowWise(WindowAggData* data, ColumnAggResult* int_res,
+                       ColumnAggResult* double_res) {
+    int64_t int_cnt = 0;
+    int64_t int_sum = 0;
+    int64_t int_min = std::numeric_limits<int64_t>::max();
+    int64_t int_max = std::numeric_limits<int64_t>::lowest();
+    int64_t double_cnt = 0;
+    double double_sum = 0;
+    double double_min = std::numeric_limits<double>::infinity();
+    double double_max = -std::numeric_limits<double>::infinity();
+    auto iter = data->window->GetIterator();
+    iter->SeekToFirst();
+    while (iter->Valid()) {
+        const int8_t* buf = iter->GetValue().buf(0);
+        int8_t is_null;
+        int32_t int_value = codec::v1::GetInt32Field(buf, data->col1.idx,
+                                                     data->col1.offset, &is_null);
+        if (!is_null) {
+            int_cnt++;
+            int_sum += int_value;
+            int_min = std::min<int64_t>(int_min, int_value);
+            int_max = std::max<int64_t>(int_max, int_value);
+        }
+        double double_value = codec::v1::GetDoubleField(
+            buf, data->col4.idx, data->col4.offset, &is_null);
+        if (!is_null) {
+            double_cnt++;
+            double_sum += double_value;
+            double_min = std::min(double_min, double_value);
+            double_max = std::max(double_max, double_value);
+        }
+        iter->Next();
+    }
+    int_res->cnt = int_cnt;
+    int_res->sum_i64 = int_sum;
+    int_res->min_i64 = int_min;
+    int_res->max_i64 = int_max;
+    double_res->cnt = double_cnt;
+    double_res->sum_f64 = double_sum;
+    double_res->min_f64 = double_min;
+    double_res->max_f64 = double_max;
+}
+
+static std::vector<int64_t> BuildSpec(const WindowAggData& data) {
+    return {2,
+            2,
+            0,
+            data.col1.idx,
+            data.col1.offset,
+            static_cast<int64_t>(codec::ColumnAggType::kInt32),
+            0,
+            data.col4.idx,
+            data.col4.offset,
+            static_cast<int64_t>(codec::ColumnAggType::kDouble),
+            0,
+            -1,
+            0,
+            0,
+            1,
+            -1,
+            0,
+            0};
+}
+
+void WindowAggRowWise(benchmark::State* state, MODE mode, int64_t data_size) {
+    WindowAggData data(data_size);
+    ColumnAggResult results[2];
+    switch (mode) {
+        case BENCHMARK: {
+            for (auto _ : *state) {
+                RunRowWise(&data, &results[0], &results[1]);
+                benchmark::DoNotOptimize(results);
+            }
+            break;
+        }
+        case TEST: {
+            RunRowWise(&data, &results[0], &results[1]);
+            ASSERT_EQ(data_size, results[0].cnt);
+            ASSERT_EQ(data_size, results[1].cnt);
+        }
+    }
+}
+
+void WindowAggColumnWise(benchmark::State* state, MODE mode,
+                         int64_t data_size) {
+    WindowAggData data(data_size);
+    std::vector<int64_t> spec = BuildSpec(data);
+    ColumnAggResult results[2];
+    int8_t* window = reinterpret_cast<int8_t*>(&data.window_ref);
+    switch (mode) {
+        case BENCHMARK: {
+            for (auto _ : *state) {
+                codec::WindowColumnAgg(window, spec.data(),
+                                       reinterpret_cast<int8_t*>(results));
+                benchmark::DoNotOptimize(results);
+            }
+            break;
+        }
+        case TEST: {
+            codec::WindowColumnAgg(window, spec.data(),
+                                   reinterpret_cast<int8_t*>(results));
+            ColumnAggResult expect[2];
+            RunRowWise(&data, &expect[0], &expect[1]);
+            ASSERT_EQ(expect[0].cnt, results[0].cnt);
+            ASSERT_EQ(expect[0].sum_i64, results[0].sum_i64);
+            ASSERT_EQ(expect[0].min_i64, results[0].min_i64);
+            ASSERT_EQ(expect[0].max_i64, results[0].max_i64);
+            ASSERT_EQ(expect[1].cnt, results[1].cnt);
+            ASSERT_DOUBLE_EQ(expect[1].sum_f64, results[1].sum_f64);
+            ASSERT_DOUBLE_EQ(expect[1].min_f64, results[1].min_f64);
+            ASSERT_DOUBLE_EQ(expect[1].max_f64, results[1].max_f64);
+        }
+    }
+}
+
+void WindowAggDoubleKernel(benchmark::State* state, MODE mode,
+                           int64_t data_size, codec::ColumnAggSimd simd) {
+    WindowAggData data(data_size);
+    codec::WindowColumns columns;
+    columns.AddColumn(0, data.col4.idx, data.col4.offset,
+                      codec::ColumnAggType::kDouble);
+    columns.Load(data.window.get());
+    ColumnAggResult res;
+    switch (mode) {
+        case BENCHMARK: {
+            for (auto _ : *state) {
+                codec::ColumnAggDouble(columns.GetDoubleValues(0),
+                                       columns.GetValid(0), data_size, &res,
+                                       simd);
+                benchmark::DoNotOptimize(res);
+            }
+            break;
+        }
+        case TEST: {
+            codec::ColumnAggDouble(columns.GetDoubleValues(0),
+                                   columns.GetValid(0), data_size, &res, simd);
+            ASSERT_EQ(data_size, res.cnt);
+        }
+    }
+}
+
+}  // namespace bm
+}  // namespace hybridse
@@ -0,0 +1,35 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HYBRIDSE_SRC_BENCHMARK_WINDOW_AGG_BM_CASE_H_
+#define HYBRIDSE_SRC_BENCHMARK_WINDOW_AGG_BM_CASE_H_
+#include "benchmark/benchmark.h"
+#include "benchmark/udf_bm_case.h"
+#include "codec/window_column_agg.h"
+namespace hybridse {
+namespace bm {
+// sum/count/min/max of col1(int32) and col4(double) over a window of
+// data_size rows, decoded row by row as the generated row-wise loop does
+void WindowAggRowWise(benchmark::State* state, MODE mode, int64_t data_size);
+// the same aggregations computed by codec::WindowColumnAgg
+void WindowAggColumnWise(benchmark::State* state, MODE mode,
+                         int64_t data_size);
+// the double kernel only over the decoded column with the simd level
+void WindowAggDoubleKernel(benchmark::State* state, MODE mode,
+                           int64_t data_size, codec::ColumnAggSimd simd);
+}  // namespace bm
+}  // namespace hybridse
+#endif  // HYBRIDSE_SRC_BENCHMARK_WINDOW_AGG_BM_CASE_H_
@@ -0,0 +1,49 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "benchmark/window_agg_bm_case.h"
+#include "gtest/gtest.h"
+namespace hybridse {
+namespace bm {
+class WindowAggBMCaseTest : public ::testing::Test {
+ public:
+    WindowAggBMCaseTest() {}
+    ~WindowAggBMCaseTest() {}
+};
+
+TEST_F(WindowAggBMCaseTest, WindowAggRowWise_TEST) {
+    WindowAggRowWise(nullptr, TEST, 100L);
+    WindowAggRowWise(nullptr, TEST, 1000L);
+}
+
+TEST_F(WindowAggBMCaseTest, WindowAggColumnWise_TEST) {
+    WindowAggColumnWise(nullptr, TEST, 100L);
+    WindowAggColumnWise(nullptr, TEST, 1001L);
+    WindowAggColumnWise(nullptr, TEST, 10000L);
+}
+
+TEST_F(WindowAggBMCaseTest, WindowAggDoubleKernel_TEST) {
+    WindowAggDoubleKernel(nullptr, TEST, 1001L, codec::ColumnAggSimd::kScalar);
+    WindowAggDoubleKernel(nullptr, TEST, 1001L, codec::ColumnAggSimd::kAvx2);
+    WindowAggDoubleKernel(nullptr, TEST, 1001L, codec::ColumnAggSimd::kAvx512);
+}
+}  // namespace bm
+}  // namespace hybridse
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
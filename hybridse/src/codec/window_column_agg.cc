@@ -0,0 +1,440 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "codec/window_column_agg.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+
+#include "codec/type_codec.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define HYBRIDSE_COLUMN_AGG_X86
+#include <immintrin.h>
+#endif
+
+namespace hybridse {
+namespace codec {
+
+static constexpr int64_t kInt64Max = std::numeric_limits<int64_t>::max();
+static constexpr int64_t kInt64Min = std::numeric_limits<int64_t>::lowest();
+// the infinities are the identities, so a column of infinities keeps its min/max
+static constexpr double kDoubleMax = std::numeric_limits<double>::infinity();
+static constexpr double kDoubleMin = -std::numeric_limits<double>::infinity();
+
+static void InitResult(ColumnAggResult* res) {
+    res->cnt = 0;
+    res->sum_i64 = 0;
+    res->sum_f64 = 0.0;
+    res->min_i64 = kInt64Max;
+    res->max_i64 = kInt64Min;
+    res->min_f64 = kDoubleMax;
+    res->max_f64 = kDoubleMin;
+}
+
+// the loops over [begin, n) are also the tails of the simd kernels
+static void ColumnAggInt64Scalar(const int64_t* values, const uint8_t* valid, size_t begin, size_t n,
+                                 ColumnAggResult* res) {
+    int64_t cnt = 0;
+    int64_t sum = 0;
+    int64_t min = res->min_i64;
+    int64_t max = res->max_i64;
+    for (size_t i = begin; i < n; ++i) {
+        if (valid[i]) {
+            cnt++;
+            sum += values[i];
+            min = std::min(min, values[i]);
+            max = std::max(max, values[i]);
+        }
+    }
+    res->cnt += cnt;
+    res->sum_i64 += sum;
+    res->min_i64 = min;
+    res->max_i64 = max;
+}
+
+static void ColumnAggDoubleScalar(const double* values, const uint8_t* valid, size_t begin, size_t n,
+                                  ColumnAggResult* res) {
+    int64_t cnt = 0;
+    double sum = 0.0;
+    double min = res->min_f64;
+    double max = res->max_f64;
+    for (size_t i = begin; i < n; ++i) {
+        if (valid[i]) {
+            cnt++;
+            sum += values[i];
+            min = values[i] < min ? values[i] : min;
+            max = values[i] > max ? values[i] : max;
+        }
+    }
+    res->cnt += cnt;
+    res->sum_f64 += sum;
+    res->min_f64 = min;
+    res->max_f64 = max;
+}
+
+#ifdef HYBRIDSE_COLUMN_AGG_X86
+// the lanes of 4 valid bytes widened to all-ones or all-zeros int64
+__attribute__((target("avx2"))) static inline __m256i LoadMask4(const uint8_t* valid) {
+    int32_t bytes;
+    memcpy(&bytes, valid, sizeof(bytes));
+    __m256i wide = _mm256_cvtepu8_epi64(_mm_cvtsi32_si128(bytes));
+    return _mm256_cmpgt_epi64(wide, _mm256_setzero_si256());
+}
+
+__attribute__((target("avx2"))) static void ColumnAggInt64Avx2(const int64_t* values, const uint8_t* valid,
+                                                               size_t n, ColumnAggResult* res) {
+    __m256i cnt = _mm256_setzero_si256();
+    __m256i sum = _mm256_setzero_si256();
+    __m256i min = _mm256_set1_epi64x(kInt64Max);
+    __m256i max = _mm256_set1_epi64x(kInt64Min);
+    const __m256i min_identity = min;
+    const __m256i max_identity = max;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i mask = LoadMask4(valid + i);
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i));
+        // the mask lane is -1 if valid
+        cnt = _mm256_sub_epi64(cnt, mask);
+        sum = _mm256_add_epi64(sum, _mm256_and_si256(v, mask));
+        __m256i v_min = _mm256_blendv_epi8(min_identity, v, mask);
+        min = _mm256_blendv_epi8(min, v_min, _mm256_cmpgt_epi64(min, v_min));
+        __m256i v_max = _mm256_blendv_epi8(max_identity, v, mask);
+        max = _mm256_blendv_epi8(max, v_max, _mm256_cmpgt_epi64(v_max, max));
+    }
+    alignas(32) int64_t lanes[4][4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes[0]), cnt);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes[1]), sum);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes[2]), min);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes[3]), max);
+    for (int lane = 0; lane < 4; ++lane) {
+        res->cnt += lanes[0][lane];
+        res->sum_i64 += lanes[1][lane];
+        res->min_i64 = std::min(res->min_i64, lanes[2][lane]);
+        res->max_i64 = std::max(res->max_i64, lanes[3][lane]);
+    }
+    ColumnAggInt64Scalar(values, valid, i, n, res);
+}
+
+__attribute__((target("avx2"))) static void ColumnAggDoubleAvx2(const double* values, const uint8_t* valid,
+                                                                size_t n, ColumnAggResult* res) {
+    __m256i cnt = _mm256_setzero_si256();
+    __m256d sum = _mm256_setzero_pd();
+    __m256d min = _mm256_set1_pd(kDoubleMax);
+    __m256d max = _mm256_set1_pd(kDoubleMin);
+    const __m256d min_identity = min;
+    const __m256d max_identity = max;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i mask = LoadMask4(valid + i);
+        __m256d mask_pd = _mm256_castsi256_pd(mask);
+        __m256d v = _mm256_loadu_pd(values + i);
+        cnt = _mm256_sub_epi64(cnt, mask);
+        sum = _mm256_add_pd(sum, _mm256_and_pd(v, mask_pd));
+        min = _mm256_min_pd(min, _mm256_blendv_pd(min_identity, v, mask_pd));
+        max = _mm256_max_pd(max, _mm256_blendv_pd(max_identity, v, mask_pd));
+    }
+    alignas(32) int64_t cnt_lanes[4];
+    alignas(32) double lanes[3][4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(cnt_lanes), cnt);
+    _mm256_store_pd(lanes[0], sum);
+    _mm256_store_pd(lanes[1], min);
+    _mm256_store_pd(lanes[2], max);
+    for (int lane = 0; lane < 4; ++lane) {
+        res->cnt += cnt_lanes[lane];
+        res->sum_f64 += lanes[0][lane];
+        res->min_f64 = std::min(res->min_f64, lanes[1][lane]);
+        res->max_f64 = std::max(res->max_f64, lanes[2][lane]);
+    }
+    ColumnAggDoubleScalar(values, valid, i, n, res);
+}
+
+// the lanes of 8 valid bytes as the mask register
+__attribute__((target("avx512f"))) static inline __mmask8 LoadMask8(const uint8_t* valid) {
+    __m512i wide = _mm512_cvtepu8_epi64(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(valid)));
+    return _mm512_test_epi64_mask(wide, wide);
+}
+
+__attribute__((target("avx512f"))) static void ColumnAggInt64Avx512(const int64_t* values, const uint8_t* valid,
+                                                                    size_t n, ColumnAggResult* res) {
+    int64_t cnt = 0;
+    __m512i sum = _mm512_setzero_si512();
+    __m512i min = _mm512_set1_epi64(kInt64Max);
+    __m512i max = _mm512_set1_epi64(kInt64Min);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __mmask8 mask = LoadMask8(valid + i);
+        __m512i v = _mm512_loadu_si512(values + i);
+        cnt += __builtin_popcount(mask);
+        sum = _mm512_mask_add_epi64(sum, mask, sum, v);
+        min = _mm512_mask_min_epi64(min, mask, min, v);
+        max = _mm512_mask_max_epi64(max, mask, max, v);
+    }
+    res->cnt += cnt;
+    res->sum_i64 += _mm512_reduce_add_epi64(sum);
+    res->min_i64 = std::min(res->min_i64, static_cast<int64_t>(_mm512_reduce_min_epi64(min)));
+    res->max_i64 = std::max(res->max_i64, static_cast<int64_t>(_mm512_reduce_max_epi64(max)));
+    ColumnAggInt64Scalar(values, valid, i, n, res);
+}
+
+__attribute__((target("avx512f"))) static void ColumnAggDoubleAvx512(const double* values, const uint8_t* valid,
+                                                                     size_t n, ColumnAggResult* res) {
+    int64_t cnt = 0;
+    __m512d sum = _mm512_setzero_pd();
+    __m512d min = _mm512_set1_pd(kDoubleMax);
+    __m512d max = _mm512_set1_pd(kDoubleMin);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __mmask8 mask = LoadMask8(valid + i);
+        __m512d v = _mm512_loadu_pd(values + i);
+        cnt += __builtin_popcount(mask);
+        sum = _mm512_mask_add_pd(sum, mask, sum, v);
+        min = _mm512_mask_min_pd(min, mask, min, v);
+        max = _mm512_mask_max_pd(max, mask, max, v);
+    }
+    res->cnt += cnt;
+    res->sum_f64 += _mm512_reduce_add_pd(sum);
+    res->min_f64 = std::min(res->min_f64, _mm512_reduce_min_pd(min));
+    res->max_f64 = std::max(res->max_f64, _mm512_reduce_max_pd(max));
+    ColumnAggDoubleScalar(values, valid, i, n, res);
+}
+#endif
+
+static ColumnAggSimd DetectColumnAggSimd() {
+#ifdef HYBRIDSE_COLUMN_AGG_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return ColumnAggSimd::kAvx512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return ColumnAggSimd::kAvx2;
+    }
+#endif
+    return ColumnAggSimd::kScalar;
+}
+
+ColumnAggSimd GetColumnAggSimd() {
+    static const ColumnAggSimd simd = DetectColumnAggSimd();
+    return simd;
+}
+
+// the requested level if the cpu supports it, or the best supported one below it
+static ColumnAggSimd ResolveSimd(ColumnAggSimd simd) {
+    ColumnAggSimd supported = GetColumnAggSimd();
+    if (simd == ColumnAggSimd::kAuto || static_cast<int>(simd) > static_cast<int>(supported)) {
+        return supported;
+    }
+    return simd;
+}
+
+void ColumnAggInt64(const int64_t* values, const uint8_t* valid, size_t n, ColumnAggResult* res,
+                    ColumnAggSimd simd) {
+    InitResult(res);
+    switch (ResolveSimd(simd)) {
+#ifdef HYBRIDSE_COLUMN_AGG_X86
+        case ColumnAggSimd::kAvx512:
+            ColumnAggInt64Avx512(values, valid, n, res);
+            return;
+        case ColumnAggSimd::kAvx2:
+            ColumnAggInt64Avx2(values, valid, n, res);
+            return;
+#endif
+        default:
+            ColumnAggInt64Scalar(values, valid, 0, n, res);
+            return;
+    }
+}
+
+void ColumnAggDouble(const double* values, const uint8_t* valid, size_t n, ColumnAggResult* res,
+                     ColumnAggSimd simd) {
+    InitResult(res);
+    switch (ResolveSimd(simd)) {
+#ifdef HYBRIDSE_COLUMN_AGG_X86
+        case ColumnAggSimd::kAvx512:
+            ColumnAggDoubleAvx512(values, valid, n, res);
+            return;
+        case ColumnAggSimd::kAvx2:
+            ColumnAggDoubleAvx2(values, valid, n, res);
+            return;
+#endif
+        default:
+            ColumnAggDoubleScalar(values, valid, 0, n, res);
+            return;
+    }
+}
+
+// the branch free loops are vectorized by the compiler
+template <class V, class C>
+static void FilterColumn(const V* values, const uint8_t* valid, size_t n, C rhs, ColumnAggCmp cmp,
+                         uint8_t* out) {
+    switch (cmp) {
+        case ColumnAggCmp::kEq:
+            for (size_t i = 0; i < n; ++i) out[i] = valid[i] & static_cast<uint8_t>(values[i] == rhs);
+            break;
+        case ColumnAggCmp::kNe:
+            for (size_t i = 0; i < n; ++i) out[i] = valid[i] & static_cast<uint8_t>(values[i] != rhs);
+            break;
+        case ColumnAggCmp::kLt:
+            for (size_t i = 0; i < n; ++i) out[i] = valid[i] & static_cast<uint8_t>(values[i] < rhs);
+            break;
+        case ColumnAggCmp::kLe:
+            for (size_t i = 0; i < n; ++i) out[i] = valid[i] & static_cast<uint8_t>(values[i] <= rhs);
+            break;
+        case ColumnAggCmp::kGt:
+            for (size_t i = 0; i < n; ++i) out[i] = valid[i] & static_cast<uint8_t>(values[i] > rhs);
+            break;
+        case ColumnAggCmp::kGe:
+            for (size_t i = 0; i < n; ++i) out[i] = valid[i] & static_cast<uint8_t>(values[i] >= rhs);
+            break;
+        default:
+            memcpy(out, valid, n);
+            break;
+    }
+}
+
+void ColumnFilterInt64(const int64_t* values, const uint8_t* valid, size_t n, ColumnAggCmp cmp, double rhs,
+                       uint8_t* out) {
+    // compare as the integers if rhs is integral, so the large values keep exact
+    if (rhs == static_cast<double>(static_cast<int64_t>(rhs)) && rhs > static_cast<double>(kInt64Min) &&
+        rhs < static_cast<double>(kInt64Max)) {
+        FilterColumn(values, valid, n, static_cast<int64_t>(rhs), cmp, out);
+    } else {
+        FilterColumn(values, valid, n, rhs, cmp, out);
+    }
+}
+
+void ColumnFilterDouble(const double* values, const uint8_t* valid, size_t n, ColumnAggCmp cmp, double rhs,
+                        uint8_t* out) {
+    FilterColumn(values, valid, n, rhs, cmp, out);
+}
+
+size_t WindowColumns::AddColumn(size_t slice_idx, uint32_t idx, uint32_t offset, ColumnAggType type) {
+    columns_.emplace_back();
+    auto& column = columns_.back();
+    column.slice_idx = slice_idx;
+    column.idx = idx;
+    column.offset = offset;
+    column.type = type;
+    return columns_.size() - 1;
+}
+
+void WindowColumns::SetColumns(const int64_t* col_spec, size_t col_cnt) {
+    bool same = columns_.size() == col_cnt;
+    for (size_t i = 0; same && i < col_cnt; ++i) {
+        const int64_t* col = col_spec + i * kWindowColumnSpecWidth;
+        const auto& column = columns_[i];
+        same = column.slice_idx == static_cast<size_t>(col[0]) && column.idx == col[1] &&
+               column.offset == col[2] && column.type == static_cast<ColumnAggType>(col[3]);
+    }
+    if (same) {
+        return;
+    }
+    Clear();
+    for (size_t i = 0; i < col_cnt; ++i) {
+        const int64_t* col = col_spec + i * kWindowColumnSpecWidth;
+        AddColumn(col[0], col[1], col[2], static_cast<ColumnAggType>(col[3]));
+    }
+}
+
+void WindowColumns::Load(ListV<Row>* window) {
+    row_cnt_ = 0;
+    for (auto& column : columns_) {
+        column.int64_values.clear();
+        column.double_values.clear();
+        column.valid.clear();
+    }
+    auto iter = window->GetIterator();
+    iter->SeekToFirst();
+    while (iter->Valid()) {
+        const Row& row = iter->GetValue();
+        for (auto& column : columns_) {
+            const int8_t* buf = row.buf(column.slice_idx);
+            bool is_null = buf == nullptr || v1::IsNullAt(buf, column.idx);
+            column.valid.push_back(is_null ? 0 : 1);
+            // the value of null is zero, so the kernels never read the garbage
+            switch (column.type) {
+                case ColumnAggType::kInt16:
+                    column.int64_values.push_back(is_null ? 0 : v1::GetInt16FieldUnsafe(buf, column.offset));
+                    break;
+                case ColumnAggType::kInt32:
+                    column.int64_values.push_back(is_null ? 0 : v1::GetInt32FieldUnsafe(buf, column.offset));
+                    break;
+                case ColumnAggType::kInt64:
+                    column.int64_values.push_back(is_null ? 0 : v1::GetInt64FieldUnsafe(buf, column.offset));
+                    break;
+                case ColumnAggType::kFloat:
+                    column.double_values.push_back(is_null ? 0.0 : v1::GetFloatFieldUnsafe(buf, column.offset));
+                    break;
+                case ColumnAggType::kDouble:
+                    column.double_values.push_back(is_null ? 0.0 : v1::GetDoubleFieldUnsafe(buf, column.offset));
+                    break;
+            }
+        }
+        row_cnt_++;
+        iter->Next();
+    }
+}
+
+void WindowColumnAgg(int8_t* window, const int64_t* spec, int8_t* results) {
+    // the buffers are reused by the windows computed in the same thread
+    thread_local WindowColumns columns;
+    thread_local std::vector<uint8_t> mask;
+    auto list_ref = reinterpret_cast<ListRef<Row>*>(window);
+    auto rows = reinterpret_cast<ListV<Row>*>(list_ref->list);
+    auto output = reinterpret_cast<ColumnAggResult*>(results);
+
+    int64_t col_cnt = spec[0];
+    int64_t slot_cnt = spec[1];
+    const int64_t* col_spec = spec + 2;
+    const int64_t* slot_spec = col_spec + col_cnt * kWindowColumnSpecWidth;
+    columns.SetColumns(col_spec, col_cnt);
+    columns.Load(rows);
+    size_t n = columns.GetRowCnt();
+    for (int64_t i = 0; i < slot_cnt; ++i) {
+        const int64_t* slot = slot_spec + i * kWindowSlotSpecWidth;
+        size_t col = slot[0];
+        const uint8_t* valid = columns.GetValid(col);
+        if (slot[1] >= 0) {
+            size_t cond_col = slot[1];
+            auto cmp = static_cast<ColumnAggCmp>(slot[2]);
+            double rhs;
+            memcpy(&rhs, &slot[3], sizeof(double));
+            mask.resize(n);
+            if (columns.IsDouble(cond_col)) {
+                ColumnFilterDouble(columns.GetDoubleValues(cond_col), columns.GetValid(cond_col), n, cmp, rhs,
+                                   mask.data());
+            } else {
+                ColumnFilterInt64(columns.GetInt64Values(cond_col), columns.GetValid(cond_col), n, cmp, rhs,
+                                  mask.data());
+            }
+            for (size_t j = 0; j < n; ++j) {
+                mask[j] &= valid[j];
+            }
+            valid = mask.data();
+        }
+        if (columns.IsDouble(col)) {
+            ColumnAggDouble(columns.GetDoubleValues(col), valid, n, output + i);
+        } else {
+            ColumnAggInt64(columns.GetInt64Values(col), valid, n, output + i);
+        }
+    }
+}
+
+}  // namespace codec
+}  // namespace hybridse
@@ -0,0 +1,223 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "codec/window_column_agg.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "codec/fe_row_codec.h"
+#include "gtest/gtest.h"
+
+namespace hybridse {
+namespace codec {
+
+class WindowColumnAggTest : public ::testing::Test {};
+
+static const ColumnAggSimd kSimds[] = {ColumnAggSimd::kScalar, ColumnAggSimd::kAvx2, ColumnAggSimd::kAvx512};
+
+TEST_F(WindowColumnAggTest, Int64Kernel) {
+    for (size_t n : {0, 1, 3, 4, 7, 8, 9, 100, 1001}) {
+        std::vector<int64_t> values(n);
+        std::vector<uint8_t> valid(n);
+        int64_t cnt = 0;
+        int64_t sum = 0;
+        int64_t min = std::numeric_limits<int64_t>::max();
+        int64_t max = std::numeric_limits<int64_t>::lowest();
+        for (size_t i = 0; i < n; ++i) {
+            values[i] = static_cast<int64_t>(i * 7919 % 1000) - 500;
+            valid[i] = i % 3 != 1;
+            if (valid[i]) {
+                cnt++;
+                sum += values[i];
+                min = std::min(min, values[i]);
+                max = std::max(max, values[i]);
+            }
+        }
+        for (auto simd : kSimds) {
+            ColumnAggResult res;
+            ColumnAggInt64(values.data(), valid.data(), n, &res, simd);
+            ASSERT_EQ(cnt, res.cnt) << n;
+            ASSERT_EQ(sum, res.sum_i64) << n;
+            ASSERT_EQ(min, res.min_i64) << n;
+            ASSERT_EQ(max, res.max_i64) << n;
+        }
+    }
+}
+
+TEST_F(WindowColumnAggTest, DoubleKernel) {
+    for (size_t n : {0, 1, 5, 8, 17, 1000}) {
+        std::vector<double> values(n);
+        std::vector<uint8_t> valid(n);
+        int64_t cnt = 0;
+        double sum = 0;
+        double min = std::numeric_limits<double>::infinity();
+        double max = -std::numeric_limits<double>::infinity();
+        for (size_t i = 0; i < n; ++i) {
+            // the integral values keep the sums exact in any order
+            values[i] = static_cast<double>(i * 104729 % 997) - 400.0;
+            valid[i] = i % 4 != 0;
+            if (valid[i]) {
+                cnt++;
+                sum += values[i];
+                min = std::min(min, values[i]);
+                max = std::max(max, values[i]);
+            }
+        }
+        for (auto simd : kSimds) {
+            ColumnAggResult res;
+            ColumnAggDouble(values.data(), valid.data(), n, &res, simd);
+            ASSERT_EQ(cnt, res.cnt) << n;
+            ASSERT_DOUBLE_EQ(sum, res.sum_f64) << n;
+            ASSERT_DOUBLE_EQ(min, res.min_f64) << n;
+            ASSERT_DOUBLE_EQ(max, res.max_f64) << n;
+        }
+    }
+}
+
+TEST_F(WindowColumnAggTest, InfinityKernel) {
+    double inf = std::numeric_limits<double>::infinity();
+    std::vector<double> values = {inf, inf, -inf, 1.0};
+    std::vector<uint8_t> valid = {1, 1, 0, 0};
+    for (auto simd : kSimds) {
+        ColumnAggResult res;
+        ColumnAggDouble(values.data(), valid.data(), values.size(), &res, simd);
+        ASSERT_EQ(2, res.cnt);
+        ASSERT_EQ(inf, res.min_f64);
+        ASSERT_EQ(inf, res.max_f64);
+    }
+    valid = {0, 0, 1, 0};
+    for (auto simd : kSimds) {
+        ColumnAggResult res;
+        ColumnAggDouble(values.data(), valid.data(), values.size(), &res, simd);
+        ASSERT_EQ(1, res.cnt);
+        ASSERT_EQ(-inf, res.min_f64);
+        ASSERT_EQ(-inf, res.max_f64);
+    }
+}
+
+TEST_F(WindowColumnAggTest, Filter) {
+    std::vector<int64_t> values = {1, 2, 3, 4, 5, std::numeric_limits<int64_t>::max()};
+    std::vector<uint8_t> valid = {1, 1, 0, 1, 1, 1};
+    std::vector<uint8_t> out(values.size());
+    ColumnFilterInt64(values.data(), valid.data(), values.size(), ColumnAggCmp::kGt, 2, out.data());
+    ASSERT_EQ(std::vector<uint8_t>({0, 0, 0, 1, 1, 1}), out);
+    ColumnFilterInt64(values.data(), valid.data(), values.size(), ColumnAggCmp::kLe, 2.5, out.data());
+    ASSERT_EQ(std::vector<uint8_t>({1, 1, 0, 0, 0, 0}), out);
+    ColumnFilterInt64(values.data(), valid.data(), values.size(), ColumnAggCmp::kNe, 4, out.data());
+    ASSERT_EQ(std::vector<uint8_t>({1, 1, 0, 0, 1, 1}), out);
+
+    std::vector<double> doubles = {0.5, 1.5, 2.5};
+    std::vector<uint8_t> all_valid = {1, 1, 1};
+    out.resize(doubles.size());
+    ColumnFilterDouble(doubles.data(), all_valid.data(), doubles.size(), ColumnAggCmp::kEq, 1.5, out.data());
+    ASSERT_EQ(std::vector<uint8_t>({0, 1, 0}), out);
+    ColumnFilterDouble(doubles.data(), all_valid.data(), doubles.size(), ColumnAggCmp::kGe, 1.5, out.data());
+    ASSERT_EQ(std::vector<uint8_t>({0, 1, 1}), out);
+}
+
+TEST_F(WindowColumnAggTest, WindowColumnAgg) {
+    Schema schema;
+    std::vector<::hybridse::type::Type> types = {::hybridse::type::kInt16, ::hybridse::type::kInt32,
+                                                 ::hybridse::type::kInt64, ::hybridse::type::kFloat,
+                                                 ::hybridse::type::kDouble};
+    for (size_t i = 0; i < types.size(); ++i) {
+        auto col = schema.Add();
+        col->set_name("col" + std::to_string(i));
+        col->set_type(types[i]);
+    }
+    std::vector<Row> rows;
+    for (int i = 1; i <= 10; ++i) {
+        RowBuilder builder(schema);
+        uint32_t size = builder.CalTotalLength(0);
+        int8_t* buf = static_cast<int8_t*>(malloc(size));
+        builder.SetBuffer(buf, size);
+        builder.AppendInt16(i);
+        // col1 is null in the odd rows
+        if (i % 2 == 1) {
+            builder.AppendNULL();
+        } else {
+            builder.AppendInt32(i * 10);
+        }
+        builder.AppendInt64(i * 100L);
+        builder.AppendFloat(i * 0.5f);
+        builder.AppendDouble(i * 1.5);
+        rows.push_back(Row(base::RefCountedSlice::CreateManaged(buf, size)));
+    }
+    ArrayListV<Row> list(&rows);
+    ListRef<Row> list_ref;
+    list_ref.list = reinterpret_cast<int8_t*>(&list);
+
+    SliceFormat format(&schema);
+    std::vector<int64_t> spec = {static_cast<int64_t>(types.size()), 4};
+    for (size_t i = 0; i < types.size(); ++i) {
+        const ColInfo* info = format.GetColumnInfo(i);
+        spec.insert(spec.end(), {0, static_cast<int64_t>(info->idx), static_cast<int64_t>(info->offset),
+                                 static_cast<int64_t>(i)});
+    }
+    int64_t rhs;
+    double value = 5;
+    memcpy(&rhs, &value, sizeof(double));
+    // sum(col1), sum_where(col4, col0 > 5), sum(col3), count_where(col1, col2 <= 500)
+    spec.insert(spec.end(), {1, -1, 0, 0});
+    spec.insert(spec.end(), {4, 0, static_cast<int64_t>(ColumnAggCmp::kGt), rhs});
+    spec.insert(spec.end(), {3, -1, 0, 0});
+    value = 500;
+    memcpy(&rhs, &value, sizeof(double));
+    spec.insert(spec.end(), {1, 2, static_cast<int64_t>(ColumnAggCmp::kLe), rhs});
+
+    ColumnAggResult results[4];
+    WindowColumnAgg(reinterpret_cast<int8_t*>(&list_ref), spec.data(), reinterpret_cast<int8_t*>(results));
+    ASSERT_EQ(5, results[0].cnt);
+    ASSERT_EQ(20 + 40 + 60 + 80 + 100, results[0].sum_i64);
+    ASSERT_EQ(20, results[0].min_i64);
+    ASSERT_EQ(100, results[0].max_i64);
+    ASSERT_EQ(5, results[1].cnt);
+    ASSERT_DOUBLE_EQ((6 + 7 + 8 + 9 + 10) * 1.5, results[1].sum_f64);
+    ASSERT_DOUBLE_EQ(9.0, results[1].min_f64);
+    ASSERT_EQ(10, results[2].cnt);
+    ASSERT_DOUBLE_EQ(55 * 0.5, results[2].sum_f64);
+    ASSERT_DOUBLE_EQ(5.0, results[2].max_f64);
+    // the rows 1..5 match the condition and the rows 2 and 4 are not null
+    ASSERT_EQ(2, results[3].cnt);
+
+    // the columns are kept for the same spec and rebuilt for another one
+    WindowColumns columns;
+    columns.SetColumns(spec.data() + 2, types.size());
+    columns.Load(&list);
+    const int64_t* int64_values = columns.GetInt64Values(2);
+    columns.SetColumns(spec.data() + 2, types.size());
+    columns.Load(&list);
+    ASSERT_EQ(int64_values, columns.GetInt64Values(2));
+    ASSERT_EQ(1000, columns.GetInt64Values(2)[9]);
+    columns.SetColumns(spec.data() + 2 + 4 * kWindowColumnSpecWidth, 1);
+    columns.Load(&list);
+    ASSERT_EQ(1u, columns.GetColumnCnt());
+    ASSERT_TRUE(columns.IsDouble(0));
+    ASSERT_DOUBLE_EQ(15.0, columns.GetDoubleValues(0)[9]);
+}
+
+}  // namespace codec
+}  // namespace hybridse
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
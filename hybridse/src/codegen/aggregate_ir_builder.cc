@@ -16,7 +16,9 @@
 #include "codegen/aggregate_ir_builder.h"
 
 #include <stdlib.h>
+#include <string.h>
 #include <algorithm>
+#include <cstddef>
 #include <limits>
 #include <map>
 #include <memory>
@@ -26,19 +28,73 @@
 #include "codegen/variable_ir_builder.h"
 #include "gflags/gflags.h"
 #include "glog/logging.h"
+
+DECLARE_bool(enable_window_column_agg);
+DECLARE_bool(enable_spark_unsaferow_format);
+
 namespace hybridse {
 namespace codegen {
 
+static const char kWhereSuffix[] = "_where";
+
+// sum_where -> sum
+static std::string GetBaseAggName(const std::string& fname) {
+    size_t suffix_len = sizeof(kWhereSuffix) - 1;
+    if (fname.size() > suffix_len &&
+        fname.compare(fname.size() - suffix_len, suffix_len, kWhereSuffix) == 0) {
+        return fname.substr(0, fname.size() - suffix_len);
+    }
+    return fname;
+}
+
+static bool GetColumnAggType(node::DataType type, codec::ColumnAggType* res) {
+    switch (type) {
+        case node::kInt16:
+            *res = codec::ColumnAggType::kInt16;
+            return true;
+        case node::kInt32:
+            *res = codec::ColumnAggType::kInt32;
+            return true;
+        case node::kInt64:
+            *res = codec::ColumnAggType::kInt64;
+            return true;
+        case node::kFloat:
+            *res = codec::ColumnAggType::kFloat;
+            return true;
+        case node::kDouble:
+            *res = codec::ColumnAggType::kDouble;
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool AggregateIRBuilder::EnableColumnAggOpt() {
+    // the column-wise decoding only supports the hybridse row format
+    return FLAGS_enable_window_column_agg && !FLAGS_enable_spark_unsaferow_format;
+}
+
 AggregateIRBuilder::AggregateIRBuilder(const vm::SchemasContext* sc,
                                        ::llvm::Module* module,
                                        const node::FrameNode* frame_node,
                                        uint32_t id)
-    : schema_context_(sc), module_(module), frame_node_(frame_node), id_(id) {
+    : schema_context_(sc),
+      module_(module),
+      frame_node_(frame_node),
+      id_(id),
+      column_agg_(EnableColumnAggOpt()) {
     available_agg_func_set_.insert("sum");
     available_agg_func_set_.insert("avg");
     available_agg_func_set_.insert("count");
     available_agg_func_set_.insert("min");
     available_agg_func_set_.insert("max");
+    if (column_agg_) {
+        available_agg_func_set_.insert("sum_where");
+        available_agg_func_set_.insert("avg_where");
+        available_agg_func_set_.insert("count_where");
+        available_agg_func_set_.insert("min_where");
+        available_agg_func_set_.insert("max_where");
+    }
 }
 
 bool AggregateIRBuilder::IsAggFuncName(const std::string& fname) {
@@ -73,7 +129,13 @@ bool AggregateIRBuilder::CollectAggColumn(const hybridse::node::ExprNode* expr,
             if (!IsAggFuncName(agg_func_name)) {
                 break;
             }
-            if (call->GetChildNum() != 1) {
+            std::string base_func_name = GetBaseAggName(agg_func_name);
+            bool has_cond = base_func_name != agg_func_name;
+            if (call->GetChildNum() != (has_cond ? 2 : 1)) {
+                break;
+            }
+            AggCondInfo cond;
+            if (has_cond && !CollectAggCondition(call->GetChild(1), &cond)) {
                 break;
             }
             auto input_expr = call->GetChild(0);
@@ -106,13 +168,13 @@ bool AggregateIRBuilder::CollectAggColumn(const hybridse::node::ExprNode* expr,
                            << hybridse::type::Type_Name(col_type);
                 return false;
             }
-            if (GetOutputLlvmType(module_->getContext(), agg_func_name,
+            if (GetOutputLlvmType(module_->getContext(), base_func_name,
                                   node_type) == nullptr) {
                 return false;
             }
-            if (agg_func_name == "count") {
+            if (base_func_name == "count") {
                 *res_agg_type = ::hybridse::type::kInt64;
-            } else if (agg_func_name == "avg") {
+            } else if (base_func_name == "avg") {
                 *res_agg_type = ::hybridse::type::kDouble;
             } else {
                 *res_agg_type = col_type;
@@ -124,7 +186,12 @@ bool AggregateIRBuilder::CollectAggColumn(const hybridse::node::ExprNode* expr,
                 agg_col_infos_[col_key] =
                     AggColumnInfo(col, node_type, schema_idx, col_idx, offset);
             }
-            agg_col_infos_[col_key].AddAgg(agg_func_name, output_idx);
+            std::string cond_key;
+            if (has_cond) {
+                cond_key = call->GetChild(1)->GetExprString();
+                agg_cond_infos_[cond_key] = cond;
+            }
+            agg_col_infos_[col_key].AddAgg(agg_func_name, output_idx, cond_key);
             return true;
         }
         default:
@@ -133,6 +200,70 @@ bool AggregateIRBuilder::CollectAggColumn(const hybridse::node::ExprNode* expr,
     return false;
 }
 
+bool AggregateIRBuilder::CollectAggCondition(const node::ExprNode* expr,
+                                             AggCondInfo* cond) {
+    if (expr->GetExprType() != node::kExprBinary) {
+        return false;
+    }
+    auto binary = dynamic_cast<const node::BinaryExpr*>(expr);
+    const node::ExprNode* lhs = binary->GetChild(0);
+    const node::ExprNode* rhs = binary->GetChild(1);
+    node::FnOperator op = binary->GetOp();
+    // `value <cmp> col` is turned into `col <cmp'> value`
+    bool swapped = false;
+    if (lhs->GetExprType() == node::kExprPrimary &&
+        rhs->GetExprType() == node::kExprColumnRef) {
+        std::swap(lhs, rhs);
+        swapped = true;
+    }
+    if (lhs->GetExprType() != node::kExprColumnRef ||
+        rhs->GetExprType() != node::kExprPrimary) {
+        return false;
+    }
+    auto value = dynamic_cast<const node::ConstNode*>(rhs);
+    if (!value->IsNumber() || value->GetDataType() == node::kBool) {
+        return false;
+    }
+    switch (op) {
+        case node::kFnOpEq:
+            cond->cmp = codec::ColumnAggCmp::kEq;
+            break;
+        case node::kFnOpNeq:
+            cond->cmp = codec::ColumnAggCmp::kNe;
+            break;
+        case node::kFnOpLt:
+            cond->cmp = swapped ? codec::ColumnAggCmp::kGt : codec::ColumnAggCmp::kLt;
+            break;
+        case node::kFnOpLe:
+            cond->cmp = swapped ? codec::ColumnAggCmp::kGe : codec::ColumnAggCmp::kLe;
+            break;
+        case node::kFnOpGt:
+            cond->cmp = swapped ? codec::ColumnAggCmp::kLt : codec::ColumnAggCmp::kGt;
+            break;
+        case node::kFnOpGe:
+            cond->cmp = swapped ? codec::ColumnAggCmp::kLe : codec::ColumnAggCmp::kGe;
+            break;
+        default:
+            return false;
+    }
+    auto col = dynamic_cast<const node::ColumnRefNode*>(lhs);
+    Status status = schema_context_->ResolveColumnRefIndex(
+        col, &cond->schema_idx, &cond->col_idx);
+    if (!status.isOK()) {
+        DLOG(ERROR) << status.msg;
+        return false;
+    }
+    const codec::ColInfo* col_info = schema_context_->GetRowFormat()->GetColumnInfo(
+        cond->schema_idx, cond->col_idx);
+    codec::ColumnAggType agg_type;
+    if (!SchemaType2DataType(col_info->type, &cond->col_type) ||
+        !GetColumnAggType(cond->col_type, &agg_type)) {
+        return false;
+    }
+    cond->value = value->GetAsDouble();
+    return true;
+}
+
 class StatisticalAggGenerator {
  public:
     StatisticalAggGenerator(node::DataType col_type,
@@ -621,6 +752,9 @@ base::Status AggregateIRBuilder::BuildMulti(const std::string& base_funcname,
     builder.CreateCall(
         module_->getOrInsertFunction(fn_name, fnt),
         {window_ptr.GetValue(&builder), builder.CreateLoad(output_buf)});
+    if (column_agg_) {
+        return BuildColumnAgg(fn, output_schema);
+    }
 
     ::llvm::BasicBlock* head_block =
         ::llvm::BasicBlock::Create(llvm_ctx, "head", fn);
@@ -764,5 +898,155 @@ base::Status AggregateIRBuilder::BuildMulti(const std::string& base_funcname,
     return base::Status::OK();
 }
 
+base::Status AggregateIRBuilder::BuildColumnAgg(::llvm::Function* fn, const vm::Schema& output_schema) {
+    ::llvm::LLVMContext& llvm_ctx = module_->getContext();
+    ::llvm::IRBuilder<> builder(llvm_ctx);
+    auto void_ty = ::llvm::Type::getVoidTy(llvm_ctx);
+    auto int64_ty = ::llvm::Type::getInt64Ty(llvm_ctx);
+    auto double_ty = ::llvm::Type::getDoubleTy(llvm_ctx);
+    auto ptr_ty = ::llvm::Type::getInt8Ty(llvm_ctx)->getPointerTo();
+    const codec::RowFormat* row_format = schema_context_->GetRowFormat();
+
+    // the spec of the columns to decode and the aggregation slots, see codec::WindowColumnAgg
+    std::vector<uint64_t> col_spec;
+    std::vector<uint64_t> slot_spec;
+    std::map<std::pair<size_t, size_t>, int64_t> col_pos;
+    std::map<std::pair<int64_t, std::string>, int64_t> slot_pos;
+    auto add_column = [&](size_t schema_idx, size_t col_idx, node::DataType col_type) -> int64_t {
+        auto key = std::make_pair(schema_idx, col_idx);
+        auto iter = col_pos.find(key);
+        if (iter != col_pos.end()) {
+            return iter->second;
+        }
+        codec::ColumnAggType agg_type = codec::ColumnAggType::kInt64;
+        GetColumnAggType(col_type, &agg_type);
+        const codec::ColInfo* col_info = row_format->GetColumnInfo(schema_idx, col_idx);
+        int64_t pos = col_pos.size();
+        col_spec.insert(col_spec.end(), {row_format->GetSliceId(schema_idx), col_info->idx, col_info->offset,
+                                         static_cast<uint64_t>(agg_type)});
+        col_pos[key] = pos;
+        return pos;
+    };
+
+    struct SlotOutput {
+        int64_t slot;
+        std::string fname;
+        size_t output_idx;
+        node::DataType col_type;
+    };
+    std::vector<SlotOutput> outputs;
+    // visit the columns in order so the generated code is stable
+    std::vector<std::string> col_keys;
+    for (auto& pair : agg_col_infos_) {
+        col_keys.push_back(pair.first);
+    }
+    std::sort(col_keys.begin(), col_keys.end());
+    for (auto& col_key : col_keys) {
+        auto& info = agg_col_infos_[col_key];
+        int64_t col = add_column(info.schema_idx, info.col_idx, info.col_type);
+        for (size_t i = 0; i < info.GetOutputNum(); ++i) {
+            const std::string& cond_key = info.cond_keys[i];
+            auto key = std::make_pair(col, cond_key);
+            auto iter = slot_pos.find(key);
+            if (iter == slot_pos.end()) {
+                int64_t cond_col = -1;
+                codec::ColumnAggCmp cmp = codec::ColumnAggCmp::kNone;
+                uint64_t rhs = 0;
+                if (!cond_key.empty()) {
+                    auto& cond = agg_cond_infos_[cond_key];
+                    cond_col = add_column(cond.schema_idx, cond.col_idx, cond.col_type);
+                    cmp = cond.cmp;
+                    memcpy(&rhs, &cond.value, sizeof(double));
+                }
+                slot_spec.insert(slot_spec.end(), {static_cast<uint64_t>(col), static_cast<uint64_t>(cond_col),
+                                                   static_cast<uint64_t>(cmp), rhs});
+                iter = slot_pos.insert(std::make_pair(key, static_cast<int64_t>(slot_pos.size()))).first;
+            }
+            outputs.push_back({iter->second, GetBaseAggName(info.agg_funcs[i]), info.output_idxs[i], info.col_type});
+        }
+    }
+    std::vector<uint64_t> spec = {col_pos.size(), slot_pos.size()};
+    spec.insert(spec.end(), col_spec.begin(), col_spec.end());
+    spec.insert(spec.end(), slot_spec.begin(), slot_spec.end());
+
+    ::llvm::BasicBlock* block = ::llvm::BasicBlock::Create(llvm_ctx, "column_agg", fn);
+    builder.SetInsertPoint(block);
+    auto spec_ty = ::llvm::ArrayType::get(int64_ty, spec.size());
+    auto spec_init = ::llvm::ConstantDataArray::get(llvm_ctx, ::llvm::ArrayRef<uint64_t>(spec));
+    auto spec_var = new ::llvm::GlobalVariable(*module_, spec_ty, true, ::llvm::GlobalValue::PrivateLinkage,
+                                               spec_init, fn->getName().str() + "_spec");
+    ::llvm::Value* spec_ptr = builder.CreateConstInBoundsGEP2_64(spec_ty, spec_var, 0, 0);
+    // ColumnAggResult[slot_cnt] on stack, allocated as int64 for the alignment
+    size_t result_bytes = sizeof(codec::ColumnAggResult);
+    ::llvm::Value* results = CreateAllocaAtHead(
+        &builder, int64_ty, "column_agg_results",
+        ::llvm::ConstantInt::get(int64_ty, slot_pos.size() * result_bytes / sizeof(int64_t), true));
+    results = builder.CreatePointerCast(results, ptr_ty);
+    auto agg_func = module_->getOrInsertFunction(
+        "hybridse_window_column_agg",
+        ::llvm::FunctionType::get(void_ty, {ptr_ty, int64_ty->getPointerTo(), ptr_ty}, false));
+    builder.CreateCall(agg_func, {fn->arg_begin(), spec_ptr, results});
+
+    auto load_field = [&](int64_t slot, size_t offset, ::llvm::Type* ty) -> ::llvm::Value* {
+        ::llvm::Value* ptr =
+            builder.CreateInBoundsGEP(builder.getInt8Ty(), results, builder.getInt64(slot * result_bytes + offset));
+        return builder.CreateLoad(builder.CreatePointerCast(ptr, ty->getPointerTo()));
+    };
+
+    ::llvm::Value* output_arg = fn->arg_begin() + 1;
+    std::map<uint32_t, NativeValue> dummy_map;
+    BufNativeEncoderIRBuilder output_encoder(&dummy_map, &output_schema, block);
+    for (auto& output : outputs) {
+        bool is_float = output.col_type == node::kFloat || output.col_type == node::kDouble;
+        ::llvm::Type* output_ty = GetOutputLlvmType(llvm_ctx, output.fname, output.col_type);
+        CHECK_TRUE(output_ty != nullptr, common::kCodegenUdafError, "Unknown output type of ", output.fname)
+        ::llvm::Value* cnt = load_field(output.slot, offsetof(codec::ColumnAggResult, cnt), int64_ty);
+        // the integers are summed in int64 and the floats in double
+        auto narrow = [&](::llvm::Value* value) -> ::llvm::Value* {
+            if (value->getType() == output_ty) {
+                return value;
+            }
+            return is_float ? builder.CreateFPTrunc(value, output_ty) : builder.CreateTrunc(value, output_ty);
+        };
+        ::llvm::Value* sum = nullptr;
+        if (is_float) {
+            sum = load_field(output.slot, offsetof(codec::ColumnAggResult, sum_f64), double_ty);
+        } else {
+            sum = load_field(output.slot, offsetof(codec::ColumnAggResult, sum_i64), int64_ty);
+        }
+        NativeValue value;
+        if (output.fname == "count") {
+            value = NativeValue::Create(cnt);
+        } else if (output.fname == "sum") {
+            value = NativeValue::Create(narrow(sum));
+        } else if (output.fname == "avg") {
+            if (!is_float) {
+                sum = builder.CreateSIToFP(sum, double_ty);
+            }
+            value = NativeValue::Create(builder.CreateFDiv(sum, builder.CreateSIToFP(cnt, double_ty)));
+        } else if (output.fname == "min" || output.fname == "max") {
+            bool is_min = output.fname == "min";
+            ::llvm::Value* extreme = nullptr;
+            if (is_float) {
+                extreme = load_field(output.slot,
+                                     is_min ? offsetof(codec::ColumnAggResult, min_f64)
+                                            : offsetof(codec::ColumnAggResult, max_f64),
+                                     double_ty);
+            } else {
+                extreme = load_field(output.slot,
+                                     is_min ? offsetof(codec::ColumnAggResult, min_i64)
+                                            : offsetof(codec::ColumnAggResult, max_i64),
+                                     int64_ty);
+            }
+            value = NativeValue::CreateWithFlag(narrow(extreme), builder.CreateICmpEQ(cnt, builder.getInt64(0)));
+        } else {
+            FAIL_STATUS(common::kCodegenUdafError, "Unknown agg function name: ", output.fname)
+        }
+        output_encoder.BuildEncodePrimaryField(output_arg, output.output_idx, value);
+    }
+    builder.CreateRetVoid();
+    return base::Status::OK();
+}
+
 }  // namespace codegen
 }  // namespace hybridse
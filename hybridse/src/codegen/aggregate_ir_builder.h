@@ -21,6 +21,7 @@
 #include <unordered_map>
 #include <utility>
 #include <vector>
+#include "codec/window_column_agg.h"
 #include "codegen/expr_ir_builder.h"
 #include "codegen/variable_ir_builder.h"
 #include "llvm/IR/IRBuilder.h"
@@ -41,6 +42,8 @@ struct AggColumnInfo {
 
     std::vector<std::string> agg_funcs;
     std::vector<size_t> output_idxs;
+    // the key of the condition of the *_where aggregation, empty if no condition
+    std::vector<std::string> cond_keys;
 
     AggColumnInfo() : col(nullptr) {}
 
@@ -57,9 +60,11 @@ struct AggColumnInfo {
         return col->GetRelationName() + "." + col->GetColumnName();
     }
 
-    void AddAgg(const std::string& fname, size_t output_idx) {
+    void AddAgg(const std::string& fname, size_t output_idx,
+                const std::string& cond_key = "") {
         agg_funcs.emplace_back(fname);
         output_idxs.emplace_back(output_idx);
+        cond_keys.emplace_back(cond_key);
     }
 
     size_t GetOutputNum() const { return output_idxs.size(); }
@@ -77,12 +82,22 @@ struct AggColumnInfo {
     }
 };
 
+// the condition `col <cmp> value` of the *_where aggregation
+struct AggCondInfo {
+    size_t schema_idx;
+    size_t col_idx;
+    node::DataType col_type;
+    codec::ColumnAggCmp cmp;
+    double value;
+};
+
 class AggregateIRBuilder {
  public:
     AggregateIRBuilder(const vm::SchemasContext*, ::llvm::Module* module,
                        const node::FrameNode* frame_node, uint32_t id);
 
-    // TODO(someone): remove temporary implementations for row-wise agg
+    // whether the aggregations are computed by the column-wise kernels of
+    // codec/window_column_agg.h instead of the row-wise loop
     static bool EnableColumnAggOpt();
 
     bool CollectAggColumn(const node::ExprNode* expr, size_t output_idx,
@@ -104,12 +119,18 @@ class AggregateIRBuilder {
     bool empty() const { return agg_col_infos_.empty(); }
 
  private:
+    bool CollectAggCondition(const node::ExprNode* expr, AggCondInfo* cond);
+    base::Status BuildColumnAgg(::llvm::Function* fn,
+                                const vm::Schema& output_schema);
+
     const vm::SchemasContext* schema_context_;
     ::llvm::Module* module_;
     const node::FrameNode* frame_node_;
     uint32_t id_;
     std::set<std::string> available_agg_func_set_;
     std::unordered_map<std::string, AggColumnInfo> agg_col_infos_;
+    bool column_agg_;
+    std::unordered_map<std::string, AggCondInfo> agg_cond_infos_;
 };
 
 }  // namespace codegen
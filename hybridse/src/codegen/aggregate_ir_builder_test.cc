@@ -17,6 +17,9 @@
 #include <string>
 #include <vector>
 #include "codegen/fn_let_ir_builder_test.h"
+#include "gflags/gflags.h"
+
+DECLARE_bool(enable_window_column_agg);
 
 namespace hybridse {
 namespace codegen {
@@ -124,6 +127,56 @@ TEST_F(AggregateIRBuilderTest, TestMixedMultipleAgg) {
     free(ptr);
 }
 
+TEST_F(AggregateIRBuilderTest, TestColumnWiseMultipleAgg) {
+    FLAGS_enable_window_column_agg = true;
+    std::string sql =
+        "SELECT "
+        "sum(col1) OVER w1 as col1_sum, "
+        "avg(col2) OVER w1 as col2_avg, "
+        "min(col3) OVER w1 as col3_min, "
+        "max(col4) OVER w1 as col4_max, "
+        "count(col5) OVER w1 as col5_count, "
+        "sum_where(col1, col5 > 100) OVER w1 as col1_sum_where, "
+        "count_where(col4, col1 >= 111) OVER w1 as col4_count_where, "
+        "avg_where(col5, 1111 > col1) OVER w1 as col5_avg_where, "
+        "min_where(col2, col2 > 2) OVER w1 as col2_min_where, "
+        "max_where(col4, col4 < 0) OVER w1 as col4_max_where "
+        "FROM t1 WINDOW "
+        "w1 AS "
+        "(PARTITION BY COL2 ORDER BY `TS` ROWS_RANGE BETWEEN 3 PRECEDING AND "
+        "CURRENT ROW) limit 10;";
+
+    int8_t* ptr = NULL;
+    std::vector<Row> window;
+    type::TableDef table1;
+    BuildWindow(table1, window, &ptr);
+    int8_t* output = NULL;
+    int8_t* row_ptr = reinterpret_cast<int8_t*>(&window[window.size() - 1]);
+    codec::ListRef<Row> window_ref;
+    window_ref.list = ptr;
+    int8_t* window_ptr = reinterpret_cast<int8_t*>(&window_ref);
+    codec::Schema schema;
+    CheckFnLetBuilder(&manager, table1, "", sql, row_ptr, window_ptr, &schema,
+                      &output);
+    FLAGS_enable_window_column_agg = false;
+
+    codec::RowView view(schema);
+    view.Reset(output, view.GetSize(output));
+    ASSERT_EQ(view.GetInt32Unsafe(0), 1 + 11 + 111 + 1111 + 11111);
+    ASSERT_DOUBLE_EQ(view.GetDoubleUnsafe(1),
+                     (2 + 22 + 222 + 2222 + 22222) / 5.0);
+    ASSERT_FLOAT_EQ(view.GetFloatUnsafe(2), 3.1f);
+    ASSERT_DOUBLE_EQ(view.GetDoubleUnsafe(3), 44444.1);
+    ASSERT_EQ(view.GetInt64Unsafe(4), 5);
+    ASSERT_EQ(view.GetInt32Unsafe(5), 111 + 1111 + 11111);
+    ASSERT_EQ(view.GetInt64Unsafe(6), 3);
+    ASSERT_DOUBLE_EQ(view.GetDoubleUnsafe(7), (5 + 55 + 555) / 3.0);
+    ASSERT_EQ(view.GetInt16Unsafe(8), 22);
+    ASSERT_TRUE(view.IsNULL(9));
+
+    free(ptr);
+}
+
 }  // namespace codegen
 }  // namespace hybridse
 
@@ -19,6 +19,22 @@
 DEFINE_string(default_db_name, "_hybridse",
               "config the default batch catalog db name");
 
+// Codegen config
+DEFINE_bool(enable_window_column_agg, false,
+            "config if the window sum/avg/count/min/max are computed by the "
+            "column-wise simd kernels");
+
+// Batch runner config
+DEFINE_bool(enable_batch_hash_runner, true,
+            "config if the batch last join and group by without an index use "
+            "the hash-partitioned runners");
+DEFINE_uint64(batch_hash_join_memory_limit_mb, 1024,
+              "config the memory limit in MB of the build side of a batch hash "
+              "last join, the build side spills to disk beyond it");
+DEFINE_string(batch_hash_join_spill_dir, "/tmp",
+              "config the directory of the spill files of the batch hash last "
+              "join");
+
 // Offline Spark config
 DEFINE_bool(enable_spark_unsaferow_format, false,
             "config if codec uses Spark UnsafeRow format");
@@ -1045,6 +1045,11 @@ SqlNode *NodeManager::MakeStorageModeNode(StorageMode storage_mode) {
     return RegisterNode(node_ptr);
 }
 
+SqlNode *NodeManager::MakeDiskTableOptionNode(const std::string &name, const std::string &value) {
+    SqlNode *node_ptr = new DiskTableOptionNode(name, value);
+    return RegisterNode(node_ptr);
+}
+
 SqlNode *NodeManager::MakePartitionNumNode(int num) {
     SqlNode *node_ptr = new PartitionNumNode(num);
     return RegisterNode(node_ptr);
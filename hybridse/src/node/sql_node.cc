@@ -1136,6 +1136,9 @@ std::string NameOfSqlNodeType(const SqlNodeType &type) {
         case kStorageMode:
             output = "kStorageMode";
             break;
+        case kDiskTableOption:
+            output = "kDiskTableOption";
+            break;
         case kFn:
             output = "kFn";
             break;
@@ -2495,6 +2498,13 @@ void StorageModeNode::Print(std::ostream &output, const std::string &org_tab) co
     PrintValue(output, tab, StorageModeName(storage_mode_), "storage_mode", true);
 }
 
+void DiskTableOptionNode::Print(std::ostream &output, const std::string &org_tab) const {
+    SqlNode::Print(output, org_tab);
+    const std::string tab = org_tab + INDENT + SPACE_ED;
+    output << "\n";
+    PrintValue(output, tab, value_, name_, true);
+}
+
 void PartitionNumNode::Print(std::ostream &output, const std::string &org_tab) const {
     SqlNode::Print(output, org_tab);
     const std::string tab = org_tab + INDENT + SPACE_ED;
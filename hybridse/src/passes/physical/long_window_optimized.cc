@@ -20,6 +20,7 @@
 #include <string>
 #include <vector>
 
+#include "base/fe_pre_aggr.h"
 #include "vm/engine.h"
 #include "vm/physical_op.h"
 
@@ -54,43 +55,55 @@ bool LongWindowOptimized::Transform(PhysicalOpNode* in, PhysicalOpNode** output)
         return false;
     }
 
-    auto project_aggr_op = dynamic_cast<vm::PhysicalAggregationNode*>(project_op);
-    // TODO(zhanghao): we only support transform PhysicalAggregationNode with one and only one window aggregation op
-    // we may remove this constraint in a later optimization
-    if (!VerifySingleAggregation(project_op)) {
-        LOG(WARNING) << "we only support transform PhysicalAggregationNode with one and only one window aggregation op";
-        return false;
-    }
-
     // this case shouldn't happen as we add the LongWindowOptimized pass only when `long_windows` option exists
     if (long_windows_.empty()) {
         LOG(ERROR) << "Long Windows is empty";
         return false;
     }
 
+    auto project_aggr_op = dynamic_cast<vm::PhysicalAggregationNode*>(project_op);
     const auto& projects = project_aggr_op->project();
+    // the aggregate calls over the long window which can be computed from the pre-aggr tables
+    std::vector<size_t> pre_aggr_idxs;
+    std::vector<vm::PhysicalTableProviderNode*> aggr_tables;
     for (size_t i = 0; i < projects.size(); i++) {
         const auto* expr = projects.GetExpr(i);
-        if (expr->GetExprType() == node::kExprCall) {
-            const auto* call_expr = dynamic_cast<const node::CallExprNode*>(expr);
-            const auto* window = call_expr->GetOver();
-            if (window == nullptr) continue;
-
-            // skip ANONYMOUS_WINDOW
-            if (!window->GetName().empty()) {
-                if (long_windows_.count(window->GetName())) {
-                    return OptimizeWithPreAggr(project_aggr_op, i, output);
-                }
-            }
+        if (expr->GetExprType() != node::kExprCall) {
+            continue;
         }
+        const auto* call_expr = dynamic_cast<const node::CallExprNode*>(expr);
+        const auto* window = call_expr->GetOver();
+        // skip ANONYMOUS_WINDOW
+        if (window == nullptr || window->GetName().empty() || !long_windows_.count(window->GetName())) {
+            continue;
+        }
+        vm::PhysicalTableProviderNode* aggr_table = nullptr;
+        if (GetPreAggrTable(project_aggr_op, i, &aggr_table)) {
+            pre_aggr_idxs.push_back(i);
+            aggr_tables.push_back(aggr_table);
+        }
+    }
+    if (pre_aggr_idxs.empty()) {
+        return false;
     }
 
-    return true;
+    if (pre_aggr_idxs.size() == projects.size() && (projects.size() == 1 || !HasRowLimit(project_aggr_op))) {
+        return OptimizeWithPreAggr(project_aggr_op, aggr_tables, output);
+    }
+    return SplitWithPreAggr(project_aggr_op, pre_aggr_idxs, aggr_tables, output);
 }
 
-bool LongWindowOptimized::OptimizeWithPreAggr(vm::PhysicalAggregationNode* in, int idx, PhysicalOpNode** output) {
-    *output = in;
+bool LongWindowOptimized::HasRowLimit(vm::PhysicalAggregationNode* in) {
+    if (in->producers()[0]->GetOpType() != vm::kPhysicalOpRequestUnion) {
+        return true;
+    }
+    auto req_union_op = dynamic_cast<vm::PhysicalRequestUnionNode*>(in->producers()[0]);
+    auto frame = req_union_op->window().range_.frame();
+    return frame == nullptr || frame->frame_type() != node::kFrameRowsRange || frame->frame_maxsize() > 0;
+}
 
+bool LongWindowOptimized::GetPreAggrTable(vm::PhysicalAggregationNode* in, size_t idx,
+                                          vm::PhysicalTableProviderNode** aggr_table) {
     if (in->producers()[0]->GetOpType() != vm::kPhysicalOpRequestUnion) {
         return false;
     }
@@ -104,16 +117,15 @@ bool LongWindowOptimized::OptimizeWithPreAggr(vm::PhysicalAggregationNode* in, i
     auto aggr_op = dynamic_cast<const node::CallExprNode*>(projects.GetExpr(idx));
     auto window = aggr_op->GetOver();
 
-    auto expr_type = aggr_op->GetChild(0)->GetExprType();
-    if (aggr_op->GetChildNum() != 1 || (expr_type != node::kExprColumnRef && expr_type != node::kExprAll)) {
-        LOG(ERROR) << "Not support aggregation over multiple cols: " << ConcatExprList(aggr_op->children_);
+    std::string func_name = aggr_op->GetFnDef()->GetName();
+    std::string aggr_col = ConcatExprList(aggr_op->children_);
+    if (!VerifyPreAggrCall(aggr_op, orig_data_provider, aggr_col)) {
+        LOG(WARNING) << "Not support pre-aggregation of " << func_name << "(" << aggr_col << ")";
         return false;
     }
 
     const std::string& db_name = orig_data_provider->GetDb();
     const std::string& table_name = orig_data_provider->GetName();
-    std::string func_name = aggr_op->GetFnDef()->GetName();
-    std::string aggr_col = ConcatExprList(aggr_op->children_);
     std::string partition_col;
     if (window->GetPartitions()) {
         partition_col = ConcatExprList(window->GetPartitions()->children_);
@@ -160,58 +172,86 @@ bool LongWindowOptimized::OptimizeWithPreAggr(vm::PhysicalAggregationNode* in, i
         return false;
     }
 
-    vm::PhysicalTableProviderNode* aggr = nullptr;
-    auto status = plan_ctx_->CreateOp<vm::PhysicalTableProviderNode>(&aggr, table);
+    if (table->GetIndex().size() != 1) {
+        LOG(ERROR) << "PreAggregation table index size != 1";
+        return false;
+    }
+
+    auto status = plan_ctx_->CreateOp<vm::PhysicalTableProviderNode>(aggr_table, table);
     if (!status.isOK()) {
         LOG(ERROR) << "Fail to create PhysicalTableProviderNode for pre-aggregation table " << table_infos[0].aggr_db
                    << "." << table_infos[0].aggr_table << ": " << status;
         return false;
     }
+    return true;
+}
 
-    if (table->GetIndex().size() != 1) {
-        LOG(ERROR) << "PreAggregation table index size != 1";
+bool LongWindowOptimized::OptimizeWithPreAggr(vm::PhysicalAggregationNode* in,
+                                              const std::vector<vm::PhysicalTableProviderNode*>& aggr_tables,
+                                              PhysicalOpNode** output) {
+    *output = in;
+
+    const auto& projects = in->project();
+    if (aggr_tables.size() != projects.size()) {
+        LOG(ERROR) << "Pre-aggregation tables size " << aggr_tables.size() << " != projects size "
+                   << projects.size();
         return false;
     }
-    auto index = table->GetIndex().cbegin()->second;
+    auto req_union_op = dynamic_cast<vm::PhysicalRequestUnionNode*>(in->producers()[0]);
     auto nm = plan_ctx_->node_manager();
-
     auto request = req_union_op->GetProducer(0);
     auto raw = req_union_op->GetProducer(1);
-
-    // generate an aggregation window for the aggr table
     auto req_window = req_union_op->window();
-    auto partitions = nm->MakeExprList();
-    for (size_t i = 0; i < index.keys.size(); i++) {
-        auto col_ref = nm->MakeColumnRefNode(index.keys[i].name, table->GetName(), table->GetDatabase());
-        partitions->AddChild(col_ref);
-    }
-    vm::RequestWindowOp aggr_window(partitions);
 
-    auto order_col_ref =
-        nm->MakeColumnRefNode((*table->GetSchema())[index.ts_pos].name(), table->GetName(), table->GetDatabase());
-    auto order_expr = nm->MakeOrderExpression(order_col_ref, true);
-    auto orders = nm->MakeExprList();
-    orders->AddChild(order_expr);
+    std::vector<PhysicalOpNode*> aggrs;
+    std::vector<vm::RequestWindowOp> aggr_windows;
+    std::vector<const node::FnDefNode*> funcs;
+    std::vector<const node::ExprNode*> agg_cols;
+    std::vector<std::string> agg_args;
+    for (size_t i = 0; i < projects.size(); i++) {
+        auto aggr_op = dynamic_cast<const node::CallExprNode*>(projects.GetExpr(i));
+        auto table = aggr_tables[i]->table_handler_;
+        auto index = table->GetIndex().cbegin()->second;
+
+        // generate an aggregation window for the aggr table
+        auto partitions = nm->MakeExprList();
+        for (size_t j = 0; j < index.keys.size(); j++) {
+            auto col_ref = nm->MakeColumnRefNode(index.keys[j].name, table->GetName(), table->GetDatabase());
+            partitions->AddChild(col_ref);
+        }
+        vm::RequestWindowOp aggr_window(partitions);
+
+        auto order_col_ref =
+            nm->MakeColumnRefNode((*table->GetSchema())[index.ts_pos].name(), table->GetName(), table->GetDatabase());
+        auto order_expr = nm->MakeOrderExpression(order_col_ref, true);
+        auto orders = nm->MakeExprList();
+        orders->AddChild(order_expr);
+
+        auto partition_by = nm->MakeExprList();
+        for (size_t j = 0; j < index.keys.size(); j++) {
+            auto col_ref = nm->MakeColumnRefNode((*table->GetSchema())[index.keys[j].idx].name(), table->GetName(),
+                                                 table->GetDatabase());
+            partition_by->AddChild(col_ref);
+        }
 
-    auto partition_by = nm->MakeExprList();
-    for (size_t i = 0; i < index.keys.size(); i++) {
-        auto col_ref = nm->MakeColumnRefNode((*table->GetSchema())[index.keys[i].idx].name(), table->GetName(),
-                                             table->GetDatabase());
-        partition_by->AddChild(col_ref);
+        aggr_window.sort_.orders_ = nm->MakeOrderByNode(orders);
+        aggr_window.name_ = req_window.name();
+        aggr_window.range_ = req_window.range_;
+        aggr_window.range_.range_key_ = order_col_ref;
+        aggr_window.partition_.keys_ = partition_by;
+
+        aggrs.push_back(aggr_tables[i]);
+        aggr_windows.push_back(aggr_window);
+        funcs.push_back(aggr_op->GetFnDef());
+        agg_cols.push_back(aggr_op->GetChild(0));
+        agg_args.push_back(ConcatExprList(aggr_op->children_));
     }
 
-    aggr_window.sort_.orders_ = nm->MakeOrderByNode(orders);
-    aggr_window.name_ = req_window.name();
-    aggr_window.range_ = req_window.range_;
-    aggr_window.range_.range_key_ = order_col_ref;
-    aggr_window.partition_.keys_ = partition_by;
-
     vm::PhysicalRequestAggUnionNode* request_aggr_union = nullptr;
-    status = plan_ctx_->CreateOp<vm::PhysicalRequestAggUnionNode>(
-        &request_aggr_union, request, raw, aggr, req_union_op->window(), aggr_window,
+    auto status = plan_ctx_->CreateOp<vm::PhysicalRequestAggUnionNode>(
+        &request_aggr_union, request, raw, aggrs, req_union_op->window(), aggr_windows,
         req_union_op->instance_not_in_window(), req_union_op->exclude_current_time(),
-        req_union_op->output_request_row(), aggr_op->GetFnDef(),
-        aggr_op->GetChild(0));
+        req_union_op->output_request_row(), funcs, agg_cols, agg_args);
     if (!status.isOK()) {
         LOG(ERROR) << "Fail to create PhysicalRequestAggUnionNode: " << status;
         return false;
@@ -225,25 +265,184 @@ bool LongWindowOptimized::OptimizeWithPreAggr(vm::PhysicalAggregationNode* in, i
 
     status = plan_ctx_->CreateOp<vm::PhysicalReduceAggregationNode>(&reduce_aggr, request_aggr_union, in->project(),
                                                                     condition, in);
+    if (!status.isOK()) {
+        LOG(ERROR) << "Fail to create PhysicalReduceAggregationNode: " << status;
+        return false;
+    }
 
     auto ctx = reduce_aggr->schemas_ctx();
-    if (ctx->GetSchemaSourceSize() != 1 || ctx->GetSchema(0)->size() != 1) {
+    if (ctx->GetSchemaSourceSize() != 1 || ctx->GetSchema(0)->size() != static_cast<int>(projects.size())) {
         LOG(ERROR) << "PhysicalReduceAggregationNode schema is unexpected";
         return false;
     }
     request_aggr_union->UpdateParentSchema(ctx);
 
+    LOG(INFO) << "[LongWindowOptimized] Before transform sql:\n" << (*output)->GetTreeString();
+    *output = reduce_aggr;
+    LOG(INFO) << "[LongWindowOptimized] After transform sql:\n" << (*output)->GetTreeString();
+    return true;
+}
+
+bool LongWindowOptimized::SplitWithPreAggr(vm::PhysicalAggregationNode* in, const std::vector<size_t>& pre_aggr_idxs,
+                                           const std::vector<vm::PhysicalTableProviderNode*>& aggr_tables,
+                                           PhysicalOpNode** output) {
+    *output = in;
+    const auto& projects = in->project();
+
+    // the calls of the window with row limit are computed one by one as the rows are counted
+    // on the buckets of a single pre-aggr table
+    std::vector<std::vector<size_t>> groups;
+    if (HasRowLimit(in)) {
+        for (size_t i = 0; i < pre_aggr_idxs.size(); i++) {
+            groups.push_back({i});
+        }
+    } else {
+        groups.emplace_back();
+        for (size_t i = 0; i < pre_aggr_idxs.size(); i++) {
+            groups.back().push_back(i);
+        }
+    }
+
+    std::vector<PhysicalOpNode*> split_nodes;
+    vm::ColumnProjects final_column_projects;
+    for (size_t i = 0; i < projects.size(); i++) {
+        final_column_projects.Add(projects.GetName(i), node_manager_->MakeColumnRefNode(projects.GetName(i), ""),
+                                  nullptr);
+    }
+    auto create_aggr_node = [this, in, &projects](const std::vector<size_t>& idxs, vm::PhysicalAggregationNode** node) {
+        vm::ColumnProjects column_projects;
+        for (auto idx : idxs) {
+            column_projects.Add(projects.GetName(idx), projects.GetExpr(idx), projects.GetFrame(idx));
+        }
+        column_projects.SetPrimaryFrame(projects.GetPrimaryFrame());
+        auto status = plan_ctx_->CreateOp<vm::PhysicalAggregationNode>(node, in->GetProducer(0), column_projects,
+                                                                       in->having_condition_.condition());
+        if (!status.isOK()) {
+            LOG(ERROR) << "Fail to create PhysicalAggregationNode: " << status;
+            return false;
+        }
+        return true;
+    };
+
+    for (const auto& group : groups) {
+        std::vector<size_t> idxs;
+        std::vector<vm::PhysicalTableProviderNode*> group_tables;
+        for (auto i : group) {
+            idxs.push_back(pre_aggr_idxs[i]);
+            group_tables.push_back(aggr_tables[i]);
+        }
+        vm::PhysicalAggregationNode* node = nullptr;
+        if (!create_aggr_node(idxs, &node)) {
+            return false;
+        }
+        PhysicalOpNode* optimized = node;
+        OptimizeWithPreAggr(node, group_tables, &optimized);
+        split_nodes.push_back(optimized);
+    }
+
+    // the other projects are computed by the window scan
+    std::vector<size_t> other_idxs;
+    for (size_t i = 0, j = 0; i < projects.size(); i++) {
+        if (j < pre_aggr_idxs.size() && pre_aggr_idxs[j] == i) {
+            j++;
+        } else {
+            other_idxs.push_back(i);
+        }
+    }
+    if (!other_idxs.empty()) {
+        vm::PhysicalAggregationNode* node = nullptr;
+        if (!create_aggr_node(other_idxs, &node)) {
+            return false;
+        }
+        split_nodes.push_back(node);
+    }
+
+    if (split_nodes.size() < 2) {
+        return false;
+    }
+    PhysicalOpNode* join = split_nodes[0];
+    for (size_t i = 1; i < split_nodes.size(); ++i) {
+        vm::PhysicalRequestJoinNode* new_join = nullptr;
+        auto status = plan_ctx_->CreateOp<vm::PhysicalRequestJoinNode>(&new_join, join, split_nodes[i],
+                                                                       ::hybridse::node::kJoinTypeConcat);
+        if (!status.isOK()) {
+            LOG(ERROR) << "Fail to create PhysicalRequestJoinNode: " << status;
+            return false;
+        }
+        join = new_join;
+    }
+
+    vm::PhysicalSimpleProjectNode* simple_prj = nullptr;
+    auto status = plan_ctx_->CreateOp<vm::PhysicalSimpleProjectNode>(&simple_prj, join, final_column_projects);
     if (!status.isOK()) {
-        LOG(ERROR) << "Fail to create PhysicalReduceAggregationNode: " << status;
+        LOG(ERROR) << "Fail to create PhysicalSimpleProjectNode: " << status;
         return false;
     }
     LOG(INFO) << "[LongWindowOptimized] Before transform sql:\n" << (*output)->GetTreeString();
-    *output = reduce_aggr;
+    *output = simple_prj;
     LOG(INFO) << "[LongWindowOptimized] After transform sql:\n" << (*output)->GetTreeString();
     return true;
 }
 
-bool LongWindowOptimized::VerifySingleAggregation(vm::PhysicalProjectNode* op) { return op->project().size() == 1; }
+bool LongWindowOptimized::VerifyPreAggrCall(const node::CallExprNode* call, vm::PhysicalDataProviderNode* provider,
+                                            const std::string& aggr_col) {
+    base::PreAggrFunc func;
+    std::vector<std::string> args;
+    if (aggr_col.empty() || !base::ParsePreAggrFunc(call->GetFnDef()->GetName(), &func) ||
+        !base::SplitPreAggrArgs(aggr_col, func, &args) || call->GetChildNum() != args.size()) {
+        return false;
+    }
+    const auto& schema = *provider->table_handler_->GetSchema();
+    auto get_type = [&schema](const std::string& col, type::Type* type) {
+        for (int i = 0; i < schema.size(); i++) {
+            if (schema.Get(i).name() == col) {
+                *type = schema.Get(i).type();
+                return true;
+            }
+        }
+        return false;
+    };
+    // the keys of distinct_count can be any type, the keys of the others are formatted in the output
+    auto is_key_type = [](type::Type type) {
+        return type == type::kInt16 || type == type::kInt32 || type == type::kInt64 || type == type::kVarchar;
+    };
+    auto is_number_type = [](type::Type type) {
+        return type == type::kInt16 || type == type::kInt32 || type == type::kInt64 || type == type::kFloat ||
+               type == type::kDouble;
+    };
+
+    type::Type value_type = type::kInt64;
+    auto value_expr_type = call->GetChild(0)->GetExprType();
+    if (value_expr_type == node::kExprAll) {
+        if (func.kind != base::PreAggrKind::kCount || func.has_cate) {
+            return false;
+        }
+    } else if (value_expr_type != node::kExprColumnRef || !get_type(args[0], &value_type)) {
+        return false;
+    }
+    if (func.has_cond) {
+        base::PreAggrCondition cond;
+        type::Type cond_type;
+        if (!cond.Parse(args[func.CondPos()]) || !get_type(cond.column(), &cond_type)) {
+            return false;
+        }
+    }
+    if (func.has_cate) {
+        type::Type cate_type;
+        if (call->GetChild(func.CatePos())->GetExprType() != node::kExprColumnRef ||
+            !get_type(args[func.CatePos()], &cate_type) || !is_key_type(cate_type)) {
+            return false;
+        }
+        return func.kind == base::PreAggrKind::kCount || is_number_type(value_type);
+    }
+    switch (func.kind) {
+        case base::PreAggrKind::kTopNFrequency:
+            return is_key_type(value_type) && call->GetChild(1)->GetExprType() == node::kExprPrimary &&
+                   !args[1].empty() && args[1].find_first_not_of("0123456789") == std::string::npos;
+        default:
+            return true;
+    }
+}
 
 std::string LongWindowOptimized::ConcatExprList(std::vector<node::ExprNode*> exprs, const std::string& delimiter) {
     std::string str = "";
@@ -253,6 +452,21 @@ std::string LongWindowOptimized::ConcatExprList(std::vector<node::ExprNode*> exp
             expr_val = expr->GetExprString();
         } else if (expr->GetExprType() == node::kExprColumnRef) {
             expr_val = dynamic_cast<node::ColumnRefNode*>(expr)->GetColumnName();
+        } else if (expr->GetExprType() == node::kExprPrimary) {
+            expr_val = expr->GetExprString();
+        } else if (expr->GetExprType() == node::kExprBinary) {
+            // the condition of `*_where`, e.g. `col > 1`
+            auto binary = dynamic_cast<node::BinaryExpr*>(expr);
+            std::string lhs = ConcatExprList({binary->GetChild(0)});
+            std::string rhs = ConcatExprList({binary->GetChild(1)});
+            if (binary->GetChild(0)->GetExprType() != node::kExprColumnRef ||
+                binary->GetChild(1)->GetExprType() != node::kExprPrimary || lhs.empty() || rhs.empty()) {
+                LOG(WARNING) << "non support condition in ConcatExprList: " << expr->GetExprString();
+                return "";
+            }
+            auto literal = dynamic_cast<node::ConstNode*>(binary->GetChild(1));
+            expr_val = base::FormatPreAggrCondition(lhs, node::ExprOpTypeName(binary->GetOp()), rhs,
+                                                    literal->GetDataType() == node::kVarchar);
         } else {
             LOG(ERROR) << "non support expr type in ConcatExprList";
             return "";
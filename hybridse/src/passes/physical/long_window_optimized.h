@@ -31,8 +31,21 @@ class LongWindowOptimized : public TransformUpPysicalPass {
 
  private:
     bool Transform(PhysicalOpNode* in, PhysicalOpNode** output) override;
-    bool VerifySingleAggregation(vm::PhysicalProjectNode* op);
-    bool OptimizeWithPreAggr(vm::PhysicalAggregationNode* in, int idx, PhysicalOpNode** output);
+    // whether the aggregate call can be computed from the pre-aggr table
+    bool VerifyPreAggrCall(const node::CallExprNode* call, vm::PhysicalDataProviderNode* provider,
+                           const std::string& aggr_col);
+    // whether the window of the aggregation limits the number of rows
+    bool HasRowLimit(vm::PhysicalAggregationNode* in);
+    // get the pre-aggr table of the idx-th project of the aggregation
+    bool GetPreAggrTable(vm::PhysicalAggregationNode* in, size_t idx, vm::PhysicalTableProviderNode** aggr_table);
+    // compute all the projects of the aggregation from the pre-aggr tables in one REQUEST_AGG_UNION,
+    // aggr_tables[i] is the pre-aggr table of the i-th project
+    bool OptimizeWithPreAggr(vm::PhysicalAggregationNode* in,
+                             const std::vector<vm::PhysicalTableProviderNode*>& aggr_tables, PhysicalOpNode** output);
+    // split the aggregation into the projects computed from the pre-aggr tables and the others,
+    // and join them by concat
+    bool SplitWithPreAggr(vm::PhysicalAggregationNode* in, const std::vector<size_t>& pre_aggr_idxs,
+                          const std::vector<vm::PhysicalTableProviderNode*>& aggr_tables, PhysicalOpNode** output);
     static std::string ConcatExprList(std::vector<node::ExprNode*> exprs, const std::string& delimiter = ",");
 
     std::set<std::string> long_windows_;
@@ -15,6 +15,8 @@
  */
 #include "passes/physical/split_aggregation_optimized.h"
 
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "vm/engine.h"
@@ -90,6 +92,10 @@ bool SplitAggregationOptimized::SplitProjects(vm::PhysicalAggregationNode* in, P
     std::vector<vm::PhysicalProjectNode*> split_nodes;
     vm::ColumnProjects final_column_projects;
     vm::ColumnProjects simple_column_projects;
+    // the calls over the same long window are kept in one aggregation, as they are computed
+    // from the pre-aggr tables together by LongWindowOptimized
+    std::vector<vm::ColumnProjects> window_column_projects;
+    std::unordered_map<std::string, size_t> long_window_idxs;
     for (size_t i = 0; i < projects.size(); i++) {
         const auto* expr = projects.GetExpr(i);
         auto name = projects.GetName(i);
@@ -100,23 +106,18 @@ bool SplitAggregationOptimized::SplitProjects(vm::PhysicalAggregationNode* in, P
             const auto* window = call_expr->GetOver();
 
             if (window) {
-                // create PhysicalAggregationNode of the window project
-                vm::ColumnProjects column_projects;
-                column_projects.Add(name, expr, projects.GetFrame(i));
-                column_projects.SetPrimaryFrame(projects.GetPrimaryFrame());
-                vm::PhysicalAggregationNode* node = nullptr;
-                DLOG(INFO) << "Create Single Aggregation: size = " << column_projects.size()
-                           << ", expr = " << column_projects.GetExpr(column_projects.size() - 1)->GetExprString();
-
-                auto status = plan_ctx_->CreateOp<vm::PhysicalAggregationNode>(
-                    &node, in->GetProducer(0), column_projects, in->having_condition_.condition());
-                if (!status.isOK()) {
-                    LOG(ERROR) << "Fail to create PhysicalAggregationNode: " << status;
-                    return false;
+                const auto& window_name = window->GetName();
+                bool is_long_window = !window_name.empty() && long_windows_.count(window_name);
+                auto it = long_window_idxs.find(window_name);
+                if (is_long_window && it != long_window_idxs.end()) {
+                    window_column_projects[it->second].Add(name, expr, projects.GetFrame(i));
+                    continue;
                 }
-
-                split_nodes.emplace_back(node);
-                column_projects.Clear();
+                if (is_long_window) {
+                    long_window_idxs[window_name] = window_column_projects.size();
+                }
+                window_column_projects.emplace_back();
+                window_column_projects.back().Add(name, expr, projects.GetFrame(i));
             } else {
                 simple_column_projects.Add(projects.GetName(i), expr, projects.GetFrame(i));
             }
@@ -125,6 +126,22 @@ bool SplitAggregationOptimized::SplitProjects(vm::PhysicalAggregationNode* in, P
         }
     }
 
+    // create PhysicalAggregationNode of the window projects
+    for (auto& column_projects : window_column_projects) {
+        column_projects.SetPrimaryFrame(projects.GetPrimaryFrame());
+        vm::PhysicalAggregationNode* node = nullptr;
+        DLOG(INFO) << "Create Aggregation: size = " << column_projects.size()
+                   << ", expr = " << column_projects.GetExpr(column_projects.size() - 1)->GetExprString();
+
+        auto status = plan_ctx_->CreateOp<vm::PhysicalAggregationNode>(
+            &node, in->GetProducer(0), column_projects, in->having_condition_.condition());
+        if (!status.isOK()) {
+            LOG(ERROR) << "Fail to create PhysicalAggregationNode: " << status;
+            return false;
+        }
+        split_nodes.emplace_back(node);
+    }
+
     if (simple_column_projects.size() > 0) {
         vm::PhysicalRowProjectNode* row_prj = nullptr;
         auto status =
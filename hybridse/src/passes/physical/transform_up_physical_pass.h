@@ -37,7 +37,8 @@ enum PhysicalPlanPassType {
     kPassClusterOptimized,
     kPassLimitOptimized,
     kPassLongWindowOptimized,
-    kPassSplitAggregationOptimized
+    kPassSplitAggregationOptimized,
+    kPassWindowScanSharing
 };
 
 inline std::string PhysicalPlanPassTypeName(PhysicalPlanPassType type) {
@@ -58,6 +59,8 @@ inline std::string PhysicalPlanPassTypeName(PhysicalPlanPassType type) {
             return "PassLongWindowOptimized";
         case kPassSplitAggregationOptimized:
             return "SplitAggregationOptimized";
+        case kPassWindowScanSharing:
+            return "PassWindowScanSharing";
         default:
             return "unknowPass";
     }
@@ -0,0 +1,178 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "passes/physical/window_scan_sharing.h"
+
+#include <set>
+#include <vector>
+
+namespace hybridse {
+namespace passes {
+
+using hybridse::common::kPlanError;
+using hybridse::vm::kPhysicalOpDataProvider;
+using hybridse::vm::kPhysicalOpRequestUnion;
+using hybridse::vm::kProviderTypePartition;
+using hybridse::vm::PhysicalDataProviderNode;
+using hybridse::vm::PhysicalPartitionProviderNode;
+
+// whether the request union can take part in a shared scan
+static bool CanShareScan(const PhysicalRequestUnionNode* node) {
+    return !node->instance_not_in_window() && node->window_unions().Empty() &&
+           node->window().range().Valid() &&
+           nullptr != node->window().range().frame();
+}
+
+static bool SameInput(const PhysicalOpNode* lhs, const PhysicalOpNode* rhs) {
+    if (lhs == rhs) {
+        return true;
+    }
+    if (nullptr == lhs || nullptr == rhs ||
+        kPhysicalOpDataProvider != lhs->GetOpType() ||
+        kPhysicalOpDataProvider != rhs->GetOpType()) {
+        return false;
+    }
+    auto lhs_provider = dynamic_cast<const PhysicalDataProviderNode*>(lhs);
+    auto rhs_provider = dynamic_cast<const PhysicalDataProviderNode*>(rhs);
+    if (lhs_provider->provider_type_ != rhs_provider->provider_type_ ||
+        lhs_provider->GetDb() != rhs_provider->GetDb() ||
+        lhs_provider->GetName() != rhs_provider->GetName()) {
+        return false;
+    }
+    if (kProviderTypePartition == lhs_provider->provider_type_) {
+        return dynamic_cast<const PhysicalPartitionProviderNode*>(lhs)
+                   ->index_name_ ==
+               dynamic_cast<const PhysicalPartitionProviderNode*>(rhs)
+                   ->index_name_;
+    }
+    return true;
+}
+
+bool WindowScanSharing::SameScan(const PhysicalRequestUnionNode* lhs,
+                                 const PhysicalRequestUnionNode* rhs) {
+    if (lhs == rhs || lhs->GetProducerCnt() != 2 ||
+        rhs->GetProducerCnt() != 2) {
+        return false;
+    }
+    if (lhs->exclude_current_time() != rhs->exclude_current_time() ||
+        lhs->output_request_row() != rhs->output_request_row()) {
+        return false;
+    }
+    if (!SameInput(lhs->GetProducer(0), rhs->GetProducer(0)) ||
+        !SameInput(lhs->GetProducer(1), rhs->GetProducer(1))) {
+        return false;
+    }
+    auto& lhs_window = lhs->window();
+    auto& rhs_window = rhs->window();
+    return node::ExprEquals(lhs_window.partition().keys(),
+                            rhs_window.partition().keys()) &&
+           node::ExprEquals(lhs_window.index_key().keys(),
+                            rhs_window.index_key().keys()) &&
+           node::ExprEquals(lhs_window.sort().orders(),
+                            rhs_window.sort().orders()) &&
+           node::ExprEquals(lhs_window.range().range_key(),
+                            rhs_window.range().range_key());
+}
+
+bool WindowScanSharing::CoverFrame(const PhysicalRequestUnionNode* large,
+                                   const PhysicalRequestUnionNode* small) {
+    auto large_frame = large->window().range().frame();
+    auto small_frame = small->window().range().frame();
+    if (large_frame->frame_type() != small_frame->frame_type()) {
+        return false;
+    }
+    // the rows of both windows end at the same position, so the smaller one
+    // is a prefix of the larger one in the descending order of the scan
+    if (large_frame->GetHistoryRangeEnd() !=
+            small_frame->GetHistoryRangeEnd() ||
+        large_frame->GetHistoryRowsEnd() != small_frame->GetHistoryRowsEnd()) {
+        return false;
+    }
+    if (large_frame->GetHistoryRangeStart() >
+            small_frame->GetHistoryRangeStart() ||
+        large_frame->GetHistoryRowsStart() >
+            small_frame->GetHistoryRowsStart()) {
+        return false;
+    }
+    // 0 means no limit of the max size
+    return 0 == large_frame->frame_maxsize() ||
+           (0 < small_frame->frame_maxsize() &&
+            small_frame->frame_maxsize() <= large_frame->frame_maxsize());
+}
+
+void WindowScanSharing::CollectRequestUnions(
+    PhysicalOpNode* input, std::set<PhysicalOpNode*>* visited,
+    std::vector<PhysicalRequestUnionNode*>* unions) {
+    if (nullptr == input || !visited->insert(input).second) {
+        return;
+    }
+    for (size_t i = 0; i < input->GetProducerCnt(); ++i) {
+        CollectRequestUnions(input->GetProducer(i), visited, unions);
+    }
+    if (kPhysicalOpRequestUnion == input->GetOpType()) {
+        auto union_op = PhysicalRequestUnionNode::CastFrom(input);
+        if (CanShareScan(union_op)) {
+            unions->push_back(union_op);
+        }
+    }
+}
+
+Status WindowScanSharing::Apply(PhysicalPlanContext* ctx,
+                                PhysicalOpNode* input, PhysicalOpNode** out) {
+    CHECK_TRUE(input != nullptr, kPlanError);
+    *out = input;
+    std::set<PhysicalOpNode*> visited;
+    std::vector<PhysicalRequestUnionNode*> unions;
+    CollectRequestUnions(input, &visited, &unions);
+
+    std::vector<std::vector<PhysicalRequestUnionNode*>> groups;
+    for (auto union_op : unions) {
+        bool grouped = false;
+        for (auto& group : groups) {
+            if (SameScan(group[0], union_op)) {
+                group.push_back(union_op);
+                grouped = true;
+                break;
+            }
+        }
+        if (!grouped) {
+            groups.push_back({union_op});
+        }
+    }
+    for (auto& group : groups) {
+        if (group.size() < 2) {
+            continue;
+        }
+        PhysicalRequestUnionNode* largest = group[0];
+        for (auto union_op : group) {
+            if (CoverFrame(union_op, largest)) {
+                largest = union_op;
+            }
+        }
+        for (auto union_op : group) {
+            if (union_op != largest && CoverFrame(largest, union_op)) {
+                DLOG(INFO) << "Share the scan of window "
+                           << largest->window().name() << " with window "
+                           << union_op->window().name();
+                union_op->set_shared_scan(largest);
+            }
+        }
+    }
+    return Status::OK();
+}
+
+}  // namespace passes
+}  // namespace hybridse
@@ -0,0 +1,63 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <set>
+#include <vector>
+
+#include "passes/physical/physical_pass.h"
+#include "vm/physical_op.h"
+
+#ifndef HYBRIDSE_SRC_PASSES_PHYSICAL_WINDOW_SCAN_SHARING_H_
+#define HYBRIDSE_SRC_PASSES_PHYSICAL_WINDOW_SCAN_SHARING_H_
+
+namespace hybridse {
+namespace passes {
+
+using hybridse::base::Status;
+using hybridse::vm::PhysicalRequestUnionNode;
+
+/**
+ * Shares one storage scan among the request unions over the same partition
+ * key and order, e.g. the windows w_1h, w_1d and w_7d of a deployment.
+ *
+ * The request unions are grouped by their inputs, partition, order and
+ * frame end. In a group, the union whose frame covers all the others keeps
+ * its scan, the others are marked with PhysicalRequestUnionNode::shared_scan
+ * and take their window as a prefix of the covering window at runtime. The
+ * plan shape is not changed.
+ */
+class WindowScanSharing : public PhysicalPass {
+ public:
+    Status Apply(PhysicalPlanContext* ctx, PhysicalOpNode* input,
+                 PhysicalOpNode** out) override;
+
+    // whether the window of `large` contains the window of `small` as a
+    // prefix of its rows for any request
+    static bool CoverFrame(const PhysicalRequestUnionNode* large,
+                           const PhysicalRequestUnionNode* small);
+    // whether `lhs` and `rhs` scan the same segment in the same order
+    static bool SameScan(const PhysicalRequestUnionNode* lhs,
+                         const PhysicalRequestUnionNode* rhs);
+
+ private:
+    void CollectRequestUnions(PhysicalOpNode* input,
+                              std::set<PhysicalOpNode*>* visited,
+                              std::vector<PhysicalRequestUnionNode*>* unions);
+};
+
+}  // namespace passes
+}  // namespace hybridse
+#endif  // HYBRIDSE_SRC_PASSES_PHYSICAL_WINDOW_SCAN_SHARING_H_
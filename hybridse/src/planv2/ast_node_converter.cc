@@ -1661,6 +1661,8 @@ base::Status ConvertIndexOption(const zetasql::ASTOptionsEntry* entry, node::Nod
 //   ("partitionnum", int) -> PartitionNumNode(int)
 //   ("replicanum", int)   -> ReplicaNumNode(int)
 //   ("distribution", [ (string, [string] ) ] ) ->
+//   ("filter_policy", string) -> DiskTableOptionNode(name, string)
+//   ("filter_bits_per_key"|"block_size_kb", int) -> DiskTableOptionNode(name, string)
 base::Status ConvertTableOption(const zetasql::ASTOptionsEntry* entry, node::NodeManager* node_manager,
                                 node::SqlNode** output) {
     auto identifier = entry->name()->GetAsString();
@@ -1707,6 +1709,15 @@ base::Status ConvertTableOption(const zetasql::ASTOptionsEntry* entry, node::Nod
         CHECK_STATUS(AstStringLiteralToString(entry->value(), &storage_mode));
         boost::to_lower(storage_mode);
         *output = node_manager->MakeStorageModeNode(node::NameToStorageMode(storage_mode));
+    } else if (boost::equals("filter_policy", identifier)) {
+        std::string filter_policy;
+        CHECK_STATUS(AstStringLiteralToString(entry->value(), &filter_policy));
+        boost::to_lower(filter_policy);
+        *output = node_manager->MakeDiskTableOptionNode(identifier, filter_policy);
+    } else if (boost::equals("filter_bits_per_key", identifier) || boost::equals("block_size_kb", identifier)) {
+        int64_t value = 0;
+        CHECK_STATUS(ASTIntLiteralToNum(entry->value(), &value));
+        *output = node_manager->MakeDiskTableOptionNode(identifier, std::to_string(value));
     } else {
         return base::Status(common::kOk, "create table option ignored");
     }
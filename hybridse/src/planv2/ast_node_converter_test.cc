@@ -17,6 +17,7 @@
 #include "planv2/ast_node_converter.h"
 
 #include <ctime>
+#include <map>
 #include <memory>
 #include <random>
 #include <vector>
@@ -460,6 +461,32 @@ TEST_F(ASTNodeConverterTest, ConvertCreateTableNodeOkTest) {
             }
         }
     }
+    {
+        const std::string sql =
+            "create table t5 (a int32, b timestamp, index(key=a, ts=b)) options (storage_mode = 'ssd', "
+            "filter_policy = 'Ribbon', filter_bits_per_key = 16, block_size_kb = 8);";
+
+        std::unique_ptr<zetasql::ParserOutput> parser_output;
+        ZETASQL_ASSERT_OK(zetasql::ParseStatement(sql, zetasql::ParserOptions(), &parser_output));
+        const auto* statement = parser_output->statement();
+        ASSERT_TRUE(statement->Is<zetasql::ASTCreateTableStatement>());
+
+        const auto create_stmt = statement->GetAsOrDie<zetasql::ASTCreateTableStatement>();
+        node::CreateStmt* output = nullptr;
+        auto status = ConvertCreateTableNode(create_stmt, &node_manager, &output);
+        EXPECT_EQ(common::kOk, status.code) << status;
+        std::map<std::string, std::string> disk_options;
+        for (auto table_option : output->GetTableOptionList()) {
+            if (table_option->GetType() == node::kDiskTableOption) {
+                auto option = dynamic_cast<node::DiskTableOptionNode *>(table_option);
+                disk_options[option->GetName()] = option->GetValue();
+            }
+        }
+        ASSERT_EQ(3, disk_options.size());
+        ASSERT_EQ("ribbon", disk_options["filter_policy"]);
+        ASSERT_EQ("16", disk_options["filter_bits_per_key"]);
+        ASSERT_EQ("8", disk_options["block_size_kb"]);
+    }
     {
         // empty table element and option list
         const std::string sql = "create table t4;";
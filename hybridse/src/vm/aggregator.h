@@ -21,8 +21,11 @@
 #include <limits>
 #include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 #include <boost/algorithm/string/compare.hpp>
 
+#include "base/fe_pre_aggr.h"
 #include "codec/fe_row_codec.h"
 #include "codec/row.h"
 #include "proto/fe_type.pb.h"
@@ -366,6 +369,187 @@ class MaxAggregator : public Aggregator<T> {
     }
 };
 
+// the aggregator of which the aggr val is the encoded base::PreAggrState,
+// the keys are the values of a int16/int32/int64/string column encoded by base::PreAggrKeyOf
+class StateAggregator : public BaseAggregator {
+ public:
+    StateAggregator(type::Type type, const Schema& output_schema, base::PreAggrState* state)
+        : BaseAggregator(type, output_schema), state_(state) {}
+
+    void Update(const std::string& bval) override {
+        if (!state_->Merge(bval)) {
+            LOG(ERROR) << "ERROR: encoded aggr val is not valid";
+            return;
+        }
+        this->counter_++;
+    }
+
+    Row Output() override {
+        auto row = OutputInternal();
+        // reset the aggregator
+        Reset();
+        return row;
+    }
+
+    bool IsNull() const override {
+        return false;
+    }
+
+    void Reset() override {
+        BaseAggregator::Reset();
+        state_->Clear();
+    }
+
+ protected:
+    virtual Row OutputInternal() = 0;
+
+    // the keys of int columns are compared by value
+    bool KeyLess(const std::string& lhs, const std::string& rhs) const {
+        switch (type_) {
+            case type::kInt16:
+            case type::kInt32:
+            case type::kInt64:
+                return std::stoll(lhs) < std::stoll(rhs);
+            default:
+                return lhs < rhs;
+        }
+    }
+
+    Row OutputString(const std::string& val) {
+        uint32_t total_len = this->row_builder_.CalTotalLength(val.size());
+        int8_t* buf = static_cast<int8_t*>(malloc(total_len));
+        this->row_builder_.SetBuffer(buf, total_len);
+        this->row_builder_.AppendString(val.c_str(), val.size());
+        return Row(base::RefCountedSlice::CreateManaged(buf, total_len));
+    }
+
+    Row OutputInt64(int64_t val) {
+        uint32_t total_len = this->row_builder_.CalTotalLength(0);
+        int8_t* buf = static_cast<int8_t*>(malloc(total_len));
+        this->row_builder_.SetBuffer(buf, total_len);
+        this->row_builder_.AppendInt64(val);
+        return Row(base::RefCountedSlice::CreateManaged(buf, total_len));
+    }
+
+    std::unique_ptr<base::PreAggrState> state_;
+};
+
+// distinct_count approximated by HyperLogLog
+class DistinctCountAggregator : public StateAggregator {
+ public:
+    DistinctCountAggregator(type::Type type, const Schema& output_schema)
+        : StateAggregator(type, output_schema, new base::HyperLogLog()) {}
+
+    // key is assumed to be not null
+    void UpdateKey(const std::string& key) {
+        static_cast<base::HyperLogLog*>(state_.get())->Add(key);
+        this->counter_++;
+    }
+
+ protected:
+    Row OutputInternal() override {
+        return OutputInt64(static_cast<base::HyperLogLog*>(state_.get())->Estimate());
+    }
+};
+
+// fz_topn_frequency approximated by the frequency summary of the most frequent keys
+class TopNFrequencyAggregator : public StateAggregator {
+ public:
+    static constexpr int64_t kMaxTopN = 1024;
+
+    TopNFrequencyAggregator(type::Type type, const Schema& output_schema, int64_t top_n)
+        : StateAggregator(type, output_schema, new base::TopNSketch(base::TopNSketch::CapacityOf(top_n))),
+          top_n_(std::min(top_n, kMaxTopN)) {}
+
+    // key is assumed to be not null
+    void UpdateKey(const std::string& key) {
+        static_cast<base::TopNSketch*>(state_.get())->Add(key);
+        this->counter_++;
+    }
+
+ protected:
+    // the keys are ordered by frequency desc, then by key, and padded with NULL to top n
+    Row OutputInternal() override {
+        if (top_n_ <= 0) {
+            return OutputString("");
+        }
+        const auto& counts = static_cast<base::TopNSketch*>(state_.get())->counts();
+        std::vector<std::pair<std::string, int64_t>> entries(counts.begin(), counts.end());
+        auto cmp = [this](const std::pair<std::string, int64_t>& lhs, const std::pair<std::string, int64_t>& rhs) {
+            return lhs.second > rhs.second || (lhs.second == rhs.second && KeyLess(lhs.first, rhs.first));
+        };
+        size_t top_n = static_cast<size_t>(top_n_);
+        if (entries.size() > top_n) {
+            std::partial_sort(entries.begin(), entries.begin() + top_n, entries.end(), cmp);
+            entries.resize(top_n);
+        } else {
+            std::sort(entries.begin(), entries.end(), cmp);
+        }
+        std::string output;
+        for (size_t i = 0; i < top_n; i++) {
+            if (i > 0) {
+                output.append(",");
+            }
+            output.append(i < entries.size() ? entries[i].first : "NULL");
+        }
+        return OutputString(output);
+    }
+
+ private:
+    int64_t top_n_;
+};
+
+// count/sum/avg/min/max_cate, the output is `key:value` of each category ordered by key
+class CateAggregator : public StateAggregator {
+ public:
+    // type is the type of the category column
+    CateAggregator(type::Type type, const Schema& output_schema, base::PreAggrKind kind, type::Type value_type)
+        : StateAggregator(type, output_schema,
+                          new base::CateAggrState(kind, value_type == type::kFloat || value_type == type::kDouble)) {}
+
+    // key and val are assumed to be not null
+    template <class T>
+    void UpdateValue(const std::string& key, const T& val) {
+        auto state = static_cast<base::CateAggrState*>(state_.get());
+        if (state->is_float()) {
+            state->Update(key, static_cast<double>(val));
+        } else {
+            state->Update(key, static_cast<int64_t>(val));
+        }
+        this->counter_++;
+    }
+
+ protected:
+    Row OutputInternal() override {
+        auto state = static_cast<base::CateAggrState*>(state_.get());
+        std::vector<const std::pair<const std::string, base::CateAggrState::Value>*> entries;
+        for (const auto& entry : state->values()) {
+            entries.push_back(&entry);
+        }
+        std::sort(entries.begin(), entries.end(), [this](const auto* lhs, const auto* rhs) {
+            return KeyLess(lhs->first, rhs->first);
+        });
+        std::string output;
+        for (const auto* entry : entries) {
+            if (!output.empty()) {
+                output.append(",");
+            }
+            output.append(entry->first).append(":");
+            const auto& value = entry->second;
+            if (state->kind() == base::PreAggrKind::kCount) {
+                output.append(std::to_string(value.cnt));
+            } else if (state->kind() == base::PreAggrKind::kAvg) {
+                output.append(std::to_string(value.dval / value.cnt));
+            } else if (state->is_float()) {
+                output.append(std::to_string(value.dval));
+            } else {
+                output.append(std::to_string(value.lval));
+            }
+        }
+        return OutputString(output);
+    }
+};
+
 template <template<class> class AggregatorClass>
 std::unique_ptr<BaseAggregator> MakeOverflowAggregator(type::Type agg_col_type, const Schema& output_schema) {
     switch (agg_col_type) {
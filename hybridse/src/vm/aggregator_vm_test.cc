@@ -550,6 +550,63 @@ TEST_F(AggregatorVMTest, NullTest) {
     check_null(aggregator.get());
 }
 
+TEST_F(AggregatorVMTest, StateAggregatorTest) {
+    codec::Schema schema;
+    auto column = schema.Add();
+    column->set_type(type::kVarchar);
+    column->set_name("val");
+    codec::RowView row_view(schema);
+    Row row;
+    auto output_string = [&](BaseAggregator* aggregator) {
+        row = aggregator->Output();
+        row_view.Reset(row.buf());
+        return row_view.GetStringUnsafe(0);
+    };
+
+    // the keys of int columns are ordered by value
+    CateAggregator sum_cate(type::kInt32, schema, base::PreAggrKind::kSum, type::kInt64);
+    sum_cate.UpdateValue<int64_t>("10", 1);
+    sum_cate.UpdateValue<int64_t>("9", 2);
+    base::CateAggrState encoded_state(base::PreAggrKind::kSum, false);
+    encoded_state.Update("10", static_cast<int64_t>(3));
+    std::string encoded;
+    encoded_state.Encode(&encoded);
+    sum_cate.Update(encoded);
+    EXPECT_EQ("9:2,10:4", output_string(&sum_cate));
+    // output resets the aggregator
+    EXPECT_EQ("", output_string(&sum_cate));
+
+    CateAggregator avg_cate(type::kVarchar, schema, base::PreAggrKind::kAvg, type::kInt32);
+    avg_cate.UpdateValue<int32_t>("y", 1);
+    avg_cate.UpdateValue<int32_t>("x", 2);
+    avg_cate.UpdateValue<int32_t>("x", 3);
+    EXPECT_EQ("x:2.500000,y:1.000000", output_string(&avg_cate));
+
+    TopNFrequencyAggregator top_n(type::kVarchar, schema, 3);
+    for (auto key : {"b", "a", "b", "c", "c"}) {
+        top_n.UpdateKey(key);
+    }
+    EXPECT_EQ("b,c,a", output_string(&top_n));
+    top_n.UpdateKey("a");
+    EXPECT_EQ("a,NULL,NULL", output_string(&top_n));
+
+    schema.Mutable(0)->set_type(type::kInt64);
+    codec::RowView count_view(schema);
+    DistinctCountAggregator distinct_count(type::kInt32, schema);
+    base::HyperLogLog hll;
+    for (int64_t i = 0; i < 100; i++) {
+        distinct_count.UpdateKey(base::PreAggrKeyOf(i % 10));
+        hll.Add(base::PreAggrKeyOf(i % 20));
+    }
+    hll.Encode(&encoded);
+    distinct_count.Update(encoded);
+    row = distinct_count.Output();
+    count_view.Reset(row.buf());
+    int64_t cnt = 0;
+    count_view.GetInt64(0, &cnt);
+    EXPECT_EQ(20, cnt);
+}
+
 }  // namespace vm
 }  // namespace hybridse
 
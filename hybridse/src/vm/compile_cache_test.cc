@@ -0,0 +1,219 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "vm/compile_cache.h"
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+#include "gtest/gtest.h"
+
+namespace hybridse {
+namespace vm {
+
+class CompileCacheTest : public ::testing::Test {};
+
+using IntCache = ShardedCompileCache<int>;
+
+static IntCache::Compiler ReturnValue(int value, std::atomic<int>* cnt = nullptr) {
+    return [value, cnt](base::Status* status) {
+        if (cnt != nullptr) {
+            cnt->fetch_add(1);
+        }
+        return std::make_shared<int>(value);
+    };
+}
+
+TEST_F(CompileCacheTest, LRUTest) {
+    IntCache cache(2, 0, nullptr, 1);
+    base::Status status;
+    ASSERT_EQ(1, *cache.GetOrCompile("db", kBatchMode, "sql1", ReturnValue(1), &status));
+    ASSERT_EQ(2, *cache.GetOrCompile("db", kBatchMode, "sql2", ReturnValue(2), &status));
+    // the keys differ by mode and db
+    ASSERT_EQ(nullptr, cache.Get("db", kRequestMode, "sql1"));
+    ASSERT_EQ(nullptr, cache.Get("db2", kBatchMode, "sql1"));
+    // sql1 is used recently, so sql2 is evicted
+    ASSERT_EQ(1, *cache.Get("db", kBatchMode, "sql1"));
+    ASSERT_EQ(3, *cache.GetOrCompile("db", kBatchMode, "sql3", ReturnValue(3), &status));
+    ASSERT_EQ(nullptr, cache.Get("db", kBatchMode, "sql2"));
+    ASSERT_EQ(1, *cache.Get("db", kBatchMode, "sql1"));
+
+    cache.Put("db", kBatchMode, "sql1", std::make_shared<int>(10));
+    ASSERT_EQ(10, *cache.Get("db", kBatchMode, "sql1"));
+
+    auto stats = cache.GetStats();
+    ASSERT_EQ(2u, stats.entries);
+    ASSERT_EQ(1u, stats.evictions);
+    ASSERT_EQ(3u, stats.compiles);
+    ASSERT_EQ(3u, stats.hits);
+    ASSERT_EQ(6u, stats.misses);
+}
+
+TEST_F(CompileCacheTest, WeightTest) {
+    IntCache cache(100, 10, [](const std::shared_ptr<int>& value) { return static_cast<uint64_t>(*value); }, 1);
+    cache.Put("db", kBatchMode, "sql1", std::make_shared<int>(4));
+    cache.Put("db", kBatchMode, "sql2", std::make_shared<int>(4));
+    ASSERT_EQ(8u, cache.GetStats().weight);
+    cache.Put("db", kBatchMode, "sql3", std::make_shared<int>(4));
+    ASSERT_EQ(nullptr, cache.Get("db", kBatchMode, "sql1"));
+    ASSERT_EQ(8u, cache.GetStats().weight);
+    // the entry heavier than the limit is kept alone
+    cache.Put("db", kBatchMode, "sql4", std::make_shared<int>(20));
+    ASSERT_EQ(20, *cache.Get("db", kBatchMode, "sql4"));
+    ASSERT_EQ(1u, cache.GetStats().entries);
+}
+
+TEST_F(CompileCacheTest, ClearTest) {
+    IntCache cache(1000, 0);
+    ASSERT_EQ(16u, cache.GetShardNum());
+    for (int i = 0; i < 20; ++i) {
+        cache.Put("db1", kBatchMode, "sql" + std::to_string(i), std::make_shared<int>(i));
+        cache.Put("db2", kBatchMode, "sql" + std::to_string(i), std::make_shared<int>(i));
+    }
+    ASSERT_EQ(40u, cache.GetStats().entries);
+    cache.Clear("db1");
+    ASSERT_EQ(20u, cache.GetStats().entries);
+    ASSERT_EQ(nullptr, cache.Get("db1", kBatchMode, "sql1"));
+    ASSERT_EQ(1, *cache.Get("db2", kBatchMode, "sql1"));
+    cache.Clear("");
+    ASSERT_EQ(0u, cache.GetStats().entries);
+}
+
+TEST_F(CompileCacheTest, CompileFailTest) {
+    IntCache cache(10, 0);
+    base::Status status;
+    auto value = cache.GetOrCompile(
+        "db", kBatchMode, "sql",
+        [](base::Status* status) {
+            *status = base::Status(common::kPlanError, "fail");
+            return nullptr;
+        },
+        &status);
+    ASSERT_EQ(nullptr, value);
+    ASSERT_EQ(common::kPlanError, status.code);
+    ASSERT_EQ(1u, cache.GetStats().compile_failures);
+    ASSERT_EQ(0u, cache.GetStats().entries);
+}
+
+TEST_F(CompileCacheTest, SingleFlightTest) {
+    IntCache cache(10, 0);
+    std::atomic<int> compile_cnt(0);
+    std::atomic<bool> started(false);
+    std::atomic<bool> release(false);
+    auto slow_compile = [&](base::Status* status) {
+        compile_cnt.fetch_add(1);
+        started.store(true);
+        while (!release.load()) {
+            std::this_thread::yield();
+        }
+        return std::make_shared<int>(42);
+    };
+    std::vector<std::thread> threads;
+    std::vector<std::shared_ptr<int>> values(8);
+    threads.emplace_back([&] {
+        base::Status status;
+        values[0] = cache.GetOrCompile("db", kBatchMode, "sql", slow_compile, &status);
+    });
+    while (!started.load()) {
+        std::this_thread::yield();
+    }
+    for (size_t i = 1; i < values.size(); ++i) {
+        threads.emplace_back([&, i] {
+            base::Status status;
+            values[i] = cache.GetOrCompile("db", kBatchMode, "sql", slow_compile, &status);
+        });
+    }
+    release.store(true);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    ASSERT_EQ(1, compile_cnt.load());
+    for (auto& value : values) {
+        ASSERT_EQ(values[0].get(), value.get());
+    }
+    ASSERT_EQ(1u, cache.GetStats().compiles);
+}
+
+TEST_F(CompileCacheTest, CompileThrowTest) {
+    IntCache cache(10, 0);
+    std::atomic<bool> started(false);
+    std::atomic<bool> release(false);
+    std::thread leader([&] {
+        base::Status status;
+        ASSERT_THROW(cache.GetOrCompile(
+                         "db", kBatchMode, "sql",
+                         [&](base::Status* status) -> std::shared_ptr<int> {
+                             started.store(true);
+                             while (!release.load()) {
+                                 std::this_thread::yield();
+                             }
+                             throw std::runtime_error("compile error");
+                         },
+                         &status),
+                     std::runtime_error);
+    });
+    while (!started.load()) {
+        std::this_thread::yield();
+    }
+    // the waiter gets the failure instead of waiting forever
+    base::Status waiter_status;
+    std::shared_ptr<int> waiter_value = std::make_shared<int>(0);
+    std::thread waiter([&] {
+        waiter_value = cache.GetOrCompile(
+            "db", kBatchMode, "sql", [](base::Status* status) { return std::make_shared<int>(1); },
+            &waiter_status);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    release.store(true);
+    leader.join();
+    waiter.join();
+    ASSERT_EQ(nullptr, waiter_value);
+    ASSERT_EQ(common::kEngineCacheError, waiter_status.code);
+    ASSERT_EQ(1u, cache.GetStats().compile_failures);
+
+    // the key is compiled again by the next caller
+    base::Status status;
+    auto value = cache.GetOrCompile(
+        "db", kBatchMode, "sql", [](base::Status* status) { return std::make_shared<int>(2); }, &status);
+    ASSERT_EQ(2, *value);
+    ASSERT_EQ(2, *cache.Get("db", kBatchMode, "sql"));
+}
+
+TEST_F(CompileCacheTest, ClearDuringCompileTest) {
+    IntCache cache(10, 0);
+    base::Status status;
+    // the value compiled before the clear is returned but not cached
+    auto value = cache.GetOrCompile(
+        "db", kBatchMode, "sql",
+        [&cache](base::Status* status) {
+            cache.Clear("db");
+            return std::make_shared<int>(1);
+        },
+        &status);
+    ASSERT_EQ(1, *value);
+    ASSERT_EQ(nullptr, cache.Get("db", kBatchMode, "sql"));
+}
+
+}  // namespace vm
+}  // namespace hybridse
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
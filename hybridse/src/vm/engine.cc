@@ -15,6 +15,7 @@
  */
 
 #include "vm/engine.h"
+#include <algorithm>
 #include <string>
 #include <utility>
 #include <vector>
@@ -50,13 +51,33 @@ EngineOptions::EngineOptions()
       enable_expr_optimize_(true),
       enable_batch_window_parallelization_(false),
       enable_window_column_pruning_(false),
-      max_sql_cache_size_(50) {
+      enable_window_scan_sharing_(false),
+      enable_tiered_jit_(false),
+      jit_tier_up_threshold_(100),
+      max_sql_cache_size_(500),
+      max_sql_cache_memory_(0) {
 }
 
-Engine::Engine(const std::shared_ptr<Catalog>& catalog) : cl_(catalog), options_(), mu_(), lru_cache_() {}
+static uint64_t WeighCompileInfo(const std::shared_ptr<CompileInfo>& info) { return info->GetMemoryUsage(); }
+
+Engine::Engine(const std::shared_ptr<Catalog>& catalog)
+    : cl_(catalog),
+      options_(),
+      compile_cache_(options_.GetMaxSqlCacheSize(), options_.GetMaxSqlCacheMemory(), WeighCompileInfo) {}
 Engine::Engine(const std::shared_ptr<Catalog>& catalog, const EngineOptions& options)
-    : cl_(catalog), options_(options), mu_(), lru_cache_() {}
-Engine::~Engine() {}
+    : cl_(catalog),
+      options_(options),
+      compile_cache_(options_.GetMaxSqlCacheSize(), options_.GetMaxSqlCacheMemory(), WeighCompileInfo) {}
+Engine::~Engine() {
+    {
+        std::lock_guard<std::mutex> lock(tier_up_mu_);
+        tier_up_stopped_ = true;
+    }
+    tier_up_cv_.notify_all();
+    if (tier_up_thread_.joinable()) {
+        tier_up_thread_.join();
+    }
+}
 void Engine::InitializeGlobalLLVM() {
     if (LLVM_IS_INITIALIZED) return;
     LLVMInitializeNativeTarget();
@@ -204,20 +225,54 @@ bool Engine::IsCompatibleCache(RunSession& session,  // NOLINT
 
 bool Engine::Get(const std::string& sql, const std::string& db, RunSession& session,
                  base::Status& status) {  // NOLINT (runtime/references)
-    std::shared_ptr<CompileInfo> cached_info = GetCacheLocked(db, sql, session.engine_mode());
-    if (cached_info && IsCompatibleCache(session, cached_info, status)) {
-        session.SetCompileInfo(cached_info);
-        return true;
+    bool compiled = false;
+    auto info = compile_cache_.GetOrCompile(
+        db, session.engine_mode(), sql,
+        [&](base::Status* compile_status) {
+            compiled = true;
+            return Compile(sql, db, session, *compile_status);
+        },
+        &status);
+    if (!info) {
+        return false;
     }
-    // TODO(baoxinqi): IsCompatibleCache fail, return false, or reset status.
-    if (!status.isOK()) {
+    if (!compiled && !IsCompatibleCache(session, info, status)) {
+        // TODO(baoxinqi): IsCompatibleCache fail, return false, or reset status.
         LOG(WARNING) << status;
         status = base::Status::OK();
+        info = Compile(sql, db, session, status);
+        if (!info) {
+            return false;
+        }
+        if (session.engine_mode() == kBatchRequestMode) {
+            compile_cache_.Put(db, session.engine_mode(), sql, info);
+        }
+        compiled = true;
+    }
+    if (!compiled) {
+        session.SetCompileInfo(GetTieredCompileInfo(info));
+        return true;
+    }
+    session.SetCompileInfo(info);
+    if (session.is_debug_) {
+        auto& sql_context = std::dynamic_pointer_cast<SqlCompileInfo>(info)->get_sql_context();
+        std::ostringstream plan_oss;
+        if (nullptr != sql_context.physical_plan) {
+            sql_context.physical_plan->Print(plan_oss, "");
+            LOG(INFO) << "physical plan:\n" << plan_oss.str() << std::endl;
+        }
+        std::ostringstream runner_oss;
+        sql_context.cluster_job.Print(runner_oss, "");
+        LOG(INFO) << "cluster job:\n" << runner_oss.str() << std::endl;
     }
+    return true;
+}
+
+std::shared_ptr<CompileInfo> Engine::Compile(const std::string& sql, const std::string& db, RunSession& session,
+                                             base::Status& status) {  // NOLINT (runtime/references)
     DLOG(INFO) << "Compile Engine ...";
-    status = base::Status::OK();
     std::shared_ptr<SqlCompileInfo> info = std::make_shared<SqlCompileInfo>();
-    auto& sql_context = std::dynamic_pointer_cast<SqlCompileInfo>(info)->get_sql_context();
+    auto& sql_context = info->get_sql_context();
     sql_context.sql = sql;
     sql_context.db = db;
     sql_context.engine_mode = session.engine_mode();
@@ -225,8 +280,13 @@ bool Engine::Get(const std::string& sql, const std::string& db, RunSession& sess
     sql_context.is_batch_request_optimized = options_.IsBatchRequestOptimized();
     sql_context.enable_batch_window_parallelization = options_.IsEnableBatchWindowParallelization();
     sql_context.enable_window_column_pruning = options_.IsEnableWindowColumnPruning();
+    sql_context.enable_window_scan_sharing = options_.IsEnableWindowScanSharing();
     sql_context.enable_expr_optimize = options_.IsEnableExprOptimize();
     sql_context.jit_options = options_.jit_options();
+    if (options_.IsEnableTieredJit() && !options_.IsCompileOnly() && !options_.IsPlanOnly()) {
+        // the sql may run only once, compile it fast and tier up if it turns hot
+        sql_context.jit_options.SetOptLevel(kJitOptFast);
+    }
     sql_context.options = session.GetOptions();
     if (session.engine_mode() == kBatchMode) {
         sql_context.parameter_types = dynamic_cast<BatchRunSession*>(&session)->GetParameterSchema();
@@ -237,31 +297,18 @@ bool Engine::Get(const std::string& sql, const std::string& db, RunSession& sess
 
     SqlCompiler compiler(std::atomic_load_explicit(&cl_, std::memory_order_acquire), options_.IsKeepIr(), false,
                          options_.IsPlanOnly());
-    bool ok = compiler.Compile(info->get_sql_context(), status);
+    bool ok = compiler.Compile(sql_context, status);
     if (!ok || 0 != status.code) {
-        return false;
+        return nullptr;
     }
     if (!options_.IsCompileOnly()) {
-        ok = compiler.BuildClusterJob(info->get_sql_context(), status);
+        ok = compiler.BuildClusterJob(sql_context, status);
         if (!ok || 0 != status.code) {
             LOG(WARNING) << "fail to build cluster job: " << status.msg;
-            return false;
+            return nullptr;
         }
     }
-
-    SetCacheLocked(db, sql, session.engine_mode(), info);
-    session.SetCompileInfo(info);
-    if (session.is_debug_) {
-        std::ostringstream plan_oss;
-        if (nullptr != sql_context.physical_plan) {
-            sql_context.physical_plan->Print(plan_oss, "");
-            LOG(INFO) << "physical plan:\n" << plan_oss.str() << std::endl;
-        }
-        std::ostringstream runner_oss;
-        sql_context.cluster_job.Print(runner_oss, "");
-        LOG(INFO) << "cluster job:\n" << runner_oss.str() << std::endl;
-    }
-    return true;
+    return info;
 }
 
 base::Status Engine::RegisterExternalFunction(const std::string& name, node::DataType return_type,
@@ -369,66 +416,74 @@ bool Engine::Explain(const std::string& sql, const std::string& db, EngineMode e
 }
 
 void Engine::ClearCacheLocked(const std::string& db) {
-    std::lock_guard<base::SpinMutex> lock(mu_);
-    if (db.empty()) {
-        lru_cache_.clear();
-        return;
-    }
-    for (auto& cache : lru_cache_) {
-        auto& mode_cache = cache.second;
-        mode_cache.erase(db);
-    }
+    compile_cache_.Clear(db);
 }
 
 EngineOptions Engine::GetEngineOptions() {
     return options_;
 }
 
-std::shared_ptr<CompileInfo> Engine::GetCacheLocked(const std::string& db, const std::string& sql,
-                                                    EngineMode engine_mode) {
-    std::lock_guard<base::SpinMutex> lock(mu_);
-    // Check mode
-    auto mode_iter = lru_cache_.find(engine_mode);
-    if (mode_iter == lru_cache_.end()) {
-        return nullptr;
-    }
-    auto& mode_cache = mode_iter->second;
-    // Check db
-    auto db_iter = mode_cache.find(db);
-    if (db_iter == mode_cache.end()) {
-        return nullptr;
+std::shared_ptr<CompileInfo> Engine::GetTieredCompileInfo(const std::shared_ptr<CompileInfo>& info) {
+    auto sql_info = std::dynamic_pointer_cast<SqlCompileInfo>(info);
+    if (!options_.IsEnableTieredJit() || !sql_info ||
+        kJitOptFast != sql_info->get_sql_context().jit_options.GetOptLevel()) {
+        return info;
+    }
+    auto optimized_info = sql_info->GetOptimizedInfo();
+    if (optimized_info) {
+        return optimized_info;
+    }
+    // schedule the recompiling only once, when the hits reach the threshold or the backoff of a failed one
+    uint64_t threshold = std::max<uint64_t>(options_.GetJitTierUpThreshold(), 1);
+    if (sql_info->IncreaseHits() == sql_info->GetTierUpHits(threshold)) {
+        std::lock_guard<std::mutex> lock(tier_up_mu_);
+        if (!tier_up_stopped_) {
+            tier_up_queue_.push_back(info);
+            if (!tier_up_thread_.joinable()) {
+                tier_up_thread_ = std::thread(&Engine::TierUpLoop, this);
+            }
+            tier_up_cv_.notify_one();
+        }
     }
-    auto& lru = db_iter->second;
+    return info;
+}
 
-    // Check SQL
-    auto value = lru.get(sql);
-    if (value == boost::none) {
-        return nullptr;
-    } else {
-        return value.value();
+void Engine::TierUpLoop() {
+    while (true) {
+        std::shared_ptr<CompileInfo> info;
+        {
+            std::unique_lock<std::mutex> lock(tier_up_mu_);
+            tier_up_cv_.wait(lock, [this] { return tier_up_stopped_ || !tier_up_queue_.empty(); });
+            if (tier_up_stopped_) {
+                return;
+            }
+            info = tier_up_queue_.front();
+            tier_up_queue_.pop_front();
+        }
+        TierUp(info);
     }
 }
 
-bool Engine::SetCacheLocked(const std::string& db, const std::string& sql, EngineMode engine_mode,
-                            std::shared_ptr<CompileInfo> info) {
-    std::lock_guard<base::SpinMutex> lock(mu_);
+bool Engine::TierUp(const std::shared_ptr<CompileInfo>& info) {
+    auto sql_info = std::dynamic_pointer_cast<SqlCompileInfo>(info);
+    auto& ctx = sql_info->get_sql_context();
+    auto optimized_info = std::make_shared<SqlCompileInfo>();
+    auto& optimized_ctx = optimized_info->get_sql_context();
+    static_cast<SqlCompileInput&>(optimized_ctx) = ctx;
+    optimized_ctx.jit_options.SetOptLevel(kJitOptAggressive);
 
-    auto& mode_cache = lru_cache_[engine_mode];
-    using BoostLRU = boost::compute::detail::lru_cache<std::string, std::shared_ptr<CompileInfo>>;
-    std::map<std::string, BoostLRU>::iterator db_iter = mode_cache.find(db);
-    if (db_iter == mode_cache.end()) {
-        db_iter = mode_cache.insert(db_iter, {db, BoostLRU(options_.GetMaxSqlCacheSize())});
-    }
-    auto& lru = db_iter->second;
-    auto value = lru.get(sql);
-    if (value == boost::none || engine_mode == kBatchRequestMode) {
-        lru.insert(sql, info);
-        return true;
-    } else {
-        // TODO(xxx): Ensure compile result is stable
-        DLOG(INFO) << "Engine cache already exists: " << engine_mode << " " << db << "\n" << sql;
+    base::Status status;
+    SqlCompiler compiler(std::atomic_load_explicit(&cl_, std::memory_order_acquire), options_.IsKeepIr(), false,
+                         false);
+    if (!compiler.Compile(optimized_ctx, status) || !compiler.BuildClusterJob(optimized_ctx, status)) {
+        LOG(WARNING) << "fail to tier up sql, retry it later: " << status << "\n" << ctx.sql;
+        sql_info->BackOffTierUp(std::max<uint64_t>(options_.GetJitTierUpThreshold(), 1));
         return false;
     }
+    // the runs in progress keep the fast compiled result alive, the new runs switch to the optimized one
+    sql_info->SetOptimizedInfo(optimized_info);
+    DLOG(INFO) << "tier up sql:\n" << ctx.sql;
+    return true;
 }
 
 RunSession::RunSession(EngineMode engine_mode) : engine_mode_(engine_mode), is_debug_(false), sp_name_("") {}
@@ -500,6 +555,7 @@ int32_t BatchRunSession::Run(std::vector<Row>& rows, uint64_t limit) {
 int32_t BatchRunSession::Run(const Row& parameter_row, std::vector<Row>& rows, uint64_t limit) {
     auto& sql_ctx = std::dynamic_pointer_cast<SqlCompileInfo>(compile_info_)->get_sql_context();
     RunnerContext ctx(&sql_ctx.cluster_job, parameter_row, is_debug_);
+    ctx.SetParallelism(parallelism_);
     auto output = sql_ctx.cluster_job.GetTask(0).GetRoot()->RunWithCache(ctx);
     if (!output) {
         DLOG(INFO) << "Run batch plan output is empty";
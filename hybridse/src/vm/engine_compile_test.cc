@@ -14,11 +14,15 @@
  * limitations under the License.
  */
 
+#include <chrono>  // NOLINT
+#include <thread>  // NOLINT
+
 #include "case/case_data_mock.h"
 #include "gtest/gtest.h"
 #include "gtest/internal/gtest-param-util.h"
 #include "testing/engine_test_base.h"
 #include "udf/openmldb_udf.h"
+#include "vm/sql_compiler.h"
 
 using namespace llvm;       // NOLINT (build/namespaces)
 using namespace llvm::orc;  // NOLINT (build/namespaces)
@@ -630,6 +634,73 @@ void cut2(UDFContext* ctx, ::openmldb::base::StringRef* input, ::openmldb::base:
     *is_null = false;
 }
 
+TEST_F(EngineCompileTest, EngineTieredJitTest) {
+    // Build Simple Catalog
+    auto catalog = BuildSimpleCatalog();
+    hybridse::type::Database db;
+    db.set_name("simple_db");
+    hybridse::type::TableDef table_def;
+    sqlcase::CaseSchemaMock::BuildTableDef(table_def);
+    table_def.set_name("t1");
+    AddTable(db, table_def);
+    catalog->AddDatabase(db);
+
+    EngineOptions options;
+    options.SetEnableTieredJit(true);
+    options.SetJitTierUpThreshold(2);
+    Engine engine(catalog, options);
+    std::string sql = "select col1, col2 + 1, col5 * 2.0 from t1;";
+    base::Status get_status;
+
+    BatchRunSession session1;
+    ASSERT_TRUE(engine.Get(sql, "simple_db", session1, get_status)) << get_status;
+    auto fast_info = std::dynamic_pointer_cast<SqlCompileInfo>(session1.GetCompileInfo());
+    ASSERT_EQ(kJitOptFast, fast_info->get_sql_context().jit_options.GetOptLevel());
+
+    // the second hit reaches the threshold and starts the recompiling
+    for (int i = 0; i < 2; ++i) {
+        BatchRunSession session;
+        ASSERT_TRUE(engine.Get(sql, "simple_db", session, get_status)) << get_status;
+        ASSERT_EQ(fast_info.get(), session.GetCompileInfo().get());
+    }
+    std::shared_ptr<CompileInfo> optimized_info = nullptr;
+    for (int i = 0; i < 600 && !optimized_info; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        optimized_info = fast_info->GetOptimizedInfo();
+    }
+    ASSERT_TRUE(optimized_info != nullptr);
+    ASSERT_EQ(kJitOptAggressive,
+              std::dynamic_pointer_cast<SqlCompileInfo>(optimized_info)->get_sql_context().jit_options.GetOptLevel());
+
+    BatchRunSession session2;
+    ASSERT_TRUE(engine.Get(sql, "simple_db", session2, get_status)) << get_status;
+    ASSERT_EQ(optimized_info.get(), session2.GetCompileInfo().get());
+    std::vector<Row> output;
+    ASSERT_EQ(0, session2.Run(output));
+    // the session compiled before the switch still runs the fast result
+    ASSERT_EQ(0, session1.Run(output));
+}
+
+TEST_F(EngineCompileTest, TierUpBackOffTest) {
+    SqlCompileInfo info;
+    ASSERT_EQ(2u, info.GetTierUpHits(2));
+    ASSERT_EQ(1u, info.IncreaseHits());
+    ASSERT_EQ(2u, info.IncreaseHits());
+    // the first failure retries after 4 more hits, the next after 8 more
+    info.BackOffTierUp(2);
+    ASSERT_EQ(6u, info.GetTierUpHits(2));
+    for (int i = 0; i < 4; ++i) {
+        info.IncreaseHits();
+    }
+    info.BackOffTierUp(2);
+    ASSERT_EQ(14u, info.GetTierUpHits(2));
+    // the backoff is bounded
+    for (int i = 0; i < 20; ++i) {
+        info.BackOffTierUp(2);
+    }
+    ASSERT_EQ(6u + (2u << 10), info.GetTierUpHits(2));
+}
+
 TEST_F(EngineCompileTest, ExternalFunctionTest) {
     // Build Simple Catalog
     auto catalog = BuildSimpleCatalog();
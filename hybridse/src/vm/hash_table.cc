@@ -0,0 +1,291 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "vm/hash_table.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <utility>
+#include "base/fe_hash.h"
+#include "glog/logging.h"
+#include "vm/mem_catalog.h"
+
+namespace hybridse {
+namespace vm {
+
+static constexpr uint32_t kHashSeed = 0xe17a1465;
+
+KeyIndexTable::KeyIndexTable(size_t expect_size) : slots_(), mask_(0), keys_(), pool_() {
+    size_t capacity = 16;
+    // keep the load factor under 0.5
+    while (capacity < expect_size * 2) {
+        capacity <<= 1;
+    }
+    slots_.resize(capacity, Slot{0, kNotFound});
+    mask_ = capacity - 1;
+}
+
+uint64_t KeyIndexTable::Hash(const base::Slice& key) {
+    return base::MurmurHash64A(key.data(), key.size(), kHashSeed);
+}
+
+uint32_t KeyIndexTable::FindSlot(const base::Slice& key, uint64_t hash) const {
+    size_t pos = hash & mask_;
+    while (true) {
+        const Slot& slot = slots_[pos];
+        if (kNotFound == slot.idx || (slot.hash == hash && keys_[slot.idx] == key)) {
+            return pos;
+        }
+        pos = (pos + 1) & mask_;
+    }
+}
+
+uint32_t KeyIndexTable::Find(const base::Slice& key) const {
+    return slots_[FindSlot(key, Hash(key))].idx;
+}
+
+uint32_t KeyIndexTable::FindOrInsert(const base::Slice& key, bool* inserted) {
+    uint64_t hash = Hash(key);
+    Slot& slot = slots_[FindSlot(key, hash)];
+    if (kNotFound != slot.idx) {
+        *inserted = false;
+        return slot.idx;
+    }
+    char* buf = pool_.Alloc(key.size());
+    memcpy(buf, key.data(), key.size());
+    slot.hash = hash;
+    slot.idx = keys_.size();
+    keys_.emplace_back(buf, key.size());
+    *inserted = true;
+    uint32_t idx = slot.idx;
+    if (keys_.size() * 2 > slots_.size()) {
+        Grow();
+    }
+    return idx;
+}
+
+void KeyIndexTable::Grow() {
+    std::vector<Slot> old_slots;
+    old_slots.swap(slots_);
+    slots_.resize(old_slots.size() * 2, Slot{0, kNotFound});
+    mask_ = slots_.size() - 1;
+    for (auto& slot : old_slots) {
+        if (kNotFound == slot.idx) {
+            continue;
+        }
+        size_t pos = slot.hash & mask_;
+        while (kNotFound != slots_[pos].idx) {
+            pos = (pos + 1) & mask_;
+        }
+        slots_[pos] = slot;
+    }
+}
+
+void KeyIndexTable::Clear() {
+    std::fill(slots_.begin(), slots_.end(), Slot{0, kNotFound});
+    keys_.clear();
+    pool_.Reset();
+}
+
+HashJoinBuildTable::HashJoinBuildTable(uint64_t memory_limit,
+                                       const std::string& spill_dir,
+                                       OrderType order_type,
+                                       uint32_t partition_num)
+    : memory_limit_(memory_limit),
+      spill_dir_(spill_dir),
+      order_type_(order_type),
+      partition_num_(std::max<uint32_t>(partition_num, 1)),
+      memory_usage_(0),
+      index_(),
+      segments_(),
+      spill_files_() {}
+
+HashJoinBuildTable::~HashJoinBuildTable() {
+    for (auto file : spill_files_) {
+        fclose(file);
+    }
+}
+
+uint64_t HashJoinBuildTable::EstimateSize(const Row& row, bool owned) {
+    uint64_t size = sizeof(std::pair<uint64_t, Row>);
+    for (int32_t i = 0; owned && i < row.GetRowPtrCnt(); ++i) {
+        size += row.size(i);
+    }
+    return size;
+}
+
+void HashJoinBuildTable::AddInMemory(const base::Slice& key, uint64_t ts,
+                                     const Row& row, bool owned) {
+    bool inserted = false;
+    uint32_t idx = index_.FindOrInsert(key, &inserted);
+    if (inserted) {
+        auto segment = std::make_shared<MemTimeTableHandler>();
+        segment->SetOrderType(order_type_);
+        segments_.push_back(segment);
+        // the key copied into the arena and the segment of it
+        memory_usage_ += key.size() + sizeof(MemTimeTableHandler);
+    }
+    std::static_pointer_cast<MemTimeTableHandler>(segments_[idx])
+        ->AddRow(ts, row);
+    memory_usage_ += EstimateSize(row, owned);
+}
+
+void HashJoinBuildTable::ClearInMemory() {
+    index_.Clear();
+    segments_.clear();
+    memory_usage_ = 0;
+}
+
+bool HashJoinBuildTable::Add(const std::string& key, uint64_t ts,
+                             const Row& row) {
+    base::Slice key_slice(key);
+    if (IsSpilled()) {
+        return WriteRow(spill_files_[GetPartition(key_slice)], key_slice, ts,
+                        row);
+    }
+    AddInMemory(key_slice, ts, row, false);
+    if (memory_usage_ > memory_limit_) {
+        return Spill();
+    }
+    return true;
+}
+
+bool HashJoinBuildTable::Spill() {
+    LOG(INFO) << "Spill the build side of hash join to " << spill_dir_
+              << ", memory usage " << memory_usage_ << " exceeds "
+              << memory_limit_;
+    for (uint32_t i = 0; i < partition_num_; ++i) {
+        std::string path = spill_dir_ + "/hybridse_hash_join_XXXXXX";
+        int fd = mkstemp(&path[0]);
+        if (fd < 0) {
+            PLOG(WARNING) << "fail to create spill file under " << spill_dir_;
+            return false;
+        }
+        unlink(path.c_str());
+        FILE* file = fdopen(fd, "w+b");
+        if (nullptr == file) {
+            PLOG(WARNING) << "fail to open spill file under " << spill_dir_;
+            close(fd);
+            return false;
+        }
+        spill_files_.push_back(file);
+    }
+    for (uint32_t idx = 0; idx < segments_.size(); ++idx) {
+        const base::Slice& key = index_.GetKey(idx);
+        FILE* file = spill_files_[GetPartition(key)];
+        auto iter = segments_[idx]->GetIterator();
+        iter->SeekToFirst();
+        while (iter->Valid()) {
+            if (!WriteRow(file, key, iter->GetKey(), iter->GetValue())) {
+                return false;
+            }
+            iter->Next();
+        }
+    }
+    ClearInMemory();
+    return true;
+}
+
+bool HashJoinBuildTable::LoadPartition(uint32_t partition) {
+    if (!IsSpilled()) {
+        return true;
+    }
+    ClearInMemory();
+    FILE* file = spill_files_[partition];
+    if (0 != fflush(file) || 0 != fseek(file, 0, SEEK_SET)) {
+        PLOG(WARNING) << "fail to rewind spill file of partition " << partition;
+        return false;
+    }
+    std::string key;
+    uint64_t ts = 0;
+    Row row;
+    while (ReadRow(file, &key, &ts, &row)) {
+        AddInMemory(base::Slice(key), ts, row, true);
+    }
+    if (ferror(file)) {
+        PLOG(WARNING) << "fail to read spill file of partition " << partition;
+        return false;
+    }
+    if (memory_usage_ > memory_limit_) {
+        LOG(WARNING) << "partition " << partition << " of hash join uses "
+                     << memory_usage_ << " bytes beyond the memory limit "
+                     << memory_limit_;
+    }
+    return true;
+}
+
+// the row is written as
+// | key size | key | ts | slice cnt | slice size | slice | ... |
+bool HashJoinBuildTable::WriteRow(FILE* file, const base::Slice& key,
+                                  uint64_t ts, const Row& row) {
+    uint32_t key_size = key.size();
+    uint32_t slice_cnt = row.GetRowPtrCnt();
+    if (1 != fwrite(&key_size, sizeof(key_size), 1, file) ||
+        key_size != fwrite(key.data(), 1, key_size, file) ||
+        1 != fwrite(&ts, sizeof(ts), 1, file) ||
+        1 != fwrite(&slice_cnt, sizeof(slice_cnt), 1, file)) {
+        PLOG(WARNING) << "fail to write spill file";
+        return false;
+    }
+    for (uint32_t i = 0; i < slice_cnt; ++i) {
+        uint32_t size = row.size(i);
+        if (1 != fwrite(&size, sizeof(size), 1, file) ||
+            size != fwrite(row.buf(i), 1, size, file)) {
+            PLOG(WARNING) << "fail to write spill file";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool HashJoinBuildTable::ReadRow(FILE* file, std::string* key, uint64_t* ts,
+                                 Row* row) {
+    uint32_t key_size = 0;
+    if (1 != fread(&key_size, sizeof(key_size), 1, file)) {
+        return false;
+    }
+    key->resize(key_size);
+    uint32_t slice_cnt = 0;
+    if (key_size != fread(&(*key)[0], 1, key_size, file) ||
+        1 != fread(ts, sizeof(uint64_t), 1, file) ||
+        1 != fread(&slice_cnt, sizeof(slice_cnt), 1, file)) {
+        return false;
+    }
+    for (uint32_t i = 0; i < slice_cnt; ++i) {
+        uint32_t size = 0;
+        if (1 != fread(&size, sizeof(size), 1, file)) {
+            return false;
+        }
+        base::RefCountedSlice slice;
+        if (size > 0) {
+            int8_t* buf = reinterpret_cast<int8_t*>(malloc(size));
+            slice = base::RefCountedSlice::CreateManaged(buf, size);
+            if (size != fread(buf, 1, size, file)) {
+                return false;
+            }
+        }
+        if (0 == i) {
+            *row = Row(slice);
+        } else {
+            row->Append(slice);
+        }
+    }
+    return true;
+}
+
+}  // namespace vm
+}  // namespace hybridse
@@ -0,0 +1,138 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HYBRIDSE_SRC_VM_HASH_TABLE_H_
+#define HYBRIDSE_SRC_VM_HASH_TABLE_H_
+
+#include <stdio.h>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+#include "base/fe_slice.h"
+#include "base/mem_pool.h"
+#include "vm/catalog.h"
+
+namespace hybridse {
+namespace vm {
+
+/**
+ * An open-addressing hash table which maps the keys to dense indexes in the
+ * order of insertion. The keys are copied into an arena, so a table of many
+ * small keys costs one allocation per chunk rather than one per key.
+ */
+class KeyIndexTable {
+ public:
+    static constexpr uint32_t kNotFound = std::numeric_limits<uint32_t>::max();
+
+    explicit KeyIndexTable(size_t expect_size = 16);
+    ~KeyIndexTable() {}
+
+    // return the index of the key, the next index is assigned to a new key
+    uint32_t FindOrInsert(const base::Slice& key, bool* inserted);
+    // return the index of the key, kNotFound if absent
+    uint32_t Find(const base::Slice& key) const;
+
+    const base::Slice& GetKey(uint32_t idx) const { return keys_[idx]; }
+    size_t GetSize() const { return keys_.size(); }
+    void Clear();
+
+    static uint64_t Hash(const base::Slice& key);
+
+ private:
+    struct Slot {
+        uint64_t hash;
+        uint32_t idx;
+    };
+    uint32_t FindSlot(const base::Slice& key, uint64_t hash) const;
+    void Grow();
+
+    std::vector<Slot> slots_;
+    size_t mask_;
+    std::vector<base::Slice> keys_;
+    openmldb::base::ByteMemoryPool pool_;
+};
+
+/**
+ * The build side of a batch hash last join: the right rows grouped by the
+ * join key into segments.
+ *
+ * The rows are kept in memory until the estimated memory owned by the table
+ * exceeds `memory_limit`, then all the rows are spilled into `partition_num` temp
+ * files under `spill_dir` by the hash of their keys, and the join probes one
+ * partition at a time after LoadPartition. The temp files are unlinked on
+ * creation, so they are removed with the table even on a crash.
+ */
+class HashJoinBuildTable {
+ public:
+    static constexpr uint32_t kDefaultPartitionNum = 64;
+
+    HashJoinBuildTable(uint64_t memory_limit, const std::string& spill_dir,
+                       OrderType order_type,
+                       uint32_t partition_num = kDefaultPartitionNum);
+    ~HashJoinBuildTable();
+
+    bool Add(const std::string& key, uint64_t ts, const Row& row);
+
+    bool IsSpilled() const { return !spill_files_.empty(); }
+    // the number of partitions to probe, 1 if not spilled
+    uint32_t GetPartitionNum() const {
+        return IsSpilled() ? partition_num_ : 1;
+    }
+    uint32_t GetPartition(const base::Slice& key) const {
+        return IsSpilled() ? (KeyIndexTable::Hash(key) >> 32) % partition_num_
+                           : 0;
+    }
+    // load the segments of the partition in place of the loaded ones, a
+    // no-op if not spilled
+    bool LoadPartition(uint32_t partition);
+
+    // return the index of the segment of the key, KeyIndexTable::kNotFound if
+    // absent in the loaded partition
+    uint32_t Find(const base::Slice& key) const { return index_.Find(key); }
+    std::shared_ptr<TableHandler>& GetSegment(uint32_t idx) {
+        return segments_[idx];
+    }
+    size_t GetSegmentCnt() const { return segments_.size(); }
+    uint64_t GetMemoryUsage() const { return memory_usage_; }
+
+ private:
+    // owned is true if the row is read from the spill files, the rows added
+    // by Add share the buffers of the input and are not charged
+    void AddInMemory(const base::Slice& key, uint64_t ts, const Row& row,
+                     bool owned);
+    void ClearInMemory();
+    bool Spill();
+
+    static uint64_t EstimateSize(const Row& row, bool owned);
+    static bool WriteRow(FILE* file, const base::Slice& key, uint64_t ts,
+                         const Row& row);
+    // return false on the end of the file or an error
+    static bool ReadRow(FILE* file, std::string* key, uint64_t* ts, Row* row);
+
+    const uint64_t memory_limit_;
+    const std::string spill_dir_;
+    const OrderType order_type_;
+    const uint32_t partition_num_;
+    uint64_t memory_usage_;
+    KeyIndexTable index_;
+    std::vector<std::shared_ptr<TableHandler>> segments_;
+    std::vector<FILE*> spill_files_;
+};
+
+}  // namespace vm
+}  // namespace hybridse
+#endif  // HYBRIDSE_SRC_VM_HASH_TABLE_H_
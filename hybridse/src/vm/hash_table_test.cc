@@ -0,0 +1,143 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "vm/hash_table.h"
+#include <map>
+#include <string>
+#include <vector>
+#include "gtest/gtest.h"
+
+namespace hybridse {
+namespace vm {
+
+class HashTableTest : public ::testing::Test {};
+
+TEST_F(HashTableTest, KeyIndexTableTest) {
+    KeyIndexTable table(4);
+    bool inserted = false;
+    for (int i = 0; i < 1000; ++i) {
+        std::string key = "key" + std::to_string(i);
+        ASSERT_EQ(static_cast<uint32_t>(i),
+                  table.FindOrInsert(base::Slice(key), &inserted));
+        ASSERT_TRUE(inserted);
+    }
+    ASSERT_EQ(1000u, table.GetSize());
+    for (int i = 0; i < 1000; ++i) {
+        std::string key = "key" + std::to_string(i);
+        ASSERT_EQ(static_cast<uint32_t>(i), table.Find(base::Slice(key)));
+        ASSERT_EQ(static_cast<uint32_t>(i),
+                  table.FindOrInsert(base::Slice(key), &inserted));
+        ASSERT_FALSE(inserted);
+        ASSERT_EQ(key, table.GetKey(i).ToString());
+    }
+    ASSERT_EQ(KeyIndexTable::kNotFound, table.Find(base::Slice("key1000")));
+    // the empty key is a valid key
+    ASSERT_EQ(1000u, table.FindOrInsert(base::Slice(""), &inserted));
+    ASSERT_TRUE(inserted);
+
+    table.Clear();
+    ASSERT_EQ(0u, table.GetSize());
+    ASSERT_EQ(KeyIndexTable::kNotFound, table.Find(base::Slice("key1")));
+}
+
+static Row BuildRow(const std::string& first, const std::string& second) {
+    Row row(base::RefCountedSlice::Create(first.data(), first.size()));
+    row.Append(base::RefCountedSlice::Create(second.data(), second.size()));
+    return row;
+}
+
+static void CheckBuildTable(HashJoinBuildTable* table,
+                            const std::vector<std::string>& keys,
+                            const std::vector<std::string>& values) {
+    std::map<std::string, std::vector<std::string>> expect;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        expect[keys[i]].push_back(values[i]);
+    }
+    size_t found = 0;
+    for (uint32_t partition = 0; partition < table->GetPartitionNum();
+         ++partition) {
+        ASSERT_TRUE(table->LoadPartition(partition));
+        for (auto& kv : expect) {
+            base::Slice key(kv.first);
+            if (table->GetPartition(key) != partition) {
+                continue;
+            }
+            uint32_t idx = table->Find(key);
+            ASSERT_NE(KeyIndexTable::kNotFound, idx);
+            auto iter = table->GetSegment(idx)->GetIterator();
+            iter->SeekToFirst();
+            for (auto& value : kv.second) {
+                ASSERT_TRUE(iter->Valid());
+                ASSERT_EQ(2, iter->GetValue().GetRowPtrCnt());
+                ASSERT_EQ(value, iter->GetValue().GetSlice(0).ToString());
+                ASSERT_EQ("slice1", iter->GetValue().GetSlice(1).ToString());
+                iter->Next();
+            }
+            ASSERT_FALSE(iter->Valid());
+            found++;
+        }
+    }
+    ASSERT_EQ(expect.size(), found);
+}
+
+TEST_F(HashTableTest, BuildInMemoryTest) {
+    std::string slice1 = "slice1";
+    std::vector<std::string> keys = {"a", "b", "a", "c", "a"};
+    std::vector<std::string> values = {"v0", "v1", "v2", "v3", "v4"};
+    HashJoinBuildTable table(1 << 20, "/tmp", kDescOrder);
+    for (size_t i = 0; i < keys.size(); ++i) {
+        ASSERT_TRUE(table.Add(keys[i], i, BuildRow(values[i], slice1)));
+    }
+    ASSERT_FALSE(table.IsSpilled());
+    ASSERT_EQ(1u, table.GetPartitionNum());
+    ASSERT_EQ(3u, table.GetSegmentCnt());
+    ASSERT_EQ(KeyIndexTable::kNotFound, table.Find(base::Slice("d")));
+    CheckBuildTable(&table, keys, values);
+}
+
+TEST_F(HashTableTest, BuildSpillTest) {
+    std::string slice1 = "slice1";
+    std::vector<std::string> keys;
+    std::vector<std::string> values;
+    for (int i = 0; i < 2000; ++i) {
+        keys.push_back("key" + std::to_string(i % 300));
+        values.push_back("value" + std::to_string(i));
+    }
+    HashJoinBuildTable table(4096, "/tmp", kDescOrder, 8);
+    for (size_t i = 0; i < keys.size(); ++i) {
+        ASSERT_TRUE(table.Add(keys[i], i, BuildRow(values[i], slice1)));
+    }
+    ASSERT_TRUE(table.IsSpilled());
+    ASSERT_EQ(8u, table.GetPartitionNum());
+    CheckBuildTable(&table, keys, values);
+    // the partitions can be loaded again
+    CheckBuildTable(&table, keys, values);
+}
+
+TEST_F(HashTableTest, SpillDirNotExistTest) {
+    std::string slice1 = "slice1";
+    std::string value = "value";
+    HashJoinBuildTable table(1, "/tmp/hybridse_not_exist_dir", kDescOrder, 2);
+    ASSERT_FALSE(table.Add("key", 0, BuildRow(value, slice1)));
+}
+
+}  // namespace vm
+}  // namespace hybridse
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -22,6 +22,7 @@ extern "C" {
 #include <cstdlib>
 }
 #include "glog/logging.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
 #include "llvm/ExecutionEngine/JITEventListener.h"
 #include "llvm/ExecutionEngine/JITSymbol.h"
 #include "llvm/ExecutionEngine/Orc/CompileUtils.h"
@@ -36,6 +37,9 @@ extern "C" {
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/Verifier.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Transforms/IPO.h"
+#include "llvm/Transforms/IPO/PassManagerBuilder.h"
 #include "llvm/Transforms/InstCombine/InstCombine.h"
 #include "llvm/Transforms/Scalar.h"
 #include "llvm/Transforms/Scalar/GVN.h"
@@ -66,6 +70,63 @@ static void RunDefaultOptPasses(::llvm::Module* m) {
     }
 }
 
+// the codegen keeps the locals in allocas, promoting them is the least to
+// make the generated code reasonable
+static void RunFastOptPasses(::llvm::Module* m) {
+    ::llvm::legacy::FunctionPassManager fpm(m);
+    fpm.add(::llvm::createPromoteMemoryToRegisterPass());
+    fpm.add(::llvm::createCFGSimplificationPass());
+    fpm.doInitialization();
+    for (auto it = m->begin(); it != m->end(); ++it) {
+        fpm.run(*it);
+    }
+}
+
+static void RunAggressiveOptPasses(::llvm::Module* m,
+                                   ::llvm::TargetMachine* tm) {
+    ::llvm::PassManagerBuilder builder;
+    builder.OptLevel = 3;
+    builder.SizeLevel = 0;
+    builder.Inliner = ::llvm::createFunctionInliningPass(3, 0, false);
+    builder.LoopVectorize = true;
+    builder.SLPVectorize = true;
+
+    ::llvm::legacy::FunctionPassManager fpm(m);
+    ::llvm::legacy::PassManager mpm;
+    if (tm != nullptr) {
+        // the vectorizers need the cost model of the host target
+        m->setTargetTriple(tm->getTargetTriple().str());
+        tm->adjustPassManager(builder);
+        fpm.add(::llvm::createTargetTransformInfoWrapperPass(
+            tm->getTargetIRAnalysis()));
+        mpm.add(::llvm::createTargetTransformInfoWrapperPass(
+            tm->getTargetIRAnalysis()));
+    }
+    builder.populateFunctionPassManager(fpm);
+    builder.populateModulePassManager(mpm);
+    fpm.doInitialization();
+    for (auto it = m->begin(); it != m->end(); ++it) {
+        fpm.run(*it);
+    }
+    fpm.doFinalization();
+    mpm.run(*m);
+}
+
+static void RunOptPasses(::llvm::Module* m, JitOptLevel level,
+                         ::llvm::TargetMachine* tm) {
+    switch (level) {
+        case kJitOptFast:
+            RunFastOptPasses(m);
+            break;
+        case kJitOptAggressive:
+            RunAggressiveOptPasses(m, tm);
+            break;
+        default:
+            RunDefaultOptPasses(m);
+            break;
+    }
+}
+
 ::llvm::Error HybridSeJit::AddIRModule(::llvm::orc::JITDylib& jd,  // NOLINT
                                        ::llvm::orc::ThreadSafeModule tsm,
                                        ::llvm::orc::VModuleKey key) {
@@ -78,12 +139,13 @@ static void RunDefaultOptPasses(::llvm::Module* m) {
     return CompileLayer->add(jd, std::move(tsm), key);
 }
 
-bool HybridSeJit::OptModule(::llvm::Module* m) {
+bool HybridSeJit::OptModule(::llvm::Module* m, JitOptLevel level,
+                            ::llvm::TargetMachine* tm) {
     if (auto err = applyDataLayout(*m)) {
         return false;
     }
     DLOG(INFO) << "Module before opt:\n" << LlvmToString(*m);
-    RunDefaultOptPasses(m);
+    RunOptPasses(m, level, tm);
     DLOG(INFO) << "Module after opt:\n" << LlvmToString(*m);
     return true;
 }
@@ -150,8 +212,54 @@ bool HybridSeJit::AddSymbol(::llvm::orc::JITDylib& jd,
 
 bool HybridSeLlvmJitWrapper::Init() {
     DLOG(INFO) << "Start to initialize hybridse jit";
-    auto jit = ::llvm::Expected<std::unique_ptr<HybridSeJit>>(
-        HybridSeJitBuilder().create());
+    HybridSeJitBuilder builder;
+    if (kJitOptAggressive == jit_options_.GetOptLevel()) {
+        // generate code for the host cpu instead of the generic one of the
+        // triple, so that the vectorized loops use the widest registers
+        auto jtmb = ::llvm::orc::JITTargetMachineBuilder::detectHost();
+        if (!jtmb) {
+            LOG(WARNING) << "fail to detect host: "
+                         << LlvmToString(jtmb.takeError());
+            return false;
+        }
+        jtmb->setCPU(::llvm::sys::getHostCPUName().str());
+        ::llvm::StringMap<bool> host_features;
+        if (::llvm::sys::getHostCPUFeatures(host_features)) {
+            for (auto& feature : host_features) {
+                jtmb->getFeatures().AddFeature(feature.first(),
+                                               feature.second);
+            }
+        }
+        jtmb->setCodeGenOptLevel(::llvm::CodeGenOpt::Aggressive);
+        auto tm = jtmb->createTargetMachine();
+        if (!tm) {
+            LOG(WARNING) << "fail to create host target machine: "
+                         << LlvmToString(tm.takeError());
+            return false;
+        }
+        this->tm_ = std::move(tm.get());
+        builder.setJITTargetMachineBuilder(std::move(jtmb.get()));
+    }
+    if (!jit_options_.GetObjectCacheDir().empty()) {
+        object_cache_.reset(
+            new HybridSeObjectCache(jit_options_.GetObjectCacheDir(),
+                                    jit_options_.GetObjectCacheMaxSize()));
+        auto object_cache = object_cache_.get();
+        builder.setCompileFunctionCreator(
+            [object_cache](::llvm::orc::JITTargetMachineBuilder jtmb)
+                -> ::llvm::Expected<
+                    ::llvm::orc::IRCompileLayer::CompileFunction> {
+                auto tm = jtmb.createTargetMachine();
+                if (!tm) {
+                    return tm.takeError();
+                }
+                return ::llvm::orc::IRCompileLayer::CompileFunction(
+                    ::llvm::orc::TMOwningSimpleCompiler(std::move(*tm),
+                                                        object_cache));
+            });
+    }
+    auto jit =
+        ::llvm::Expected<std::unique_ptr<HybridSeJit>>(builder.create());
     {
         ::llvm::Error e = jit.takeError();
         if (e) {
@@ -170,7 +278,18 @@ bool HybridSeLlvmJitWrapper::Init() {
 }
 
 bool HybridSeLlvmJitWrapper::OptModule(::llvm::Module* module) {
-    return jit_->OptModule(module);
+    if (object_cache_) {
+        // key the module before the passes change it
+        module->setModuleIdentifier(
+            HybridSeObjectCache::GetKey(*module, jit_options_.GetOptLevel()));
+        if (object_cache_->Load(module->getModuleIdentifier())) {
+            // the loaded object is used in place of compiling the module
+            DLOG(INFO) << "skip opt for cached module "
+                       << module->getModuleIdentifier();
+            return true;
+        }
+    }
+    return jit_->OptModule(module, jit_options_.GetOptLevel(), tm_.get());
 }
 
 bool HybridSeLlvmJitWrapper::AddModule(
@@ -210,7 +329,7 @@ bool HybridSeMcJitWrapper::Init() { return true; }
 
 bool HybridSeMcJitWrapper::OptModule(::llvm::Module* module) {
     DLOG(INFO) << "Module before opt:\n" << LlvmToString(*module);
-    RunDefaultOptPasses(module);
+    RunOptPasses(module, jit_options_.GetOptLevel(), nullptr);
     DLOG(INFO) << "Module after opt:\n" << LlvmToString(*module);
     return true;
 }
@@ -237,7 +356,9 @@ bool HybridSeMcJitWrapper::AddModule(
             engine_builder.setEngineKind(llvm::EngineKind::JIT)
                 .setErrorStr(&err_str_)
                 .setVerifyModules(true)
-                .setOptLevel(::llvm::CodeGenOpt::Level::Default)
+                .setOptLevel(kJitOptAggressive == jit_options_.GetOptLevel()
+                                 ? ::llvm::CodeGenOpt::Level::Aggressive
+                                 : ::llvm::CodeGenOpt::Level::Default)
                 .setSymbolResolver(
                     std::unique_ptr<::llvm::LegacyJITSymbolResolver>(
                         ::llvm::cast<::llvm::LegacyJITSymbolResolver>(
@@ -22,6 +22,8 @@
 #include <string>
 #include "llvm/ExecutionEngine/GenericValue.h"
 #include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#include "llvm/Target/TargetMachine.h"
+#include "vm/jit_object_cache.h"
 #include "vm/jit_wrapper.h"
 
 #ifdef LLVM_EXT_ENABLE
@@ -48,7 +50,10 @@ class HybridSeJit : public ::llvm::orc::LLJIT {
                               ::llvm::orc::ThreadSafeModule tsm,
                               ::llvm::orc::VModuleKey key);
 
-    bool OptModule(::llvm::Module* m);
+    // run the passes of the opt level on the module, the target machine is
+    // used for the cost model of the aggressive level if not null
+    bool OptModule(::llvm::Module* m, JitOptLevel level = kJitOptDefault,
+                   ::llvm::TargetMachine* tm = nullptr);
 
     ::llvm::orc::VModuleKey CreateVModule();
 
@@ -88,6 +93,8 @@ std::string LlvmToString(const T& value) {
 class HybridSeLlvmJitWrapper : public HybridSeJitWrapper {
  public:
     HybridSeLlvmJitWrapper() {}
+    explicit HybridSeLlvmJitWrapper(const JitOptions& jit_options)
+        : jit_options_(jit_options) {}
     ~HybridSeLlvmJitWrapper() {}
 
     bool Init() override;
@@ -103,8 +110,13 @@ class HybridSeLlvmJitWrapper : public HybridSeJitWrapper {
         const std::string& funcname) override;
 
  private:
+    const JitOptions jit_options_;
+    // used by the compile function of jit_, so it outlives jit_
+    std::unique_ptr<HybridSeObjectCache> object_cache_;
     std::unique_ptr<HybridSeJit> jit_;
     std::unique_ptr<::llvm::orc::MangleAndInterner> mi_;
+    // the host target machine of the aggressive opt level
+    std::unique_ptr<::llvm::TargetMachine> tm_;
 };
 
 #ifdef LLVM_EXT_ENABLE
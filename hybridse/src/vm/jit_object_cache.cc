@@ -0,0 +1,227 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "vm/jit_object_cache.h"
+#include <unistd.h>
+#include <utime.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "glog/logging.h"
+#include "hybridse_version.h"  // NOLINT
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/SHA1.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace hybridse {
+namespace vm {
+
+static const char KEY_PREFIX[] = "hybridse_obj_";
+static const char OBJECT_SUFFIX[] = ".o";
+
+HybridSeObjectCache::HybridSeObjectCache(const std::string& dir,
+                                         uint64_t max_size)
+    : dir_(dir), max_size_(max_size), total_size_(0) {
+    auto ec = ::llvm::sys::fs::create_directories(dir_);
+    if (ec) {
+        LOG(WARNING) << "fail to create jit object cache dir " << dir_ << ": "
+                     << ec.message();
+        return;
+    }
+    // the files left by the last run, ordered by the last use
+    std::vector<std::tuple<::llvm::sys::TimePoint<>, std::string, uint64_t>>
+        files;
+    for (::llvm::sys::fs::directory_iterator it(dir_, ec), end;
+         it != end && !ec; it.increment(ec)) {
+        auto name = ::llvm::sys::path::filename(it->path());
+        if (!name.startswith(KEY_PREFIX) || !name.endswith(OBJECT_SUFFIX)) {
+            continue;
+        }
+        ::llvm::sys::fs::file_status status;
+        if (::llvm::sys::fs::status(it->path(), status)) {
+            continue;
+        }
+        files.emplace_back(status.getLastModificationTime(),
+                           name.drop_back(sizeof(OBJECT_SUFFIX) - 1).str(),
+                           status.getSize());
+    }
+    std::sort(files.begin(), files.end());
+    std::lock_guard<std::mutex> lock(mu_);
+    for (auto& file : files) {
+        Touch(std::get<1>(file), std::get<2>(file));
+    }
+    Evict();
+}
+
+std::string HybridSeObjectCache::GetKey(const ::llvm::Module& m,
+                                        JitOptLevel level) {
+    ::llvm::SHA1 sha1;
+    {
+        std::string ir;
+        ::llvm::raw_string_ostream ss(ir);
+        // the module name is the key itself once the module is keyed
+        m.print(ss, nullptr);
+        ss.flush();
+        sha1.update(ir);
+    }
+    sha1.update(std::to_string(HYBRIDSE_VERSION_MAJOR) + "." +
+                std::to_string(HYBRIDSE_VERSION_MINOR) + "." +
+                std::to_string(HYBRIDSE_VERSION_BUG));
+    sha1.update(LLVM_VERSION_STRING);
+    sha1.update(std::to_string(level));
+    sha1.update(::llvm::sys::getHostCPUName());
+    ::llvm::StringMap<bool> host_features;
+    if (::llvm::sys::getHostCPUFeatures(host_features)) {
+        // sorted to be stable across processes
+        std::map<std::string, bool> features;
+        for (auto& feature : host_features) {
+            features[feature.first().str()] = feature.second;
+        }
+        for (auto& feature : features) {
+            sha1.update((feature.second ? "+" : "-") + feature.first);
+        }
+    }
+    return KEY_PREFIX + ::llvm::toHex(sha1.final(), true);
+}
+
+bool HybridSeObjectCache::IsKey(const std::string& key) const {
+    return key.compare(0, sizeof(KEY_PREFIX) - 1, KEY_PREFIX) == 0;
+}
+
+std::string HybridSeObjectCache::GetPath(const std::string& key) const {
+    return dir_ + "/" + key + OBJECT_SUFFIX;
+}
+
+void HybridSeObjectCache::Touch(const std::string& key, uint64_t size) {
+    auto iter = files_.find(key);
+    if (iter != files_.end()) {
+        total_size_ -= iter->second.first;
+        lru_.erase(iter->second.second);
+        files_.erase(iter);
+    }
+    lru_.push_back(key);
+    files_.emplace(key, std::make_pair(size, std::prev(lru_.end())));
+    total_size_ += size;
+}
+
+void HybridSeObjectCache::Evict() {
+    // the most recently used file is kept even if it is over max_size_ alone
+    while (max_size_ > 0 && total_size_ > max_size_ && lru_.size() > 1) {
+        const std::string& key = lru_.front();
+        ::llvm::sys::fs::remove(GetPath(key));
+        DLOG(INFO) << "evict jit object " << GetPath(key);
+        auto iter = files_.find(key);
+        total_size_ -= iter->second.first;
+        files_.erase(iter);
+        lru_.pop_front();
+    }
+}
+
+bool HybridSeObjectCache::Load(const std::string& key) {
+    if (!IsKey(key)) {
+        return false;
+    }
+    auto buf = ::llvm::MemoryBuffer::getFile(GetPath(key));
+    if (!buf) {
+        return false;
+    }
+    DLOG(INFO) << "load jit object " << GetPath(key);
+    // the modification time orders the files by the last use after restart
+    ::utime(GetPath(key).c_str(), nullptr);
+    // the object is owned by the jit, copy it out of the file mapping
+    std::lock_guard<std::mutex> lock(mu_);
+    Touch(key, (*buf)->getBufferSize());
+    loaded_.emplace(key, ::llvm::MemoryBuffer::getMemBufferCopy(
+                             (*buf)->getBuffer(), key));
+    return true;
+}
+
+void HybridSeObjectCache::notifyObjectCompiled(const ::llvm::Module* m,
+                                               ::llvm::MemoryBufferRef obj) {
+    const std::string& key = m->getModuleIdentifier();
+    if (!IsKey(key)) {
+        return;
+    }
+    // write to a temporary file and rename it, so that a tablet never loads
+    // a partial object written by another one
+    std::string path = GetPath(key);
+    std::string tmp_path = path + ".tmp" + std::to_string(::getpid());
+    {
+        std::error_code ec;
+        ::llvm::raw_fd_ostream os(tmp_path, ec, ::llvm::sys::fs::OF_None);
+        if (ec) {
+            LOG(WARNING) << "fail to open " << tmp_path << ": " << ec.message();
+            return;
+        }
+        os << obj.getBuffer();
+        os.close();
+        if (os.has_error()) {
+            LOG(WARNING) << "fail to write " << tmp_path;
+            os.clear_error();
+            ::llvm::sys::fs::remove(tmp_path);
+            return;
+        }
+    }
+    auto ec = ::llvm::sys::fs::rename(tmp_path, path);
+    if (ec) {
+        LOG(WARNING) << "fail to rename " << tmp_path << ": " << ec.message();
+        ::llvm::sys::fs::remove(tmp_path);
+        return;
+    }
+    DLOG(INFO) << "cache jit object " << path;
+    std::lock_guard<std::mutex> lock(mu_);
+    Touch(key, obj.getBufferSize());
+    Evict();
+}
+
+std::unique_ptr<::llvm::MemoryBuffer> HybridSeObjectCache::getObject(
+    const ::llvm::Module* m) {
+    const std::string& key = m->getModuleIdentifier();
+    if (!IsKey(key)) {
+        return nullptr;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        auto iter = loaded_.find(key);
+        if (iter != loaded_.end()) {
+            auto obj = std::move(iter->second);
+            loaded_.erase(iter);
+            return obj;
+        }
+    }
+    auto buf = ::llvm::MemoryBuffer::getFile(GetPath(key));
+    if (!buf) {
+        return nullptr;
+    }
+    DLOG(INFO) << "load jit object " << GetPath(key);
+    ::utime(GetPath(key).c_str(), nullptr);
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        Touch(key, (*buf)->getBufferSize());
+    }
+    // the object is owned by the jit, copy it out of the file mapping
+    return ::llvm::MemoryBuffer::getMemBufferCopy((*buf)->getBuffer(), key);
+}
+
+}  // namespace vm
+}  // namespace hybridse
@@ -0,0 +1,86 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HYBRIDSE_SRC_VM_JIT_OBJECT_CACHE_H_
+#define HYBRIDSE_SRC_VM_JIT_OBJECT_CACHE_H_
+
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include "llvm/ExecutionEngine/ObjectCache.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "vm/engine_context.h"
+
+namespace hybridse {
+namespace vm {
+
+/**
+ * The on-disk cache of the object code compiled by the jit, so that the same
+ * sql compiled again, e.g. the deployments recovered by a restarted tablet,
+ * skips the optimization passes and the code generation.
+ *
+ * The module is keyed by GetKey before the passes, the key hashes the
+ * unoptimized ir, which carries the plan of the sql and the row layouts of
+ * its tables, together with the opt level, the engine and llvm versions and
+ * the host cpu. The modules not keyed by GetKey are not cached.
+ *
+ * The objects of all the compiled sql are cached, so the least recently used
+ * files are removed once the total size is over max_size, 0 means unlimited.
+ */
+class HybridSeObjectCache : public ::llvm::ObjectCache {
+ public:
+    explicit HybridSeObjectCache(const std::string& dir, uint64_t max_size = 0);
+    ~HybridSeObjectCache() {}
+
+    void notifyObjectCompiled(const ::llvm::Module* m,
+                              ::llvm::MemoryBufferRef obj) override;
+
+    std::unique_ptr<::llvm::MemoryBuffer> getObject(
+        const ::llvm::Module* m) override;
+
+    // load the object of the key from the disk, the next getObject of the
+    // module keyed by it returns the loaded one, so that the module skipping
+    // the passes is never compiled unoptimized if the file is removed later.
+    // return false if the object of the key is not in the cache
+    bool Load(const std::string& key);
+
+    static std::string GetKey(const ::llvm::Module& m, JitOptLevel level);
+
+ private:
+    bool IsKey(const std::string& key) const;
+    std::string GetPath(const std::string& key) const;
+    // mark the file of key as the most recently used one, mu_ should be held
+    void Touch(const std::string& key, uint64_t size);
+    // remove the least recently used files over max_size_, mu_ should be held
+    void Evict();
+
+    const std::string dir_;
+    const uint64_t max_size_;
+    std::mutex mu_;
+    // the objects loaded by Load and not taken by getObject yet
+    std::multimap<std::string, std::unique_ptr<::llvm::MemoryBuffer>> loaded_;
+    // the keys of the files from the least recently used one
+    std::list<std::string> lru_;
+    std::map<std::string, std::pair<uint64_t, std::list<std::string>::iterator>> files_;
+    uint64_t total_size_;
+};
+
+}  // namespace vm
+}  // namespace hybridse
+#endif  // HYBRIDSE_SRC_VM_JIT_OBJECT_CACHE_H_
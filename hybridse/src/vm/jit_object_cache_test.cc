@@ -0,0 +1,202 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "vm/jit_object_cache.h"
+#include <unistd.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include "codec/fe_row_codec.h"
+#include "gtest/gtest.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "vm/engine.h"
+#include "vm/simple_catalog.h"
+#include "vm/sql_compiler.h"
+
+namespace hybridse {
+namespace vm {
+
+class JitObjectCacheTest : public ::testing::Test {
+ public:
+    JitObjectCacheTest() {
+        dir_ = "/tmp/jit_object_cache_test_" + std::to_string(::getpid());
+    }
+    ~JitObjectCacheTest() { ::llvm::sys::fs::remove_directories(dir_); }
+
+ protected:
+    size_t CountObjects() {
+        size_t cnt = 0;
+        std::error_code ec;
+        for (::llvm::sys::fs::directory_iterator it(dir_, ec), end;
+             it != end && !ec; it.increment(ec)) {
+            cnt++;
+        }
+        return cnt;
+    }
+
+    std::string dir_;
+};
+
+static std::unique_ptr<::llvm::Module> BuildModule(::llvm::LLVMContext* ctx,
+                                                   int32_t value) {
+    auto m = std::unique_ptr<::llvm::Module>(new ::llvm::Module("sql", *ctx));
+    ::llvm::IRBuilder<> builder(*ctx);
+    auto fn = ::llvm::Function::Create(
+        ::llvm::FunctionType::get(builder.getInt32Ty(), false),
+        ::llvm::Function::ExternalLinkage, "fn", m.get());
+    builder.SetInsertPoint(::llvm::BasicBlock::Create(*ctx, "entry", fn));
+    builder.CreateRet(builder.getInt32(value));
+    return m;
+}
+
+TEST_F(JitObjectCacheTest, KeyTest) {
+    ::llvm::LLVMContext ctx;
+    auto m1 = BuildModule(&ctx, 1);
+    auto m2 = BuildModule(&ctx, 1);
+    auto m3 = BuildModule(&ctx, 2);
+    auto key = HybridSeObjectCache::GetKey(*m1, kJitOptDefault);
+    ASSERT_EQ(key, HybridSeObjectCache::GetKey(*m2, kJitOptDefault));
+    ASSERT_NE(key, HybridSeObjectCache::GetKey(*m3, kJitOptDefault));
+    ASSERT_NE(key, HybridSeObjectCache::GetKey(*m1, kJitOptAggressive));
+}
+
+TEST_F(JitObjectCacheTest, ObjectTest) {
+    HybridSeObjectCache cache(dir_);
+    ::llvm::LLVMContext ctx;
+    auto m = BuildModule(&ctx, 1);
+    // the module not keyed is not cached
+    cache.notifyObjectCompiled(m.get(), ::llvm::MemoryBufferRef("obj", "sql"));
+    ASSERT_EQ(nullptr, cache.getObject(m.get()));
+    ASSERT_EQ(0u, CountObjects());
+
+    auto key = HybridSeObjectCache::GetKey(*m, kJitOptDefault);
+    m->setModuleIdentifier(key);
+    ASSERT_FALSE(cache.Load(key));
+    ASSERT_EQ(nullptr, cache.getObject(m.get()));
+    cache.notifyObjectCompiled(m.get(), ::llvm::MemoryBufferRef("obj", key));
+    auto obj = cache.getObject(m.get());
+    ASSERT_TRUE(obj != nullptr);
+    ASSERT_EQ("obj", obj->getBuffer().str());
+    ASSERT_EQ(1u, CountObjects());
+
+    // the loaded object is got even if the file is removed after loading
+    ASSERT_TRUE(cache.Load(key));
+    ::llvm::sys::fs::remove(dir_ + "/" + key + ".o");
+    ASSERT_FALSE(cache.Load(key));
+    obj = cache.getObject(m.get());
+    ASSERT_TRUE(obj != nullptr);
+    ASSERT_EQ("obj", obj->getBuffer().str());
+    ASSERT_EQ(nullptr, cache.getObject(m.get()));
+}
+
+TEST_F(JitObjectCacheTest, EvictTest) {
+    ::llvm::LLVMContext ctx;
+    std::vector<std::unique_ptr<::llvm::Module>> modules;
+    for (int32_t i = 0; i < 4; ++i) {
+        auto m = BuildModule(&ctx, i);
+        m->setModuleIdentifier(HybridSeObjectCache::GetKey(*m, kJitOptDefault));
+        modules.push_back(std::move(m));
+    }
+    {
+        // at most 2 objects of 4 bytes
+        HybridSeObjectCache cache(dir_, 8);
+        for (int32_t i = 0; i < 3; ++i) {
+            cache.notifyObjectCompiled(modules[i].get(), ::llvm::MemoryBufferRef("obj" + std::to_string(i),
+                                                                                 modules[i]->getName()));
+            if (i == 1) {
+                // the module 0 is used recently, so the module 1 is evicted
+                ASSERT_TRUE(cache.getObject(modules[0].get()) != nullptr);
+            }
+        }
+        ASSERT_EQ(2u, CountObjects());
+        ASSERT_TRUE(cache.getObject(modules[0].get()) != nullptr);
+        ASSERT_EQ(nullptr, cache.getObject(modules[1].get()));
+        ASSERT_TRUE(cache.getObject(modules[2].get()) != nullptr);
+    }
+    // the files left are counted by the cache of the next run
+    HybridSeObjectCache cache(dir_, 8);
+    cache.notifyObjectCompiled(modules[3].get(), ::llvm::MemoryBufferRef("obj3", modules[3]->getName()));
+    ASSERT_EQ(2u, CountObjects());
+    ASSERT_TRUE(cache.getObject(modules[3].get()) != nullptr);
+}
+
+static std::shared_ptr<SimpleCatalog> GetTestCatalog() {
+    hybridse::type::Database db;
+    db.set_name("db");
+    ::hybridse::type::TableDef* table = db.add_tables();
+    table->set_name("t1");
+    table->set_catalog("db");
+    {
+        ::hybridse::type::ColumnDef* column = table->add_columns();
+        column->set_type(::hybridse::type::kDouble);
+        column->set_name("col_1");
+    }
+    {
+        ::hybridse::type::ColumnDef* column = table->add_columns();
+        column->set_type(::hybridse::type::kInt64);
+        column->set_name("col_2");
+    }
+    auto catalog = std::make_shared<SimpleCatalog>();
+    catalog->AddDatabase(db);
+    return catalog;
+}
+
+TEST_F(JitObjectCacheTest, EngineTest) {
+    auto catalog = GetTestCatalog();
+    EngineOptions options;
+    options.jit_options().SetObjectCacheDir(dir_);
+    std::string sql = "select col_1 * 2.0, col_2 + 1 from t1;";
+    auto schema = catalog->GetTable("db", "t1")->GetSchema();
+    int8_t buf[1024];
+    codec::RowBuilder row_builder(*schema);
+    row_builder.SetBuffer(buf, 1024);
+    row_builder.AppendDouble(3.5);
+    row_builder.AppendInt64(41);
+    hybridse::codec::Row row(base::RefCountedSlice::Create(buf, 1024));
+
+    // compile by the first engine and load from the cache by the second one
+    for (int i = 0; i < 2; ++i) {
+        Engine engine(catalog, options);
+        BatchRunSession session;
+        base::Status status;
+        ASSERT_TRUE(engine.Get(sql, "db", session, status)) << status;
+        ASSERT_EQ(1u, CountObjects());
+
+        auto info = std::dynamic_pointer_cast<SqlCompileInfo>(session.GetCompileInfo());
+        auto& ctx = info->get_sql_context();
+        auto fn = ctx.jit->FindFunction(ctx.physical_plan->GetFnInfos()[0]->fn_name());
+        ASSERT_TRUE(fn != nullptr);
+        hybridse::codec::Row output = CoreAPI::RowProject(fn, row, hybridse::codec::Row());
+        codec::RowView row_view(ctx.schema, output.buf(), output.size());
+        double c1;
+        int64_t c2;
+        ASSERT_EQ(0, row_view.GetDouble(0, &c1));
+        ASSERT_EQ(0, row_view.GetInt64(1, &c2));
+        ASSERT_EQ(7.0, c1);
+        ASSERT_EQ(42, c2);
+    }
+}
+
+}  // namespace vm
+}  // namespace hybridse
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    hybridse::vm::Engine::InitializeGlobalLLVM();
+    return RUN_ALL_TESTS();
+}
@@ -17,6 +17,7 @@
 
 #include <string>
 #include <utility>
+#include "codec/window_column_agg.h"
 #include "glog/logging.h"
 #include "llvm/ExecutionEngine/JITSymbol.h"
 #include "llvm/ExecutionEngine/Orc/CompileUtils.h"
@@ -73,17 +74,20 @@ HybridSeJitWrapper* HybridSeJitWrapper::Create(const JitOptions& jit_options) {
     if (jit_options.IsEnableMcjit()) {
 #ifdef LLVM_EXT_ENABLE
         LOG(INFO) << "Create McJit engine";
+        if (!jit_options.GetObjectCacheDir().empty()) {
+            LOG(WARNING) << "McJit do not support object cache";
+        }
         return new HybridSeMcJitWrapper(jit_options);
 #else
         LOG(WARNING) << "McJit support is not enabled";
-        return new HybridSeLlvmJitWrapper();
+        return new HybridSeLlvmJitWrapper(jit_options);
 #endif
     } else {
         if (jit_options.IsEnableVtune() || jit_options.IsEnablePerf() ||
             jit_options.IsEnableGdb()) {
             LOG(WARNING) << "LLJIT do not support jit events";
         }
-        return new HybridSeLlvmJitWrapper();
+        return new HybridSeLlvmJitWrapper(jit_options);
     }
 }
 
@@ -197,6 +201,9 @@ void InitBuiltinJitSymbols(HybridSeJitWrapper* jit) {
     jit->AddExternalFunction(
         "hybridse_storage_row_iter_delete",
         reinterpret_cast<void*>(&hybridse::vm::RowIterDelete));
+    jit->AddExternalFunction(
+        "hybridse_window_column_agg",
+        reinterpret_cast<void*>(&hybridse::codec::WindowColumnAgg));
     jit->AddExternalFunction(
         "hybridse_storage_get_row_slice",
         reinterpret_cast<void*>(&hybridse::vm::RowGetSlice));
@@ -81,7 +81,7 @@ void simple_test(const EngineOptions &options) {
     auto &sql_context = compile_info->get_sql_context();
     std::string ir_str = sql_context.ir;
     ASSERT_FALSE(ir_str.empty());
-    HybridSeJitWrapper *jit = HybridSeJitWrapper::Create();
+    HybridSeJitWrapper *jit = HybridSeJitWrapper::Create(options.jit_options());
     ASSERT_TRUE(jit->Init());
     HybridSeJitWrapper::InitJitSymbols(jit);
 
@@ -118,6 +118,15 @@ TEST_F(JitWrapperTest, test) {
     simple_test(options);
 }
 
+TEST_F(JitWrapperTest, test_opt_level) {
+    for (auto level : {kJitOptFast, kJitOptDefault, kJitOptAggressive}) {
+        EngineOptions options;
+        options.SetKeepIr(true);
+        options.jit_options().SetOptLevel(level);
+        simple_test(options);
+    }
+}
+
 #ifdef LLVM_EXT_ENABLE
 TEST_F(JitWrapperTest, test_mcjit) {
     EngineOptions options;
@@ -149,7 +158,7 @@ TEST_F(JitWrapperTest, test_window) {
     // this should be removed by better symbol init utility
 
     ASSERT_FALSE(ir_str.empty());
-    HybridSeJitWrapper *jit = HybridSeJitWrapper::Create();
+    HybridSeJitWrapper *jit = HybridSeJitWrapper::Create(options.jit_options());
     ASSERT_TRUE(jit->Init());
     HybridSeJitWrapper::InitJitSymbols(jit);
 
@@ -194,6 +194,15 @@ bool MemPartitionHandler::AddRow(const std::string& key, uint64_t ts,
     }
     return true;
 }
+void MemPartitionHandler::AddSegment(const std::string& key,
+                                     MemTimeTable&& segment) {
+    auto& rows = partitions_[key];
+    if (rows.empty()) {
+        rows = std::move(segment);
+    } else {
+        rows.insert(rows.end(), segment.begin(), segment.end());
+    }
+}
 std::unique_ptr<WindowIterator> MemPartitionHandler::GetWindowIterator() {
     return std::unique_ptr<WindowIterator>(
         new MemWindowIterator(&partitions_, schema_));
@@ -274,6 +283,9 @@ MemTableHandler::MemTableHandler(const std::string& table_name,
       table_(),
       order_type_(kNoneOrder) {}
 void MemTableHandler::AddRow(const Row& row) { table_.push_back(row); }
+void MemTableHandler::AddRows(const MemTableHandler& table) {
+    table_.insert(table_.end(), table.table_.begin(), table.table_.end());
+}
 void MemTableHandler::Resize(const size_t size) { table_.resize(size); }
 bool MemTableHandler::SetRow(const size_t idx, const Row& row) {
     if (idx >= table_.size()) {
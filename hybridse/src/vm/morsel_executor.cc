@@ -0,0 +1,114 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "vm/morsel_executor.h"
+#include <algorithm>
+
+namespace hybridse {
+namespace vm {
+
+// the morsels per runner, more morsels balance the skewed keys better but
+// cost more merges
+static constexpr size_t kMorselsPerRunner = 8;
+
+MorselExecutor::MorselExecutor(uint32_t worker_num)
+    : mu_(), cv_(), jobs_(), stopped_(false), workers_() {
+    for (uint32_t i = 0; i < worker_num; ++i) {
+        workers_.emplace_back(&MorselExecutor::WorkLoop, this);
+    }
+}
+
+MorselExecutor::~MorselExecutor() {
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        stopped_ = true;
+    }
+    cv_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+MorselExecutor* MorselExecutor::GetInstance() {
+    static MorselExecutor executor(
+        std::max<uint32_t>(std::thread::hardware_concurrency(), 2) - 1);
+    return &executor;
+}
+
+size_t MorselExecutor::GetMorselCnt(size_t size, uint32_t parallelism) {
+    return std::min(size, std::max<size_t>(parallelism, 1) * kMorselsPerRunner);
+}
+
+void MorselExecutor::RunMorsels(Job* job) {
+    size_t finished = 0;
+    while (true) {
+        size_t morsel = job->next.fetch_add(1, std::memory_order_relaxed);
+        if (morsel >= job->morsel_cnt) {
+            break;
+        }
+        job->fn(morsel);
+        finished++;
+    }
+    if (finished > 0) {
+        job->done.signal(static_cast<int>(finished));
+    }
+}
+
+void MorselExecutor::WorkLoop() {
+    while (true) {
+        std::shared_ptr<Job> job;
+        {
+            std::unique_lock<std::mutex> lock(mu_);
+            cv_.wait(lock, [this] { return stopped_ || !jobs_.empty(); });
+            if (stopped_) {
+                return;
+            }
+            job = jobs_.front();
+            jobs_.pop_front();
+        }
+        RunMorsels(job.get());
+    }
+}
+
+void MorselExecutor::Run(size_t morsel_cnt, uint32_t parallelism,
+                         const MorselFn& fn) {
+    size_t helper_num = std::min<size_t>(
+        {parallelism > 0 ? parallelism - 1 : 0, workers_.size(),
+         morsel_cnt > 0 ? morsel_cnt - 1 : 0});
+    if (0 == helper_num) {
+        for (size_t i = 0; i < morsel_cnt; ++i) {
+            fn(i);
+        }
+        return;
+    }
+    auto job = std::make_shared<Job>(morsel_cnt, fn);
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        for (size_t i = 0; i < helper_num; ++i) {
+            jobs_.push_back(job);
+        }
+    }
+    if (1 == helper_num) {
+        cv_.notify_one();
+    } else {
+        cv_.notify_all();
+    }
+    RunMorsels(job.get());
+    job->done.wait();
+}
+
+}  // namespace vm
+}  // namespace hybridse
@@ -0,0 +1,93 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HYBRIDSE_SRC_VM_MORSEL_EXECUTOR_H_
+#define HYBRIDSE_SRC_VM_MORSEL_EXECUTOR_H_
+
+#include <atomic>
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>   // NOLINT
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "bthread/countdown_event.h"
+
+namespace hybridse {
+namespace vm {
+
+/**
+ * A process-wide pool of workers which runs the morsels, i.e. the small work
+ * units, of the batch runners in parallel.
+ *
+ * A job is split into morsels indexed from 0. The caller and up to
+ * `parallelism - 1` idle workers take the next morsel from the job one at a
+ * time, so a worker done with its morsel takes over the rest of a slower
+ * one's share. The caller takes part in its own job, so a morsel can run a
+ * nested job without waiting on the busy workers.
+ */
+class MorselExecutor {
+ public:
+    using MorselFn = std::function<void(size_t)>;
+
+    explicit MorselExecutor(uint32_t worker_num);
+    ~MorselExecutor();
+
+    MorselExecutor(const MorselExecutor&) = delete;
+    MorselExecutor& operator=(const MorselExecutor&) = delete;
+
+    // the executor with a worker per core
+    static MorselExecutor* GetInstance();
+
+    // run fn(0) ... fn(morsel_cnt - 1) and return when all of them are done
+    void Run(size_t morsel_cnt, uint32_t parallelism, const MorselFn& fn);
+
+    uint32_t GetWorkerNum() const { return workers_.size(); }
+
+    // the number of morsels to split `size` units for `parallelism` runners,
+    // a few morsels per runner to balance the skewed units
+    static size_t GetMorselCnt(size_t size, uint32_t parallelism);
+
+ private:
+    struct Job {
+        Job(size_t morsel_cnt, const MorselFn& fn)
+            : fn(fn),
+              morsel_cnt(morsel_cnt),
+              next(0),
+              done(static_cast<int>(morsel_cnt)) {}
+        const MorselFn& fn;
+        const size_t morsel_cnt;
+        std::atomic<size_t> next;
+        // the caller may be a bthread of the rpc, so it waits on a bthread
+        // event which does not block the worker pthread
+        bthread::CountdownEvent done;
+    };
+
+    static void RunMorsels(Job* job);
+    void WorkLoop();
+
+    std::mutex mu_;
+    std::condition_variable cv_;
+    std::deque<std::shared_ptr<Job>> jobs_;
+    bool stopped_;
+    std::vector<std::thread> workers_;
+};
+
+}  // namespace vm
+}  // namespace hybridse
+#endif  // HYBRIDSE_SRC_VM_MORSEL_EXECUTOR_H_
@@ -0,0 +1,92 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "vm/morsel_executor.h"
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <mutex>   // NOLINT
+#include <set>
+#include <thread>  // NOLINT
+#include <vector>
+#include "gtest/gtest.h"
+
+namespace hybridse {
+namespace vm {
+
+class MorselExecutorTest : public ::testing::Test {};
+
+TEST_F(MorselExecutorTest, RunAllMorselsTest) {
+    MorselExecutor executor(4);
+    ASSERT_EQ(4u, executor.GetWorkerNum());
+    for (uint32_t parallelism : {0, 1, 2, 8}) {
+        std::vector<std::atomic<int>> runs(1000);
+        executor.Run(runs.size(), parallelism,
+                     [&runs](size_t morsel) { runs[morsel].fetch_add(1); });
+        for (auto& run : runs) {
+            ASSERT_EQ(1, run.load());
+        }
+    }
+    // no morsel
+    executor.Run(0, 4, [](size_t morsel) { FAIL(); });
+}
+
+TEST_F(MorselExecutorTest, ParallelismTest) {
+    MorselExecutor executor(4);
+    std::mutex mu;
+    std::set<std::thread::id> threads;
+    std::atomic<int> running(0);
+    std::atomic<int> max_running(0);
+    executor.Run(64, 3, [&](size_t morsel) {
+        int cur = running.fetch_add(1) + 1;
+        int max = max_running.load();
+        while (cur > max && !max_running.compare_exchange_weak(max, cur)) {
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        {
+            std::lock_guard<std::mutex> lock(mu);
+            threads.insert(std::this_thread::get_id());
+        }
+        running.fetch_sub(1);
+    });
+    // the caller and at most 2 workers
+    ASSERT_LE(max_running.load(), 3);
+    ASSERT_LE(threads.size(), 3u);
+    ASSERT_TRUE(threads.count(std::this_thread::get_id()));
+}
+
+TEST_F(MorselExecutorTest, NestedRunTest) {
+    MorselExecutor executor(2);
+    std::atomic<int> cnt(0);
+    executor.Run(8, 3, [&](size_t morsel) {
+        executor.Run(8, 3, [&](size_t inner) { cnt.fetch_add(1); });
+    });
+    ASSERT_EQ(64, cnt.load());
+}
+
+TEST_F(MorselExecutorTest, MorselCntTest) {
+    ASSERT_EQ(0u, MorselExecutor::GetMorselCnt(0, 4));
+    ASSERT_EQ(10u, MorselExecutor::GetMorselCnt(10, 4));
+    ASSERT_EQ(32u, MorselExecutor::GetMorselCnt(10000, 4));
+    ASSERT_EQ(8u, MorselExecutor::GetMorselCnt(10000, 0));
+}
+
+}  // namespace vm
+}  // namespace hybridse
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -1228,6 +1228,9 @@ void PhysicalRequestUnionNode::Print(std::ostream& output, const std::string& ta
     if (exclude_current_time_) {
         output << "EXCLUDE_CURRENT_TIME, ";
     }
+    if (nullptr != shared_scan_) {
+        output << "SHARED_SCAN(" << shared_scan_->window().range().ToString() << "), ";
+    }
     output << window_.ToString() << ")";
     if (!window_unions_.Empty()) {
         for (auto window_union : window_unions_.window_unions_) {
@@ -1276,10 +1279,16 @@ void PhysicalRequestAggUnionNode::Print(std::ostream& output, const std::string&
 }
 
 void PhysicalRequestAggUnionNode::PrintChildren(std::ostream& output, const std::string& tab) const {
-    if (3 != producers_.size() || nullptr == producers_[0] || nullptr == producers_[1] || nullptr == producers_[2]) {
+    if (producers_.size() < 3 || producers_.size() != GetAggNum() + 2) {
         LOG(WARNING) << "fail to print PhysicalRequestAggUnionNode children";
         return;
     }
+    for (auto producer : producers_) {
+        if (nullptr == producer) {
+            LOG(WARNING) << "fail to print PhysicalRequestAggUnionNode children";
+            return;
+        }
+    }
     producers_[0]->Print(output, tab + INDENT);
     for (size_t i = 1; i < producers_.size(); i++) {
         output << "\n";
@@ -1297,14 +1306,19 @@ base::Status PhysicalRequestAggUnionNode::InitSchema(PhysicalPlanContext* ctx) {
     if (parent_schema_context_) {
         source->SetSchema(parent_schema_context_->GetOutputSchema());
     } else {
-        auto column = agg_schema_.Add();
-        column->set_type(::hybridse::type::kVarchar);
-        column->set_name("agg_val");
+        // one column for each aggregate call
+        for (size_t i = 0; i < GetAggNum(); i++) {
+            auto column = agg_schema_.Add();
+            column->set_type(::hybridse::type::kVarchar);
+            column->set_name("agg_val");
+        }
         source->SetSchema(&agg_schema_);
     }
 
-    source->SetColumnID(0, ctx->GetNewColumnID());
-    source->SetNonSource(0);
+    for (size_t i = 0; i < source->size(); i++) {
+        source->SetColumnID(i, ctx->GetNewColumnID());
+        source->SetNonSource(i);
+    }
     return Status::OK();
 }
 
@@ -16,6 +16,7 @@
 
 #include "vm/runner.h"
 
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <utility>
@@ -26,10 +27,15 @@
 #include "udf/udf.h"
 #include "vm/catalog_wrapper.h"
 #include "vm/core_api.h"
+#include "vm/hash_table.h"
 #include "vm/jit_runtime.h"
 #include "vm/mem_catalog.h"
+#include "vm/morsel_executor.h"
 
 DECLARE_bool(enable_spark_unsaferow_format);
+DECLARE_bool(enable_batch_hash_runner);
+DECLARE_uint64(batch_hash_join_memory_limit_mb);
+DECLARE_string(batch_hash_join_spill_dir);
 
 namespace hybridse {
 namespace vm {
@@ -297,6 +303,26 @@ ClusterTask RunnerBuilder::Build(PhysicalOpNode* node, Status& status) {
                 LOG(WARNING) << status;
                 return fail;
             }
+            auto shared_scan = dynamic_cast<const PhysicalRequestUnionNode*>(node)->shared_scan();
+            if (nullptr != shared_scan && !support_cluster_optimized_) {
+                auto shared_task = Build(shared_scan, status);
+                if (!shared_task.IsValid()) {
+                    status.msg = "fail to build shared scan runner";
+                    status.code = common::kExecutionPlanError;
+                    LOG(WARNING) << status;
+                    return fail;
+                }
+                // the window of the shared scan is computed once for all the windows sharing it
+                shared_task.GetRoot()->EnableCache();
+                auto op = dynamic_cast<const PhysicalRequestUnionNode*>(node);
+                RequestUnionRunner* runner = nullptr;
+                CreateRunner<RequestUnionRunner>(&runner, id_++, node->schemas_ctx(), op->GetLimitCnt(),
+                                                 op->window().range_, op->exclude_current_time(),
+                                                 op->output_request_row());
+                runner->EnableSharedScan();
+                return RegisterTask(node, BinaryInherit(left_task, shared_task, runner, op->window_.index_key_,
+                                                        kRightBias));
+            }
             auto right_task = Build(node->producers().at(1), status);
             auto right = right_task.GetRoot();
             if (!right_task.IsValid()) {
@@ -428,12 +454,19 @@ ClusterTask RunnerBuilder::Build(PhysicalOpNode* node, Status& status) {
                             BinaryInherit(left_task, right_task, runner,
                                           op->join().index_key(), kLeftBias));
                     } else {
+                        // hash join the right table when no index serves
+                        // the join
+                        bool hash_join =
+                            FLAGS_enable_batch_hash_runner &&
+                            !op->join().index_key().ValidKey() &&
+                            op->join().right_key().ValidKey();
                         LastJoinRunner* runner = nullptr;
                         CreateRunner<LastJoinRunner>(
                             &runner, id_++, node->schemas_ctx(),
                             op->GetLimitCnt(), op->join_,
                             left->output_schemas()->GetSchemaSourceSize(),
-                            right->output_schemas()->GetSchemaSourceSize());
+                            right->output_schemas()->GetSchemaSourceSize(),
+                            hash_join);
                         return RegisterTask(
                             node, BinaryInherit(left_task, right_task, runner,
                                                 Key(), kLeftBias));
@@ -474,7 +507,8 @@ ClusterTask RunnerBuilder::Build(PhysicalOpNode* node, Status& status) {
             auto op = dynamic_cast<const PhysicalGroupNode*>(node);
             GroupRunner* runner = nullptr;
             CreateRunner<GroupRunner>(&runner, id_++, node->schemas_ctx(),
-                                      op->GetLimitCnt(), op->group());
+                                      op->GetLimitCnt(), op->group(),
+                                      FLAGS_enable_batch_hash_runner);
             return RegisterTask(node, UnaryInheritTask(cluster_task, runner));
         }
         case kPhysicalOpFilter: {
@@ -562,28 +596,37 @@ ClusterTask RunnerBuilder::BuildRequestAggUnionTask(PhysicalOpNode* node, Status
         LOG(WARNING) << status;
         return fail;
     }
-    auto agg_table_task = Build(node->producers().at(2), status);
-    auto agg_table = agg_table_task.GetRoot();
-    if (!agg_table_task.IsValid()) {
-        status.msg = "fail to build agg_table input runner";
-        status.code = common::kExecutionPlanError;
-        LOG(WARNING) << status;
-        return fail;
-    }
     auto op = dynamic_cast<const PhysicalRequestAggUnionNode*>(node);
+    // one agg table for each aggregate call
+    std::vector<ClusterTask> agg_table_tasks;
+    for (size_t i = 0; i < op->GetAggNum(); i++) {
+        auto agg_table_task = Build(node->producers().at(i + 2), status);
+        if (!agg_table_task.IsValid()) {
+            status.msg = "fail to build agg_table input runner";
+            status.code = common::kExecutionPlanError;
+            LOG(WARNING) << status;
+            return fail;
+        }
+        agg_table_tasks.push_back(agg_table_task);
+    }
     RequestAggUnionRunner* runner = nullptr;
     CreateRunner<RequestAggUnionRunner>(
         &runner, id_++, node->schemas_ctx(), op->GetLimitCnt(),
         op->window().range_, op->exclude_current_time(),
-        op->output_request_row(), op->func_, op->agg_col_);
+        op->output_request_row(), op->funcs_, op->agg_cols_, op->agg_args_);
     Key index_key;
     if (!op->instance_not_in_window()) {
         index_key = op->window_.index_key();
         runner->AddWindowUnion(op->window_, base_table);
-        runner->AddWindowUnion(op->agg_window_, agg_table);
+        for (size_t i = 0; i < agg_table_tasks.size(); i++) {
+            runner->AddWindowUnion(op->agg_windows_[i], agg_table_tasks[i].GetRoot());
+        }
     }
-    auto task = RegisterTask(node, MultipleInherit({&request_task, &base_table_task, &agg_table_task}, runner,
-                                                   index_key, kRightBias));
+    std::vector<const ClusterTask*> children = {&request_task, &base_table_task};
+    for (const auto& agg_table_task : agg_table_tasks) {
+        children.push_back(&agg_table_task);
+    }
+    auto task = RegisterTask(node, MultipleInherit(children, runner, index_key, kRightBias));
     if (!runner->InitAggregator()) {
         return fail;
     } else {
@@ -1256,6 +1299,11 @@ std::shared_ptr<DataHandler> GroupRunner::Run(
         LOG(WARNING) << "input is empty";
         return fail_ptr;
     }
+    if (hash_group_ && kTableHandler == input->GetHanlderType()) {
+        return partition_gen_.HashPartition(
+            std::dynamic_pointer_cast<TableHandler>(input),
+            ctx.GetParameterRow());
+    }
     return partition_gen_.Partition(input, ctx.GetParameterRow());
 }
 std::shared_ptr<DataHandler> SortRunner::Run(
@@ -1411,6 +1459,17 @@ std::shared_ptr<DataHandler> SelectSliceRunner::Run(
     return nullptr;
 }
 
+// the keys of the partition from the current position of the iterator, to
+// split into the morsels of a parallel run
+static std::vector<std::string> GetPartitionKeys(WindowIterator* iter) {
+    std::vector<std::string> keys;
+    while (iter->Valid()) {
+        keys.push_back(iter->GetKey().ToString());
+        iter->Next();
+    }
+    return keys;
+}
+
 std::shared_ptr<DataHandler> WindowAggRunner::Run(
     RunnerContext& ctx,
     const std::vector<std::shared_ptr<DataHandler>>& inputs) {
@@ -1448,11 +1507,35 @@ std::shared_ptr<DataHandler> WindowAggRunner::Run(
 
     // Compute output
     std::shared_ptr<MemTableHandler> output_table = std::make_shared<MemTableHandler>();
-    while (instance_partition_iter->Valid()) {
-        auto key = instance_partition_iter->GetKey().ToString();
-        RunWindowAggOnKey(parameter, instance_partition, union_partitions,
-                          join_right_tables, key, output_table);
-        instance_partition_iter->Next();
+    // the limit counts the rows across the keys, so it runs serially
+    uint32_t parallelism = limit_cnt_ > 0 ? 1 : ctx.GetParallelism();
+    if (parallelism <= 1) {
+        while (instance_partition_iter->Valid()) {
+            auto key = instance_partition_iter->GetKey().ToString();
+            RunWindowAggOnKey(parameter, instance_partition, union_partitions,
+                              join_right_tables, key, output_table);
+            instance_partition_iter->Next();
+        }
+        return output_table;
+    }
+
+    // Compute the morsels of keys in parallel and merge them in key order
+    auto keys = GetPartitionKeys(instance_partition_iter.get());
+    size_t morsel_cnt = MorselExecutor::GetMorselCnt(keys.size(), parallelism);
+    std::vector<std::shared_ptr<MemTableHandler>> morsel_outputs(morsel_cnt);
+    MorselExecutor::GetInstance()->Run(
+        morsel_cnt, parallelism, [&](size_t morsel) {
+            auto morsel_output = std::make_shared<MemTableHandler>();
+            for (size_t i = keys.size() * morsel / morsel_cnt;
+                 i < keys.size() * (morsel + 1) / morsel_cnt; ++i) {
+                RunWindowAggOnKey(parameter, instance_partition,
+                                  union_partitions, join_right_tables, keys[i],
+                                  morsel_output);
+            }
+            morsel_outputs[morsel] = morsel_output;
+        });
+    for (auto& morsel_output : morsel_outputs) {
+        output_table->AddRows(*morsel_output);
     }
     return output_table;
 }
@@ -1585,6 +1668,79 @@ std::shared_ptr<DataHandler> RequestLastJoinRunner::Run(
     }
 }
 
+std::shared_ptr<DataHandlerList> RequestLastJoinRunner::BatchRequestRun(
+    RunnerContext& ctx) {
+    if (need_batch_cache_ || producers_.size() < 2u ||
+        !join_gen_.index_key_gen_.Valid()) {
+        return Runner::BatchRequestRun(ctx);
+    }
+    if (need_cache_) {
+        auto cached = ctx.GetBatchCache(id_);
+        if (cached != nullptr) {
+            DLOG(INFO) << "RUNNER ID " << id_ << " HIT CACHE!";
+            return cached;
+        }
+    }
+    auto right_inputs = producers_[1]->BatchRequestRun(ctx);
+    auto left_inputs = producers_[0]->BatchRequestRun(ctx);
+    size_t request_size = ctx.GetRequestSize();
+
+    // the right partition has to be shared by all the requests
+    std::shared_ptr<PartitionHandler> partition;
+    std::vector<Row> left_rows;
+    if (request_size > 0 && right_inputs && left_inputs) {
+        auto right = right_inputs->Get(0);
+        if (right && kPartitionHandler == right->GetHanlderType()) {
+            partition = std::dynamic_pointer_cast<PartitionHandler>(right);
+        }
+        for (size_t idx = 0; partition && idx < request_size; idx++) {
+            auto left = left_inputs->Get(idx);
+            if (right_inputs->Get(idx) != right || !left ||
+                kRowHandler != left->GetHanlderType()) {
+                partition.reset();
+                break;
+            }
+            left_rows.push_back(
+                std::dynamic_pointer_cast<RowHandler>(left)->GetValue());
+        }
+    }
+    std::shared_ptr<DataHandlerVector> outputs =
+        std::make_shared<DataHandlerVector>();
+    std::vector<Row> joined_rows;
+    if (partition &&
+        join_gen_.RowLastJoinBatch(left_rows, partition, ctx.GetParameterRow(),
+                                   output_right_only_, &joined_rows)) {
+        for (const auto& row : joined_rows) {
+            outputs->Add(std::make_shared<MemRowHandler>(row));
+        }
+    } else {
+        std::vector<std::shared_ptr<DataHandler>> inputs;
+        for (size_t idx = 0; idx < request_size; idx++) {
+            inputs.clear();
+            inputs.push_back(left_inputs->Get(idx));
+            inputs.push_back(right_inputs->Get(idx));
+            outputs->Add(Run(ctx, inputs));
+        }
+    }
+    if (ctx.is_debug()) {
+        std::ostringstream oss;
+        oss << "RUNNER TYPE: " << RunnerTypeName(type_) << ", ID: " << id_
+            << "\n";
+        for (size_t idx = 0; idx < outputs->GetSize(); idx++) {
+            if (idx >= MAX_DEBUG_BATCH_SiZE) {
+                oss << ">= MAX_DEBUG_BATCH_SiZE...\n";
+                break;
+            }
+            Runner::PrintData(oss, output_schemas_, outputs->Get(idx));
+        }
+        LOG(INFO) << oss.str();
+    }
+    if (need_cache_) {
+        ctx.SetBatchCache(id_, outputs);
+    }
+    return outputs;
+}
+
 std::shared_ptr<DataHandler> LastJoinRunner::Run(RunnerContext& ctx,
                                                  const std::vector<std::shared_ptr<DataHandler>>& inputs) {
     auto fail_ptr = std::shared_ptr<DataHandler>();
@@ -1606,6 +1762,18 @@ std::shared_ptr<DataHandler> LastJoinRunner::Run(RunnerContext& ctx,
 
     switch (left->GetHanlderType()) {
         case kTableHandler: {
+            if (hash_join_ && join_gen_.CanHashJoin() &&
+                kTableHandler == right->GetHanlderType()) {
+                auto left_table = std::dynamic_pointer_cast<TableHandler>(left);
+                auto output_table = std::make_shared<MemTimeTableHandler>();
+                output_table->SetOrderType(left_table->GetOrderType());
+                if (!join_gen_.HashTableJoin(
+                        left_table, std::dynamic_pointer_cast<TableHandler>(right),
+                        parameter, output_table)) {
+                    return fail_ptr;
+                }
+                return output_table;
+            }
             if (join_gen_.right_group_gen_.Valid()) {
                 right = join_gen_.right_group_gen_.Partition(right, parameter);
             }
@@ -1763,6 +1931,39 @@ std::shared_ptr<PartitionHandler> PartitionGenerator::Partition(
     output_partitions->SetOrderType(table->GetOrderType());
     return output_partitions;
 }
+std::shared_ptr<PartitionHandler> PartitionGenerator::HashPartition(
+    std::shared_ptr<TableHandler> table, const Row& parameter) {
+    auto fail_ptr = std::shared_ptr<PartitionHandler>();
+    if (!key_gen_.Valid() || !table) {
+        return fail_ptr;
+    }
+    auto iter = table->GetIterator();
+    if (!iter) {
+        LOG(WARNING) << "Fail to group empty table: table is empty";
+        return fail_ptr;
+    }
+    KeyIndexTable index;
+    std::vector<MemTimeTable> segments;
+    iter->SeekToFirst();
+    while (iter->Valid()) {
+        std::string keys = key_gen_.Gen(iter->GetValue(), parameter);
+        bool inserted = false;
+        uint32_t idx = index.FindOrInsert(base::Slice(keys), &inserted);
+        if (inserted) {
+            segments.emplace_back();
+        }
+        segments[idx].emplace_back(iter->GetKey(), iter->GetValue());
+        iter->Next();
+    }
+    auto output_partitions = std::shared_ptr<MemPartitionHandler>(
+        new MemPartitionHandler(table->GetSchema()));
+    for (uint32_t idx = 0; idx < segments.size(); ++idx) {
+        output_partitions->AddSegment(index.GetKey(idx).ToString(),
+                                      std::move(segments[idx]));
+    }
+    output_partitions->SetOrderType(table->GetOrderType());
+    return output_partitions;
+}
 std::shared_ptr<DataHandler> SortGenerator::Sort(
     std::shared_ptr<DataHandler> input, const bool reverse) {
     if (!input || !is_valid_ || !order_gen_.Valid()) {
@@ -1883,13 +2084,40 @@ std::shared_ptr<TableHandler> SortGenerator::Sort(
 }
 Row JoinGenerator::RowLastJoinDropLeftSlices(
     const Row& left_row, std::shared_ptr<DataHandler> right, const Row& parameter) {
-    Row joined = RowLastJoin(left_row, right, parameter);
+    return DropLeftSlices(RowLastJoin(left_row, right, parameter));
+}
+Row JoinGenerator::DropLeftSlices(const Row& joined) {
     Row right_row(joined.GetSlice(left_slices_));
     for (size_t offset = 1; offset < right_slices_; offset++) {
         right_row.Append(joined.GetSlice(left_slices_ + offset));
     }
     return right_row;
 }
+bool JoinGenerator::RowLastJoinBatch(const std::vector<Row>& left_rows,
+                                     std::shared_ptr<PartitionHandler> partition,
+                                     const Row& parameter,
+                                     bool drop_left_slices,
+                                     std::vector<Row>* outputs) {
+    if (!index_key_gen_.Valid() || !partition) {
+        return false;
+    }
+    std::vector<std::string> keys;
+    keys.reserve(left_rows.size());
+    for (const auto& left_row : left_rows) {
+        keys.push_back(index_key_gen_.Gen(left_row, parameter));
+    }
+    auto segments = partition->GetSegments(keys);
+    if (segments.size() != left_rows.size()) {
+        return false;
+    }
+    outputs->clear();
+    outputs->reserve(left_rows.size());
+    for (size_t i = 0; i < left_rows.size(); i++) {
+        Row joined = RowLastJoinTable(left_rows[i], segments[i], parameter);
+        outputs->push_back(drop_left_slices ? DropLeftSlices(joined) : joined);
+    }
+    return true;
+}
 Row JoinGenerator::RowLastJoin(const Row& left_row,
                                std::shared_ptr<DataHandler> right,
                                const Row& parameter) {
@@ -2035,6 +2263,108 @@ bool JoinGenerator::TableJoin(std::shared_ptr<TableHandler> left,
     return true;
 }
 
+bool JoinGenerator::HashTableJoin(std::shared_ptr<TableHandler> left,
+                                  std::shared_ptr<TableHandler> right,
+                                  const Row& parameter,
+                                  std::shared_ptr<MemTimeTableHandler> output) {
+    auto left_iter = left->GetIterator();
+    auto right_iter = right->GetIterator();
+    if (!left_iter || !right_iter) {
+        LOG(WARNING) << "fail to run hash join: left or right input empty";
+        return false;
+    }
+    HashJoinBuildTable build_table(
+        FLAGS_batch_hash_join_memory_limit_mb << 20,
+        FLAGS_batch_hash_join_spill_dir, right->GetOrderType());
+    right_iter->SeekToFirst();
+    while (right_iter->Valid()) {
+        if (!build_table.Add(
+                right_group_gen_.GetKey(right_iter->GetValue(), parameter),
+                right_iter->GetKey(), right_iter->GetValue())) {
+            LOG(WARNING) << "fail to run hash join: fail to build right table";
+            return false;
+        }
+        right_iter->Next();
+    }
+
+    // the left keys are kept in an arena to probe each spilled partition
+    openmldb::base::ByteMemoryPool key_pool;
+    std::vector<base::Slice> left_keys;
+    std::vector<uint64_t> left_ts;
+    std::vector<Row> left_rows;
+    left_iter->SeekToFirst();
+    while (left_iter->Valid()) {
+        const Row& left_row = left_iter->GetValue();
+        std::string key = left_key_gen_.Gen(left_row, parameter);
+        char* buf = key_pool.Alloc(key.size());
+        memcpy(buf, key.data(), key.size());
+        left_keys.emplace_back(buf, key.size());
+        left_ts.push_back(left_iter->GetKey());
+        left_rows.push_back(left_row);
+        left_iter->Next();
+    }
+
+    // the left rows of each partition, so a partition probes only its rows
+    std::vector<std::vector<uint32_t>> partition_rows(
+        build_table.GetPartitionNum());
+    for (uint32_t i = 0; i < left_rows.size(); ++i) {
+        partition_rows[build_table.GetPartition(left_keys[i])].push_back(i);
+    }
+    std::vector<Row> joined_rows(left_rows.size());
+    for (uint32_t partition = 0; partition < build_table.GetPartitionNum();
+         ++partition) {
+        if (!build_table.LoadPartition(partition)) {
+            LOG(WARNING) << "fail to run hash join: fail to load partition "
+                         << partition;
+            return false;
+        }
+        // the segments are sorted once on their first probe
+        std::vector<bool> sorted(build_table.GetSegmentCnt(), false);
+        for (uint32_t i : partition_rows[partition]) {
+            uint32_t idx = build_table.Find(left_keys[i]);
+            if (KeyIndexTable::kNotFound == idx) {
+                joined_rows[i] =
+                    Row(left_slices_, left_rows[i], right_slices_, Row());
+                continue;
+            }
+            auto& segment = build_table.GetSegment(idx);
+            if (!sorted[idx]) {
+                segment = right_sort_gen_.Sort(segment, true);
+                sorted[idx] = true;
+            }
+            joined_rows[i] = LastJoinSortedTable(left_rows[i], segment,
+                                                 parameter);
+        }
+    }
+    for (size_t i = 0; i < left_rows.size(); ++i) {
+        output->AddRow(left_ts[i], joined_rows[i]);
+    }
+    return true;
+}
+
+Row JoinGenerator::LastJoinSortedTable(const Row& left_row,
+                                       std::shared_ptr<TableHandler> table,
+                                       const Row& parameter) {
+    if (!table) {
+        return Row(left_slices_, left_row, right_slices_, Row());
+    }
+    auto right_iter = table->GetIterator();
+    if (!right_iter) {
+        return Row(left_slices_, left_row, right_slices_, Row());
+    }
+    right_iter->SeekToFirst();
+    while (right_iter->Valid()) {
+        Row joined_row(left_slices_, left_row, right_slices_,
+                       right_iter->GetValue());
+        if (!condition_gen_.Valid() ||
+            condition_gen_.Gen(joined_row, parameter)) {
+            return joined_row;
+        }
+        right_iter->Next();
+    }
+    return Row(left_slices_, left_row, right_slices_, Row());
+}
+
 bool JoinGenerator::PartitionJoin(std::shared_ptr<PartitionHandler> left,
                                   std::shared_ptr<TableHandler> right,
                                   const Row& parameter,
@@ -2651,6 +2981,10 @@ std::shared_ptr<DataHandler> GroupAggRunner::Run(
             return std::shared_ptr<DataHandler>();
         }
         iter->SeekToFirst();
+        uint32_t parallelism = limit_cnt_ > 0 ? 1 : ctx.GetParallelism();
+        if (parallelism > 1) {
+            return ParallelRun(partition, iter.get(), parameter, parallelism);
+        }
         int32_t cnt = 0;
         while (iter->Valid()) {
             if (limit_cnt_ > 0 && cnt++ >= limit_cnt_) {
@@ -2659,7 +2993,7 @@ std::shared_ptr<DataHandler> GroupAggRunner::Run(
             auto key = iter->GetKey().ToString();
             auto segment = partition->GetSegment(key);
             if (!segment) {
-                LOG(WARNING) << "group aggregation fail: segment segment is null";
+                LOG(WARNING) << "group aggregation fail: segment is null";
                 return std::shared_ptr<DataHandler>();
             }
             if (!having_condition_.Valid() || having_condition_.Gen(segment, parameter)) {
@@ -2674,43 +3008,128 @@ std::shared_ptr<DataHandler> GroupAggRunner::Run(
     }
 }
 
+std::shared_ptr<DataHandler> GroupAggRunner::ParallelRun(
+    std::shared_ptr<PartitionHandler> partition, WindowIterator* iter,
+    const Row& parameter, uint32_t parallelism) {
+    auto keys = GetPartitionKeys(iter);
+    size_t morsel_cnt = MorselExecutor::GetMorselCnt(keys.size(), parallelism);
+    std::vector<std::shared_ptr<MemTableHandler>> morsel_outputs(morsel_cnt);
+    std::atomic<bool> failed(false);
+    MorselExecutor::GetInstance()->Run(
+        morsel_cnt, parallelism, [&](size_t morsel) {
+            auto morsel_output = std::make_shared<MemTableHandler>();
+            for (size_t i = keys.size() * morsel / morsel_cnt;
+                 i < keys.size() * (morsel + 1) / morsel_cnt; ++i) {
+                auto segment = partition->GetSegment(keys[i]);
+                if (!segment) {
+                    LOG(WARNING) << "group aggregation fail: segment is null";
+                    failed.store(true, std::memory_order_relaxed);
+                    return;
+                }
+                if (!having_condition_.Valid() ||
+                    having_condition_.Gen(segment, parameter)) {
+                    morsel_output->AddRow(agg_gen_.Gen(parameter, segment));
+                }
+            }
+            morsel_outputs[morsel] = morsel_output;
+        });
+    if (failed.load()) {
+        return std::shared_ptr<DataHandler>();
+    }
+    auto output_table = std::make_shared<MemTableHandler>();
+    for (auto& morsel_output : morsel_outputs) {
+        output_table->AddRows(*morsel_output);
+    }
+    return output_table;
+}
+
 bool RequestAggUnionRunner::InitAggregator() {
-    auto func_name = func_->GetName();
-    auto type_it = agg_type_map_.find(func_name);
-    if (type_it == agg_type_map_.end()) {
-        LOG(ERROR) << "RequestAggUnionRunner does not support for op " << func_name;
+    if (calls_.empty() || producers_.size() != calls_.size() + 2) {
+        LOG(ERROR) << "RequestAggUnionRunner has " << calls_.size() << " aggregate calls but " << producers_.size()
+                   << " producers";
+        return false;
+    }
+    auto& output_schema = *output_schemas_->GetOutputSchema();
+    if (output_schema.size() != static_cast<int>(calls_.size())) {
+        LOG(ERROR) << "RequestAggUnionRunner output schema size " << output_schema.size()
+                   << " != aggregate calls size " << calls_.size();
+        return false;
+    }
+    for (size_t i = 0; i < calls_.size(); i++) {
+        if (!InitAggregator(i, &calls_[i])) {
+            return false;
+        }
+    }
+    if (calls_.size() > 1) {
+        row_builder_ = std::make_unique<codec::RowBuilder>(output_schema);
+    }
+    return true;
+}
+
+bool RequestAggUnionRunner::InitAggregator(size_t idx, AggrCall* call) {
+    auto func_name = call->func->GetName();
+    std::vector<std::string> args;
+    if (!base::ParsePreAggrFunc(func_name, &call->agg_func) ||
+        !base::SplitPreAggrArgs(call->agg_args, call->agg_func, &args)) {
+        LOG(ERROR) << "RequestAggUnionRunner does not support for op " << func_name << "(" << call->agg_args << ")";
         return false;
     }
+    const auto& agg_func = call->agg_func;
 
-    agg_type_ = type_it->second;
+    auto row_parser = producers_[1]->row_parser();
     type::Type agg_col_type;
-    if (agg_col_->GetExprType() == node::kExprColumnRef) {
-        agg_col_type = producers_[1]->row_parser()->GetType(agg_col_name_);
-    } else if (agg_col_->GetExprType() == node::kExprAll) {
-        if (agg_type_ != kCount) {
-            LOG(ERROR) << "only support " << ExprTypeName(agg_col_->GetExprType()) << "on count op";
+    if (call->agg_col->GetExprType() == node::kExprColumnRef) {
+        agg_col_type = row_parser->GetType(call->agg_col_name);
+    } else if (call->agg_col->GetExprType() == node::kExprAll) {
+        if (agg_func.kind != base::PreAggrKind::kCount || agg_func.has_cate) {
+            LOG(ERROR) << "only support " << ExprTypeName(call->agg_col->GetExprType()) << "on count op";
             return false;
         }
         agg_col_type = type::Type::kInt64;
     } else {
-        LOG(ERROR) << "non-support aggr expr type " << ExprTypeName(agg_col_->GetExprType());
+        LOG(ERROR) << "non-support aggr expr type " << ExprTypeName(call->agg_col->GetExprType());
         return false;
     }
-    switch (agg_type_) {
-        case kSum:
-            aggregator_ = MakeOverflowAggregator<SumAggregator>(agg_col_type, *output_schemas_->GetOutputSchema());
+    if (agg_func.has_cond) {
+        call->cond = std::make_unique<base::PreAggrCondition>();
+        if (!call->cond->Parse(args[agg_func.CondPos()])) {
+            LOG(ERROR) << "RequestAggUnionRunner does not support for condition " << args[agg_func.CondPos()];
+            return false;
+        }
+        call->cond_col_type = row_parser->GetType(call->cond->column());
+    }
+
+    // the aggregator outputs the idx-th column only
+    *call->output_schema.Add() = output_schemas_->GetOutputSchema()->Get(idx);
+    auto& output_schema = call->output_schema;
+    if (agg_func.has_cate) {
+        call->cate_col_name = args[agg_func.CatePos()];
+        call->aggregator = std::make_unique<CateAggregator>(row_parser->GetType(call->cate_col_name), output_schema,
+                                                            agg_func.kind, agg_col_type);
+        return true;
+    }
+    switch (agg_func.kind) {
+        case base::PreAggrKind::kSum:
+            call->aggregator = MakeOverflowAggregator<SumAggregator>(agg_col_type, output_schema);
+            return true;
+        case base::PreAggrKind::kAvg:
+            call->aggregator = std::make_unique<AvgAggregator>(agg_col_type, output_schema);
+            return true;
+        case base::PreAggrKind::kCount:
+            call->aggregator = std::make_unique<CountAggregator>(agg_col_type, output_schema);
             return true;
-        case kAvg:
-            aggregator_ = std::make_unique<AvgAggregator>(agg_col_type, *output_schemas_->GetOutputSchema());
+        case base::PreAggrKind::kMin:
+            call->aggregator = MakeSameTypeAggregator<MinAggregator>(agg_col_type, output_schema);
             return true;
-        case kCount:
-            aggregator_ = std::make_unique<CountAggregator>(agg_col_type, *output_schemas_->GetOutputSchema());
+        case base::PreAggrKind::kMax:
+            call->aggregator = MakeSameTypeAggregator<MaxAggregator>(agg_col_type, output_schema);
             return true;
-        case kMin:
-            aggregator_ = MakeSameTypeAggregator<MinAggregator>(agg_col_type, *output_schemas_->GetOutputSchema());
+        case base::PreAggrKind::kDistinctCount:
+            call->aggregator = std::make_unique<DistinctCountAggregator>(agg_col_type, output_schema);
             return true;
-        case kMax:
-            aggregator_ = MakeSameTypeAggregator<MaxAggregator>(agg_col_type, *output_schemas_->GetOutputSchema());
+        case base::PreAggrKind::kTopNFrequency:
+            call->aggregator =
+                std::make_unique<TopNFrequencyAggregator>(agg_col_type, output_schema, std::stoll(args[1]));
             return true;
         default:
             LOG(ERROR) << "RequestAggUnionRunner does not support for op " << func_name;
@@ -2722,16 +3141,16 @@ std::shared_ptr<DataHandler> RequestAggUnionRunner::Run(
     RunnerContext& ctx,
     const std::vector<std::shared_ptr<DataHandler>>& inputs) {
     auto fail_ptr = std::shared_ptr<DataHandler>();
-    if (inputs.size() < 3u) {
-        LOG(WARNING) << "inputs size < 3";
+    if (inputs.size() < calls_.size() + 2) {
+        LOG(WARNING) << "inputs size < " << calls_.size() + 2;
         return std::shared_ptr<DataHandler>();
     }
-    auto request_handler = inputs[0];
-    auto base_handler = inputs[1];
-    auto agg_handler = inputs[2];
-    if (!request_handler || !base_handler || !agg_handler) {
-        return std::shared_ptr<DataHandler>();
+    for (const auto& input : inputs) {
+        if (!input) {
+            return std::shared_ptr<DataHandler>();
+        }
     }
+    auto request_handler = inputs[0];
     if (kRowHandler != request_handler->GetHanlderType()) {
         return std::shared_ptr<DataHandler>();
     }
@@ -2751,15 +3170,25 @@ std::shared_ptr<DataHandler> RequestAggUnionRunner::Run(
 
     auto& key_gen = windows_union_gen_.windows_gen_[0].index_seek_gen_.index_key_gen_;
     std::string key = key_gen.Gen(request, ctx.GetParameterRow());
-    // do not use codegen to gen the union outputs for aggr segment
-    union_inputs.pop_back();
-
+    // do not use codegen to gen the union outputs for aggr segments
+    std::vector<std::shared_ptr<DataHandler>> base_inputs(union_inputs.begin(), union_inputs.begin() + 1);
     auto union_segments =
-        windows_union_gen_.GetRequestWindows(request, ctx.GetParameterRow(), union_inputs);
+        windows_union_gen_.GetRequestWindows(request, ctx.GetParameterRow(), base_inputs);
     // code_gen result of agg_segment is not correct. we correct the result here
-    auto agg_segment = std::dynamic_pointer_cast<PartitionHandler>(union_inputs[1])->GetSegment(key);
-    if (agg_segment) {
-        union_segments.emplace_back(agg_segment);
+    std::vector<std::shared_ptr<PartitionHandler>> agg_partitions;
+    std::vector<std::shared_ptr<TableHandler>> agg_segments;
+    for (size_t i = 1; i < union_inputs.size(); i++) {
+        auto agg_partition = std::dynamic_pointer_cast<PartitionHandler>(union_inputs[i]);
+        auto agg_segment = agg_partition ? agg_partition->GetSegment(key) : std::shared_ptr<TableHandler>();
+        if (!agg_segment) {
+            break;
+        }
+        agg_partitions.push_back(agg_partition);
+        agg_segments.push_back(agg_segment);
+    }
+    bool has_agg_segments = agg_segments.size() == calls_.size();
+    if (has_agg_segments) {
+        union_segments.insert(union_segments.end(), agg_segments.begin(), agg_segments.end());
     }
 
     if (ctx.is_debug()) {
@@ -2774,9 +3203,12 @@ std::shared_ptr<DataHandler> RequestAggUnionRunner::Run(
 
     // build window with start and end offset
     std::shared_ptr<TableHandler> window;
-    if (agg_segment) {
-        window = RequestUnionWindow(request, union_segments, ts_gen, range_gen_.window_range_, output_request_row_,
-                                    exclude_current_time_);
+    if (has_agg_segments) {
+        window = IncrementalAggrWindow(request, agg_partitions, key, ts_gen);
+        if (!window) {
+            window = RequestUnionWindow(request, union_segments, ts_gen, range_gen_.window_range_,
+                                        output_request_row_, exclude_current_time_);
+        }
     } else {
         LOG(WARNING) << "Aggr segment is empty. Fall back to normal RequestUnionRunner";
         window = RequestUnionRunner::RequestUnionWindow(request, union_segments, ts_gen, range_gen_.window_range_,
@@ -2791,15 +3223,359 @@ std::shared_ptr<DataHandler> RequestAggUnionRunner::Run(
     return window;
 }
 
+std::shared_ptr<TableHandler> RequestAggUnionRunner::IncrementalAggrWindow(
+    const Row& request, const std::vector<std::shared_ptr<PartitionHandler>>& agg_partitions,
+    const std::string& key, int64_t request_ts) {
+    const WindowRange& window_range = range_gen_.window_range_;
+    // only the time range window without row limit can be aggregated incrementally
+    if (agg_partitions.size() != calls_.size() || request_ts < 0 ||
+        window_range.frame_type_ != Window::kFrameRowsRange || window_range.max_size_ > 0) {
+        return nullptr;
+    }
+    for (const auto& call : calls_) {
+        if (call.agg_func.HasState()) {
+            return nullptr;
+        }
+    }
+    int64_t start = (request_ts + window_range.start_offset_) < 0 ? 0 : (request_ts + window_range.start_offset_);
+    int64_t end = 0;
+    if (exclude_current_time_ && 0 == window_range.end_offset_) {
+        end = (request_ts - 1) < 0 ? 0 : (request_ts - 1);
+    } else {
+        end = (request_ts + window_range.end_offset_) < 0 ? 0 : (request_ts + window_range.end_offset_);
+    }
+    // all the calls fall back to the window scan if any of them is not available
+    std::vector<std::string> agg_vals(calls_.size());
+    for (size_t i = 0; i < calls_.size(); i++) {
+        if (!agg_partitions[i] || !agg_partitions[i]->GetIncrementalAggr(key, start, end, &agg_vals[i])) {
+            return nullptr;
+        }
+    }
+    for (size_t i = 0; i < calls_.size(); i++) {
+        if (!agg_vals[i].empty()) {
+            calls_[i].aggregator->Update(agg_vals[i]);
+        }
+        if (output_request_row_) {
+            UpdateBaseAggregator(calls_[i], producers_[1]->row_parser(), request);
+        }
+    }
+    auto window_table = std::make_shared<MemTimeTableHandler>();
+    window_table->AddRow(start, OutputAggregators());
+    return window_table;
+}
+
+bool RequestAggUnionRunner::MatchCondition(const AggrCall& call, const RowParser* row_parser, const Row& row) const {
+    if (!call.cond) {
+        return true;
+    }
+    // the condition is not true if the value is null
+    const std::string& col = call.cond->column();
+    if (row_parser->IsNull(row, col)) {
+        return false;
+    }
+    switch (call.cond_col_type) {
+        case type::Type::kBool: {
+            bool val = false;
+            row_parser->GetValue(row, col, call.cond_col_type, &val);
+            return call.cond->Match(static_cast<int64_t>(val));
+        }
+        case type::Type::kInt16: {
+            int16_t val = 0;
+            row_parser->GetValue(row, col, call.cond_col_type, &val);
+            return call.cond->Match(static_cast<int64_t>(val));
+        }
+        case type::Type::kDate:
+        case type::Type::kInt32: {
+            int32_t val = 0;
+            row_parser->GetValue(row, col, call.cond_col_type, &val);
+            return call.cond->Match(static_cast<int64_t>(val));
+        }
+        case type::Type::kTimestamp:
+        case type::Type::kInt64: {
+            int64_t val = 0;
+            row_parser->GetValue(row, col, call.cond_col_type, &val);
+            return call.cond->Match(val);
+        }
+        case type::Type::kFloat: {
+            float val = 0;
+            row_parser->GetValue(row, col, call.cond_col_type, &val);
+            return call.cond->Match(static_cast<double>(val));
+        }
+        case type::Type::kDouble: {
+            double val = 0;
+            row_parser->GetValue(row, col, call.cond_col_type, &val);
+            return call.cond->Match(val);
+        }
+        case type::Type::kVarchar: {
+            std::string val;
+            row_parser->GetString(row, col, &val);
+            return call.cond->Match(val);
+        }
+        default:
+            return false;
+    }
+}
+
+bool RequestAggUnionRunner::GetKey(const RowParser* row_parser, const Row& row, const std::string& col,
+                                   std::string* key) const {
+    if (col.empty() || row_parser->IsNull(row, col)) {
+        return false;
+    }
+    auto type = row_parser->GetType(col);
+    base::PreAggrKeyType key_type = base::PreAggrKeyType::kUnknown;
+    switch (type) {
+        case type::Type::kBool:
+            key_type = base::PreAggrKeyType::kBool;
+            break;
+        case type::Type::kInt16:
+            key_type = base::PreAggrKeyType::kInt16;
+            break;
+        case type::Type::kDate:
+        case type::Type::kInt32:
+            key_type = base::PreAggrKeyType::kInt32;
+            break;
+        case type::Type::kTimestamp:
+        case type::Type::kInt64:
+            key_type = base::PreAggrKeyType::kInt64;
+            break;
+        case type::Type::kFloat:
+            key_type = base::PreAggrKeyType::kFloat;
+            break;
+        case type::Type::kDouble:
+            key_type = base::PreAggrKeyType::kDouble;
+            break;
+        case type::Type::kVarchar:
+            key_type = base::PreAggrKeyType::kString;
+            break;
+        default:
+            LOG(ERROR) << "Not support type: " << Type_Name(type);
+            return false;
+    }
+    return base::GetPreAggrKey(
+        key_type, [&](auto* val) { row_parser->GetValue(row, col, type, val); },
+        [&](std::string* str) { row_parser->GetString(row, col, str); }, key);
+}
+
+void RequestAggUnionRunner::UpdateBaseAggregator(const AggrCall& call, const RowParser* row_parser, const Row& row) {
+    if (!MatchCondition(call, row_parser, row)) {
+        return;
+    }
+    if (!call.agg_col_name.empty() && row_parser->IsNull(row, call.agg_col_name)) {
+        return;
+    }
+
+    auto type = call.aggregator->type();
+    auto aggregator = call.aggregator.get();
+    if (call.agg_func.has_cate) {
+        UpdateCateAggregator(call, row_parser, row);
+        return;
+    }
+    auto kind = call.agg_func.kind;
+    if (kind == base::PreAggrKind::kDistinctCount || kind == base::PreAggrKind::kTopNFrequency) {
+        std::string key;
+        if (!GetKey(row_parser, row, call.agg_col_name, &key)) {
+            return;
+        }
+        if (kind == base::PreAggrKind::kDistinctCount) {
+            dynamic_cast<DistinctCountAggregator*>(aggregator)->UpdateKey(key);
+        } else {
+            dynamic_cast<TopNFrequencyAggregator*>(aggregator)->UpdateKey(key);
+        }
+        return;
+    }
+    if (kind == base::PreAggrKind::kCount) {
+        dynamic_cast<Aggregator<int64_t>*>(aggregator)->UpdateValue(1);
+        return;
+    }
+    if (call.agg_col_name.empty()) {
+        return;
+    }
+    switch (type) {
+        case type::Type::kInt16: {
+            int16_t val = 0;
+            row_parser->GetValue(row, call.agg_col_name, type, &val);
+            AggregatorUpdate(aggregator, val);
+            break;
+        }
+        case type::Type::kDate:
+        case type::Type::kInt32: {
+            int32_t val = 0;
+            row_parser->GetValue(row, call.agg_col_name, type, &val);
+            AggregatorUpdate(aggregator, val);
+            break;
+        }
+        case type::Type::kTimestamp:
+        case type::Type::kInt64: {
+            int64_t val = 0;
+            row_parser->GetValue(row, call.agg_col_name, type, &val);
+            AggregatorUpdate(aggregator, val);
+            break;
+        }
+        case type::Type::kFloat: {
+            float val = 0;
+            row_parser->GetValue(row, call.agg_col_name, type, &val);
+            AggregatorUpdate(aggregator, val);
+            break;
+        }
+        case type::Type::kDouble: {
+            double val = 0;
+            row_parser->GetValue(row, call.agg_col_name, type, &val);
+            AggregatorUpdate(aggregator, val);
+            break;
+        }
+        case type::Type::kVarchar: {
+            std::string val;
+            row_parser->GetString(row, call.agg_col_name, &val);
+            AggregatorUpdate(aggregator, val);
+            break;
+        }
+        default:
+            LOG(ERROR) << "Not support type: " << Type_Name(type);
+            break;
+    }
+}
+
+void RequestAggUnionRunner::UpdateCateAggregator(const AggrCall& call, const RowParser* row_parser, const Row& row) {
+    std::string key;
+    if (!GetKey(row_parser, row, call.cate_col_name, &key)) {
+        return;
+    }
+    auto aggregator = dynamic_cast<CateAggregator*>(call.aggregator.get());
+    if (call.agg_col_name.empty()) {
+        aggregator->UpdateValue(key, 0);
+        return;
+    }
+    auto type = row_parser->GetType(call.agg_col_name);
+    switch (type) {
+        case type::Type::kInt16: {
+            int16_t val = 0;
+            row_parser->GetValue(row, call.agg_col_name, type, &val);
+            aggregator->UpdateValue(key, val);
+            break;
+        }
+        case type::Type::kInt32: {
+            int32_t val = 0;
+            row_parser->GetValue(row, call.agg_col_name, type, &val);
+            aggregator->UpdateValue(key, val);
+            break;
+        }
+        case type::Type::kTimestamp:
+        case type::Type::kInt64: {
+            int64_t val = 0;
+            row_parser->GetValue(row, call.agg_col_name, type, &val);
+            aggregator->UpdateValue(key, val);
+            break;
+        }
+        case type::Type::kFloat: {
+            float val = 0;
+            row_parser->GetValue(row, call.agg_col_name, type, &val);
+            aggregator->UpdateValue(key, val);
+            break;
+        }
+        case type::Type::kDouble: {
+            double val = 0;
+            row_parser->GetValue(row, call.agg_col_name, type, &val);
+            aggregator->UpdateValue(key, val);
+            break;
+        }
+        default:
+            // only the count of the category is needed by count_cate
+            if (call.agg_func.kind == base::PreAggrKind::kCount) {
+                aggregator->UpdateValue(key, 0);
+            } else {
+                LOG(ERROR) << "Not support type: " << Type_Name(type);
+            }
+            break;
+    }
+}
+
+Row RequestAggUnionRunner::OutputAggregators() {
+    if (calls_.size() == 1) {
+        return calls_[0].aggregator->Output();
+    }
+    // concat the single column outputs of the aggregators into one row
+    std::vector<Row> outputs;
+    outputs.reserve(calls_.size());
+    uint32_t str_len = 0;
+    for (auto& call : calls_) {
+        outputs.push_back(call.aggregator->Output());
+        const auto& row = outputs.back();
+        if (call.output_schema.Get(0).type() == type::kVarchar && row.size() > 0) {
+            codec::RowView view(call.output_schema, row.buf(), row.size());
+            if (!view.IsNULL(0)) {
+                const char* val = nullptr;
+                uint32_t len = 0;
+                view.GetString(0, &val, &len);
+                str_len += len;
+            }
+        }
+    }
+    uint32_t total_len = row_builder_->CalTotalLength(str_len);
+    int8_t* buf = static_cast<int8_t*>(malloc(total_len));
+    row_builder_->SetBuffer(buf, total_len);
+    for (size_t i = 0; i < calls_.size(); i++) {
+        const auto& row = outputs[i];
+        if (row.size() == 0) {
+            row_builder_->AppendNULL();
+            continue;
+        }
+        codec::RowView view(calls_[i].output_schema, row.buf(), row.size());
+        if (view.IsNULL(0)) {
+            row_builder_->AppendNULL();
+            continue;
+        }
+        auto type = calls_[i].output_schema.Get(0).type();
+        switch (type) {
+            case type::kBool:
+                row_builder_->AppendBool(view.GetBoolUnsafe(0));
+                break;
+            case type::kInt16:
+                row_builder_->AppendInt16(view.GetInt16Unsafe(0));
+                break;
+            case type::kInt32:
+                row_builder_->AppendInt32(view.GetInt32Unsafe(0));
+                break;
+            case type::kDate:
+                row_builder_->AppendDate(view.GetDateUnsafe(0));
+                break;
+            case type::kInt64:
+                row_builder_->AppendInt64(view.GetInt64Unsafe(0));
+                break;
+            case type::kTimestamp:
+                row_builder_->AppendTimestamp(view.GetTimestampUnsafe(0));
+                break;
+            case type::kFloat:
+                row_builder_->AppendFloat(view.GetFloatUnsafe(0));
+                break;
+            case type::kDouble:
+                row_builder_->AppendDouble(view.GetDoubleUnsafe(0));
+                break;
+            case type::kVarchar: {
+                const char* val = nullptr;
+                uint32_t len = 0;
+                view.GetString(0, &val, &len);
+                row_builder_->AppendString(val, len);
+                break;
+            }
+            default:
+                LOG(ERROR) << "Not support type: " << Type_Name(type);
+                row_builder_->AppendNULL();
+                break;
+        }
+    }
+    return Row(base::RefCountedSlice::CreateManaged(buf, total_len));
+}
+
 std::shared_ptr<TableHandler> RequestAggUnionRunner::RequestUnionWindow(
     const Row& request,
     std::vector<std::shared_ptr<TableHandler>> union_segments, int64_t ts_gen,
     const WindowRange& window_range, const bool output_request_row,
     const bool exclude_current_time) {
-    // TOOD(zhanghao): for now, we only support AggUnion with 1 base table and 1 agg table
+    // the base table is followed by one agg table for each aggregate call
     size_t unions_cnt = union_segments.size();
-    if (unions_cnt != 2) {
-        LOG(ERROR) << "Not support of RequestAggUnion with more than 2 unions";
+    if (unions_cnt != calls_.size() + 1) {
+        LOG(ERROR) << "Not support of RequestAggUnion with " << unions_cnt << " unions for " << calls_.size()
+                   << " aggregate calls";
         return nullptr;
     }
 
@@ -2807,13 +3583,14 @@ std::shared_ptr<TableHandler> RequestAggUnionRunner::RequestUnionWindow(
         LOG(ERROR) << "base table is empty";
         return nullptr;
     }
-    if (!union_segments[1]) {
-        LOG(ERROR) << "agg table is empty";
-        return nullptr;
+    for (size_t i = 1; i < unions_cnt; i++) {
+        if (!union_segments[i]) {
+            LOG(ERROR) << "agg table is empty";
+            return nullptr;
+        }
     }
 
     const auto base_row_parser = producers_[1]->row_parser();
-    const auto agg_row_parser = producers_[2]->row_parser();
 
     int64_t start = 0;
     int64_t end = INT64_MAX;
@@ -2837,73 +3614,19 @@ std::shared_ptr<TableHandler> RequestAggUnionRunner::RequestUnionWindow(
     }
     int64_t request_key = ts_gen > 0 ? ts_gen : 0;
 
-    auto update_base_aggregator = [row_parser = base_row_parser, this](const Row& row) {
-        if (!agg_col_name_.empty() && row_parser->IsNull(row, agg_col_name_)) {
-            return;
-        }
-
-        auto type = aggregator_->type();
-        auto aggregator = aggregator_.get();
-        if (agg_type_ == kCount) {
-            dynamic_cast<Aggregator<int64_t>*>(aggregator)->UpdateValue(1);
-            return;
-        }
-        if (agg_col_name_.empty()) {
-            return;
-        }
-        switch (type) {
-            case type::Type::kInt16: {
-                int16_t val = 0;
-                row_parser->GetValue(row, agg_col_name_, type, &val);
-                AggregatorUpdate(aggregator, val);
-                break;
-            }
-            case type::Type::kDate:
-            case type::Type::kInt32: {
-                int32_t val = 0;
-                row_parser->GetValue(row, agg_col_name_, type, &val);
-                AggregatorUpdate(aggregator, val);
-                break;
-            }
-            case type::Type::kTimestamp:
-            case type::Type::kInt64: {
-                int64_t val = 0;
-                row_parser->GetValue(row, agg_col_name_, type, &val);
-                AggregatorUpdate(aggregator, val);
-                break;
-            }
-            case type::Type::kFloat: {
-                float val = 0;
-                row_parser->GetValue(row, agg_col_name_, type, &val);
-                AggregatorUpdate(aggregator, val);
-                break;
-            }
-            case type::Type::kDouble: {
-                double val = 0;
-                row_parser->GetValue(row, agg_col_name_, type, &val);
-                AggregatorUpdate(aggregator, val);
-                break;
-            }
-            case type::Type::kVarchar: {
-                std::string val;
-                row_parser->GetString(row, agg_col_name_, &val);
-                AggregatorUpdate(aggregator, val);
-                break;
-            }
-            default:
-                LOG(ERROR) << "Not support type: " << Type_Name(type);
-                break;
-        }
+    auto update_base_aggregator = [row_parser = base_row_parser, this](const AggrCall& call, const Row& row) {
+        UpdateBaseAggregator(call, row_parser, row);
     };
 
-    auto update_agg_aggregator = [row_parser = agg_row_parser, this](const Row& row) {
+    auto update_agg_aggregator = [this](size_t idx, const Row& row) {
+        auto row_parser = producers_[idx + 2]->row_parser();
         if (row_parser->IsNull(row, "agg_val")) {
             return;
         }
 
         std::string agg_val;
         row_parser->GetString(row, "agg_val", &agg_val);
-        aggregator_->Update(agg_val);
+        calls_[idx].aggregator->Update(agg_val);
     };
 
     int64_t cnt = 0;
@@ -2911,7 +3634,9 @@ std::shared_ptr<TableHandler> RequestAggUnionRunner::RequestUnionWindow(
         cnt > rows_start_preceding, window_range.end_offset_ < 0,
         request_key < start);
     if (output_request_row) {
-        update_base_aggregator(request);
+        for (const auto& call : calls_) {
+            update_base_aggregator(call, request);
+        }
     }
     if (WindowRange::kInWindow == range_status) {
         cnt++;
@@ -2922,62 +3647,75 @@ std::shared_ptr<TableHandler> RequestAggUnionRunner::RequestUnionWindow(
     auto base_it = union_segments[0]->GetIterator();
     if (!base_it) {
         LOG(WARNING) << "Base window is empty.";
-        window_table->AddRow(start, aggregator_->Output());
+        window_table->AddRow(start, OutputAggregators());
         DLOG(INFO) << "REQUEST AGG UNION cnt = " << window_table->GetCount();
         return window_table;
     }
     base_it->Seek(end);
 
-    auto agg_it = union_segments[1]->GetIterator();
-    if (agg_it) {
-         agg_it->Seek(end);
-    } else {
-        LOG(WARNING) << "Agg window is empty. Use base window only";
-    }
+    // the i-th agg table covers [start_bases[i], end_bases[i]] of the window, and we'll iterate over the
+    // following ranges:
+    // - base(max(end_bases), end], which is not covered by any agg table
+    // - agg[start_bases[i], end_bases[i]] of each agg table
+    // - base[start, max(end_bases)], except [max(start_bases), min(end_bases)] which is covered by all the
+    //   agg tables. A row is aggregated by the i-th call only if it is out of [start_bases[i], end_bases[i]]
+    // so the base table is iterated once for all the calls, and the rows are counted in the order of time
+    size_t calls_cnt = calls_.size();
+    std::vector<std::unique_ptr<RowIterator>> agg_its(calls_cnt);
+    std::vector<int64_t> end_bases(calls_cnt, start);
+    std::vector<int64_t> start_bases(calls_cnt, start + 1);
+    for (size_t i = 0; i < calls_cnt; i++) {
+        const auto agg_row_parser = producers_[i + 2]->row_parser();
+        auto& agg_it = agg_its[i];
+        agg_it = union_segments[i + 1]->GetIterator();
+        if (!agg_it) {
+            LOG(WARNING) << "Agg window is empty. Use base window only";
+            continue;
+        }
+        agg_it->Seek(end);
+        if (!agg_it->Valid()) {
+            continue;
+        }
 
-    // we'll iterate over the following ranges:
-    // - base(end_base, end] if end_base < end
-    // - agg[start_base, end_base]
-    // - base[start, start_base) if start < start_base
-    int64_t end_base = start;
-    int64_t start_base = start + 1;
-    if (agg_it && agg_it->Valid()) {
         int64_t ts_start = agg_it->GetKey();
         int64_t ts_end = -1;
         agg_row_parser->GetValue(agg_it->GetValue(), "ts_end", type::Type::kTimestamp, &ts_end);
-
         if (ts_end > end) {  // [ts_start, ts_end] covers beyond the [start, end] region
-            end_base = ts_start;
+            end_bases[i] = ts_start;
             agg_it->Next();
             if (agg_it->Valid()) {
                 agg_row_parser->GetValue(agg_it->GetValue(), "ts_end", type::Type::kTimestamp, &ts_end);
-                end_base = ts_end;
+                end_bases[i] = ts_end;
             } else {
                 // only base table will be used
-                end_base = start;
-                start_base = start + 1;
+                end_bases[i] = start;
+                start_bases[i] = start + 1;
             }
         } else {
-            end_base = ts_end;
+            end_bases[i] = ts_end;
         }
     }
+    int64_t min_end_base = *std::min_element(end_bases.begin(), end_bases.end());
+    int64_t max_end_base = *std::max_element(end_bases.begin(), end_bases.end());
 
-    // iterate over base table from end (inclusive) to end_base (exclusive)
-    if (end_base < end) {
+    // iterate over base table from end (inclusive) to max_end_base (exclusive)
+    if (max_end_base < end) {
         while (base_it->Valid()) {
             if (max_size > 0 && cnt >= max_size) {
                 break;
             }
 
             int64_t ts = base_it->GetKey();
-            if (ts <= end_base) break;
+            if (ts <= max_end_base) break;
 
             auto range_status = window_range.GetWindowPositionStatus(cnt > rows_start_preceding, ts > end, ts < start);
             if (WindowRange::kExceedWindow == range_status) {
                 break;
             }
             if (WindowRange::kInWindow == range_status) {
-                update_base_aggregator(base_it->GetValue());
+                for (const auto& call : calls_) {
+                    update_base_aggregator(call, base_it->GetValue());
+                }
                 cnt++;
             }
 
@@ -2985,64 +3723,87 @@ std::shared_ptr<TableHandler> RequestAggUnionRunner::RequestUnionWindow(
         }
     }
 
-    // iterate over agg table from end_base until start (both inclusive)
-    int64_t last_ts_start = INT64_MAX;
-    while (agg_it && agg_it->Valid()) {
-        if (max_size > 0 && cnt >= max_size) {
-            break;
-        }
+    // iterate over each agg table from end_base until start (both inclusive).
+    // the rows are counted by the first agg table, the calls of the window with row limit
+    // are never merged into one node by the optimizer, so the others do not depend on the count
+    int64_t base_cnt = cnt;
+    for (size_t i = 0; i < calls_cnt; i++) {
+        const auto agg_row_parser = producers_[i + 2]->row_parser();
+        auto& agg_it = agg_its[i];
+        int64_t agg_cnt = base_cnt;
+        int64_t last_ts_start = INT64_MAX;
+        while (agg_it && agg_it->Valid()) {
+            if (max_size > 0 && agg_cnt >= max_size) {
+                break;
+            }
 
-        int64_t ts_start = agg_it->GetKey();
-        // for mem-table, updating will inserts duplicate entries
-        if (last_ts_start == ts_start) {
-            DLOG(INFO) << "Found duplicate entries in agg table for ts_start = " << ts_start;
-            continue;
-        }
-        last_ts_start = ts_start;
+            int64_t ts_start = agg_it->GetKey();
+            // for mem-table, updating will inserts duplicate entries
+            if (last_ts_start == ts_start) {
+                DLOG(INFO) << "Found duplicate entries in agg table for ts_start = " << ts_start;
+                agg_it->Next();
+                continue;
+            }
+            last_ts_start = ts_start;
+
+            const Row& row = agg_it->GetValue();
+            int64_t ts_end = -1;
+            agg_row_parser->GetValue(row, "ts_end", type::Type::kTimestamp, &ts_end);
+            int num_rows = 0;
+            agg_row_parser->GetValue(row, "num_rows", type::Type::kInt32, &num_rows);
+
+            // FIXME(zhanghao): check cnt and rows_start_preceding meanings
+            int next_incr = num_rows > 0 ? num_rows - 1 : 0;
+            auto range_status = window_range.GetWindowPositionStatus(agg_cnt + next_incr > rows_start_preceding,
+                                                                     ts_start > end, ts_start < start);
+            if ((max_size > 0 && agg_cnt + next_incr >= max_size) || WindowRange::kExceedWindow == range_status) {
+                start_bases[i] = ts_end + 1;
+                break;
+            }
+            if (WindowRange::kInWindow == range_status) {
+                update_agg_aggregator(i, row);
+                agg_cnt += num_rows;
+            }
 
-        const Row& row = agg_it->GetValue();
-        int64_t ts_end = -1;
-        agg_row_parser->GetValue(row, "ts_end", type::Type::kTimestamp, &ts_end);
-        int num_rows = 0;
-        agg_row_parser->GetValue(row, "num_rows", type::Type::kInt32, &num_rows);
-
-        // FIXME(zhanghao): check cnt and rows_start_preceding meanings
-        int next_incr = num_rows > 0 ? num_rows - 1 : 0;
-        auto range_status = window_range.GetWindowPositionStatus(cnt + next_incr > rows_start_preceding, ts_start > end,
-                                                                 ts_start < start);
-        if ((max_size > 0 && cnt + next_incr >= max_size) || WindowRange::kExceedWindow == range_status) {
-            start_base = ts_end + 1;
-            break;
+            start_bases[i] = ts_start;
+            agg_it->Next();
         }
-        if (WindowRange::kInWindow == range_status) {
-            update_agg_aggregator(row);
-            cnt += num_rows;
+        if (i == 0) {
+            cnt = agg_cnt;
         }
-
-        start_base = ts_start;
-        agg_it->Next();
     }
 
-    if (start_base > 0) {
-        // iterate over base table from start_base (exclusive) to start (inclusive)
-        base_it->Seek(start_base - 1);
-        while (base_it->Valid()) {
-            int64_t ts = base_it->GetKey();
-            auto range_status = window_range.GetWindowPositionStatus(static_cast<int64_t>(cnt) > rows_start_preceding,
-                                                                     ts > end, static_cast<int64_t>(ts) < start);
-            if (WindowRange::kExceedWindow == range_status) {
+    // the base rows newer than max_end_base have been iterated
+    int64_t max_start_base = *std::max_element(start_bases.begin(), start_bases.end());
+    base_it->Seek(max_end_base);
+    while (base_it->Valid()) {
+        int64_t ts = base_it->GetKey();
+        if (ts >= max_start_base && ts <= min_end_base) {
+            // covered by all the agg tables
+            if (max_start_base <= 0) {
                 break;
             }
-            if (WindowRange::kInWindow == range_status) {
-                update_base_aggregator(base_it->GetValue());
-                cnt++;
+            base_it->Seek(max_start_base - 1);
+            continue;
+        }
+        auto range_status = window_range.GetWindowPositionStatus(static_cast<int64_t>(cnt) > rows_start_preceding,
+                                                                 ts > end, static_cast<int64_t>(ts) < start);
+        if (WindowRange::kExceedWindow == range_status) {
+            break;
+        }
+        if (WindowRange::kInWindow == range_status) {
+            for (size_t i = 0; i < calls_cnt; i++) {
+                if (ts > end_bases[i] || ts < start_bases[i]) {
+                    update_base_aggregator(calls_[i], base_it->GetValue());
+                }
             }
-
-            base_it->Next();
+            cnt++;
         }
+
+        base_it->Next();
     }
 
-    window_table->AddRow(start, aggregator_->Output());
+    window_table->AddRow(start, OutputAggregators());
     DLOG(INFO) << "REQUEST AGG UNION cnt = " << window_table->GetCount();
     return window_table;
 }
@@ -3112,6 +3873,14 @@ std::shared_ptr<DataHandler> RequestUnionRunner::Run(
 
     int64_t ts_gen = range_gen_.Valid() ? range_gen_.ts_gen_.Gen(request) : -1;
 
+    if (shared_scan_) {
+        if (kTableHandler != right->GetHanlderType()) {
+            return std::shared_ptr<DataHandler>();
+        }
+        return RequestPrefixWindow(request, std::dynamic_pointer_cast<TableHandler>(right), ts_gen,
+                                   range_gen_.window_range_, output_request_row_, exclude_current_time_);
+    }
+
     // Prepare Union Window
     auto union_inputs = windows_union_gen_.RunInputs(ctx);
     auto union_segments =
@@ -3121,29 +3890,37 @@ std::shared_ptr<DataHandler> RequestUnionRunner::Run(
                               range_gen_.window_range_, output_request_row_,
                               exclude_current_time_);
 }
-std::shared_ptr<TableHandler> RequestUnionRunner::RequestUnionWindow(
-    const Row& request,
-    std::vector<std::shared_ptr<TableHandler>> union_segments, int64_t ts_gen,
-    const WindowRange& window_range, const bool output_request_row,
-    const bool exclude_current_time) {
-    uint64_t start = 0;
-    uint64_t end = UINT64_MAX;
-    uint64_t rows_start_preceding = 0;
-    uint64_t max_size = 0;
+// the bounds of the window of the request with timestamp ts_gen
+static void GetRequestWindowBound(int64_t ts_gen, const WindowRange& window_range, const bool exclude_current_time,
+                                  uint64_t* start, uint64_t* end, uint64_t* rows_start_preceding,
+                                  uint64_t* max_size) {
+    *start = 0;
+    *end = UINT64_MAX;
+    *rows_start_preceding = 0;
+    *max_size = 0;
     if (ts_gen >= 0) {
-        start = (ts_gen + window_range.start_offset_) < 0
-                    ? 0
-                    : (ts_gen + window_range.start_offset_);
+        *start = (ts_gen + window_range.start_offset_) < 0 ? 0 : (ts_gen + window_range.start_offset_);
         if (exclude_current_time && 0 == window_range.end_offset_) {
-            end = (ts_gen - 1) < 0 ? 0 : (ts_gen - 1);
+            *end = (ts_gen - 1) < 0 ? 0 : (ts_gen - 1);
         } else {
-            end = (ts_gen + window_range.end_offset_) < 0
-                      ? 0
-                      : (ts_gen + window_range.end_offset_);
+            *end = (ts_gen + window_range.end_offset_) < 0 ? 0 : (ts_gen + window_range.end_offset_);
         }
-        rows_start_preceding = window_range.start_row_;
-        max_size = window_range.max_size_;
+        *rows_start_preceding = window_range.start_row_;
+        *max_size = window_range.max_size_;
     }
+}
+
+std::shared_ptr<TableHandler> RequestUnionRunner::RequestUnionWindow(
+    const Row& request,
+    std::vector<std::shared_ptr<TableHandler>> union_segments, int64_t ts_gen,
+    const WindowRange& window_range, const bool output_request_row,
+    const bool exclude_current_time) {
+    uint64_t start;
+    uint64_t end;
+    uint64_t rows_start_preceding;
+    uint64_t max_size;
+    GetRequestWindowBound(ts_gen, window_range, exclude_current_time, &start, &end, &rows_start_preceding,
+                          &max_size);
     uint64_t request_key = ts_gen > 0 ? static_cast<uint64_t>(ts_gen) : 0;
 
     auto window_table =
@@ -3217,6 +3994,56 @@ std::shared_ptr<TableHandler> RequestUnionRunner::RequestUnionWindow(
     return window_table;
 }
 
+std::shared_ptr<TableHandler> RequestUnionRunner::RequestPrefixWindow(
+    const Row& request, std::shared_ptr<TableHandler> shared_window, int64_t ts_gen,
+    const WindowRange& window_range, const bool output_request_row, const bool exclude_current_time) {
+    uint64_t start;
+    uint64_t end;
+    uint64_t rows_start_preceding;
+    uint64_t max_size;
+    GetRequestWindowBound(ts_gen, window_range, exclude_current_time, &start, &end, &rows_start_preceding,
+                          &max_size);
+    uint64_t request_key = ts_gen > 0 ? static_cast<uint64_t>(ts_gen) : 0;
+
+    auto window_table = std::make_shared<MemTimeTableHandler>();
+    uint64_t cnt = 0;
+    auto range_status = window_range.GetWindowPositionStatus(
+        cnt > rows_start_preceding, window_range.end_offset_ < 0, request_key < start);
+    if (output_request_row) {
+        window_table->AddRow(request_key, request);
+    }
+    if (WindowRange::kInWindow == range_status) {
+        cnt++;
+    }
+    auto iter = shared_window ? shared_window->GetIterator() : nullptr;
+    if (!iter) {
+        return window_table;
+    }
+    iter->SeekToFirst();
+    // the shared window starts with the request row if it outputs it
+    if (output_request_row && iter->Valid()) {
+        iter->Next();
+    }
+    // the rows of the shared window are in the descending order and not after end already
+    while (iter->Valid()) {
+        if (max_size > 0 && cnt >= max_size) {
+            break;
+        }
+        uint64_t key = iter->GetKey();
+        auto range_status = window_range.GetWindowPositionStatus(cnt > rows_start_preceding, key > end, key < start);
+        if (WindowRange::kExceedWindow == range_status) {
+            break;
+        }
+        if (WindowRange::kInWindow == range_status) {
+            window_table->AddRow(key, iter->GetValue());
+            cnt++;
+        }
+        iter->Next();
+    }
+    DLOG(INFO) << "REQUEST UNION (shared scan) cnt = " << window_table->GetCount();
+    return window_table;
+}
+
 std::shared_ptr<DataHandler> PostRequestUnionRunner::Run(
     RunnerContext& ctx,
     const std::vector<std::shared_ptr<DataHandler>>& inputs) {
@@ -207,6 +207,10 @@ class PartitionGenerator {
         std::shared_ptr<PartitionHandler> table, const Row& parameter);
     std::shared_ptr<PartitionHandler> Partition(
         std::shared_ptr<TableHandler> table, const Row& parameter);
+    // Partition the table by grouping the rows in a hash table first, so the
+    // segments are built with one map insert per key instead of per row
+    std::shared_ptr<PartitionHandler> HashPartition(
+        std::shared_ptr<TableHandler> table, const Row& parameter);
     const std::string GetKey(const Row& row, const Row& parameter) { return key_gen_.Gen(row, parameter); }
 
  private:
@@ -674,9 +678,28 @@ class JoinGenerator {
                        std::shared_ptr<PartitionHandler> right,
                        const Row& parameter,
                        std::shared_ptr<MemPartitionHandler>);  // NOLINT
+    // whether the join can run as HashTableJoin, i.e. it is keyed by
+    // left_key_gen_ and right_group_gen_ only
+    bool CanHashJoin() const {
+        return left_key_gen_.Valid() && right_group_gen_.Valid() &&
+               !index_key_gen_.Valid();
+    }
+    // Join the left table with the right table grouped in a hash table by
+    // the right key, which spills to disk beyond
+    // FLAGS_batch_hash_join_memory_limit_mb
+    bool HashTableJoin(std::shared_ptr<TableHandler> left,
+                       std::shared_ptr<TableHandler> right,
+                       const Row& parameter,
+                       std::shared_ptr<MemTimeTableHandler> output);  // NOLINT
 
     Row RowLastJoin(const Row& left_row, std::shared_ptr<DataHandler> right, const Row& parameter);
     Row RowLastJoinDropLeftSlices(const Row& left_row, std::shared_ptr<DataHandler> right, const Row& parameter);
+    // Last join the left rows with the right partition, the segments of all
+    // the index keys are got from the partition in one batch
+    bool RowLastJoinBatch(const std::vector<Row>& left_rows,
+                          std::shared_ptr<PartitionHandler> partition,
+                          const Row& parameter, bool drop_left_slices,
+                          std::vector<Row>* outputs);
     ConditionGenerator condition_gen_;
     KeyGenerator left_key_gen_;
     PartitionGenerator right_group_gen_;
@@ -691,6 +714,11 @@ class JoinGenerator {
     Row RowLastJoinTable(const Row& left_row,
                          std::shared_ptr<TableHandler> table,
                          const Row& parameter);
+    Row DropLeftSlices(const Row& joined);
+    // join the first row of the sorted table which meets the condition
+    Row LastJoinSortedTable(const Row& left_row,
+                            std::shared_ptr<TableHandler> table,
+                            const Row& parameter);
 
     size_t left_slices_;
     size_t right_slices_;
@@ -741,14 +769,19 @@ class RequestRunner : public Runner {
 class GroupRunner : public Runner {
  public:
     GroupRunner(const int32_t id, const SchemasContext* schema,
-                const int32_t limit_cnt, const Key& group)
-        : Runner(id, kRunnerGroup, schema, limit_cnt), partition_gen_(group) {}
+                const int32_t limit_cnt, const Key& group,
+                const bool hash_group = false)
+        : Runner(id, kRunnerGroup, schema, limit_cnt),
+          partition_gen_(group),
+          hash_group_(hash_group) {}
     ~GroupRunner() {}
     std::shared_ptr<DataHandler> Run(
         RunnerContext& ctx,  // NOLINT
         const std::vector<std::shared_ptr<DataHandler>>& inputs)
         override;  // NOLINT
     PartitionGenerator partition_gen_;
+    // group the table input with PartitionGenerator::HashPartition
+    const bool hash_group_;
 };
 class FilterRunner : public Runner {
  public:
@@ -877,6 +910,12 @@ class GroupAggRunner : public Runner {
     KeyGenerator group_;
     ConditionGenerator having_condition_;
     AggGenerator agg_gen_;
+
+ private:
+    // aggregate the morsels of the keys from `iter` with the MorselExecutor
+    std::shared_ptr<DataHandler> ParallelRun(
+        std::shared_ptr<PartitionHandler> partition, WindowIterator* iter,
+        const Row& parameter, uint32_t parallelism);
 };
 class AggRunner : public Runner {
  public:
@@ -962,7 +1001,8 @@ class RequestUnionRunner : public Runner {
         : Runner(id, kRunnerRequestUnion, schema, limit_cnt),
           range_gen_(range),
           exclude_current_time_(exclude_current_time),
-          output_request_row_(output_request_row) {}
+          output_request_row_(output_request_row),
+          shared_scan_(false) {}
 
     std::shared_ptr<DataHandler> Run(
         RunnerContext& ctx,  // NOLINT
@@ -973,65 +1013,101 @@ class RequestUnionRunner : public Runner {
         std::vector<std::shared_ptr<TableHandler>> union_segments,
         int64_t request_ts, const WindowRange& window_range,
         const bool output_request_row, const bool exclude_current_time);
+    // build the window as a prefix of shared_window, which is the output of
+    // the request union of a covering frame over the same partition and order
+    static std::shared_ptr<TableHandler> RequestPrefixWindow(
+        const Row& request, std::shared_ptr<TableHandler> shared_window,
+        int64_t request_ts, const WindowRange& window_range,
+        const bool output_request_row, const bool exclude_current_time);
     void AddWindowUnion(const RequestWindowOp& window, Runner* runner) {
         windows_union_gen_.AddWindowUnion(window, runner);
     }
+    // the second producer is the request union of the shared scan instead of
+    // the table to union
+    void EnableSharedScan() { shared_scan_ = true; }
     RequestWindowUnionGenerator windows_union_gen_;
     RangeGenerator range_gen_;
     bool exclude_current_time_;
     bool output_request_row_;
+    bool shared_scan_;
 };
 
 class RequestAggUnionRunner : public Runner {
  public:
+    // the i-th aggregate call is func[i] on agg_cols[i] with the arguments agg_args[i],
+    // and it is computed from the pre-aggr table of the (i + 2)-th producer
     RequestAggUnionRunner(const int32_t id, const SchemasContext* schema, const int32_t limit_cnt, const Range& range,
-                          bool exclude_current_time, bool output_request_row, const node::FnDefNode* func,
-                          const node::ExprNode* agg_col)
+                          bool exclude_current_time, bool output_request_row,
+                          const std::vector<const node::FnDefNode*>& funcs,
+                          const std::vector<const node::ExprNode*>& agg_cols, const std::vector<std::string>& agg_args)
         : Runner(id, kRunnerRequestAggUnion, schema, limit_cnt),
           range_gen_(range),
           exclude_current_time_(exclude_current_time),
           output_request_row_(output_request_row),
-          func_(func),
-          agg_col_(agg_col) {
-    if (agg_col_->GetExprType() == node::kExprColumnRef) {
-        agg_col_name_ = dynamic_cast<const node::ColumnRefNode*>(agg_col_)->GetColumnName();
+          calls_(funcs.size()) {
+        for (size_t i = 0; i < calls_.size(); i++) {
+            auto& call = calls_[i];
+            call.func = funcs[i];
+            call.agg_col = agg_cols[i];
+            call.agg_args = agg_args[i];
+            if (call.agg_col->GetExprType() == node::kExprColumnRef) {
+                call.agg_col_name = dynamic_cast<const node::ColumnRefNode*>(call.agg_col)->GetColumnName();
+            }
+        }
     }
-}
 
     bool InitAggregator();
     std::shared_ptr<DataHandler> Run(RunnerContext& ctx,
                                      const std::vector<std::shared_ptr<DataHandler>>& inputs) override;
+    // union_segments are the base segment followed by the segments of the pre-aggr tables
     std::shared_ptr<TableHandler> RequestUnionWindow(
         const Row& request,
         std::vector<std::shared_ptr<TableHandler>> union_segments,
         int64_t request_ts, const WindowRange& window_range,
         const bool output_request_row, const bool exclude_current_time);
+    // build the window from the aggregates maintained incrementally by storage,
+    // return null if any of them is not available
+    std::shared_ptr<TableHandler> IncrementalAggrWindow(
+        const Row& request, const std::vector<std::shared_ptr<PartitionHandler>>& agg_partitions,
+        const std::string& key, int64_t request_ts);
     void AddWindowUnion(const RequestWindowOp& window, Runner* runner) {
         windows_union_gen_.AddWindowUnion(window, runner);
     }
 
  private:
-    enum AggType {
-        kSum,
-        kCount,
-        kAvg,
-        kMin,
-        kMax
+    // an aggregate call and the aggregator of it
+    struct AggrCall {
+        const node::FnDefNode* func = nullptr;
+        base::PreAggrFunc agg_func;
+        const node::ExprNode* agg_col = nullptr;
+        std::string agg_args;
+        std::string agg_col_name;
+        std::unique_ptr<base::PreAggrCondition> cond;
+        type::Type cond_col_type = type::Type::kBool;
+        std::string cate_col_name;
+        // the output column of the call, the aggregator refers to it
+        Schema output_schema;
+        std::unique_ptr<BaseAggregator> aggregator;
     };
 
-    static inline const std::unordered_map<std::string, AggType> agg_type_map_ = {
-        {"sum", kSum}, {"count", kCount}, {"avg", kAvg}, {"min", kMin}, {"max", kMax},
-    };
+    bool InitAggregator(size_t idx, AggrCall* call);
+    void UpdateBaseAggregator(const AggrCall& call, const RowParser* row_parser, const Row& row);
+    void UpdateCateAggregator(const AggrCall& call, const RowParser* row_parser, const Row& row);
+    // whether the row matches the condition of `*_where`
+    bool MatchCondition(const AggrCall& call, const RowParser* row_parser, const Row& row) const;
+    // get the key of the value of col in the format of pre-aggr table, return false if it is null
+    bool GetKey(const RowParser* row_parser, const Row& row, const std::string& col, std::string* key) const;
+    // the output row of all the aggregators, the aggregators are reset
+    Row OutputAggregators();
 
     RequestWindowUnionGenerator windows_union_gen_;
     RangeGenerator range_gen_;
     bool exclude_current_time_;
     bool output_request_row_;
-    const node::FnDefNode* func_ = nullptr;
-    AggType agg_type_;
-    const node::ExprNode* agg_col_ = nullptr;
-    std::string agg_col_name_;
-    std::unique_ptr<BaseAggregator> aggregator_ = nullptr;
+    // never resized after constructed as the aggregators refer to the output schemas
+    std::vector<AggrCall> calls_;
+    // the builder of the output row of multiple calls
+    std::unique_ptr<codec::RowBuilder> row_builder_;
 };
 
 class PostRequestUnionRunner : public Runner {
@@ -1053,9 +1129,11 @@ class LastJoinRunner : public Runner {
  public:
     LastJoinRunner(const int32_t id, const SchemasContext* schema,
                    const int32_t limit_cnt, const Join& join,
-                   size_t left_slices, size_t right_slices)
+                   size_t left_slices, size_t right_slices,
+                   const bool hash_join = false)
         : Runner(id, kRunnerLastJoin, schema, limit_cnt),
-          join_gen_(join, left_slices, right_slices) {}
+          join_gen_(join, left_slices, right_slices),
+          hash_join_(hash_join) {}
     ~LastJoinRunner() {}
     std::shared_ptr<DataHandler> Run(
         RunnerContext& ctx,  // NOLINT
@@ -1063,6 +1141,8 @@ class LastJoinRunner : public Runner {
         override;  // NOLINT
 
     JoinGenerator join_gen_;
+    // join the table inputs with JoinGenerator::HashTableJoin
+    const bool hash_join_;
 };
 class RequestLastJoinRunner : public Runner {
  public:
@@ -1078,6 +1158,10 @@ class RequestLastJoinRunner : public Runner {
     std::shared_ptr<DataHandler> Run(
         RunnerContext& ctx,                                        // NOLINT
         const std::vector<std::shared_ptr<DataHandler>>& inputs);  // NOLINT
+    // join the requests with the right partition shared by them in one
+    // batch, so the storage could get the segments of all keys together
+    std::shared_ptr<DataHandlerList> BatchRequestRun(
+        RunnerContext& ctx) override;  // NOLINT
     virtual void PrintRunnerInfo(std::ostream& output,
                                  const std::string& tab) const {
         output << tab << "[" << id_ << "]" << RunnerTypeName(type_);
@@ -1575,6 +1659,10 @@ class RunnerContext {
     void SetRequest(const hybridse::codec::Row& request);
     void SetRequests(const std::vector<hybridse::codec::Row>& requests);
     bool is_debug() const { return is_debug_; }
+    // the max number of threads to run a batch runner, e.g. the window
+    // aggregation over the keys of a partition
+    uint32_t GetParallelism() const { return parallelism_; }
+    void SetParallelism(uint32_t parallelism) { parallelism_ = parallelism; }
 
     const std::string& sp_name() { return sp_name_; }
     std::shared_ptr<DataHandler> GetCache(int64_t id) const;
@@ -1591,6 +1679,7 @@ class RunnerContext {
     hybridse::codec::Row parameter_;
     size_t idx_;
     const bool is_debug_;
+    uint32_t parallelism_ = 1;
     // TODO(chenjing): optimize
     std::map<int64_t, std::shared_ptr<DataHandler>> cache_;
     std::map<int64_t, std::shared_ptr<DataHandlerList>> batch_cache_;
@@ -132,6 +132,7 @@ bool SqlCompiler::Compile(SqlContext& ctx, Status& status) {  // NOLINT
     if (keep_ir_) {
         KeepIR(ctx, m.get());
     }
+    ctx.ir_instruction_cnt = m->getInstructionCount();
     if (!jit->AddModule(std::move(m), std::move(llvm_ctx))) {
         LOG(WARNING) << "fail to add ir module  for sql " << ctx.sql;
         return false;
@@ -184,6 +185,10 @@ Status SqlCompiler::BuildRequestModePhysicalPlan(SqlContext* ctx, const ::hybrid
         transformer.AddPass(passes::kPassLongWindowOptimized);
     }
     transformer.AddDefaultPasses();
+    if (ctx->enable_window_scan_sharing) {
+        // after the other passes, which may replace the request unions
+        transformer.AddPass(passes::kPassWindowScanSharing);
+    }
     CHECK_STATUS(transformer.TransformPhysicalPlan(plan_list, output),
                  "Fail to transform physical plan on request mode");
 
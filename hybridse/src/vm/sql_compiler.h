@@ -17,6 +17,8 @@
 #ifndef HYBRIDSE_SRC_VM_SQL_COMPILER_H_
 #define HYBRIDSE_SRC_VM_SQL_COMPILER_H_
 
+#include <algorithm>
+#include <atomic>
 #include <memory>
 #include <set>
 #include <string>
@@ -37,7 +39,8 @@ namespace vm {
 
 using hybridse::base::Status;
 
-struct SqlContext {
+// the inputs of the compiling, which is copied as a whole to recompile the sql
+struct SqlCompileInput {
     // mode: batch|request|batch request
     ::hybridse::vm::EngineMode engine_mode;
     bool is_cluster_optimized = false;
@@ -45,26 +48,39 @@ struct SqlContext {
     bool enable_expr_optimize = false;
     bool enable_batch_window_parallelization = true;
     bool enable_window_column_pruning = false;
+    bool enable_window_scan_sharing = false;
 
     // the sql content
     std::string sql;
     // the database
     std::string db;
+    // TODO(wangtaize) add a light jit engine
+    // eg using bthead to compile ir
+    hybridse::vm::JitOptions jit_options;
+    Schema parameter_types;
+
+    // the common column indices are set before the compiling, the other
+    // fields are set by it
+    ::hybridse::vm::BatchRequestInfo batch_request_info;
+
+    std::shared_ptr<const std::unordered_map<std::string, std::string>> options;
+};
+
+// the node manager owns the plan nodes, so the context is not copyable
+struct SqlContext : public SqlCompileInput {
     // the logical plan
     ::hybridse::node::PlanNodeList logical_plan;
     ::hybridse::vm::PhysicalOpNode* physical_plan = nullptr;
     hybridse::vm::ClusterJob cluster_job;
-    // TODO(wangtaize) add a light jit engine
-    // eg using bthead to compile ir
-    hybridse::vm::JitOptions jit_options;
     std::shared_ptr<hybridse::vm::HybridSeJitWrapper> jit = nullptr;
     Schema schema;
     Schema request_schema;
     std::string request_db_name;
     std::string request_name;
-    Schema parameter_types;
     uint32_t row_size;
     uint32_t limit_cnt = 0;
+    // the instructions of the module added to the jit
+    uint64_t ir_instruction_cnt = 0;
     std::string ir;
     std::string logical_plan_str;
     std::string physical_plan_str;
@@ -73,10 +89,6 @@ struct SqlContext {
     ::hybridse::node::NodeManager nm;
     ::hybridse::udf::UdfLibrary* udf_library = nullptr;
 
-    ::hybridse::vm::BatchRequestInfo batch_request_info;
-
-    std::shared_ptr<const std::unordered_map<std::string, std::string>> options;
-
     SqlContext() {}
     ~SqlContext() {}
 };
@@ -142,8 +154,56 @@ class SqlCompileInfo : public CompileInfo {
         return dynamic_cast<SqlCompileInfo*>(node);
     }
 
+    // the jit code is estimated by the instructions of the module and the
+    // plan by the nodes
+    size_t GetMemoryUsage() override {
+        return sizeof(SqlCompileInfo) + sql_ctx.sql.size() + sql_ctx.ir.size() +
+               sql_ctx.logical_plan_str.size() +
+               sql_ctx.physical_plan_str.size() +
+               sql_ctx.ir_instruction_cnt * kJitBytesPerInstruction +
+               sql_ctx.nm.GetNodeListSize() * kBytesPerNode;
+    }
+
+    // count a run of the compile result under tiered jit, return the count
+    uint64_t IncreaseHits() {
+        return hits_.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+    // the count of hits to schedule the recompiling, `threshold` until a
+    // recompiling fails
+    uint64_t GetTierUpHits(uint64_t threshold) const {
+        uint64_t hits = tier_up_hits_.load(std::memory_order_acquire);
+        return 0 == hits ? threshold : hits;
+    }
+    // retry the failed recompiling after `threshold << failures` more hits,
+    // it is called by the recompiling thread only
+    void BackOffTierUp(uint64_t threshold) {
+        tier_up_failures_ =
+            std::min<uint32_t>(tier_up_failures_ + 1, kMaxTierUpBackOff);
+        tier_up_hits_.store(hits_.load(std::memory_order_relaxed) +
+                                (threshold << tier_up_failures_),
+                            std::memory_order_release);
+    }
+    // the result recompiled with the aggressive opt level, null until the
+    // recompiling is done
+    std::shared_ptr<CompileInfo> GetOptimizedInfo() const {
+        return std::atomic_load_explicit(&optimized_info_,
+                                         std::memory_order_acquire);
+    }
+    void SetOptimizedInfo(const std::shared_ptr<CompileInfo>& info) {
+        std::atomic_store_explicit(&optimized_info_, info,
+                                   std::memory_order_release);
+    }
+
  private:
+    static constexpr size_t kJitBytesPerInstruction = 16;
+    static constexpr size_t kBytesPerNode = 256;
+    static constexpr uint32_t kMaxTierUpBackOff = 10;
+
     hybridse::vm::SqlContext sql_ctx;
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> tier_up_hits_{0};
+    uint32_t tier_up_failures_ = 0;
+    std::shared_ptr<CompileInfo> optimized_info_ = nullptr;
 };
 
 class SqlCompiler {
@@ -37,6 +37,7 @@
 #include "passes/physical/simple_project_optimized.h"
 #include "passes/physical/split_aggregation_optimized.h"
 #include "passes/physical/window_column_pruning.h"
+#include "passes/physical/window_scan_sharing.h"
 
 namespace hybridse {
 namespace vm {
@@ -55,6 +56,7 @@ using hybridse::passes::SimpleProjectOptimized;
 using hybridse::passes::WindowColumnPruning;
 using hybridse::passes::LongWindowOptimized;
 using hybridse::passes::SplitAggregationOptimized;
+using hybridse::passes::WindowScanSharing;
 
 std::ostream& operator<<(std::ostream& output,
                          const hybridse::vm::LogicalOp& thiz) {
@@ -282,8 +284,10 @@ Status BatchModeTransformer::InitFnInfo(PhysicalOpNode* node,
                 dynamic_cast<PhysicalRequestAggUnionNode*>(node);
             CHECK_STATUS(GenRequestWindow(&request_union_op->window_,
                                           node->producers()[0]));
-            CHECK_STATUS(GenRequestWindow(&request_union_op->agg_window_,
-                                          node->producers()[2]));
+            for (size_t i = 0; i < request_union_op->GetAggNum(); i++) {
+                CHECK_STATUS(GenRequestWindow(&request_union_op->agg_windows_[i],
+                                              node->producers()[i + 2]));
+            }
             break;
         }
         case kPhysicalOpPostRequestUnion: {
@@ -1333,6 +1337,14 @@ void BatchModeTransformer::ApplyPasses(PhysicalOpNode* node,
                 transformed = pass.Apply(cur_op, &new_op);
                 break;
             }
+            case PhysicalPlanPassType::kPassWindowScanSharing: {
+                // the shared scan runs in the same task as the windows sharing it
+                if (!cluster_optimized_mode_) {
+                    WindowScanSharing pass;
+                    transformed = pass.Apply(&plan_ctx_, cur_op, &new_op).isOK();
+                }
+                break;
+            }
             default: {
                 DLOG(WARNING) << "Invalid pass: "
                              << PhysicalPlanPassTypeName(type);
@@ -65,7 +65,8 @@ class TransformRequestModeTest : public ::testing::TestWithParam<SqlCase> {
 GTEST_ALLOW_UNINSTANTIATED_PARAMETERIZED_TEST(TransformRequestModeTest);
 void PhysicalPlanCheck(const std::shared_ptr<Catalog>& catalog, std::string sql, std::string exp,
                        const std::vector<passes::PhysicalPlanPassType>& extra_passes = {},
-                       const std::unordered_map<std::string, std::string>* options = nullptr) {
+                       const std::unordered_map<std::string, std::string>* options = nullptr,
+                       const std::vector<passes::PhysicalPlanPassType>& post_passes = {}) {
     const hybridse::base::Status exp_status(::hybridse::common::kOk, "ok");
 
     boost::to_lower(sql);
@@ -93,6 +94,9 @@ void PhysicalPlanCheck(const std::shared_ptr<Catalog>& catalog, std::string sql,
         transform.AddPass(pass);
     }
     transform.AddDefaultPasses();
+    for (auto pass : post_passes) {
+        transform.AddPass(pass);
+    }
 
     PhysicalOpNode* physical_plan = nullptr;
     auto s = transform.TransformPhysicalPlan(plan_trees, &physical_plan);
@@ -492,16 +496,10 @@ TEST_F(TransformRequestModePassOptimizedTest, SplitAggregationOptimizedTest) {
         "      REQUEST_JOIN(type=kJoinTypeConcat)\n"
         "        PROJECT(type=RowProject)\n"
         "          DATA_PROVIDER(request=t1)\n"
-        "        SIMPLE_PROJECT(sources=(sum(col2)over w1, count(col2)over w1))\n"
-        "          REQUEST_JOIN(type=kJoinTypeConcat)\n"
-        "            PROJECT(type=Aggregation)\n"
-        "              REQUEST_UNION(partition_keys=(), orders=(ASC), range=(col5, -180000, 0), index_keys=(col1))\n"
-        "                DATA_PROVIDER(request=t1)\n"
-        "                DATA_PROVIDER(type=Partition, table=t1, index=index1)\n"
-        "            PROJECT(type=Aggregation)\n"
-        "              REQUEST_UNION(partition_keys=(), orders=(ASC), range=(col5, -180000, 0), index_keys=(col1))\n"
-        "                DATA_PROVIDER(request=t1)\n"
-        "                DATA_PROVIDER(type=Partition, table=t1, index=index1)\n"
+        "        PROJECT(type=Aggregation)\n"
+        "          REQUEST_UNION(partition_keys=(), orders=(ASC), range=(col5, -180000, 0), index_keys=(col1))\n"
+        "            DATA_PROVIDER(request=t1)\n"
+        "            DATA_PROVIDER(type=Partition, table=t1, index=index1)\n"
         "      PROJECT(type=Aggregation)\n"
         "        REQUEST_UNION(partition_keys=(), orders=(ASC), range=(col5, -3, 0), index_keys=(col1,col2))\n"
         "          DATA_PROVIDER(request=t1)\n"
@@ -568,20 +566,13 @@ TEST_F(TransformRequestModePassOptimizedTest, LongWindowOptimizedTest) {
         "      REQUEST_JOIN(type=kJoinTypeConcat)\n"
         "        PROJECT(type=RowProject)\n"
         "          DATA_PROVIDER(request=t1)\n"
-        "        SIMPLE_PROJECT(sources=(sum(col2)over w1, count(col2)over w1))\n"
-        "          REQUEST_JOIN(type=kJoinTypeConcat)\n"
-        "            PROJECT(type=ReduceAggregation: sum(col2)over w1 (range[-180000,0]))\n"
-        "              REQUEST_AGG_UNION(partition_keys=(), orders=(ASC), range=(col5, -180000, 0), "
-        "index_keys=(col1))\n"
-        "                DATA_PROVIDER(request=t1)\n"
-        "                DATA_PROVIDER(type=Partition, table=t1, index=index1)\n"
-        "                DATA_PROVIDER(type=Partition, table=aggr_t1, index=index1_t2)\n"
-        "            PROJECT(type=ReduceAggregation: count(col2)over w1 (range[-180000,0]))\n"
-        "              REQUEST_AGG_UNION(partition_keys=(), orders=(ASC), range=(col5, -180000, 0), "
-        "index_keys=(col1))\n"
-        "                DATA_PROVIDER(request=t1)\n"
-        "                DATA_PROVIDER(type=Partition, table=t1, index=index1)\n"
-        "                DATA_PROVIDER(type=Partition, table=aggr_t1, index=index1_t2)\n"
+        "        PROJECT(type=ReduceAggregation: sum(col2)over w1 (range[-180000,0]), "
+        "count(col2)over w1 (range[-180000,0]))\n"
+        "          REQUEST_AGG_UNION(partition_keys=(), orders=(ASC), range=(col5, -180000, 0), index_keys=(col1))\n"
+        "            DATA_PROVIDER(request=t1)\n"
+        "            DATA_PROVIDER(type=Partition, table=t1, index=index1)\n"
+        "            DATA_PROVIDER(type=Partition, table=aggr_t1, index=index1_t2)\n"
+        "            DATA_PROVIDER(type=Partition, table=aggr_t1, index=index1_t2)\n"
         "      PROJECT(type=ReduceAggregation: sum(col2)over w2 (range[-3,0]))\n"
         "        REQUEST_AGG_UNION(partition_keys=(), orders=(ASC), range=(col5, -3, 0), index_keys=(col1,col2))\n"
         "          DATA_PROVIDER(request=t1)\n"
@@ -634,6 +625,62 @@ TEST_F(TransformRequestModePassOptimizedTest, LongWindowOptimizedTest) {
     PhysicalPlanCheck(catalog, sql, expected, extra_passes, &options);
 }
 
+TEST_F(TransformRequestModePassOptimizedTest, WindowScanSharingTest) {
+    // w3 is covered by w1 over the same partition and order, w2 is over another partition
+    const std::string sql =
+        "SELECT col1, sum(col2) OVER w1, col2+1, add(col2, col1), count(col2) OVER w1, "
+        "sum(col2) over w2 as w1_col2_sum , sum(col2) over w3 FROM t1\n"
+        "WINDOW w1 AS (PARTITION BY col1 ORDER BY col5 ROWS_RANGE BETWEEN 3m PRECEDING AND CURRENT ROW),"
+        "w2 AS (PARTITION BY col1,col2 ORDER BY col5 ROWS_RANGE BETWEEN 3 PRECEDING AND CURRENT ROW),"
+        "w3 AS (PARTITION BY col1 ORDER BY col5 ROWS_RANGE BETWEEN 3 PRECEDING AND CURRENT ROW);";
+
+    const std::string expected =
+        "SIMPLE_PROJECT(sources=(col1, sum(col2)over w1, col2 + 1, add(col2, col1), count(col2)over w1, w1_col2_sum, "
+        "sum(col2)over w3))\n"
+        "  REQUEST_JOIN(type=kJoinTypeConcat)\n"
+        "    REQUEST_JOIN(type=kJoinTypeConcat)\n"
+        "      REQUEST_JOIN(type=kJoinTypeConcat)\n"
+        "        PROJECT(type=RowProject)\n"
+        "          DATA_PROVIDER(request=t1)\n"
+        "        PROJECT(type=Aggregation)\n"
+        "          REQUEST_UNION(partition_keys=(), orders=(ASC), range=(col5, -180000, 0), index_keys=(col1))\n"
+        "            DATA_PROVIDER(request=t1)\n"
+        "            DATA_PROVIDER(type=Partition, table=t1, index=index1)\n"
+        "      PROJECT(type=Aggregation)\n"
+        "        REQUEST_UNION(partition_keys=(), orders=(ASC), range=(col5, -3, 0), index_keys=(col1,col2))\n"
+        "          DATA_PROVIDER(request=t1)\n"
+        "          DATA_PROVIDER(type=Partition, table=t1, index=index12)\n"
+        "    PROJECT(type=Aggregation)\n"
+        "      REQUEST_UNION(SHARED_SCAN(range=(col5, -180000, 0)), partition_keys=(), orders=(ASC), "
+        "range=(col5, -3, 0), index_keys=(col1))\n"
+        "        DATA_PROVIDER(request=t1)\n"
+        "        DATA_PROVIDER(type=Partition, table=t1, index=index1)";
+
+    std::shared_ptr<SimpleCatalog> catalog(new SimpleCatalog(true));
+    hybridse::type::TableDef table_def;
+    BuildTableDef(table_def);
+    table_def.set_name("t1");
+    {
+        ::hybridse::type::IndexDef* index = table_def.add_indexes();
+        index->set_name("index12");
+        index->add_first_keys("col1");
+        index->add_first_keys("col2");
+        index->set_second_key("col5");
+    }
+    {
+        ::hybridse::type::IndexDef* index = table_def.add_indexes();
+        index->set_name("index1");
+        index->add_first_keys("col1");
+        index->set_second_key("col5");
+    }
+    hybridse::type::Database db;
+    db.set_name("db");
+    AddTable(db, table_def);
+    catalog->AddDatabase(db);
+
+    PhysicalPlanCheck(catalog, sql, expected, {}, nullptr, {passes::kPassWindowScanSharing});
+}
+
 }  // namespace vm
 }  // namespace hybridse
 int main(int argc, char** argv) {
@@ -1546,6 +1546,69 @@ TEST_F(RequestUnionWindowTest, RequestRowsMergeRowsRangeWindowTest) {
             window_range, keys, current_key, exp_keys, exclude_current_time));
     }
 }
+
+// the window taken as a prefix of the window of a covering frame is the same
+// as the one scanned from the segment
+void CHECK_REQUEST_PREFIX_WINDOW(const WindowRange& large_range,
+                                 const WindowRange& window_range,
+                                 const std::vector<uint64_t>& buffered_keys,
+                                 uint64_t current_key,
+                                 const bool exclude_current_time = false) {
+    Row row;
+    auto table = std::make_shared<MemTimeTableHandler>();
+    for (uint64_t key : buffered_keys) {
+        table->AddRow(key, row);
+    }
+    for (bool output_request_row : {true, false}) {
+        auto large_table = RequestUnionRunner::RequestUnionWindow(
+            row, std::vector<std::shared_ptr<TableHandler>>({table}),
+            current_key, large_range, output_request_row, exclude_current_time);
+        auto exp_table = RequestUnionRunner::RequestUnionWindow(
+            row, std::vector<std::shared_ptr<TableHandler>>({table}),
+            current_key, window_range, output_request_row,
+            exclude_current_time);
+        std::vector<uint64_t> exp_keys;
+        auto iter = exp_table->GetIterator();
+        iter->SeekToFirst();
+        while (iter->Valid()) {
+            exp_keys.push_back(iter->GetKey());
+            iter->Next();
+        }
+        auto prefix_table = RequestUnionRunner::RequestPrefixWindow(
+            row, large_table, current_key, window_range, output_request_row,
+            exclude_current_time);
+        CHECK_TABLE_KEY(prefix_table, exp_keys);
+    }
+}
+TEST_F(RequestUnionWindowTest, RequestPrefixWindowTest) {
+    std::vector<uint64_t> keys({10L, 9L, 8L, 8L, 7L, 6L, 5L, 4L, 3L, 2L});
+    for (uint64_t current_key : {1L, 3L, 8L, 11L, 20L}) {
+        ASSERT_NO_FATAL_FAILURE(CHECK_REQUEST_PREFIX_WINDOW(
+            WindowRange::CreateRowsWindow(7), WindowRange::CreateRowsWindow(3),
+            keys, current_key));
+        ASSERT_NO_FATAL_FAILURE(CHECK_REQUEST_PREFIX_WINDOW(
+            WindowRange::CreateRowsRangeWindow(-8, 0),
+            WindowRange::CreateRowsRangeWindow(-3, 0), keys, current_key));
+        ASSERT_NO_FATAL_FAILURE(CHECK_REQUEST_PREFIX_WINDOW(
+            WindowRange::CreateRowsRangeWindow(-8, 0),
+            WindowRange::CreateRowsRangeWindow(-5, 0, 2), keys, current_key));
+        ASSERT_NO_FATAL_FAILURE(CHECK_REQUEST_PREFIX_WINDOW(
+            WindowRange::CreateRowsRangeWindow(-8, -1),
+            WindowRange::CreateRowsRangeWindow(-3, -1), keys, current_key));
+        ASSERT_NO_FATAL_FAILURE(CHECK_REQUEST_PREFIX_WINDOW(
+            WindowRange::CreateRowsRangeWindow(-8, 0),
+            WindowRange::CreateRowsRangeWindow(-3, 0), keys, current_key,
+            true));
+        ASSERT_NO_FATAL_FAILURE(CHECK_REQUEST_PREFIX_WINDOW(
+            WindowRange::CreateRowsMergeRowsRangeWindow(-7, 5),
+            WindowRange::CreateRowsMergeRowsRangeWindow(-2, 3), keys,
+            current_key));
+        ASSERT_NO_FATAL_FAILURE(CHECK_REQUEST_PREFIX_WINDOW(
+            WindowRange::CreateRowsMergeRowsRangeWindow(-7, 5, 7),
+            WindowRange::CreateRowsMergeRowsRangeWindow(-2, 3, 4), keys,
+            current_key, true));
+    }
+}
 }  // namespace vm
 }  // namespace hybridse
 int main(int argc, char** argv) {
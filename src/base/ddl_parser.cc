@@ -22,6 +22,7 @@
 #include <utility>
 #include <vector>
 
+#include "base/fe_pre_aggr.h"
 #include "codec/schema_codec.h"
 #include "common/timer.h"
 #include "node/node_manager.h"
@@ -330,7 +331,19 @@ void DDLParser::ExtractInfosFromProjectPlan(hybridse::node::ProjectPlanNode* pro
             std::string aggr_col;
             for (uint32_t i = 0; i < agg_expr->GetChildNum(); i++) {
                 auto child_expr = agg_expr->GetChild(i);
-                aggr_col += child_expr->GetExprString() + ",";
+                std::string arg = child_expr->GetExprString();
+                // the string literal of the condition is quoted, the same as LongWindowOptimized does
+                if (child_expr->GetExprType() == hybridse::node::kExprBinary &&
+                    child_expr->GetChild(1)->GetExprType() == hybridse::node::kExprPrimary) {
+                    auto binary = dynamic_cast<hybridse::node::BinaryExpr*>(child_expr);
+                    auto literal = dynamic_cast<hybridse::node::ConstNode*>(child_expr->GetChild(1));
+                    if (literal->GetDataType() == hybridse::node::kVarchar) {
+                        arg = hybridse::base::FormatPreAggrCondition(binary->GetChild(0)->GetExprString(),
+                                                                     hybridse::node::ExprOpTypeName(binary->GetOp()),
+                                                                     literal->GetExprString(), true);
+                    }
+                }
+                aggr_col += arg + ",";
             }
             if (!aggr_col.empty()) {
                 aggr_col.pop_back();
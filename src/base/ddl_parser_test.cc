@@ -631,6 +631,24 @@ TEST_F(DDLParserTest, extractLongWindow) {
         ASSERT_EQ(window_infos[0].bucket_size_, "1d");
     }
 
+    {
+        // conditional and categorical aggregates
+        std::string query =
+            "SELECT c1, count_where(c3, c2 > 5) OVER w1 AS m1, sum_cate(c3, c1) OVER w1 AS m2 FROM demo_table1 "
+            "WINDOW w1 AS (PARTITION BY c1 ORDER BY c6 ROWS_RANGE BETWEEN 20s PRECEDING AND CURRENT ROW);";
+
+        std::unordered_map<std::string, std::string> window_map;
+        window_map["w1"] = "1d";
+        openmldb::base::LongWindowInfos window_infos;
+        auto extract_status = DDLParser::ExtractLongWindowInfos(query, window_map, &window_infos);
+        ASSERT_TRUE(extract_status.IsOK());
+        ASSERT_EQ(window_infos.size(), 2);
+        ASSERT_EQ(window_infos[0].aggr_func_, "count_where");
+        ASSERT_EQ(window_infos[0].aggr_col_, "c3,c2 > 5");
+        ASSERT_EQ(window_infos[1].aggr_func_, "sum_cate");
+        ASSERT_EQ(window_infos[1].aggr_col_, "c3,c1");
+    }
+
     {
         // with limit
         std::string query =
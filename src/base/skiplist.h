@@ -20,8 +20,12 @@
 #include <assert.h>
 #include <stdint.h>
 
+#include <algorithm>
 #include <atomic>
+#include <functional>
 #include <iostream>
+#include <new>
+#include <thread>  // NOLINT
 
 #include "base/random.h"
 
@@ -40,19 +44,28 @@ struct DefaultComparator {
 };
 
 // Skiplist node , a thread safe structure
+// The next pointer array is allocated together with the node, so a node must
+// be created with `new (height) Node<K, V>(...)` and released with `delete`
 template <class K, class V>
 class Node {
  public:
     // Set data reference and Node height
     Node(const K& key, V& value, uint8_t height)  // NOLINT
         : height_(height), key_(key), value_(value) {
-        nexts_ = new std::atomic<Node<K, V>*>[height];
+        InitNexts();
     }
 
     Node(uint8_t height) : height_(height), key_(), value_() {  // NOLINT
-        nexts_ = new std::atomic<Node<K, V>*>[height];
+        InitNexts();
     }
 
+    static void* operator new(size_t size, uint8_t height) {
+        return ::operator new(size + sizeof(std::atomic<Node<K, V>*>) * (height > 1 ? height - 1 : 0));
+    }
+    static void* operator new(size_t size) = delete;
+    static void operator delete(void* ptr) { ::operator delete(ptr); }
+    static void operator delete(void* ptr, uint8_t height) { ::operator delete(ptr); }
+
     // Set the next node with memory barrier
     void SetNext(uint8_t level, Node<K, V>* node) {
         assert(level < height_ && level >= 0);
@@ -77,17 +90,33 @@ class Node {
         return nexts_[level].load(std::memory_order_relaxed);
     }
 
+    // Set the next node only if it is still expected
+    bool CasNext(uint8_t level, Node<K, V>* expected, Node<K, V>* node) {
+        assert(level < height_ && level >= 0);
+        return nexts_[level].compare_exchange_strong(expected, node, std::memory_order_release,
+                                                     std::memory_order_relaxed);
+    }
+
     V& GetValue() { return value_; }
 
     const K& GetKey() const { return key_; }
 
-    ~Node() { delete[] nexts_; }
+    ~Node() {}
+
+ private:
+    void InitNexts() {
+        for (uint8_t i = 1; i < height_; i++) {
+            ::new (&nexts_[i]) std::atomic<Node<K, V>*>(NULL);
+        }
+        nexts_[0].store(NULL, std::memory_order_relaxed);
+    }
 
  private:
     uint8_t const height_;
     K const key_;
     V value_;
-    std::atomic<Node<K, V>*>* nexts_;
+    // the rest of the array is placed right after the node
+    std::atomic<Node<K, V>*> nexts_[1];
 };
 
 template <class K, class V, class Comparator>
@@ -101,7 +130,7 @@ class Skiplist {
           rand_(0xdeadbeef),
           head_(NULL),
           tail_(NULL) {
-        head_ = new Node<K, V>(MaxHeight);
+        head_ = new (MaxHeight) Node<K, V>(MaxHeight);
         for (uint8_t i = 0; i < head_->Height(); i++) {
             head_->SetNext(i, NULL);
         }
@@ -111,7 +140,12 @@ class Skiplist {
 
     // Insert need external synchronized
     uint8_t Insert(const K& key, V& value) {  // NOLINT
-        uint8_t height = RandomHeight();
+        return Insert(key, value, RandomHeight());
+    }
+
+    // Insert with the given height which is no more than MaxHeight, need external synchronized
+    uint8_t Insert(const K& key, V& value, uint8_t height) {  // NOLINT
+        assert(height > 0 && height <= MaxHeight);
         Node<K, V>* pre[MaxHeight];
         FindLessOrEqual(key, pre);
         if (height > GetMaxHeight()) {
@@ -131,6 +165,20 @@ class Skiplist {
         return height;
     }
 
+    // InsertConcurrently can run with other InsertConcurrently and readers,
+    // but Insert, Remove, Split and Clear still need to be exclusive with it
+    uint8_t InsertConcurrently(const K& key, V& value) {  // NOLINT
+        uint8_t height = 0;
+        InsertConcurrently(key, value, false, &height);
+        return height;
+    }
+
+    // Insert the key if it is absent and return the node holding the key.
+    // height is set to 0 if the key exists already
+    Node<K, V>* GetOrInsertConcurrently(const K& key, V& value, uint8_t* height) {  // NOLINT
+        return InsertConcurrently(key, value, true, height);
+    }
+
     bool IsEmpty() {
         if (head_->GetNextNoBarrier(0) == NULL) {
             return true;
@@ -173,7 +221,8 @@ class Skiplist {
         if (target == NULL) {
             return NULL;
         }
-        tail_.store(target, std::memory_order_release);
+        // the list is empty if all nodes are split off
+        tail_.store(target == head_ ? NULL : target, std::memory_order_release);
         Node<K, V>* result = target->GetNextNoBarrier(0);
         for (uint8_t i = 0; i < MaxHeight; i++) {
             if (pre[i] == NULL) {
@@ -364,7 +413,7 @@ class Skiplist {
 
  private:
     Node<K, V>* NewNode(const K& key, V& value, uint8_t height) {  // NOLINT
-        Node<K, V>* node = new Node<K, V>(key, value, height);
+        Node<K, V>* node = new (height) Node<K, V>(key, value, height);
         return node;
     }
 
@@ -376,6 +425,81 @@ class Skiplist {
         return height;
     }
 
+    // rand_ is not thread safe, every writer thread uses its own generator
+    uint8_t RandomHeightConcurrently() {
+        static thread_local Random rand(std::hash<std::thread::id>()(std::this_thread::get_id()));
+        uint8_t height = 1;
+        while (height < MaxHeight && (rand.Next() % Branch) == 0) {
+            height++;
+        }
+        return height;
+    }
+
+    Node<K, V>* InsertConcurrently(const K& key, V& value, bool unique, uint8_t* height_out) {  // NOLINT
+        uint8_t height = RandomHeightConcurrently();
+        uint8_t max_height = GetMaxHeight();
+        while (height > max_height) {
+            if (max_height_.compare_exchange_weak(max_height, height, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        Node<K, V>* pre[MaxHeight];
+        Node<K, V>* succ[MaxHeight];
+        Node<K, V>* before = head_;
+        for (int level = std::max(max_height, height) - 1; level >= 0; level--) {
+            FindSpliceForLevel(key, before, level, &pre[level], &succ[level]);
+            before = pre[level];
+        }
+        if (unique && succ[0] != NULL && compare_(succ[0]->GetKey(), key) == 0) {
+            *height_out = 0;
+            return succ[0];
+        }
+        Node<K, V>* node = NewNode(key, value, height);
+        for (uint8_t i = 0; i < height; i++) {
+            while (true) {
+                node->SetNextNoBarrier(i, succ[i]);
+                if (pre[i]->CasNext(i, succ[i], node)) {
+                    break;
+                }
+                // other writer has changed the splice, find it again from the last position
+                FindSpliceForLevel(key, pre[i], i, &pre[i], &succ[i]);
+                if (i == 0 && unique && succ[0] != NULL && compare_(succ[0]->GetKey(), key) == 0) {
+                    delete node;
+                    *height_out = 0;
+                    return succ[0];
+                }
+            }
+            if (i == 0 && succ[0] == NULL) {
+                UpdateTailConcurrently(node);
+            }
+        }
+        *height_out = height;
+        return node;
+    }
+
+    void FindSpliceForLevel(const K& key, Node<K, V>* before, uint8_t level, Node<K, V>** pre, Node<K, V>** succ) {
+        while (true) {
+            Node<K, V>* next = before->GetNext(level);
+            if (IsAfterNode(key, next)) {
+                before = next;
+            } else {
+                *pre = before;
+                *succ = next;
+                return;
+            }
+        }
+    }
+
+    // the tail only moves forward while inserting concurrently
+    void UpdateTailConcurrently(Node<K, V>* node) {
+        Node<K, V>* tail = tail_.load(std::memory_order_acquire);
+        while (tail == NULL || tail == head_ || compare_(node->GetKey(), tail->GetKey()) > 0) {
+            if (tail_.compare_exchange_weak(tail, node, std::memory_order_release, std::memory_order_acquire)) {
+                break;
+            }
+        }
+    }
+
     Node<K, V>* FindLessOrEqual(const K& key, Node<K, V>** nodes) {
         assert(nodes != NULL);
         Node<K, V>* node = head_;
@@ -17,6 +17,7 @@
 #include "base/skiplist.h"
 
 #include <string>
+#include <thread>  // NOLINT
 #include <vector>
 
 #include "base/slice.h"
@@ -77,14 +78,18 @@ struct StrComparator {
 TEST_F(NodeTest, SetNext) {
     uint32_t key = 1;
     uint32_t value = 2;
-    Node<uint32_t, uint32_t> node(key, value, 2);
+    auto node = new (2) Node<uint32_t, uint32_t>(key, value, 2);
     uint32_t key2 = 3;
     uint32_t value2 = 3;
-    Node<uint32_t, uint32_t> node2(key2, value2, 2);
-    node.SetNext(1, &node2);
-    Node<uint32_t, uint32_t>* node_ptr = node.GetNext(1);
+    auto node2 = new (2) Node<uint32_t, uint32_t>(key2, value2, 2);
+    ASSERT_TRUE(node->GetNext(0) == NULL);
+    ASSERT_TRUE(node->GetNext(1) == NULL);
+    node->SetNext(1, node2);
+    Node<uint32_t, uint32_t>* node_ptr = node->GetNext(1);
     ASSERT_EQ(3, (signed)node_ptr->GetValue());
     ASSERT_EQ(3, (signed)node_ptr->GetKey());
+    delete node;
+    delete node2;
 }
 
 TEST_F(NodeTest, NodeByteSize) {
@@ -273,6 +278,12 @@ TEST_F(SkiplistTest, Split1) {
         // Can not find the node deleted
         it->Seek(2);
         ASSERT_FALSE(it->Valid());
+        delete it;
+        // split off all nodes
+        node = sl.Split(0);
+        ASSERT_EQ(0, (signed)node->GetKey());
+        ASSERT_TRUE(sl.GetLast() == NULL);
+        ASSERT_TRUE(sl.IsEmpty());
     }
 }
 
@@ -663,6 +674,65 @@ TEST_F(SkiplistTest, Duplicate) {
     ASSERT_FALSE(it->Valid());
 }
 
+TEST_F(SkiplistTest, InsertConcurrently) {
+    Comparator cmp;
+    for (auto height : vec) {
+        Skiplist<uint32_t, uint32_t, Comparator> sl(height, 4, cmp);
+        std::vector<std::thread> threads;
+        for (uint32_t tid = 0; tid < 4; tid++) {
+            threads.emplace_back([&sl, tid] {
+                for (uint32_t i = 0; i < 1000; i++) {
+                    uint32_t key = i * 4 + tid;
+                    uint32_t value = key;
+                    sl.InsertConcurrently(key, value);
+                }
+            });
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+        ASSERT_EQ(4000u, sl.GetSize());
+        ASSERT_EQ(3999u, sl.GetLast()->GetKey());
+        Skiplist<uint32_t, uint32_t, Comparator>::Iterator* it = sl.NewIterator();
+        it->SeekToFirst();
+        for (uint32_t i = 0; i < 4000; i++) {
+            ASSERT_TRUE(it->Valid());
+            ASSERT_EQ(i, it->GetKey());
+            ASSERT_EQ(i, it->GetValue());
+            it->Next();
+        }
+        ASSERT_FALSE(it->Valid());
+        delete it;
+        sl.Clear();
+    }
+}
+
+TEST_F(SkiplistTest, GetOrInsertConcurrently) {
+    Comparator cmp;
+    Skiplist<uint32_t, uint32_t, Comparator> sl(12, 4, cmp);
+    std::atomic<uint32_t> inserted(0);
+    std::vector<std::thread> threads;
+    for (uint32_t tid = 0; tid < 4; tid++) {
+        threads.emplace_back([&sl, &inserted, tid] {
+            for (uint32_t i = 0; i < 1000; i++) {
+                uint32_t value = tid;
+                uint8_t height = 0;
+                Node<uint32_t, uint32_t>* node = sl.GetOrInsertConcurrently(i, value, &height);
+                if (height > 0) {
+                    inserted.fetch_add(1);
+                }
+                ASSERT_EQ(i, node->GetKey());
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    ASSERT_EQ(1000u, inserted.load());
+    ASSERT_EQ(1000u, sl.GetSize());
+    sl.Clear();
+}
+
 }  // namespace base
 }  // namespace openmldb
 
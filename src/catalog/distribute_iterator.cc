@@ -156,8 +156,12 @@ bool FullTableIterator::NextFromRemote() {
 
 const ::hybridse::codec::Row& FullTableIterator::GetValue() {
     if (it_) {
-        value_ = ::hybridse::codec::Row(
-            ::hybridse::base::RefCountedSlice::Create(it_->GetValue().data(), it_->GetValue().size()));
+        // the value of local iterator may be a decoded buffer or a rocksdb slice which is overwritten by Next,
+        // so the row owns a copy as it may be kept by the caller
+        ::openmldb::base::Slice value = it_->GetValue();
+        int8_t* buf = reinterpret_cast<int8_t*>(malloc(value.size()));
+        memcpy(buf, value.data(), value.size());
+        value_ = ::hybridse::codec::Row(::hybridse::base::RefCountedSlice::CreateManaged(buf, value.size()));
         return value_;
     } else {
         value_ = ::hybridse::codec::Row(
@@ -27,8 +27,11 @@
 #include "glog/logging.h"
 #include "schema/index_util.h"
 #include "schema/schema_adapter.h"
+#include "storage/window_aggr_cache.h"
+#include "vm/mem_catalog.h"
 
 DECLARE_bool(enable_localtablet);
+DECLARE_uint32(disk_table_batch_get_limit);
 namespace openmldb {
 namespace catalog {
 
@@ -238,6 +241,103 @@ void TabletTableHandler::Update(const ::openmldb::nameserver::TableInfo& meta, c
     }
 }
 
+bool TabletPartitionHandler::GetIncrementalAggr(const std::string& key, int64_t start, int64_t end,
+                                                std::string* agg_val) {
+    auto table_handler = std::dynamic_pointer_cast<TabletTableHandler>(table_handler_);
+    if (!table_handler) {
+        return false;
+    }
+    return table_handler->GetIncrementalAggr(key, start, end, agg_val);
+}
+
+std::vector<std::shared_ptr<::hybridse::vm::TableHandler>> TabletPartitionHandler::GetSegments(
+    const std::vector<std::string>& keys) {
+    std::vector<std::shared_ptr<::hybridse::vm::TableHandler>> segments(keys.size());
+    auto table_handler = std::dynamic_pointer_cast<TabletTableHandler>(table_handler_);
+    if (table_handler) {
+        table_handler->BatchGetSegments(index_name_, keys, &segments);
+    }
+    for (size_t i = 0; i < keys.size(); i++) {
+        if (!segments[i]) {
+            segments[i] = GetSegment(keys[i]);
+        }
+    }
+    return segments;
+}
+
+void TabletTableHandler::BatchGetSegments(const std::string& index_name, const std::vector<std::string>& keys,
+                                          std::vector<std::shared_ptr<::hybridse::vm::TableHandler>>* segments) {
+    auto index_iter = index_hint_.find(index_name);
+    if (index_iter == index_hint_.end()) {
+        return;
+    }
+    auto tables = std::atomic_load_explicit(&tables_, std::memory_order_acquire);
+    if (!tables) {
+        return;
+    }
+    uint32_t pid_num = table_st_.GetPartitionNum();
+    std::map<uint32_t, std::vector<uint32_t>> pid_keys;
+    for (uint32_t i = 0; i < keys.size(); i++) {
+        uint32_t pid = 0;
+        if (pid_num > 0) {
+            pid = (uint32_t)(::openmldb::base::hash64(keys[i]) % pid_num);
+        }
+        pid_keys[pid].push_back(i);
+    }
+    for (const auto& kv : pid_keys) {
+        auto iter = tables->find(kv.first);
+        if (iter == tables->end()) {
+            continue;
+        }
+        std::vector<std::string> pks;
+        for (uint32_t pos : kv.second) {
+            pks.push_back(keys[pos]);
+        }
+        std::vector<std::vector<std::pair<uint64_t, std::string>>> rows;
+        std::vector<bool> complete;
+        if (!iter->second->BatchGet(index_iter->second.index, pks, FLAGS_disk_table_batch_get_limit, &rows,
+                                    &complete)) {
+            continue;
+        }
+        for (size_t i = 0; i < pks.size(); i++) {
+            if (!complete[i]) {
+                continue;
+            }
+            auto segment = std::make_shared<::hybridse::vm::MemTimeTableHandler>(GetName(), GetDatabase(), &schema_);
+            segment->SetOrderType(::hybridse::vm::kDescOrder);
+            for (const auto& row : rows[i]) {
+                int8_t* buf = reinterpret_cast<int8_t*>(malloc(row.second.size()));
+                memcpy(buf, row.second.data(), row.second.size());
+                segment->AddRow(row.first, ::hybridse::codec::Row(
+                                               ::hybridse::base::RefCountedSlice::CreateManaged(buf, row.second.size())));
+            }
+            (*segments)[kv.second[i]] = segment;
+        }
+    }
+}
+
+bool TabletTableHandler::GetIncrementalAggr(const std::string& key, int64_t start, int64_t end,
+                                            std::string* agg_val) {
+    uint32_t pid_num = table_st_.GetPartitionNum();
+    uint32_t pid = 0;
+    if (pid_num > 0) {
+        pid = (uint32_t)(::openmldb::base::hash64(key) % pid_num);
+    }
+    auto tables = std::atomic_load_explicit(&tables_, std::memory_order_acquire);
+    if (!tables) {
+        return false;
+    }
+    auto iter = tables->find(pid);
+    if (iter == tables->end()) {
+        return false;
+    }
+    auto cache = iter->second->GetWindowAggrCache();
+    if (!cache) {
+        return false;
+    }
+    return cache->Get(key, start, end, agg_val);
+}
+
 std::shared_ptr<::hybridse::vm::Tablet> TabletTableHandler::GetTablet(const std::string& index_name,
                                                                       const std::string& pk) {
     uint32_t pid_num = table_st_.GetPartitionNum();
@@ -157,6 +157,12 @@ class TabletPartitionHandler : public ::hybridse::vm::PartitionHandler,
     std::shared_ptr<::hybridse::vm::TableHandler> GetSegment(const std::string &key) override {
         return std::make_shared<TabletSegmentHandler>(shared_from_this(), key);
     }
+
+    std::vector<std::shared_ptr<::hybridse::vm::TableHandler>> GetSegments(
+        const std::vector<std::string> &keys) override;
+
+    bool GetIncrementalAggr(const std::string &key, int64_t start, int64_t end, std::string *agg_val) override;
+
     const std::string GetHandlerTypeName() override { return "TabletPartitionHandler"; }
 
  private:
@@ -209,6 +215,14 @@ class TabletTableHandler : public ::hybridse::vm::TableHandler,
 
     inline int32_t GetTid() { return table_st_.GetTid(); }
 
+    // get the incremental window aggregate of key from the local pre-aggr table
+    bool GetIncrementalAggr(const std::string &key, int64_t start, int64_t end, std::string *agg_val);
+
+    // get the segments of keys from the local tables in batch, the segment is left null
+    // if the key is not got, e.g. the partition is remote or the key has too many rows
+    void BatchGetSegments(const std::string &index_name, const std::vector<std::string> &keys,
+                          std::vector<std::shared_ptr<::hybridse::vm::TableHandler>> *segments);
+
     void AddTable(std::shared_ptr<::openmldb::storage::Table> table);
 
     bool HasLocalTable();
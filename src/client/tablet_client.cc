@@ -268,6 +268,70 @@ bool TabletClient::Put(uint32_t tid, uint32_t pid, uint64_t time, const std::str
     return false;
 }
 
+bool TabletClient::BatchPut(uint32_t tid, uint32_t pid, const std::vector<BatchPutRow>& rows,
+                            uint32_t format_version, uint32_t* put_cnt, std::string* msg) {
+    ::openmldb::api::BatchPutRequest request;
+    request.set_tid(tid);
+    request.set_pid(pid);
+    if (batch_put_unsupported_.load(std::memory_order_relaxed)) {
+        return PutOneByOne(tid, pid, rows, format_version, put_cnt, msg);
+    }
+    request.set_format_version(format_version);
+    brpc::Controller cntl;
+    cntl.set_timeout_ms(FLAGS_request_timeout_ms);
+    auto& io_buf = cntl.request_attachment();
+    for (const auto& row : rows) {
+        request.add_time(row.time);
+        request.add_value_size(row.value->size());
+        request.add_dimension_cnt(row.dimensions->size());
+        for (const auto& kv : *row.dimensions) {
+            ::openmldb::api::Dimension* d = request.add_dimensions();
+            d->set_key(kv.first);
+            d->set_idx(kv.second);
+        }
+        io_buf.append(*row.value);
+    }
+    ::openmldb::api::BatchPutResponse response;
+    bool ok = client_.SendRequest(&::openmldb::api::TabletServer_Stub::BatchPut, &cntl, &request, &response);
+    if (!ok && cntl.ErrorCode() == brpc::ENOMETHOD) {
+        LOG(WARNING) << "tablet " << GetEndpoint() << " does not support batch put, put the rows one by one";
+        batch_put_unsupported_.store(true, std::memory_order_relaxed);
+        return PutOneByOne(tid, pid, rows, format_version, put_cnt, msg);
+    }
+    if (put_cnt != NULL) {
+        *put_cnt = ok ? response.put_cnt() : 0;
+    }
+    if (!ok) {
+        msg->assign(cntl.ErrorText());
+        return false;
+    }
+    if (response.code() == 0) {
+        return true;
+    }
+    msg->assign(response.msg());
+    LOG(WARNING) << "fail to batch put for error " << response.msg() << " and error code " << response.code();
+    return false;
+}
+
+bool TabletClient::PutOneByOne(uint32_t tid, uint32_t pid, const std::vector<BatchPutRow>& rows,
+                               uint32_t format_version, uint32_t* put_cnt, std::string* msg) {
+    uint32_t cnt = 0;
+    for (const auto& row : rows) {
+        if (!Put(tid, pid, row.time, *row.value, *row.dimensions, format_version)) {
+            break;
+        }
+        cnt++;
+    }
+    if (put_cnt != NULL) {
+        *put_cnt = cnt;
+    }
+    if (cnt < rows.size()) {
+        msg->assign("put failed");
+        return false;
+    }
+    return true;
+}
+
 bool TabletClient::Put(uint32_t tid, uint32_t pid, const char* pk, uint64_t time, const char* value, uint32_t size,
                        uint32_t format_version) {
     ::openmldb::api::PutRequest request;
@@ -17,6 +17,7 @@
 #ifndef SRC_CLIENT_TABLET_CLIENT_H_
 #define SRC_CLIENT_TABLET_CLIENT_H_
 
+#include <atomic>
 #include <map>
 #include <memory>
 #include <string>
@@ -47,6 +48,13 @@ namespace client {
 using ::openmldb::api::TaskInfo;
 const uint32_t INVALID_REMOTE_TID = UINT32_MAX;
 
+// one row of BatchPut, the value and dimensions are owned by caller
+struct BatchPutRow {
+    uint64_t time;
+    const std::string* value;
+    const std::vector<std::pair<std::string, uint32_t>>* dimensions;
+};
+
 class TabletClient : public Client {
  public:
     TabletClient(const std::string& endpoint, const std::string& real_endpoint);
@@ -90,6 +98,11 @@ class TabletClient : public Client {
     bool Put(uint32_t tid, uint32_t pid, uint64_t time, const std::string& value,
              const std::vector<std::pair<std::string, uint32_t>>& dimensions, uint32_t format_version);
 
+    // put the rows of one partition in one request. put_cnt is the count of rows
+    // which have been put successfully if it is not NULL. The rows are put one by one
+    // if the tablet is too old to support BatchPut
+    bool BatchPut(uint32_t tid, uint32_t pid, const std::vector<BatchPutRow>& rows, uint32_t format_version,
+                  uint32_t* put_cnt, std::string* msg);
 
 
     bool Get(uint32_t tid, uint32_t pid, const std::string& pk, uint64_t time, std::string& value,  // NOLINT
@@ -296,9 +309,15 @@ class TabletClient : public Client {
 
     bool GetAndFlushDeployStats(::openmldb::api::DeployStatsResponse* res);
 
+ private:
+    bool PutOneByOne(uint32_t tid, uint32_t pid, const std::vector<BatchPutRow>& rows, uint32_t format_version,
+                     uint32_t* put_cnt, std::string* msg);
+
  private:
     ::openmldb::RpcClient<::openmldb::api::TabletServer_Stub> client_;
     std::vector<uint64_t> percentile_;
+    // the tablet returns ENOMETHOD for BatchPut during the rolling upgrade
+    std::atomic<bool> batch_put_unsupported_{false};
 };
 
 }  // namespace client
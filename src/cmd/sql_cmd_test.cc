@@ -44,6 +44,7 @@ DECLARE_string(ssd_root_path);
 DECLARE_string(hdd_root_path);
 DECLARE_string(recycle_bin_ssd_root_path);
 DECLARE_string(recycle_bin_hdd_root_path);
+DECLARE_uint32(window_aggr_cache_max_rows);
 
 ::openmldb::sdk::StandaloneEnv env;
 
@@ -1342,6 +1343,162 @@ TEST_P(DBSDKTest, DeployLongWindowsExecuteCount) {
     ASSERT_TRUE(ok);
 }
 
+TEST_P(DBSDKTest, DeployLongWindowsDiffBuckets) {
+    auto cli = GetParam();
+    cs = cli->cs;
+    sr = cli->sr;
+    ::hybridse::sdk::Status status;
+    sr->ExecuteSQL("SET @@execute_mode='online';", &status);
+    std::string base_table = "t_lw" + GenRand();
+    std::string base_db = "d_lw" + GenRand();
+    bool ok;
+    std::string msg;
+    CreateDBTableForLongWindow(base_db, base_table);
+    sr->ExecuteSQL(base_db, "use " + base_db + ";", &status);
+    ASSERT_TRUE(status.IsOK()) << status.msg;
+
+    std::string window = " from " + base_table +
+                         " WINDOW w1 AS (PARTITION BY col1,col2 ORDER BY col3"
+                         " ROWS_RANGE BETWEEN 20 PRECEDING AND CURRENT ROW);";
+    sr->ExecuteSQL(base_db, "deploy test_aggr options(long_windows='w1:2') select col1, col2,"
+                   " sum(i64_col) over w1 as w1_sum_i64_col" + window, &status);
+    ASSERT_TRUE(status.IsOK()) << status.msg;
+    PrepareDataForLongWindow(base_db, base_table);
+
+    // the sum reuses the pre-aggr table of test_aggr which covers all the rows,
+    // the max and count only have the buckets of the rows inserted after the deployment
+    std::string select = "select col1, col2, sum(i64_col) over w1 as w1_sum_i64_col,"
+                         " max(i64_col) over w1 as w1_max_i64_col, count(i64_col) over w1 as w1_count_i64_col";
+    sr->ExecuteSQL(base_db, "deploy test_aggr2 options(long_windows='w1:2') " + select + window, &status);
+    ASSERT_TRUE(status.IsOK()) << status.msg;
+    sr->ExecuteSQL(base_db, "deploy test_plain " + select + window, &status);
+    ASSERT_TRUE(status.IsOK()) << status.msg;
+    for (int i = 12; i <= 20; i++) {
+        std::string val = std::to_string(i);
+        std::string insert = absl::StrCat("insert into ", base_table, " values('str1', 'str2', ", val, ", ", val, ", ",
+                                          val, ", ", val, ", ", val, ", ", val, ", ", val, ", '", val,
+                                          "', '1900-01-", val, "');");
+        ASSERT_TRUE(sr->ExecuteInsert(base_db, insert, &status)) << status.msg;
+    }
+
+    for (const auto& sp_name : {"test_aggr2", "test_plain"}) {
+        auto req = sr->GetRequestRowByProcedure(base_db, sp_name, &status);
+        ASSERT_TRUE(status.IsOK()) << status.msg;
+        ASSERT_TRUE(req->Init(strlen("str1") + strlen("str2") + strlen("21")));
+        ASSERT_TRUE(req->AppendString("str1"));
+        ASSERT_TRUE(req->AppendString("str2"));
+        ASSERT_TRUE(req->AppendTimestamp(21));
+        ASSERT_TRUE(req->AppendInt64(21));
+        ASSERT_TRUE(req->AppendInt16(21));
+        ASSERT_TRUE(req->AppendInt32(21));
+        ASSERT_TRUE(req->AppendFloat(21));
+        ASSERT_TRUE(req->AppendDouble(21));
+        ASSERT_TRUE(req->AppendTimestamp(21));
+        ASSERT_TRUE(req->AppendString("21"));
+        ASSERT_TRUE(req->AppendDate(21));
+        ASSERT_TRUE(req->Build());
+        auto res = sr->CallProcedure(base_db, sp_name, req, &status);
+        ASSERT_TRUE(status.IsOK()) << status.msg;
+        ASSERT_EQ(1, res->Size());
+        ASSERT_TRUE(res->Next());
+        ASSERT_EQ("str1", res->GetStringUnsafe(0));
+        ASSERT_EQ("str2", res->GetStringUnsafe(1));
+        // the rows of ts [1, 20] and the request row
+        ASSERT_EQ(210 + 21, res->GetInt64Unsafe(2)) << sp_name;
+        ASSERT_EQ(21, res->GetInt64Unsafe(3)) << sp_name;
+        ASSERT_EQ(21, res->GetInt64Unsafe(4)) << sp_name;
+    }
+
+    ASSERT_TRUE(cs->GetNsClient()->DropProcedure(base_db, "test_aggr", msg));
+    ASSERT_TRUE(cs->GetNsClient()->DropProcedure(base_db, "test_aggr2", msg));
+    ASSERT_TRUE(cs->GetNsClient()->DropProcedure(base_db, "test_plain", msg));
+    std::string pre_aggr_db = openmldb::nameserver::PRE_AGG_DB;
+    for (const auto& pre_aggr_table :
+         {"pre_test_aggr_w1_sum_i64_col", "pre_test_aggr2_w1_max_i64_col", "pre_test_aggr2_w1_count_i64_col"}) {
+        ok = sr->ExecuteDDL(pre_aggr_db, absl::StrCat("drop table ", pre_aggr_table, ";"), &status);
+        ASSERT_TRUE(ok);
+    }
+    ok = sr->ExecuteDDL(base_db, "drop table " + base_table + ";", &status);
+    ASSERT_TRUE(ok);
+    ok = sr->DropDB(base_db, &status);
+    ASSERT_TRUE(ok);
+}
+
+TEST_P(DBSDKTest, DeployLongWindowsWithCache) {
+    auto cli = GetParam();
+    cs = cli->cs;
+    sr = cli->sr;
+    ::hybridse::sdk::Status status;
+    sr->ExecuteSQL("SET @@execute_mode='online';", &status);
+    std::string base_table = "t_lw" + GenRand();
+    std::string base_db = "d_lw" + GenRand();
+    bool ok;
+    std::string msg;
+    CreateDBTableForLongWindow(base_db, base_table);
+    sr->ExecuteSQL(base_db, "use " + base_db + ";", &status);
+    ASSERT_TRUE(status.IsOK()) << status.msg;
+
+    // the cache keeps fewer rows than the window, so the entries are evicted
+    uint32_t old_max_rows = FLAGS_window_aggr_cache_max_rows;
+    FLAGS_window_aggr_cache_max_rows = 4;
+    std::string select = "select col1, col2, sum(i64_col) over w1 as w1_sum_i64_col,"
+                         " sum(d_col) over w1 as w1_sum_d_col, avg(d_col) over w1 as w1_avg_d_col,"
+                         " min(i64_col) over w1 as w1_min_i64_col, max(i64_col) over w1 as w1_max_i64_col";
+    std::string window = " from " + base_table +
+                         " WINDOW w1 AS (PARTITION BY col1,col2 ORDER BY col3"
+                         " ROWS_RANGE BETWEEN 3 PRECEDING AND CURRENT ROW);";
+    sr->ExecuteSQL(base_db, "deploy test_cache options(long_windows='w1:2') " + select + window, &status);
+    FLAGS_window_aggr_cache_max_rows = old_max_rows;
+    ASSERT_TRUE(status.IsOK()) << status.msg;
+    sr->ExecuteSQL(base_db, "deploy test_plain " + select + window, &status);
+    ASSERT_TRUE(status.IsOK()) << status.msg;
+    PrepareDataForLongWindow(base_db, base_table);
+
+    for (int64_t ts = 4; ts <= 12; ts++) {
+        std::vector<std::string> results;
+        for (const auto& sp_name : {"test_cache", "test_plain"}) {
+            auto req = sr->GetRequestRowByProcedure(base_db, sp_name, &status);
+            ASSERT_TRUE(status.IsOK()) << status.msg;
+            std::string val = std::to_string(ts);
+            ASSERT_TRUE(req->Init(strlen("str1") + strlen("str2") + val.size()));
+            ASSERT_TRUE(req->AppendString("str1"));
+            ASSERT_TRUE(req->AppendString("str2"));
+            ASSERT_TRUE(req->AppendTimestamp(ts));
+            ASSERT_TRUE(req->AppendInt64(ts));
+            ASSERT_TRUE(req->AppendInt16(ts));
+            ASSERT_TRUE(req->AppendInt32(ts));
+            ASSERT_TRUE(req->AppendFloat(ts));
+            ASSERT_TRUE(req->AppendDouble(ts));
+            ASSERT_TRUE(req->AppendTimestamp(ts));
+            ASSERT_TRUE(req->AppendString(val));
+            ASSERT_TRUE(req->AppendDate(ts));
+            ASSERT_TRUE(req->Build());
+            auto res = sr->CallProcedure(base_db, sp_name, req, &status);
+            ASSERT_TRUE(status.IsOK()) << status.msg;
+            ASSERT_EQ(1, res->Size());
+            ASSERT_TRUE(res->Next());
+            results.push_back(absl::StrCat(res->GetInt64Unsafe(2), ",", res->GetDoubleUnsafe(3), ",",
+                                           res->GetDoubleUnsafe(4), ",", res->GetInt64Unsafe(5), ",",
+                                           res->GetInt64Unsafe(6)));
+        }
+        ASSERT_EQ(results[0], results[1]) << "ts " << ts;
+    }
+
+    ASSERT_TRUE(cs->GetNsClient()->DropProcedure(base_db, "test_cache", msg));
+    ASSERT_TRUE(cs->GetNsClient()->DropProcedure(base_db, "test_plain", msg));
+    std::string pre_aggr_db = openmldb::nameserver::PRE_AGG_DB;
+    for (const auto& pre_aggr_table : {"pre_test_cache_w1_sum_i64_col", "pre_test_cache_w1_sum_d_col",
+                                       "pre_test_cache_w1_avg_d_col", "pre_test_cache_w1_min_i64_col",
+                                       "pre_test_cache_w1_max_i64_col"}) {
+        ok = sr->ExecuteDDL(pre_aggr_db, absl::StrCat("drop table ", pre_aggr_table, ";"), &status);
+        ASSERT_TRUE(ok);
+    }
+    ok = sr->ExecuteDDL(base_db, "drop table " + base_table + ";", &status);
+    ASSERT_TRUE(ok);
+    ok = sr->DropDB(base_db, &status);
+    ASSERT_TRUE(ok);
+}
+
 TEST_P(DBSDKTest, CreateWithoutIndexCol) {
     auto cli = GetParam();
     cs = cli->cs;
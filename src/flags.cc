@@ -47,6 +47,9 @@ DEFINE_uint32(system_table_replica_num, 1, "config the default replica_num of sy
 DEFINE_int32(gc_interval, 120, "the gc interval of tablet every two hour");
 DEFINE_int32(disk_gc_interval, 120, "the rocksdb gc interval of tablet");
 DEFINE_int32(gc_pool_size, 2, "the size of tablet gc thread pool");
+DEFINE_uint32(gc_step_max_keys, 0, "the max keys of a segment visited by one gc step, 0 means gc the table at once");
+DEFINE_uint32(gc_step_max_time_ms, 0, "the max time of one gc step, 0 means gc the table at once");
+DEFINE_uint32(gc_step_interval_ms, 10, "the min interval between two gc steps of a table");
 DEFINE_int32(gc_safe_offset, 1, "the safe offset of tablet gc in minute");
 DEFINE_uint64(gc_on_table_recover_count, 10000000, "make a gc on recover count");
 DEFINE_uint32(gc_deleted_pk_version_delta, 2, "config the gc version delta");
@@ -57,6 +60,23 @@ DEFINE_bool(use_name, false, "enable or disable use server name");
 DEFINE_string(data_dir, "./data", "the path of data dir");
 DEFINE_bool(enable_distsql, false, "enable or disable distribute sql");
 DEFINE_bool(enable_localtablet, true, "enable or disable local tablet opt when distribute sql circumstance");
+DEFINE_bool(enable_window_scan_sharing, false,
+            "share one scan among the windows of a deployment over the same partition and order, "
+            "ignored if enable_distsql is set in cluster mode");
+DEFINE_bool(enable_tiered_jit, false,
+            "compile sql with the fast jit passes first and recompile it with the aggressive passes for the host cpu "
+            "in background once it has run jit_tier_up_threshold times");
+DEFINE_uint64(jit_tier_up_threshold, 100, "the run count of a sql or deployment to recompile it under tiered jit");
+DEFINE_string(jit_object_cache_dir, "",
+              "the dir of the on-disk cache of the jit compiled code of all the sql, including the queries and "
+              "deployments. the deployments created again, e.g. after restart, load the code from it instead of "
+              "compiling. empty to disable the cache");
+DEFINE_uint64(jit_object_cache_max_mb, 1024,
+              "the max size in MB of jit_object_cache_dir, the least recently used code is removed once it is "
+              "exceeded. 0 means unlimited");
+DEFINE_uint32(batch_query_parallelism, 1,
+              "the max number of threads to run the window and group aggregations of a batch query, "
+              "which split the keys of their partitions into parallel work units. 1 to run serially");
 DEFINE_string(bucket_size, "1d", "the default bucket size in pre-aggr table");
 
 // scan configuration
@@ -72,11 +92,16 @@ DEFINE_bool(binlog_enable_crc, false, "enable crc");
 DEFINE_int32(binlog_coffee_time, 1000, "config the coffee time");
 DEFINE_int32(binlog_sync_wait_time, 100, "config the sync log wait time");
 DEFINE_int32(binlog_sync_to_disk_interval, 20000, "config the interval of sync binlog to disk time");
+DEFINE_int32(binlog_group_commit_max_size, 128, "the max count of entries written by one group commit");
+DEFINE_bool(binlog_sync_on_commit, false, "sync binlog to disk before the put returns, one sync for a group commit");
 DEFINE_int32(binlog_delete_interval, 60000, "config the interval of delete binlog");
 DEFINE_int32(binlog_match_logoffset_interval, 1000, "config the interval of match log offset ");
 DEFINE_int32(binlog_name_length, 8, "binlog name length");
 DEFINE_uint32(check_binlog_sync_progress_delta, 100000, "config the delta of check binlog sync progress");
 DEFINE_uint32(go_back_max_try_cnt, 10, "config max try time of go back");
+DEFINE_uint32(binlog_tail_buffer_size, 1024,
+              "the max size in KB of the latest binlog entries kept in memory for replication, 0 disables it");
+DEFINE_uint32(binlog_sync_max_inflight, 4, "the max count of AppendEntries requests in flight to one follower");
 
 DEFINE_uint32(put_slow_log_threshold, 50000, "config the threshold of put slow log");
 DEFINE_uint32(query_slow_log_threshold, 50000, "config the threshold of query slow log");
@@ -115,6 +140,10 @@ DEFINE_uint32(make_snapshot_offline_interval, 60 * 60 * 24,
               "config tablet self makesnapshot when how long time do not "
               "makesnapshot from ns. unit is second");
 DEFINE_string(snapshot_compression, "off", "Type of snapshot compression, can be off, snappy, zlib");
+DEFINE_string(snapshot_format, "row",
+              "Format of memory table snapshot, can be row, columnar. "
+              "the columnar snapshot compresses each block by snappy and ignores snapshot_compression");
+DEFINE_uint32(snapshot_block_rows, 4096, "the max row count of a block in columnar snapshot");
 DEFINE_int32(snapshot_pool_size, 1, "the size of tablet thread pool for making snapshot");
 
 DEFINE_uint32(load_index_max_wait_time, 120 * 60 * 1000, "config the max wait time of load index");
@@ -131,6 +160,17 @@ DEFINE_uint32(skiplist_max_height, 12, "the max height of skiplist");
 DEFINE_uint32(key_entry_max_height, 8, "the max height of key entry");
 DEFINE_uint32(latest_default_skiplist_height, 1, "the default height of skiplist for latest table");
 DEFINE_uint32(absolute_default_skiplist_height, 4, "the default height of skiplist for absolute table");
+DEFINE_bool(enable_concurrent_put, false, "enable or disable lock free put of multi writers into one segment");
+DEFINE_string(memory_compression, "off", "Type of row compression in memory table, can be off, snappy");
+DEFINE_uint32(memory_compression_min_size, 128, "the rows smaller than this size are not compressed in memory");
+DEFINE_uint32(hot_data_ttl, 0,
+              "the rows of absolute ttl index older than this time in minutes are moved to cold tier, 0 means disabled");
+DEFINE_string(cold_tier_root_path, "./cold_tier", "the root path of the cold tier of memory table");
+DEFINE_uint32(spill_max_rows, 1000000,
+              "the max rows moved to the cold tier of a memory table in a gc round, 0 means no limit");
+DEFINE_uint32(window_aggr_cache_max_rows, 0,
+              "the max rows of a key kept by the incremental aggregate of long window, 0 means disabled");
+DEFINE_uint32(window_aggr_cache_max_keys, 100000, "the max keys of the incremental aggregate of a long window");
 DEFINE_bool(enable_show_tp, false, "enable show tp");
 DEFINE_uint32(max_col_display_length, 256, "config the max length of column display");
 
@@ -143,11 +183,33 @@ DEFINE_uint32(block_cache_mb, 4096,
 DEFINE_uint32(write_buffer_mb, 128, "Memtable size");
 DEFINE_uint32(block_cache_shardbits, 8, "Divide block cache into 2^8 shards to avoid cache contention");
 DEFINE_bool(verify_compression, false, "For debug");
+DEFINE_string(disk_table_filter_policy, "bloom",
+              "The filter policy on the key prefix of disk table, can be bloom, ribbon, none");
+DEFINE_uint32(disk_table_filter_bits_per_key, 10, "Bits per key of the disk table filter");
+DEFINE_uint32(disk_table_block_size_kb, 256, "Data block size of disk table");
+DEFINE_bool(disk_table_partition_index_filter, true,
+            "If true, use partitioned index and filter blocks which are cached with high priority");
+DEFINE_uint32(disk_table_batch_get_limit, 16,
+              "The max rows of one key got in batch from disk table by the batch request and last join, "
+              "the key with more rows is sought alone");
+DEFINE_uint32(disk_table_row_cache_mb, 0,
+              "The memory size of the decoded rows of hot keys cached for the window reads of disk tables, "
+              "0 disables the cache");
+DEFINE_uint32(disk_table_row_cache_max_rows, 64, "The max rows of one key kept in the row cache of disk tables");
+DEFINE_bool(disk_table_gc_head_scan, false,
+            "If true, the gc of disk table scans the whole table to delete the rows beyond the latest ttl, "
+            "otherwise the gc compacts the indexs with the latest ttl and they are dropped by the compaction filter");
+DEFINE_uint32(disk_table_gc_compaction_percent, 50,
+              "The gc of disk table compacts an index with the latest ttl only if the rows put since its last "
+              "compaction reach the percent of its rows, 0 compacts it in each gc");
 
 // load table resouce control
 DEFINE_uint32(load_table_batch, 30, "set laod table batch size");
 DEFINE_uint32(load_table_thread_num, 3, "set load tabale thread pool size");
 DEFINE_uint32(load_table_queue_size, 1000, "set load tabale queue size");
+DEFINE_uint32(load_snapshot_split_mb, 64,
+              "the uncompressed snapshot is split into ranges of at least this size in MB and loaded by "
+              "load_table_thread_num threads, 0 means disabled");
 
 // multiple data center
 DEFINE_uint32(get_replica_status_interval, 10000, "config the interval to sync replica cluster status time");
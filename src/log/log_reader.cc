@@ -446,6 +446,31 @@ LogReader::~LogReader() {
 
 void LogReader::SetOffset(uint64_t start_offset) { start_offset_ = start_offset; }
 
+void LogReader::Reset(uint64_t start_offset) {
+    delete reader_;
+    reader_ = NULL;
+    delete sf_;
+    sf_ = NULL;
+    log_part_index_ = -1;
+    start_offset_ = start_offset;
+}
+
+int LogReader::Seek(int log_part_index, uint64_t offset) {
+    if (compressed_ || log_part_index < 0) {
+        return -1;
+    }
+    std::string full_path =
+        log_path_ + "/" + ::openmldb::base::FormatToString(log_part_index, FLAGS_binlog_name_length) + ".log";
+    if (OpenSeqFile(full_path) != 0) {
+        return -1;
+    }
+    delete reader_;
+    reader_ = new Reader(sf_, NULL, FLAGS_binlog_enable_crc, offset - offset % kBlockSize, compressed_);
+    DEBUGLOG("seek log file to index[%d] offset[%lu]", log_part_index, offset);
+    log_part_index_ = log_part_index;
+    return 0;
+}
+
 void LogReader::GoBackToLastBlock() {
     if (sf_ == NULL || reader_ == NULL) {
         return;
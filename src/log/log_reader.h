@@ -162,6 +162,11 @@ class LogReader {
     int GetEndLogIndex();
     uint64_t GetLastRecordEndOffset();
     void SetOffset(uint64_t start_offset);
+    // close the log part in reading, the next read starts from the log part holding start_offset
+    void Reset(uint64_t start_offset);
+    // open the log part log_part_index and read from the block holding offset, the records before offset
+    // in that block are read again. return -1 if the log is compressed or the log part can not be opened
+    int Seek(int log_part_index, uint64_t offset);
     LogReader(const LogReader&) = delete;
     LogReader& operator=(const LogReader&) = delete;
 
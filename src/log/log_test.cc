@@ -22,10 +22,12 @@
 #include <unistd.h>
 
 #include <iostream>
+#include <string>
 #include <vector>
 
 #include "base/file_util.h"
 #include "base/glog_wapper.h"
+#include "base/strings.h"
 #include "config.h"  // NOLINT
 #include "log/coding.h"
 #include "log/crc32c.h"
@@ -37,6 +39,7 @@ using ::openmldb::base::Slice;
 using ::openmldb::log::Status;
 
 DECLARE_string(snapshot_compression);
+DECLARE_int32(binlog_name_length);
 bool compressed_ = true;
 uint32_t block_size_ = 1024 * 4;
 uint32_t header_size_ = 7;
@@ -208,6 +211,40 @@ TEST_F(LogWRTest, TestWriteAndRead) {
     }
 }
 
+TEST_F(LogWRTest, TestAddRecords) {
+    std::string log_dir = "/tmp/" + GenRand() + "/";
+    ::openmldb::base::MkdirRecur(log_dir);
+    std::string fname = "test.log";
+    std::string full_path = GetWritePath(log_dir + "/" + fname);
+    FILE* fd_w = fopen(full_path.c_str(), "ab+");
+    ASSERT_TRUE(fd_w != NULL);
+    WritableFile* wf = NewWritableFile(fname, fd_w);
+    Writer writer(FLAGS_snapshot_compression, wf);
+    // the batch crosses the block boundary and fills the trailer of block
+    std::vector<std::string> values{"hello", std::string(block_size_ - header_size_ * 2 - 8, 'a'), "world",
+                                    std::string(block_size_ * 2, 'b'), ""};
+    std::vector<Slice> slices;
+    for (const auto& value : values) {
+        slices.emplace_back(value);
+    }
+    ASSERT_TRUE(writer.AddRecords(slices).ok());
+    ASSERT_TRUE(writer.AddRecord(Slice("tail")).ok());
+    values.push_back("tail");
+    writer.EndLog();
+    FILE* fd_r = fopen(full_path.c_str(), "rb");
+    ASSERT_TRUE(fd_r != NULL);
+    SequentialFile* rf = NewSeqFile(fname, fd_r);
+    Reader reader(rf, NULL, true, 0, compressed_);
+    std::string scratch;
+    Slice value;
+    for (const auto& expect : values) {
+        ASSERT_TRUE(reader.ReadRecord(&value, &scratch).ok());
+        ASSERT_EQ(expect, value.ToString());
+    }
+    delete rf;
+    delete wf;
+}
+
 TEST_F(LogWRTest, TestLogEntry) {
     std::string log_dir = "/tmp/" + GenRand() + "/";
     ::openmldb::base::MkdirRecur(log_dir);
@@ -410,6 +447,56 @@ TEST_F(LogWRTest, TestInit) {
     ASSERT_EQ(compressed_, reader.GetCompressed());
 }
 
+TEST_F(LogWRTest, TestLogReaderSeek) {
+    std::string log_dir = "/tmp/" + GenRand() + "/";
+    ::openmldb::base::MkdirRecur(log_dir);
+    std::string fname = ::openmldb::base::FormatToString(0, FLAGS_binlog_name_length) + ".log";
+    std::string full_path = log_dir + "/" + fname;
+    FILE* fd_w = fopen(full_path.c_str(), "ab+");
+    ASSERT_TRUE(fd_w != NULL);
+    WritableFile* wf = NewWritableFile(fname, fd_w);
+    Writer writer(FLAGS_snapshot_compression, wf);
+    // the records span several blocks
+    for (int i = 0; i < 200; i++) {
+        Status status = writer.AddRecord("record" + std::to_string(i) + std::string(100, 'x'));
+        ASSERT_TRUE(status.ok());
+    }
+    if (FLAGS_snapshot_compression != "off") {
+        writer.EndLog();
+    }
+    ::openmldb::base::DefaultComparator cmp;
+    LogParts logs(12, 4, cmp);
+    uint64_t offset = 0;
+    logs.Insert(0, offset);
+    LogReader reader(&logs, log_dir, compressed_);
+    std::string scratch;
+    Slice value;
+    uint64_t end_offset = 0;
+    for (int i = 0; i < 150; i++) {
+        Status status = reader.ReadNextRecord(&value, &scratch);
+        ASSERT_TRUE(status.ok());
+        if (i == 99) {
+            end_offset = reader.GetLastRecordEndOffset();
+        }
+    }
+    if (compressed_) {
+        ASSERT_EQ(-1, reader.Seek(0, end_offset));
+        return;
+    }
+    ASSERT_GT(end_offset, kBlockSize);
+    ASSERT_EQ(0, reader.Seek(0, end_offset));
+    ASSERT_EQ(0, reader.GetLogIndex());
+    // the records of the block holding end_offset are read again
+    int idx = -1;
+    while (idx < 100) {
+        Status status = reader.ReadNextRecord(&value, &scratch);
+        ASSERT_TRUE(status.ok());
+        idx = std::stoi(value.ToString().substr(6));
+        ASSERT_LE(idx, 100);
+    }
+    ASSERT_EQ(-1, reader.Seek(1, 0));
+}
+
 }  // namespace log
 }  // namespace openmldb
 
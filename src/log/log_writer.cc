@@ -45,7 +45,9 @@ Writer::Writer(const std::string& compress_type, WritableFile* dest)
       compress_type_(GetCompressType(compress_type)),
       header_size_(compress_type_ != kNoCompress ? kHeaderSizeForCompress : kHeaderSize),
       buffer_(nullptr),
-      compress_buf_(nullptr) {
+      compress_buf_(nullptr),
+      batching_(false),
+      batch_() {
     InitTypeCrc(type_crc_);
     if (compress_type_ != kNoCompress) {
         block_size_ = kCompressBlockSize;
@@ -64,7 +66,9 @@ Writer::Writer(const std::string& compress_type, WritableFile* dest, uint64_t de
       compress_type_(GetCompressType(compress_type)),
       header_size_(compress_type_ != kNoCompress ? kHeaderSizeForCompress : kHeaderSize),
       buffer_(nullptr),
-      compress_buf_(nullptr) {
+      compress_buf_(nullptr),
+      batching_(false),
+      batch_() {
     InitTypeCrc(type_crc_);
     if (compress_type_ != kNoCompress) {
         block_size_ = kCompressBlockSize;
@@ -180,6 +184,38 @@ Status Writer::AddRecord(const Slice& slice) {
     return s;
 }
 
+Status Writer::AddRecords(const std::vector<Slice>& slices) {
+    Status s;
+    if (compress_type_ != kNoCompress) {
+        for (const auto& slice : slices) {
+            s = AddRecord(slice);
+            if (!s.ok()) {
+                return s;
+            }
+        }
+        return s;
+    }
+    batch_.clear();
+    batching_ = true;
+    for (const auto& slice : slices) {
+        s = AddRecord(slice);
+        if (!s.ok()) {
+            break;
+        }
+    }
+    batching_ = false;
+    if (s.ok() && !batch_.empty()) {
+        s = dest_->Append(Slice(batch_));
+        if (s.ok()) {
+            s = dest_->Flush();
+        }
+        if (!s.ok()) {
+            PDLOG(WARNING, "write error. %s", s.ToString().c_str());
+        }
+    }
+    return s;
+}
+
 Status Writer::EmitPhysicalRecord(RecordType t, const char* ptr, size_t n) {
     if (compress_type_ == kNoCompress) {
         assert(n <= 0xffff);  // Must fit in two bytes
@@ -206,7 +242,12 @@ Status Writer::EmitPhysicalRecord(RecordType t, const char* ptr, size_t n) {
     crc = Mask(crc);  // Adjust for storage
     EncodeFixed32(buf, crc);
 
-    if (compress_type_ == kNoCompress) {
+    if (compress_type_ == kNoCompress && batching_) {
+        batch_.append(buf, header_size_);
+        batch_.append(ptr, n);
+        block_offset_ += header_size_ + n;
+        return Status::OK();
+    } else if (compress_type_ == kNoCompress) {
         // Write the header and the payload
         Status s = dest_->Append(Slice(buf, header_size_));
         if (s.ok()) {
@@ -310,7 +351,11 @@ CompressType Writer::GetCompressType(const std::string& compress_type) {
 Status Writer::AppendInternal(WritableFile* wf, int32_t leftover) {
     Slice fill_slice("\x00\x00\x00\x00\x00\x00", leftover);
     if (compress_type_ == kNoCompress) {
-        wf->Append(fill_slice);
+        if (batching_) {
+            batch_.append(fill_slice.data(), fill_slice.size());
+        } else {
+            wf->Append(fill_slice);
+        }
         return Status::OK();
     } else {
         memcpy(buffer_ + block_offset_, fill_slice.data(), leftover);
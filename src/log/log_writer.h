@@ -24,6 +24,7 @@
 #include <stdint.h>
 
 #include <string>
+#include <vector>
 
 #include "base/slice.h"
 #include "log/status.h"
@@ -50,6 +51,9 @@ class Writer {
     ~Writer();
 
     Status AddRecord(const Slice& slice);
+    // Append all records with one write to dest, the compressed writer
+    // buffers the records of a block already
+    Status AddRecords(const std::vector<Slice>& slices);
     Status EndLog();
 
     inline CompressType GetCompressType() { return compress_type_; }
@@ -76,6 +80,9 @@ class Writer {
     char* buffer_;
     // buffer for compressed block
     char* compress_buf_;
+    // the physical records are appended to batch_ in AddRecords
+    bool batching_;
+    std::string batch_;
     Status CompressRecord();
     Status AppendInternal(WritableFile* wf, int leftover);
 
@@ -98,6 +105,8 @@ struct WriteHandle {
 
     Status Write(const ::openmldb::base::Slice& slice) { return lw_->AddRecord(slice); }
 
+    Status WriteBatch(const std::vector<::openmldb::base::Slice>& slices) { return lw_->AddRecords(slices); }
+
     Status Sync() { return wf_->Sync(); }
 
     Status EndLog() { return lw_->EndLog(); }
@@ -22,6 +22,10 @@
 
 #include <errno.h>
 #include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <algorithm>
 
 #include "base/glog_wapper.h"  // NOLINT
 #include "base/slice.h"
@@ -91,7 +95,70 @@ class PosixSequentialFile : public SequentialFile {
     }
 };
 
+// Read the whole file through a read only mapping, the result of Read points to
+// the mapped memory directly and is valid until the file is deleted
+class MmapSequentialFile : public SequentialFile {
+ private:
+    std::string filename_;
+    FILE* file_;
+    char* base_;
+    uint64_t size_;
+    uint64_t pos_;
+
+ public:
+    MmapSequentialFile(const std::string& fname, FILE* f, char* base, uint64_t size)
+        : filename_(fname), file_(f), base_(base), size_(size), pos_(0) {}
+
+    virtual ~MmapSequentialFile() {
+        munmap(base_, size_);
+        fclose(file_);
+    }
+
+    virtual Status Read(size_t n, Slice* result, char* scratch) {
+        size_t r = std::min(static_cast<uint64_t>(n), size_ - pos_);
+        *result = Slice(base_ + pos_, r);
+        pos_ += r;
+        return Status::OK();
+    }
+
+    virtual Status Skip(uint64_t n) {
+        pos_ = std::min(pos_ + n, size_);
+        return Status::OK();
+    }
+
+    virtual Status Tell(uint64_t* pos) {
+        if (pos == NULL) {
+            return Status::InvalidArgument("invalid pos arg");
+        }
+        *pos = pos_;
+        return Status::OK();
+    }
+
+    virtual Status Seek(uint64_t pos) {
+        if (pos > size_) {
+            return Status::IOError("fail to seek", filename_);
+        }
+        pos_ = pos;
+        return Status::OK();
+    }
+};
+
 SequentialFile* NewSeqFile(const std::string& fname, FILE* f) { return new PosixSequentialFile(fname, f); }
 
+SequentialFile* NewMmapSeqFile(const std::string& fname, FILE* f) {
+    struct stat stat_buf;
+    if (fstat(fileno(f), &stat_buf) < 0 || stat_buf.st_size <= 0) {
+        return NULL;
+    }
+    uint64_t size = stat_buf.st_size;
+    void* base = mmap(NULL, size, PROT_READ, MAP_SHARED, fileno(f), 0);
+    if (base == MAP_FAILED) {
+        PDLOG(WARNING, "fail to mmap file %s for error %s", fname.c_str(), strerror(errno));
+        return NULL;
+    }
+    madvise(base, size, MADV_SEQUENTIAL);
+    return new MmapSequentialFile(fname, f, reinterpret_cast<char*>(base), size);
+}
+
 }  // namespace log
 }  // namespace openmldb
@@ -66,6 +66,10 @@ class SequentialFile {
 
 SequentialFile* NewSeqFile(const std::string& fname, FILE* f);
 
+// Map the whole file into memory, return NULL if the file is empty or fails to
+// be mapped. The returned file closes f when it's deleted
+SequentialFile* NewMmapSeqFile(const std::string& fname, FILE* f);
+
 }  // namespace log
 }  // namespace openmldb
 #endif  // SRC_LOG_SEQUENTIAL_FILE_H_
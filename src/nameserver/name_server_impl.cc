@@ -2309,6 +2309,9 @@ int NameServerImpl::CreateTableOnTablet(const std::shared_ptr<::openmldb::namese
     table_meta.set_compress_type(compress_type);
     table_meta.set_format_version(table_info->format_version());
     table_meta.set_storage_mode(table_info->storage_mode());
+    if (table_info->has_disk_table_option()) {
+        table_meta.mutable_disk_table_option()->CopyFrom(table_info->disk_table_option());
+    }
     if (table_info->has_key_entry_max_height()) {
         table_meta.set_key_entry_max_height(table_info->key_entry_max_height());
     }
@@ -35,6 +35,9 @@
 
 DECLARE_int32(binlog_single_file_max_size);
 DECLARE_int32(binlog_name_length);
+DECLARE_int32(binlog_group_commit_max_size);
+DECLARE_bool(binlog_sync_on_commit);
+DECLARE_uint32(binlog_tail_buffer_size);
 DECLARE_string(zk_cluster);
 
 namespace openmldb {
@@ -59,7 +62,17 @@ LogReplicator::LogReplicator(uint32_t tid, uint32_t pid, const std::string& path
       term_(0),
       mu_(),
       cv_(),
-      wmu_() {
+      wmu_(),
+      group_mu_(),
+      pending_entries_(),
+      sync_on_commit_(FLAGS_binlog_sync_on_commit),
+      tail_buffer_(),
+      apply_mu_(),
+      apply_cv_(),
+      applying_(false) {
+    if (FLAGS_binlog_tail_buffer_size > 0) {
+        tail_buffer_.reset(new LogTailBuffer(FLAGS_binlog_tail_buffer_size * 1024ull));
+    }
     binlog_index_ = 0;
     snapshot_log_part_index_.store(-1, std::memory_order_relaxed);
     snapshot_last_offset_.store(0, std::memory_order_relaxed);
@@ -108,8 +121,8 @@ bool LogReplicator::Init() {
     if (role_ == kLeaderNode) {
         for (const auto& kv : real_ep_map_) {
             std::shared_ptr<ReplicateNode> replicate_node =
-                std::make_shared<ReplicateNode>(kv.first, logs_, log_path_, tid_, pid_, &term_,
-                                                &log_offset_, &mu_, &cv_, false, &follower_offset_, kv.second);
+                std::make_shared<ReplicateNode>(kv.first, logs_, log_path_, tid_, pid_, &term_, &log_offset_, &mu_,
+                                                &cv_, false, &follower_offset_, kv.second, tail_buffer_.get());
             if (replicate_node->Init() < 0) {
                 PDLOG(WARNING, "init replicate node %s error", kv.first.c_str());
                 return false;
@@ -316,6 +329,26 @@ bool LogReplicator::ApplyEntry(const LogEntry& entry) {
     return true;
 }
 
+bool LogReplicator::WaitApply(uint64_t pre_log_index, uint32_t timeout_ms) {
+    std::unique_lock<bthread::Mutex> lock(apply_mu_);
+    uint64_t deadline = ::baidu::common::timer::get_micros() + timeout_ms * 1000ull;
+    while (applying_ || GetOffset() < pre_log_index) {
+        uint64_t now = ::baidu::common::timer::get_micros();
+        if (now >= deadline) {
+            return false;
+        }
+        apply_cv_.wait_for(lock, deadline - now);
+    }
+    applying_ = true;
+    return true;
+}
+
+void LogReplicator::FinishApply() {
+    std::lock_guard<bthread::Mutex> lock(apply_mu_);
+    applying_ = false;
+    apply_cv_.notify_all();
+}
+
 int LogReplicator::AddReplicateNode(const std::map<std::string, std::string>& real_ep_map) {
     return AddReplicateNode(real_ep_map, UINT32_MAX);
 }
@@ -342,12 +375,12 @@ int LogReplicator::AddReplicateNode(const std::map<std::string, std::string>& re
         std::shared_ptr<ReplicateNode> replicate_node;
         if (tid == UINT32_MAX) {
             replicate_node =
-                std::make_shared<ReplicateNode>(endpoint, logs_, log_path_, tid_, pid_, &term_,
-                                                &log_offset_, &mu_, &cv_, false, &follower_offset_, kv.second);
+                std::make_shared<ReplicateNode>(endpoint, logs_, log_path_, tid_, pid_, &term_, &log_offset_, &mu_,
+                                                &cv_, false, &follower_offset_, kv.second, tail_buffer_.get());
         } else {
             replicate_node =
                 std::make_shared<ReplicateNode>(endpoint, logs_, log_path_, tid, pid_, &term_, &log_offset_,
-                                                &mu_, &cv_, true, &follower_offset_, kv.second);
+                                                &mu_, &cv_, true, &follower_offset_, kv.second, tail_buffer_.get());
         }
         if (replicate_node->Init() < 0) {
             PDLOG(WARNING, "init replicate node %s error", endpoint.c_str());
@@ -412,6 +445,17 @@ void LogReplicator::GetReplicateInfo(std::map<std::string, uint64_t>& info_map)
     }
 }
 
+void LogReplicator::GetReplicateLag(std::map<std::string, std::pair<uint64_t, uint64_t>>* lag_map) {
+    std::lock_guard<bthread::Mutex> lock(mu_);
+    if (role_ != kLeaderNode) {
+        return;
+    }
+    for (const auto& node : nodes_) {
+        lag_map->insert(
+            std::make_pair(node->GetEndPoint(), std::make_pair(node->GetLagEntries(), node->GetLagBytes())));
+    }
+}
+
 bool LogReplicator::DelAllReplicateNode() {
     std::vector<std::shared_ptr<ReplicateNode>> copied_nodes = nodes_;
     {
@@ -433,7 +477,50 @@ bool LogReplicator::DelAllReplicateNode() {
     return true;
 }
 
-bool LogReplicator::AppendEntry(LogEntry& entry) {
+bool LogReplicator::AppendEntry(LogEntry& entry) { return AppendEntries(&entry, 1); }
+
+bool LogReplicator::AppendEntries(LogEntry* entries, size_t cnt) {
+    if (cnt == 0) {
+        return true;
+    }
+    PendingEntry pending(entries, cnt);
+    std::unique_lock<bthread::Mutex> lock(group_mu_);
+    pending_entries_.push_back(&pending);
+    while (!pending.done && &pending != pending_entries_.front()) {
+        pending.cv.wait(lock);
+    }
+    if (pending.done) {
+        return pending.ok;
+    }
+    // the waiting entries are written by the leader, the entries which come later join the next group
+    size_t max_size = std::max(FLAGS_binlog_group_commit_max_size, 1);
+    std::vector<PendingEntry*> group;
+    size_t entry_cnt = 0;
+    for (auto it = pending_entries_.begin(); it != pending_entries_.end(); ++it) {
+        if (!group.empty() && entry_cnt + (*it)->cnt > max_size) {
+            break;
+        }
+        group.push_back(*it);
+        entry_cnt += (*it)->cnt;
+    }
+    lock.unlock();
+    bool ok = WriteGroup(group);
+    lock.lock();
+    for (auto* cur : group) {
+        pending_entries_.pop_front();
+        cur->ok = ok;
+        cur->done = true;
+        if (cur != &pending) {
+            cur->cv.notify_one();
+        }
+    }
+    if (!pending_entries_.empty()) {
+        pending_entries_.front()->cv.notify_one();
+    }
+    return ok;
+}
+
+bool LogReplicator::WriteGroup(const std::vector<PendingEntry*>& group) {
     std::lock_guard<std::mutex> lock(wmu_);
     if (wh_ == NULL || wh_->GetSize() / (1024 * 1024) > (uint32_t)FLAGS_binlog_single_file_max_size) {
         bool ok = RollWLogFile();
@@ -442,19 +529,45 @@ bool LogReplicator::AppendEntry(LogEntry& entry) {
         }
     }
     uint64_t cur_offset = log_offset_.load(std::memory_order_relaxed);
-    entry.set_log_index(1 + cur_offset);
-    std::string buffer;
-    entry.SerializeToString(&buffer);
-    ::openmldb::base::Slice slice(buffer);
-    ::openmldb::log::Status status = wh_->Write(slice);
+    size_t entry_cnt = 0;
+    for (const auto* pending : group) {
+        entry_cnt += pending->cnt;
+    }
+    std::vector<std::string> buffers(entry_cnt);
+    std::vector<::openmldb::base::Slice> slices;
+    slices.reserve(entry_cnt);
+    for (const auto* pending : group) {
+        for (size_t i = 0; i < pending->cnt; i++) {
+            size_t idx = slices.size();
+            LogEntry& entry = pending->entries[i];
+            entry.set_log_index(cur_offset + 1 + idx);
+            entry.SerializeToString(&buffers[idx]);
+            slices.emplace_back(buffers[idx]);
+        }
+    }
+    ::openmldb::log::Status status = wh_->WriteBatch(slices);
     if (!status.ok()) {
         PDLOG(WARNING, "fail to write replication log in dir %s for %s", path_.c_str(), status.ToString().c_str());
         return false;
     }
-    log_offset_.fetch_add(1, std::memory_order_relaxed);
+    if (tail_buffer_) {
+        // the entries must be in buffer before the replicate nodes see the new offset
+        for (size_t idx = 0; idx < slices.size(); idx++) {
+            tail_buffer_->Append(cur_offset + 1 + idx, slices[idx]);
+        }
+    }
+    log_offset_.fetch_add(entry_cnt, std::memory_order_relaxed);
     if (local_endpoints_.empty()) {  // if local replica are dead, leader direct
                                      // sync to remote replica
-        follower_offset_.store(cur_offset + 1, std::memory_order_relaxed);
+        follower_offset_.store(cur_offset + entry_cnt, std::memory_order_relaxed);
+    }
+    if (sync_on_commit_) {
+        status = wh_->Sync();
+        if (!status.ok()) {
+            PDLOG(WARNING, "fail to sync replication log in dir %s for %s", path_.c_str(),
+                  status.ToString().c_str());
+            return false;
+        }
     }
     return true;
 }
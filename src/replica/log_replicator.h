@@ -19,10 +19,12 @@
 
 #include <atomic>
 #include <condition_variable>  // NOLINT
+#include <deque>
 #include <map>
 #include <memory>
 #include <mutex>  // NOLINT
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "base/skiplist.h"
@@ -33,6 +35,7 @@
 #include "log/log_writer.h"
 #include "log/sequential_file.h"
 #include "proto/tablet.pb.h"
+#include "replica/log_tail_buffer.h"
 #include "replica/replicate_node.h"
 #include "storage/table.h"
 
@@ -63,9 +66,20 @@ class LogReplicator {
     // the slave node receives master log entries
     bool ApplyEntry(const ::openmldb::api::LogEntry& entry);
 
-    // the master node append entry
+    // the pipelined requests of leader may arrive out of order, the slave node applies them one by one.
+    // wait until the entries before pre_log_index are applied and no other request is applying,
+    // return false if timeout. FinishApply must be called after the entries are applied
+    bool WaitApply(uint64_t pre_log_index, uint32_t timeout_ms);
+    void FinishApply();
+
+    // the master node append entry. The concurrent calls are committed as a group,
+    // the first one writes the entries of the group with one write and fsyncs them
+    // if binlog_sync_on_commit is enabled
     bool AppendEntry(::openmldb::api::LogEntry& entry);  // NOLINT
 
+    // append the entries in one group commit, the log indexes of entries are continuous
+    bool AppendEntries(LogEntry* entries, size_t cnt);
+
     //  data to slave nodes
     void Notify();
     // recover logs meta
@@ -84,6 +98,9 @@ class LogReplicator {
 
     void GetReplicateInfo(std::map<std::string, uint64_t>& info_map);  // NOLINT
 
+    // the count and bytes of entries which are not synced to the follower
+    void GetReplicateLag(std::map<std::string, std::pair<uint64_t, uint64_t>>* lag_map);
+
     void MatchLogOffset();
 
     void ReplicateToNode(const std::string& endpoint);
@@ -111,8 +128,21 @@ class LogReplicator {
     const std::string& GetLogPath() {return log_path_;}
 
  private:
+    // the entries waiting for the group commit
+    struct PendingEntry {
+        PendingEntry(LogEntry* e, size_t c) : entries(e), cnt(c), done(false), ok(false) {}
+        LogEntry* entries;
+        size_t cnt;
+        bool done;
+        bool ok;
+        bthread::ConditionVariable cv;
+    };
+
     bool OpenSeqFile(const std::string& path, SequentialFile** sf);
 
+    // write the entries of group into binlog
+    bool WriteGroup(const std::vector<PendingEntry*>& group);
+
  private:
     // the replicator root data path
     uint32_t tid_;
@@ -139,6 +169,16 @@ class LogReplicator {
     std::atomic<uint64_t> snapshot_last_offset_;
 
     std::mutex wmu_;
+    // the queue of group commit, the front one is the leader of group
+    bthread::Mutex group_mu_;
+    std::deque<PendingEntry*> pending_entries_;
+    bool sync_on_commit_;
+    // the latest entries shared by replicate nodes
+    std::unique_ptr<LogTailBuffer> tail_buffer_;
+
+    bthread::Mutex apply_mu_;
+    bthread::ConditionVariable apply_cv_;
+    bool applying_;
 };
 
 }  // namespace replica
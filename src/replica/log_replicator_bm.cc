@@ -0,0 +1,63 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gflags/gflags.h>
+#include <stdlib.h>
+
+#include <map>
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "proto/tablet.pb.h"
+#include "replica/log_replicator.h"
+
+DECLARE_bool(binlog_sync_on_commit);
+
+namespace openmldb {
+namespace replica {
+
+// multi clients append entries to one replicator, range(0) selects the sync-on-commit mode
+static LogReplicator* shared_replicator = nullptr;
+static void BM_AppendEntry(benchmark::State& state) {  // NOLINT
+    if (state.thread_index == 0) {
+        FLAGS_binlog_sync_on_commit = state.range(0) == 1;
+        std::string folder = "/tmp/log_replicator_bm/" + std::to_string(rand()) + "/";  // NOLINT
+        shared_replicator = new LogReplicator(1, 1, folder, std::map<std::string, std::string>(), kLeaderNode);
+        shared_replicator->Init();
+    }
+    ::openmldb::api::LogEntry entry;
+    entry.set_term(1);
+    entry.set_pk("key" + std::to_string(state.thread_index));
+    entry.set_value(std::string(128, 'a'));
+    uint64_t ts = 1;
+    for (auto _ : state) {
+        entry.set_ts(ts++);
+        shared_replicator->AppendEntry(entry);
+    }
+    state.SetItemsProcessed(state.iterations());
+    if (state.thread_index == 0) {
+        delete shared_replicator;
+        shared_replicator = nullptr;
+        FLAGS_binlog_sync_on_commit = false;
+    }
+}
+
+BENCHMARK(BM_AppendEntry)->Arg(0)->Arg(1)->ThreadRange(1, 64)->UseRealTime();
+
+}  // namespace replica
+}  // namespace openmldb
+
+BENCHMARK_MAIN();
@@ -16,6 +16,7 @@
 
 #include "replica/log_replicator.h"
 
+#include <brpc/controller.h>
 #include <brpc/server.h>
 #include <gtest/gtest.h>
 #include <sched.h>
@@ -24,6 +25,8 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <atomic>
+#include <thread>  // NOLINT
 #include <utility>
 
 #include "base/glog_wapper.h"
@@ -46,6 +49,9 @@ using ::openmldb::storage::Table;
 using ::openmldb::storage::TableIterator;
 using ::openmldb::storage::Ticket;
 
+DECLARE_int32(binlog_sync_batch_size);
+DECLARE_uint32(binlog_tail_buffer_size);
+
 namespace openmldb {
 namespace replica {
 
@@ -113,6 +119,97 @@ class MockTabletImpl : public ::openmldb::api::TabletServer {
     std::atomic<bool> follower_;
 };
 
+// applies the pipelined requests with the entries in attachment like TabletImpl
+class PipelineTabletImpl : public ::openmldb::api::TabletServer {
+ public:
+    PipelineTabletImpl(const std::string& path, std::shared_ptr<MemTable> table)
+        : table_(table),
+          replicator_(table->GetId(), table->GetPid(), path, g_endpoints, kFollowerNode),
+          delay_index_(UINT64_MAX),
+          fail_index_(UINT64_MAX),
+          fail_cnt_(0),
+          out_of_order_cnt_(0) {}
+
+    bool Init() { return replicator_.Init(); }
+
+    // the request after pre_log_index arrives later than the next ones
+    void SetDelayIndex(uint64_t pre_log_index) { delay_index_.store(pre_log_index); }
+
+    // the request after pre_log_index fails once
+    void SetFailIndex(uint64_t pre_log_index) { fail_index_.store(pre_log_index); }
+
+    uint32_t GetFailCnt() { return fail_cnt_.load(); }
+
+    uint32_t GetOutOfOrderCnt() { return out_of_order_cnt_.load(); }
+
+    uint64_t GetOffset() { return replicator_.GetOffset(); }
+
+    void AppendEntries(RpcController* controller, const ::openmldb::api::AppendEntriesRequest* request,
+                       ::openmldb::api::AppendEntriesResponse* response, Closure* done) {
+        brpc::ClosureGuard done_guard(done);
+        response->set_code(::openmldb::base::ReturnCode::kOk);
+        if (request->pre_log_index() == 0 && request->entries_size() == 0 && request->entry_sizes_size() == 0) {
+            response->set_log_offset(replicator_.GetOffset());
+            return;
+        }
+        uint64_t pre_log_index = request->pre_log_index();
+        if (delay_index_.compare_exchange_strong(pre_log_index, UINT64_MAX)) {
+            bthread_usleep(200 * 1000);
+        }
+        pre_log_index = request->pre_log_index();
+        if (fail_index_.compare_exchange_strong(pre_log_index, UINT64_MAX)) {
+            fail_cnt_++;
+            response->set_code(::openmldb::base::ReturnCode::kFailToAppendEntriesToReplicator);
+            return;
+        }
+        ::google::protobuf::RepeatedPtrField<::openmldb::api::LogEntry> entries = request->entries();
+        butil::IOBuf& attachment = static_cast<brpc::Controller*>(controller)->request_attachment();
+        for (int32_t i = 0; i < request->entry_sizes_size(); i++) {
+            butil::IOBuf entry_buf;
+            attachment.cutn(&entry_buf, request->entry_sizes(i));
+            butil::IOBufAsZeroCopyInputStream stream(entry_buf);
+            if (!entries.Add()->ParseFromZeroCopyStream(&stream)) {
+                response->set_code(::openmldb::base::ReturnCode::kFailToAppendEntriesToReplicator);
+                return;
+            }
+        }
+        bool with_attachment = request->entry_sizes_size() > 0;
+        if (with_attachment) {
+            if (replicator_.GetOffset() < request->pre_log_index()) {
+                out_of_order_cnt_++;
+            }
+            if (!replicator_.WaitApply(request->pre_log_index(), 1000)) {
+                response->set_code(::openmldb::base::ReturnCode::kFailToAppendEntriesToReplicator);
+                response->set_log_offset(replicator_.GetOffset());
+                return;
+            }
+        }
+        for (const auto& entry : entries) {
+            if (entry.log_index() <= replicator_.GetOffset()) {
+                continue;
+            }
+            // the entries are applied in order without a hole
+            if (entry.log_index() != replicator_.GetOffset() + 1 || !replicator_.ApplyEntry(entry)) {
+                response->set_code(::openmldb::base::ReturnCode::kFailToAppendEntriesToReplicator);
+                break;
+            }
+            table_->Put(entry);
+        }
+        if (with_attachment) {
+            replicator_.FinishApply();
+        }
+        response->set_log_offset(replicator_.GetOffset());
+    }
+
+ private:
+    std::shared_ptr<Table> table_;
+    LogReplicator replicator_;
+    std::atomic<uint64_t> delay_index_;
+    std::atomic<uint64_t> fail_index_;
+    std::atomic<uint32_t> fail_cnt_;
+    std::atomic<uint32_t> out_of_order_cnt_;
+};
+
 bool ReceiveEntry(const ::openmldb::api::LogEntry& entry) { return true; }
 
 class LogReplicatorTest : public ::testing::Test {
@@ -147,6 +244,59 @@ TEST_F(LogReplicatorTest, BenchMark) {
     ASSERT_TRUE(ok);
 }
 
+TEST_F(LogReplicatorTest, GroupCommit) {
+    std::map<std::string, std::string> map;
+    std::string folder = "/tmp/" + GenRand() + "/";
+    LogReplicator replicator(1, 1, folder, map, kLeaderNode);
+    ASSERT_TRUE(replicator.Init());
+    uint32_t thread_num = 8;
+    uint32_t cnt = 1000;
+    std::atomic<uint32_t> failed_cnt(0);
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < thread_num; i++) {
+        threads.emplace_back([&replicator, &failed_cnt, cnt, i] {
+            for (uint32_t j = 0; j < cnt; j++) {
+                ::openmldb::api::LogEntry entry;
+                entry.set_term(1);
+                entry.set_pk("key" + std::to_string(i));
+                entry.set_value("value" + std::to_string(j));
+                entry.set_ts(j);
+                if (!replicator.AppendEntry(entry) || entry.log_index() == 0) {
+                    failed_cnt.fetch_add(1);
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    ASSERT_EQ(0u, failed_cnt.load());
+    ASSERT_EQ(thread_num * cnt, replicator.GetLogOffset());
+    replicator.SyncToDisk();
+    // the entries are written in the order of log index
+    std::string full_path = replicator.GetLogPath() + "/00000000.log";
+    FILE* fd = fopen(full_path.c_str(), "rb");
+    ASSERT_TRUE(fd != NULL);
+    ::openmldb::log::SequentialFile* seq_file = ::openmldb::log::NewSeqFile(full_path, fd);
+    ::openmldb::log::Reader reader(seq_file, NULL, false, 0, false);
+    std::string buffer;
+    ::openmldb::base::Slice record;
+    std::map<std::string, uint64_t> last_ts;
+    for (uint64_t offset = 1; offset <= thread_num * cnt; offset++) {
+        ASSERT_TRUE(reader.ReadRecord(&record, &buffer).ok());
+        ::openmldb::api::LogEntry entry;
+        ASSERT_TRUE(entry.ParseFromArray(record.data(), record.size()));
+        ASSERT_EQ(offset, entry.log_index());
+        // the entries of a thread keep their order
+        auto it = last_ts.find(entry.pk());
+        if (it != last_ts.end()) {
+            ASSERT_EQ(it->second + 1, entry.ts());
+        }
+        last_ts[entry.pk()] = entry.ts();
+    }
+    delete seq_file;
+}
+
 TEST_F(LogReplicatorTest, LeaderAndFollowerMulti) {
     brpc::ServerOptions options;
     brpc::Server server0;
@@ -300,6 +450,123 @@ TEST_F(LogReplicatorTest, LeaderAndFollowerMulti) {
     }
 }
 
+void AppendEntries(LogReplicator* leader, int start, int cnt) {
+    for (int i = start; i < start + cnt; i++) {
+        ::openmldb::api::LogEntry entry;
+        ::openmldb::test::AddDimension(0, "test_pk", &entry);
+        entry.set_value(::openmldb::test::EncodeKV("test_pk", "value" + std::to_string(i)));
+        entry.set_ts(1000 + i);
+        ASSERT_TRUE(leader->AppendEntry(entry));
+    }
+    leader->Notify();
+}
+
+void CheckEntries(std::shared_ptr<MemTable> table, int cnt) {
+    ASSERT_EQ(cnt, (signed)table->GetRecordCnt());
+    Ticket ticket;
+    TableIterator* it = table->NewIterator("test_pk", ticket);
+    it->SeekToFirst();
+    for (int i = cnt - 1; i >= 0; i--) {
+        ASSERT_TRUE(it->Valid());
+        ::openmldb::base::Slice value = it->GetValue();
+        ASSERT_EQ("value" + std::to_string(i), ::openmldb::test::DecodeV(std::string(value.data(), value.size())));
+        ASSERT_EQ(1000 + i, (signed)it->GetKey());
+        it->Next();
+    }
+    ASSERT_FALSE(it->Valid());
+    delete it;
+}
+
+TEST_F(LogReplicatorTest, PipelineOutOfOrder) {
+    int32_t batch_size = FLAGS_binlog_sync_batch_size;
+    FLAGS_binlog_sync_batch_size = 2;
+    brpc::ServerOptions options;
+    brpc::Server server;
+    std::map<std::string, uint32_t> mapping;
+    mapping.insert(std::make_pair("idx", 0));
+    std::shared_ptr<MemTable> table =
+        std::make_shared<MemTable>("test", 1, 1, 8, mapping, 0, ::openmldb::type::TTLType::kAbsoluteTime);
+    table->Init();
+    PipelineTabletImpl* follower = new PipelineTabletImpl("/tmp/" + GenRand() + "/", table);
+    ASSERT_TRUE(follower->Init());
+    // the second request is applied after the ones behind it arrive
+    follower->SetDelayIndex(2);
+    ASSERT_EQ(0, server.AddService(follower, brpc::SERVER_OWNS_SERVICE));
+    ASSERT_EQ(0, server.Start("127.0.0.1:18537", &options));
+    LogReplicator leader(1, 1, "/tmp/" + GenRand() + "/", g_endpoints, kLeaderNode);
+    ASSERT_TRUE(leader.Init());
+    AppendEntries(&leader, 0, 10);
+    std::map<std::string, std::string> map;
+    map.insert(std::make_pair("127.0.0.1:18537", ""));
+    leader.AddReplicateNode(map);
+    sleep(3);
+    leader.DelAllReplicateNode();
+    FLAGS_binlog_sync_batch_size = batch_size;
+    ASSERT_EQ(10u, follower->GetOffset());
+    ASSERT_GT(follower->GetOutOfOrderCnt(), 0u);
+    ASSERT_EQ(0u, follower->GetFailCnt());
+    CheckEntries(table, 10);
+}
+
+TEST_F(LogReplicatorTest, PipelineSendAgain) {
+    int32_t batch_size = FLAGS_binlog_sync_batch_size;
+    uint32_t tail_buffer_size = FLAGS_binlog_tail_buffer_size;
+    FLAGS_binlog_sync_batch_size = 2;
+    // the entries are read from binlog files and read again after the failure
+    FLAGS_binlog_tail_buffer_size = 0;
+    brpc::ServerOptions options;
+    brpc::Server server;
+    std::map<std::string, uint32_t> mapping;
+    mapping.insert(std::make_pair("idx", 0));
+    std::shared_ptr<MemTable> table =
+        std::make_shared<MemTable>("test", 1, 1, 8, mapping, 0, ::openmldb::type::TTLType::kAbsoluteTime);
+    table->Init();
+    PipelineTabletImpl* follower = new PipelineTabletImpl("/tmp/" + GenRand() + "/", table);
+    ASSERT_TRUE(follower->Init());
+    follower->SetFailIndex(4);
+    ASSERT_EQ(0, server.AddService(follower, brpc::SERVER_OWNS_SERVICE));
+    ASSERT_EQ(0, server.Start("127.0.0.1:18538", &options));
+    LogReplicator leader(1, 1, "/tmp/" + GenRand() + "/", g_endpoints, kLeaderNode);
+    ASSERT_TRUE(leader.Init());
+    AppendEntries(&leader, 0, 10);
+    std::map<std::string, std::string> map;
+    map.insert(std::make_pair("127.0.0.1:18538", ""));
+    leader.AddReplicateNode(map);
+    sleep(5);
+    leader.DelAllReplicateNode();
+    FLAGS_binlog_sync_batch_size = batch_size;
+    FLAGS_binlog_tail_buffer_size = tail_buffer_size;
+    ASSERT_EQ(1u, follower->GetFailCnt());
+    ASSERT_EQ(10u, follower->GetOffset());
+    CheckEntries(table, 10);
+}
+
+TEST_F(LogReplicatorTest, OldFollowerWithoutAttachment) {
+    brpc::ServerOptions options;
+    brpc::Server server;
+    std::map<std::string, uint32_t> mapping;
+    mapping.insert(std::make_pair("idx", 0));
+    std::shared_ptr<MemTable> table =
+        std::make_shared<MemTable>("test", 1, 1, 8, mapping, 0, ::openmldb::type::TTLType::kAbsoluteTime);
+    table->Init();
+    // MockTabletImpl ignores the attachment like the follower of old version
+    MockTabletImpl* follower = new MockTabletImpl(kFollowerNode, "/tmp/" + GenRand() + "/", g_endpoints, table);
+    ASSERT_TRUE(follower->Init());
+    ASSERT_EQ(0, server.AddService(follower, brpc::SERVER_OWNS_SERVICE));
+    ASSERT_EQ(0, server.Start("127.0.0.1:18539", &options));
+    LogReplicator leader(1, 1, "/tmp/" + GenRand() + "/", g_endpoints, kLeaderNode);
+    ASSERT_TRUE(leader.Init());
+    AppendEntries(&leader, 0, 5);
+    std::map<std::string, std::string> map;
+    map.insert(std::make_pair("127.0.0.1:18539", ""));
+    leader.AddReplicateNode(map);
+    sleep(3);
+    AppendEntries(&leader, 5, 5);
+    sleep(3);
+    leader.DelAllReplicateNode();
+    CheckEntries(table, 10);
+}
+
 TEST_F(LogReplicatorTest, LeaderAndFollower) {
     brpc::ServerOptions options;
     brpc::Server server0;
@@ -0,0 +1,101 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "replica/log_tail_buffer.h"
+
+namespace openmldb {
+namespace replica {
+
+LogTailBuffer::LogTailBuffer(uint64_t capacity)
+    : mu_(), capacity_(capacity), first_index_(0), size_(0), appended_bytes_(0), items_() {}
+
+void LogTailBuffer::Append(uint64_t log_index, const ::openmldb::base::Slice& entry) {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (!items_.empty() && first_index_ + items_.size() != log_index) {
+        items_.clear();
+        size_ = 0;
+        appended_bytes_ = 0;
+    }
+    if (items_.empty()) {
+        first_index_ = log_index;
+    }
+    appended_bytes_ += entry.size();
+    items_.emplace_back();
+    items_.back().data.append(entry.data(), entry.size());
+    items_.back().end_bytes = appended_bytes_;
+    size_ += entry.size();
+    while (size_ > capacity_ && !items_.empty()) {
+        size_ -= items_.front().data.size();
+        items_.pop_front();
+        first_index_++;
+    }
+}
+
+uint32_t LogTailBuffer::Read(uint64_t start_index, uint32_t max_cnt, butil::IOBuf* buf,
+                             std::vector<uint32_t>* sizes) {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (items_.empty() || start_index < first_index_ || start_index >= first_index_ + items_.size()) {
+        return 0;
+    }
+    uint32_t cnt = 0;
+    for (size_t pos = start_index - first_index_; pos < items_.size() && cnt < max_cnt; pos++) {
+        buf->append(items_[pos].data);
+        sizes->push_back(items_[pos].data.size());
+        cnt++;
+    }
+    return cnt;
+}
+
+uint64_t LogTailBuffer::GetBytesAfter(uint64_t offset) {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (items_.empty()) {
+        return 0;
+    }
+    uint64_t last_index = first_index_ + items_.size() - 1;
+    if (offset >= last_index) {
+        return 0;
+    }
+    if (offset >= first_index_) {
+        return appended_bytes_ - items_[offset - first_index_].end_bytes;
+    }
+    return size_ + (first_index_ - 1 - offset) * (size_ / items_.size());
+}
+
+uint64_t LogTailBuffer::GetFirstIndex() {
+    std::lock_guard<std::mutex> lock(mu_);
+    return items_.empty() ? 0 : first_index_;
+}
+
+uint64_t LogTailBuffer::GetLastIndex() {
+    std::lock_guard<std::mutex> lock(mu_);
+    return items_.empty() ? 0 : first_index_ + items_.size() - 1;
+}
+
+uint64_t LogTailBuffer::GetSize() {
+    std::lock_guard<std::mutex> lock(mu_);
+    return size_;
+}
+
+void LogTailBuffer::Clear() {
+    std::lock_guard<std::mutex> lock(mu_);
+    items_.clear();
+    first_index_ = 0;
+    size_ = 0;
+    appended_bytes_ = 0;
+}
+
+}  // namespace replica
+}  // namespace openmldb
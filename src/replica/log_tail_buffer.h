@@ -0,0 +1,78 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_REPLICA_LOG_TAIL_BUFFER_H_
+#define SRC_REPLICA_LOG_TAIL_BUFFER_H_
+
+#include <deque>
+#include <mutex>  // NOLINT
+#include <vector>
+
+#include "base/slice.h"
+#include "butil/iobuf.h"
+
+namespace openmldb {
+namespace replica {
+
+// LogTailBuffer keeps the serialized entries which are appended to binlog recently,
+// so the replicate nodes which keep up with the leader read them without reading binlog
+// files. The entries are shared by the nodes and appended to the rpc attachments without copy.
+// The oldest entries are evicted if the size of entries exceeds the capacity
+class LogTailBuffer {
+ public:
+    explicit LogTailBuffer(uint64_t capacity);
+
+    LogTailBuffer(const LogTailBuffer&) = delete;
+    LogTailBuffer& operator=(const LogTailBuffer&) = delete;
+
+    // append the entry with log_index, the buffer is cleared first if the log_index
+    // is not next to the last one
+    void Append(uint64_t log_index, const ::openmldb::base::Slice& entry);
+
+    // append at most max_cnt entries from start_index to buf and their sizes to sizes,
+    // return the count of entries read and 0 if the entry of start_index is not in buffer
+    uint32_t Read(uint64_t start_index, uint32_t max_cnt, butil::IOBuf* buf, std::vector<uint32_t>* sizes);
+
+    // the bytes of the entries after offset, the ones evicted are estimated with the average size
+    uint64_t GetBytesAfter(uint64_t offset);
+
+    // the first and last log index in buffer, both are 0 if the buffer is empty
+    uint64_t GetFirstIndex();
+    uint64_t GetLastIndex();
+
+    uint64_t GetSize();
+
+    void Clear();
+
+ private:
+    struct Item {
+        butil::IOBuf data;
+        // the bytes appended since the buffer is cleared, including this entry
+        uint64_t end_bytes;
+    };
+
+    std::mutex mu_;
+    uint64_t capacity_;
+    uint64_t first_index_;
+    uint64_t size_;
+    uint64_t appended_bytes_;
+    std::deque<Item> items_;
+};
+
+}  // namespace replica
+}  // namespace openmldb
+
+#endif  // SRC_REPLICA_LOG_TAIL_BUFFER_H_
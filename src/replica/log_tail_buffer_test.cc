@@ -0,0 +1,97 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "replica/log_tail_buffer.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+namespace openmldb {
+namespace replica {
+
+class LogTailBufferTest : public ::testing::Test {
+ public:
+    LogTailBufferTest() {}
+    ~LogTailBufferTest() {}
+};
+
+TEST_F(LogTailBufferTest, AppendAndRead) {
+    LogTailBuffer buffer(1024);
+    for (uint64_t i = 1; i <= 10; i++) {
+        std::string entry = "entry" + std::to_string(i);
+        buffer.Append(i, ::openmldb::base::Slice(entry));
+    }
+    ASSERT_EQ(1u, buffer.GetFirstIndex());
+    ASSERT_EQ(10u, buffer.GetLastIndex());
+    butil::IOBuf buf;
+    std::vector<uint32_t> sizes;
+    ASSERT_EQ(3u, buffer.Read(4, 3, &buf, &sizes));
+    ASSERT_EQ("entry4entry5entry6", buf.to_string());
+    ASSERT_EQ(std::vector<uint32_t>({6, 6, 6}), sizes);
+    buf.clear();
+    sizes.clear();
+    ASSERT_EQ(2u, buffer.Read(9, 10, &buf, &sizes));
+    ASSERT_EQ("entry9entry10", buf.to_string());
+    ASSERT_EQ(0u, buffer.Read(11, 10, &buf, &sizes));
+    ASSERT_EQ(0u, buffer.Read(0, 10, &buf, &sizes));
+    ASSERT_EQ(7u, buffer.GetBytesAfter(9));
+    ASSERT_EQ(0u, buffer.GetBytesAfter(10));
+    ASSERT_EQ(buffer.GetSize(), buffer.GetBytesAfter(0));
+}
+
+TEST_F(LogTailBufferTest, Evict) {
+    LogTailBuffer buffer(30);
+    for (uint64_t i = 1; i <= 10; i++) {
+        buffer.Append(i, ::openmldb::base::Slice("0123456789"));
+    }
+    ASSERT_EQ(30u, buffer.GetSize());
+    ASSERT_EQ(8u, buffer.GetFirstIndex());
+    ASSERT_EQ(10u, buffer.GetLastIndex());
+    butil::IOBuf buf;
+    std::vector<uint32_t> sizes;
+    ASSERT_EQ(0u, buffer.Read(7, 10, &buf, &sizes));
+    ASSERT_EQ(3u, buffer.Read(8, 10, &buf, &sizes));
+    // the evicted entries are estimated with the average size
+    ASSERT_EQ(50u, buffer.GetBytesAfter(5));
+    // the entry larger than the capacity is not kept
+    buffer.Append(11, ::openmldb::base::Slice(std::string(31, 'a')));
+    ASSERT_EQ(0u, buffer.GetSize());
+    ASSERT_EQ(0u, buffer.GetLastIndex());
+}
+
+TEST_F(LogTailBufferTest, Discontinuous) {
+    LogTailBuffer buffer(1024);
+    buffer.Append(1, ::openmldb::base::Slice("a"));
+    buffer.Append(2, ::openmldb::base::Slice("b"));
+    // the offset of replicator is reset
+    buffer.Append(10, ::openmldb::base::Slice("c"));
+    ASSERT_EQ(10u, buffer.GetFirstIndex());
+    ASSERT_EQ(10u, buffer.GetLastIndex());
+    ASSERT_EQ(1u, buffer.GetSize());
+    buffer.Clear();
+    ASSERT_EQ(0u, buffer.GetFirstIndex());
+    ASSERT_EQ(0u, buffer.GetSize());
+}
+
+}  // namespace replica
+}  // namespace openmldb
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -19,9 +19,11 @@
 #include <gflags/gflags.h>
 
 #include <algorithm>
+#include <vector>
 
 #include "base/glog_wapper.h"  // NOLINT
 #include "base/strings.h"
+#include "brpc/controller.h"
 
 DECLARE_int32(binlog_sync_batch_size);
 DECLARE_int32(binlog_sync_wait_time);
@@ -31,6 +33,7 @@ DECLARE_int32(request_max_retry);
 DECLARE_int32(request_timeout_ms);
 DECLARE_string(zk_cluster);
 DECLARE_uint32(go_back_max_try_cnt);
+DECLARE_uint32(binlog_sync_max_inflight);
 
 namespace openmldb {
 namespace replica {
@@ -46,14 +49,54 @@ static void* RunSyncTask(void* args) {
     return NULL;
 }
 
+// the log part holding the entries after offset
+static int FindLogIndex(LogParts* logs, uint64_t offset) {
+    int index = -1;
+    LogParts::Iterator* it = logs->NewIterator();
+    it->SeekToFirst();
+    while (it->Valid()) {
+        if (it->GetValue() <= offset) {
+            index = (int)it->GetKey();  // NOLINT
+            break;
+        }
+        it->Next();
+    }
+    delete it;
+    return index;
+}
+
+class ReplicateNode::AppendEntriesClosure : public google::protobuf::Closure {
+ public:
+    AppendEntriesClosure(const std::shared_ptr<ReplicateNode>& node, bool with_attachment)
+        : node(node), with_attachment(with_attachment), end_offset(0) {}
+
+    void Run() override {
+        node->OnAppendEntries(this);
+        delete this;
+    }
+
+    // hold the node until the response arrives
+    std::shared_ptr<ReplicateNode> node;
+    bool with_attachment;
+    uint64_t end_offset;
+    brpc::Controller cntl;
+    ::openmldb::api::AppendEntriesRequest request;
+    ::openmldb::api::AppendEntriesResponse response;
+};
+
 ReplicateNode::ReplicateNode(const std::string& point, LogParts* logs, const std::string& log_path, uint32_t tid,
                              uint32_t pid, std::atomic<uint64_t>* term, std::atomic<uint64_t>* leader_log_offset,
                              bthread::Mutex* mu, bthread::ConditionVariable* cv, bool rep_follower,
-                             std::atomic<uint64_t>* follower_offset, const std::string& real_point)
-    : log_reader_(logs, log_path, false),
-      cache_(),
+                             std::atomic<uint64_t>* follower_offset, const std::string& real_point,
+                             LogTailBuffer* tail_buffer)
+    : logs_(logs),
+      log_reader_(logs, log_path, false),
+      tail_buffer_(tail_buffer),
       endpoint_(point),
       last_sync_offset_(0),
+      send_offset_(0),
+      reader_offset_(0),
+      reader_positions_(),
       log_matched_(false),
       tid_(tid),
       pid_(pid),
@@ -66,7 +109,12 @@ ReplicateNode::ReplicateNode(const std::string& point, LogParts* logs, const std
       cv_(cv),
       go_back_cnt_(0),
       rep_node_(rep_follower),
-      follower_offset_(follower_offset) {
+      follower_offset_(follower_offset),
+      use_attachment_(true),
+      sync_failed_(false),
+      inflight_mu_(),
+      inflight_cv_(),
+      inflight_cnt_(0) {
     if (!real_point.empty()) {
         rpc_client_ = openmldb::RpcClient<::openmldb::api::TabletServer_Stub>(real_point);
     }
@@ -117,17 +165,14 @@ void ReplicateNode::SyncData() {
         {
             std::unique_lock<bthread::Mutex> lock(*mu_);
             // no new data append and wait
-            while (last_sync_offset_ >= leader_log_offset_->load(std::memory_order_relaxed)) {
+            while (send_offset_ >= leader_log_offset_->load(std::memory_order_relaxed) &&
+                   !sync_failed_.load(std::memory_order_relaxed) && is_running_.load(std::memory_order_relaxed)) {
                 cv_->wait_for(lock, FLAGS_binlog_sync_wait_time * 1000);
-                if (!is_running_.load(std::memory_order_relaxed)) {
-                    PDLOG(INFO,
-                          "replicate log to endpoint %s for table #tid %u #pid "
-                          "%u exist",
-                          endpoint_.c_str(), tid_, pid_);
-                    return;
-                }
             }
         }
+        if (!is_running_.load(std::memory_order_relaxed)) {
+            break;
+        }
         int ret;
         if (rep_node_.load(std::memory_order_relaxed)) {
             ret = SyncData(follower_offset_->load(std::memory_order_relaxed));
@@ -138,18 +183,35 @@ void ReplicateNode::SyncData() {
             coffee_time = FLAGS_binlog_coffee_time;
         }
     }
+    WaitInflight(0);
     PDLOG(INFO, "replicate log to endpoint %s for table #tid %u #pid %u exist", endpoint_.c_str(), tid_, pid_);
 }
 
-int ReplicateNode::GetLogIndex() { return log_reader_.GetLogIndex(); }
+int ReplicateNode::GetLogIndex() {
+    return FindLogIndex(logs_, last_sync_offset_.load(std::memory_order_relaxed));
+}
 
 bool ReplicateNode::IsLogMatched() { return log_matched_; }
 
 std::string ReplicateNode::GetEndPoint() { return endpoint_; }
 
-uint64_t ReplicateNode::GetLastSyncOffset() { return last_sync_offset_; }
+uint64_t ReplicateNode::GetLastSyncOffset() { return last_sync_offset_.load(std::memory_order_relaxed); }
+
+void ReplicateNode::SetLastSyncOffset(uint64_t offset) { last_sync_offset_.store(offset, std::memory_order_relaxed); }
+
+uint64_t ReplicateNode::GetLagEntries() {
+    uint64_t offset = rep_node_.load(std::memory_order_relaxed) ? follower_offset_->load(std::memory_order_relaxed)
+                                                                : leader_log_offset_->load(std::memory_order_relaxed);
+    uint64_t sync_offset = last_sync_offset_.load(std::memory_order_relaxed);
+    return offset > sync_offset ? offset - sync_offset : 0;
+}
 
-void ReplicateNode::SetLastSyncOffset(uint64_t offset) { last_sync_offset_ = offset; }
+uint64_t ReplicateNode::GetLagBytes() {
+    if (tail_buffer_ == NULL) {
+        return 0;
+    }
+    return tail_buffer_->GetBytesAfter(last_sync_offset_.load(std::memory_order_relaxed));
+}
 
 int ReplicateNode::MatchLogOffsetFromNode() {
     ::openmldb::api::AppendEntriesRequest request;
@@ -161,11 +223,13 @@ int ReplicateNode::MatchLogOffsetFromNode() {
     bool ret = rpc_client_.SendRequest(&::openmldb::api::TabletServer_Stub::AppendEntries, &request, &response,
                                        FLAGS_request_timeout_ms, FLAGS_request_max_retry);
     if (ret && response.code() == 0) {
-        last_sync_offset_ = response.log_offset();
+        last_sync_offset_.store(response.log_offset(), std::memory_order_relaxed);
+        send_offset_ = response.log_offset();
+        reader_offset_ = response.log_offset();
         log_matched_ = true;
-        log_reader_.SetOffset(last_sync_offset_);
-        PDLOG(INFO, "match node %s log offset %lu for table tid %u pid %u", endpoint_.c_str(), last_sync_offset_, tid_,
-              pid_);
+        log_reader_.SetOffset(response.log_offset());
+        PDLOG(INFO, "match node %s log offset %lu for table tid %u pid %u", endpoint_.c_str(), response.log_offset(),
+              tid_, pid_);
         return 0;
     }
     PDLOG(WARNING, "match node %s log offset failed. tid %u pid %u", endpoint_.c_str(), tid_, pid_);
@@ -173,84 +237,119 @@ int ReplicateNode::MatchLogOffsetFromNode() {
 }
 
 int ReplicateNode::SyncData(uint64_t log_offset) {
-    DEBUGLOG("node[%s] offset[%lu] log offset[%lu]", endpoint_.c_str(), last_sync_offset_, log_offset);
-    if (log_offset <= last_sync_offset_) {
-        PDLOG(WARNING, "log offset [%lu] le last sync offset [%lu], do nothing", log_offset, last_sync_offset_);
+    DEBUGLOG("node[%s] offset[%lu] send offset[%lu] log offset[%lu]", endpoint_.c_str(),
+             last_sync_offset_.load(std::memory_order_relaxed), send_offset_, log_offset);
+    if (sync_failed_.load(std::memory_order_relaxed)) {
+        // the follower drops the requests after the failed one, send the entries again
+        // from the last synced offset when all responses arrive
+        WaitInflight(0);
+        sync_failed_.store(false, std::memory_order_relaxed);
+        send_offset_ = last_sync_offset_.load(std::memory_order_relaxed);
+        PDLOG(WARNING, "fail to sync log to node %s, send again from offset %lu. tid %u pid %u", endpoint_.c_str(),
+              send_offset_, tid_, pid_);
         return 1;
     }
-    ::openmldb::api::AppendEntriesRequest request;
-    ::openmldb::api::AppendEntriesResponse response;
-    uint64_t sync_log_offset = last_sync_offset_;
-    bool request_from_cache = false;
+    if (log_offset <= send_offset_) {
+        PDLOG(WARNING, "log offset [%lu] le send offset [%lu], do nothing", log_offset, send_offset_);
+        return 1;
+    }
+    bool with_attachment = use_attachment_.load(std::memory_order_relaxed);
+    WaitInflight(with_attachment ? std::max(FLAGS_binlog_sync_max_inflight, 1u) - 1 : 0);
+    if (sync_failed_.load(std::memory_order_relaxed)) {
+        return 0;
+    }
+    AppendEntriesClosure* closure = new AppendEntriesClosure(shared_from_this(), with_attachment);
+    ::openmldb::api::AppendEntriesRequest& request = closure->request;
+    request.set_tid(tid_);
+    request.set_pid(pid_);
+    request.set_pre_log_index(send_offset_);
+    if (!FLAGS_zk_cluster.empty()) {
+        request.set_term(term_->load(std::memory_order_relaxed));
+    }
     bool need_wait = false;
-    if (cache_.size() > 0) {
-        request_from_cache = true;
-        request = cache_[0];
-        if (request.entries_size() <= 0) {
-            cache_.clear();
-            PDLOG(WARNING, "empty append entry request from node %s cache", endpoint_.c_str());
-            return -1;
-        }
-        const ::openmldb::api::LogEntry& entry = request.entries(request.entries_size() - 1);
-        if (entry.log_index() <= last_sync_offset_) {
-            DEBUGLOG("duplicate log index from node %s cache", endpoint_.c_str());
-            cache_.clear();
-            return -1;
+    uint32_t cnt = ReadEntries(log_offset, with_attachment, &request, &closure->cntl.request_attachment(), &need_wait);
+    if (cnt == 0) {
+        delete closure;
+        return 1;
+    }
+    send_offset_ += cnt;
+    closure->end_offset = send_offset_;
+    closure->cntl.set_timeout_ms(FLAGS_request_timeout_ms);
+    closure->cntl.set_max_retry(FLAGS_request_max_retry);
+    {
+        std::lock_guard<bthread::Mutex> lock(inflight_mu_);
+        inflight_cnt_++;
+    }
+    if (!rpc_client_.SendRequest(&::openmldb::api::TabletServer_Stub::AppendEntries, &closure->cntl, &request,
+                                 &closure->response, closure)) {
+        closure->cntl.SetFailed("stub is null");
+        closure->Run();
+    }
+    if (need_wait) {
+        return 1;
+    }
+    return 0;
+}
+
+uint32_t ReplicateNode::ReadEntries(uint64_t log_offset, bool with_attachment,
+                                    ::openmldb::api::AppendEntriesRequest* request, butil::IOBuf* attachment,
+                                    bool* need_wait) {
+    uint32_t batch_size = std::min(log_offset - send_offset_, (uint64_t)FLAGS_binlog_sync_batch_size);
+    if (tail_buffer_ != NULL) {
+        butil::IOBuf buf;
+        std::vector<uint32_t> sizes;
+        uint32_t cnt = tail_buffer_->Read(send_offset_ + 1, batch_size, with_attachment ? attachment : &buf, &sizes);
+        for (uint32_t i = 0; i < cnt; i++) {
+            if (with_attachment) {
+                request->add_entry_sizes(sizes[i]);
+                continue;
+            }
+            butil::IOBuf entry_buf;
+            buf.cutn(&entry_buf, sizes[i]);
+            butil::IOBufAsZeroCopyInputStream stream(entry_buf);
+            if (!request->add_entries()->ParseFromZeroCopyStream(&stream)) {
+                PDLOG(WARNING, "bad protobuf format in tail buffer. tid %u pid %u", tid_, pid_);
+                request->mutable_entries()->RemoveLast();
+                return i;
+            }
         }
-        PDLOG(INFO, "use cached request to send last index %lu. tid %u pid %u", entry.log_index(), tid_, pid_);
-        sync_log_offset = entry.log_index();
-    } else {
-        request.set_tid(tid_);
-        request.set_pid(pid_);
-        request.set_pre_log_index(last_sync_offset_);
-        if (!FLAGS_zk_cluster.empty()) {
-            request.set_term(term_->load(std::memory_order_relaxed));
+        if (cnt > 0) {
+            return cnt;
         }
-        uint32_t batchSize = log_offset - last_sync_offset_;
-        batchSize = std::min(batchSize, (uint32_t)FLAGS_binlog_sync_batch_size);
-        for (uint64_t i = 0; i < batchSize;) {
-            std::string buffer;
-            ::openmldb::base::Slice record;
-            ::openmldb::log::Status status = log_reader_.ReadNextRecord(&record, &buffer);
-            if (status.ok()) {
-                ::openmldb::api::LogEntry* entry = request.add_entries();
-                if (!entry->ParseFromString(record.ToString())) {
-                    PDLOG(WARNING, "bad protobuf format %s size %ld. tid %u pid %u",
-                          ::openmldb::base::DebugString(record.ToString()).c_str(), record.ToString().size(), tid_,
-                          pid_);
-                    request.mutable_entries()->RemoveLast();
-                    break;
+    }
+    PositionReader();
+    uint64_t sync_log_offset = send_offset_;
+    ReaderPosition position = {0, -1, 0};
+    ::openmldb::api::LogEntry attached_entry;
+    for (uint64_t i = 0; i < batch_size;) {
+        std::string buffer;
+        ::openmldb::base::Slice record;
+        ::openmldb::log::Status status = log_reader_.ReadNextRecord(&record, &buffer);
+        if (status.ok()) {
+            ::openmldb::api::LogEntry* entry = with_attachment ? &attached_entry : request->add_entries();
+            if (!entry->ParseFromString(record.ToString())) {
+                PDLOG(WARNING, "bad protobuf format %s size %ld. tid %u pid %u",
+                      ::openmldb::base::DebugString(record.ToString()).c_str(), record.ToString().size(), tid_, pid_);
+                if (!with_attachment) {
+                    request->mutable_entries()->RemoveLast();
                 }
-                DEBUGLOG("entry val %s log index %lld", entry->value().c_str(), entry->log_index());
-                if (entry->log_index() <= sync_log_offset) {
-                    DEBUGLOG("skip duplicate log offset %lld", entry->log_index());
-                    request.mutable_entries()->RemoveLast();
-                    continue;
+                break;
+            }
+            DEBUGLOG("entry val %s log index %lld", entry->value().c_str(), entry->log_index());
+            if (entry->log_index() <= sync_log_offset) {
+                DEBUGLOG("skip duplicate log offset %lld", entry->log_index());
+                if (!with_attachment) {
+                    request->mutable_entries()->RemoveLast();
                 }
-                // the log index should incr by 1
-                if ((sync_log_offset + 1) != entry->log_index()) {
-                    PDLOG(WARNING, "log missing expect offset %lu but %ld. tid %u pid %u", sync_log_offset + 1,
-                          entry->log_index(), tid_, pid_);
-                    request.mutable_entries()->RemoveLast();
-                    if (go_back_cnt_ > FLAGS_go_back_max_try_cnt) {
-                        log_reader_.GoBackToStart();
-                        go_back_cnt_ = 0;
-                        PDLOG(WARNING, "go back to start. tid %u pid %u endpoint %s", tid_, pid_, endpoint_.c_str());
-                    } else {
-                        log_reader_.GoBackToLastBlock();
-                        go_back_cnt_++;
-                    }
-                    need_wait = true;
-                    break;
+                continue;
+            }
+            // the log index should incr by 1
+            if ((sync_log_offset + 1) != entry->log_index()) {
+                PDLOG(WARNING, "log missing expect offset %lu but %ld. tid %u pid %u", sync_log_offset + 1,
+                      entry->log_index(), tid_, pid_);
+                if (!with_attachment) {
+                    request->mutable_entries()->RemoveLast();
                 }
-                sync_log_offset = entry->log_index();
-            } else if (status.IsWaitRecord()) {
-                DEBUGLOG("got a coffee time for[%s]", endpoint_.c_str());
-                need_wait = true;
-                break;
-            } else if (status.IsInvalidRecord()) {
-                DEBUGLOG("fail to get record. %s. tid %u pid %u", status.ToString().c_str(), tid_, pid_);
-                need_wait = true;
                 if (go_back_cnt_ > FLAGS_go_back_max_try_cnt) {
                     log_reader_.GoBackToStart();
                     go_back_cnt_ = 0;
@@ -259,41 +358,122 @@ int ReplicateNode::SyncData(uint64_t log_offset) {
                     log_reader_.GoBackToLastBlock();
                     go_back_cnt_++;
                 }
-                break;
-            } else {
-                PDLOG(WARNING, "fail to get record: %s. tid %u pid %u", status.ToString().c_str(), tid_, pid_);
-                need_wait = true;
+                *need_wait = true;
                 break;
             }
-            i++;
-            go_back_cnt_ = 0;
-        }
-    }
-    if (request.entries_size() > 0) {
-        bool ret = rpc_client_.SendRequest(&::openmldb::api::TabletServer_Stub::AppendEntries, &request, &response,
-                                           FLAGS_request_timeout_ms, FLAGS_request_max_retry);
-        if (ret && response.code() == 0) {
-            DEBUGLOG("sync log to node[%s] to offset %lld", endpoint_.c_str(), sync_log_offset);
-            last_sync_offset_ = sync_log_offset;
-            if (!rep_node_.load(std::memory_order_relaxed) &&
-                (last_sync_offset_ > follower_offset_->load(std::memory_order_relaxed))) {
-                follower_offset_->store(last_sync_offset_, std::memory_order_relaxed);
+            if (with_attachment) {
+                attachment->append(record.data(), record.size());
+                request->add_entry_sizes(record.size());
             }
-            if (request_from_cache) {
-                cache_.clear();
+            sync_log_offset = entry->log_index();
+            position = {sync_log_offset, log_reader_.GetLogIndex(), log_reader_.GetLastRecordEndOffset()};
+        } else if (status.IsWaitRecord()) {
+            DEBUGLOG("got a coffee time for[%s]", endpoint_.c_str());
+            *need_wait = true;
+            break;
+        } else if (status.IsInvalidRecord()) {
+            DEBUGLOG("fail to get record. %s. tid %u pid %u", status.ToString().c_str(), tid_, pid_);
+            *need_wait = true;
+            if (go_back_cnt_ > FLAGS_go_back_max_try_cnt) {
+                log_reader_.GoBackToStart();
+                go_back_cnt_ = 0;
+                PDLOG(WARNING, "go back to start. tid %u pid %u endpoint %s", tid_, pid_, endpoint_.c_str());
+            } else {
+                log_reader_.GoBackToLastBlock();
+                go_back_cnt_++;
             }
+            break;
         } else {
-            if (!request_from_cache) {
-                cache_.push_back(request);
-            }
-            need_wait = true;
-            PDLOG(WARNING, "fail to sync log to node %s. tid %u pid %u", endpoint_.c_str(), tid_, pid_);
+            PDLOG(WARNING, "fail to get record: %s. tid %u pid %u", status.ToString().c_str(), tid_, pid_);
+            *need_wait = true;
+            break;
         }
+        i++;
+        go_back_cnt_ = 0;
     }
-    if (need_wait) {
-        return 1;
+    reader_offset_ = sync_log_offset;
+    if (position.log_index >= 0) {
+        reader_positions_.push_back(position);
+    }
+    return sync_log_offset - send_offset_;
+}
+
+void ReplicateNode::PositionReader() {
+    // the requests before last_sync_offset_ are never sent again
+    uint64_t sync_offset = last_sync_offset_.load(std::memory_order_relaxed);
+    while (reader_positions_.size() > 1 &&
+           (reader_positions_[1].offset <= sync_offset ||
+            reader_positions_.size() > std::max(FLAGS_binlog_sync_max_inflight, 1u) + 1)) {
+        reader_positions_.pop_front();
+    }
+    if (reader_offset_ == send_offset_) {
+        return;
+    }
+    if (reader_offset_ < send_offset_) {
+        // the entries are read from tail buffer, the duplicate entries are skipped
+        // if the reader stays in the log part holding send_offset_
+        if (log_reader_.GetLogIndex() >= 0 && log_reader_.GetLogIndex() == FindLogIndex(logs_, send_offset_)) {
+            return;
+        }
+    } else {
+        // the entries are sent again after a failure
+        auto it = reader_positions_.rbegin();
+        while (it != reader_positions_.rend() && it->offset > send_offset_) {
+            ++it;
+        }
+        if (it != reader_positions_.rend() && log_reader_.Seek(it->log_index, it->file_offset) == 0) {
+            reader_offset_ = it->offset;
+            reader_positions_.erase(it.base(), reader_positions_.end());
+            return;
+        }
+    }
+    log_reader_.Reset(send_offset_);
+    reader_positions_.clear();
+    reader_offset_ = send_offset_;
+}
+
+void ReplicateNode::OnAppendEntries(AppendEntriesClosure* closure) {
+    bool ok = !closure->cntl.Failed() && closure->response.code() == 0;
+    if (!ok) {
+        PDLOG(WARNING, "fail to sync log to node %s. error %s, code %d, msg %s. tid %u pid %u", endpoint_.c_str(),
+              closure->cntl.ErrorText().c_str(), closure->response.code(), closure->response.msg().c_str(), tid_,
+              pid_);
+    } else if (closure->with_attachment && closure->response.log_offset() < closure->end_offset) {
+        // the follower of old version ignores the entries in attachment
+        PDLOG(WARNING, "node %s does not apply the entries in attachment, sync without attachment. tid %u pid %u",
+              endpoint_.c_str(), tid_, pid_);
+        use_attachment_.store(false, std::memory_order_relaxed);
+        ok = false;
+    }
+    if (ok) {
+        DEBUGLOG("sync log to node[%s] to offset %lu", endpoint_.c_str(), closure->end_offset);
+        uint64_t offset = last_sync_offset_.load(std::memory_order_relaxed);
+        while (offset < closure->end_offset &&
+               !last_sync_offset_.compare_exchange_weak(offset, closure->end_offset, std::memory_order_relaxed)) {
+        }
+        if (!rep_node_.load(std::memory_order_relaxed) &&
+            (closure->end_offset > follower_offset_->load(std::memory_order_relaxed))) {
+            follower_offset_->store(closure->end_offset, std::memory_order_relaxed);
+        }
+    } else {
+        sync_failed_.store(true, std::memory_order_relaxed);
+    }
+    {
+        std::lock_guard<bthread::Mutex> lock(inflight_mu_);
+        inflight_cnt_--;
+        inflight_cv_.notify_all();
+    }
+    if (!ok) {
+        std::lock_guard<bthread::Mutex> lock(*mu_);
+        cv_->notify_all();
+    }
+}
+
+void ReplicateNode::WaitInflight(uint32_t max_cnt) {
+    std::unique_lock<bthread::Mutex> lock(inflight_mu_);
+    while (inflight_cnt_ > max_cnt) {
+        inflight_cv_.wait(lock);
     }
-    return 0;
 }
 
 void ReplicateNode::Stop() {
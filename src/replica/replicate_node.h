@@ -18,8 +18,9 @@
 #define SRC_REPLICA_REPLICATE_NODE_H_
 
 #include <atomic>
+#include <deque>
+#include <memory>
 #include <string>
-#include <vector>
 
 #include "base/skiplist.h"
 #include "bthread/bthread.h"
@@ -28,6 +29,7 @@
 #include "log/log_writer.h"
 #include "log/sequential_file.h"
 #include "proto/tablet.pb.h"
+#include "replica/log_tail_buffer.h"
 #include "rpc/rpc_client.h"
 
 namespace openmldb {
@@ -36,12 +38,17 @@ namespace replica {
 using ::openmldb::log::LogReader;
 typedef ::openmldb::base::Skiplist<uint32_t, uint64_t, ::openmldb::base::DefaultComparator> LogParts;
 
-class ReplicateNode {
+// ReplicateNode syncs the binlog of leader to a follower. The entries are read from the tail
+// buffer of replicator if the follower keeps up with the leader, or from binlog files otherwise.
+// At most binlog_sync_max_inflight AppendEntries requests are in flight, the entries of them are
+// carried by the attachments. The follower of old version ignores the attachment, then the node
+// falls back to send one request at a time with the entries in request
+class ReplicateNode : public std::enable_shared_from_this<ReplicateNode> {
  public:
     ReplicateNode(const std::string& point, LogParts* logs, const std::string& log_path, uint32_t tid, uint32_t pid,
                   std::atomic<uint64_t>* term, std::atomic<uint64_t>* leader_log_offset, bthread::Mutex* mu,
                   bthread::ConditionVariable* cv, bool rep_follower, std::atomic<uint64_t>* follower_offset,
-                  const std::string& real_point);
+                  const std::string& real_point, LogTailBuffer* tail_buffer = NULL);
     int Init();
 
     int Start();
@@ -61,6 +68,10 @@ class ReplicateNode {
 
     uint64_t GetLastSyncOffset();
 
+    // the count and bytes of the entries which are not synced to follower yet
+    uint64_t GetLagEntries();
+    uint64_t GetLagBytes();
+
     int GetLogIndex();
 
     void Stop();
@@ -70,13 +81,41 @@ class ReplicateNode {
     ReplicateNode& operator=(const ReplicateNode&) = delete;
 
  private:
+    class AppendEntriesClosure;
+
+    // the record after log index offset starts at file_offset of the log part log_index
+    struct ReaderPosition {
+        uint64_t offset;
+        int log_index;
+        uint64_t file_offset;
+    };
+
     int MatchLogOffsetFromNode();
 
+    // read the entries after send_offset_ into request, return the count of entries read
+    uint32_t ReadEntries(uint64_t log_offset, bool with_attachment, ::openmldb::api::AppendEntriesRequest* request,
+                         butil::IOBuf* attachment, bool* need_wait);
+
+    void OnAppendEntries(AppendEntriesClosure* closure);
+
+    // wait until the requests in flight are no more than max_cnt
+    void WaitInflight(uint32_t max_cnt);
+
+    // move log_reader_ to read the entries after send_offset_
+    void PositionReader();
+
  private:
+    LogParts* logs_;
     LogReader log_reader_;
-    std::vector<::openmldb::api::AppendEntriesRequest> cache_;
+    LogTailBuffer* tail_buffer_;
     std::string endpoint_;
-    uint64_t last_sync_offset_;
+    std::atomic<uint64_t> last_sync_offset_;
+    // the entries in (last_sync_offset_, send_offset_] are in flight
+    uint64_t send_offset_;
+    // the last log index read by log_reader_
+    uint64_t reader_offset_;
+    // the positions of log_reader_ after the requests read from binlog files, used to send again
+    std::deque<ReaderPosition> reader_positions_;
     bool log_matched_;
     uint32_t tid_;
     uint32_t pid_;
@@ -90,6 +129,11 @@ class ReplicateNode {
     uint32_t go_back_cnt_;
     std::atomic<bool> rep_node_;
     std::atomic<uint64_t>* follower_offset_;  // max local cluster follower offset
+    std::atomic<bool> use_attachment_;
+    std::atomic<bool> sync_failed_;
+    bthread::Mutex inflight_mu_;
+    bthread::ConditionVariable inflight_cv_;
+    uint32_t inflight_cnt_;
 };
 
 }  // namespace replica
@@ -71,6 +71,32 @@ bool NodeAdapter::TransformToTableDef(::hybridse::node::CreatePlanNode* create_n
                     storage_mode = dynamic_cast<hybridse::node::StorageModeNode *>(table_option)->GetStorageMode();
                     break;
                 }
+                case hybridse::node::kDiskTableOption: {
+                    auto option = dynamic_cast<hybridse::node::DiskTableOptionNode*>(table_option);
+                    auto disk_option = table->mutable_disk_table_option();
+                    if (option->GetName() == "filter_policy") {
+                        const std::string& policy = option->GetValue();
+                        if (policy != "bloom" && policy != "ribbon" && policy != "none") {
+                            status->msg = "filter_policy should be bloom, ribbon or none, but got " + policy;
+                            status->code = hybridse::common::kUnsupportSql;
+                            return false;
+                        }
+                        disk_option->set_filter_policy(policy);
+                    } else {
+                        int64_t value = std::stoll(option->GetValue());
+                        if (value <= 0 || value > UINT16_MAX) {
+                            status->msg = "invalid " + option->GetName() + " " + option->GetValue();
+                            status->code = hybridse::common::kUnsupportSql;
+                            return false;
+                        }
+                        if (option->GetName() == "filter_bits_per_key") {
+                            disk_option->set_filter_bits_per_key(value);
+                        } else {
+                            disk_option->set_block_size_kb(value);
+                        }
+                    }
+                    break;
+                }
                 case hybridse::node::kDistributions: {
                     auto d_list = dynamic_cast<hybridse::node::DistributionsNode*>(table_option)->GetDistributionList();
                     if (d_list != nullptr) {
@@ -100,6 +126,11 @@ bool NodeAdapter::TransformToTableDef(::hybridse::node::CreatePlanNode* create_n
             return false;
         }
     }
+    if (storage_mode == hybridse::node::kMemory && table->has_disk_table_option()) {
+        status->msg = "Fail to create table with the disk table options in memory storage mode";
+        status->code = hybridse::common::kUnsupportSql;
+        return false;
+    }
     table->set_replica_num(replica_num);
     table->set_partition_num(partition_num);
 
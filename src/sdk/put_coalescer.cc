@@ -0,0 +1,69 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "sdk/put_coalescer.h"
+
+#include <chrono>  // NOLINT
+
+namespace openmldb {
+namespace sdk {
+
+bool PutCoalescer::Put(const std::shared_ptr<::openmldb::client::TabletClient>& client, uint32_t tid, uint32_t pid,
+                       const ::openmldb::client::BatchPutRow& row, std::string* msg) {
+    auto key = std::make_pair(tid, pid);
+    std::unique_lock<std::mutex> lock(mu_);
+    auto& slot = batches_[key];
+    bool is_leader = false;
+    if (!slot) {
+        slot = std::make_shared<Batch>();
+        is_leader = true;
+    }
+    std::shared_ptr<Batch> batch = slot;
+    size_t pos = batch->rows.size();
+    batch->rows.push_back(row);
+    if (batch->rows.size() >= batch_size_) {
+        // detach the full batch, the following rows go to a new one
+        batches_.erase(key);
+        batch->full = true;
+        batch->cv.notify_all();
+    }
+    if (is_leader) {
+        batch->cv.wait_for(lock, std::chrono::milliseconds(linger_ms_), [&batch] { return batch->full; });
+        if (!batch->full) {
+            batches_.erase(key);
+            batch->full = true;
+        }
+        lock.unlock();
+        uint32_t put_cnt = 0;
+        std::string err;
+        client->BatchPut(tid, pid, batch->rows, 1, &put_cnt, &err);
+        lock.lock();
+        batch->put_cnt = put_cnt;
+        batch->msg = err;
+        batch->done = true;
+        batch->cv.notify_all();
+    } else {
+        batch->cv.wait(lock, [&batch] { return batch->done; });
+    }
+    if (pos < batch->put_cnt) {
+        return true;
+    }
+    msg->assign(batch->msg);
+    return false;
+}
+
+}  // namespace sdk
+}  // namespace openmldb
@@ -0,0 +1,63 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_SDK_PUT_COALESCER_H_
+#define SRC_SDK_PUT_COALESCER_H_
+
+#include <condition_variable>  // NOLINT
+#include <map>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "client/tablet_client.h"
+
+namespace openmldb {
+namespace sdk {
+
+// Coalesce the single row puts of concurrent callers into BatchPut requests per partition.
+// The first row of a batch waits up to linger_ms for the others, the batch is sent at once
+// when it has batch_size rows. Put blocks until the batch which holds the row is done.
+class PutCoalescer {
+ public:
+    PutCoalescer(uint32_t batch_size, uint32_t linger_ms) : batch_size_(batch_size), linger_ms_(linger_ms) {}
+    PutCoalescer(const PutCoalescer&) = delete;
+    PutCoalescer& operator=(const PutCoalescer&) = delete;
+
+    bool Put(const std::shared_ptr<::openmldb::client::TabletClient>& client, uint32_t tid, uint32_t pid,
+             const ::openmldb::client::BatchPutRow& row, std::string* msg);
+
+ private:
+    struct Batch {
+        std::vector<::openmldb::client::BatchPutRow> rows;
+        bool full = false;
+        bool done = false;
+        uint32_t put_cnt = 0;
+        std::string msg;
+        std::condition_variable cv;
+    };
+
+    const uint32_t batch_size_;
+    const uint32_t linger_ms_;
+    std::mutex mu_;
+    std::map<std::pair<uint32_t, uint32_t>, std::shared_ptr<Batch>> batches_;
+};
+
+}  // namespace sdk
+}  // namespace openmldb
+#endif  // SRC_SDK_PUT_COALESCER_H_
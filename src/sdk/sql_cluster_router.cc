@@ -27,7 +27,9 @@
 #include "absl/strings/str_cat.h"
 #include "absl/strings/strip.h"
 #include "base/ddl_parser.h"
+#include "base/fe_pre_aggr.h"
 #include "base/file_util.h"
+#include "base/hash.h"
 #include "boost/none.hpp"
 #include "boost/property_tree/ini_parser.hpp"
 #include "boost/property_tree/ptree.hpp"
@@ -189,11 +191,29 @@ class BatchQueryFutureImpl : public QueryFuture {
     openmldb::RpcCallback<openmldb::api::SQLBatchRequestQueryResponse>* callback_;
 };
 
+static uint64_t WeighSQLCache(const std::shared_ptr<SQLCache>& cache) {
+    return sizeof(SQLCache) + (cache->table_info ? cache->table_info->SpaceUsedLong() : 0);
+}
+
+// quote the string literal of sql, the '\\' and '\'' in it are escaped
+static std::string QuoteSQLString(const std::string& str) {
+    std::string quoted = "'";
+    for (char ch : str) {
+        if (ch == '\\' || ch == '\'') {
+            quoted.push_back('\\');
+        }
+        quoted.push_back(ch);
+    }
+    quoted.push_back('\'');
+    return quoted;
+}
+
 SQLClusterRouter::SQLClusterRouter(const SQLRouterOptions& options)
     : options_(options),
       is_cluster_mode_(true),
       interactive_(false),
       cluster_sdk_(nullptr),
+      input_cache_(options.max_sql_cache_size, 0, WeighSQLCache),
       mu_(),
       rand_(::baidu::common::timer::now_time()) {}
 
@@ -202,6 +222,7 @@ SQLClusterRouter::SQLClusterRouter(const StandaloneOptions& options)
       is_cluster_mode_(false),
       interactive_(false),
       cluster_sdk_(nullptr),
+      input_cache_(options.max_sql_cache_size, 0, WeighSQLCache),
       mu_(),
       rand_(::baidu::common::timer::now_time()) {}
 
@@ -210,6 +231,7 @@ SQLClusterRouter::SQLClusterRouter(DBSDK* sdk)
       is_cluster_mode_(sdk->IsClusterMode()),
       interactive_(false),
       cluster_sdk_(sdk),
+      input_cache_(options_.max_sql_cache_size, 0, WeighSQLCache),
       mu_(),
       rand_(::baidu::common::timer::now_time()) {}
 
@@ -258,6 +280,10 @@ bool SQLClusterRouter::Init() {
             }
         }
     }
+    const auto& router_options = GetRouterOptions();
+    if (router_options.put_linger_ms > 0 && router_options.put_batch_size > 1) {
+        put_coalescer_.reset(new PutCoalescer(router_options.put_batch_size, router_options.put_linger_ms));
+    }
     std::string db = openmldb::nameserver::INFORMATION_SCHEMA_DB;
     std::string table = openmldb::nameserver::GLOBAL_VARIABLES;
     std::string sql = "select * from " + table;
@@ -597,51 +623,27 @@ DefaultValueMap SQLClusterRouter::GetDefaultMap(std::shared_ptr<::openmldb::name
 // Get Cache with given db, sql and engine mode
 std::shared_ptr<SQLCache> SQLClusterRouter::GetCache(const std::string& db, const std::string& sql,
                                                      const hybridse::vm::EngineMode engine_mode) {
-    std::lock_guard<::openmldb::base::SpinMutex> lock(mu_);
-    auto mode_cache_it = input_lru_cache_.find(db);
-    if (mode_cache_it == input_lru_cache_.end()) {
-        return {};
-    }
-
-    auto it = mode_cache_it->second.find(engine_mode);
-    if (it != mode_cache_it->second.end()) {
-        auto value = it->second.get(sql);
-        if (value != boost::none) {
-            // Check cache validation, the name is the same, but the tid may be different.
-            // Notice that we won't check it when table_info is disabled and router is enabled.
-            //  invalid router info doesn't have tid, so it won't get confused.
-            auto cached_info = value.value()->table_info;
-            if (cached_info) {
-                auto current_info = cluster_sdk_->GetTableInfo(db, cached_info->name());
-                if (!current_info || cached_info->tid() != current_info->tid()) {
-                    // just leave, this invalid value will be updated by SetCache()
-                    return {};
-                }
+    auto value = input_cache_.Get(db, engine_mode, sql);
+    if (value) {
+        // Check cache validation, the name is the same, but the tid may be different.
+        // Notice that we won't check it when table_info is disabled and router is enabled.
+        //  invalid router info doesn't have tid, so it won't get confused.
+        auto cached_info = value->table_info;
+        if (cached_info) {
+            auto current_info = cluster_sdk_->GetTableInfo(db, cached_info->name());
+            if (!current_info || cached_info->tid() != current_info->tid()) {
+                // just leave, this invalid value will be updated by SetCache()
+                return {};
             }
-            return value.value();
         }
     }
-    return {};
+    return value;
 }
 
 void SQLClusterRouter::SetCache(const std::string& db, const std::string& sql,
                                 const hybridse::vm::EngineMode engine_mode,
                                 const std::shared_ptr<SQLCache>& router_cache) {
-    std::lock_guard<::openmldb::base::SpinMutex> lock(mu_);
-    auto it = input_lru_cache_.find(db);
-    if (it == input_lru_cache_.end()) {
-        decltype(input_lru_cache_)::mapped_type db_value;
-        input_lru_cache_.insert(std::make_pair(db, db_value));
-        it = input_lru_cache_.find(db);
-    }
-
-    auto cache_it = it->second.find(engine_mode);
-    if (cache_it == it->second.end()) {
-        decltype(it->second)::mapped_type value(options_.max_sql_cache_size);
-        it->second.insert(std::make_pair(engine_mode, value));
-        cache_it = it->second.find(engine_mode);
-    }
-    cache_it->second.upsert(sql, router_cache);
+    input_cache_.Put(db, engine_mode, sql, router_cache);
 }
 
 std::shared_ptr<SQLInsertRows> SQLClusterRouter::GetInsertRows(const std::string& db, const std::string& sql,
@@ -1145,7 +1147,7 @@ bool SQLClusterRouter::ExecuteInsert(const std::string& db, const std::string& s
         LOG(WARNING) << status->msg;
         return false;
     }
-    size_t cnt = 0;
+    std::vector<std::shared_ptr<SQLInsertRow>> rows;
     for (size_t i = 0; i < default_maps.size(); i++) {
         auto row = std::make_shared<SQLInsertRow>(table_info, schema, default_maps[i], str_lengths[i]);
         if (!row) {
@@ -1160,11 +1162,11 @@ bool SQLClusterRouter::ExecuteInsert(const std::string& db, const std::string& s
             LOG(WARNING) << "fail to build row[" << i << "]";
             continue;
         }
-        if (!PutRow(table_info->tid(), row, tablets, status)) {
-            LOG(WARNING) << "fail to put row[" << i << "] due to: " << status->msg;
-            continue;
-        }
-        cnt++;
+        rows.push_back(row);
+    }
+    size_t cnt = 0;
+    if (!rows.empty() && !PutRows(table_info->tid(), rows, tablets, status, &cnt)) {
+        LOG(WARNING) << "fail to put rows due to: " << status->msg;
     }
     if (cnt < default_maps.size()) {
         status->msg = "Error occur when execute insert, success/total: " + std::to_string(cnt) + "/" +
@@ -1192,7 +1194,13 @@ bool SQLClusterRouter::PutRow(uint32_t tid, const std::shared_ptr<SQLInsertRow>&
                 if (client) {
                     DLOG(INFO) << "put data to endpoint " << client->GetEndpoint() << " with dimensions size "
                                << kv.second.size();
-                    bool ret = client->Put(tid, pid, cur_ts, row->GetRow(), kv.second, 1);
+                    bool ret = false;
+                    if (put_coalescer_) {
+                        std::string msg;
+                        ret = put_coalescer_->Put(client, tid, pid, {cur_ts, &row->GetRow(), &kv.second}, &msg);
+                    } else {
+                        ret = client->Put(tid, pid, cur_ts, row->GetRow(), kv.second, 1);
+                    }
                     if (!ret) {
                         status->msg = "fail to make a put request to table. tid " + std::to_string(tid);
                         LOG(WARNING) << status->msg;
@@ -1209,6 +1217,72 @@ bool SQLClusterRouter::PutRow(uint32_t tid, const std::shared_ptr<SQLInsertRow>&
     return true;
 }
 
+bool SQLClusterRouter::PutRows(uint32_t tid, const std::vector<std::shared_ptr<SQLInsertRow>>& rows,
+                               const std::vector<std::shared_ptr<::openmldb::catalog::TabletAccessor>>& tablets,
+                               ::hybridse::sdk::Status* status, size_t* put_cnt) {
+    if (status == nullptr) {
+        return false;
+    }
+    uint64_t cur_ts = ::baidu::common::timer::get_micros() / 1000;
+    // the rows of each partition and their positions in rows
+    std::map<uint32_t, std::pair<std::vector<::openmldb::client::BatchPutRow>, std::vector<size_t>>> pid_rows;
+    for (size_t i = 0; i < rows.size(); i++) {
+        for (const auto& kv : rows[i]->GetDimensions()) {
+            auto& pid_row = pid_rows[kv.first];
+            pid_row.first.push_back({cur_ts, &rows[i]->GetRow(), &kv.second});
+            pid_row.second.push_back(i);
+        }
+    }
+    // a row is put only if it's put to all its partitions
+    std::vector<bool> failed(rows.size(), false);
+    auto set_put_cnt = [&]() {
+        if (put_cnt != nullptr) {
+            *put_cnt = std::count(failed.begin(), failed.end(), false);
+        }
+    };
+    size_t batch_size = std::max(GetRouterOptions().put_batch_size, 1u);
+    for (auto it = pid_rows.begin(); it != pid_rows.end(); ++it) {
+        uint32_t pid = it->first;
+        const auto& batch_rows = it->second.first;
+        std::shared_ptr<::openmldb::client::TabletClient> client;
+        if (pid < tablets.size() && tablets[pid]) {
+            client = tablets[pid]->GetClient();
+        }
+        size_t start = 0;
+        if (!client) {
+            status->msg = "fail to get tablet client. pid " + std::to_string(pid);
+        }
+        for (; client && start < batch_rows.size(); start += batch_size) {
+            size_t end = std::min(batch_rows.size(), start + batch_size);
+            std::vector<::openmldb::client::BatchPutRow> batch(batch_rows.begin() + start, batch_rows.begin() + end);
+            std::string msg;
+            uint32_t batch_put_cnt = 0;
+            if (!client->BatchPut(tid, pid, batch, 1, &batch_put_cnt, &msg)) {
+                status->msg = "fail to make a batch put request to table. tid " + std::to_string(tid) + " pid " +
+                              std::to_string(pid) + " " + msg;
+                start += batch_put_cnt;
+                break;
+            }
+        }
+        if (start < batch_rows.size()) {
+            LOG(WARNING) << status->msg;
+            // the rows not put to this partition and the rows of the partitions not tried
+            for (size_t i = start; i < batch_rows.size(); i++) {
+                failed[it->second.second[i]] = true;
+            }
+            for (auto next = std::next(it); next != pid_rows.end(); ++next) {
+                for (size_t pos : next->second.second) {
+                    failed[pos] = true;
+                }
+            }
+            set_put_cnt();
+            return false;
+        }
+    }
+    set_put_cnt();
+    return true;
+}
+
 bool SQLClusterRouter::ExecuteInsert(const std::string& db, const std::string& sql, std::shared_ptr<SQLInsertRows> rows,
                                      hybridse::sdk::Status* status) {
     if (!rows || !status) {
@@ -1224,13 +1298,11 @@ bool SQLClusterRouter::ExecuteInsert(const std::string& db, const std::string& s
             status->msg = "fail to get table " + table_info->name() + " tablet";
             return false;
         }
+        std::vector<std::shared_ptr<SQLInsertRow>> insert_rows;
         for (uint32_t i = 0; i < rows->GetCnt(); ++i) {
-            std::shared_ptr<SQLInsertRow> row = rows->GetRow(i);
-            if (!PutRow(table_info->tid(), row, tablets, status)) {
-                return false;
-            }
+            insert_rows.push_back(rows->GetRow(i));
         }
-        return true;
+        return PutRows(table_info->tid(), insert_rows, tablets, status);
     } else {
         status->msg = "please use getInsertRow with " + sql + " first";
         return false;
@@ -1463,6 +1535,18 @@ std::shared_ptr<hybridse::sdk::ResultSet> SQLClusterRouter::HandleSQLCmd(const h
             options["storage_mode"] = StorageMode_Name(table->storage_mode());
             // remove the prefix 'k', i.e., change kMemory to Memory
             options["storage_mode"] = options["storage_mode"].substr(1, options["storage_mode"].size() - 1);
+            if (table->has_disk_table_option()) {
+                const auto& disk_option = table->disk_table_option();
+                if (disk_option.has_filter_policy()) {
+                    options["filter_policy"] = disk_option.filter_policy();
+                }
+                if (disk_option.has_filter_bits_per_key()) {
+                    options["filter_bits_per_key"] = std::to_string(disk_option.filter_bits_per_key());
+                }
+                if (disk_option.has_block_size_kb()) {
+                    options["block_size_kb"] = std::to_string(disk_option.block_size_kb());
+                }
+            }
             ::openmldb::cmd::PrintTableOptions(options, ss);
             result.emplace_back(std::vector{ss.str()});
             return ResultSetSQL::MakeResultSet({FORMAT_STRING_KEY}, result, status);
@@ -2161,6 +2245,9 @@ bool SQLClusterRouter::UpdateOfflineTableInfo(const ::openmldb::nameserver::Tabl
     table_partition->CopyFrom(base_table_info.table_partition());
     table_info.set_format_version(1);
     table_info.set_storage_mode(base_table_info.storage_mode());
+    if (base_table_info.has_disk_table_option()) {
+        table_info.mutable_disk_table_option()->CopyFrom(base_table_info.disk_table_option());
+    }
     auto SetColumnDesc = [](const std::string& name, openmldb::type::DataType type,
                             openmldb::common::ColumnDesc* field) {
         if (field != nullptr) {
@@ -2735,34 +2822,53 @@ hybridse::sdk::Status SQLClusterRouter::HandleLoadDataInfile(
             str_cols_idx.emplace_back(i);
         }
     }
+    // the rows are put with batch put requests every put_batch_size rows
+    uint32_t batch_size = std::max(GetRouterOptions().put_batch_size, 1u);
+    std::shared_ptr<SQLInsertRows> rows;
     uint64_t i = 0;
     do {
+        if (!rows) {
+            rows = GetInsertRows(database, insert_placeholder, &status);
+            if (!rows) {
+                return {::hybridse::common::StatusCode::kCmdError, "get insert rows failed, " + status.msg};
+            }
+        }
         cols.clear();
         std::string error;
         ::openmldb::sdk::SplitLineWithDelimiterForStrings(line, options_parse.GetDelimiter(), &cols,
                                                           options_parse.GetQuote());
-        auto ret = InsertOneRow(database, insert_placeholder, str_cols_idx, options_parse.GetNullValue(), cols);
+        auto ret = AppendInsertRow(rows, str_cols_idx, options_parse.GetNullValue(), cols);
         if (!ret.IsOK()) {
             return {::hybridse::common::StatusCode::kCmdError, "line [" + line + "] insert failed, " + ret.msg};
         }
-        ++i;
+        if (rows->GetCnt() >= batch_size) {
+            if (!ExecuteInsert(database, insert_placeholder, rows, &status)) {
+                return {::hybridse::common::StatusCode::kCmdError,
+                        "insert rows before line [" + line + "] failed, " + status.msg};
+            }
+            i += rows->GetCnt();
+            rows.reset();
+        }
     } while (std::getline(file, line));
+    if (rows && rows->GetCnt() > 0) {
+        if (!ExecuteInsert(database, insert_placeholder, rows, &status)) {
+            return {::hybridse::common::StatusCode::kCmdError, "insert the last rows failed, " + status.msg};
+        }
+        i += rows->GetCnt();
+    }
     return {0, "Load " + std::to_string(i) + " rows"};
 }
 
-hybridse::sdk::Status SQLClusterRouter::InsertOneRow(const std::string& database, const std::string& insert_placeholder,
-                                                     const std::vector<int>& str_col_idx, const std::string& null_value,
-                                                     const std::vector<std::string>& cols) {
+hybridse::sdk::Status SQLClusterRouter::AppendInsertRow(const std::shared_ptr<SQLInsertRows>& rows,
+                                                        const std::vector<int>& str_col_idx,
+                                                        const std::string& null_value,
+                                                        const std::vector<std::string>& cols) {
     if (cols.empty()) {
         return {::hybridse::common::StatusCode::kCmdError, "cols is empty"};
     }
-    if (database.empty()) {
-        return {::hybridse::common::StatusCode::kCmdError, "database is empty"};
-    }
-    hybridse::sdk::Status status;
-    auto row = GetInsertRow(database, insert_placeholder, &status);
+    auto row = rows->NewRow();
     if (!row) {
-        return status;
+        return {::hybridse::common::StatusCode::kCmdError, "new row failed"};
     }
     // build row from cols
     auto& schema = row->GetSchema();
@@ -2785,9 +2891,6 @@ hybridse::sdk::Status SQLClusterRouter::InsertOneRow(const std::string& database
             return {::hybridse::common::StatusCode::kCmdError, "translate to insert row failed"};
         }
     }
-    if (!ExecuteInsert(database, insert_placeholder, row, &status)) {
-        return {::hybridse::common::StatusCode::kCmdError, "insert row failed"};
-    }
     return {};
 }
 
@@ -3198,6 +3301,13 @@ hybridse::sdk::Status SQLClusterRouter::HandleLongWindows(
         std::string meta_table = openmldb::nameserver::PRE_AGG_META_NAME;
         std::string aggr_db = openmldb::nameserver::PRE_AGG_DB;
         for (const auto& lw : long_window_infos) {
+            ::hybridse::base::PreAggrFunc pre_aggr_func;
+            std::vector<std::string> pre_aggr_args;
+            if (!::hybridse::base::ParsePreAggrFunc(absl::AsciiStrToLower(lw.aggr_func_), &pre_aggr_func) ||
+                !::hybridse::base::SplitPreAggrArgs(lw.aggr_col_, pre_aggr_func, &pre_aggr_args)) {
+                return {base::ReturnCode::kError,
+                        absl::StrCat("unsupported aggregate in long window: ", lw.aggr_func_, "(", lw.aggr_col_, ")")};
+            }
             // check if pre-aggr table exists
             bool is_exist = CheckPreAggrTableExist(base_table, base_db, lw.aggr_func_, lw.aggr_col_, lw.partition_col_,
                                                    lw.order_col_, lw.bucket_size_);
@@ -3206,13 +3316,23 @@ hybridse::sdk::Status SQLClusterRouter::HandleLongWindows(
             }
             // insert pre-aggr meta info to meta table
             std::string aggr_col = lw.aggr_col_ == "*" ? "" : lw.aggr_col_;
+            // the arguments may contain the condition, e.g. `c1,c2 > 5`, which are replaced by '_' in the name.
+            // The replaced names of `c2 > 5` and `c2 < 5` are the same, so the hash of the arguments is appended
+            std::string name_col = aggr_col;
+            std::replace_if(
+                name_col.begin(), name_col.end(), [](char ch) { return !absl::ascii_isalnum(ch) && ch != '_'; }, '_');
+            if (name_col != aggr_col) {
+                absl::StrAppend(&name_col, "_", absl::Hex(static_cast<uint64_t>(::openmldb::base::hash64(aggr_col))));
+            }
             auto aggr_table =
-                absl::StrCat("pre_", deploy_node->Name(), "_", lw.window_name_, "_", lw.aggr_func_, "_", aggr_col);
+                absl::StrCat("pre_", deploy_node->Name(), "_", lw.window_name_, "_", lw.aggr_func_, "_", name_col);
             ::hybridse::sdk::Status status;
-            std::string insert_sql =
-                absl::StrCat("insert into ", meta_db, ".", meta_table, " values('" + aggr_table, "', '", aggr_db,
-                             "', '", base_db, "', '", base_table, "', '", lw.aggr_func_, "', '", lw.aggr_col_, "', '",
-                             lw.partition_col_, "', '", lw.order_col_, "', '", lw.bucket_size_, "');");
+            std::string insert_sql = absl::StrCat(
+                "insert into ", meta_db, ".", meta_table, " values(", QuoteSQLString(aggr_table), ", ",
+                QuoteSQLString(aggr_db), ", ", QuoteSQLString(base_db), ", ", QuoteSQLString(base_table), ", ",
+                QuoteSQLString(lw.aggr_func_), ", ", QuoteSQLString(lw.aggr_col_), ", ",
+                QuoteSQLString(lw.partition_col_), ", ", QuoteSQLString(lw.order_col_), ", ",
+                QuoteSQLString(lw.bucket_size_), ");");
             bool ok = ExecuteInsert("", insert_sql, &status);
             if (!ok) {
                 return {base::ReturnCode::kError, "insert pre-aggr meta failed"};
@@ -3285,10 +3405,11 @@ bool SQLClusterRouter::CheckPreAggrTableExist(const std::string& base_table, con
     std::string meta_db = openmldb::nameserver::INTERNAL_DB;
     std::string meta_table = openmldb::nameserver::PRE_AGG_META_NAME;
     std::string meta_info = absl::StrCat(
-        "base_db = '", base_db, "' and base_table = '", base_table, "' and aggr_func = '", aggr_func,
-        "' and aggr_col = '", aggr_col, "' and partition_cols = '", partition_col, "' and order_by_col = '", order_col);
+        "base_db = ", QuoteSQLString(base_db), " and base_table = ", QuoteSQLString(base_table),
+        " and aggr_func = ", QuoteSQLString(aggr_func), " and aggr_col = ", QuoteSQLString(aggr_col),
+        " and partition_cols = ", QuoteSQLString(partition_col), " and order_by_col = ", QuoteSQLString(order_col));
     std::string select_sql =
-        absl::StrCat("select bucket_size from ", meta_db, ".", meta_table, " where ", meta_info, "';");
+        absl::StrCat("select bucket_size from ", meta_db, ".", meta_table, " where ", meta_info, ";");
     hybridse::sdk::Status status;
     auto rs = ExecuteSQL("", select_sql, &status);
     if (!status.IsOK()) {
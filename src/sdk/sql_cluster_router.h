@@ -28,11 +28,12 @@
 #include "base/ddl_parser.h"
 #include "base/random.h"
 #include "base/spinlock.h"
-#include "base/lru_cache.h"
 #include "client/tablet_client.h"
 #include "sdk/db_sdk.h"
+#include "sdk/put_coalescer.h"
 #include "sdk/sql_router.h"
 #include "sdk/table_reader_impl.h"
+#include "vm/compile_cache.h"
 #include "nameserver/system_table.h"
 
 namespace openmldb {
@@ -303,6 +304,19 @@ class SQLClusterRouter : public SQLRouter {
                 const std::vector<std::shared_ptr<::openmldb::catalog::TabletAccessor>>& tablets,
                 ::hybridse::sdk::Status* status);
 
+    // put the rows with batch put requests per partition, it stops at the first failed request.
+    // put_cnt is the count of rows put to all their partitions if it is not null
+    bool PutRows(uint32_t tid, const std::vector<std::shared_ptr<SQLInsertRow>>& rows,
+                 const std::vector<std::shared_ptr<::openmldb::catalog::TabletAccessor>>& tablets,
+                 ::hybridse::sdk::Status* status, size_t* put_cnt = nullptr);
+
+    const BasicRouterOptions& GetRouterOptions() const {
+        if (is_cluster_mode_) {
+            return options_;
+        }
+        return standalone_options_;
+    }
+
     bool IsConstQuery(::hybridse::vm::PhysicalOpNode* node);
     std::shared_ptr<SQLCache> GetCache(const std::string& db, const std::string& sql,
                                        const hybridse::vm::EngineMode engine_mode);
@@ -348,9 +362,9 @@ class SQLClusterRouter : public SQLRouter {
             const std::string& table, const std::string& file_path,
             const std::shared_ptr<hybridse::node::OptionsMap>& options);
 
-    hybridse::sdk::Status InsertOneRow(const std::string& database,
-            const std::string& insert_placeholder, const std::vector<int>& str_col_idx,
-            const std::string& null_value, const std::vector<std::string>& cols);
+    // build a row from cols and append it to rows
+    hybridse::sdk::Status AppendInsertRow(const std::shared_ptr<SQLInsertRows>& rows,
+            const std::vector<int>& str_col_idx, const std::string& null_value, const std::vector<std::string>& cols);
 
     hybridse::sdk::Status HandleDeploy(const hybridse::node::DeployPlanNode* deploy_node);
 
@@ -398,11 +412,10 @@ class SQLClusterRouter : public SQLRouter {
     bool is_cluster_mode_;
     bool interactive_;
     DBSDK* cluster_sdk_;
-    std::map<std::string,
-             std::map<hybridse::vm::EngineMode,
-                      base::lru_cache<std::string, std::shared_ptr<SQLCache>>>> input_lru_cache_;
+    ::hybridse::vm::ShardedCompileCache<SQLCache> input_cache_;
     ::openmldb::base::SpinMutex mu_;
     ::openmldb::base::Random rand_;
+    std::unique_ptr<PutCoalescer> put_coalescer_;
 };
 
 }  // namespace sdk
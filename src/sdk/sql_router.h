@@ -39,8 +39,14 @@ namespace sdk {
 struct BasicRouterOptions {
     bool enable_debug = false;
     uint32_t session_timeout = 2000;
-    uint32_t max_sql_cache_size = 10;
+    // the max number of cached sqls of all the dbs and modes together, they are spread over up to 16 shards and a
+    // shard holds 8 sqls at least, so a size below 128 shards the cache less
+    uint32_t max_sql_cache_size = 1000;
     uint32_t request_timeout = 60000;
+    // the max rows of one batch put request
+    uint32_t put_batch_size = 1000;
+    // the max time in ms a single row put waits for others of the same partition, 0 means no waiting
+    uint32_t put_linger_ms = 0;
 };
 
 struct SQLRouterOptions : BasicRouterOptions {
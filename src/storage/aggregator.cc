@@ -16,6 +16,7 @@
 
 #include <algorithm>
 #include <utility>
+#include <vector>
 #include "boost/algorithm/string.hpp"
 
 #include "base/file_util.h"
@@ -25,8 +26,11 @@
 #include "common/timer.h"
 #include "storage/aggregator.h"
 #include "storage/table.h"
+#include "storage/window_aggr_cache.h"
 
 DECLARE_bool(binlog_notify_on_put);
+DECLARE_uint32(window_aggr_cache_max_rows);
+DECLARE_uint32(window_aggr_cache_max_keys);
 namespace openmldb {
 namespace storage {
 
@@ -67,6 +71,9 @@ Aggregator::Aggregator(const ::openmldb::api::TableMeta& base_meta, const ::open
       aggr_col_idx_(-1),
       ts_col_idx_(-1),
       window_type_(window_tpye),
+      cond_(),
+      cond_col_idx_(-1),
+      cond_col_type_(DataType::kBool),
       window_size_(window_size),
       base_row_view_(base_table_schema_),
       aggr_row_view_(aggr_table_schema_),
@@ -90,6 +97,13 @@ Aggregator::Aggregator(const ::openmldb::api::TableMeta& base_meta, const ::open
     }
     auto dimension = dimensions_.Add();
     dimension->set_idx(0);
+    if (FLAGS_window_aggr_cache_max_rows > 0 && aggr_table_ &&
+        WindowAggrCache::IsSupported(aggr_type_, aggr_col_type_)) {
+        window_aggr_cache_ = std::make_shared<WindowAggrCache>(aggr_type_, aggr_col_type_,
+                                                               FLAGS_window_aggr_cache_max_rows,
+                                                               FLAGS_window_aggr_cache_max_keys);
+        aggr_table_->SetWindowAggrCache(window_aggr_cache_);
+    }
 }
 
 Aggregator::~Aggregator() {}
@@ -115,6 +129,13 @@ bool Aggregator::Update(const std::string& key, const std::string& row, const ui
             return false;
         }
     }
+    if (window_aggr_cache_ && !recover) {
+        AggrBuffer row_buffer;
+        row_buffer.data_type_ = aggr_col_type_;
+        if (UpdateMatchedAggrVal(base_row_view_, row_ptr, &row_buffer)) {
+            window_aggr_cache_->Add(key, cur_ts, row_buffer);
+        }
+    }
 
     AggrBufferLocked* aggr_buffer_lock;
     {
@@ -182,7 +203,7 @@ bool Aggregator::Update(const std::string& key, const std::string& row, const ui
         if (window_type_ == WindowType::kRowsNum) {
             aggr_buffer.ts_end_ = cur_ts;
         }
-        bool ok = UpdateAggrVal(base_row_view_, row_ptr, &aggr_buffer);
+        bool ok = UpdateMatchedAggrVal(base_row_view_, row_ptr, &aggr_buffer);
         if (!ok) {
             PDLOG(ERROR, "Update aggr value failed");
             return false;
@@ -365,7 +386,9 @@ bool Aggregator::FlushAggrBuffer(const std::string& key, const AggrBuffer& buffe
     row_builder_.SetString(row_ptr, row_size, 0, key.c_str(), key.size());
     row_builder_.SetTimestamp(row_ptr, 1, buffer.ts_begin_);
     row_builder_.SetTimestamp(row_ptr, 2, buffer.ts_end_);
-    if ((aggr_type_ == AggrType::kMax || aggr_type_ == AggrType::kMin) && buffer.AggrValEmpty()) {
+    if (((aggr_type_ == AggrType::kMax || aggr_type_ == AggrType::kMin) && buffer.AggrValEmpty()) ||
+        (aggr_val.empty() && (aggr_type_ == AggrType::kCate || aggr_type_ == AggrType::kDistinctCount ||
+                              aggr_type_ == AggrType::kTopNFrequency))) {
         row_builder_.SetNULL(row_ptr, row_size, 4);
     } else {
         row_builder_.SetString(row_ptr, row_size, 4, aggr_val.c_str(), aggr_val.size());
@@ -420,7 +443,7 @@ bool Aggregator::UpdateFlushedBuffer(const std::string& key, const int8_t* base_
         tmp_buffer.aggr_cnt_ = 1;
         tmp_buffer.binlog_offset_ = offset;
     }
-    bool ok = UpdateAggrVal(base_row_view_, base_row_ptr, &tmp_buffer);
+    bool ok = UpdateMatchedAggrVal(base_row_view_, base_row_ptr, &tmp_buffer);
     if (!ok) {
         PDLOG(ERROR, "UpdateAggrVal failed");
         return false;
@@ -433,6 +456,88 @@ bool Aggregator::UpdateFlushedBuffer(const std::string& key, const int8_t* base_
     return true;
 }
 
+bool Aggregator::SetCondition(const std::string& cond) {
+    auto condition = std::make_unique<::hybridse::base::PreAggrCondition>();
+    if (!condition->Parse(cond)) {
+        PDLOG(ERROR, "unsupported condition of aggregator: %s", cond.c_str());
+        return false;
+    }
+    for (int i = 0; i < base_table_schema_.size(); i++) {
+        if (base_table_schema_.Get(i).name() == condition->column()) {
+            cond_col_idx_ = i;
+            cond_col_type_ = base_table_schema_.Get(i).data_type();
+        }
+    }
+    if (cond_col_idx_ == -1) {
+        PDLOG(ERROR, "condition column %s not found in base table", condition->column().c_str());
+        return false;
+    }
+    cond_ = std::move(condition);
+    return true;
+}
+
+bool Aggregator::MatchCondition(const codec::RowView& row_view, const int8_t* row_ptr) {
+    if (!cond_) {
+        return true;
+    }
+    // the condition is not true if the value is null
+    if (row_view.IsNULL(row_ptr, cond_col_idx_)) {
+        return false;
+    }
+    switch (cond_col_type_) {
+        case DataType::kBool: {
+            bool val;
+            row_view.GetValue(row_ptr, cond_col_idx_, cond_col_type_, &val);
+            return cond_->Match(static_cast<int64_t>(val));
+        }
+        case DataType::kSmallInt: {
+            int16_t val;
+            row_view.GetValue(row_ptr, cond_col_idx_, cond_col_type_, &val);
+            return cond_->Match(static_cast<int64_t>(val));
+        }
+        case DataType::kDate:
+        case DataType::kInt: {
+            int32_t val;
+            row_view.GetValue(row_ptr, cond_col_idx_, cond_col_type_, &val);
+            return cond_->Match(static_cast<int64_t>(val));
+        }
+        case DataType::kTimestamp:
+        case DataType::kBigInt: {
+            int64_t val;
+            row_view.GetValue(row_ptr, cond_col_idx_, cond_col_type_, &val);
+            return cond_->Match(val);
+        }
+        case DataType::kFloat: {
+            float val;
+            row_view.GetValue(row_ptr, cond_col_idx_, cond_col_type_, &val);
+            return cond_->Match(static_cast<double>(val));
+        }
+        case DataType::kDouble: {
+            double val;
+            row_view.GetValue(row_ptr, cond_col_idx_, cond_col_type_, &val);
+            return cond_->Match(val);
+        }
+        case DataType::kString:
+        case DataType::kVarchar: {
+            char* ch = NULL;
+            uint32_t ch_length = 0;
+            row_view.GetValue(row_ptr, cond_col_idx_, &ch, &ch_length);
+            return cond_->Match(std::string(ch, ch_length));
+        }
+        default:
+            return false;
+    }
+}
+
+bool Aggregator::UpdateMatchedAggrVal(const codec::RowView& row_view, const int8_t* row_ptr,
+                                      AggrBuffer* aggr_buffer) {
+    // the unmatched row is still counted in aggr_cnt_ to locate the bucket, but not aggregated
+    if (!MatchCondition(row_view, row_ptr)) {
+        return true;
+    }
+    return UpdateAggrVal(row_view, row_ptr, aggr_buffer);
+}
+
 bool Aggregator::CheckBufferFilled(int64_t cur_ts, int64_t buffer_end, int32_t buffer_cnt) {
     if (window_type_ == WindowType::kRowsRange && cur_ts > buffer_end) {
         return true;
@@ -931,6 +1036,222 @@ bool AvgAggregator::DecodeAggrVal(const int8_t* row_ptr, AggrBuffer* buffer) {
     return true;
 }
 
+StateAggregator::StateAggregator(const ::openmldb::api::TableMeta& base_meta,
+                                 const ::openmldb::api::TableMeta& aggr_meta, std::shared_ptr<Table> aggr_table,
+                                 std::shared_ptr<LogReplicator> aggr_replicator, const uint32_t& index_pos,
+                                 const std::string& aggr_col, const AggrType& aggr_type, const std::string& ts_col,
+                                 WindowType window_tpye, uint32_t window_size)
+    : Aggregator(base_meta, aggr_meta, aggr_table, aggr_replicator, index_pos, aggr_col, aggr_type, ts_col, window_tpye,
+                 window_size) {}
+
+bool StateAggregator::GetKey(const codec::RowView& row_view, const int8_t* row_ptr, int col_idx, DataType col_type,
+                             std::string* key) {
+    if (col_idx < 0 || row_view.IsNULL(row_ptr, col_idx)) {
+        return false;
+    }
+    ::hybridse::base::PreAggrKeyType key_type = ::hybridse::base::PreAggrKeyType::kUnknown;
+    switch (col_type) {
+        case DataType::kBool:
+            key_type = ::hybridse::base::PreAggrKeyType::kBool;
+            break;
+        case DataType::kSmallInt:
+            key_type = ::hybridse::base::PreAggrKeyType::kInt16;
+            break;
+        case DataType::kDate:
+        case DataType::kInt:
+            key_type = ::hybridse::base::PreAggrKeyType::kInt32;
+            break;
+        case DataType::kTimestamp:
+        case DataType::kBigInt:
+            key_type = ::hybridse::base::PreAggrKeyType::kInt64;
+            break;
+        case DataType::kFloat:
+            key_type = ::hybridse::base::PreAggrKeyType::kFloat;
+            break;
+        case DataType::kDouble:
+            key_type = ::hybridse::base::PreAggrKeyType::kDouble;
+            break;
+        case DataType::kString:
+        case DataType::kVarchar:
+            key_type = ::hybridse::base::PreAggrKeyType::kString;
+            break;
+        default:
+            return false;
+    }
+    return ::hybridse::base::GetPreAggrKey(
+        key_type, [&](auto* val) { row_view.GetValue(row_ptr, col_idx, col_type, val); },
+        [&](std::string* str) {
+            char* ch = NULL;
+            uint32_t ch_length = 0;
+            row_view.GetValue(row_ptr, col_idx, &ch, &ch_length);
+            str->assign(ch, ch_length);
+        },
+        key);
+}
+
+::hybridse::base::PreAggrState* StateAggregator::MutableState(AggrBuffer* aggr_buffer) const {
+    if (!aggr_buffer->state_) {
+        aggr_buffer->state_.reset(NewState());
+    }
+    return aggr_buffer->state_.get();
+}
+
+bool StateAggregator::EncodeAggrVal(const AggrBuffer& buffer, std::string* aggr_val) {
+    aggr_val->clear();
+    if (buffer.state_) {
+        buffer.state_->Encode(aggr_val);
+    }
+    return true;
+}
+
+bool StateAggregator::DecodeAggrVal(const int8_t* row_ptr, AggrBuffer* buffer) {
+    char* aggr_val = NULL;
+    uint32_t ch_length = 0;
+    if (aggr_row_view_.GetValue(row_ptr, 4, &aggr_val, &ch_length) == 1) {
+        buffer->state_.reset();
+        return true;
+    }
+    buffer->state_.reset(NewState());
+    if (!buffer->state_->Decode(aggr_val, ch_length)) {
+        PDLOG(ERROR, "decode aggr state failed");
+        return false;
+    }
+    return true;
+}
+
+DistinctCountAggregator::DistinctCountAggregator(const ::openmldb::api::TableMeta& base_meta,
+                                                 const ::openmldb::api::TableMeta& aggr_meta,
+                                                 std::shared_ptr<Table> aggr_table,
+                                                 std::shared_ptr<LogReplicator> aggr_replicator,
+                                                 const uint32_t& index_pos, const std::string& aggr_col,
+                                                 const AggrType& aggr_type, const std::string& ts_col,
+                                                 WindowType window_tpye, uint32_t window_size)
+    : StateAggregator(base_meta, aggr_meta, aggr_table, aggr_replicator, index_pos, aggr_col, aggr_type, ts_col,
+                      window_tpye, window_size) {}
+
+::hybridse::base::PreAggrState* DistinctCountAggregator::NewState() const {
+    return new ::hybridse::base::HyperLogLog();
+}
+
+bool DistinctCountAggregator::UpdateAggrVal(const codec::RowView& row_view, const int8_t* row_ptr,
+                                            AggrBuffer* aggr_buffer) {
+    std::string key;
+    if (!GetKey(row_view, row_ptr, aggr_col_idx_, aggr_col_type_, &key)) {
+        return true;
+    }
+    static_cast<::hybridse::base::HyperLogLog*>(MutableState(aggr_buffer))->Add(key);
+    aggr_buffer->non_null_cnt++;
+    return true;
+}
+
+TopNFrequencyAggregator::TopNFrequencyAggregator(const ::openmldb::api::TableMeta& base_meta,
+                                                 const ::openmldb::api::TableMeta& aggr_meta,
+                                                 std::shared_ptr<Table> aggr_table,
+                                                 std::shared_ptr<LogReplicator> aggr_replicator,
+                                                 const uint32_t& index_pos, const std::string& aggr_col,
+                                                 const AggrType& aggr_type, const std::string& ts_col,
+                                                 WindowType window_tpye, uint32_t window_size, int64_t top_n)
+    : StateAggregator(base_meta, aggr_meta, aggr_table, aggr_replicator, index_pos, aggr_col, aggr_type, ts_col,
+                      window_tpye, window_size),
+      capacity_(::hybridse::base::TopNSketch::CapacityOf(top_n)) {}
+
+::hybridse::base::PreAggrState* TopNFrequencyAggregator::NewState() const {
+    return new ::hybridse::base::TopNSketch(capacity_);
+}
+
+bool TopNFrequencyAggregator::UpdateAggrVal(const codec::RowView& row_view, const int8_t* row_ptr,
+                                            AggrBuffer* aggr_buffer) {
+    std::string key;
+    if (!GetKey(row_view, row_ptr, aggr_col_idx_, aggr_col_type_, &key)) {
+        return true;
+    }
+    static_cast<::hybridse::base::TopNSketch*>(MutableState(aggr_buffer))->Add(key);
+    aggr_buffer->non_null_cnt++;
+    return true;
+}
+
+CateAggregator::CateAggregator(const ::openmldb::api::TableMeta& base_meta,
+                               const ::openmldb::api::TableMeta& aggr_meta, std::shared_ptr<Table> aggr_table,
+                               std::shared_ptr<LogReplicator> aggr_replicator, const uint32_t& index_pos,
+                               const std::string& aggr_col, const AggrType& aggr_type, const std::string& ts_col,
+                               WindowType window_tpye, uint32_t window_size, ::hybridse::base::PreAggrKind kind,
+                               const std::string& cate_col)
+    : StateAggregator(base_meta, aggr_meta, aggr_table, aggr_replicator, index_pos, aggr_col, aggr_type, ts_col,
+                      window_tpye, window_size),
+      kind_(kind),
+      cate_col_idx_(-1),
+      cate_col_type_(DataType::kString) {
+    for (int i = 0; i < base_meta.column_desc().size(); i++) {
+        if (base_meta.column_desc(i).name() == cate_col) {
+            cate_col_idx_ = i;
+            cate_col_type_ = base_meta.column_desc(i).data_type();
+        }
+    }
+    if (cate_col_idx_ == -1) {
+        PDLOG(ERROR, "cate col %s not found in base table", cate_col.c_str());
+    }
+}
+
+::hybridse::base::PreAggrState* CateAggregator::NewState() const {
+    bool is_float = aggr_col_type_ == DataType::kFloat || aggr_col_type_ == DataType::kDouble;
+    return new ::hybridse::base::CateAggrState(kind_, is_float);
+}
+
+bool CateAggregator::UpdateAggrVal(const codec::RowView& row_view, const int8_t* row_ptr, AggrBuffer* aggr_buffer) {
+    std::string key;
+    if (!GetKey(row_view, row_ptr, cate_col_idx_, cate_col_type_, &key)) {
+        return true;
+    }
+    if (aggr_col_idx_ < 0 || row_view.IsNULL(row_ptr, aggr_col_idx_)) {
+        return true;
+    }
+    auto state = static_cast<::hybridse::base::CateAggrState*>(MutableState(aggr_buffer));
+    switch (aggr_col_type_) {
+        case DataType::kSmallInt: {
+            int16_t val;
+            row_view.GetValue(row_ptr, aggr_col_idx_, aggr_col_type_, &val);
+            state->Update(key, static_cast<int64_t>(val));
+            break;
+        }
+        case DataType::kInt: {
+            int32_t val;
+            row_view.GetValue(row_ptr, aggr_col_idx_, aggr_col_type_, &val);
+            state->Update(key, static_cast<int64_t>(val));
+            break;
+        }
+        case DataType::kTimestamp:
+        case DataType::kBigInt: {
+            int64_t val;
+            row_view.GetValue(row_ptr, aggr_col_idx_, aggr_col_type_, &val);
+            state->Update(key, val);
+            break;
+        }
+        case DataType::kFloat: {
+            float val;
+            row_view.GetValue(row_ptr, aggr_col_idx_, aggr_col_type_, &val);
+            state->Update(key, static_cast<double>(val));
+            break;
+        }
+        case DataType::kDouble: {
+            double val;
+            row_view.GetValue(row_ptr, aggr_col_idx_, aggr_col_type_, &val);
+            state->Update(key, val);
+            break;
+        }
+        default: {
+            // only the count of the category is needed by count_cate
+            if (kind_ != ::hybridse::base::PreAggrKind::kCount) {
+                PDLOG(ERROR, "Unsupported data type");
+                return false;
+            }
+            state->Update(key, static_cast<int64_t>(0));
+            break;
+        }
+    }
+    aggr_buffer->non_null_cnt++;
+    return true;
+}
+
 std::shared_ptr<Aggregator> CreateAggregator(const ::openmldb::api::TableMeta& base_meta,
                                              const ::openmldb::api::TableMeta& aggr_meta,
                                              std::shared_ptr<Table> aggr_table,
@@ -976,26 +1297,54 @@ std::shared_ptr<Aggregator> CreateAggregator(const ::openmldb::api::TableMeta& b
         }
     }
 
-    if (aggr_type == "sum") {
-        return std::make_shared<SumAggregator>(base_meta, aggr_meta, aggr_table, aggr_replicator, index_pos, aggr_col,
-                                               AggrType::kSum, ts_col, window_type, window_size);
-    } else if (aggr_type == "min") {
-        return std::make_shared<MinAggregator>(base_meta, aggr_meta, aggr_table, aggr_replicator, index_pos, aggr_col,
-                                               AggrType::kMin, ts_col, window_type, window_size);
-    } else if (aggr_type == "max") {
-        return std::make_shared<MaxAggregator>(base_meta, aggr_meta, aggr_table, aggr_replicator, index_pos, aggr_col,
-                                               AggrType::kMax, ts_col, window_type, window_size);
-    } else if (aggr_type == "count") {
-        return std::make_shared<CountAggregator>(base_meta, aggr_meta, aggr_table, aggr_replicator, index_pos, aggr_col,
-                                                 AggrType::kCount, ts_col, window_type, window_size);
-    } else if (aggr_type == "avg") {
-        return std::make_shared<AvgAggregator>(base_meta, aggr_meta, aggr_table, aggr_replicator, index_pos, aggr_col,
-                                               AggrType::kAvg, ts_col, window_type, window_size);
+    ::hybridse::base::PreAggrFunc func;
+    std::vector<std::string> args;
+    if (!::hybridse::base::ParsePreAggrFunc(aggr_type, &func) ||
+        !::hybridse::base::SplitPreAggrArgs(aggr_col, func, &args)) {
+        PDLOG(ERROR, "Unsupported aggregate function %s(%s)", aggr_type.c_str(), aggr_col.c_str());
+        return std::shared_ptr<Aggregator>();
+    }
+    const std::string& value_col = args[0];
+    std::shared_ptr<Aggregator> aggregator;
+    if (func.kind == ::hybridse::base::PreAggrKind::kDistinctCount) {
+        aggregator = std::make_shared<DistinctCountAggregator>(base_meta, aggr_meta, aggr_table, aggr_replicator,
+                                                               index_pos, value_col, AggrType::kDistinctCount, ts_col,
+                                                               window_type, window_size);
+    } else if (func.kind == ::hybridse::base::PreAggrKind::kTopNFrequency) {
+        if (!::openmldb::base::IsNumber(args[1])) {
+            PDLOG(ERROR, "the top n of fz_topn_frequency is not a number: %s", args[1].c_str());
+            return std::shared_ptr<Aggregator>();
+        }
+        aggregator = std::make_shared<TopNFrequencyAggregator>(base_meta, aggr_meta, aggr_table, aggr_replicator,
+                                                               index_pos, value_col, AggrType::kTopNFrequency, ts_col,
+                                                               window_type, window_size, std::stoll(args[1]));
+    } else if (func.has_cate) {
+        aggregator = std::make_shared<CateAggregator>(base_meta, aggr_meta, aggr_table, aggr_replicator, index_pos,
+                                                      value_col, AggrType::kCate, ts_col, window_type, window_size,
+                                                      func.kind, args[func.CatePos()]);
+    } else if (func.kind == ::hybridse::base::PreAggrKind::kSum) {
+        aggregator = std::make_shared<SumAggregator>(base_meta, aggr_meta, aggr_table, aggr_replicator, index_pos,
+                                                     value_col, AggrType::kSum, ts_col, window_type, window_size);
+    } else if (func.kind == ::hybridse::base::PreAggrKind::kMin) {
+        aggregator = std::make_shared<MinAggregator>(base_meta, aggr_meta, aggr_table, aggr_replicator, index_pos,
+                                                     value_col, AggrType::kMin, ts_col, window_type, window_size);
+    } else if (func.kind == ::hybridse::base::PreAggrKind::kMax) {
+        aggregator = std::make_shared<MaxAggregator>(base_meta, aggr_meta, aggr_table, aggr_replicator, index_pos,
+                                                     value_col, AggrType::kMax, ts_col, window_type, window_size);
+    } else if (func.kind == ::hybridse::base::PreAggrKind::kCount) {
+        aggregator = std::make_shared<CountAggregator>(base_meta, aggr_meta, aggr_table, aggr_replicator, index_pos,
+                                                       value_col, AggrType::kCount, ts_col, window_type, window_size);
+    } else if (func.kind == ::hybridse::base::PreAggrKind::kAvg) {
+        aggregator = std::make_shared<AvgAggregator>(base_meta, aggr_meta, aggr_table, aggr_replicator, index_pos,
+                                                     value_col, AggrType::kAvg, ts_col, window_type, window_size);
     } else {
         PDLOG(ERROR, "Unsupported aggregate function type");
         return std::shared_ptr<Aggregator>();
     }
-    return std::shared_ptr<Aggregator>();
+    if (func.has_cond && !aggregator->SetCondition(args[func.CondPos()])) {
+        return std::shared_ptr<Aggregator>();
+    }
+    return aggregator;
 }
 
 }  // namespace storage
@@ -23,6 +23,7 @@
 #include <unordered_map>
 #include <vector>
 
+#include "base/fe_pre_aggr.h"
 #include "codec/codec.h"
 #include "proto/tablet.pb.h"
 #include "proto/type.pb.h"
@@ -37,12 +38,17 @@ using ::openmldb::log::LogParts;
 using ::openmldb::replica::LogReplicator;
 using ::openmldb::type::DataType;
 
+class WindowAggrCache;
+
 enum class AggrType {
     kSum = 1,
     kMin = 2,
     kMax = 3,
     kCount = 4,
     kAvg = 5,
+    kCate = 6,
+    kDistinctCount = 7,
+    kTopNFrequency = 8,
 };
 
 enum class WindowType {
@@ -75,6 +81,8 @@ class AggrBuffer {
     uint64_t binlog_offset_;
     int64_t non_null_cnt;
     DataType data_type_;
+    // the aggregate of StateAggregator
+    std::unique_ptr<::hybridse::base::PreAggrState> state_;
     AggrBuffer() : aggr_val_(), ts_begin_(-1), ts_end_(0), aggr_cnt_(0), binlog_offset_(0), non_null_cnt(0) {}
     AggrBuffer(const AggrBuffer& buffer) {
         memcpy(&aggr_val_, &buffer.aggr_val_, sizeof(aggr_val_));
@@ -90,6 +98,9 @@ class AggrBuffer {
                 memcpy(aggr_val_.vstring.data, buffer.aggr_val_.vstring.data, buffer.aggr_val_.vstring.len);
             }
         }
+        if (buffer.state_) {
+            state_.reset(buffer.state_->Clone());
+        }
     }
     AggrBuffer& operator=(const AggrBuffer& buffer) = delete;
     ~AggrBuffer() { clear(); }
@@ -105,6 +116,7 @@ class AggrBuffer {
         aggr_cnt_ = 0;
         binlog_offset_ = 0;
         non_null_cnt = 0;
+        state_.reset();
     }
     bool AggrValEmpty() const { return non_null_cnt == 0; }
 };
@@ -143,6 +155,12 @@ class Aggregator {
 
     bool GetAggrBuffer(const std::string& key, AggrBuffer** buffer);
 
+    // only the rows matching the condition of `*_where` are aggregated
+    bool SetCondition(const std::string& cond);
+
+    // NULL if the incremental window aggregate is disabled or not supported
+    std::shared_ptr<WindowAggrCache> GetWindowAggrCache() const { return window_aggr_cache_; }
+
  protected:
     codec::Schema base_table_schema_;
     codec::Schema aggr_table_schema_;
@@ -156,11 +174,14 @@ class Aggregator {
     std::shared_ptr<LogReplicator> aggr_replicator_;
     std::atomic<AggrStat> status_;
     Dimensions dimensions_;
+    std::shared_ptr<WindowAggrCache> window_aggr_cache_;
 
     bool GetAggrBufferFromRowView(const codec::RowView& row_view, const int8_t* row_ptr, AggrBuffer* buffer);
     bool FlushAggrBuffer(const std::string& key, const AggrBuffer& aggr_buffer);
     bool UpdateFlushedBuffer(const std::string& key, const int8_t* base_row_ptr, int64_t cur_ts, uint64_t offset);
     bool CheckBufferFilled(int64_t cur_ts, int64_t buffer_end, int32_t buffer_cnt);
+    bool MatchCondition(const codec::RowView& row_view, const int8_t* row_ptr);
+    bool UpdateMatchedAggrVal(const codec::RowView& row_view, const int8_t* row_ptr, AggrBuffer* aggr_buffer);
 
  private:
     virtual bool UpdateAggrVal(const codec::RowView& row_view, const int8_t* row_ptr, AggrBuffer* aggr_buffer) = 0;
@@ -176,6 +197,9 @@ class Aggregator {
     int aggr_col_idx_;
     int ts_col_idx_;
     WindowType window_type_;
+    std::unique_ptr<::hybridse::base::PreAggrCondition> cond_;
+    int cond_col_idx_;
+    DataType cond_col_type_;
 
     // for kRowsNum, window_size_ is the rows num in mini window
     // for kRowsRange, window size is the time interval in mini window
@@ -279,6 +303,86 @@ class AvgAggregator : public Aggregator {
     bool DecodeAggrVal(const int8_t* row_ptr, AggrBuffer* buffer) override;
 };
 
+// the aggregator of which the aggregate is a PreAggrState rather than a single value
+class StateAggregator : public Aggregator {
+ public:
+    StateAggregator(const ::openmldb::api::TableMeta& base_meta, const ::openmldb::api::TableMeta& aggr_meta,
+                    std::shared_ptr<Table> aggr_table, std::shared_ptr<LogReplicator> aggr_replicator,
+                    const uint32_t& index_pos, const std::string& aggr_col, const AggrType& aggr_type,
+                    const std::string& ts_col, WindowType window_tpye, uint32_t window_size);
+
+    ~StateAggregator() = default;
+
+ protected:
+    // get the key of the value of the column, return false if it is null
+    static bool GetKey(const codec::RowView& row_view, const int8_t* row_ptr, int col_idx, DataType col_type,
+                       std::string* key);
+
+    ::hybridse::base::PreAggrState* MutableState(AggrBuffer* aggr_buffer) const;
+
+ private:
+    virtual ::hybridse::base::PreAggrState* NewState() const = 0;
+
+    bool EncodeAggrVal(const AggrBuffer& buffer, std::string* aggr_val) override;
+
+    bool DecodeAggrVal(const int8_t* row_ptr, AggrBuffer* buffer) override;
+};
+
+// approximate distinct_count by HyperLogLog
+class DistinctCountAggregator : public StateAggregator {
+ public:
+    DistinctCountAggregator(const ::openmldb::api::TableMeta& base_meta, const ::openmldb::api::TableMeta& aggr_meta,
+                            std::shared_ptr<Table> aggr_table, std::shared_ptr<LogReplicator> aggr_replicator,
+                            const uint32_t& index_pos, const std::string& aggr_col, const AggrType& aggr_type,
+                            const std::string& ts_col, WindowType window_tpye, uint32_t window_size);
+
+    ~DistinctCountAggregator() = default;
+
+ private:
+    ::hybridse::base::PreAggrState* NewState() const override;
+
+    bool UpdateAggrVal(const codec::RowView& row_view, const int8_t* row_ptr, AggrBuffer* aggr_buffer) override;
+};
+
+// approximate fz_topn_frequency by the frequency summary of the most frequent keys
+class TopNFrequencyAggregator : public StateAggregator {
+ public:
+    TopNFrequencyAggregator(const ::openmldb::api::TableMeta& base_meta, const ::openmldb::api::TableMeta& aggr_meta,
+                            std::shared_ptr<Table> aggr_table, std::shared_ptr<LogReplicator> aggr_replicator,
+                            const uint32_t& index_pos, const std::string& aggr_col, const AggrType& aggr_type,
+                            const std::string& ts_col, WindowType window_tpye, uint32_t window_size, int64_t top_n);
+
+    ~TopNFrequencyAggregator() = default;
+
+ private:
+    ::hybridse::base::PreAggrState* NewState() const override;
+
+    bool UpdateAggrVal(const codec::RowView& row_view, const int8_t* row_ptr, AggrBuffer* aggr_buffer) override;
+
+    uint32_t capacity_;
+};
+
+// count/sum/avg/min/max of the values grouped by the category column
+class CateAggregator : public StateAggregator {
+ public:
+    CateAggregator(const ::openmldb::api::TableMeta& base_meta, const ::openmldb::api::TableMeta& aggr_meta,
+                   std::shared_ptr<Table> aggr_table, std::shared_ptr<LogReplicator> aggr_replicator,
+                   const uint32_t& index_pos, const std::string& aggr_col, const AggrType& aggr_type,
+                   const std::string& ts_col, WindowType window_tpye, uint32_t window_size,
+                   ::hybridse::base::PreAggrKind kind, const std::string& cate_col);
+
+    ~CateAggregator() = default;
+
+ private:
+    ::hybridse::base::PreAggrState* NewState() const override;
+
+    bool UpdateAggrVal(const codec::RowView& row_view, const int8_t* row_ptr, AggrBuffer* aggr_buffer) override;
+
+    ::hybridse::base::PreAggrKind kind_;
+    int cate_col_idx_;
+    DataType cate_col_type_;
+};
+
 std::shared_ptr<Aggregator> CreateAggregator(const ::openmldb::api::TableMeta& base_meta,
                                              const ::openmldb::api::TableMeta& aggr_meta,
                                              std::shared_ptr<Table> aggr_table,
@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include <functional>
 #include <map>
 #include <utility>
 #include "gtest/gtest.h"
@@ -717,6 +718,137 @@ TEST_F(AggregatorTest, OutOfOrder) {
     ::openmldb::base::RemoveDir(folder);
 }
 
+TEST_F(AggregatorTest, WhereAggregatorUpdate) {
+    std::shared_ptr<Aggregator> aggregator;
+    AggrBuffer* last_buffer;
+    std::shared_ptr<Table> aggr_table;
+    ASSERT_TRUE(GetUpdatedResult(counter, "col3,col3 > 50", "sum_where", "1s", aggregator, aggr_table, &last_buffer));
+    ASSERT_EQ(aggregator->GetAggrType(), AggrType::kSum);
+    ASSERT_EQ(aggr_table->GetRecordCnt(), 50);
+    auto it = aggr_table->NewTraverseIterator(0);
+    it->SeekToFirst();
+    for (int i = 50 - 1; i >= 0; --i) {
+        ASSERT_TRUE(it->Valid());
+        std::string origin_data = it->GetValue().ToString();
+        codec::RowView origin_row_view(aggr_table->GetTableMeta()->column_desc(),
+                                       reinterpret_cast<int8_t*>(const_cast<char*>(origin_data.c_str())),
+                                       origin_data.size());
+        int32_t origin_cnt = 0;
+        origin_row_view.GetInt32(3, &origin_cnt);
+        // the unmatched rows are counted in the bucket but not aggregated
+        ASSERT_EQ(origin_cnt, 2);
+        char* ch = NULL;
+        uint32_t ch_length = 0;
+        origin_row_view.GetString(4, &ch, &ch_length);
+        int64_t expect = i * 2 > 50 ? i * 4 + 1 : (i == 25 ? 51 : 0);
+        ASSERT_EQ(*reinterpret_cast<int64_t*>(ch), expect);
+        it->Next();
+    }
+    ASSERT_EQ(last_buffer->aggr_val_.vlong, 100);
+    counter += 2;
+    ASSERT_TRUE(
+        GetUpdatedResult(counter, "col3,col9 = hello", "count_where", "1s", aggregator, aggr_table, &last_buffer));
+    CheckCountAggrResult(aggr_table, DataType::kInt, 1);
+    ASSERT_EQ(last_buffer->non_null_cnt, 0);
+    counter += 2;
+
+    // the condition which can not be pre-aggregated
+    std::map<std::string, std::string> map;
+    std::string folder = "/tmp/" + GenRand() + "/";
+    ::openmldb::api::TableMeta base_table_meta;
+    base_table_meta.set_tid(counter++);
+    AddDefaultAggregatorBaseSchema(&base_table_meta);
+    ::openmldb::api::TableMeta aggr_table_meta;
+    aggr_table_meta.set_tid(counter++);
+    AddDefaultAggregatorSchema(&aggr_table_meta);
+    aggr_table = std::make_shared<MemTable>(aggr_table_meta);
+    aggr_table->Init();
+    std::shared_ptr<LogReplicator> replicator = std::make_shared<LogReplicator>(
+        aggr_table->GetId(), aggr_table->GetPid(), folder, map, ::openmldb::replica::kLeaderNode);
+    replicator->Init();
+    ASSERT_TRUE(CreateAggregator(base_table_meta, aggr_table_meta, aggr_table, replicator, 0, "col3,col3 + 1 > 5",
+                                 "sum_where", "ts_col", "1s") == nullptr);
+    ASSERT_TRUE(CreateAggregator(base_table_meta, aggr_table_meta, aggr_table, replicator, 0, "col3,col_x > 5",
+                                 "sum_where", "ts_col", "1s") == nullptr);
+    ASSERT_TRUE(CreateAggregator(base_table_meta, aggr_table_meta, aggr_table, replicator, 0, "col9",
+                                 "fz_topn_frequency", "ts_col", "1s") == nullptr);
+    ::openmldb::base::RemoveDir(folder);
+}
+
+template <typename T>
+void CheckStateAggrResult(std::shared_ptr<Table> aggr_table, T* state,
+                          const std::function<void(int, const T&)>& check) {
+    ASSERT_EQ(aggr_table->GetRecordCnt(), 50);
+    auto it = aggr_table->NewTraverseIterator(0);
+    it->SeekToFirst();
+    for (int i = 50 - 1; i >= 0; --i) {
+        ASSERT_TRUE(it->Valid());
+        std::string origin_data = it->GetValue().ToString();
+        codec::RowView origin_row_view(aggr_table->GetTableMeta()->column_desc(),
+                                       reinterpret_cast<int8_t*>(const_cast<char*>(origin_data.c_str())),
+                                       origin_data.size());
+        char* ch = NULL;
+        uint32_t ch_length = 0;
+        // the aggregate is null if no row is matched in the bucket
+        if (origin_row_view.GetString(4, &ch, &ch_length) == 1) {
+            state->Clear();
+        } else {
+            ASSERT_TRUE(state->Decode(ch, ch_length));
+        }
+        check(i, *state);
+        it->Next();
+    }
+}
+
+TEST_F(AggregatorTest, StateAggregatorUpdate) {
+    std::shared_ptr<Aggregator> aggregator;
+    AggrBuffer* last_buffer;
+    std::shared_ptr<Table> aggr_table;
+    ASSERT_TRUE(GetUpdatedResult(counter, "col3,col9", "count_cate", "1s", aggregator, aggr_table, &last_buffer));
+    ASSERT_EQ(aggregator->GetAggrType(), AggrType::kCate);
+    ::hybridse::base::CateAggrState count_cate(::hybridse::base::PreAggrKind::kCount, false);
+    CheckStateAggrResult<::hybridse::base::CateAggrState>(
+        aggr_table, &count_cate, [](int i, const ::hybridse::base::CateAggrState& state) {
+            ASSERT_EQ(state.values().size(), 2u);
+            ASSERT_EQ(state.values().at("abc").cnt, 1);
+            ASSERT_EQ(state.values().at("hello").cnt, 1);
+        });
+    ASSERT_EQ(last_buffer->non_null_cnt, 1);
+    counter += 2;
+
+    ASSERT_TRUE(GetUpdatedResult(counter, "col5,col3 >= 10,col9", "SUM_CATE_WHERE", "1s", aggregator, aggr_table,
+                                 &last_buffer));
+    ::hybridse::base::CateAggrState sum_cate(::hybridse::base::PreAggrKind::kSum, false);
+    CheckStateAggrResult<::hybridse::base::CateAggrState>(
+        aggr_table, &sum_cate, [](int i, const ::hybridse::base::CateAggrState& state) {
+            if (i < 5) {
+                ASSERT_TRUE(state.Empty());
+                return;
+            }
+            ASSERT_EQ(state.values().at("abc").lval, i * 2);
+            ASSERT_EQ(state.values().at("hello").lval, i * 2 + 1);
+        });
+    counter += 2;
+
+    ASSERT_TRUE(GetUpdatedResult(counter, "col9", "distinct_count", "1s", aggregator, aggr_table, &last_buffer));
+    ::hybridse::base::HyperLogLog hll;
+    CheckStateAggrResult<::hybridse::base::HyperLogLog>(
+        aggr_table, &hll, [](int i, const ::hybridse::base::HyperLogLog& state) { ASSERT_EQ(state.Estimate(), 2); });
+    counter += 2;
+
+    ASSERT_TRUE(
+        GetUpdatedResult(counter, "col9,2", "fz_topn_frequency", "1s", aggregator, aggr_table, &last_buffer));
+    ::hybridse::base::TopNSketch sketch(::hybridse::base::TopNSketch::CapacityOf(2));
+    CheckStateAggrResult<::hybridse::base::TopNSketch>(
+        aggr_table, &sketch, [](int i, const ::hybridse::base::TopNSketch& state) {
+            ASSERT_EQ(state.counts().size(), 2u);
+            ASSERT_EQ(state.counts().at("abc"), 1);
+            ASSERT_EQ(state.counts().at("hello"), 1);
+        });
+    ASSERT_EQ(last_buffer->non_null_cnt, 1);
+    counter += 2;
+}
+
 TEST_F(AggregatorTest, FlushAll) {
     std::shared_ptr<Aggregator> aggregator;
     AggrBuffer* last_buffer;
@@ -0,0 +1,146 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "storage/cold_tier.h"
+
+#include "base/file_util.h"
+#include "base/glog_wapper.h"
+
+namespace openmldb {
+namespace storage {
+
+ColdTier::ColdTier(uint32_t tid, uint32_t pid, const std::string& db_path)
+    : tid_(tid), pid_(pid), db_path_(db_path), db_(nullptr), cf_hs_(), write_opts_(), cmp_(), inner_cnt_(0), written_() {
+    // the rows can be rebuilt from snapshot and binlog
+    write_opts_.disableWAL = true;
+}
+
+ColdTier::~ColdTier() {
+    for (auto handle : cf_hs_) {
+        delete handle;
+    }
+    if (db_ != nullptr) {
+        db_->Close();
+        delete db_;
+        db_ = nullptr;
+    }
+    ::openmldb::base::RemoveDirRecursive(db_path_);
+}
+
+bool ColdTier::Init(const std::vector<std::shared_ptr<InnerIndexSt>>& inner_indexs) {
+    if (::openmldb::base::IsExists(db_path_) && !::openmldb::base::RemoveDirRecursive(db_path_)) {
+        PDLOG(WARNING, "fail to clear cold tier path %s. tid %u pid %u", db_path_.c_str(), tid_, pid_);
+        return false;
+    }
+    if (!::openmldb::base::MkdirRecur(db_path_)) {
+        PDLOG(WARNING, "fail to create cold tier path %s. tid %u pid %u", db_path_.c_str(), tid_, pid_);
+        return false;
+    }
+    std::vector<rocksdb::ColumnFamilyDescriptor> cf_ds;
+    cf_ds.push_back(
+        rocksdb::ColumnFamilyDescriptor(rocksdb::kDefaultColumnFamilyName, rocksdb::ColumnFamilyOptions()));
+    for (const auto& inner_index : inner_indexs) {
+        rocksdb::ColumnFamilyOptions cfo;
+        cfo.comparator = &cmp_;
+        cfo.prefix_extractor.reset(new KeyTsPrefixTransform());
+        const auto& indexs = inner_index->GetIndex();
+        if (indexs.front()->GetTTLType() == ::openmldb::storage::TTLType::kAbsoluteTime) {
+            cfo.compaction_filter_factory = std::make_shared<TTLFilterFactory>(inner_index);
+        }
+        cf_ds.push_back(rocksdb::ColumnFamilyDescriptor(std::to_string(inner_index->GetId()), cfo));
+    }
+    rocksdb::DBOptions options;
+    options.create_if_missing = true;
+    options.create_missing_column_families = true;
+    rocksdb::Status s = rocksdb::DB::Open(options, db_path_, cf_ds, &cf_hs_, &db_);
+    if (!s.ok()) {
+        PDLOG(WARNING, "open cold tier failed. tid %u pid %u error %s", tid_, pid_, s.ToString().c_str());
+        return false;
+    }
+    inner_cnt_ = inner_indexs.size();
+    written_.reset(new std::atomic<bool>[inner_cnt_]);
+    for (uint32_t i = 0; i < inner_cnt_; i++) {
+        written_[i].store(false, std::memory_order_relaxed);
+    }
+    PDLOG(INFO, "open cold tier with path %s. tid %u pid %u", db_path_.c_str(), tid_, pid_);
+    return true;
+}
+
+void ColdTier::Put(uint32_t inner_pos, const Slice& pk, uint64_t time, const Slice& row,
+                   rocksdb::WriteBatch* batch) {
+    std::string combine_key = CombineKeyTs(pk.ToString(), time);
+    batch->Put(cf_hs_[inner_pos + 1], rocksdb::Slice(combine_key), rocksdb::Slice(row.data(), row.size()));
+}
+
+bool ColdTier::Write(uint32_t inner_pos, rocksdb::WriteBatch* batch) {
+    if (inner_pos >= inner_cnt_) {
+        return false;
+    }
+    // readers check the flag before creating the iterator, so set it before the rows are visible
+    written_[inner_pos].store(true, std::memory_order_release);
+    rocksdb::Status s = db_->Write(write_opts_, batch);
+    if (!s.ok()) {
+        PDLOG(WARNING, "write cold tier failed. tid %u pid %u error %s", tid_, pid_, s.ToString().c_str());
+        return false;
+    }
+    return true;
+}
+
+bool ColdTier::Delete(uint32_t inner_pos, const std::string& pk) {
+    if (!HasData(inner_pos)) {
+        return true;
+    }
+    std::string combine_key1 = CombineKeyTs(pk, UINT64_MAX);
+    std::string combine_key2 = CombineKeyTs(pk, 0);
+    rocksdb::WriteBatch batch;
+    batch.DeleteRange(cf_hs_[inner_pos + 1], rocksdb::Slice(combine_key1), rocksdb::Slice(combine_key2));
+    rocksdb::Status s = db_->Write(write_opts_, &batch);
+    if (!s.ok()) {
+        PDLOG(WARNING, "delete cold tier failed. tid %u pid %u error %s", tid_, pid_, s.ToString().c_str());
+        return false;
+    }
+    return true;
+}
+
+bool ColdTier::HasKey(uint32_t inner_pos, const Slice& pk, uint64_t expire_time) {
+    std::unique_ptr<TableIterator> it(NewIterator(inner_pos, pk.ToString()));
+    it->SeekToFirst();
+    return it->Valid() && it->GetKey() >= expire_time;
+}
+
+TableIterator* ColdTier::NewIterator(uint32_t inner_pos, const std::string& pk) {
+    rocksdb::ReadOptions ro = rocksdb::ReadOptions();
+    const rocksdb::Snapshot* snapshot = db_->GetSnapshot();
+    ro.snapshot = snapshot;
+    ro.prefix_same_as_start = true;
+    ro.pin_data = true;
+    rocksdb::Iterator* it = db_->NewIterator(ro, cf_hs_[inner_pos + 1]);
+    return new DiskTableIterator(db_, it, snapshot, pk);
+}
+
+uint64_t ColdTier::GetRecordCnt() {
+    uint64_t total = 0;
+    for (size_t i = 1; i < cf_hs_.size(); i++) {
+        uint64_t cnt = 0;
+        if (db_->GetIntProperty(cf_hs_[i], "rocksdb.estimate-num-keys", &cnt)) {
+            total += cnt;
+        }
+    }
+    return total;
+}
+
+}  // namespace storage
+}  // namespace openmldb
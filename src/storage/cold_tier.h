@@ -0,0 +1,170 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_STORAGE_COLD_TIER_H_
+#define SRC_STORAGE_COLD_TIER_H_
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rocksdb/db.h"
+#include "rocksdb/write_batch.h"
+#include "storage/disk_table.h"
+#include "storage/iterator.h"
+#include "storage/schema.h"
+#include "storage/segment.h"
+
+namespace openmldb {
+namespace storage {
+
+// The cold tier of memory table keeps the rows moved out of memory in rocksdb. Each inner index has a
+// column family with the same key layout as DiskTable, and the expired rows are removed by compaction.
+// The rows can be rebuilt from snapshot and binlog, so the db is cleared when it's opened
+class ColdTier {
+ public:
+    ColdTier(uint32_t tid, uint32_t pid, const std::string& db_path);
+    ~ColdTier();
+    ColdTier(const ColdTier&) = delete;
+    ColdTier& operator=(const ColdTier&) = delete;
+
+    bool Init(const std::vector<std::shared_ptr<InnerIndexSt>>& inner_indexs);
+
+    void Put(uint32_t inner_pos, const Slice& pk, uint64_t time, const Slice& row, rocksdb::WriteBatch* batch);
+
+    bool Write(uint32_t inner_pos, rocksdb::WriteBatch* batch);
+
+    // delete all rows of pk
+    bool Delete(uint32_t inner_pos, const std::string& pk);
+
+    // whether any row of the inner index has been written, the index added after Init is never written
+    bool HasData(uint32_t inner_pos) const {
+        return inner_pos < inner_cnt_ && written_[inner_pos].load(std::memory_order_acquire);
+    }
+
+    // whether the pk has rows whose time is not less than expire_time
+    bool HasKey(uint32_t inner_pos, const Slice& pk, uint64_t expire_time);
+
+    // the rows of pk sorted by time desc
+    TableIterator* NewIterator(uint32_t inner_pos, const std::string& pk);
+
+    // the count of inner indexes opened in Init
+    uint32_t GetInnerCnt() const { return inner_cnt_; }
+
+    // the estimated count of rows
+    uint64_t GetRecordCnt();
+
+ private:
+    uint32_t tid_;
+    uint32_t pid_;
+    std::string db_path_;
+    rocksdb::DB* db_;
+    std::vector<rocksdb::ColumnFamilyHandle*> cf_hs_;
+    rocksdb::WriteOptions write_opts_;
+    KeyTSComparator cmp_;
+    uint32_t inner_cnt_;
+    std::unique_ptr<std::atomic<bool>[]> written_;
+};
+
+// write the rows spilled from the segments of one inner index into cold tier
+class ColdTierWriter : public SpillTarget {
+ public:
+    ColdTierWriter(ColdTier* cold_tier, uint32_t inner_pos, uint64_t expire_time)
+        : cold_tier_(cold_tier), inner_pos_(inner_pos), expire_time_(expire_time), batch_() {}
+    ~ColdTierWriter() override {}
+
+    void Put(const Slice& key, uint64_t time, const Slice& row) override {
+        cold_tier_->Put(inner_pos_, key, time, row, &batch_);
+    }
+
+    bool Commit() override {
+        if (batch_.Count() == 0) {
+            return true;
+        }
+        bool ok = cold_tier_->Write(inner_pos_, &batch_);
+        batch_.Clear();
+        return ok;
+    }
+
+    bool Contains(const Slice& key) override { return cold_tier_->HasKey(inner_pos_, key, expire_time_); }
+
+ private:
+    ColdTier* cold_tier_;
+    uint32_t inner_pos_;
+    uint64_t expire_time_;
+    rocksdb::WriteBatch batch_;
+};
+
+// Merge the rows in memory and cold tier of one pk by time desc. The cold row is skipped if there is a
+// row with the same time in memory, as it's moved from memory or overwritten in cold tier
+class TieredTableIterator : public TableIterator {
+ public:
+    TieredTableIterator(TableIterator* hot_it, TableIterator* cold_it)
+        : hot_it_(hot_it), cold_it_(cold_it), use_hot_(true) {}
+    ~TieredTableIterator() override {}
+
+    bool Valid() override { return hot_it_->Valid() || cold_it_->Valid(); }
+
+    void Next() override {
+        if (use_hot_) {
+            hot_it_->Next();
+        } else {
+            cold_it_->Next();
+        }
+        Pick();
+    }
+
+    openmldb::base::Slice GetValue() const override {
+        return use_hot_ ? hot_it_->GetValue() : cold_it_->GetValue();
+    }
+
+    uint64_t GetKey() const override { return use_hot_ ? hot_it_->GetKey() : cold_it_->GetKey(); }
+
+    void SeekToFirst() override {
+        hot_it_->SeekToFirst();
+        cold_it_->SeekToFirst();
+        Pick();
+    }
+
+    void Seek(uint64_t time) override {
+        hot_it_->Seek(time);
+        cold_it_->Seek(time);
+        Pick();
+    }
+
+ private:
+    void Pick() {
+        if (!hot_it_->Valid()) {
+            use_hot_ = false;
+            return;
+        }
+        while (cold_it_->Valid() && cold_it_->GetKey() == hot_it_->GetKey()) {
+            cold_it_->Next();
+        }
+        use_hot_ = !cold_it_->Valid() || hot_it_->GetKey() > cold_it_->GetKey();
+    }
+
+ private:
+    std::unique_ptr<TableIterator> hot_it_;
+    std::unique_ptr<TableIterator> cold_it_;
+    bool use_hot_;
+};
+
+}  // namespace storage
+}  // namespace openmldb
+
+#endif  // SRC_STORAGE_COLD_TIER_H_
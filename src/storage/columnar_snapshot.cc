@@ -0,0 +1,444 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "storage/columnar_snapshot.h"
+
+#include <errno.h>
+#include <snappy.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "base/glog_wapper.h"
+#include "gflags/gflags.h"
+#include "log/sequential_file.h"
+#include "storage/mem_table.h"
+
+DECLARE_uint32(snapshot_block_rows);
+
+namespace openmldb {
+namespace storage {
+
+const char COLUMNAR_SNAPSHOT_SUBFIX[] = ".csdb";
+// the version 2 keeps all fields of LogEntry and no ts of rows, the ts are extracted from rows when loading
+static const uint8_t COLUMNAR_BLOCK_VERSION = 2;
+
+bool IsColumnarSnapshot(const std::string& path) {
+    return path.find(COLUMNAR_SNAPSHOT_SUBFIX) != std::string::npos;
+}
+
+namespace {
+
+// the presence of the optional fields of LogEntry
+constexpr uint8_t kHasTime = 1;
+constexpr uint8_t kHasTerm = 2;
+constexpr uint8_t kHasPk = 4;
+constexpr uint8_t kHasMethodType = 8;
+
+template <typename T>
+void Append(std::string* output, T value) {
+    output->append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+bool Read(const ::openmldb::base::Slice& input, uint32_t* pos, T* value) {
+    if (*pos + sizeof(T) > input.size()) {
+        return false;
+    }
+    memcpy(value, input.data() + *pos, sizeof(T));
+    *pos += sizeof(T);
+    return true;
+}
+
+class RowSnapshotReader : public SnapshotReader {
+ public:
+    RowSnapshotReader(::openmldb::log::SequentialFile* seq_file, bool compressed)
+        : seq_file_(seq_file), reader_(seq_file, NULL, false, 0, compressed) {}
+    ~RowSnapshotReader() override { delete seq_file_; }
+
+    ::openmldb::log::Status ReadRecord(::openmldb::base::Slice* record, std::string* buffer) override {
+        return reader_.ReadRecord(record, buffer);
+    }
+
+ private:
+    ::openmldb::log::SequentialFile* seq_file_;
+    ::openmldb::log::Reader reader_;
+};
+
+}  // namespace
+
+SnapshotReader* NewSnapshotReader(const std::string& path) {
+    FILE* fd = fopen(path.c_str(), "rb");
+    if (fd == NULL) {
+        PDLOG(WARNING, "fail to open path %s for error %s", path.c_str(), strerror(errno));
+        return NULL;
+    }
+    ::openmldb::log::SequentialFile* seq_file = ::openmldb::log::NewMmapSeqFile(path, fd);
+    if (seq_file == NULL) {
+        seq_file = ::openmldb::log::NewSeqFile(path, fd);
+    }
+    if (IsColumnarSnapshot(path)) {
+        return new ColumnarSnapshotReader(seq_file);
+    }
+    bool compressed = path.find(::openmldb::log::ZLIB_COMPRESS_SUFFIX) != std::string::npos ||
+                      path.find(::openmldb::log::SNAPPY_COMPRESS_SUFFIX) != std::string::npos;
+    return new RowSnapshotReader(seq_file, compressed);
+}
+
+bool ColumnarBlock::Encode(const std::vector<::openmldb::api::LogEntry>& entries, MemTable* table,
+                           std::string* output) {
+    uint32_t row_cnt = entries.size();
+    std::vector<uint32_t> order(row_cnt);
+    for (uint32_t i = 0; i < row_cnt; i++) {
+        order[i] = i;
+    }
+    auto first_key = [&entries](uint32_t i) -> std::pair<uint32_t, const std::string*> {
+        const auto& entry = entries[i];
+        if (entry.dimensions_size() > 0) {
+            return {entry.dimensions(0).idx(), &entry.dimensions(0).key()};
+        }
+        return {0, &entry.pk()};
+    };
+    std::sort(order.begin(), order.end(), [&entries, &first_key](uint32_t a, uint32_t b) {
+        auto ka = first_key(a);
+        auto kb = first_key(b);
+        if (ka.first != kb.first) {
+            return ka.first < kb.first;
+        }
+        int cmp = ka.second->compare(*kb.second);
+        if (cmp != 0) {
+            return cmp < 0;
+        }
+        return entries[a].ts() > entries[b].ts();
+    });
+    // the min/max ts of each ts column, only the columns extracted from all rows are kept
+    std::map<int32_t, std::pair<uint64_t, uint64_t>> ts_ranges;
+    std::map<int32_t, uint32_t> ts_row_cnt;
+    std::map<int32_t, uint64_t> ts_map;
+    for (uint32_t i = 0; table != NULL && i < row_cnt; i++) {
+        ts_map.clear();
+        if (!table->GetTsMap(entries[i].ts(), entries[i].value(), &ts_map)) {
+            ts_ranges.clear();
+            break;
+        }
+        for (const auto& kv : ts_map) {
+            auto iter = ts_ranges.emplace(kv.first, std::make_pair(kv.second, kv.second)).first;
+            iter->second.first = std::min(iter->second.first, kv.second);
+            iter->second.second = std::max(iter->second.second, kv.second);
+            ts_row_cnt[kv.first]++;
+        }
+    }
+    for (const auto& kv : ts_row_cnt) {
+        if (kv.second != row_cnt) {
+            ts_ranges.erase(kv.first);
+        }
+    }
+    std::string body;
+    for (auto i : order) {
+        Append<uint64_t>(&body, entries[i].log_index());
+    }
+    for (auto i : order) {
+        Append<uint64_t>(&body, entries[i].ts());
+    }
+    for (auto i : order) {
+        Append<uint64_t>(&body, entries[i].term());
+    }
+    for (auto i : order) {
+        Append<uint32_t>(&body, entries[i].method_type());
+    }
+    for (auto i : order) {
+        const auto& entry = entries[i];
+        uint8_t flags = (entry.has_ts() ? kHasTime : 0) | (entry.has_term() ? kHasTerm : 0) |
+                        (entry.has_pk() ? kHasPk : 0) | (entry.has_method_type() ? kHasMethodType : 0);
+        Append<uint8_t>(&body, flags);
+    }
+    for (auto i : order) {
+        Append<uint32_t>(&body, entries[i].dimensions_size());
+    }
+    for (auto i : order) {
+        Append<uint32_t>(&body, entries[i].ts_dimensions_size());
+    }
+    for (auto i : order) {
+        for (const auto& dim : entries[i].dimensions()) {
+            Append<uint32_t>(&body, dim.idx());
+        }
+    }
+    for (auto i : order) {
+        for (const auto& ts_dim : entries[i].ts_dimensions()) {
+            Append<uint32_t>(&body, ts_dim.idx());
+        }
+    }
+    for (auto i : order) {
+        for (const auto& ts_dim : entries[i].ts_dimensions()) {
+            Append<uint64_t>(&body, ts_dim.ts());
+        }
+    }
+    for (auto i : order) {
+        Append<uint32_t>(&body, entries[i].pk().size());
+    }
+    for (auto i : order) {
+        for (const auto& dim : entries[i].dimensions()) {
+            Append<uint32_t>(&body, dim.key().size());
+        }
+    }
+    for (auto i : order) {
+        Append<uint32_t>(&body, entries[i].value().size());
+    }
+    for (auto i : order) {
+        body.append(entries[i].pk());
+    }
+    for (auto i : order) {
+        for (const auto& dim : entries[i].dimensions()) {
+            body.append(dim.key());
+        }
+    }
+    for (auto i : order) {
+        body.append(entries[i].value());
+    }
+    if (body.size() > UINT32_MAX) {
+        PDLOG(WARNING, "columnar block is too large, size %lu", body.size());
+        return false;
+    }
+    output->clear();
+    Append<uint8_t>(output, COLUMNAR_BLOCK_VERSION);
+    Append<uint32_t>(output, row_cnt);
+    Append<uint8_t>(output, ts_ranges.size());
+    for (const auto& kv : ts_ranges) {
+        Append<uint32_t>(output, kv.first);
+        Append<uint64_t>(output, kv.second.first);
+        Append<uint64_t>(output, kv.second.second);
+    }
+    Append<uint32_t>(output, body.size());
+    std::string compressed;
+    snappy::Compress(body.data(), body.size(), &compressed);
+    output->append(compressed);
+    return true;
+}
+
+bool ColumnarBlock::Decode(const ::openmldb::base::Slice& input) {
+    row_cnt_ = 0;
+    ts_cols_.clear();
+    ts_ranges_.clear();
+    uint32_t pos = 0;
+    uint8_t version = 0;
+    uint32_t row_cnt = 0;
+    uint8_t ts_col_cnt = 0;
+    if (!Read(input, &pos, &version) || version != COLUMNAR_BLOCK_VERSION || !Read(input, &pos, &row_cnt) ||
+        !Read(input, &pos, &ts_col_cnt)) {
+        PDLOG(WARNING, "invalid columnar block header");
+        return false;
+    }
+    for (uint8_t i = 0; i < ts_col_cnt; i++) {
+        uint32_t col = 0;
+        uint64_t min_ts = 0;
+        uint64_t max_ts = 0;
+        if (!Read(input, &pos, &col) || !Read(input, &pos, &min_ts) || !Read(input, &pos, &max_ts)) {
+            PDLOG(WARNING, "invalid columnar block header");
+            return false;
+        }
+        ts_cols_.push_back(col);
+        ts_ranges_.emplace_back(min_ts, max_ts);
+    }
+    uint32_t body_size = 0;
+    size_t uncompressed_size = 0;
+    if (!Read(input, &pos, &body_size) ||
+        !snappy::GetUncompressedLength(input.data() + pos, input.size() - pos, &uncompressed_size) ||
+        uncompressed_size != body_size || !snappy::Uncompress(input.data() + pos, input.size() - pos, &body_)) {
+        PDLOG(WARNING, "fail to uncompress columnar block");
+        return false;
+    }
+    // all positions are computed in 64 bits and checked against the body size before any column is read,
+    // so a corrupt block never reads out of the body
+    uint64_t cur = 0;
+    auto next_column = [&cur, body_size](uint64_t cnt, uint64_t width, uint32_t* column_pos) {
+        *column_pos = cur;
+        cur += cnt * width;
+        return cur <= body_size;
+    };
+    uint32_t dim_cnt_pos = 0;
+    uint32_t ts_dim_cnt_pos = 0;
+    if (!next_column(row_cnt, 8, &log_index_pos_) || !next_column(row_cnt, 8, &time_pos_) ||
+        !next_column(row_cnt, 8, &term_pos_) || !next_column(row_cnt, 4, &method_type_pos_) ||
+        !next_column(row_cnt, 1, &flags_pos_) || !next_column(row_cnt, 4, &dim_cnt_pos) ||
+        !next_column(row_cnt, 4, &ts_dim_cnt_pos)) {
+        PDLOG(WARNING, "invalid columnar block body");
+        return false;
+    }
+    // the counts are read from the checked columns, the sums are bounded by the body size
+    auto read_offsets = [&](uint32_t len_pos, uint32_t cnt, uint64_t start, std::vector<uint32_t>* offsets) {
+        offsets->assign(1, start);
+        uint64_t end = start;
+        for (uint32_t i = 0; i < cnt; i++) {
+            end += ReadU32(len_pos, i);
+            if (end > body_size) {
+                return false;
+            }
+            offsets->push_back(end);
+        }
+        return true;
+    };
+    if (!read_offsets(dim_cnt_pos, row_cnt, 0, &dim_offsets_) ||
+        !read_offsets(ts_dim_cnt_pos, row_cnt, 0, &ts_dim_offsets_)) {
+        PDLOG(WARNING, "invalid columnar block body");
+        return false;
+    }
+    uint64_t total_dims = dim_offsets_.back();
+    uint64_t total_ts_dims = ts_dim_offsets_.back();
+    uint32_t pk_len_pos = 0;
+    uint32_t key_len_pos = 0;
+    uint32_t value_len_pos = 0;
+    if (!next_column(total_dims, 4, &dim_idx_pos_) || !next_column(total_ts_dims, 4, &ts_dim_idx_pos_) ||
+        !next_column(total_ts_dims, 8, &ts_dim_ts_pos_) || !next_column(row_cnt, 4, &pk_len_pos) ||
+        !next_column(total_dims, 4, &key_len_pos) || !next_column(row_cnt, 4, &value_len_pos)) {
+        PDLOG(WARNING, "invalid columnar block body");
+        return false;
+    }
+    if (!read_offsets(pk_len_pos, row_cnt, cur, &pk_offsets_) ||
+        !read_offsets(key_len_pos, total_dims, pk_offsets_.back(), &key_offsets_) ||
+        !read_offsets(value_len_pos, row_cnt, key_offsets_.back(), &value_offsets_) ||
+        value_offsets_.back() != body_size) {
+        PDLOG(WARNING, "invalid columnar block body");
+        return false;
+    }
+    row_cnt_ = row_cnt;
+    return true;
+}
+
+bool ColumnarBlock::GetTsRange(uint32_t ts_col, uint64_t* min_ts, uint64_t* max_ts) const {
+    for (uint32_t i = 0; i < ts_cols_.size(); i++) {
+        if (ts_cols_[i] == ts_col) {
+            *min_ts = ts_ranges_[i].first;
+            *max_ts = ts_ranges_[i].second;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ColumnarBlock::ToLogEntry(uint32_t row, ::openmldb::api::LogEntry* entry) const {
+    entry->Clear();
+    uint8_t flags = static_cast<uint8_t>(body_[flags_pos_ + row]);
+    entry->set_log_index(GetLogIndex(row));
+    if (flags & kHasTime) {
+        entry->set_ts(GetTime(row));
+    }
+    if (flags & kHasTerm) {
+        entry->set_term(ReadU64(term_pos_, row));
+    }
+    if (flags & kHasPk) {
+        entry->set_pk(body_.data() + pk_offsets_[row], pk_offsets_[row + 1] - pk_offsets_[row]);
+    }
+    if (flags & kHasMethodType) {
+        entry->set_method_type(static_cast<::openmldb::api::MethodType>(ReadU32(method_type_pos_, row)));
+    }
+    auto value = GetValue(row);
+    entry->set_value(value.data(), value.size());
+    for (uint32_t i = dim_offsets_[row]; i < dim_offsets_[row + 1]; i++) {
+        auto dim = entry->add_dimensions();
+        dim->set_idx(ReadU32(dim_idx_pos_, i));
+        dim->set_key(body_.data() + key_offsets_[i], key_offsets_[i + 1] - key_offsets_[i]);
+    }
+    for (uint32_t i = ts_dim_offsets_[row]; i < ts_dim_offsets_[row + 1]; i++) {
+        auto ts_dim = entry->add_ts_dimensions();
+        ts_dim->set_idx(ReadU32(ts_dim_idx_pos_, i));
+        ts_dim->set_ts(ReadU64(ts_dim_ts_pos_, i));
+    }
+}
+
+uint64_t ColumnarBlock::ReadU64(uint32_t pos, uint32_t row) const {
+    uint64_t value = 0;
+    memcpy(&value, body_.data() + pos + static_cast<uint64_t>(row) * 8, sizeof(uint64_t));
+    return value;
+}
+
+uint32_t ColumnarBlock::ReadU32(uint32_t pos, uint32_t idx) const {
+    uint32_t value = 0;
+    memcpy(&value, body_.data() + pos + static_cast<uint64_t>(idx) * 4, sizeof(uint32_t));
+    return value;
+}
+
+ColumnarSnapshotWriter::ColumnarSnapshotWriter(::openmldb::log::WriteHandle* wh, MemTable* table)
+    : wh_(wh), table_(table), entries_(), buffer_() {
+    entries_.reserve(FLAGS_snapshot_block_rows);
+}
+
+::openmldb::log::Status ColumnarSnapshotWriter::Write(const ::openmldb::base::Slice& record) {
+    entries_.emplace_back();
+    if (!entries_.back().ParseFromArray(record.data(), record.size())) {
+        entries_.pop_back();
+        return ::openmldb::log::Status::InvalidRecord("fail to parse LogEntry");
+    }
+    if (entries_.size() >= FLAGS_snapshot_block_rows) {
+        return Flush();
+    }
+    return ::openmldb::log::Status::OK();
+}
+
+::openmldb::log::Status ColumnarSnapshotWriter::EndLog() {
+    ::openmldb::log::Status status = Flush();
+    if (!status.ok()) {
+        return status;
+    }
+    return wh_->EndLog();
+}
+
+::openmldb::log::Status ColumnarSnapshotWriter::Flush() {
+    if (entries_.empty()) {
+        return ::openmldb::log::Status::OK();
+    }
+    bool ok = ColumnarBlock::Encode(entries_, table_, &buffer_);
+    entries_.clear();
+    if (!ok) {
+        return ::openmldb::log::Status::InvalidArgument("fail to encode columnar block");
+    }
+    return wh_->Write(::openmldb::base::Slice(buffer_));
+}
+
+ColumnarSnapshotReader::ColumnarSnapshotReader(::openmldb::log::SequentialFile* seq_file)
+    : seq_file_(seq_file), reader_(seq_file, NULL, false, 0, false), block_(), row_(0), entry_() {}
+
+ColumnarSnapshotReader::~ColumnarSnapshotReader() { delete seq_file_; }
+
+::openmldb::log::Status ColumnarSnapshotReader::ReadBlock(std::string* block) {
+    ::openmldb::base::Slice record;
+    ::openmldb::log::Status status = reader_.ReadRecord(&record, block);
+    if (status.ok() && record.data() != block->data()) {
+        block->assign(record.data(), record.size());
+    }
+    return status;
+}
+
+::openmldb::log::Status ColumnarSnapshotReader::ReadRecord(::openmldb::base::Slice* record, std::string* buffer) {
+    while (row_ >= block_.GetRowCnt()) {
+        std::string raw;
+        ::openmldb::log::Status status = ReadBlock(&raw);
+        if (!status.ok()) {
+            return status;
+        }
+        row_ = 0;
+        if (!block_.Decode(::openmldb::base::Slice(raw))) {
+            return ::openmldb::log::Status::Corruption("invalid columnar block");
+        }
+    }
+    block_.ToLogEntry(row_++, &entry_);
+    buffer->clear();
+    entry_.SerializeToString(buffer);
+    *record = ::openmldb::base::Slice(*buffer);
+    return ::openmldb::log::Status::OK();
+}
+
+}  // namespace storage
+}  // namespace openmldb
@@ -0,0 +1,169 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_STORAGE_COLUMNAR_SNAPSHOT_H_
+#define SRC_STORAGE_COLUMNAR_SNAPSHOT_H_
+
+#include <stdint.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/slice.h"
+#include "log/log_reader.h"
+#include "log/log_writer.h"
+#include "log/status.h"
+#include "proto/tablet.pb.h"
+
+namespace openmldb {
+namespace storage {
+
+class MemTable;
+
+// the suffix of columnar snapshot, the blocks are compressed by itself
+extern const char COLUMNAR_SNAPSHOT_SUBFIX[];
+
+bool IsColumnarSnapshot(const std::string& path);
+
+// Read the records of snapshot as serialized LogEntry whatever the format is
+class SnapshotReader {
+ public:
+    virtual ~SnapshotReader() {}
+    virtual ::openmldb::log::Status ReadRecord(::openmldb::base::Slice* record, std::string* buffer) = 0;
+};
+
+// return NULL if the file fails to be opened
+SnapshotReader* NewSnapshotReader(const std::string& path);
+
+// Write the serialized LogEntry into snapshot
+class SnapshotWriter {
+ public:
+    virtual ~SnapshotWriter() {}
+    virtual ::openmldb::log::Status Write(const ::openmldb::base::Slice& record) = 0;
+    virtual ::openmldb::log::Status EndLog() = 0;
+};
+
+class RowSnapshotWriter : public SnapshotWriter {
+ public:
+    explicit RowSnapshotWriter(::openmldb::log::WriteHandle* wh) : wh_(wh) {}
+    ::openmldb::log::Status Write(const ::openmldb::base::Slice& record) override { return wh_->Write(record); }
+    ::openmldb::log::Status EndLog() override { return wh_->EndLog(); }
+
+ private:
+    ::openmldb::log::WriteHandle* wh_;
+};
+
+// A block of columnar snapshot holds up to snapshot_block_rows rows sorted by the
+// first dimension and time desc, so the rows of a key are stored together. The
+// header keeps the row count and the min/max ts of each ts column, the columns
+// follow it and are compressed by snappy:
+//   log_index, time, term, method_type, field flags, dimension count, ts dimension count,
+//   dimension idx, ts dimension idx, ts dimension ts, pk length, dimension key length,
+//   value length, pks, dimension keys, values
+// The ts of rows are not stored, they are extracted from the values when the rows are put.
+class ColumnarBlock {
+ public:
+    ColumnarBlock() = default;
+    ColumnarBlock(const ColumnarBlock&) = delete;
+    ColumnarBlock& operator=(const ColumnarBlock&) = delete;
+
+    // the ts ranges in header are extracted by table, the block has no ts column if table is NULL
+    static bool Encode(const std::vector<::openmldb::api::LogEntry>& entries, MemTable* table, std::string* output);
+
+    bool Decode(const ::openmldb::base::Slice& input);
+
+    uint32_t GetRowCnt() const { return row_cnt_; }
+    const std::vector<uint32_t>& GetTsColumns() const { return ts_cols_; }
+
+    // return false if the ts column does not exist
+    bool GetTsRange(uint32_t ts_col, uint64_t* min_ts, uint64_t* max_ts) const;
+
+    uint64_t GetLogIndex(uint32_t row) const { return ReadU64(log_index_pos_, row); }
+    uint64_t GetTime(uint32_t row) const { return ReadU64(time_pos_, row); }
+    ::openmldb::base::Slice GetValue(uint32_t row) const {
+        return ::openmldb::base::Slice(body_.data() + value_offsets_[row], value_offsets_[row + 1] -
+                                                                               value_offsets_[row]);
+    }
+    void ToLogEntry(uint32_t row, ::openmldb::api::LogEntry* entry) const;
+
+ private:
+    uint64_t ReadU64(uint32_t pos, uint32_t row) const;
+    uint32_t ReadU32(uint32_t pos, uint32_t idx) const;
+
+ private:
+    uint32_t row_cnt_ = 0;
+    std::vector<uint32_t> ts_cols_;
+    std::vector<std::pair<uint64_t, uint64_t>> ts_ranges_;
+    std::string body_;
+    uint32_t log_index_pos_ = 0;
+    uint32_t time_pos_ = 0;
+    uint32_t term_pos_ = 0;
+    uint32_t method_type_pos_ = 0;
+    uint32_t flags_pos_ = 0;
+    uint32_t dim_idx_pos_ = 0;
+    uint32_t ts_dim_idx_pos_ = 0;
+    uint32_t ts_dim_ts_pos_ = 0;
+    // the index of the first dimension of each row, the size is row count + 1
+    std::vector<uint32_t> dim_offsets_;
+    std::vector<uint32_t> ts_dim_offsets_;
+    // the offsets in body_, the size is count + 1
+    std::vector<uint32_t> pk_offsets_;
+    std::vector<uint32_t> key_offsets_;
+    std::vector<uint32_t> value_offsets_;
+};
+
+// Buffer the records and write a block once snapshot_block_rows rows are buffered
+class ColumnarSnapshotWriter : public SnapshotWriter {
+ public:
+    ColumnarSnapshotWriter(::openmldb::log::WriteHandle* wh, MemTable* table);
+    ::openmldb::log::Status Write(const ::openmldb::base::Slice& record) override;
+    ::openmldb::log::Status EndLog() override;
+
+ private:
+    ::openmldb::log::Status Flush();
+
+ private:
+    ::openmldb::log::WriteHandle* wh_;
+    MemTable* table_;
+    std::vector<::openmldb::api::LogEntry> entries_;
+    std::string buffer_;
+};
+
+class ColumnarSnapshotReader : public SnapshotReader {
+ public:
+    explicit ColumnarSnapshotReader(::openmldb::log::SequentialFile* seq_file);
+    ~ColumnarSnapshotReader() override;
+
+    // read the raw block which can be decoded by ColumnarBlock
+    ::openmldb::log::Status ReadBlock(std::string* block);
+
+    ::openmldb::log::Status ReadRecord(::openmldb::base::Slice* record, std::string* buffer) override;
+
+ private:
+    ::openmldb::log::SequentialFile* seq_file_;
+    ::openmldb::log::Reader reader_;
+    ColumnarBlock block_;
+    uint32_t row_;
+    ::openmldb::api::LogEntry entry_;
+};
+
+}  // namespace storage
+}  // namespace openmldb
+
+#endif  // SRC_STORAGE_COLUMNAR_SNAPSHOT_H_
@@ -0,0 +1,195 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "storage/disk_row_cache.h"
+
+#include <algorithm>
+
+#include "base/hash.h"
+
+namespace openmldb {
+namespace storage {
+
+// the memory used by an entry besides the rows
+static const uint64_t ENTRY_OVERHEAD = 128;
+
+DiskRowCache::DiskRowCache(uint64_t capacity, uint32_t max_rows, uint32_t shard_cnt)
+    : shard_capacity_(capacity / std::max(shard_cnt, 1u)), max_rows_(max_rows), shards_() {
+    for (uint32_t i = 0; i < std::max(shard_cnt, 1u); i++) {
+        shards_.emplace_back(new Shard());
+    }
+}
+
+std::string DiskRowCache::GetCacheKey(uint64_t table_id, uint32_t idx, const std::string& pk) {
+    std::string cache_key;
+    cache_key.reserve(sizeof(table_id) + sizeof(idx) + pk.size());
+    cache_key.append(reinterpret_cast<const char*>(&table_id), sizeof(table_id));
+    cache_key.append(reinterpret_cast<const char*>(&idx), sizeof(idx));
+    cache_key.append(pk);
+    return cache_key;
+}
+
+DiskRowCache::Shard& DiskRowCache::GetShard(const std::string& cache_key) {
+    return *shards_[::openmldb::base::hash64(cache_key) % shards_.size()];
+}
+
+void DiskRowCache::Remove(Shard* shard, std::unordered_map<std::string, Entry>::iterator iter) {
+    shard->byte_size -= iter->second.charge;
+    shard->lru.erase(iter->second.lru_iter);
+    shard->entries.erase(iter);
+}
+
+std::shared_ptr<const CachedRows> DiskRowCache::Get(uint64_t table_id, uint32_t idx, const std::string& pk) {
+    std::string cache_key = GetCacheKey(table_id, idx, pk);
+    Shard& shard = GetShard(cache_key);
+    std::lock_guard<std::mutex> lock(shard.mu);
+    auto iter = shard.entries.find(cache_key);
+    if (iter == shard.entries.end()) {
+        return std::shared_ptr<const CachedRows>();
+    }
+    shard.lru.splice(shard.lru.begin(), shard.lru, iter->second.lru_iter);
+    return iter->second.rows;
+}
+
+uint64_t DiskRowCache::BeginFill(uint64_t table_id, uint32_t idx, const std::string& pk) {
+    std::string cache_key = GetCacheKey(table_id, idx, pk);
+    Shard& shard = GetShard(cache_key);
+    std::lock_guard<std::mutex> lock(shard.mu);
+    Fill& fill = shard.fills[cache_key];
+    fill.ref_cnt++;
+    return fill.version;
+}
+
+uint64_t DiskRowCache::ReleaseFill(Shard* shard, const std::string& cache_key) {
+    auto iter = shard->fills.find(cache_key);
+    if (iter == shard->fills.end()) {
+        return UINT64_MAX;
+    }
+    uint64_t version = iter->second.version;
+    if (--iter->second.ref_cnt == 0) {
+        shard->fills.erase(iter);
+    }
+    return version;
+}
+
+bool DiskRowCache::Insert(uint64_t table_id, uint32_t idx, const std::string& pk, uint64_t version,
+                          const std::shared_ptr<const CachedRows>& rows) {
+    std::string cache_key = GetCacheKey(table_id, idx, pk);
+    uint64_t charge = rows->byte_size + cache_key.size() + ENTRY_OVERHEAD;
+    Shard& shard = GetShard(cache_key);
+    std::lock_guard<std::mutex> lock(shard.mu);
+    if (ReleaseFill(&shard, cache_key) != version || charge > shard_capacity_) {
+        return false;
+    }
+    auto iter = shard.entries.find(cache_key);
+    if (iter != shard.entries.end()) {
+        Remove(&shard, iter);
+    }
+    while (!shard.lru.empty() && shard.byte_size + charge > shard_capacity_) {
+        Remove(&shard, shard.entries.find(shard.lru.back()));
+    }
+    shard.lru.push_front(cache_key);
+    shard.entries.emplace(cache_key, Entry{rows, charge, shard.lru.begin()});
+    shard.byte_size += charge;
+    return true;
+}
+
+void DiskRowCache::EndFill(uint64_t table_id, uint32_t idx, const std::string& pk) {
+    std::string cache_key = GetCacheKey(table_id, idx, pk);
+    Shard& shard = GetShard(cache_key);
+    std::lock_guard<std::mutex> lock(shard.mu);
+    ReleaseFill(&shard, cache_key);
+}
+
+void DiskRowCache::Invalidate(uint64_t table_id, uint32_t idx, const std::string& pk) {
+    std::string cache_key = GetCacheKey(table_id, idx, pk);
+    Shard& shard = GetShard(cache_key);
+    std::lock_guard<std::mutex> lock(shard.mu);
+    auto fill_iter = shard.fills.find(cache_key);
+    if (fill_iter != shard.fills.end()) {
+        fill_iter->second.version++;
+    }
+    auto iter = shard.entries.find(cache_key);
+    if (iter != shard.entries.end()) {
+        Remove(&shard, iter);
+    }
+}
+
+void DiskRowCache::Erase(uint64_t table_id) {
+    std::string prefix(reinterpret_cast<const char*>(&table_id), sizeof(table_id));
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mu);
+        for (auto& kv : shard->fills) {
+            if (kv.first.compare(0, prefix.size(), prefix) == 0) {
+                kv.second.version++;
+            }
+        }
+        for (auto iter = shard->entries.begin(); iter != shard->entries.end();) {
+            if (iter->first.compare(0, prefix.size(), prefix) == 0) {
+                shard->byte_size -= iter->second.charge;
+                shard->lru.erase(iter->second.lru_iter);
+                iter = shard->entries.erase(iter);
+            } else {
+                ++iter;
+            }
+        }
+    }
+}
+
+uint64_t DiskRowCache::GetByteSize() {
+    uint64_t byte_size = 0;
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mu);
+        byte_size += shard->byte_size;
+    }
+    return byte_size;
+}
+
+uint64_t DiskRowCache::GetKeyCnt() {
+    uint64_t key_cnt = 0;
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mu);
+        key_cnt += shard->entries.size();
+    }
+    return key_cnt;
+}
+
+CachedRowIterator::CachedRowIterator(std::shared_ptr<const CachedRows> rows, ::openmldb::storage::TTLType ttl_type,
+                                     uint64_t expire_time, uint64_t expire_cnt)
+    : rows_(rows), expire_value_(expire_time, expire_cnt, ttl_type), pos_(0) {}
+
+bool CachedRowIterator::Valid() const {
+    return pos_ < rows_->rows.size() && !expire_value_.IsExpired(rows_->rows[pos_].first, pos_ + 1);
+}
+
+void CachedRowIterator::Next() { pos_++; }
+
+const uint64_t& CachedRowIterator::GetKey() const { return rows_->rows[pos_].first; }
+
+const ::hybridse::codec::Row& CachedRowIterator::GetValue() { return rows_->rows[pos_].second; }
+
+void CachedRowIterator::Seek(const uint64_t& key) {
+    // the rows are in the ts desc order, find the first one whose ts is not greater than key
+    auto iter = std::lower_bound(
+        rows_->rows.begin(), rows_->rows.end(), key,
+        [](const std::pair<uint64_t, ::hybridse::codec::Row>& row, uint64_t ts) { return row.first > ts; });
+    pos_ = iter - rows_->rows.begin();
+}
+
+void CachedRowIterator::SeekToFirst() { pos_ = 0; }
+
+}  // namespace storage
+}  // namespace openmldb
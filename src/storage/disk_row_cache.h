@@ -0,0 +1,134 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_STORAGE_DISK_ROW_CACHE_H_
+#define SRC_STORAGE_DISK_ROW_CACHE_H_
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "codec/row.h"
+#include "storage/schema.h"
+#include "vm/catalog.h"
+
+namespace openmldb {
+namespace storage {
+
+// The rows of one key of an index in the ts desc order. complete is false if the key
+// has more alive rows than the cache keeps, then the key has to be read from disk
+struct CachedRows {
+    std::vector<std::pair<uint64_t, ::hybridse::codec::Row>> rows;
+    bool complete = true;
+    uint64_t byte_size = 0;
+};
+
+// The decoded rows of the hot keys of disk tables, shared by all the tables and bounded by
+// the total byte size. The keys are spread to shards, each of them is a lru list.
+//
+// The rows are filled by the point lookups of the window iterator after a miss and dropped
+// by the puts and deletes of the key. A fill begins before the snapshot it reads is taken and
+// it is dropped if the key has been invalidated after that, so a stale fill never hides a put
+class DiskRowCache {
+ public:
+    DiskRowCache(uint64_t capacity, uint32_t max_rows, uint32_t shard_cnt);
+    DiskRowCache(const DiskRowCache&) = delete;
+    DiskRowCache& operator=(const DiskRowCache&) = delete;
+
+    // table_id is unique among the tables using the cache, so the rows of a dropped
+    // table are never read by the table created later with the same tid and pid
+    std::shared_ptr<const CachedRows> Get(uint64_t table_id, uint32_t idx, const std::string& pk);
+
+    // begin a fill of the key and return the version to pass to Insert, it has to be called
+    // before the rows are read. Insert or EndFill must be called after it
+    uint64_t BeginFill(uint64_t table_id, uint32_t idx, const std::string& pk);
+
+    // end the fill, return false if the key is invalidated after the fill begins or the rows are too large
+    bool Insert(uint64_t table_id, uint32_t idx, const std::string& pk, uint64_t version,
+                const std::shared_ptr<const CachedRows>& rows);
+
+    // end the fill without rows
+    void EndFill(uint64_t table_id, uint32_t idx, const std::string& pk);
+
+    void Invalidate(uint64_t table_id, uint32_t idx, const std::string& pk);
+
+    // drop all the keys of the table, the fills started before are dropped too
+    void Erase(uint64_t table_id);
+
+    uint32_t GetMaxRows() const { return max_rows_; }
+
+    uint64_t GetByteSize();
+    uint64_t GetKeyCnt();
+
+ private:
+    struct Entry {
+        std::shared_ptr<const CachedRows> rows;
+        uint64_t charge;
+        std::list<std::string>::iterator lru_iter;
+    };
+    // the fills in progress of a key, the version is increased by every invalidation of the key
+    struct Fill {
+        uint64_t version = 0;
+        uint32_t ref_cnt = 0;
+    };
+    struct Shard {
+        std::mutex mu;
+        // the most recently used key is at the front
+        std::list<std::string> lru;
+        std::unordered_map<std::string, Entry> entries;
+        std::unordered_map<std::string, Fill> fills;
+        uint64_t byte_size = 0;
+    };
+
+    static std::string GetCacheKey(uint64_t table_id, uint32_t idx, const std::string& pk);
+    Shard& GetShard(const std::string& cache_key);
+    void Remove(Shard* shard, std::unordered_map<std::string, Entry>::iterator iter);
+    // end a fill of the key and return its version now
+    uint64_t ReleaseFill(Shard* shard, const std::string& cache_key);
+
+    uint64_t shard_capacity_;
+    uint32_t max_rows_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+// iterate the cached rows of a key and skip the expired ones
+class CachedRowIterator : public ::hybridse::vm::RowIterator {
+ public:
+    CachedRowIterator(std::shared_ptr<const CachedRows> rows, ::openmldb::storage::TTLType ttl_type,
+                      uint64_t expire_time, uint64_t expire_cnt);
+
+    bool Valid() const override;
+    void Next() override;
+    const uint64_t& GetKey() const override;
+    const ::hybridse::codec::Row& GetValue() override;
+    void Seek(const uint64_t& key) override;
+    void SeekToFirst() override;
+    bool IsSeekable() const override { return true; }
+
+ private:
+    std::shared_ptr<const CachedRows> rows_;
+    TTLSt expire_value_;
+    uint32_t pos_;
+};
+
+}  // namespace storage
+}  // namespace openmldb
+
+#endif  // SRC_STORAGE_DISK_ROW_CACHE_H_
@@ -0,0 +1,171 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "storage/disk_row_cache.h"
+
+#include <memory>
+#include <string>
+
+#include "gtest/gtest.h"
+
+namespace openmldb {
+namespace storage {
+
+class DiskRowCacheTest : public ::testing::Test {
+ public:
+    DiskRowCacheTest() {}
+    ~DiskRowCacheTest() {}
+};
+
+// the rows of ts from start down to start - cnt + 1, each of them has size bytes
+std::shared_ptr<CachedRows> BuildRows(uint64_t start, uint32_t cnt, uint32_t size) {
+    auto rows = std::make_shared<CachedRows>();
+    for (uint32_t i = 0; i < cnt; i++) {
+        int8_t* buf = reinterpret_cast<int8_t*>(malloc(size));
+        memset(buf, 'a' + i % 26, size);
+        rows->rows.emplace_back(start - i,
+                                ::hybridse::codec::Row(::hybridse::base::RefCountedSlice::CreateManaged(buf, size)));
+        rows->byte_size += size;
+    }
+    return rows;
+}
+
+TEST_F(DiskRowCacheTest, GetAndInvalidate) {
+    DiskRowCache cache(1 << 20, 16, 4);
+    ASSERT_FALSE(cache.Get(1, 0, "key1"));
+    uint64_t version = cache.BeginFill(1, 0, "key1");
+    ASSERT_TRUE(cache.Insert(1, 0, "key1", version, BuildRows(100, 3, 10)));
+    auto rows = cache.Get(1, 0, "key1");
+    ASSERT_TRUE(rows);
+    ASSERT_EQ(3u, rows->rows.size());
+    ASSERT_EQ(100u, rows->rows[0].first);
+    // the same pk of another index or table is another key
+    ASSERT_FALSE(cache.Get(1, 1, "key1"));
+    ASSERT_FALSE(cache.Get(2, 0, "key1"));
+    ASSERT_EQ(1u, cache.GetKeyCnt());
+
+    cache.Invalidate(1, 0, "key1");
+    ASSERT_FALSE(cache.Get(1, 0, "key1"));
+    ASSERT_EQ(0u, cache.GetKeyCnt());
+    ASSERT_EQ(0u, cache.GetByteSize());
+    // the fill started before the invalidation is dropped
+    ASSERT_FALSE(cache.Insert(1, 0, "key1", version, BuildRows(100, 3, 10)));
+    ASSERT_FALSE(cache.Get(1, 0, "key1"));
+    version = cache.BeginFill(1, 0, "key1");
+    ASSERT_TRUE(cache.Insert(1, 0, "key1", version, BuildRows(101, 4, 10)));
+    rows = cache.Get(1, 0, "key1");
+    ASSERT_TRUE(rows);
+    ASSERT_EQ(4u, rows->rows.size());
+    ASSERT_EQ(101u, rows->rows[0].first);
+}
+
+TEST_F(DiskRowCacheTest, FillVersionPerKey) {
+    // all the keys are in one shard
+    DiskRowCache cache(1 << 20, 16, 1);
+    uint64_t version1 = cache.BeginFill(1, 0, "key1");
+    uint64_t version2 = cache.BeginFill(1, 0, "key2");
+    // the invalidation of another key does not drop the fill
+    cache.Invalidate(1, 0, "key2");
+    ASSERT_TRUE(cache.Insert(1, 0, "key1", version1, BuildRows(100, 3, 10)));
+    ASSERT_FALSE(cache.Insert(1, 0, "key2", version2, BuildRows(100, 3, 10)));
+    ASSERT_FALSE(cache.Get(1, 0, "key2"));
+
+    // the concurrent fills of a key are all dropped by an invalidation
+    version1 = cache.BeginFill(1, 0, "key2");
+    cache.BeginFill(1, 0, "key2");
+    cache.Invalidate(1, 0, "key2");
+    uint64_t version3 = cache.BeginFill(1, 0, "key2");
+    ASSERT_FALSE(cache.Insert(1, 0, "key2", version1, BuildRows(100, 3, 10)));
+    cache.EndFill(1, 0, "key2");
+    ASSERT_TRUE(cache.Insert(1, 0, "key2", version3, BuildRows(100, 3, 10)));
+    ASSERT_TRUE(cache.Get(1, 0, "key2"));
+
+    // the fills of a table are dropped when it is erased
+    version1 = cache.BeginFill(1, 0, "key3");
+    cache.Erase(1);
+    ASSERT_FALSE(cache.Insert(1, 0, "key3", version1, BuildRows(100, 3, 10)));
+    ASSERT_EQ(0u, cache.GetKeyCnt());
+}
+
+TEST_F(DiskRowCacheTest, Evict) {
+    // one shard keeps about 10 keys
+    DiskRowCache cache(10 * 1200, 16, 1);
+    for (int i = 0; i < 20; i++) {
+        std::string pk = "key" + std::to_string(i);
+        ASSERT_TRUE(cache.Insert(1, 0, pk, cache.BeginFill(1, 0, pk), BuildRows(100, 10, 100)));
+        // key0 is the most recently used one
+        ASSERT_TRUE(cache.Get(1, 0, "key0"));
+    }
+    ASSERT_LE(cache.GetByteSize(), 10 * 1200u);
+    ASSERT_GT(cache.GetKeyCnt(), 5u);
+    ASSERT_LT(cache.GetKeyCnt(), 20u);
+    ASSERT_TRUE(cache.Get(1, 0, "key0"));
+    ASSERT_TRUE(cache.Get(1, 0, "key19"));
+    ASSERT_FALSE(cache.Get(1, 0, "key1"));
+    // the rows larger than a shard are not cached
+    ASSERT_FALSE(cache.Insert(1, 0, "large", cache.BeginFill(1, 0, "large"), BuildRows(100, 200, 100)));
+
+    ASSERT_TRUE(cache.Insert(2, 0, "key0", cache.BeginFill(2, 0, "key0"), BuildRows(100, 1, 100)));
+    cache.Erase(1);
+    ASSERT_FALSE(cache.Get(1, 0, "key0"));
+    ASSERT_TRUE(cache.Get(2, 0, "key0"));
+    ASSERT_EQ(1u, cache.GetKeyCnt());
+}
+
+TEST_F(DiskRowCacheTest, Iterator) {
+    std::shared_ptr<const CachedRows> rows = BuildRows(100, 10, 10);
+    CachedRowIterator it(rows, ::openmldb::storage::TTLType::kAbsoluteTime, 0, 0);
+    it.SeekToFirst();
+    for (uint64_t ts = 100; ts > 90; ts--) {
+        ASSERT_TRUE(it.Valid());
+        ASSERT_EQ(ts, it.GetKey());
+        ASSERT_EQ(10u, it.GetValue().size());
+        it.Next();
+    }
+    ASSERT_FALSE(it.Valid());
+    it.Seek(95);
+    ASSERT_TRUE(it.Valid());
+    ASSERT_EQ(95u, it.GetKey());
+    it.Seek(200);
+    ASSERT_TRUE(it.Valid());
+    ASSERT_EQ(100u, it.GetKey());
+    it.Seek(10);
+    ASSERT_FALSE(it.Valid());
+
+    // the rows not later than the expire time are skipped
+    CachedRowIterator abs_it(rows, ::openmldb::storage::TTLType::kAbsoluteTime, 97, 0);
+    abs_it.SeekToFirst();
+    int cnt = 0;
+    for (; abs_it.Valid(); abs_it.Next()) {
+        cnt++;
+    }
+    ASSERT_EQ(3, cnt);
+    CachedRowIterator lat_it(rows, ::openmldb::storage::TTLType::kLatestTime, 0, 4);
+    lat_it.SeekToFirst();
+    cnt = 0;
+    for (; lat_it.Valid(); lat_it.Next()) {
+        cnt++;
+    }
+    ASSERT_EQ(4, cnt);
+}
+
+}  // namespace storage
+}  // namespace openmldb
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -15,6 +15,8 @@
  */
 
 #include "storage/disk_table.h"
+#include <algorithm>
+#include <numeric>
 #include <utility>
 #include "base/file_util.h"
 #include "base/glog_wapper.h"  // NOLINT
@@ -29,13 +31,45 @@ DECLARE_uint32(block_cache_mb);
 DECLARE_uint32(write_buffer_mb);
 DECLARE_uint32(block_cache_shardbits);
 DECLARE_bool(verify_compression);
+DECLARE_string(disk_table_filter_policy);
+DECLARE_uint32(disk_table_filter_bits_per_key);
+DECLARE_uint32(disk_table_block_size_kb);
+DECLARE_bool(disk_table_partition_index_filter);
+DECLARE_uint32(disk_table_row_cache_mb);
+DECLARE_uint32(disk_table_row_cache_max_rows);
+DECLARE_bool(disk_table_gc_head_scan);
+DECLARE_uint32(disk_table_gc_compaction_percent);
 
 namespace openmldb {
 namespace storage {
 
 static rocksdb::Options ssd_option_template;
 static rocksdb::Options hdd_option_template;
+static rocksdb::BlockBasedTableOptions table_options_template;
 static bool options_template_initialized = false;
+// the row cache shared by all disk tables, null if it is disabled
+static std::shared_ptr<DiskRowCache> row_cache_template;
+static std::atomic<uint64_t> row_cache_table_id(0);
+static const uint32_t ROW_CACHE_SHARD_CNT = 16;
+
+// the filter is built on the prefix extracted by KeyTsPrefixTransform, i.e. the key without ts,
+// so the seeks of absent keys skip the data blocks
+static bool SetFilterPolicy(const std::string& policy, uint32_t bits_per_key,
+                            rocksdb::BlockBasedTableOptions* table_options) {
+    if (policy == "bloom") {
+        table_options->filter_policy.reset(rocksdb::NewBloomFilterPolicy(bits_per_key, false));
+    } else if (policy == "ribbon") {
+        table_options->filter_policy.reset(rocksdb::NewRibbonFilterPolicy(bits_per_key));
+    } else if (policy == "none") {
+        table_options->filter_policy.reset();
+    } else {
+        return false;
+    }
+    table_options->partition_filters =
+        table_options->filter_policy != nullptr &&
+        table_options->index_type == rocksdb::BlockBasedTableOptions::IndexType::kTwoLevelIndexSearch;
+    return true;
+}
 
 DiskTable::DiskTable(const std::string& name, uint32_t id, uint32_t pid, const std::map<std::string, uint32_t>& mapping,
                      uint64_t ttl, ::openmldb::type::TTLType ttl_type, ::openmldb::common::StorageMode storage_mode,
@@ -44,10 +78,17 @@ DiskTable::DiskTable(const std::string& name, uint32_t id, uint32_t pid, const s
             ::openmldb::type::CompressType::kNoCompress),
       write_opts_(),
       offset_(0),
-      table_path_(table_path) {
+      table_path_(table_path),
+      row_cache_(),
+      cache_id_(0),
+      row_cache_hit_cnt_(0),
+      row_cache_miss_cnt_(0),
+      gc_offsets_() {
     if (!options_template_initialized) {
         initOptionTemplate();
     }
+    row_cache_ = row_cache_template;
+    cache_id_ = row_cache_table_id.fetch_add(1, std::memory_order_relaxed);
     write_opts_.disableWAL = FLAGS_disable_wal;
     db_ = nullptr;
 }
@@ -58,10 +99,17 @@ DiskTable::DiskTable(const ::openmldb::api::TableMeta& table_meta, const std::st
             ::openmldb::type::CompressType::kNoCompress),
       write_opts_(),
       offset_(0),
-      table_path_(table_path) {
+      table_path_(table_path),
+      row_cache_(),
+      cache_id_(0),
+      row_cache_hit_cnt_(0),
+      row_cache_miss_cnt_(0),
+      gc_offsets_() {
     if (!options_template_initialized) {
         initOptionTemplate();
     }
+    row_cache_ = row_cache_template;
+    cache_id_ = row_cache_table_id.fetch_add(1, std::memory_order_relaxed);
     diskused_ = 0;
     write_opts_.disableWAL = FLAGS_disable_wal;
     db_ = nullptr;
@@ -69,6 +117,9 @@ DiskTable::DiskTable(const ::openmldb::api::TableMeta& table_meta, const std::st
 }
 
 DiskTable::~DiskTable() {
+    if (row_cache_) {
+        row_cache_->Erase(cache_id_);
+    }
     for (auto handle : cf_hs_) {
         delete handle;
     }
@@ -79,8 +130,10 @@ DiskTable::~DiskTable() {
 }
 
 void DiskTable::initOptionTemplate() {
-    std::shared_ptr<rocksdb::Cache> cache = rocksdb::NewLRUCache(FLAGS_block_cache_mb << 20,
-                                                                 FLAGS_block_cache_shardbits);  // Can be set by flags
+    // the index and filter blocks cached with high priority are kept in the high priority pool
+    std::shared_ptr<rocksdb::Cache> cache =
+        rocksdb::NewLRUCache(static_cast<uint64_t>(FLAGS_block_cache_mb) << 20, FLAGS_block_cache_shardbits, false,
+                             0.5);  // Can be set by flags
     // SSD options template
     ssd_option_template.max_open_files = -1;
     ssd_option_template.env->SetBackgroundThreads(1, rocksdb::Env::Priority::HIGH);  // flush threads
@@ -98,13 +151,23 @@ void DiskTable::initOptionTemplate() {
         ssd_option_template.max_bytes_for_level_base >> 4;  // number of L1 files = 16
 
     rocksdb::BlockBasedTableOptions table_options;
-    // table_options.cache_index_and_filter_blocks = true;
-    // table_options.pin_l0_filter_and_index_blocks_in_cache = true;
+    if (FLAGS_disk_table_partition_index_filter) {
+        // only the top level index and filter are pinned, the partitions are loaded on demand
+        table_options.index_type = rocksdb::BlockBasedTableOptions::IndexType::kTwoLevelIndexSearch;
+        table_options.metadata_block_size = 4 << 10;
+        table_options.cache_index_and_filter_blocks = true;
+        table_options.cache_index_and_filter_blocks_with_high_priority = true;
+        table_options.pin_top_level_index_and_filter = true;
+        table_options.pin_l0_filter_and_index_blocks_in_cache = true;
+    }
     table_options.block_cache = cache;
-    // table_options.filter_policy.reset(rocksdb::NewBloomFilterPolicy(10,
-    // false));
+    if (!SetFilterPolicy(FLAGS_disk_table_filter_policy, FLAGS_disk_table_filter_bits_per_key, &table_options)) {
+        PDLOG(WARNING, "invalid disk_table_filter_policy %s, use bloom instead",
+              FLAGS_disk_table_filter_policy.c_str());
+        SetFilterPolicy("bloom", FLAGS_disk_table_filter_bits_per_key, &table_options);
+    }
     table_options.whole_key_filtering = false;
-    table_options.block_size = 256 << 10;
+    table_options.block_size = FLAGS_disk_table_block_size_kb << 10;
     table_options.use_delta_encoding = false;
 #ifdef PZFPGA_ENABLE
     if (FLAGS_file_compression.compare("pz") == 0) {
@@ -122,13 +185,13 @@ void DiskTable::initOptionTemplate() {
     }
     if (FLAGS_verify_compression) table_options.verify_compression = true;
 #endif
+    table_options_template = table_options;
     ssd_option_template.table_factory.reset(rocksdb::NewBlockBasedTableFactory(table_options));
     // HDD options template
     hdd_option_template.max_open_files = -1;
     hdd_option_template.env->SetBackgroundThreads(1, rocksdb::Env::Priority::HIGH);  // flush threads
     hdd_option_template.env->SetBackgroundThreads(1, rocksdb::Env::Priority::LOW);   // compaction threads
     hdd_option_template.memtable_prefix_bloom_size_ratio = 0.02;
-    hdd_option_template.optimize_filters_for_hits = true;
     hdd_option_template.level_compaction_dynamic_level_bytes = true;
     hdd_option_template.max_file_opening_threads =
         1;  // set to the number of disks on which the db root folder is mounted
@@ -143,13 +206,37 @@ void DiskTable::initOptionTemplate() {
     hdd_option_template.max_bytes_for_level_base = 1024 << 20;
     hdd_option_template.table_factory.reset(rocksdb::NewBlockBasedTableFactory(table_options));
 
+    if (FLAGS_disk_table_row_cache_mb > 0) {
+        row_cache_template = std::make_shared<DiskRowCache>(static_cast<uint64_t>(FLAGS_disk_table_row_cache_mb) << 20,
+                                                            FLAGS_disk_table_row_cache_max_rows, ROW_CACHE_SHARD_CNT);
+    }
     options_template_initialized = true;
 }
 
 bool DiskTable::InitColumnFamilyDescriptor() {
     cf_ds_.clear();
+    filter_factories_.clear();
     cf_ds_.push_back(
         rocksdb::ColumnFamilyDescriptor(rocksdb::kDefaultColumnFamilyName, rocksdb::ColumnFamilyOptions()));
+    std::shared_ptr<rocksdb::TableFactory> table_factory;
+    if (table_meta_ && table_meta_->has_disk_table_option()) {
+        const auto& disk_option = table_meta_->disk_table_option();
+        rocksdb::BlockBasedTableOptions table_options = table_options_template;
+        if (disk_option.has_block_size_kb()) {
+            table_options.block_size = disk_option.block_size_kb() << 10;
+        }
+        if (disk_option.has_filter_policy() || disk_option.has_filter_bits_per_key()) {
+            const std::string& policy =
+                disk_option.has_filter_policy() ? disk_option.filter_policy() : FLAGS_disk_table_filter_policy;
+            uint32_t bits_per_key = disk_option.has_filter_bits_per_key() ? disk_option.filter_bits_per_key()
+                                                                          : FLAGS_disk_table_filter_bits_per_key;
+            if (!SetFilterPolicy(policy, bits_per_key, &table_options)) {
+                PDLOG(WARNING, "invalid filter policy %s. tid %u pid %u", policy.c_str(), id_, pid_);
+                return false;
+            }
+        }
+        table_factory.reset(rocksdb::NewBlockBasedTableFactory(table_options));
+    }
     auto inner_indexs = table_index_.GetAllInnerIndex();
     for (const auto& inner_index : *inner_indexs) {
         rocksdb::ColumnFamilyOptions cfo;
@@ -162,12 +249,15 @@ bool DiskTable::InitColumnFamilyDescriptor() {
         }
         cfo.comparator = &cmp_;
         cfo.prefix_extractor.reset(new KeyTsPrefixTransform());
+        if (table_factory) {
+            cfo.table_factory = table_factory;
+        }
         const auto& indexs = inner_index->GetIndex();
         auto index_def = indexs.front();
-        if (index_def->GetTTLType() == ::openmldb::storage::TTLType::kAbsoluteTime ||
-            index_def->GetTTLType() == ::openmldb::storage::TTLType::kAbsOrLat) {
-            cfo.compaction_filter_factory = std::make_shared<AbsoluteTTLFilterFactory>(inner_index);
-        }
+        // the filter reads the ttl of the indexs in each compaction, so the ttl updated later takes effect too
+        auto filter_factory = std::make_shared<TTLFilterFactory>(inner_index);
+        filter_factories_.push_back(filter_factory);
+        cfo.compaction_filter_factory = filter_factory;
         cf_ds_.push_back(rocksdb::ColumnFamilyDescriptor(index_def->GetName(), cfo));
         DEBUGLOG("add cf_name %s. tid %u pid %u", index_def->GetName().c_str(), id_, pid_);
     }
@@ -178,7 +268,9 @@ bool DiskTable::Init() {
     if (!InitFromMeta()) {
         return false;
     }
-    InitColumnFamilyDescriptor();
+    if (!InitColumnFamilyDescriptor()) {
+        return false;
+    }
     std::string path = table_path_ + "/data";
     if (!openmldb::base::IsExists(path)) {
         PDLOG(INFO, "Create new disk table with path %s", path);
@@ -196,17 +288,39 @@ bool DiskTable::Init() {
         PDLOG(WARNING, "rocksdb open failed. tid %u pid %u error %s", id_, pid_, s.ToString().c_str());
         return false;
     }
+    for (uint32_t i = 0; i < filter_factories_.size(); i++) {
+        // the memtables are flushed in recovery, so the range deletions written before are in the sst files
+        if (!HasRangeDelete(i)) {
+            filter_factories_[i]->ResetRangeDelete(filter_factories_[i]->GetRangeDeleteCnt());
+        }
+    }
     PDLOG(INFO, "Open DB. tid %u pid %u ColumnFamilyHandle size %u with data path %s", id_, pid_, GetIdxCnt(),
           path.c_str());
     return true;
 }
 
+bool DiskTable::HasRangeDelete(uint32_t inner_pos) {
+    rocksdb::TablePropertiesCollection props;
+    rocksdb::Status s = db_->GetPropertiesOfAllTables(cf_hs_[inner_pos + 1], &props);
+    if (!s.ok()) {
+        PDLOG(WARNING, "get table properties failed. tid %u pid %u msg %s", id_, pid_, s.ToString().c_str());
+        return true;
+    }
+    for (const auto& kv : props) {
+        if (kv.second->num_range_deletions > 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
 bool DiskTable::Put(const std::string& pk, uint64_t time, const char* data, uint32_t size) {
     rocksdb::Status s;
     std::string combine_key = CombineKeyTs(pk, time);
     rocksdb::Slice spk = rocksdb::Slice(combine_key);
     s = db_->Put(write_opts_, cf_hs_[1], spk, rocksdb::Slice(data, size));
     if (s.ok()) {
+        InvalidateRowCache(0, pk);
         offset_.fetch_add(1, std::memory_order_relaxed);
         return true;
     } else {
@@ -258,6 +372,10 @@ bool DiskTable::Put(uint64_t time, const std::string& value, const Dimensions& d
     }
     s = db_->Write(write_opts_, &batch);
     if (s.ok()) {
+        // the cached rows are dropped after the write, so the fill after that reads the new row
+        for (const auto& dim : dimensions) {
+            InvalidateRowCache(table_index_.GetInnerIndexPos(dim.idx()), dim.key());
+        }
         offset_.fetch_add(1, std::memory_order_relaxed);
         return true;
     } else {
@@ -289,8 +407,10 @@ bool DiskTable::Delete(const std::string& pk, uint32_t idx) {
         std::string combine_key2 = CombineKeyTs(pk, 0);
         batch.DeleteRange(cf_hs_[idx + 1], rocksdb::Slice(combine_key1), rocksdb::Slice(combine_key2));
     }
+    filter_factories_[idx]->AddRangeDelete();
     rocksdb::Status s = db_->Write(write_opts_, &batch);
     if (s.ok()) {
+        InvalidateRowCache(index_def->GetInnerPos(), pk);
         offset_.fetch_add(1, std::memory_order_relaxed);
         return true;
     } else {
@@ -316,8 +436,17 @@ bool DiskTable::Get(uint32_t idx, const std::string& pk, uint64_t ts, std::strin
 bool DiskTable::Get(const std::string& pk, uint64_t ts, std::string& value) { return Get(0, pk, ts, value); }
 
 void DiskTable::SchedGc() {
-    GcHead();
+    if (FLAGS_disk_table_gc_head_scan) {
+        GcHead();
+    } else {
+        GcByCompaction();
+    }
+    bool ttl_updated = !std::atomic_load_explicit(&update_ttl_, std::memory_order_acquire)->empty();
     UpdateTTL();
+    if (ttl_updated && row_cache_) {
+        // the rows cached are filtered by the old ttl
+        row_cache_->Erase(cache_id_);
+    }
 }
 
 void DiskTable::GcHead() {
@@ -328,10 +457,13 @@ void DiskTable::GcHead() {
         rocksdb::ReadOptions ro = rocksdb::ReadOptions();
         const rocksdb::Snapshot* snapshot = db_->GetSnapshot();
         ro.snapshot = snapshot;
-        // ro.prefix_same_as_start = true;
+        // the iterator goes across keys, so the prefix filter can not be used
+        ro.total_order_seek = true;
         ro.pin_data = true;
         rocksdb::Iterator* it = db_->NewIterator(ro, cf_hs_[idx + 1]);
         it->SeekToFirst();
+        // the rows beyond the latest ttl are deleted by range
+        filter_factories_[idx]->AddRangeDelete();
         const auto& indexs = inner_index->GetIndex();
         if (indexs.size() > 1) {
             bool need_ttl = false;
@@ -438,6 +570,62 @@ void DiskTable::GcHead() {
     PDLOG(INFO, "Gc used %lu second. tid %u pid %u", time_used / 1000, id_, pid_);
 }
 
+void DiskTable::GcByCompaction() {
+    uint64_t offset = offset_.load(std::memory_order_relaxed);
+    uint64_t start_time = ::baidu::common::timer::get_micros() / 1000;
+    uint32_t compact_cnt = 0;
+    auto inner_indexs = table_index_.GetAllInnerIndex();
+    for (const auto& inner_index : *inner_indexs) {
+        bool need_gc = false;
+        for (const auto& index : inner_index->GetIndex()) {
+            auto ttl = index->GetTTL();
+            if (ttl->lat_ttl > 0 && ttl->ttl_type != ::openmldb::storage::TTLType::kAbsoluteTime) {
+                need_gc = true;
+                break;
+            }
+        }
+        if (!need_gc) {
+            continue;
+        }
+        uint32_t inner_id = inner_index->GetId();
+        const auto& filter_factory = filter_factories_[inner_id];
+        uint64_t put_cnt = offset - gc_offsets_[inner_id];
+        if (put_cnt == 0) {
+            continue;
+        }
+        // the full compaction rewrites the whole index, so it waits for enough puts to bound the rewritten rows.
+        // a row has a key for each ts of the inner index
+        uint64_t row_cnt = 0;
+        if (db_->GetIntProperty(cf_hs_[inner_id + 1], "rocksdb.estimate-num-keys", &row_cnt)) {
+            row_cnt /= inner_index->GetIndex().size();
+        }
+        if (put_cnt * 100 < row_cnt * FLAGS_disk_table_gc_compaction_percent) {
+            continue;
+        }
+        // the filter counts the rows exactly only in a full compaction without range deletions, CompactRange
+        // may end with no full compaction if a memtable is flushed during it
+        uint64_t range_delete_cnt = filter_factory->GetRangeDeleteCnt();
+        uint64_t exact_cnt = filter_factory->GetExactCompactionCnt();
+        rocksdb::Status s = db_->CompactRange(rocksdb::CompactRangeOptions(), cf_hs_[inner_id + 1], nullptr, nullptr);
+        if (!s.ok()) {
+            PDLOG(WARNING, "compact failed. tid %u pid %u msg %s", id_, pid_, s.ToString().c_str());
+            continue;
+        }
+        compact_cnt++;
+        if (filter_factory->GetExactCompactionCnt() > exact_cnt) {
+            gc_offsets_[inner_id] = offset;
+        } else if (range_delete_cnt > 0 && !HasRangeDelete(inner_id)) {
+            // the range deletions are dropped with the rows deleted in the compaction. The memtable is flushed
+            // before it, and the range deletions written after that are counted again
+            filter_factory->ResetRangeDelete(range_delete_cnt);
+        }
+    }
+    if (compact_cnt > 0) {
+        uint64_t time_used = ::baidu::common::timer::get_micros() / 1000 - start_time;
+        PDLOG(INFO, "Gc by compaction of %u indexs used %lu ms. tid %u pid %u", compact_cnt, time_used, id_, pid_);
+    }
+}
+
 void DiskTable::GcTTLOrHead() {}
 
 void DiskTable::GcTTLAndHead() {}
@@ -512,7 +700,7 @@ TraverseIterator* DiskTable::NewTraverseIterator(uint32_t index) {
     rocksdb::ReadOptions ro = rocksdb::ReadOptions();
     const rocksdb::Snapshot* snapshot = db_->GetSnapshot();
     ro.snapshot = snapshot;
-    // ro.prefix_same_as_start = true;
+    ro.total_order_seek = true;
     ro.pin_data = true;
     rocksdb::Iterator* it = db_->NewIterator(ro, cf_hs_[inner_pos + 1]);
     if (inner_index && inner_index->GetIndex().size() > 1) {
@@ -843,56 +1031,82 @@ void DiskTableTraverseIterator::NextPK() {
     auto ttl = index_def->GetTTL();
     uint64_t expire_time = GetExpireTime(*ttl);
     uint64_t expire_cnt = ttl->lat_ttl;
-    rocksdb::ReadOptions ro = rocksdb::ReadOptions();
-    const rocksdb::Snapshot* snapshot = db_->GetSnapshot();
-    ro.snapshot = snapshot;
-    // ro.prefix_same_as_start = true;
-    ro.pin_data = true;
-    rocksdb::Iterator* it = db_->NewIterator(ro, cf_hs_[inner_pos + 1]);
+    DiskTableKeyIterator* key_it = nullptr;
     if (inner_index && inner_index->GetIndex().size() > 1) {
         auto ts_col = index_def->GetTsColumn();
         if (ts_col) {
-            return new DiskTableKeyIterator(db_, it, snapshot, ttl->ttl_type, expire_time, expire_cnt,
-                                                 ts_col->GetId(), cf_hs_[inner_pos + 1]);
+            key_it = new DiskTableKeyIterator(db_, ttl->ttl_type, expire_time, expire_cnt, ts_col->GetId(),
+                                              cf_hs_[inner_pos + 1]);
         }
     }
-    return new DiskTableKeyIterator(db_, it, snapshot, ttl->ttl_type, expire_time, expire_cnt, cf_hs_[inner_pos + 1]);
+    if (key_it == nullptr) {
+        key_it = new DiskTableKeyIterator(db_, ttl->ttl_type, expire_time, expire_cnt, cf_hs_[inner_pos + 1]);
+    }
+    if (row_cache_) {
+        key_it->SetRowCache(this, idx);
+    }
+    return key_it;
 }
 
-DiskTableKeyIterator::DiskTableKeyIterator(rocksdb::DB* db, rocksdb::Iterator* it,
-                                           const rocksdb::Snapshot* snapshot, ::openmldb::storage::TTLType ttl_type,
+DiskTableKeyIterator::DiskTableKeyIterator(rocksdb::DB* db, ::openmldb::storage::TTLType ttl_type,
                                            const uint64_t& expire_time, const uint64_t& expire_cnt,
                                            rocksdb::ColumnFamilyHandle* column_handle)
     : db_(db),
-      it_(it),
-      snapshot_(snapshot),
+      it_(nullptr),
+      snapshot_(nullptr),
       ttl_type_(ttl_type),
       expire_time_(expire_time),
       expire_cnt_(expire_cnt),
       has_ts_idx_(false),
       ts_idx_(0),
-      column_handle_(column_handle) {}
+      column_handle_(column_handle),
+      table_(nullptr),
+      idx_(0),
+      cached_rows_() {}
 
-DiskTableKeyIterator::DiskTableKeyIterator(rocksdb::DB* db, rocksdb::Iterator* it,
-                                           const rocksdb::Snapshot* snapshot, ::openmldb::storage::TTLType ttl_type,
+DiskTableKeyIterator::DiskTableKeyIterator(rocksdb::DB* db, ::openmldb::storage::TTLType ttl_type,
                                            const uint64_t& expire_time, const uint64_t& expire_cnt, int32_t ts_idx,
                                            rocksdb::ColumnFamilyHandle* column_handle)
     : db_(db),
-      it_(it),
-      snapshot_(snapshot),
+      it_(nullptr),
+      snapshot_(nullptr),
       ttl_type_(ttl_type),
       expire_time_(expire_time),
       expire_cnt_(expire_cnt),
       has_ts_idx_(true),
       ts_idx_(ts_idx),
-      column_handle_(column_handle) {}
+      column_handle_(column_handle),
+      table_(nullptr),
+      idx_(0),
+      cached_rows_() {}
+
+DiskTableKeyIterator::~DiskTableKeyIterator() { ReleaseIterator(); }
 
-DiskTableKeyIterator::~DiskTableKeyIterator() {
+void DiskTableKeyIterator::InitIterator() {
+    if (it_ != nullptr) {
+        return;
+    }
+    rocksdb::ReadOptions ro = rocksdb::ReadOptions();
+    snapshot_ = db_->GetSnapshot();
+    ro.snapshot = snapshot_;
+    ro.total_order_seek = true;
+    ro.pin_data = true;
+    it_ = db_->NewIterator(ro, column_handle_);
+}
+
+void DiskTableKeyIterator::ReleaseIterator() {
+    if (it_ == nullptr) {
+        return;
+    }
     delete it_;
+    it_ = nullptr;
     db_->ReleaseSnapshot(snapshot_);
+    snapshot_ = nullptr;
 }
 
 void DiskTableKeyIterator::SeekToFirst() {
+    cached_rows_.reset();
+    InitIterator();
     it_->SeekToFirst();
     uint32_t cur_ts_idx = UINT32_MAX;
     ParseKeyAndTs(has_ts_idx_, it_->key(), pk_, ts_, cur_ts_idx);
@@ -922,9 +1136,30 @@ void DiskTableKeyIterator::NextPK() {
     }
 }
 
-void DiskTableKeyIterator::Next() { NextPK(); }
+void DiskTableKeyIterator::Next() {
+    cached_rows_.reset();
+    InitIterator();
+    NextPK();
+}
 
 void DiskTableKeyIterator::Seek(const std::string& pk) {
+    cached_rows_.reset();
+    bool need_fill = false;
+    uint64_t version = 0;
+    if (table_ != nullptr) {
+        // a point lookup is served by the row cache without reading rocksdb
+        cached_rows_ = table_->GetCachedRows(idx_, pk, &need_fill);
+        if (cached_rows_) {
+            pk_ = pk;
+            return;
+        }
+    }
+    if (need_fill) {
+        // the fill reads the rows through a snapshot taken after it begins
+        version = table_->BeginFillRowCache(idx_, pk);
+        ReleaseIterator();
+    }
+    InitIterator();
     std::string combine;
     uint64_t tmp_ts = UINT64_MAX;
     if (has_ts_idx_) {
@@ -943,10 +1178,17 @@ void DiskTableKeyIterator::Seek(const std::string& pk) {
         }
         break;
     }
+    if (need_fill) {
+        if (it_->Valid() && pk_ == pk) {
+            cached_rows_ = table_->FillRowCache(idx_, pk, version, snapshot_);
+        } else {
+            table_->EndFillRowCache(idx_, pk);
+        }
+    }
 }
 
 bool DiskTableKeyIterator::Valid() {
-    return it_->Valid();
+    return cached_rows_ || (it_ != nullptr && it_->Valid());
 }
 
 const hybridse::codec::Row DiskTableKeyIterator::GetKey() {
@@ -956,22 +1198,17 @@ const hybridse::codec::Row DiskTableKeyIterator::GetKey() {
 }
 
 std::unique_ptr<::hybridse::vm::RowIterator> DiskTableKeyIterator::GetValue() {
-    rocksdb::ReadOptions ro = rocksdb::ReadOptions();
-    const rocksdb::Snapshot* snapshot = db_->GetSnapshot();
-    ro.snapshot = snapshot;
-    // ro.prefix_same_as_start = true;
-    ro.pin_data = true;
-    rocksdb::Iterator* it = db_->NewIterator(ro, column_handle_);
-    std::unique_ptr<DiskTableRowIterator> wit(new DiskTableRowIterator(db_, it, snapshot, ttl_type_, expire_time_,
-                                                                       expire_cnt_, pk_, ts_, has_ts_idx_, ts_idx_));
-    return wit;
+    return std::unique_ptr<::hybridse::vm::RowIterator>(GetRawValue());
 }
 
 ::hybridse::vm::RowIterator* DiskTableKeyIterator::GetRawValue() {
+    if (cached_rows_) {
+        return new CachedRowIterator(cached_rows_, ttl_type_, expire_time_, expire_cnt_);
+    }
     rocksdb::ReadOptions ro = rocksdb::ReadOptions();
     const rocksdb::Snapshot* snapshot = db_->GetSnapshot();
     ro.snapshot = snapshot;
-    // ro.prefix_same_as_start = true;
+    ro.total_order_seek = true;
     ro.pin_data = true;
     rocksdb::Iterator* it = db_->NewIterator(ro, column_handle_);
     return new DiskTableRowIterator(db_, it, snapshot, ttl_type_, expire_time_, expire_cnt_, pk_, ts_, has_ts_idx_,
@@ -1127,7 +1364,7 @@ int DiskTable::GetCount(uint32_t index, const std::string& pk, uint64_t& count)
     rocksdb::ReadOptions ro = rocksdb::ReadOptions();
     const rocksdb::Snapshot* snapshot = db_->GetSnapshot();
     ro.snapshot = snapshot;
-    // ro.prefix_same_as_start = true;
+    ro.prefix_same_as_start = true;
     ro.pin_data = true;
     rocksdb::Iterator* it = db_->NewIterator(ro, cf_hs_[inner_pos + 1]);
 
@@ -1168,5 +1405,157 @@ int DiskTable::GetCount(uint32_t index, const std::string& pk, uint64_t& count)
     return 0;
 }
 
+bool DiskTable::BatchGet(uint32_t index, const std::vector<std::string>& pks, uint32_t limit,
+                         std::vector<std::vector<std::pair<uint64_t, std::string>>>* rows,
+                         std::vector<bool>* complete) {
+    const rocksdb::Snapshot* snapshot = db_->GetSnapshot();
+    bool ok = BatchGet(index, pks, limit, snapshot, rows, complete);
+    db_->ReleaseSnapshot(snapshot);
+    return ok;
+}
+
+bool DiskTable::BatchGet(uint32_t index, const std::vector<std::string>& pks, uint32_t limit,
+                         const rocksdb::Snapshot* snapshot,
+                         std::vector<std::vector<std::pair<uint64_t, std::string>>>* rows,
+                         std::vector<bool>* complete) {
+    if (rows == nullptr || complete == nullptr) {
+        return false;
+    }
+    std::shared_ptr<IndexDef> index_def = table_index_.GetIndex(index);
+    if (!index_def || !index_def->IsReady()) {
+        return false;
+    }
+    uint32_t inner_pos = index_def->GetInnerPos();
+    auto inner_index = table_index_.GetInnerIndex(inner_pos);
+    bool has_ts_idx = false;
+    uint32_t ts_idx = 0;
+    if (inner_index && inner_index->GetIndex().size() > 1) {
+        auto ts_col = index_def->GetTsColumn();
+        if (!ts_col) {
+            return false;
+        }
+        has_ts_idx = true;
+        ts_idx = ts_col->GetId();
+    }
+    auto ttl = index_def->GetTTL();
+    TTLSt expire_value(GetExpireTime(*ttl), ttl->lat_ttl, ttl->ttl_type);
+    rows->assign(pks.size(), std::vector<std::pair<uint64_t, std::string>>());
+    complete->assign(pks.size(), true);
+    std::vector<uint32_t> order(pks.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&pks](uint32_t a, uint32_t b) { return pks[a] < pks[b]; });
+
+    rocksdb::ReadOptions ro = rocksdb::ReadOptions();
+    ro.snapshot = snapshot;
+    ro.prefix_same_as_start = true;
+    ro.pin_data = true;
+    rocksdb::Iterator* it = db_->NewIterator(ro, cf_hs_[inner_pos + 1]);
+    for (size_t i = 0; i < order.size(); i++) {
+        uint32_t pos = order[i];
+        const std::string& pk = pks[pos];
+        if (i > 0 && pks[order[i - 1]] == pk) {
+            (*rows)[pos] = (*rows)[order[i - 1]];
+            (*complete)[pos] = (*complete)[order[i - 1]];
+            continue;
+        }
+        std::string combine;
+        if (has_ts_idx) {
+            combine = CombineKeyTs(pk, UINT64_MAX, ts_idx);
+        } else {
+            combine = CombineKeyTs(pk, UINT64_MAX);
+        }
+        auto& pk_rows = (*rows)[pos];
+        for (it->Seek(rocksdb::Slice(combine)); it->Valid(); it->Next()) {
+            uint32_t cur_ts_idx = UINT32_MAX;
+            std::string cur_pk;
+            uint64_t cur_ts = 0;
+            ParseKeyAndTs(has_ts_idx, it->key(), cur_pk, cur_ts, cur_ts_idx);
+            if (cur_pk != pk || (has_ts_idx && cur_ts_idx != ts_idx) ||
+                expire_value.IsExpired(cur_ts, pk_rows.size() + 1)) {
+                break;
+            }
+            if (pk_rows.size() >= limit) {
+                (*complete)[pos] = false;
+                break;
+            }
+            pk_rows.emplace_back(cur_ts, it->value().ToString());
+        }
+    }
+    delete it;
+    return true;
+}
+
+std::shared_ptr<const CachedRows> DiskTable::GetCachedRows(uint32_t idx, const std::string& pk, bool* need_fill) {
+    *need_fill = false;
+    if (!row_cache_) {
+        return std::shared_ptr<const CachedRows>();
+    }
+    auto cached = row_cache_->Get(cache_id_, idx, pk);
+    if (cached && cached->complete) {
+        row_cache_hit_cnt_.fetch_add(1, std::memory_order_relaxed);
+        return cached;
+    }
+    row_cache_miss_cnt_.fetch_add(1, std::memory_order_relaxed);
+    // the key with too many rows is kept as incomplete, so it is not filled on every lookup
+    *need_fill = !cached;
+    return std::shared_ptr<const CachedRows>();
+}
+
+uint64_t DiskTable::BeginFillRowCache(uint32_t idx, const std::string& pk) {
+    return row_cache_->BeginFill(cache_id_, idx, pk);
+}
+
+void DiskTable::EndFillRowCache(uint32_t idx, const std::string& pk) { row_cache_->EndFill(cache_id_, idx, pk); }
+
+std::shared_ptr<const CachedRows> DiskTable::FillRowCache(uint32_t idx, const std::string& pk, uint64_t version,
+                                                          const rocksdb::Snapshot* snapshot) {
+    std::vector<std::vector<std::pair<uint64_t, std::string>>> rows;
+    std::vector<bool> complete;
+    if (!BatchGet(idx, {pk}, row_cache_->GetMaxRows(), snapshot, &rows, &complete)) {
+        row_cache_->EndFill(cache_id_, idx, pk);
+        return std::shared_ptr<const CachedRows>();
+    }
+    auto filled = std::make_shared<CachedRows>();
+    filled->complete = complete[0];
+    if (filled->complete) {
+        filled->rows.reserve(rows[0].size());
+        for (const auto& row : rows[0]) {
+            int8_t* buf = reinterpret_cast<int8_t*>(malloc(row.second.size()));
+            memcpy(buf, row.second.data(), row.second.size());
+            filled->rows.emplace_back(row.first, ::hybridse::codec::Row(::hybridse::base::RefCountedSlice::CreateManaged(
+                                                     buf, row.second.size())));
+            filled->byte_size += row.second.size();
+        }
+    }
+    row_cache_->Insert(cache_id_, idx, pk, version, filled);
+    if (!filled->complete) {
+        return std::shared_ptr<const CachedRows>();
+    }
+    return filled;
+}
+
+void DiskTable::InvalidateRowCache(uint32_t inner_pos, const std::string& pk) {
+    if (!row_cache_) {
+        return;
+    }
+    auto inner_index = table_index_.GetInnerIndex(inner_pos);
+    if (!inner_index) {
+        return;
+    }
+    for (const auto& index_def : inner_index->GetIndex()) {
+        row_cache_->Invalidate(cache_id_, index_def->GetId(), pk);
+    }
+}
+
+void DiskTable::GetRowCacheStatus(::openmldb::api::RowCacheStatus* status) {
+    uint64_t hit_cnt = row_cache_hit_cnt_.load(std::memory_order_relaxed);
+    uint64_t miss_cnt = row_cache_miss_cnt_.load(std::memory_order_relaxed);
+    status->set_hit_cnt(hit_cnt);
+    status->set_miss_cnt(miss_cnt);
+    if (hit_cnt + miss_cnt > 0) {
+        status->set_hit_ratio(hit_cnt * 100 / (hit_cnt + miss_cnt));
+    }
+}
+
 }  // namespace storage
 }  // namespace openmldb
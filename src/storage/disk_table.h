@@ -36,7 +36,9 @@
 #include "rocksdb/slice_transform.h"
 #include "rocksdb/status.h"
 #include "rocksdb/table.h"
+#include "rocksdb/table_properties.h"
 #include "rocksdb/utilities/checkpoint.h"
+#include "storage/disk_row_cache.h"
 #include "storage/iterator.h"
 #include "storage/table.h"
 
@@ -143,19 +145,26 @@ class KeyTsPrefixTransform : public rocksdb::SliceTransform {
     bool SameResultWhenAppended(const rocksdb::Slice& prefix) const override { return InDomain(prefix); }
 };
 
-class AbsoluteTTLCompactionFilter : public rocksdb::CompactionFilter {
+// Drop the expired rows in compaction by the ttl of each index. The keys of the compaction input are sorted
+// by pk (with the ts position) and then by ts desc, so the rows of a pk are counted in order for the latest
+// ttl. The count is exact only in a full compaction without range deletions in the column family, the rows
+// deleted by a range tombstone are still passed to the filter. Otherwise a counted row may have been deleted,
+// so the rows are dropped by the absolute ttl only. One filter is used by one compaction only
+class TTLCompactionFilter : public rocksdb::CompactionFilter {
  public:
-    explicit AbsoluteTTLCompactionFilter(std::shared_ptr<InnerIndexSt> inner_index) : inner_index_(inner_index) {}
-    virtual ~AbsoluteTTLCompactionFilter() {}
+    TTLCompactionFilter(std::shared_ptr<InnerIndexSt> inner_index, bool exact_count)
+        : inner_index_(inner_index), exact_count_(exact_count), cur_time_(::baidu::common::timer::get_micros() / 1000),
+          last_key_(), record_idx_(0) {}
+    virtual ~TTLCompactionFilter() {}
 
-    const char* Name() const override { return "AbsoluteTTLCompactionFilter"; }
+    const char* Name() const override { return "TTLCompactionFilter"; }
 
     bool Filter(int /*level*/, const rocksdb::Slice& key, const rocksdb::Slice& /*existing_value*/,
                 std::string* /*new_value*/, bool* /*value_changed*/) const override {
         if (key.size() < TS_LEN) {
             return false;
         }
-        uint64_t real_ttl = 0;
+        std::shared_ptr<TTLSt> ttl;
         const auto& indexs = inner_index_->GetIndex();
         if (indexs.size() > 1) {
             if (key.size() < TS_LEN + TS_POS_LEN) {
@@ -163,52 +172,91 @@ class AbsoluteTTLCompactionFilter : public rocksdb::CompactionFilter {
             }
             uint32_t ts_idx = *((uint32_t*)(key.data() + key.size() - TS_LEN -  // NOLINT
                                           TS_POS_LEN));
-            bool has_found = false;
-            for (const auto index : indexs) {
+            for (const auto& index : indexs) {
                 auto ts_col = index->GetTsColumn();
                 if (!ts_col) {
                     return false;
                 }
                 if (ts_col->GetId() == ts_idx) {
-                    real_ttl = index->GetTTL()->abs_ttl;
-                    has_found = true;
+                    ttl = index->GetTTL();
                     break;
                 }
             }
-            if (!has_found) {
+            if (!ttl) {
                 return false;
             }
         } else {
-            real_ttl = indexs.front()->GetTTL()->abs_ttl;
+            ttl = indexs.front()->GetTTL();
         }
-        if (real_ttl < 1) {
-            return false;
+        // the key without ts is the pk, or the pk and the ts position of the index
+        rocksdb::Slice cur_key(key.data(), key.size() - TS_LEN);
+        if (cur_key != rocksdb::Slice(last_key_)) {
+            last_key_.assign(cur_key.data(), cur_key.size());
+            record_idx_ = 0;
+        }
+        record_idx_++;
+        uint64_t expire_time = 0;
+        switch (ttl->ttl_type) {
+            case TTLType::kAbsoluteTime:
+            case TTLType::kAbsAndLat:
+            case TTLType::kAbsOrLat:
+                if (ttl->abs_ttl > 0 && cur_time_ > ttl->abs_ttl) {
+                    expire_time = cur_time_ - ttl->abs_ttl;
+                }
+                break;
+            case TTLType::kLatestTime:
+                break;
+            default:
+                return false;
         }
         uint64_t ts = 0;
         memcpy(static_cast<void*>(&ts), key.data() + key.size() - TS_LEN, TS_LEN);
         memrev64ifbe(static_cast<void*>(&ts));
-        uint64_t cur_time = ::baidu::common::timer::get_micros() / 1000;
-        if (ts < cur_time - real_ttl) {
-            return true;
+        if (!exact_count_) {
+            if (ttl->ttl_type == TTLType::kLatestTime || ttl->ttl_type == TTLType::kAbsAndLat) {
+                return false;
+            }
+            return TTLSt(expire_time, 0, TTLType::kAbsoluteTime).IsExpired(ts, record_idx_);
         }
-        return false;
+        return TTLSt(expire_time, ttl->lat_ttl, ttl->ttl_type).IsExpired(ts, record_idx_);
     }
 
  private:
     std::shared_ptr<InnerIndexSt> inner_index_;
+    bool exact_count_;
+    uint64_t cur_time_;
+    mutable std::string last_key_;
+    mutable uint32_t record_idx_;
 };
 
-class AbsoluteTTLFilterFactory : public rocksdb::CompactionFilterFactory {
+// The range deletions are counted since the column family is opened, the ones written before are assumed
+// until ResetRangeDelete is called
+class TTLFilterFactory : public rocksdb::CompactionFilterFactory {
  public:
-    explicit AbsoluteTTLFilterFactory(const std::shared_ptr<InnerIndexSt>& inner_index) : inner_index_(inner_index) {}
+    explicit TTLFilterFactory(const std::shared_ptr<InnerIndexSt>& inner_index)
+        : inner_index_(inner_index), range_delete_cnt_(1), exact_compaction_cnt_(0) {}
     std::unique_ptr<rocksdb::CompactionFilter> CreateCompactionFilter(
         const rocksdb::CompactionFilter::Context& context) override {
-        return std::unique_ptr<rocksdb::CompactionFilter>(new AbsoluteTTLCompactionFilter(inner_index_));
+        bool exact_count = context.is_full_compaction && range_delete_cnt_.load(std::memory_order_acquire) == 0;
+        if (exact_count) {
+            exact_compaction_cnt_.fetch_add(1, std::memory_order_relaxed);
+        }
+        return std::unique_ptr<rocksdb::CompactionFilter>(new TTLCompactionFilter(inner_index_, exact_count));
     }
-    const char* Name() const override { return "AbsoluteTTLFilterFactory"; }
+    const char* Name() const override { return "TTLFilterFactory"; }
+
+    // need to be called before a range deletion is written
+    void AddRangeDelete() { range_delete_cnt_.fetch_add(1, std::memory_order_acq_rel); }
+    uint64_t GetRangeDeleteCnt() const { return range_delete_cnt_.load(std::memory_order_acquire); }
+    // the range deletions counted in cnt are no longer in the column family. It does nothing if more are added
+    void ResetRangeDelete(uint64_t cnt) { range_delete_cnt_.compare_exchange_strong(cnt, 0); }
+    // the count of the compactions in which the filter drops the rows by the latest ttl
+    uint64_t GetExactCompactionCnt() const { return exact_compaction_cnt_.load(std::memory_order_relaxed); }
 
  private:
     std::shared_ptr<InnerIndexSt> inner_index_;
+    std::atomic<uint64_t> range_delete_cnt_;
+    std::atomic<uint64_t> exact_compaction_cnt_;
 };
 
 class DiskTableIterator : public TableIterator {
@@ -305,18 +353,24 @@ class DiskTableRowIterator : public ::hybridse::vm::RowIterator {
     bool pk_valid_;
 };
 
+class DiskTable;
+
 class DiskTableKeyIterator : public ::hybridse::vm::WindowIterator {
  public:
-    DiskTableKeyIterator(rocksdb::DB* db, rocksdb::Iterator* it, const rocksdb::Snapshot* snapshot,
-                         ::openmldb::storage::TTLType ttl_type, const uint64_t& expire_time, const uint64_t& expire_cnt,
-                         int32_t ts_idx, rocksdb::ColumnFamilyHandle* column_handle);
+    DiskTableKeyIterator(rocksdb::DB* db, ::openmldb::storage::TTLType ttl_type, const uint64_t& expire_time,
+                         const uint64_t& expire_cnt, int32_t ts_idx, rocksdb::ColumnFamilyHandle* column_handle);
 
-    DiskTableKeyIterator(rocksdb::DB* db, rocksdb::Iterator* it, const rocksdb::Snapshot* snapshot,
-                         ::openmldb::storage::TTLType ttl_type, const uint64_t& expire_time, const uint64_t& expire_cnt,
-                         rocksdb::ColumnFamilyHandle* column_handle);
+    DiskTableKeyIterator(rocksdb::DB* db, ::openmldb::storage::TTLType ttl_type, const uint64_t& expire_time,
+                         const uint64_t& expire_cnt, rocksdb::ColumnFamilyHandle* column_handle);
 
     ~DiskTableKeyIterator() override;
 
+    // the rows of the pk sought are got from the row cache of the table first
+    void SetRowCache(DiskTable* table, uint32_t idx) {
+        table_ = table;
+        idx_ = idx;
+    }
+
     void Seek(const std::string& pk) override;
 
     void SeekToFirst() override;
@@ -333,6 +387,10 @@ class DiskTableKeyIterator : public ::hybridse::vm::WindowIterator {
  private:
     void NextPK();
 
+    // the snapshot and the iterator are created at the first use, so a hit of row cache never reads rocksdb
+    void InitIterator();
+    void ReleaseIterator();
+
  private:
     rocksdb::DB* db_;
     rocksdb::Iterator* it_;
@@ -345,6 +403,10 @@ class DiskTableKeyIterator : public ::hybridse::vm::WindowIterator {
     uint64_t ts_;
     uint32_t ts_idx_;
     rocksdb::ColumnFamilyHandle* column_handle_;
+    DiskTable* table_;
+    uint32_t idx_;
+    // the rows of pk_ got from the row cache by Seek
+    std::shared_ptr<const CachedRows> cached_rows_;
 };
 
 class DiskTable : public Table {
@@ -402,7 +464,12 @@ class DiskTable : public Table {
 
     void SchedGc() override;
 
+    // delete the rows beyond the latest ttl by scanning the whole table
     void GcHead();
+    // drop the rows beyond the latest ttl by the full compaction of the inner indexs with the latest ttl. An
+    // index is compacted only if the rows put since its last exact one reach disk_table_gc_compaction_percent
+    // of it. The compaction with range deletions drops them, so the following one can be exact
+    void GcByCompaction();
     void GcTTLAndHead();
     void GcTTLOrHead();
 
@@ -425,6 +492,35 @@ class DiskTable : public Table {
 
     int GetCount(uint32_t index, const std::string& pk, uint64_t& count) override; // NOLINT
 
+    // the pks are sought in the key order with one iterator, so the seeks move forward
+    // and the data blocks loaded are reused by the following pks
+    bool BatchGet(uint32_t index, const std::vector<std::string>& pks, uint32_t limit,
+                  std::vector<std::vector<std::pair<uint64_t, std::string>>>* rows,
+                  std::vector<bool>* complete) override;
+
+    // the rows of pk got from the row cache, return null if the cache is disabled, pk is not cached
+    // or pk has more rows than the cache keeps. need_fill is set if pk is not cached
+    std::shared_ptr<const CachedRows> GetCachedRows(uint32_t idx, const std::string& pk, bool* need_fill);
+
+    // a fill of the row cache begins before the snapshot is taken, then FillRowCache reads the rows of pk
+    // through the snapshot and caches them, or EndFillRowCache ends it if pk is not found
+    uint64_t BeginFillRowCache(uint32_t idx, const std::string& pk);
+    std::shared_ptr<const CachedRows> FillRowCache(uint32_t idx, const std::string& pk, uint64_t version,
+                                                   const rocksdb::Snapshot* snapshot);
+    void EndFillRowCache(uint32_t idx, const std::string& pk);
+
+    void GetRowCacheStatus(::openmldb::api::RowCacheStatus* status);
+
+ private:
+    void InvalidateRowCache(uint32_t inner_pos, const std::string& pk);
+
+    bool BatchGet(uint32_t index, const std::vector<std::string>& pks, uint32_t limit,
+                  const rocksdb::Snapshot* snapshot, std::vector<std::vector<std::pair<uint64_t, std::string>>>* rows,
+                  std::vector<bool>* complete);
+
+    // if any range deletion is in the sst files of the inner index
+    bool HasRangeDelete(uint32_t inner_pos);
+
  private:
     rocksdb::DB* db_;
     rocksdb::WriteOptions write_opts_;
@@ -434,6 +530,15 @@ class DiskTable : public Table {
     KeyTSComparator cmp_;
     std::atomic<uint64_t> offset_;
     std::string table_path_;
+    std::shared_ptr<DiskRowCache> row_cache_;
+    // the id of the table in the row cache
+    uint64_t cache_id_;
+    std::atomic<uint64_t> row_cache_hit_cnt_;
+    std::atomic<uint64_t> row_cache_miss_cnt_;
+    // the compaction filter factory of each inner index
+    std::vector<std::shared_ptr<TTLFilterFactory>> filter_factories_;
+    // the offset when GcByCompaction compacted the inner index exactly last time, it's only used by the gc task
+    std::map<uint32_t, uint64_t> gc_offsets_;
 };
 
 }  // namespace storage
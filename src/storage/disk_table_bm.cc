@@ -0,0 +1,138 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gflags/gflags.h>
+
+#include <map>
+#include <string>
+
+#include "base/file_util.h"
+#include "benchmark/benchmark.h"
+#include "codec/schema_codec.h"
+#include "storage/disk_table.h"
+#include "storage/ticket.h"
+
+DECLARE_uint32(block_cache_mb);
+DEFINE_uint32(disk_table_bm_cache_mb, 64, "The block cache size of the disk table benchmark");
+DEFINE_uint32(disk_table_bm_data_ratio, 10, "The data size of each table is data_ratio times of the block cache");
+DEFINE_uint32(disk_table_bm_row_size, 1024, "The row size of the disk table benchmark");
+DEFINE_string(disk_table_bm_path, "/tmp/disk_table_bm", "The data path of the disk table benchmark");
+
+namespace openmldb {
+namespace storage {
+
+static const uint32_t ROWS_PER_KEY = 4;
+static const uint64_t BASE_TS = 1000;
+static const char* FILTER_POLICIES[] = {"none", "bloom", "ribbon"};
+
+// one table for each filter policy, which is loaded by the first benchmark using it
+static std::map<int64_t, DiskTable*> tables;
+
+static uint64_t GetKeyCnt() {
+    uint64_t data_size = static_cast<uint64_t>(FLAGS_disk_table_bm_cache_mb) * FLAGS_disk_table_bm_data_ratio << 20;
+    return data_size / FLAGS_disk_table_bm_row_size / ROWS_PER_KEY;
+}
+
+static DiskTable* GetTable(int64_t policy) {
+    auto iter = tables.find(policy);
+    if (iter != tables.end()) {
+        return iter->second;
+    }
+    ::openmldb::api::TableMeta table_meta;
+    table_meta.set_name("t" + std::to_string(policy));
+    table_meta.set_tid(policy + 1);
+    table_meta.set_pid(0);
+    table_meta.set_storage_mode(::openmldb::common::kSSD);
+    table_meta.set_format_version(1);
+    table_meta.mutable_disk_table_option()->set_filter_policy(FILTER_POLICIES[policy]);
+    ::openmldb::codec::SchemaCodec::SetColumnDesc(table_meta.add_column_desc(), "card", ::openmldb::type::kString);
+    ::openmldb::codec::SchemaCodec::SetColumnDesc(table_meta.add_column_desc(), "ts", ::openmldb::type::kBigInt);
+    ::openmldb::codec::SchemaCodec::SetIndex(table_meta.add_column_key(), "card", "card", "ts",
+                                             ::openmldb::type::kAbsoluteTime, 0, 0);
+    std::string table_path = FLAGS_disk_table_bm_path + "/" + std::to_string(policy);
+    ::openmldb::base::RemoveDirRecursive(table_path);
+    auto table = new DiskTable(table_meta, table_path);
+    if (!table->Init()) {
+        delete table;
+        return nullptr;
+    }
+    std::string value(FLAGS_disk_table_bm_row_size, 'a');
+    uint64_t key_cnt = GetKeyCnt();
+    for (uint64_t i = 0; i < key_cnt; i++) {
+        std::string pk = "card" + std::to_string(i);
+        for (uint32_t k = 0; k < ROWS_PER_KEY; k++) {
+            table->Put(pk, BASE_TS + k, value.c_str(), value.length());
+        }
+    }
+    // flush and compact the memtables, so the seeks go to the sst files
+    table->CompactDB();
+    tables.emplace(policy, table);
+    return table;
+}
+
+// seek one key of the table which is data_ratio times of the block cache,
+// range(0) selects the filter policy and range(1) selects hit or miss.
+// the absent keys are next to the existing ones, so they fall into the same data blocks
+static void BM_DiskTableSeek(benchmark::State& state) {  // NOLINT
+    DiskTable* table = GetTable(state.range(0));
+    if (table == nullptr) {
+        state.SkipWithError("fail to init disk table");
+        return;
+    }
+    bool hit = state.range(1) == 1;
+    uint64_t key_cnt = GetKeyCnt();
+    uint64_t found = 0;
+    Ticket ticket;
+    for (auto _ : state) {
+        std::string pk = "card" + std::to_string(rand() % key_cnt);  // NOLINT
+        if (!hit) {
+            pk.append("x");
+        }
+        TableIterator* it = table->NewIterator(0, pk, ticket);
+        it->Seek(BASE_TS + ROWS_PER_KEY - 1);
+        if (it->Valid()) {
+            found++;
+        }
+        delete it;
+    }
+    state.counters["found"] = found;
+    state.SetItemsProcessed(state.iterations());
+    state.SetLabel(FILTER_POLICIES[state.range(0)]);
+}
+
+BENCHMARK(BM_DiskTableSeek)
+    ->Args({0, 1})
+    ->Args({0, 0})
+    ->Args({1, 1})
+    ->Args({1, 0})
+    ->Args({2, 1})
+    ->Args({2, 0})
+    ->Unit(benchmark::kMicrosecond);
+
+}  // namespace storage
+}  // namespace openmldb
+
+int main(int argc, char** argv) {
+    ::benchmark::Initialize(&argc, argv);
+    ::google::ParseCommandLineFlags(&argc, &argv, true);
+    FLAGS_block_cache_mb = FLAGS_disk_table_bm_cache_mb;
+    ::benchmark::RunSpecifiedBenchmarks();
+    for (auto& kv : ::openmldb::storage::tables) {
+        delete kv.second;
+    }
+    ::openmldb::base::RemoveDirRecursive(FLAGS_disk_table_bm_path);
+    return 0;
+}
@@ -17,6 +17,7 @@
 #include "storage/disk_table.h"
 #include <gflags/gflags.h>
 #include <iostream>
+#include <memory>
 #include <utility>
 #include "base/file_util.h"
 #include "base/glog_wapper.h"  // NOLINT
@@ -33,6 +34,8 @@ DECLARE_string(ssd_root_path);
 DECLARE_string(hdd_root_path);
 DECLARE_uint32(max_traverse_cnt);
 DECLARE_int32(gc_safe_offset);
+DECLARE_uint32(disk_table_gc_compaction_percent);
+DECLARE_uint32(disk_table_row_cache_mb);
 
 namespace openmldb {
 namespace storage {
@@ -946,6 +949,148 @@ TEST_F(DiskTableTest, CompactFilterMulTs) {
     RemoveData(table_path);
 }
 
+TEST_F(DiskTableTest, CompactFilterLatest) {
+    ::openmldb::api::TableMeta table_meta;
+    table_meta.set_tid(19);
+    table_meta.set_pid(1);
+    table_meta.set_storage_mode(::openmldb::common::kHDD);
+    table_meta.set_format_version(1);
+    SchemaCodec::SetColumnDesc(table_meta.add_column_desc(), "card", ::openmldb::type::kString);
+    SchemaCodec::SetColumnDesc(table_meta.add_column_desc(), "mcc", ::openmldb::type::kString);
+    SchemaCodec::SetColumnDesc(table_meta.add_column_desc(), "addr", ::openmldb::type::kString);
+    SchemaCodec::SetColumnDesc(table_meta.add_column_desc(), "ts", ::openmldb::type::kBigInt);
+    SchemaCodec::SetIndex(table_meta.add_column_key(), "card", "card", "ts", ::openmldb::type::kLatestTime, 0, 3);
+    SchemaCodec::SetIndex(table_meta.add_column_key(), "mcc", "mcc", "ts", ::openmldb::type::kAbsAndLat, 10, 2);
+    SchemaCodec::SetIndex(table_meta.add_column_key(), "addr", "addr", "ts", ::openmldb::type::kAbsOrLat, 10, 2);
+
+    std::string table_path = FLAGS_hdd_root_path + "/19_1";
+    DiskTable* table = new DiskTable(table_meta, table_path);
+    ASSERT_TRUE(table->Init());
+    codec::SDKCodec codec(table_meta);
+    uint64_t cur_time = ::baidu::common::timer::get_micros() / 1000;
+    for (int idx = 0; idx < 100; idx++) {
+        Dimensions dims;
+        std::vector<std::string> keys = {"card" + std::to_string(idx), "mcc" + std::to_string(idx),
+                                         "addr" + std::to_string(idx)};
+        for (uint32_t i = 0; i < keys.size(); i++) {
+            ::openmldb::api::Dimension* dim = dims.Add();
+            dim->set_key(keys[i]);
+            dim->set_idx(i);
+        }
+        // 3 recent rows and 2 rows older than the abs ttl
+        for (int i = 0; i < 5; i++) {
+            uint64_t ts = i < 3 ? cur_time - i : cur_time - (20 + i) * 60 * 1000;
+            std::vector<std::string> row = {keys[0], keys[1], keys[2], std::to_string(ts)};
+            std::string value;
+            ASSERT_EQ(0, codec.EncodeRow(row, &value));
+            ASSERT_TRUE(table->Put(ts, value, dims));
+        }
+    }
+    auto count_rows = [&](uint32_t index, const std::string& pk) {
+        Ticket ticket;
+        TableIterator* it = table->NewIterator(index, pk, ticket);
+        it->SeekToFirst();
+        int cnt = 0;
+        for (; it->Valid(); it->Next()) {
+            cnt++;
+        }
+        delete it;
+        return cnt;
+    };
+    for (int idx = 0; idx < 100; idx++) {
+        ASSERT_EQ(5, count_rows(0, "card" + std::to_string(idx)));
+        ASSERT_EQ(5, count_rows(1, "mcc" + std::to_string(idx)));
+        ASSERT_EQ(5, count_rows(2, "addr" + std::to_string(idx)));
+    }
+    table->CompactDB();
+    for (int idx = 0; idx < 100; idx++) {
+        // latest 3
+        ASSERT_EQ(3, count_rows(0, "card" + std::to_string(idx)));
+        // the recent rows beyond the latest 2 are kept by the abs ttl
+        ASSERT_EQ(3, count_rows(1, "mcc" + std::to_string(idx)));
+        ASSERT_EQ(2, count_rows(2, "addr" + std::to_string(idx)));
+    }
+    // the rows are dropped by the gc without scanning the table
+    for (int i = 0; i < 5; i++) {
+        ASSERT_TRUE(table->Put("card0", cur_time + 10 + i, "value", 5));
+    }
+    table->SchedGc();
+    ASSERT_EQ(3, count_rows(0, "card0"));
+    delete table;
+    RemoveData(table_path);
+}
+
+TEST_F(DiskTableTest, CompactFilterNotFull) {
+    auto index = std::make_shared<IndexDef>("idx0", 0);
+    index->SetTTL(TTLSt(10 * 60 * 1000, 2, TTLType::kAbsOrLat));
+    auto inner_index = std::make_shared<InnerIndexSt>(0, std::vector<std::shared_ptr<IndexDef>>{index});
+    uint64_t cur_time = ::baidu::common::timer::get_micros() / 1000;
+    // 3 recent rows and 1 row older than the abs ttl
+    std::vector<uint64_t> ts_vec = {cur_time, cur_time - 1, cur_time - 2, cur_time - 20 * 60 * 1000};
+    auto filter_rows = [&](bool is_full_compaction) {
+        TTLCompactionFilter filter(inner_index, is_full_compaction);
+        std::vector<bool> dropped;
+        for (auto ts : ts_vec) {
+            dropped.push_back(filter.Filter(0, CombineKeyTs("key1", ts), "", nullptr, nullptr));
+        }
+        return dropped;
+    };
+    // all the rows of the key are merged in the full compaction, so the rows beyond the latest 2 are dropped
+    ASSERT_EQ(std::vector<bool>({false, false, true, true}), filter_rows(true));
+    // the newer rows counted may have been deleted, so the rows are dropped by the abs ttl only
+    ASSERT_EQ(std::vector<bool>({false, false, false, true}), filter_rows(false));
+
+    index->SetTTL(TTLSt(0, 2, TTLType::kLatestTime));
+    ASSERT_EQ(std::vector<bool>({false, false, true, true}), filter_rows(true));
+    ASSERT_EQ(std::vector<bool>({false, false, false, false}), filter_rows(false));
+}
+
+TEST_F(DiskTableTest, CompactFilterRangeDelete) {
+    FLAGS_disk_table_gc_compaction_percent = 0;
+    std::map<std::string, uint32_t> mapping;
+    mapping.insert(std::make_pair("idx0", 0));
+    std::string table_path = FLAGS_hdd_root_path + "/20_1";
+    DiskTable* table = new DiskTable("t1", 20, 1, mapping, 3, ::openmldb::type::TTLType::kLatestTime,
+                                     ::openmldb::common::StorageMode::kHDD, table_path);
+    ASSERT_TRUE(table->Init());
+    auto count_rows = [&]() {
+        Ticket ticket;
+        TableIterator* it = table->NewIterator("test", ticket);
+        it->SeekToFirst();
+        int cnt = 0;
+        for (; it->Valid(); it->Next()) {
+            cnt++;
+        }
+        delete it;
+        return cnt;
+    };
+    for (int k = 0; k < 5; k++) {
+        ASSERT_TRUE(table->Put("test", 100 + k, "value", 5));
+    }
+    ASSERT_TRUE(table->Delete("test", 0));
+    // the rows older than the deleted ones
+    ASSERT_TRUE(table->Put("test", 10, "value", 5));
+    ASSERT_TRUE(table->Put("test", 11, "value", 5));
+    ASSERT_EQ(2, count_rows());
+    // the deleted rows are passed to the filter, so they must not be counted
+    table->SchedGc();
+    ASSERT_EQ(2, count_rows());
+    // the range deletion has been dropped, the second round compacts exactly
+    table->SchedGc();
+    ASSERT_EQ(2, count_rows());
+    ASSERT_TRUE(table->Put("test", 12, "value", 5));
+    ASSERT_TRUE(table->Put("test", 13, "value", 5));
+    ASSERT_EQ(4, count_rows());
+    table->SchedGc();
+    ASSERT_EQ(3, count_rows());
+    std::string value;
+    ASSERT_FALSE(table->Get("test", 10, value));
+    ASSERT_TRUE(table->Get("test", 11, value));
+    FLAGS_disk_table_gc_compaction_percent = 50;
+    delete table;
+    RemoveData(table_path);
+}
+
 TEST_F(DiskTableTest, GcHeadMulTs) {
     ::openmldb::api::TableMeta table_meta;
     table_meta.set_tid(12);
@@ -1198,6 +1343,233 @@ TEST_F(DiskTableTest, CheckPoint) {
     RemoveData(table_path);
 }
 
+TEST_F(DiskTableTest, PrefixFilter) {
+    ::openmldb::api::TableMeta table_meta;
+    table_meta.set_tid(16);
+    table_meta.set_pid(1);
+    table_meta.set_storage_mode(::openmldb::common::kSSD);
+    table_meta.set_format_version(1);
+    table_meta.mutable_disk_table_option()->set_filter_policy("ribbon");
+    table_meta.mutable_disk_table_option()->set_filter_bits_per_key(12);
+    table_meta.mutable_disk_table_option()->set_block_size_kb(4);
+    SchemaCodec::SetColumnDesc(table_meta.add_column_desc(), "card", ::openmldb::type::kString);
+    SchemaCodec::SetColumnDesc(table_meta.add_column_desc(), "mcc", ::openmldb::type::kString);
+    SchemaCodec::SetColumnDesc(table_meta.add_column_desc(), "ts1", ::openmldb::type::kBigInt);
+    SchemaCodec::SetColumnDesc(table_meta.add_column_desc(), "ts2", ::openmldb::type::kBigInt);
+    SchemaCodec::SetIndex(table_meta.add_column_key(), "card", "card", "ts1", ::openmldb::type::kAbsoluteTime, 0, 0);
+    SchemaCodec::SetIndex(table_meta.add_column_key(), "card1", "card", "ts2", ::openmldb::type::kAbsoluteTime, 0, 0);
+    SchemaCodec::SetIndex(table_meta.add_column_key(), "mcc", "mcc", "ts2", ::openmldb::type::kAbsoluteTime, 0, 0);
+
+    std::string table_path = FLAGS_ssd_root_path + "/16_1";
+    DiskTable* table = new DiskTable(table_meta, table_path);
+    ASSERT_TRUE(table->Init());
+    codec::SDKCodec codec(table_meta);
+    for (int idx = 0; idx < 1000; idx++) {
+        Dimensions dims;
+        ::openmldb::api::Dimension* dim = dims.Add();
+        dim->set_key("card" + std::to_string(idx));
+        dim->set_idx(0);
+        ::openmldb::api::Dimension* dim1 = dims.Add();
+        dim1->set_key("card" + std::to_string(idx));
+        dim1->set_idx(1);
+        ::openmldb::api::Dimension* dim2 = dims.Add();
+        dim2->set_key("mcc" + std::to_string(idx));
+        dim2->set_idx(2);
+        for (int i = 0; i < 5; i++) {
+            std::vector<std::string> row = {"card" + std::to_string(idx), "mcc" + std::to_string(idx),
+                                            std::to_string(1000 + i), std::to_string(2000 + i)};
+            std::string value;
+            ASSERT_EQ(0, codec.EncodeRow(row, &value));
+            ASSERT_TRUE(table->Put(1000 + i, value, dims));
+        }
+    }
+    // the filters are built when the data is flushed to sst files
+    table->CompactDB();
+    Ticket ticket;
+    for (int idx = 0; idx < 1000; idx += 7) {
+        for (uint32_t index : {0, 1, 2}) {
+            std::string pk = (index == 2 ? "mcc" : "card") + std::to_string(idx);
+            uint64_t base_ts = index == 0 ? 1000 : 2000;
+            TableIterator* it = table->NewIterator(index, pk, ticket);
+            it->SeekToFirst();
+            for (int i = 4; i >= 0; i--) {
+                ASSERT_TRUE(it->Valid());
+                ASSERT_EQ(base_ts + i, it->GetKey());
+                it->Next();
+            }
+            ASSERT_FALSE(it->Valid());
+            it->Seek(base_ts + 2);
+            ASSERT_TRUE(it->Valid());
+            ASSERT_EQ(base_ts + 2, it->GetKey());
+            delete it;
+            uint64_t count = 0;
+            ASSERT_EQ(0, table->GetCount(index, pk, count));
+            ASSERT_EQ(5u, count);
+        }
+    }
+    for (uint32_t index : {0, 1, 2}) {
+        TableIterator* it = table->NewIterator(index, "absent_key", ticket);
+        it->SeekToFirst();
+        ASSERT_FALSE(it->Valid());
+        delete it;
+        uint64_t count = 0;
+        ASSERT_EQ(0, table->GetCount(index, "card1000", count));
+        ASSERT_EQ(0u, count);
+    }
+    delete table;
+
+    // invalid filter policy
+    table_meta.mutable_disk_table_option()->set_filter_policy("cuckoo");
+    table = new DiskTable(table_meta, table_path);
+    ASSERT_FALSE(table->Init());
+    delete table;
+    RemoveData(table_path);
+}
+
+TEST_F(DiskTableTest, BatchGet) {
+    std::map<std::string, uint32_t> mapping;
+    mapping.insert(std::make_pair("idx0", 0));
+    std::string table_path = FLAGS_hdd_root_path + "/18_1";
+    DiskTable* table = new DiskTable("t1", 18, 1, mapping, 3, ::openmldb::type::TTLType::kLatestTime,
+                                     ::openmldb::common::StorageMode::kHDD, table_path);
+    ASSERT_TRUE(table->Init());
+    for (int idx = 0; idx < 10; idx++) {
+        std::string key = "test" + std::to_string(idx);
+        for (int k = 0; k <= idx % 5; k++) {
+            std::string value = "value" + std::to_string(k);
+            ASSERT_TRUE(table->Put(key, 9537 + k, value.c_str(), value.length()));
+        }
+    }
+    std::vector<std::string> pks = {"test7", "test1", "absent", "test4", "test1", "test0"};
+    std::vector<std::vector<std::pair<uint64_t, std::string>>> rows;
+    std::vector<bool> complete;
+    ASSERT_TRUE(table->BatchGet(0, pks, 3, &rows, &complete));
+    ASSERT_EQ(pks.size(), rows.size());
+    ASSERT_EQ(pks.size(), complete.size());
+    // test7 has 3 rows and test4 has 5 rows, only the latest 3 rows are alive
+    for (int pos : {0, 3}) {
+        ASSERT_TRUE(complete[pos]);
+        ASSERT_EQ(3u, rows[pos].size());
+    }
+    ASSERT_EQ(9539u, rows[0][0].first);
+    ASSERT_EQ("value2", rows[0][0].second);
+    ASSERT_EQ(9537u, rows[0][2].first);
+    ASSERT_EQ(9541u, rows[3][0].first);
+    ASSERT_EQ("value4", rows[3][0].second);
+    ASSERT_EQ(9539u, rows[3][2].first);
+    for (int pos : {1, 4}) {
+        ASSERT_TRUE(complete[pos]);
+        ASSERT_EQ(2u, rows[pos].size());
+        ASSERT_EQ(9538u, rows[pos][0].first);
+        ASSERT_EQ("value1", rows[pos][0].second);
+        ASSERT_EQ(9537u, rows[pos][1].first);
+    }
+    ASSERT_TRUE(complete[2]);
+    ASSERT_TRUE(rows[2].empty());
+    ASSERT_TRUE(complete[5]);
+    ASSERT_EQ(1u, rows[5].size());
+
+    // the keys with more rows than the limit are incomplete
+    table->CompactDB();
+    ASSERT_TRUE(table->BatchGet(0, pks, 2, &rows, &complete));
+    ASSERT_FALSE(complete[0]);
+    ASSERT_FALSE(complete[3]);
+    ASSERT_TRUE(complete[1]);
+    ASSERT_EQ(2u, rows[1].size());
+    ASSERT_TRUE(complete[5]);
+    ASSERT_FALSE(table->BatchGet(1, pks, 2, &rows, &complete));
+    delete table;
+    RemoveData(table_path);
+}
+
+// the count of rows of pk read by a point lookup of the window iterator, -1 if pk is not found
+int GetWindowRowCnt(DiskTable* table, const std::string& pk, uint64_t* first_ts) {
+    std::unique_ptr<::hybridse::vm::WindowIterator> key_it(table->NewWindowIterator(0));
+    key_it->Seek(pk);
+    if (!key_it->Valid() || key_it->GetKey().ToString() != pk) {
+        return -1;
+    }
+    auto row_it = key_it->GetValue();
+    row_it->SeekToFirst();
+    int cnt = 0;
+    for (; row_it->Valid(); row_it->Next()) {
+        if (cnt == 0) {
+            *first_ts = row_it->GetKey();
+        }
+        cnt++;
+    }
+    return cnt;
+}
+
+TEST_F(DiskTableTest, RowCache) {
+    std::map<std::string, uint32_t> mapping;
+    mapping.insert(std::make_pair("idx0", 0));
+    std::string table_path = FLAGS_hdd_root_path + "/21_1";
+    DiskTable* table = new DiskTable("t1", 21, 1, mapping, 3, ::openmldb::type::TTLType::kLatestTime,
+                                     ::openmldb::common::StorageMode::kHDD, table_path);
+    ASSERT_TRUE(table->Init());
+    for (int k = 0; k < 3; k++) {
+        std::string value = "value" + std::to_string(k);
+        ASSERT_TRUE(table->Put("key1", 9537 + k, value.c_str(), value.length()));
+        ASSERT_TRUE(table->Put("key2", 9537 + k, value.c_str(), value.length()));
+    }
+    ::openmldb::api::RowCacheStatus status;
+    uint64_t first_ts = 0;
+    // the first lookup fills the cache and the second one is served by it
+    ASSERT_EQ(3, GetWindowRowCnt(table, "key1", &first_ts));
+    ASSERT_EQ(9539u, first_ts);
+    ASSERT_EQ(3, GetWindowRowCnt(table, "key1", &first_ts));
+    table->GetRowCacheStatus(&status);
+    ASSERT_EQ(1u, status.hit_cnt());
+    ASSERT_EQ(1u, status.miss_cnt());
+
+    // the traverse of the window iterator neither reads nor fills the cache
+    {
+        std::unique_ptr<::hybridse::vm::WindowIterator> key_it(table->NewWindowIterator(0));
+        int key_cnt = 0;
+        for (key_it->SeekToFirst(); key_it->Valid(); key_it->Next()) {
+            key_cnt++;
+        }
+        ASSERT_EQ(2, key_cnt);
+    }
+    table->GetRowCacheStatus(&status);
+    ASSERT_EQ(1u, status.hit_cnt());
+    ASSERT_EQ(1u, status.miss_cnt());
+
+    // a put drops the cached rows of the key only
+    ASSERT_EQ(3, GetWindowRowCnt(table, "key2", &first_ts));
+    ASSERT_TRUE(table->Put("key1", 9540, "value3", 6));
+    ASSERT_EQ(3, GetWindowRowCnt(table, "key1", &first_ts));
+    ASSERT_EQ(9540u, first_ts);
+    ASSERT_EQ(3, GetWindowRowCnt(table, "key2", &first_ts));
+    ASSERT_EQ(9539u, first_ts);
+    table->GetRowCacheStatus(&status);
+    ASSERT_EQ(2u, status.hit_cnt());
+    ASSERT_EQ(3u, status.miss_cnt());
+
+    // the cached rows are dropped when the ttl is updated
+    ASSERT_EQ(3, GetWindowRowCnt(table, "key1", &first_ts));
+    ::openmldb::storage::UpdateTTLMeta update_ttl(TTLSt(0, 5, ::openmldb::storage::kLatestTime));
+    table->SetTTL(update_ttl);
+    table->SchedGc();
+    std::vector<std::vector<std::pair<uint64_t, std::string>>> rows;
+    std::vector<bool> complete;
+    ASSERT_TRUE(table->BatchGet(0, {"key1"}, 10, &rows, &complete));
+    ASSERT_EQ(static_cast<int>(rows[0].size()), GetWindowRowCnt(table, "key1", &first_ts));
+    ASSERT_EQ(9540u, first_ts);
+    table->GetRowCacheStatus(&status);
+    ASSERT_EQ(3u, status.hit_cnt());
+    ASSERT_EQ(4u, status.miss_cnt());
+
+    // a delete drops the cached rows
+    ASSERT_EQ(static_cast<int>(rows[0].size()), GetWindowRowCnt(table, "key1", &first_ts));
+    ASSERT_TRUE(table->Delete("key1", 0));
+    ASSERT_EQ(-1, GetWindowRowCnt(table, "key1", &first_ts));
+    ASSERT_EQ(3, GetWindowRowCnt(table, "key2", &first_ts));
+    delete table;
+    RemoveData(table_path);
+}
+
 }  // namespace storage
 }  // namespace openmldb
 
@@ -1206,6 +1578,7 @@ int main(int argc, char** argv) {
     ::openmldb::base::SetLogLevel(INFO);
     FLAGS_hdd_root_path = "/tmp/" + std::to_string(::openmldb::storage::GenRand());
     FLAGS_ssd_root_path = "/tmp/" + std::to_string(::openmldb::storage::GenRand());
+    FLAGS_disk_table_row_cache_mb = 16;
     // FLAGS_hdd_root_path = "/tmp/1";
     // FLAGS_ssd_root_path = "/tmp/1";
     return RUN_ALL_TESTS();
@@ -32,6 +32,11 @@ DECLARE_uint32(key_entry_max_height);
 DECLARE_uint32(absolute_default_skiplist_height);
 DECLARE_uint32(latest_default_skiplist_height);
 DECLARE_uint32(max_traverse_cnt);
+DECLARE_string(memory_compression);
+DECLARE_uint32(memory_compression_min_size);
+DECLARE_uint32(hot_data_ttl);
+DECLARE_string(cold_tier_root_path);
+DECLARE_uint32(spill_max_rows);
 
 namespace openmldb {
 namespace storage {
@@ -47,7 +52,8 @@ MemTable::MemTable(const std::string& name, uint32_t id, uint32_t pid, uint32_t
       enable_gc_(true),
       record_cnt_(0),
       segment_released_(false),
-      record_byte_size_(0) {}
+      record_byte_size_(0),
+      compress_row_(FLAGS_memory_compression == "snappy") {}
 
 MemTable::MemTable(const ::openmldb::api::TableMeta& table_meta)
     : Table(table_meta.storage_mode(), table_meta.name(), table_meta.tid(), table_meta.pid(), 0, true, 60 * 1000,
@@ -59,6 +65,7 @@ MemTable::MemTable(const ::openmldb::api::TableMeta& table_meta)
     record_cnt_ = 0;
     segment_released_ = false;
     record_byte_size_ = 0;
+    compress_row_ = FLAGS_memory_compression == "snappy";
     diskused_ = 0;
     table_meta_ = std::make_shared<::openmldb::api::TableMeta>(table_meta);
 }
@@ -107,18 +114,28 @@ bool MemTable::Init() {
         if (!ts_vec.empty()) {
             for (uint32_t j = 0; j < seg_cnt_; j++) {
                 seg_arr[j] = new Segment(cur_key_entry_max_height, ts_vec);
+                seg_arr[j]->SetCompressStat(&compress_stat_);
                 PDLOG(INFO, "init %u, %u segment. height %u, ts col num %u. tid %u pid %u", i, j,
                       cur_key_entry_max_height, ts_vec.size(), id_, pid_);
             }
         } else {
             for (uint32_t j = 0; j < seg_cnt_; j++) {
                 seg_arr[j] = new Segment(cur_key_entry_max_height);
+                seg_arr[j]->SetCompressStat(&compress_stat_);
                 PDLOG(INFO, "init %u, %u segment. height %u tid %u pid %u", i, j, cur_key_entry_max_height, id_, pid_);
             }
         }
         segments_[i] = seg_arr;
         key_entry_max_height_ = cur_key_entry_max_height;
     }
+    if (FLAGS_hot_data_ttl > 0) {
+        std::string path = FLAGS_cold_tier_root_path + "/" + std::to_string(id_) + "_" + std::to_string(pid_);
+        cold_tier_.reset(new ColdTier(id_, pid_, path));
+        if (!cold_tier_->Init(*inner_indexs)) {
+            PDLOG(WARNING, "init cold tier failed. tid %u pid %u", id_, pid_);
+            return false;
+        }
+    }
     PDLOG(INFO, "init table name %s, id %d, pid %d, seg_cnt %d", name_.c_str(), id_, pid_, seg_cnt_);
     return true;
 }
@@ -135,7 +152,11 @@ bool MemTable::Put(const std::string& pk, uint64_t time, const char* data, uint3
     }
     Segment* segment = segments_[0][index];
     Slice spk(pk);
-    segment->Put(spk, time, data, size);
+    if (segment->GetTsCnt() == 1) {
+        auto* block = NewDataBlock(1, data, size);
+        segment->Put(spk, time, block);
+        size = block->size;
+    }
     record_cnt_.fetch_add(1, std::memory_order_relaxed);
     record_byte_size_.fetch_add(GetRecordSize(size));
     return true;
@@ -194,7 +215,39 @@ bool MemTable::Put(uint64_t time, const std::string& value, const Dimensions& di
     if (ts_map.empty()) {
         return false;
     }
-    auto* block = new DataBlock(real_ref_cnt, value.c_str(), value.length());
+    PutToSegments(inner_index_key_map, ts_map, real_ref_cnt, value.c_str(), value.length());
+    return true;
+}
+
+bool MemTable::GetTsMap(uint64_t time, const Slice& value, std::map<int32_t, uint64_t>* ts_map) {
+    if (value.size() < codec::HEADER_LENGTH) {
+        return false;
+    }
+    const int8_t* data = reinterpret_cast<const int8_t*>(value.data());
+    auto decoder = GetVersionDecoder(codec::RowView::GetSchemaVersion(data));
+    if (decoder == nullptr) {
+        return false;
+    }
+    for (const auto& index_def : table_index_.GetAllIndex()) {
+        auto ts_col = index_def->GetTsColumn();
+        if (!ts_col || index_def->GetStatus() == IndexStatus::kDeleted) {
+            continue;
+        }
+        int64_t ts = 0;
+        if (ts_col->IsAutoGenTs()) {
+            ts = time;
+        } else if (decoder->GetInteger(data, ts_col->GetId(), ts_col->GetType(), &ts) != 0) {
+            return false;
+        }
+        ts_map->emplace(ts_col->GetId(), ts);
+    }
+    return true;
+}
+
+void MemTable::PutToSegments(const std::map<int32_t, Slice>& inner_index_key_map,
+                             const std::map<int32_t, uint64_t>& ts_map, uint32_t real_ref_cnt, const char* data,
+                             uint32_t size) {
+    auto* block = NewDataBlock(real_ref_cnt, data, size);
     for (const auto& kv : inner_index_key_map) {
         auto inner_index = table_index_.GetInnerIndex(kv.first);
         bool need_put = false;
@@ -215,8 +268,19 @@ bool MemTable::Put(uint64_t time, const std::string& value, const Dimensions& di
         }
     }
     record_cnt_.fetch_add(1, std::memory_order_relaxed);
-    record_byte_size_.fetch_add(GetRecordSize(value.length()));
-    return true;
+    record_byte_size_.fetch_add(GetRecordSize(block->size));
+}
+
+DataBlock* MemTable::NewDataBlock(uint8_t dim_cnt, const char* data, uint32_t size) {
+    // the rows of snappy table are compressed by client already
+    if (compress_row_ && compress_type_ == ::openmldb::type::kNoCompress &&
+        size >= FLAGS_memory_compression_min_size) {
+        DataBlock* block = DataBlock::NewCompressed(dim_cnt, data, size, &compress_stat_);
+        if (block != NULL) {
+            return block;
+        }
+    }
+    return DataBlock::NewInline(dim_cnt, data, size);
 }
 
 bool MemTable::Delete(const std::string& pk, uint32_t idx) {
@@ -231,6 +295,9 @@ bool MemTable::Delete(const std::string& pk, uint32_t idx) {
     }
     uint32_t real_idx = index_def->GetInnerPos();
     Segment* segment = segments_[real_idx][seg_idx];
+    if (cold_tier_ && !cold_tier_->Delete(real_idx, pk)) {
+        return false;
+    }
     return segment->Delete(spk);
 }
 
@@ -254,14 +321,29 @@ uint64_t MemTable::Release() {
     return total_cnt;
 }
 
-void MemTable::SchedGc() {
+void MemTable::SchedGc() { SchedGcStep(0, 0); }
+
+bool MemTable::SchedGcStep(uint64_t max_keys, uint64_t max_time_us) {
+    std::lock_guard<std::mutex> lock(gc_mu_);
     uint64_t consumed = ::baidu::common::timer::get_micros();
-    PDLOG(INFO, "start making gc for table %s, tid %u, pid %u", name_.c_str(), id_, pid_);
+    uint64_t deadline = max_time_us > 0 ? consumed + max_time_us : 0;
+    if (spill_in_progress_) {
+        // the gc of this round is finished, continue the spill stopped by the last step
+        return SpillColdData(max_keys, deadline);
+    }
+    if (gc_index_pos_ == 0 && gc_seg_pos_ == 0 && !gc_index_entered_) {
+        PDLOG(INFO, "start making gc for table %s, tid %u, pid %u", name_.c_str(), id_, pid_);
+        gc_round_start_time_ = consumed;
+        gc_round_idx_cnt_ = 0;
+        gc_round_record_cnt_ = 0;
+    }
     uint64_t gc_idx_cnt = 0;
     uint64_t gc_record_cnt = 0;
     uint64_t gc_record_byte_size = 0;
+    bool finished = true;
     auto inner_indexs = table_index_.GetAllInnerIndex();
-    for (uint32_t i = 0; i < inner_indexs->size(); i++) {
+    for (; gc_index_pos_ < inner_indexs->size(); gc_index_pos_++, gc_seg_pos_ = 0, gc_index_entered_ = false) {
+        uint32_t i = gc_index_pos_;
         const std::vector<std::shared_ptr<IndexDef>>& real_index = inner_indexs->at(i)->GetIndex();
         std::map<uint32_t, TTLSt> ttl_st_map;
         bool need_gc = true;
@@ -274,6 +356,10 @@ void MemTable::SchedGc() {
             } else {
                 ttl_st_map.emplace(0, *(cur_index->GetTTL()));
             }
+            // the index status changes once a round, skip it if the index is resumed by the next step
+            if (gc_index_entered_) {
+                continue;
+            }
             if (cur_index->GetStatus() == IndexStatus::kWaiting) {
                 cur_index->SetStatus(IndexStatus::kDeleting);
                 need_gc = false;
@@ -293,35 +379,184 @@ void MemTable::SchedGc() {
                 deleted_num++;
             }
         }
+        gc_index_entered_ = true;
         if (!enable_gc_.load(std::memory_order_relaxed) || !need_gc) {
             continue;
         }
         if (deleted_num == real_index.size() || ttl_st_map.empty()) {
             continue;
         }
-        for (uint32_t j = 0; j < seg_cnt_; j++) {
+        for (; gc_seg_pos_ < seg_cnt_; gc_seg_pos_++) {
+            uint32_t j = gc_seg_pos_;
+            if (deadline > 0 && ::baidu::common::timer::get_micros() >= deadline) {
+                finished = false;
+                break;
+            }
             uint64_t seg_gc_time = ::baidu::common::timer::get_micros() / 1000;
             Segment* segment = segments_[i][j];
-            segment->IncrGcVersion();
-            segment->GcFreeList(gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+            if (!segment->IsGcInProgress()) {
+                segment->IncrGcVersion();
+                segment->GcFreeList(gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+            }
+            segment->SetGcLimit(max_keys, deadline);
             if (ttl_st_map.size() == 1) {
                 segment->ExecuteGc(ttl_st_map.begin()->second, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
             } else {
                 segment->ExecuteGc(ttl_st_map, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
             }
+            if (segment->IsGcInProgress()) {
+                finished = false;
+                break;
+            }
             seg_gc_time = ::baidu::common::timer::get_micros() / 1000 - seg_gc_time;
             PDLOG(INFO, "gc segment[%u][%u] done consumed %lu for table %s tid %u pid %u", i, j, seg_gc_time,
                   name_.c_str(), id_, pid_);
         }
+        if (!finished) {
+            break;
+        }
     }
     consumed = ::baidu::common::timer::get_micros() - consumed;
     record_cnt_.fetch_sub(gc_record_cnt, std::memory_order_relaxed);
     record_byte_size_.fetch_sub(gc_record_byte_size, std::memory_order_relaxed);
+    gc_round_idx_cnt_ += gc_idx_cnt;
+    gc_round_record_cnt_ += gc_record_cnt;
+    gc_step_cnt_.fetch_add(1, std::memory_order_relaxed);
+    gc_idx_cnt_.fetch_add(gc_idx_cnt, std::memory_order_relaxed);
+    gc_record_cnt_.fetch_add(gc_record_cnt, std::memory_order_relaxed);
+    gc_consumed_time_.fetch_add(consumed, std::memory_order_relaxed);
+    if (!finished) {
+        uint64_t seg_total = inner_indexs->size() * seg_cnt_;
+        gc_progress_.store(seg_total == 0 ? 0 : (gc_index_pos_ * seg_cnt_ + gc_seg_pos_) * 100 / seg_total,
+                           std::memory_order_relaxed);
+        DEBUGLOG("gc step stopped at segment[%u][%u], gc_idx_cnt %lu, consumed %lu us for table %s tid %u pid %u",
+                 gc_index_pos_, gc_seg_pos_, gc_idx_cnt, consumed, name_.c_str(), id_, pid_);
+        return false;
+    }
+    gc_index_pos_ = 0;
+    gc_seg_pos_ = 0;
+    gc_index_entered_ = false;
+    gc_progress_.store(0, std::memory_order_relaxed);
+    gc_round_cnt_.fetch_add(1, std::memory_order_relaxed);
+    uint64_t round_time = (::baidu::common::timer::get_micros() - gc_round_start_time_) / 1000;
+    gc_last_round_time_.store(round_time, std::memory_order_relaxed);
     PDLOG(INFO,
           "gc finished, gc_idx_cnt %lu, gc_record_cnt %lu consumed %lu ms for "
           "table %s tid %u pid %u",
-          gc_idx_cnt, gc_record_cnt, consumed / 1000, name_.c_str(), id_, pid_);
+          gc_round_idx_cnt_, gc_round_record_cnt_, round_time, name_.c_str(), id_, pid_);
     UpdateTTL();
+    spill_round_rows_ = 0;
+    return SpillColdData(max_keys, deadline);
+}
+
+bool MemTable::IsSpillable(uint32_t inner_pos) {
+    if (!cold_tier_ || inner_pos >= cold_tier_->GetInnerCnt()) {
+        return false;
+    }
+    auto inner_index = table_index_.GetInnerIndex(inner_pos);
+    if (!inner_index || inner_index->GetIndex().size() != 1) {
+        return false;
+    }
+    auto index_def = inner_index->GetIndex().front();
+    return index_def->IsReady() && index_def->GetTTLType() == ::openmldb::storage::TTLType::kAbsoluteTime;
+}
+
+bool MemTable::SpillColdData(uint64_t max_keys, uint64_t deadline_us) {
+    spill_in_progress_ = false;
+    if (!cold_tier_ || !enable_gc_.load(std::memory_order_relaxed) || segments_.empty()) {
+        return true;
+    }
+    uint64_t consumed = ::baidu::common::timer::get_micros();
+    uint64_t hot_time = consumed / 1000 - static_cast<uint64_t>(FLAGS_hot_data_ttl) * 60 * 1000;
+    uint64_t spill_idx_cnt = 0;
+    uint64_t spill_record_cnt = 0;
+    uint64_t spill_record_byte_size = 0;
+    bool stopped = false;
+    uint32_t inner_cnt = table_index_.GetAllInnerIndex()->size();
+    for (; spill_index_pos_ < inner_cnt; spill_index_pos_++, spill_seg_pos_ = 0) {
+        uint32_t i = spill_index_pos_;
+        if (!IsSpillable(i) || segments_[i] == NULL) {
+            continue;
+        }
+        uint64_t expire_time = GetExpireTime(*(table_index_.GetInnerIndex(i)->GetIndex().front()->GetTTL()));
+        // the rows will be removed by gc before they are read from cold tier
+        if (expire_time > 0 && hot_time <= expire_time) {
+            continue;
+        }
+        ColdTierWriter writer(cold_tier_.get(), i, expire_time);
+        for (; spill_seg_pos_ < seg_cnt_; spill_seg_pos_++) {
+            uint64_t max_rows = 0;
+            if (FLAGS_spill_max_rows > 0) {
+                if (spill_round_rows_ + spill_idx_cnt >= FLAGS_spill_max_rows) {
+                    stopped = true;
+                    break;
+                }
+                max_rows = FLAGS_spill_max_rows - spill_round_rows_ - spill_idx_cnt;
+            }
+            Segment* segment = segments_[i][spill_seg_pos_];
+            segment->Spill(hot_time, &writer, max_keys, max_rows, deadline_us, spill_idx_cnt, spill_record_cnt,
+                           spill_record_byte_size);
+            if (segment->IsSpillInProgress()) {
+                stopped = true;
+                break;
+            }
+        }
+        if (stopped) {
+            break;
+        }
+    }
+    spill_round_rows_ += spill_idx_cnt;
+    if (!stopped) {
+        spill_index_pos_ = 0;
+        spill_seg_pos_ = 0;
+        spill_round_cnt_.fetch_add(1, std::memory_order_relaxed);
+    }
+    // the position is kept for the next gc round if the round reaches spill_max_rows
+    bool finished = !stopped || (FLAGS_spill_max_rows > 0 && spill_round_rows_ >= FLAGS_spill_max_rows);
+    spill_in_progress_ = !finished;
+    consumed = ::baidu::common::timer::get_micros() - consumed;
+    record_cnt_.fetch_sub(spill_record_cnt, std::memory_order_relaxed);
+    record_byte_size_.fetch_sub(spill_record_byte_size, std::memory_order_relaxed);
+    spill_record_cnt_.fetch_add(spill_record_cnt, std::memory_order_relaxed);
+    spill_consumed_time_.fetch_add(consumed, std::memory_order_relaxed);
+    if (!finished) {
+        DEBUGLOG("spill step stopped at segment[%u][%u], spill_idx_cnt %lu, consumed %lu us for table %s tid %u pid %u",
+                 spill_index_pos_, spill_seg_pos_, spill_idx_cnt, consumed, name_.c_str(), id_, pid_);
+        return false;
+    }
+    PDLOG(INFO, "spill finished, spill_idx_cnt %lu of the round, consumed %lu ms for table %s tid %u pid %u",
+          spill_round_rows_, consumed / 1000, name_.c_str(), id_, pid_);
+    return true;
+}
+
+void MemTable::GetColdTierStatus(::openmldb::api::ColdTierStatus* status) {
+    if (!cold_tier_) {
+        return;
+    }
+    status->set_round_cnt(spill_round_cnt_.load(std::memory_order_relaxed));
+    status->set_spill_record_cnt(spill_record_cnt_.load(std::memory_order_relaxed));
+    status->set_consumed_time(spill_consumed_time_.load(std::memory_order_relaxed));
+    status->set_record_cnt(cold_tier_->GetRecordCnt());
+}
+
+void MemTable::GetCompressStatus(::openmldb::api::CompressStatus* status) {
+    status->set_record_cnt(compress_stat_.record_cnt.load(std::memory_order_relaxed));
+    status->set_saved_byte_size(compress_stat_.saved_byte_size.load(std::memory_order_relaxed));
+    uint64_t sampled_cnt = compress_stat_.sampled_decode_cnt.load(std::memory_order_relaxed);
+    if (sampled_cnt > 0) {
+        status->set_decode_time_per_row(compress_stat_.sampled_decode_time.load(std::memory_order_relaxed) /
+                                        sampled_cnt);
+    }
+}
+
+void MemTable::GetGcStatus(::openmldb::api::GcStatus* status) {
+    status->set_round_cnt(gc_round_cnt_.load(std::memory_order_relaxed));
+    status->set_step_cnt(gc_step_cnt_.load(std::memory_order_relaxed));
+    status->set_progress(gc_progress_.load(std::memory_order_relaxed));
+    status->set_gc_idx_cnt(gc_idx_cnt_.load(std::memory_order_relaxed));
+    status->set_gc_record_cnt(gc_record_cnt_.load(std::memory_order_relaxed));
+    status->set_consumed_time(gc_consumed_time_.load(std::memory_order_relaxed));
+    status->set_last_round_time(gc_last_round_time_.load(std::memory_order_relaxed));
 }
 
 // tll as ms
@@ -458,10 +693,16 @@ TableIterator* MemTable::NewIterator(uint32_t index, const std::string& pk, Tick
     uint32_t real_idx = index_def->GetInnerPos();
     Segment* segment = segments_[real_idx][seg_idx];
     auto ts_col = index_def->GetTsColumn();
+    TableIterator* it = NULL;
     if (ts_col) {
-        return segment->NewIterator(spk, ts_col->GetId(), ticket);
+        it = segment->NewIterator(spk, ts_col->GetId(), ticket);
+    } else {
+        it = segment->NewIterator(spk, ticket);
+    }
+    if (cold_tier_ && segment->GetTsCnt() == 1 && cold_tier_->HasData(real_idx)) {
+        return new TieredTableIterator(it, cold_tier_->NewIterator(real_idx, pk));
     }
-    return segment->NewIterator(spk, ticket);
+    return it;
 }
 
 uint64_t MemTable::GetRecordIdxByteSize() {
@@ -591,6 +832,7 @@ bool MemTable::AddIndex(const ::openmldb::common::ColumnKey& column_key) {
         Segment** seg_arr = new Segment*[seg_cnt_];
         for (uint32_t j = 0; j < seg_cnt_; j++) {
             seg_arr[j] = new Segment(FLAGS_absolute_default_skiplist_height, ts_vec);
+            seg_arr[j]->SetCompressStat(&compress_stat_);
             PDLOG(INFO, "init %u, %u segment. height %u, ts col num %u. tid %u pid %u", inner_id, j,
                   FLAGS_absolute_default_skiplist_height, ts_vec.size(), id_, pid_);
         }
@@ -667,7 +909,8 @@ bool MemTable::DeleteIndex(const std::string& idx_name) {
     if (ts_col) {
         ts_idx = ts_col->GetId();
     }
-    return new MemTableKeyIterator(segments_[real_idx], seg_cnt_, ttl->ttl_type, expire_time, expire_cnt, ts_idx);
+    return new MemTableKeyIterator(segments_[real_idx], seg_cnt_, ttl->ttl_type, expire_time, expire_cnt, ts_idx,
+                                   cold_tier_.get(), real_idx);
 }
 
 TraverseIterator* MemTable::NewTraverseIterator(uint32_t index) {
@@ -687,9 +930,10 @@ TraverseIterator* MemTable::NewTraverseIterator(uint32_t index) {
     auto ts_col = index_def->GetTsColumn();
     if (ts_col) {
         return new MemTableTraverseIterator(segments_[real_idx], seg_cnt_, ttl->ttl_type, expire_time, expire_cnt,
-                                            ts_col->GetId());
+                                            ts_col->GetId(), cold_tier_.get(), real_idx);
     }
-    return new MemTableTraverseIterator(segments_[real_idx], seg_cnt_, ttl->ttl_type, expire_time, expire_cnt, 0);
+    return new MemTableTraverseIterator(segments_[real_idx], seg_cnt_, ttl->ttl_type, expire_time, expire_cnt, 0,
+                                        cold_tier_.get(), real_idx);
 }
 
 bool MemTable::GetBulkLoadInfo(::openmldb::api::BulkLoadInfoResponse* response) {
@@ -777,7 +1021,8 @@ bool MemTable::BulkLoad(const std::vector<DataBlock*>& data_blocks,
 }
 
 MemTableKeyIterator::MemTableKeyIterator(Segment** segments, uint32_t seg_cnt, ::openmldb::storage::TTLType ttl_type,
-                                         uint64_t expire_time, uint64_t expire_cnt, uint32_t ts_index)
+                                         uint64_t expire_time, uint64_t expire_cnt, uint32_t ts_index,
+                                         ColdTier* cold_tier, uint32_t inner_pos)
     : segments_(segments),
       seg_cnt_(seg_cnt),
       seg_idx_(0),
@@ -787,7 +1032,9 @@ MemTableKeyIterator::MemTableKeyIterator(Segment** segments, uint32_t seg_cnt, :
       expire_time_(expire_time),
       expire_cnt_(expire_cnt),
       ticket_(),
-      ts_idx_(0) {
+      ts_idx_(0),
+      cold_tier_(cold_tier),
+      inner_pos_(inner_pos) {
     uint32_t idx = 0;
     if (segments_[0]->GetTsIdx(ts_index, idx) == 0) {
         ts_idx_ = idx;
@@ -849,7 +1096,15 @@ void MemTableKeyIterator::Next() { NextPK(); }
         ticket_.Push((KeyEntry*)pk_it_->GetValue());  // NOLINT
     }
     it->SeekToFirst();
-    return new MemTableWindowIterator(it, ttl_type_, expire_time_, expire_cnt_);
+    auto hot_it = new MemTableWindowIterator(it, ttl_type_, expire_time_, expire_cnt_,
+                                             segments_[seg_idx_]->GetCompressStat());
+    if (cold_tier_ != NULL && segments_[seg_idx_]->GetTsCnt() == 1 && cold_tier_->HasData(inner_pos_)) {
+        auto cold_it = cold_tier_->NewIterator(inner_pos_, pk_it_->GetKey().ToString());
+        auto tiered_it = new TieredWindowIterator(hot_it, cold_it, ttl_type_, expire_time_, expire_cnt_);
+        tiered_it->SeekToFirst();
+        return tiered_it;
+    }
+    return hot_it;
 }
 
 std::unique_ptr<::hybridse::vm::RowIterator> MemTableKeyIterator::GetValue() {
@@ -886,7 +1141,8 @@ void MemTableKeyIterator::NextPK() {
 
 MemTableTraverseIterator::MemTableTraverseIterator(Segment** segments, uint32_t seg_cnt,
                                                    ::openmldb::storage::TTLType ttl_type, uint64_t expire_time,
-                                                   uint64_t expire_cnt, uint32_t ts_index)
+                                                   uint64_t expire_cnt, uint32_t ts_index, ColdTier* cold_tier,
+                                                   uint32_t inner_pos)
     : segments_(segments),
       seg_cnt_(seg_cnt),
       seg_idx_(0),
@@ -896,7 +1152,10 @@ MemTableTraverseIterator::MemTableTraverseIterator(Segment** segments, uint32_t
       ts_idx_(0),
       expire_value_(expire_time, expire_cnt, ttl_type),
       ticket_(),
-      traverse_cnt_(0) {
+      traverse_cnt_(0),
+      compress_stat_(segments[0]->GetCompressStat()),
+      cold_tier_(cold_tier),
+      inner_pos_(inner_pos) {
     uint32_t idx = 0;
     if (segments_[0]->GetTsIdx(ts_index, idx) == 0) {
         ts_idx_ = idx;
@@ -924,6 +1183,14 @@ void MemTableTraverseIterator::Next() {
 }
 uint64_t MemTableTraverseIterator::GetCount() const { return traverse_cnt_; }
 
+TableIterator* MemTableTraverseIterator::NewKeyIterator(KeyEntry* entry) {
+    TableIterator* it = new MemTableIterator(entry->entries.NewIterator(), compress_stat_);
+    if (cold_tier_ != NULL && segments_[seg_idx_]->GetTsCnt() == 1 && cold_tier_->HasData(inner_pos_)) {
+        it = new TieredTableIterator(it, cold_tier_->NewIterator(inner_pos_, pk_it_->GetKey().ToString()));
+    }
+    return it;
+}
+
 void MemTableTraverseIterator::NextPK() {
     delete it_;
     it_ = NULL;
@@ -952,12 +1219,11 @@ void MemTableTraverseIterator::NextPK() {
         }
         if (segments_[seg_idx_]->GetTsCnt() > 1) {
             KeyEntry* entry = ((KeyEntry**)pk_it_->GetValue())[0];  // NOLINT
-            it_ = entry->entries.NewIterator();
+            it_ = NewKeyIterator(entry);
             ticket_.Push(entry);
         } else {
-            it_ = ((KeyEntry*)pk_it_->GetValue())  // NOLINT
-                      ->entries.NewIterator();
-            ticket_.Push((KeyEntry*)pk_it_->GetValue());  // NOLINT
+            it_ = NewKeyIterator((KeyEntry*)pk_it_->GetValue());  // NOLINT
+            ticket_.Push((KeyEntry*)pk_it_->GetValue());          // NOLINT
         }
         it_->SeekToFirst();
         record_idx_ = 1;
@@ -988,11 +1254,10 @@ void MemTableTraverseIterator::Seek(const std::string& key, uint64_t ts) {
         if (segments_[seg_idx_]->GetTsCnt() > 1) {
             KeyEntry* entry = ((KeyEntry**)pk_it_->GetValue())[ts_idx_];  // NOLINT
             ticket_.Push(entry);
-            it_ = entry->entries.NewIterator();
+            it_ = NewKeyIterator(entry);
         } else {
-            ticket_.Push((KeyEntry*)pk_it_->GetValue());  // NOLINT
-            it_ = ((KeyEntry*)pk_it_->GetValue())         // NOLINT
-                      ->entries.NewIterator();
+            ticket_.Push((KeyEntry*)pk_it_->GetValue());          // NOLINT
+            it_ = NewKeyIterator((KeyEntry*)pk_it_->GetValue());  // NOLINT
         }
         if (spk.compare(pk_it_->GetKey()) != 0 || ts == 0) {
             it_->SeekToFirst();
@@ -1030,9 +1295,7 @@ void MemTableTraverseIterator::Seek(const std::string& key, uint64_t ts) {
     }
 }
 
-openmldb::base::Slice MemTableTraverseIterator::GetValue() const {
-    return openmldb::base::Slice(it_->GetValue()->data, it_->GetValue()->size);
-}
+openmldb::base::Slice MemTableTraverseIterator::GetValue() const { return it_->GetValue(); }
 
 uint64_t MemTableTraverseIterator::GetKey() const {
     if (it_ != NULL && it_->Valid()) {
@@ -1065,11 +1328,10 @@ void MemTableTraverseIterator::SeekToFirst() {
             if (segments_[seg_idx_]->GetTsCnt() > 1) {
                 KeyEntry* entry = ((KeyEntry**)pk_it_->GetValue())[ts_idx_];  // NOLINT
                 ticket_.Push(entry);
-                it_ = entry->entries.NewIterator();
+                it_ = NewKeyIterator(entry);
             } else {
-                ticket_.Push((KeyEntry*)pk_it_->GetValue());  // NOLINT
-                it_ = ((KeyEntry*)pk_it_->GetValue())         // NOLINT
-                          ->entries.NewIterator();
+                ticket_.Push((KeyEntry*)pk_it_->GetValue());          // NOLINT
+                it_ = NewKeyIterator((KeyEntry*)pk_it_->GetValue());  // NOLINT
             }
             it_->SeekToFirst();
             traverse_cnt_++;
@@ -20,10 +20,13 @@
 #include <atomic>
 #include <map>
 #include <memory>
+#include <mutex>  // NOLINT
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "proto/tablet.pb.h"
+#include "storage/cold_tier.h"
 #include "storage/iterator.h"
 #include "storage/segment.h"
 #include "storage/table.h"
@@ -41,8 +44,13 @@ typedef google::protobuf::RepeatedPtrField<::openmldb::api::Dimension> Dimension
 class MemTableWindowIterator : public ::hybridse::vm::RowIterator {
  public:
     MemTableWindowIterator(TimeEntries::Iterator* it, ::openmldb::storage::TTLType ttl_type, uint64_t expire_time,
-                           uint64_t expire_cnt)
-        : it_(it), record_idx_(1), expire_value_(expire_time, expire_cnt, ttl_type), row_() {}
+                           uint64_t expire_cnt, CompressStat* compress_stat = NULL)
+        : it_(it),
+          record_idx_(1),
+          expire_value_(expire_time, expire_cnt, ttl_type),
+          row_(),
+          compress_stat_(compress_stat),
+          managed_row_(false) {}
 
     ~MemTableWindowIterator() { delete it_; }
 
@@ -62,7 +70,22 @@ class MemTableWindowIterator : public ::hybridse::vm::RowIterator {
 
     // TODO(wangtaize) unify the row object
     const ::hybridse::codec::Row& GetValue() override {
-        row_.Reset(reinterpret_cast<const int8_t*>(it_->GetValue()->data), it_->GetValue()->size);
+        const DataBlock* block = it_->GetValue();
+        if (!block->compressed) {
+            if (managed_row_) {
+                // Reset does not release the decoded buffer owned by row
+                row_ = ::hybridse::codec::Row();
+                managed_row_ = false;
+            }
+            row_.Reset(reinterpret_cast<const int8_t*>(block->data), block->size);
+            return row_;
+        }
+        // the decoded row may be held by the caller after Next, so it owns the buffer
+        uint32_t size = block->GetDecodedSize();
+        int8_t* buf = reinterpret_cast<int8_t*>(malloc(size));
+        block->Decode(reinterpret_cast<char*>(buf), compress_stat_);
+        row_ = ::hybridse::codec::Row(::hybridse::base::RefCountedSlice::CreateManaged(buf, size));
+        managed_row_ = true;
         return row_;
     }
 
@@ -78,12 +101,97 @@ class MemTableWindowIterator : public ::hybridse::vm::RowIterator {
     uint32_t record_idx_;
     TTLSt expire_value_;
     ::hybridse::codec::Row row_;
+    CompressStat* compress_stat_;
+    bool managed_row_;
+};
+
+// Merge the rows of one pk in memory and cold tier by time desc, the same as TieredTableIterator
+class TieredWindowIterator : public ::hybridse::vm::RowIterator {
+ public:
+    TieredWindowIterator(MemTableWindowIterator* hot_it, TableIterator* cold_it, ::openmldb::storage::TTLType ttl_type,
+                         uint64_t expire_time, uint64_t expire_cnt)
+        : hot_it_(hot_it),
+          cold_it_(cold_it),
+          expire_value_(expire_time, expire_cnt, ttl_type),
+          use_hot_(true),
+          cold_key_(0),
+          row_() {}
+
+    ~TieredWindowIterator() override {}
+
+    bool Valid() const override {
+        if (use_hot_) {
+            return hot_it_->Valid();
+        }
+        return cold_it_->Valid() && !expire_value_.IsExpired(cold_key_, 0);
+    }
+
+    void Next() override {
+        if (use_hot_) {
+            hot_it_->Next();
+        } else {
+            cold_it_->Next();
+        }
+        Pick();
+    }
+
+    const uint64_t& GetKey() const override { return use_hot_ ? hot_it_->GetKey() : cold_key_; }
+
+    const ::hybridse::codec::Row& GetValue() override {
+        if (use_hot_) {
+            return hot_it_->GetValue();
+        }
+        // the value of rocksdb iterator is invalid after Next, so the row owns a copy
+        Slice value = cold_it_->GetValue();
+        int8_t* buf = reinterpret_cast<int8_t*>(malloc(value.size()));
+        memcpy(buf, value.data(), value.size());
+        row_ = ::hybridse::codec::Row(::hybridse::base::RefCountedSlice::CreateManaged(buf, value.size()));
+        return row_;
+    }
+
+    void Seek(const uint64_t& key) override {
+        hot_it_->Seek(key);
+        cold_it_->Seek(key);
+        Pick();
+    }
+
+    void SeekToFirst() override {
+        hot_it_->SeekToFirst();
+        cold_it_->SeekToFirst();
+        Pick();
+    }
+
+    bool IsSeekable() const override { return true; }
+
+ private:
+    void Pick() {
+        if (hot_it_->Valid()) {
+            while (cold_it_->Valid() && cold_it_->GetKey() == hot_it_->GetKey()) {
+                cold_it_->Next();
+            }
+            use_hot_ = !cold_it_->Valid() || hot_it_->GetKey() > cold_it_->GetKey();
+        } else {
+            use_hot_ = false;
+        }
+        if (!use_hot_ && cold_it_->Valid()) {
+            cold_key_ = cold_it_->GetKey();
+        }
+    }
+
+ private:
+    std::unique_ptr<MemTableWindowIterator> hot_it_;
+    std::unique_ptr<TableIterator> cold_it_;
+    TTLSt expire_value_;
+    bool use_hot_;
+    uint64_t cold_key_;
+    ::hybridse::codec::Row row_;
 };
 
 class MemTableKeyIterator : public ::hybridse::vm::WindowIterator {
  public:
     MemTableKeyIterator(Segment** segments, uint32_t seg_cnt, ::openmldb::storage::TTLType ttl_type,
-                        uint64_t expire_time, uint64_t expire_cnt, uint32_t ts_index);
+                        uint64_t expire_time, uint64_t expire_cnt, uint32_t ts_index,
+                        ColdTier* cold_tier = NULL, uint32_t inner_pos = 0);
 
     ~MemTableKeyIterator() override;
 
@@ -115,12 +223,15 @@ class MemTableKeyIterator : public ::hybridse::vm::WindowIterator {
     uint32_t ts_index_{};
     Ticket ticket_;
     uint32_t ts_idx_;
+    ColdTier* cold_tier_;
+    uint32_t inner_pos_;
 };
 
 class MemTableTraverseIterator : public TraverseIterator {
  public:
     MemTableTraverseIterator(Segment** segments, uint32_t seg_cnt, ::openmldb::storage::TTLType ttl_type,
-                             uint64_t expire_time, uint64_t expire_cnt, uint32_t ts_index);
+                             uint64_t expire_time, uint64_t expire_cnt, uint32_t ts_index,
+                             ColdTier* cold_tier = NULL, uint32_t inner_pos = 0);
     ~MemTableTraverseIterator() override;
     inline bool Valid() override;
     void Next() override;
@@ -132,18 +243,25 @@ class MemTableTraverseIterator : public TraverseIterator {
     void SeekToFirst() override;
     uint64_t GetCount() const override;
 
+ private:
+    // the rows of the current pk, merged with the rows in cold tier if it has any
+    TableIterator* NewKeyIterator(KeyEntry* entry);
+
  private:
     Segment** segments_;
     uint32_t const seg_cnt_;
     uint32_t seg_idx_;
     KeyEntries::Iterator* pk_it_;
-    TimeEntries::Iterator* it_;
+    TableIterator* it_;
     uint32_t record_idx_;
     uint32_t ts_idx_;
     // uint64_t expire_value_;
     TTLSt expire_value_;
     Ticket ticket_;
     uint64_t traverse_cnt_;
+    CompressStat* compress_stat_;
+    ColdTier* cold_tier_;
+    uint32_t inner_pos_;
 };
 
 class MemTable : public Table {
@@ -162,6 +280,9 @@ class MemTable : public Table {
 
     bool Put(uint64_t time, const std::string& value, const Dimensions& dimensions) override;
 
+    // extract the ts of all index ts columns from the row, the auto gen ts uses time
+    bool GetTsMap(uint64_t time, const Slice& value, std::map<int32_t, uint64_t>* ts_map);
+
     bool GetBulkLoadInfo(::openmldb::api::BulkLoadInfoResponse* response);
 
     bool BulkLoad(const std::vector<DataBlock*>& data_blocks,
@@ -183,6 +304,20 @@ class MemTable : public Table {
 
     void SchedGc() override;
 
+    // Run one gc step which visits at most max_keys keys of a segment and uses at most max_time_us,
+    // 0 means no limit. The next step continues the unfinished round. Return true if the round is finished
+    bool SchedGcStep(uint64_t max_keys, uint64_t max_time_us);
+
+    void GetGcStatus(::openmldb::api::GcStatus* status);
+
+    void GetCompressStatus(::openmldb::api::CompressStatus* status);
+
+    // Move the rows older than hot_data_ttl of absolute ttl indexes to cold tier, at most spill_max_rows rows
+    // in a gc round. Return false if it's stopped by max_keys or deadline_us and the next call continues it
+    bool SpillColdData(uint64_t max_keys, uint64_t deadline_us);
+
+    void GetColdTierStatus(::openmldb::api::ColdTierStatus* status);
+
     int GetCount(uint32_t index, const std::string& pk, uint64_t& count) override;  // NOLINT
 
     uint64_t GetRecordIdxCnt() override;
@@ -222,6 +357,15 @@ class MemTable : public Table {
 
     bool CheckLatest(uint32_t index_id, const std::string& key, uint64_t ts);
 
+    // only the inner index with one absolute ttl index is kept in cold tier
+    bool IsSpillable(uint32_t inner_pos);
+
+    void PutToSegments(const std::map<int32_t, Slice>& inner_index_key_map, const std::map<int32_t, uint64_t>& ts_map,
+                       uint32_t real_ref_cnt, const char* data, uint32_t size);
+
+    // the row is compressed if memory_compression is enabled and it saves memory
+    DataBlock* NewDataBlock(uint8_t dim_cnt, const char* data, uint32_t size);
+
  private:
     uint32_t seg_cnt_;
     std::vector<Segment**> segments_;
@@ -231,6 +375,33 @@ class MemTable : public Table {
     bool segment_released_;
     std::atomic<uint64_t> record_byte_size_;
     uint32_t key_entry_max_height_;
+    // the position of the unfinished gc round
+    std::mutex gc_mu_;
+    uint32_t gc_index_pos_{0};
+    uint32_t gc_seg_pos_{0};
+    bool gc_index_entered_{false};
+    uint64_t gc_round_start_time_{0};
+    uint64_t gc_round_idx_cnt_{0};
+    uint64_t gc_round_record_cnt_{0};
+    // gc stat
+    std::atomic<uint64_t> gc_round_cnt_{0};
+    std::atomic<uint64_t> gc_step_cnt_{0};
+    std::atomic<uint32_t> gc_progress_{0};
+    std::atomic<uint64_t> gc_idx_cnt_{0};
+    std::atomic<uint64_t> gc_record_cnt_{0};
+    std::atomic<uint64_t> gc_consumed_time_{0};
+    std::atomic<uint64_t> gc_last_round_time_{0};
+    bool compress_row_;
+    CompressStat compress_stat_;
+    std::unique_ptr<ColdTier> cold_tier_;
+    // the spill position is kept across gc rounds if a round reaches spill_max_rows
+    uint32_t spill_index_pos_{0};
+    uint32_t spill_seg_pos_{0};
+    bool spill_in_progress_{false};
+    uint64_t spill_round_rows_{0};
+    std::atomic<uint64_t> spill_round_cnt_{0};
+    std::atomic<uint64_t> spill_record_cnt_{0};
+    std::atomic<uint64_t> spill_consumed_time_{0};
 };
 
 }  // namespace storage
@@ -23,7 +23,9 @@
 #include <snappy.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <set>
+#include <thread>  // NOLINT
 #include <utility>
 
 #include "base/count_down_latch.h"
@@ -42,6 +44,7 @@
 #include "log/log_reader.h"
 #include "log/sequential_file.h"
 #include "proto/tablet.pb.h"
+#include "storage/mem_table.h"
 
 using google::protobuf::RepeatedPtrField;
 using ::openmldb::codec::SchemaCodec;
@@ -52,7 +55,9 @@ DECLARE_uint32(make_snapshot_max_deleted_keys);
 DECLARE_uint32(load_table_batch);
 DECLARE_uint32(load_table_thread_num);
 DECLARE_uint32(load_table_queue_size);
+DECLARE_uint32(load_snapshot_split_mb);
 DECLARE_string(snapshot_compression);
+DECLARE_string(snapshot_format);
 
 namespace openmldb {
 namespace storage {
@@ -98,17 +103,53 @@ void MemTableSnapshot::RecoverFromSnapshot(const std::string& snapshot_name, uin
     std::string full_path = snapshot_path_ + "/" + snapshot_name;
     std::atomic<uint64_t> g_succ_cnt(0);
     std::atomic<uint64_t> g_failed_cnt(0);
+    uint64_t file_size = 0;
+    ::openmldb::base::GetFileSize(full_path, file_size);
+    uint64_t consumed = ::baidu::common::timer::get_micros();
     RecoverSingleSnapshot(full_path, table, &g_succ_cnt, &g_failed_cnt);
+    consumed = ::baidu::common::timer::get_micros() - consumed;
+    uint64_t succ_cnt = g_succ_cnt.load(std::memory_order_relaxed);
+    recover_byte_size_.store(file_size, std::memory_order_relaxed);
+    recover_record_cnt_.store(succ_cnt, std::memory_order_relaxed);
+    recover_time_.store(consumed, std::memory_order_relaxed);
+    double seconds = consumed > 0 ? consumed / 1000000.0 : 1.0;
     PDLOG(INFO, "[Recover] progress done stat: success count %lu, failed count %lu",
-          g_succ_cnt.load(std::memory_order_relaxed), g_failed_cnt.load(std::memory_order_relaxed));
+          succ_cnt, g_failed_cnt.load(std::memory_order_relaxed));
+    PDLOG(INFO, "[Recover] read %lu bytes and %lu rows in %lu ms, %.2f MB/s, %.0f rows/s. tid %u pid %u", file_size,
+          succ_cnt, consumed / 1000, file_size / seconds / 1024 / 1024, succ_cnt / seconds, tid_, pid_);
     if (g_succ_cnt.load(std::memory_order_relaxed) != expect_cnt) {
         PDLOG(WARNING, "snapshot %s , expect cnt %lu but succ_cnt %lu", snapshot_name.c_str(), expect_cnt,
               g_succ_cnt.load(std::memory_order_relaxed));
     }
 }
 
+void MemTableSnapshot::GetRecoverStatus(::openmldb::api::RecoverStatus* status) {
+    uint64_t byte_size = recover_byte_size_.load(std::memory_order_relaxed);
+    uint64_t record_cnt = recover_record_cnt_.load(std::memory_order_relaxed);
+    uint64_t consumed = recover_time_.load(std::memory_order_relaxed);
+    status->set_byte_size(byte_size);
+    status->set_record_cnt(record_cnt);
+    status->set_consumed_time(consumed);
+    if (consumed > 0) {
+        status->set_byte_per_second(byte_size * 1000000 / consumed);
+        status->set_record_per_second(record_cnt * 1000000 / consumed);
+    }
+}
+
 void MemTableSnapshot::RecoverSingleSnapshot(const std::string& path, std::shared_ptr<Table> table,
                                              std::atomic<uint64_t>* g_succ_cnt, std::atomic<uint64_t>* g_failed_cnt) {
+    if (table != NULL && IsColumnarSnapshot(path)) {
+        RecoverColumnarSnapshot(path, table, g_succ_cnt, g_failed_cnt);
+        return;
+    }
+    uint64_t split_size = static_cast<uint64_t>(FLAGS_load_snapshot_split_mb) * 1024 * 1024;
+    uint64_t file_size = 0;
+    // the compressed blocks have variable length, so only the uncompressed snapshot can be split
+    if (table != NULL && split_size > 0 && FLAGS_load_table_thread_num > 1 && !IsCompressed(path) &&
+        ::openmldb::base::GetFileSize(path, file_size) && file_size >= 2 * split_size) {
+        RecoverSnapshotByRange(path, file_size, table, g_succ_cnt, g_failed_cnt);
+        return;
+    }
     ::openmldb::base::TaskPool load_pool_(FLAGS_load_table_thread_num, FLAGS_load_table_batch);
     std::atomic<uint64_t> succ_cnt, failed_cnt;
     succ_cnt = failed_cnt = 0;
@@ -124,7 +165,10 @@ void MemTableSnapshot::RecoverSingleSnapshot(const std::string& path, std::share
             break;
         }
         bool compressed = IsCompressed(path);
-        ::openmldb::log::SequentialFile* seq_file = ::openmldb::log::NewSeqFile(path, fd);
+        ::openmldb::log::SequentialFile* seq_file = ::openmldb::log::NewMmapSeqFile(path, fd);
+        if (seq_file == NULL) {
+            seq_file = ::openmldb::log::NewSeqFile(path, fd);
+        }
         ::openmldb::log::Reader reader(seq_file, NULL, false, 0, compressed);
         std::string buffer;
         // second
@@ -176,6 +220,168 @@ void MemTableSnapshot::RecoverSingleSnapshot(const std::string& path, std::share
     load_pool_.Stop();
 }
 
+void MemTableSnapshot::RecoverSnapshotByRange(const std::string& path, uint64_t file_size,
+                                              std::shared_ptr<Table> table, std::atomic<uint64_t>* g_succ_cnt,
+                                              std::atomic<uint64_t>* g_failed_cnt) {
+    uint64_t split_size = static_cast<uint64_t>(FLAGS_load_snapshot_split_mb) * 1024 * 1024;
+    uint64_t range_cnt = std::min(static_cast<uint64_t>(FLAGS_load_table_thread_num), file_size / split_size);
+    // align the ranges to the log block, so each reader starts from a block boundary
+    uint64_t block_size = ::openmldb::log::kBlockSize;
+    uint64_t range_size = (file_size / range_cnt + block_size - 1) / block_size * block_size;
+    std::atomic<uint64_t> succ_cnt(0);
+    std::atomic<uint64_t> failed_cnt(0);
+    uint64_t consumed = ::baidu::common::timer::now_time();
+    std::vector<std::thread> threads;
+    for (uint64_t start = 0; start < file_size; start += range_size) {
+        uint64_t end = std::min(start + range_size, file_size);
+        threads.emplace_back(&MemTableSnapshot::RecoverSnapshotRange, this, path, start, end, table, &succ_cnt,
+                             &failed_cnt);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    consumed = ::baidu::common::timer::now_time() - consumed;
+    PDLOG(INFO,
+          "read path %s for table tid %u pid %u with %lu threads completed, "
+          "succ_cnt %lu, failed_cnt %lu, consumed %us",
+          path.c_str(), tid_, pid_, threads.size(), succ_cnt.load(std::memory_order_relaxed),
+          failed_cnt.load(std::memory_order_relaxed), consumed);
+    if (g_succ_cnt) {
+        g_succ_cnt->fetch_add(succ_cnt, std::memory_order_relaxed);
+    }
+    if (g_failed_cnt) {
+        g_failed_cnt->fetch_add(failed_cnt, std::memory_order_relaxed);
+    }
+}
+
+void MemTableSnapshot::RecoverSnapshotRange(const std::string& path, uint64_t start, uint64_t end,
+                                            std::shared_ptr<Table> table, std::atomic<uint64_t>* succ_cnt,
+                                            std::atomic<uint64_t>* failed_cnt) {
+    FILE* fd = fopen(path.c_str(), "rb");
+    if (fd == NULL) {
+        PDLOG(WARNING, "fail to open path %s for error %s", path.c_str(), strerror(errno));
+        return;
+    }
+    ::openmldb::log::SequentialFile* seq_file = ::openmldb::log::NewMmapSeqFile(path, fd);
+    if (seq_file == NULL) {
+        seq_file = ::openmldb::log::NewSeqFile(path, fd);
+    }
+    // the reader skips the tail of the record which starts in the previous range
+    ::openmldb::log::Reader reader(seq_file, NULL, false, start, false);
+    std::string buffer;
+    ::openmldb::api::LogEntry entry;
+    while (true) {
+        ::openmldb::base::Slice record;
+        ::openmldb::log::Status status = reader.ReadRecord(&record, &buffer);
+        if (status.IsWaitRecord() || status.IsEof()) {
+            break;
+        }
+        if (!status.ok()) {
+            PDLOG(WARNING, "fail to read record for tid %u, pid %u with error %s", tid_, pid_,
+                  status.ToString().c_str());
+            failed_cnt->fetch_add(1, std::memory_order_relaxed);
+            if (status.IsIOError()) {
+                break;
+            }
+            continue;
+        }
+        // the record starts in the next range is loaded by the next reader
+        if (reader.LastRecordOffset() >= end) {
+            break;
+        }
+        if (!entry.ParseFromArray(record.data(), record.size())) {
+            failed_cnt->fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        auto scount = succ_cnt->fetch_add(1, std::memory_order_relaxed);
+        if (scount % 100000 == 0) {
+            PDLOG(INFO, "load snapshot %s with succ_cnt %lu, failed_cnt %lu", path.c_str(), scount,
+                  failed_cnt->load(std::memory_order_relaxed));
+        }
+        table->Put(entry);
+    }
+    delete seq_file;
+}
+
+void MemTableSnapshot::RecoverColumnarSnapshot(const std::string& path, std::shared_ptr<Table> table,
+                                               std::atomic<uint64_t>* g_succ_cnt,
+                                               std::atomic<uint64_t>* g_failed_cnt) {
+    FILE* fd = fopen(path.c_str(), "rb");
+    if (fd == NULL) {
+        PDLOG(WARNING, "fail to open path %s for error %s", path.c_str(), strerror(errno));
+        return;
+    }
+    ::openmldb::log::SequentialFile* seq_file = ::openmldb::log::NewMmapSeqFile(path, fd);
+    if (seq_file == NULL) {
+        seq_file = ::openmldb::log::NewSeqFile(path, fd);
+    }
+    ColumnarSnapshotReader reader(seq_file);
+    ::openmldb::base::TaskPool load_pool_(FLAGS_load_table_thread_num, FLAGS_load_table_batch);
+    std::atomic<uint64_t> succ_cnt(0);
+    std::atomic<uint64_t> failed_cnt(0);
+    uint64_t consumed = ::baidu::common::timer::now_time();
+    while (true) {
+        std::string* block = new std::string();
+        ::openmldb::log::Status status = reader.ReadBlock(block);
+        if (status.IsWaitRecord() || status.IsEof()) {
+            delete block;
+            break;
+        }
+        if (!status.ok()) {
+            PDLOG(WARNING, "fail to read block for tid %u, pid %u with error %s", tid_, pid_,
+                  status.ToString().c_str());
+            delete block;
+            failed_cnt.fetch_add(1, std::memory_order_relaxed);
+            if (status.IsIOError()) {
+                break;
+            }
+            continue;
+        }
+        // the blocks are decoded and loaded in parallel
+        load_pool_.AddTask(
+            boost::bind(&MemTableSnapshot::PutBlock, this, path, table, block, &succ_cnt, &failed_cnt));
+    }
+    load_pool_.Stop();
+    consumed = ::baidu::common::timer::now_time() - consumed;
+    PDLOG(INFO,
+          "read columnar path %s for table tid %u pid %u completed, "
+          "succ_cnt %lu, failed_cnt %lu, consumed %us",
+          path.c_str(), tid_, pid_, succ_cnt.load(std::memory_order_relaxed),
+          failed_cnt.load(std::memory_order_relaxed), consumed);
+    if (g_succ_cnt) {
+        g_succ_cnt->fetch_add(succ_cnt, std::memory_order_relaxed);
+    }
+    if (g_failed_cnt) {
+        g_failed_cnt->fetch_add(failed_cnt, std::memory_order_relaxed);
+    }
+}
+
+void MemTableSnapshot::PutBlock(const std::string& path, std::shared_ptr<Table> table, std::string* raw,
+                                std::atomic<uint64_t>* succ_cnt, std::atomic<uint64_t>* failed_cnt) {
+    std::unique_ptr<std::string> raw_guard(raw);
+    ColumnarBlock block;
+    if (!block.Decode(::openmldb::base::Slice(*raw))) {
+        PDLOG(WARNING, "fail to decode block of %s. tid %u pid %u", path.c_str(), tid_, pid_);
+        failed_cnt->fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    ::openmldb::api::LogEntry entry;
+    for (uint32_t row = 0; row < block.GetRowCnt(); row++) {
+        // put through Table::Put so the ts are extracted from the row and the dimensions are checked
+        block.ToLogEntry(row, &entry);
+        bool ok = table->Put(entry);
+        if (!ok) {
+            failed_cnt->fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        auto scount = succ_cnt->fetch_add(1, std::memory_order_relaxed);
+        if (scount % 100000 == 0) {
+            PDLOG(INFO, "load snapshot %s with succ_cnt %lu, failed_cnt %lu", path.c_str(), scount,
+                  failed_cnt->load(std::memory_order_relaxed));
+        }
+    }
+}
+
 void MemTableSnapshot::Put(std::string& path, std::shared_ptr<Table>& table, std::vector<std::string*> recordPtr,
                            std::atomic<uint64_t>* succ_cnt, std::atomic<uint64_t>* failed_cnt) {
     ::openmldb::api::LogEntry entry;
@@ -197,17 +403,13 @@ void MemTableSnapshot::Put(std::string& path, std::shared_ptr<Table>& table, std
 }
 
 int MemTableSnapshot::TTLSnapshot(std::shared_ptr<Table> table, const ::openmldb::api::Manifest& manifest,
-                                  WriteHandle* wh, uint64_t& count, uint64_t& expired_key_num,
+                                  SnapshotWriter* wh, uint64_t& count, uint64_t& expired_key_num,
                                   uint64_t& deleted_key_num) {
     std::string full_path = snapshot_path_ + manifest.name();
-    FILE* fd = fopen(full_path.c_str(), "rb");
-    if (fd == NULL) {
-        PDLOG(WARNING, "fail to open path %s for error %s", full_path.c_str(), strerror(errno));
+    std::unique_ptr<SnapshotReader> reader(NewSnapshotReader(full_path));
+    if (!reader) {
         return -1;
     }
-    bool compressed = IsCompressed(full_path);
-    ::openmldb::log::SequentialFile* seq_file = ::openmldb::log::NewSeqFile(manifest.name(), fd);
-    ::openmldb::log::Reader reader(seq_file, NULL, false, 0, compressed);
 
     std::string buffer;
     std::string tmp_buf;
@@ -221,7 +423,7 @@ int MemTableSnapshot::TTLSnapshot(std::shared_ptr<Table> table, const ::openmldb
     }
     while (true) {
         ::openmldb::base::Slice record;
-        ::openmldb::log::Status status = reader.ReadRecord(&record, &buffer);
+        ::openmldb::log::Status status = reader->ReadRecord(&record, &buffer);
         if (status.IsEof()) {
             break;
         }
@@ -259,7 +461,6 @@ int MemTableSnapshot::TTLSnapshot(std::shared_ptr<Table> table, const ::openmldb
         }
         count++;
     }
-    delete seq_file;
     if (expired_key_num + count + deleted_key_num != manifest.count()) {
         PDLOG(WARNING,
               "key num not match! total key num[%lu] load key num[%lu] ttl key "
@@ -354,10 +555,17 @@ int MemTableSnapshot::MakeSnapshot(std::shared_ptr<Table> table, uint64_t& out_o
     }
     making_snapshot_.store(true, std::memory_order_release);
     std::string now_time = ::openmldb::base::GetNowTime();
-    std::string snapshot_name = now_time.substr(0, now_time.length() - 2) + ".sdb";
-    if (FLAGS_snapshot_compression != "off") {
-        snapshot_name.append(".");
-        snapshot_name.append(FLAGS_snapshot_compression);
+    bool columnar = FLAGS_snapshot_format == "columnar";
+    std::string snapshot_name = now_time.substr(0, now_time.length() - 2);
+    if (columnar) {
+        // the blocks of columnar snapshot are compressed already
+        snapshot_name.append(COLUMNAR_SNAPSHOT_SUBFIX);
+    } else {
+        snapshot_name.append(".sdb");
+        if (FLAGS_snapshot_compression != "off") {
+            snapshot_name.append(".");
+            snapshot_name.append(FLAGS_snapshot_compression);
+        }
     }
     std::string snapshot_name_tmp = snapshot_name + ".tmp";
     std::string full_path = snapshot_path_ + snapshot_name;
@@ -370,7 +578,13 @@ int MemTableSnapshot::MakeSnapshot(std::shared_ptr<Table> table, uint64_t& out_o
     }
     uint64_t collected_offset = CollectDeletedKey(end_offset);
     uint64_t start_time = ::baidu::common::timer::now_time();
-    WriteHandle* wh = new WriteHandle(FLAGS_snapshot_compression, snapshot_name_tmp, fd);
+    WriteHandle* whandle = new WriteHandle(columnar ? "off" : FLAGS_snapshot_compression, snapshot_name_tmp, fd);
+    SnapshotWriter* wh = NULL;
+    if (columnar) {
+        wh = new ColumnarSnapshotWriter(whandle, std::dynamic_pointer_cast<MemTable>(table).get());
+    } else {
+        wh = new RowSnapshotWriter(whandle);
+    }
     ::openmldb::api::Manifest manifest;
     bool has_error = false;
     uint64_t write_count = 0;
@@ -473,9 +687,12 @@ int MemTableSnapshot::MakeSnapshot(std::shared_ptr<Table> table, uint64_t& out_o
         }
     }
     if (wh != NULL) {
-        wh->EndLog();
+        if (!wh->EndLog().ok()) {
+            has_error = true;
+        }
         delete wh;
         wh = NULL;
+        delete whandle;
     }
     int ret = 0;
     if (has_error) {
@@ -671,14 +888,10 @@ base::Status MemTableSnapshot::ExtractIndexFromSnapshot(std::shared_ptr<Table> t
         index_vec.push_back(index_def);
     }
     std::string full_path = snapshot_path_ + manifest.name();
-    FILE* fd = fopen(full_path.c_str(), "rb");
-    if (fd == NULL) {
-        PDLOG(WARNING, "fail to open path %s for error %s", full_path.c_str(), strerror(errno));
+    std::unique_ptr<SnapshotReader> reader(NewSnapshotReader(full_path));
+    if (!reader) {
         return base::Status(base::ReturnCode::kError, "fail to open file");
     }
-    ::openmldb::log::SequentialFile* seq_file = ::openmldb::log::NewSeqFile(manifest.name(), fd);
-    bool compressed = IsCompressed(full_path);
-    ::openmldb::log::Reader reader(seq_file, NULL, false, 0, compressed);
     std::string buffer;
     ::openmldb::api::LogEntry entry;
     bool has_error = false;
@@ -687,7 +900,7 @@ base::Status MemTableSnapshot::ExtractIndexFromSnapshot(std::shared_ptr<Table> t
     DLOG(INFO) << "extract index data from snapshot";
     while (true) {
         ::openmldb::base::Slice record;
-        ::openmldb::log::Status status = reader.ReadRecord(&record, &buffer);
+        ::openmldb::log::Status status = reader->ReadRecord(&record, &buffer);
         if (status.IsEof()) {
             break;
         }
@@ -770,7 +983,6 @@ base::Status MemTableSnapshot::ExtractIndexFromSnapshot(std::shared_ptr<Table> t
         }
         (*count)++;
     }
-    delete seq_file;
     if (*expired_key_num + write_count + *deleted_key_num != manifest.count()) {
         PDLOG(WARNING, "key num not match! total key[%lu] load key[%lu] ttl key[%lu] delete key [%lu], tid %u pid %u",
                 manifest.count(), *count, *expired_key_num, *deleted_key_num, tid, pid);
@@ -791,14 +1003,10 @@ int MemTableSnapshot::ExtractIndexFromSnapshot(std::shared_ptr<Table> table, con
     uint32_t tid = table->GetId();
     uint32_t pid = table->GetPid();
     std::string full_path = snapshot_path_ + manifest.name();
-    FILE* fd = fopen(full_path.c_str(), "rb");
-    if (fd == NULL) {
-        PDLOG(WARNING, "fail to open path %s for error %s", full_path.c_str(), strerror(errno));
+    std::unique_ptr<SnapshotReader> reader(NewSnapshotReader(full_path));
+    if (!reader) {
         return -1;
     }
-    ::openmldb::log::SequentialFile* seq_file = ::openmldb::log::NewSeqFile(manifest.name(), fd);
-    bool compressed = IsCompressed(full_path);
-    ::openmldb::log::Reader reader(seq_file, NULL, false, 0, compressed);
     std::string buffer;
     ::openmldb::api::LogEntry entry;
     bool has_error = false;
@@ -808,7 +1016,7 @@ int MemTableSnapshot::ExtractIndexFromSnapshot(std::shared_ptr<Table> table, con
     DLOG(INFO) << "extract index data from snapshot";
     while (true) {
         ::openmldb::base::Slice record;
-        ::openmldb::log::Status status = reader.ReadRecord(&record, &buffer);
+        ::openmldb::log::Status status = reader->ReadRecord(&record, &buffer);
         if (status.IsEof()) {
             break;
         }
@@ -928,7 +1136,6 @@ int MemTableSnapshot::ExtractIndexFromSnapshot(std::shared_ptr<Table> table, con
         }
         count++;
     }
-    delete seq_file;
     if (expired_key_num + count + deleted_key_num + schame_size_less_count + other_error_count != manifest.count()) {
         LOG(WARNING) << "key num not match ! total key num[" << manifest.count() << "] load key num[" << count
                      << "] ttl key num[" << expired_key_num << "] schema size less num[" << schame_size_less_count
@@ -1548,14 +1755,10 @@ bool MemTableSnapshot::DumpSnapshotIndexData(std::shared_ptr<Table> table,
     std::string path = snapshot_path_ + "/" + manifest.name();
     uint64_t succ_cnt = 0;
     uint64_t failed_cnt = 0;
-    FILE* fd = fopen(path.c_str(), "rb");
-    if (fd == NULL) {
-        PDLOG(WARNING, "fail to open path %s for error %s", path.c_str(), strerror(errno));
+    std::unique_ptr<SnapshotReader> reader(NewSnapshotReader(path));
+    if (!reader) {
         return false;
     }
-    ::openmldb::log::SequentialFile* seq_file = ::openmldb::log::NewSeqFile(path, fd);
-    bool compressed = IsCompressed(path);
-    ::openmldb::log::Reader reader(seq_file, NULL, false, 0, compressed);
     ::openmldb::api::LogEntry entry;
     std::string buffer;
     std::string entry_buff;
@@ -1563,7 +1766,7 @@ bool MemTableSnapshot::DumpSnapshotIndexData(std::shared_ptr<Table> table,
     while (true) {
         buffer.clear();
         ::openmldb::base::Slice record;
-        ::openmldb::log::Status status = reader.ReadRecord(&record, &buffer);
+        ::openmldb::log::Status status = reader->ReadRecord(&record, &buffer);
         if (status.IsWaitRecord() || status.IsEof()) {
             PDLOG(INFO,
                   "read path %s for table tid %u pid %u completed, succ_cnt "
@@ -1593,7 +1796,6 @@ bool MemTableSnapshot::DumpSnapshotIndexData(std::shared_ptr<Table> table,
         ::openmldb::base::Slice new_record(entry_str);
         status = whs[index_pid]->Write(new_record);
         if (!status.ok()) {
-            delete seq_file;
             PDLOG(WARNING,
                   "fail to dump index entrylog in snapshot to pid[%u]. tid "
                   "%u pid %u",
@@ -1602,7 +1804,6 @@ bool MemTableSnapshot::DumpSnapshotIndexData(std::shared_ptr<Table> table,
         }
         succ_cnt++;
     }
-    delete seq_file;
     return true;
 }
 
@@ -29,6 +29,7 @@
 #include "log/log_writer.h"
 #include "log/sequential_file.h"
 #include "proto/tablet.pb.h"
+#include "storage/columnar_snapshot.h"
 #include "storage/snapshot.h"
 
 using ::openmldb::api::LogEntry;
@@ -52,12 +53,15 @@ class MemTableSnapshot : public Snapshot {
 
     void RecoverFromSnapshot(const std::string& snapshot_name, uint64_t expect_cnt, std::shared_ptr<Table> table);
 
+    // the stat of the last snapshot recovery
+    void GetRecoverStatus(::openmldb::api::RecoverStatus* status);
+
     int MakeSnapshot(std::shared_ptr<Table> table,
                      uint64_t& out_offset,  // NOLINT
                      uint64_t end_offset,
                      uint64_t term = 0) override;
 
-    int TTLSnapshot(std::shared_ptr<Table> table, const ::openmldb::api::Manifest& manifest, WriteHandle* wh,
+    int TTLSnapshot(std::shared_ptr<Table> table, const ::openmldb::api::Manifest& manifest, SnapshotWriter* wh,
                     uint64_t& count, uint64_t& expired_key_num,  // NOLINT
                     uint64_t& deleted_key_num);                  // NOLINT
 
@@ -120,6 +124,22 @@ class MemTableSnapshot : public Snapshot {
     void RecoverSingleSnapshot(const std::string& path, std::shared_ptr<Table> table, std::atomic<uint64_t>* g_succ_cnt,
                                std::atomic<uint64_t>* g_failed_cnt);
 
+    // split the snapshot into ranges aligned to log block and load them in parallel
+    void RecoverSnapshotByRange(const std::string& path, uint64_t file_size, std::shared_ptr<Table> table,
+                                std::atomic<uint64_t>* g_succ_cnt, std::atomic<uint64_t>* g_failed_cnt);
+
+    // load the records which start in [start, end)
+    void RecoverSnapshotRange(const std::string& path, uint64_t start, uint64_t end, std::shared_ptr<Table> table,
+                              std::atomic<uint64_t>* succ_cnt, std::atomic<uint64_t>* failed_cnt);
+
+    // decode the blocks of columnar snapshot and load them in parallel
+    void RecoverColumnarSnapshot(const std::string& path, std::shared_ptr<Table> table,
+                                 std::atomic<uint64_t>* g_succ_cnt, std::atomic<uint64_t>* g_failed_cnt);
+
+    // raw is the columnar block and will be deleted
+    void PutBlock(const std::string& path, std::shared_ptr<Table> table, std::string* raw,
+                  std::atomic<uint64_t>* succ_cnt, std::atomic<uint64_t>* failed_cnt);
+
     uint64_t CollectDeletedKey(uint64_t end_offset);
 
     int DecodeData(std::shared_ptr<Table> table, const openmldb::api::LogEntry& entry, uint32_t maxIdx,
@@ -132,6 +152,10 @@ class MemTableSnapshot : public Snapshot {
     std::string log_path_;
     std::map<std::string, uint64_t> deleted_keys_;
     std::string db_root_path_;
+    std::atomic<uint64_t> recover_byte_size_{0};
+    std::atomic<uint64_t> recover_record_cnt_{0};
+    // in us
+    std::atomic<uint64_t> recover_time_{0};
 };
 
 }  // namespace storage
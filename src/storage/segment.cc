@@ -17,7 +17,11 @@
 #include "storage/segment.h"
 
 #include <gflags/gflags.h>
+#include <snappy.h>
 
+#include <chrono>  // NOLINT
+
+#include "absl/cleanup/cleanup.h"
 #include "base/glog_wapper.h"
 #include "base/strings.h"
 #include "common/timer.h"
@@ -26,11 +30,71 @@
 DECLARE_int32(gc_safe_offset);
 DECLARE_uint32(skiplist_max_height);
 DECLARE_uint32(gc_deleted_pk_version_delta);
+DECLARE_bool(enable_concurrent_put);
 
 namespace openmldb {
 namespace storage {
 
 static const SliceComparator scmp;
+// time one of every DECODE_SAMPLE_RATE decodes in a thread
+static const uint32_t DECODE_SAMPLE_RATE = 128;
+
+DataBlock* DataBlock::NewCompressed(uint8_t dim_cnt, const char* input, uint32_t len, CompressStat* stat) {
+    std::string compressed;
+    ::snappy::Compress(input, len, &compressed);
+    if (compressed.size() + (len >> 3) > len) {
+        return NULL;
+    }
+    DataBlock* block = NewInline(dim_cnt, compressed.data(), compressed.size());
+    block->compressed = true;
+    if (stat != NULL) {
+        stat->record_cnt.fetch_add(1, std::memory_order_relaxed);
+        stat->saved_byte_size.fetch_add(len - compressed.size(), std::memory_order_relaxed);
+    }
+    return block;
+}
+
+uint32_t DataBlock::GetDecodedSize() const {
+    if (!compressed) {
+        return size;
+    }
+    size_t len = 0;
+    if (!::snappy::GetUncompressedLength(data, size, &len)) {
+        return 0;
+    }
+    return len;
+}
+
+bool DataBlock::Decode(char* dst, CompressStat* stat) const {
+    if (!compressed) {
+        memcpy(dst, data, size);
+        return true;
+    }
+    static thread_local uint32_t decode_cnt = 0;
+    if (stat == NULL || ++decode_cnt % DECODE_SAMPLE_RATE != 0) {
+        return ::snappy::RawUncompress(data, size, dst);
+    }
+    auto start = std::chrono::steady_clock::now();
+    bool ok = ::snappy::RawUncompress(data, size, dst);
+    uint64_t cost =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    stat->sampled_decode_cnt.fetch_add(1, std::memory_order_relaxed);
+    stat->sampled_decode_time.fetch_add(cost, std::memory_order_relaxed);
+    return ok;
+}
+
+Slice DataBlock::GetRow(std::string* buf, CompressStat* stat) const {
+    if (!compressed) {
+        return Slice(data, size);
+    }
+    buf->resize(GetDecodedSize());
+    if (!Decode(&(*buf)[0], stat)) {
+        PDLOG(WARNING, "decode compressed row failed");
+        buf->clear();
+    }
+    return Slice(buf->data(), buf->size());
+}
+
 Segment::Segment()
     : entries_(NULL),
       mu_(),
@@ -39,7 +103,16 @@ Segment::Segment()
       pk_cnt_(0),
       ts_cnt_(1),
       gc_version_(0),
-      ttl_offset_(FLAGS_gc_safe_offset * 60 * 1000) {
+      ttl_offset_(FLAGS_gc_safe_offset * 60 * 1000),
+      concurrent_put_(FLAGS_enable_concurrent_put),
+      gc_cursor_(),
+      gc_in_progress_(false),
+      gc_resume_(false),
+      gc_max_keys_(0),
+      gc_deadline_us_(0),
+      spill_cursor_(),
+      spill_in_progress_(false),
+      compress_stat_(NULL) {
     entries_ = new KeyEntries((uint8_t)FLAGS_skiplist_max_height, 4, scmp);
     key_entry_max_height_ = (uint8_t)FLAGS_skiplist_max_height;
     entry_free_list_ = new KeyEntryNodeList(4, 4, tcmp);
@@ -54,7 +127,16 @@ Segment::Segment(uint8_t height)
       key_entry_max_height_(height),
       ts_cnt_(1),
       gc_version_(0),
-      ttl_offset_(FLAGS_gc_safe_offset * 60 * 1000) {
+      ttl_offset_(FLAGS_gc_safe_offset * 60 * 1000),
+      concurrent_put_(FLAGS_enable_concurrent_put),
+      gc_cursor_(),
+      gc_in_progress_(false),
+      gc_resume_(false),
+      gc_max_keys_(0),
+      gc_deadline_us_(0),
+      spill_cursor_(),
+      spill_in_progress_(false),
+      compress_stat_(NULL) {
     entries_ = new KeyEntries((uint8_t)FLAGS_skiplist_max_height, 4, scmp);
     entry_free_list_ = new KeyEntryNodeList(4, 4, tcmp);
 }
@@ -68,7 +150,16 @@ Segment::Segment(uint8_t height, const std::vector<uint32_t>& ts_idx_vec)
       key_entry_max_height_(height),
       ts_cnt_(ts_idx_vec.size()),
       gc_version_(0),
-      ttl_offset_(FLAGS_gc_safe_offset * 60 * 1000) {
+      ttl_offset_(FLAGS_gc_safe_offset * 60 * 1000),
+      concurrent_put_(FLAGS_enable_concurrent_put),
+      gc_cursor_(),
+      gc_in_progress_(false),
+      gc_resume_(false),
+      gc_max_keys_(0),
+      gc_deadline_us_(0),
+      spill_cursor_(),
+      spill_in_progress_(false),
+      compress_stat_(NULL) {
     entries_ = new KeyEntries((uint8_t)FLAGS_skiplist_max_height, 4, scmp);
     entry_free_list_ = new KeyEntryNodeList(4, 4, tcmp);
     for (uint32_t i = 0; i < ts_idx_vec.size(); i++) {
@@ -92,13 +183,13 @@ uint64_t Segment::Release() {
             if (ts_cnt_ > 1) {
                 KeyEntry** entry_arr = (KeyEntry**)it->GetValue();  // NOLINT
                 for (uint32_t i = 0; i < ts_cnt_; i++) {
-                    cnt += entry_arr[i]->Release();
+                    cnt += entry_arr[i]->Release(compress_stat_);
                     delete entry_arr[i];
                 }
                 delete[] entry_arr;
             } else {
                 KeyEntry* entry = (KeyEntry*)it->GetValue();  // NOLINT
-                cnt += entry->Release();
+                cnt += entry->Release(compress_stat_);
                 delete entry;
             }
         }
@@ -115,13 +206,13 @@ uint64_t Segment::Release() {
         if (ts_cnt_ > 1) {
             KeyEntry** entry_arr = (KeyEntry**)node->GetValue();  // NOLINT
             for (uint32_t i = 0; i < ts_cnt_; i++) {
-                entry_arr[i]->Release();
+                entry_arr[i]->Release(compress_stat_);
                 delete entry_arr[i];
             }
             delete[] entry_arr;
         } else {
             KeyEntry* entry = (KeyEntry*)node->GetValue();  // NOLINT
-            entry->Release();
+            entry->Release(compress_stat_);
             delete entry;
         }
         delete node;
@@ -140,7 +231,7 @@ void Segment::ReleaseAndCount(uint64_t& gc_idx_cnt, uint64_t& gc_record_cnt, uin
         Slice key = it->GetKey();
         ::openmldb::base::Node<Slice, void*>* entry_node = NULL;
         {
-            std::lock_guard<std::mutex> lock(mu_);
+            std::lock_guard<std::shared_mutex> lock(mu_);
             entry_node = entries_->Remove(key);
         }
         if (entry_node != NULL) {
@@ -159,7 +250,7 @@ void Segment::Put(const Slice& key, uint64_t time, const char* data, uint32_t si
     if (ts_cnt_ > 1) {
         return;
     }
-    auto* db = new DataBlock(1, data, size);
+    auto* db = DataBlock::NewInline(1, data, size);
     Put(key, time, db);
 }
 
@@ -167,10 +258,67 @@ void Segment::Put(const Slice& key, uint64_t time, DataBlock* row) {
     if (ts_cnt_ > 1) {
         return;
     }
-    std::lock_guard<std::mutex> lock(mu_);
+    if (concurrent_put_) {
+        // writers insert with cas and only exclude the gc which splits the lists
+        std::shared_lock<std::shared_mutex> lock(mu_);
+        uint32_t byte_size = 0;
+        KeyEntry* entry = reinterpret_cast<KeyEntry*>(GetOrInsertEntryConcurrently(key, byte_size));
+        idx_cnt_.fetch_add(1, std::memory_order_relaxed);
+        uint8_t height = entry->entries.InsertConcurrently(time, row);
+        entry->count_.fetch_add(1, std::memory_order_relaxed);
+        byte_size += GetRecordTsIdxSize(height);
+        idx_byte_size_.fetch_add(byte_size, std::memory_order_relaxed);
+        return;
+    }
+    std::lock_guard<std::shared_mutex> lock(mu_);
     PutUnlock(key, time, row);
 }
 
+void* Segment::GetOrInsertEntryConcurrently(const Slice& key, uint32_t& byte_size) {
+    void* entry = NULL;
+    if (entries_->Get(key, entry) == 0 && entry != NULL) {
+        return entry;
+    }
+    char* pk = new char[key.size()];
+    memcpy(pk, key.data(), key.size());
+    // need to delete memory when free node
+    Slice skey(pk, key.size());
+    if (ts_cnt_ > 1) {
+        auto** entry_arr = new KeyEntry*[ts_cnt_];
+        for (uint32_t i = 0; i < ts_cnt_; i++) {
+            entry_arr[i] = new KeyEntry(key_entry_max_height_, !concurrent_put_);
+        }
+        entry = (void*)entry_arr;  // NOLINT
+    } else {
+        entry = (void*)new KeyEntry(key_entry_max_height_, !concurrent_put_);  // NOLINT
+    }
+    uint8_t height = 0;
+    ::openmldb::base::Node<Slice, void*>* node = entries_->GetOrInsertConcurrently(skey, entry, &height);
+    if (height == 0) {
+        // the key has been inserted by other writer
+        delete[] pk;
+        if (ts_cnt_ > 1) {
+            auto** entry_arr = (KeyEntry**)entry;  // NOLINT
+            for (uint32_t i = 0; i < ts_cnt_; i++) {
+                delete entry_arr[i];
+            }
+            delete[] entry_arr;
+        } else {
+            delete (KeyEntry*)entry;  // NOLINT
+        }
+        return node->GetValue();
+    }
+    if (ts_cnt_ > 1) {
+        byte_size += GetRecordPkMultiIdxSize(height, key.size(), ts_cnt_);
+    } else {
+        byte_size += GetRecordPkIdxSize(height, key.size());
+    }
+    // the time entries lists are allocated with the key entries if inline is disabled
+    byte_size += GetRecordTsListSize(key_entry_max_height_) * ts_cnt_;
+    pk_cnt_.fetch_add(1, std::memory_order_relaxed);
+    return entry;
+}
+
 void Segment::PutUnlock(const Slice& key, uint64_t time, DataBlock* row) {
     void* entry = nullptr;
     uint32_t byte_size = 0;
@@ -180,23 +328,31 @@ void Segment::PutUnlock(const Slice& key, uint64_t time, DataBlock* row) {
         memcpy(pk, key.data(), key.size());
         // need to delete memory when free node
         Slice skey(pk, key.size());
-        entry = (void*)new KeyEntry(key_entry_max_height_);  // NOLINT
+        entry = (void*)new KeyEntry(key_entry_max_height_, !concurrent_put_);  // NOLINT
         uint8_t height = entries_->Insert(skey, entry);
-        byte_size += GetRecordPkIdxSize(height, key.size(), key_entry_max_height_);
+        byte_size += GetRecordPkIdxSize(height, key.size());
         pk_cnt_.fetch_add(1, std::memory_order_relaxed);
     }
     idx_cnt_.fetch_add(1, std::memory_order_relaxed);
-    uint8_t height = ((KeyEntry*)entry)->entries.Insert(time, row);  // NOLINT
-    ((KeyEntry*)entry)                                               // NOLINT
-        ->count_.fetch_add(1, std::memory_order_relaxed);
-    byte_size += GetRecordTsIdxSize(height);
+    byte_size += InsertTimeEntry((KeyEntry*)entry, time, row);  // NOLINT
     idx_byte_size_.fetch_add(byte_size, std::memory_order_relaxed);
 }
 
+uint32_t Segment::InsertTimeEntry(KeyEntry* entry, uint64_t time, DataBlock* row) {
+    bool is_inline = entry->entries.IsInline();
+    uint8_t height = entry->entries.Insert(time, row);
+    entry->count_.fetch_add(1, std::memory_order_relaxed);
+    uint32_t byte_size = GetRecordTsIdxSize(height);
+    if (is_inline && !entry->entries.IsInline()) {
+        byte_size += GetRecordTsListSize(key_entry_max_height_);
+    }
+    return byte_size;
+}
+
 void Segment::BulkLoadPut(unsigned int key_entry_id, const Slice& key, uint64_t time, DataBlock* row) {
     void* key_entry_or_list = nullptr;
     uint32_t byte_size = 0;
-    std::lock_guard<std::mutex> lock(mu_);  // TODO(hw): need lock?
+    std::lock_guard<std::shared_mutex> lock(mu_);  // TODO(hw): need lock?
     int ret = entries_->Get(key, key_entry_or_list);
     if (ts_cnt_ == 1) {
         PutUnlock(key, time, row);
@@ -207,18 +363,14 @@ void Segment::BulkLoadPut(unsigned int key_entry_id, const Slice& key, uint64_t
             Slice skey(pk, key.size());
             auto** entry_arr_tmp = new KeyEntry*[ts_cnt_];
             for (uint32_t i = 0; i < ts_cnt_; i++) {
-                entry_arr_tmp[i] = new KeyEntry(key_entry_max_height_);
+                entry_arr_tmp[i] = new KeyEntry(key_entry_max_height_, !concurrent_put_);
             }
             auto entry_arr = (void*)entry_arr_tmp;  // NOLINT
             uint8_t height = entries_->Insert(skey, entry_arr);
-            byte_size += GetRecordPkMultiIdxSize(height, key.size(), key_entry_max_height_, ts_cnt_);
+            byte_size += GetRecordPkMultiIdxSize(height, key.size(), ts_cnt_);
             pk_cnt_.fetch_add(1, std::memory_order_relaxed);
         }
-        uint8_t height = ((KeyEntry**)key_entry_or_list)[key_entry_id]->entries.Insert(  // NOLINT
-            time, row);
-        ((KeyEntry**)key_entry_or_list)[key_entry_id]->count_.fetch_add(  // NOLINT
-            1, std::memory_order_relaxed);
-        byte_size += GetRecordTsIdxSize(height);
+        byte_size += InsertTimeEntry(((KeyEntry**)key_entry_or_list)[key_entry_id], time, row);  // NOLINT
         idx_byte_size_.fetch_add(byte_size, std::memory_order_relaxed);
         idx_cnt_vec_[key_entry_id]->fetch_add(1, std::memory_order_relaxed);
     }
@@ -236,8 +388,28 @@ void Segment::Put(const Slice& key, const std::map<int32_t, uint64_t>& ts_map, D
         }
         return;
     }
+    if (concurrent_put_) {
+        std::shared_lock<std::shared_mutex> lock(mu_);
+        KeyEntry** entry_arr = NULL;
+        for (const auto& kv : ts_map) {
+            uint32_t byte_size = 0;
+            auto pos = ts_idx_map_.find(kv.first);
+            if (pos == ts_idx_map_.end()) {
+                continue;
+            }
+            if (entry_arr == NULL) {
+                entry_arr = reinterpret_cast<KeyEntry**>(GetOrInsertEntryConcurrently(key, byte_size));
+            }
+            uint8_t height = entry_arr[pos->second]->entries.InsertConcurrently(kv.second, row);
+            entry_arr[pos->second]->count_.fetch_add(1, std::memory_order_relaxed);
+            byte_size += GetRecordTsIdxSize(height);
+            idx_byte_size_.fetch_add(byte_size, std::memory_order_relaxed);
+            idx_cnt_vec_[pos->second]->fetch_add(1, std::memory_order_relaxed);
+        }
+        return;
+    }
     void* entry_arr = NULL;
-    std::lock_guard<std::mutex> lock(mu_);
+    std::lock_guard<std::shared_mutex> lock(mu_);
     for (const auto& kv : ts_map) {
         uint32_t byte_size = 0;
         auto pos = ts_idx_map_.find(kv.first);
@@ -252,19 +424,15 @@ void Segment::Put(const Slice& key, const std::map<int32_t, uint64_t>& ts_map, D
                 Slice skey(pk, key.size());
                 KeyEntry** entry_arr_tmp = new KeyEntry*[ts_cnt_];
                 for (uint32_t i = 0; i < ts_cnt_; i++) {
-                    entry_arr_tmp[i] = new KeyEntry(key_entry_max_height_);
+                    entry_arr_tmp[i] = new KeyEntry(key_entry_max_height_, !concurrent_put_);
                 }
                 entry_arr = (void*)entry_arr_tmp;  // NOLINT
                 uint8_t height = entries_->Insert(skey, entry_arr);
-                byte_size += GetRecordPkMultiIdxSize(height, key.size(), key_entry_max_height_, ts_cnt_);
+                byte_size += GetRecordPkMultiIdxSize(height, key.size(), ts_cnt_);
                 pk_cnt_.fetch_add(1, std::memory_order_relaxed);
             }
         }
-        uint8_t height = ((KeyEntry**)entry_arr)[pos->second]->entries.Insert(  // NOLINT
-            kv.second, row);
-        ((KeyEntry**)entry_arr)[pos->second]->count_.fetch_add(  // NOLINT
-            1, std::memory_order_relaxed);
-        byte_size += GetRecordTsIdxSize(height);
+        byte_size += InsertTimeEntry(((KeyEntry**)entry_arr)[pos->second], kv.second, row);  // NOLINT
         idx_byte_size_.fetch_add(byte_size, std::memory_order_relaxed);
         idx_cnt_vec_[pos->second]->fetch_add(1, std::memory_order_relaxed);
     }
@@ -304,7 +472,7 @@ bool Segment::Get(const Slice& key, uint32_t idx, const uint64_t time, DataBlock
 bool Segment::Delete(const Slice& key) {
     ::openmldb::base::Node<Slice, void*>* entry_node = NULL;
     {
-        std::lock_guard<std::mutex> lock(mu_);
+        std::lock_guard<std::shared_mutex> lock(mu_);
         entry_node = entries_->Remove(key);
         if (entry_node == NULL) {
             return false;
@@ -330,6 +498,11 @@ void Segment::FreeList(::openmldb::base::Node<uint64_t, DataBlock*>* node, uint6
         } else {
             DEBUGLOG("delele data block for key %lu", tmp->GetKey());
             gc_record_byte_size += GetRecordSize(tmp->GetValue()->size);
+            if (tmp->GetValue()->compressed && compress_stat_ != NULL) {
+                compress_stat_->record_cnt.fetch_sub(1, std::memory_order_relaxed);
+                compress_stat_->saved_byte_size.fetch_sub(
+                    tmp->GetValue()->GetDecodedSize() - tmp->GetValue()->size, std::memory_order_relaxed);
+            }
             delete tmp->GetValue();
             gc_record_cnt++;
         }
@@ -357,12 +530,14 @@ void Segment::FreeEntry(::openmldb::base::Node<Slice, void*>* entry_node, uint64
                 FreeList(data_node, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
             }
             delete it;
+            if (!entry->entries.IsInline()) {
+                idx_byte_size_.fetch_sub(GetRecordTsListSize(key_entry_max_height_), std::memory_order_relaxed);
+            }
             delete entry;
             idx_cnt_vec_[i]->fetch_sub(gc_idx_cnt - old, std::memory_order_relaxed);
         }
         delete[] entry_arr;
-        uint64_t byte_size =
-            GetRecordPkMultiIdxSize(entry_node->Height(), entry_node->GetKey().size(), key_entry_max_height_, ts_cnt_);
+        uint64_t byte_size = GetRecordPkMultiIdxSize(entry_node->Height(), entry_node->GetKey().size(), ts_cnt_);
         idx_byte_size_.fetch_sub(byte_size, std::memory_order_relaxed);
     } else {
         uint64_t old = gc_idx_cnt;
@@ -375,9 +550,11 @@ void Segment::FreeEntry(::openmldb::base::Node<Slice, void*>* entry_node, uint64
             FreeList(data_node, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
         }
         delete it;
+        if (!entry->entries.IsInline()) {
+            idx_byte_size_.fetch_sub(GetRecordTsListSize(key_entry_max_height_), std::memory_order_relaxed);
+        }
         delete entry;
-        uint64_t byte_size =
-            GetRecordPkIdxSize(entry_node->Height(), entry_node->GetKey().size(), key_entry_max_height_);
+        uint64_t byte_size = GetRecordPkIdxSize(entry_node->Height(), entry_node->GetKey().size());
         idx_byte_size_.fetch_sub(byte_size, std::memory_order_relaxed);
         idx_cnt_.fetch_sub(gc_idx_cnt - old, std::memory_order_relaxed);
     }
@@ -412,6 +589,11 @@ void Segment::GcFreeList(uint64_t& gc_idx_cnt, uint64_t& gc_record_cnt, uint64_t
 
 void Segment::ExecuteGc(const TTLSt& ttl_st, uint64_t& gc_idx_cnt, uint64_t& gc_record_cnt,
                         uint64_t& gc_record_byte_size) {
+    // continue from the cursor if the last gc is unfinished, the cursor is dropped by any
+    // exit which doesn't reach it
+    gc_resume_ = gc_in_progress_;
+    gc_in_progress_ = false;
+    absl::Cleanup reset_resume = [this] { gc_resume_ = false; };
     uint64_t cur_time = ::baidu::common::timer::get_micros() / 1000;
     switch (ttl_st.ttl_type) {
         case ::openmldb::storage::TTLType::kAbsoluteTime: {
@@ -456,9 +638,13 @@ void Segment::ExecuteGc(const std::map<uint32_t, TTLSt>& ttl_st_map, uint64_t& g
         return;
     }
     if (ts_cnt_ <= 1) {
+        // ExecuteGc with single ttl handles the cursor
         ExecuteGc(ttl_st_map.begin()->second, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
         return;
     }
+    gc_resume_ = gc_in_progress_;
+    gc_in_progress_ = false;
+    absl::Cleanup reset_resume = [this] { gc_resume_ = false; };
     bool need_gc = false;
     for (const auto& kv : ttl_st_map) {
         if (ts_idx_map_.find(kv.first) == ts_idx_map_.end()) {
@@ -481,13 +667,17 @@ void Segment::Gc4Head(uint64_t keep_cnt, uint64_t& gc_idx_cnt, uint64_t& gc_reco
     }
     uint64_t consumed = ::baidu::common::timer::get_micros();
     uint64_t old = gc_idx_cnt;
+    uint64_t visited_cnt = 0;
     KeyEntries::Iterator* it = entries_->NewIterator();
-    it->SeekToFirst();
+    SeekGcCursor(it);
     while (it->Valid()) {
+        if (ReachGcLimit(it, visited_cnt++)) {
+            break;
+        }
         KeyEntry* entry = (KeyEntry*)it->GetValue();  // NOLINT
         ::openmldb::base::Node<uint64_t, DataBlock*>* node = NULL;
         {
-            std::lock_guard<std::mutex> lock(mu_);
+            std::lock_guard<std::shared_mutex> lock(mu_);
             if (entry->refs_.load(std::memory_order_acquire) <= 0) {
                 node = entry->entries.SplitByPos(keep_cnt);
             }
@@ -508,9 +698,13 @@ void Segment::GcAllType(const std::map<uint32_t, TTLSt>& ttl_st_map, uint64_t& g
                         uint64_t& gc_record_byte_size) {
     uint64_t old = gc_idx_cnt;
     uint64_t consumed = ::baidu::common::timer::get_micros();
+    uint64_t visited_cnt = 0;
     KeyEntries::Iterator* it = entries_->NewIterator();
-    it->SeekToFirst();
+    SeekGcCursor(it);
     while (it->Valid()) {
+        if (ReachGcLimit(it, visited_cnt++)) {
+            break;
+        }
         KeyEntry** entry_arr = (KeyEntry**)it->GetValue();  // NOLINT
         Slice key = it->GetKey();
         it->Next();
@@ -525,15 +719,14 @@ void Segment::GcAllType(const std::map<uint32_t, TTLSt>& ttl_st_map, uint64_t& g
             }
             KeyEntry* entry = entry_arr[pos->second];
             ::openmldb::base::Node<uint64_t, DataBlock*>* node = NULL;
+            uint64_t last_time = 0;
             bool continue_flag = false;
             switch (kv.second.ttl_type) {
                 case ::openmldb::storage::TTLType::kAbsoluteTime: {
-                    node = entry->entries.GetLast();
-                    if (node == NULL || node->GetKey() > kv.second.abs_ttl) {
+                    if (!entry->entries.GetLastTime(&last_time) || last_time > kv.second.abs_ttl) {
                         continue_flag = true;
                     } else {
-                        node = NULL;
-                        std::lock_guard<std::mutex> lock(mu_);
+                        std::lock_guard<std::shared_mutex> lock(mu_);
                         SplitList(entry, kv.second.abs_ttl, &node);
                         if (entry->entries.IsEmpty()) {
                             empty_cnt++;
@@ -542,19 +735,17 @@ void Segment::GcAllType(const std::map<uint32_t, TTLSt>& ttl_st_map, uint64_t& g
                     break;
                 }
                 case ::openmldb::storage::TTLType::kLatestTime: {
-                    std::lock_guard<std::mutex> lock(mu_);
+                    std::lock_guard<std::shared_mutex> lock(mu_);
                     if (entry->refs_.load(std::memory_order_acquire) <= 0) {
                         node = entry->entries.SplitByPos(kv.second.lat_ttl);
                     }
                     break;
                 }
                 case ::openmldb::storage::TTLType::kAbsAndLat: {
-                    node = entry->entries.GetLast();
-                    if (node == NULL || node->GetKey() > kv.second.abs_ttl) {
+                    if (!entry->entries.GetLastTime(&last_time) || last_time > kv.second.abs_ttl) {
                         continue_flag = true;
                     } else {
-                        node = NULL;
-                        std::lock_guard<std::mutex> lock(mu_);
+                        std::lock_guard<std::shared_mutex> lock(mu_);
                         if (entry->refs_.load(std::memory_order_acquire) <= 0) {
                             node = entry->entries.SplitByKeyAndPos(kv.second.abs_ttl, kv.second.lat_ttl);
                         }
@@ -562,12 +753,10 @@ void Segment::GcAllType(const std::map<uint32_t, TTLSt>& ttl_st_map, uint64_t& g
                     break;
                 }
                 case ::openmldb::storage::TTLType::kAbsOrLat: {
-                    node = entry->entries.GetLast();
-                    if (node == NULL) {
+                    if (!entry->entries.GetLastTime(&last_time)) {
                         continue_flag = true;
                     } else {
-                        node = NULL;
-                        std::lock_guard<std::mutex> lock(mu_);
+                        std::lock_guard<std::shared_mutex> lock(mu_);
                         if (entry->refs_.load(std::memory_order_acquire) <= 0) {
                             if (kv.second.abs_ttl == 0) {
                                 node = entry->entries.SplitByPos(kv.second.lat_ttl);
@@ -599,7 +788,7 @@ void Segment::GcAllType(const std::map<uint32_t, TTLSt>& ttl_st_map, uint64_t& g
             bool is_empty = true;
             ::openmldb::base::Node<Slice, void*>* entry_node = NULL;
             {
-                std::lock_guard<std::mutex> lock(mu_);
+                std::lock_guard<std::shared_mutex> lock(mu_);
                 for (uint32_t i = 0; i < ts_cnt_; i++) {
                     if (!entry_arr[i]->entries.IsEmpty()) {
                         is_empty = false;
@@ -621,6 +810,29 @@ void Segment::GcAllType(const std::map<uint32_t, TTLSt>& ttl_st_map, uint64_t& g
     delete it;
 }
 
+void Segment::SeekGcCursor(KeyEntries::Iterator* it) {
+    if (gc_resume_) {
+        it->Seek(Slice(gc_cursor_));
+        gc_resume_ = false;
+    } else {
+        it->SeekToFirst();
+    }
+}
+
+bool Segment::ReachGcLimit(KeyEntries::Iterator* it, uint64_t visited_cnt) {
+    if (visited_cnt == 0) {
+        return false;
+    }
+    // check the time every 64 keys
+    if ((gc_max_keys_ > 0 && visited_cnt >= gc_max_keys_) ||
+        (gc_deadline_us_ > 0 && visited_cnt % 64 == 0 && ::baidu::common::timer::get_micros() >= gc_deadline_us_)) {
+        gc_cursor_.assign(it->GetKey().data(), it->GetKey().size());
+        gc_in_progress_ = true;
+        return true;
+    }
+    return false;
+}
+
 void Segment::SplitList(KeyEntry* entry, uint64_t ts, ::openmldb::base::Node<uint64_t, DataBlock*>** node) {
     // skip entry that ocupied by reader
     if (entry->refs_.load(std::memory_order_acquire) <= 0) {
@@ -628,31 +840,127 @@ void Segment::SplitList(KeyEntry* entry, uint64_t ts, ::openmldb::base::Node<uin
     }
 }
 
+void Segment::Spill(const uint64_t time, SpillTarget* target, uint64_t max_keys, uint64_t max_rows,
+                    uint64_t deadline_us, uint64_t& spill_idx_cnt, uint64_t& spill_record_cnt,
+                    uint64_t& spill_record_byte_size) {
+    bool resume = spill_in_progress_;
+    spill_in_progress_ = false;
+    if (ts_cnt_ > 1 || time == 0) {
+        return;
+    }
+    uint64_t consumed = ::baidu::common::timer::get_micros();
+    uint64_t old = spill_idx_cnt;
+    uint64_t visited_cnt = 0;
+    std::string buf;
+    std::vector<uint64_t> written;
+    KeyEntries::Iterator* it = entries_->NewIterator();
+    if (resume) {
+        it->Seek(Slice(spill_cursor_));
+    } else {
+        it->SeekToFirst();
+    }
+    while (it->Valid()) {
+        // the rows of one key are written to target at once, so the time is checked for every key
+        if (visited_cnt > 0 && ((max_keys > 0 && visited_cnt >= max_keys) ||
+                                (max_rows > 0 && spill_idx_cnt - old >= max_rows) ||
+                                (deadline_us > 0 && ::baidu::common::timer::get_micros() >= deadline_us))) {
+            spill_cursor_.assign(it->GetKey().data(), it->GetKey().size());
+            spill_in_progress_ = true;
+            break;
+        }
+        visited_cnt++;
+        KeyEntry* entry = (KeyEntry*)it->GetValue();  // NOLINT
+        Slice key = it->GetKey();
+        it->Next();
+        uint64_t last_time = 0;
+        if (!entry->entries.GetLastTime(&last_time)) {
+            if (target->Contains(key)) {
+                continue;
+            }
+            ::openmldb::base::Node<Slice, void*>* entry_node = NULL;
+            {
+                std::lock_guard<std::shared_mutex> lock(mu_);
+                if (entry->entries.IsEmpty()) {
+                    entry_node = entries_->Remove(key);
+                }
+            }
+            if (entry_node != NULL) {
+                std::lock_guard<std::mutex> lock(gc_mu_);
+                entry_free_list_->Insert(gc_version_.load(std::memory_order_relaxed), entry_node);
+            }
+            continue;
+        } else if (last_time >= time) {
+            continue;
+        }
+        // write the rows before they are removed from memory, so the readers always find them
+        written.clear();
+        TimeEntries::Iterator* time_it = entry->entries.NewIterator();
+        time_it->Seek(time - 1);
+        while (time_it->Valid()) {
+            target->Put(key, time_it->GetKey(), time_it->GetValue()->GetRow(&buf, compress_stat_));
+            written.push_back(time_it->GetKey());
+            time_it->Next();
+        }
+        delete time_it;
+        if (!target->Commit()) {
+            continue;
+        }
+        ::openmldb::base::Node<uint64_t, DataBlock*>* node = NULL;
+        {
+            std::lock_guard<std::shared_mutex> lock(mu_);
+            SplitList(entry, time - 1, &node);
+        }
+        // the rows put between writing and splitting
+        size_t pos = 0;
+        for (auto cur = node; cur != NULL; cur = cur->GetNextNoBarrier(0)) {
+            while (pos < written.size() && written[pos] > cur->GetKey()) {
+                pos++;
+            }
+            if (pos >= written.size() || written[pos] != cur->GetKey()) {
+                target->Put(key, cur->GetKey(), cur->GetValue()->GetRow(&buf, compress_stat_));
+            }
+        }
+        target->Commit();
+        uint64_t entry_spill_idx_cnt = 0;
+        FreeList(node, entry_spill_idx_cnt, spill_record_cnt, spill_record_byte_size);
+        entry->count_.fetch_sub(entry_spill_idx_cnt, std::memory_order_relaxed);
+        spill_idx_cnt += entry_spill_idx_cnt;
+    }
+    DEBUGLOG("[Spill] segment spill time %lu consumed %lu, count %lu", time,
+             (::baidu::common::timer::get_micros() - consumed) / 1000, spill_idx_cnt - old);
+    idx_cnt_.fetch_sub(spill_idx_cnt - old, std::memory_order_relaxed);
+    delete it;
+}
+
 // fast gc with no global pause
 void Segment::Gc4TTL(const uint64_t time, uint64_t& gc_idx_cnt, uint64_t& gc_record_cnt,
                      uint64_t& gc_record_byte_size) {
     uint64_t consumed = ::baidu::common::timer::get_micros();
     uint64_t old = gc_idx_cnt;
+    uint64_t visited_cnt = 0;
     KeyEntries::Iterator* it = entries_->NewIterator();
-    it->SeekToFirst();
+    SeekGcCursor(it);
     while (it->Valid()) {
+        if (ReachGcLimit(it, visited_cnt++)) {
+            break;
+        }
         KeyEntry* entry = (KeyEntry*)it->GetValue();  // NOLINT
         Slice key = it->GetKey();
         it->Next();
-        ::openmldb::base::Node<uint64_t, DataBlock*>* node = entry->entries.GetLast();
-        if (node == NULL) {
+        uint64_t last_time = 0;
+        if (!entry->entries.GetLastTime(&last_time)) {
             continue;
-        } else if (node->GetKey() > time) {
+        } else if (last_time > time) {
             DEBUGLOG(
                 "[Gc4TTL] segment gc with key %lu need not ttl, last node "
                 "key %lu",
-                time, node->GetKey());
+                time, last_time);
             continue;
         }
-        node = NULL;
+        ::openmldb::base::Node<uint64_t, DataBlock*>* node = NULL;
         ::openmldb::base::Node<Slice, void*>* entry_node = NULL;
         {
-            std::lock_guard<std::mutex> lock(mu_);
+            std::lock_guard<std::shared_mutex> lock(mu_);
             SplitList(entry, time, &node);
             if (entry->entries.IsEmpty()) {
                 entry_node = entries_->Remove(key);
@@ -681,24 +989,28 @@ void Segment::Gc4TTLAndHead(const uint64_t time, const uint64_t keep_cnt, uint64
     }
     uint64_t consumed = ::baidu::common::timer::get_micros();
     uint64_t old = gc_idx_cnt;
+    uint64_t visited_cnt = 0;
     KeyEntries::Iterator* it = entries_->NewIterator();
-    it->SeekToFirst();
+    SeekGcCursor(it);
     while (it->Valid()) {
+        if (ReachGcLimit(it, visited_cnt++)) {
+            break;
+        }
         KeyEntry* entry = (KeyEntry*)it->GetValue();  // NOLINT
-        ::openmldb::base::Node<uint64_t, DataBlock*>* node = entry->entries.GetLast();
+        uint64_t last_time = 0;
         it->Next();
-        if (node == NULL) {
+        if (!entry->entries.GetLastTime(&last_time)) {
             continue;
-        } else if (node->GetKey() > time) {
+        } else if (last_time > time) {
             DEBUGLOG(
                 "[Gc4TTLAndHead] segment gc with key %lu need not ttl, last "
                 "node key %lu",
-                time, node->GetKey());
+                time, last_time);
             continue;
         }
-        node = NULL;
+        ::openmldb::base::Node<uint64_t, DataBlock*>* node = NULL;
         {
-            std::lock_guard<std::mutex> lock(mu_);
+            std::lock_guard<std::shared_mutex> lock(mu_);
             if (entry->refs_.load(std::memory_order_acquire) <= 0) {
                 node = entry->entries.SplitByKeyAndPos(time, keep_cnt);
             }
@@ -730,20 +1042,24 @@ void Segment::Gc4TTLOrHead(const uint64_t time, const uint64_t keep_cnt, uint64_
     }
     uint64_t consumed = ::baidu::common::timer::get_micros();
     uint64_t old = gc_idx_cnt;
+    uint64_t visited_cnt = 0;
     KeyEntries::Iterator* it = entries_->NewIterator();
-    it->SeekToFirst();
+    SeekGcCursor(it);
     while (it->Valid()) {
+        if (ReachGcLimit(it, visited_cnt++)) {
+            break;
+        }
         KeyEntry* entry = (KeyEntry*)it->GetValue();  // NOLINT
         Slice key = it->GetKey();
         it->Next();
-        ::openmldb::base::Node<uint64_t, DataBlock*>* node = entry->entries.GetLast();
-        if (node == NULL) {
+        uint64_t last_time = 0;
+        if (!entry->entries.GetLastTime(&last_time)) {
             continue;
         }
-        node = NULL;
+        ::openmldb::base::Node<uint64_t, DataBlock*>* node = NULL;
         ::openmldb::base::Node<Slice, void*>* entry_node = NULL;
         {
-            std::lock_guard<std::mutex> lock(mu_);
+            std::lock_guard<std::shared_mutex> lock(mu_);
             if (entry->refs_.load(std::memory_order_acquire) <= 0) {
                 node = entry->entries.SplitByKeyOrPos(time, keep_cnt);
             }
@@ -807,7 +1123,7 @@ MemTableIterator* Segment::NewIterator(const Slice& key, Ticket& ticket) {
         return new MemTableIterator(NULL);
     }
     ticket.Push((KeyEntry*)entry);                                           // NOLINT
-    return new MemTableIterator(((KeyEntry*)entry)->entries.NewIterator());  // NOLINT
+    return new MemTableIterator(((KeyEntry*)entry)->entries.NewIterator(), compress_stat_);  // NOLINT
 }
 
 MemTableIterator* Segment::NewIterator(const Slice& key, uint32_t idx, Ticket& ticket) {
@@ -823,10 +1139,14 @@ MemTableIterator* Segment::NewIterator(const Slice& key, uint32_t idx, Ticket& t
         return new MemTableIterator(NULL);
     }
     ticket.Push(((KeyEntry**)entry_arr)[pos->second]);                                         // NOLINT
-    return new MemTableIterator(((KeyEntry**)entry_arr)[pos->second]->entries.NewIterator());  // NOLINT
+    return new MemTableIterator(((KeyEntry**)entry_arr)[pos->second]->entries.NewIterator(),  // NOLINT
+                                compress_stat_);
 }
 
-MemTableIterator::MemTableIterator(TimeEntries::Iterator* it) : it_(it) {}
+MemTableIterator::MemTableIterator(TimeEntries::Iterator* it) : it_(it), compress_stat_(NULL) {}
+
+MemTableIterator::MemTableIterator(TimeEntries::Iterator* it, CompressStat* compress_stat)
+    : it_(it), compress_stat_(compress_stat) {}
 
 MemTableIterator::~MemTableIterator() {
     if (it_ != NULL) {
@@ -855,9 +1175,7 @@ void MemTableIterator::Next() {
     it_->Next();
 }
 
-::openmldb::base::Slice MemTableIterator::GetValue() const {
-    return ::openmldb::base::Slice(it_->GetValue()->data, it_->GetValue()->size);
-}
+::openmldb::base::Slice MemTableIterator::GetValue() const { return it_->GetValue()->GetRow(&buf_, compress_stat_); }
 
 uint64_t MemTableIterator::GetKey() const { return it_->GetKey(); }
 
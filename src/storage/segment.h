@@ -21,6 +21,9 @@
 #include <map>
 #include <memory>
 #include <mutex>  // NOLINT
+#include <new>
+#include <shared_mutex>  // NOLINT
+#include <string>
 #include <vector>
 
 #include "base/skiplist.h"
@@ -29,6 +32,7 @@
 #include "storage/iterator.h"
 #include "storage/schema.h"
 #include "storage/ticket.h"
+#include "storage/time_entries.h"
 
 namespace openmldb {
 namespace storage {
@@ -40,19 +44,34 @@ using ::openmldb::base::Slice;
 class Segment;
 class Ticket;
 
+// the stat of rows compressed in memory, it's shared by all segments of one table
+struct CompressStat {
+    // the count and saved bytes of compressed rows which are not deleted
+    std::atomic<uint64_t> record_cnt{0};
+    std::atomic<uint64_t> saved_byte_size{0};
+    // the decode time in ns of the sampled rows
+    std::atomic<uint64_t> sampled_decode_cnt{0};
+    std::atomic<uint64_t> sampled_decode_time{0};
+};
+
 struct DataBlock {
     // dimension count down
     uint8_t dim_cnt_down;
+    // the payload is placed right after the block
+    bool inline_data;
+    // the payload is compressed by snappy
+    bool compressed;
     uint32_t size;
     char* data;
 
-    DataBlock(uint8_t dim_cnt, const char* input, uint32_t len) : dim_cnt_down(dim_cnt), size(len), data(NULL) {
+    DataBlock(uint8_t dim_cnt, const char* input, uint32_t len)
+        : dim_cnt_down(dim_cnt), inline_data(false), compressed(false), size(len), data(NULL) {
         data = new char[len];
         memcpy(data, input, len);
     }
 
     DataBlock(uint8_t dim_cnt, char* input, uint32_t len, bool skip_copy)
-        : dim_cnt_down(dim_cnt), size(len), data(NULL) {
+        : dim_cnt_down(dim_cnt), inline_data(false), compressed(false), size(len), data(NULL) {
         if (skip_copy) {
             data = input;
         } else {
@@ -61,30 +80,42 @@ struct DataBlock {
         }
     }
 
-    ~DataBlock() {
-        delete[] data;
-        data = NULL;
+    // Allocate the block and a copy of input with one allocation, the result can be released with delete
+    static DataBlock* NewInline(uint8_t dim_cnt, const char* input, uint32_t len) {
+        char* buf = static_cast<char*>(::operator new(sizeof(DataBlock) + len));
+        DataBlock* block = ::new (buf) DataBlock(dim_cnt, buf + sizeof(DataBlock), len, true);
+        block->inline_data = true;
+        memcpy(block->data, input, len);
+        return block;
     }
-};
 
-// the desc time comparator
-struct TimeComparator {
-    int operator()(const uint64_t& a, const uint64_t& b) const {
-        if (a > b) {
-            return -1;
-        } else if (a == b) {
-            return 0;
+    // Compress the input into an inline block, return NULL if it saves less than 1/8 of the input
+    static DataBlock* NewCompressed(uint8_t dim_cnt, const char* input, uint32_t len, CompressStat* stat);
+
+    // the size of the row after decoded
+    uint32_t GetDecodedSize() const;
+
+    // decode the row into dst which has GetDecodedSize() bytes at least
+    bool Decode(char* dst, CompressStat* stat) const;
+
+    // return the row which is decoded into buf if it's compressed
+    Slice GetRow(std::string* buf, CompressStat* stat) const;
+
+    // the allocated size differs from sizeof(DataBlock) for inline block
+    static void operator delete(void* ptr) { ::operator delete(ptr); }
+
+    ~DataBlock() {
+        if (!inline_data) {
+            delete[] data;
         }
-        return 1;
+        data = NULL;
     }
 };
 
-static const TimeComparator tcmp;
-typedef ::openmldb::base::Skiplist<uint64_t, DataBlock*, TimeComparator> TimeEntries;
-
 class MemTableIterator : public TableIterator {
  public:
     explicit MemTableIterator(TimeEntries::Iterator* it);
+    MemTableIterator(TimeEntries::Iterator* it, CompressStat* compress_stat);
     virtual ~MemTableIterator();
     void Seek(const uint64_t time) override;
     bool Valid() override;
@@ -96,16 +127,21 @@ class MemTableIterator : public TableIterator {
 
  private:
     TimeEntries::Iterator* it_;
+    CompressStat* compress_stat_;
+    // the decoded row of compressed block
+    mutable std::string buf_;
 };
 
 class KeyEntry {
  public:
-    KeyEntry() : entries(12, 4, tcmp), refs_(0), count_(0) {}
-    explicit KeyEntry(uint8_t height) : entries(height, 4, tcmp), refs_(0), count_(0) {}
+    KeyEntry() : entries(12, true), refs_(0), count_(0) {}
+    explicit KeyEntry(uint8_t height) : entries(height, true), refs_(0), count_(0) {}
+    // the time entries are kept in skiplist from the beginning if inline is disabled
+    KeyEntry(uint8_t height, bool enable_inline) : entries(height, enable_inline), refs_(0), count_(0) {}
     ~KeyEntry() {}
 
-    // just return the count of datablock
-    uint64_t Release() {
+    // just return the count of datablock, the compressed rows deleted are removed from compress_stat
+    uint64_t Release(CompressStat* compress_stat = NULL) {
         uint64_t cnt = 0;
         TimeEntries::Iterator* it = entries.NewIterator();
         it->SeekToFirst();
@@ -116,6 +152,11 @@ class KeyEntry {
             if (block->dim_cnt_down > 1) {
                 block->dim_cnt_down--;
             } else {
+                if (block->compressed && compress_stat != NULL) {
+                    compress_stat->record_cnt.fetch_sub(1, std::memory_order_relaxed);
+                    compress_stat->saved_byte_size.fetch_sub(block->GetDecodedSize() - block->size,
+                                                             std::memory_order_relaxed);
+                }
                 delete block;
             }
             it->Next();
@@ -145,6 +186,17 @@ struct SliceComparator {
 typedef ::openmldb::base::Skiplist<::openmldb::base::Slice, void*, SliceComparator> KeyEntries;
 typedef ::openmldb::base::Skiplist<uint64_t, ::openmldb::base::Node<Slice, void*>*, TimeComparator> KeyEntryNodeList;
 
+// the receiver of the rows moved out of memory
+class SpillTarget {
+ public:
+    virtual ~SpillTarget() {}
+    virtual void Put(const Slice& key, uint64_t time, const Slice& row) = 0;
+    // write the rows put since the last commit
+    virtual bool Commit() = 0;
+    // whether the key still has rows not expired
+    virtual bool Contains(const Slice& key) = 0;
+};
+
 class Segment {
  public:
     Segment();
@@ -194,6 +246,15 @@ class Segment {
     void GcAllType(const std::map<uint32_t, TTLSt>& ttl_st_map, uint64_t& gc_idx_cnt,  // NOLINT
                    uint64_t& gc_record_cnt,                                            // NOLINT
                    uint64_t& gc_record_byte_size);                                     // NOLINT
+    // Move the rows older than time to target and free them from memory. The key is kept after all of
+    // its rows are moved, and it's removed once target does not contain it.
+    // The spill stops once it visits max_keys keys, moves max_rows rows or reaches deadline_us, 0 means
+    // no limit, and the next call continues from the unvisited key
+    void Spill(const uint64_t time, SpillTarget* target, uint64_t max_keys, uint64_t max_rows,  // NOLINT
+               uint64_t deadline_us, uint64_t& spill_idx_cnt,                                   // NOLINT
+               uint64_t& spill_record_cnt,                                                      // NOLINT
+               uint64_t& spill_record_byte_size);                                               // NOLINT
+    bool IsSpillInProgress() const { return spill_in_progress_; }
     MemTableIterator* NewIterator(const Slice& key, Ticket& ticket);                   // NOLINT
     MemTableIterator* NewIterator(const Slice& key, uint32_t idx,
                                   Ticket& ticket);  // NOLINT
@@ -241,6 +302,19 @@ class Segment {
 
     void IncrGcVersion() { gc_version_.fetch_add(1, std::memory_order_relaxed); }
 
+    // Limit the keys visited and the time used by the next gc call, 0 means no limit.
+    // The gc stopped by the limit will continue from the unvisited key in the next call
+    void SetGcLimit(uint64_t max_keys, uint64_t deadline_us) {
+        gc_max_keys_ = max_keys;
+        gc_deadline_us_ = deadline_us;
+    }
+
+    bool IsGcInProgress() const { return gc_in_progress_; }
+
+    // the stat is updated when the compressed rows are read or deleted
+    void SetCompressStat(CompressStat* compress_stat) { compress_stat_ = compress_stat; }
+    CompressStat* GetCompressStat() const { return compress_stat_; }
+
     void ReleaseAndCount(uint64_t& gc_idx_cnt,            // NOLINT
                          uint64_t& gc_record_cnt,         // NOLINT
                          uint64_t& gc_record_byte_size);  // NOLINT
@@ -258,10 +332,21 @@ class Segment {
                    uint64_t& gc_record_cnt,         // NOLINT
                    uint64_t& gc_record_byte_size);  // NOLINT
 
+    void SeekGcCursor(KeyEntries::Iterator* it);
+    // return true and save the cursor if the gc reaches the limit
+    bool ReachGcLimit(KeyEntries::Iterator* it, uint64_t visited_cnt);
+
+    // return the KeyEntry (or KeyEntry array if ts_cnt_ > 1) of key, need the shared lock of mu_
+    void* GetOrInsertEntryConcurrently(const Slice& key, uint32_t& byte_size);  // NOLINT
+
+    // insert into the time entries of entry under the exclusive lock of mu_, return the index bytes it takes
+    uint32_t InsertTimeEntry(KeyEntry* entry, uint64_t time, DataBlock* row);
+
  private:
     KeyEntries* entries_;
-    // only Put need mutex
-    std::mutex mu_;
+    // Put and gc need mutex. The concurrent put takes the shared lock and
+    // the others take the exclusive lock
+    std::shared_mutex mu_;
     std::mutex gc_mu_;
     std::atomic<uint64_t> idx_cnt_;
     std::atomic<uint64_t> idx_byte_size_;
@@ -273,6 +358,17 @@ class Segment {
     std::map<uint32_t, uint32_t> ts_idx_map_;
     std::vector<std::shared_ptr<std::atomic<uint64_t>>> idx_cnt_vec_;
     uint64_t ttl_offset_;
+    bool concurrent_put_;
+    // the key where the unfinished gc continues
+    std::string gc_cursor_;
+    bool gc_in_progress_;
+    bool gc_resume_;
+    uint64_t gc_max_keys_;
+    uint64_t gc_deadline_us_;
+    // the key where the unfinished spill continues
+    std::string spill_cursor_;
+    bool spill_in_progress_;
+    CompressStat* compress_stat_;
 };
 
 }  // namespace storage
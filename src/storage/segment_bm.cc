@@ -0,0 +1,115 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gflags/gflags.h>
+
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "storage/record.h"
+#include "storage/segment.h"
+
+DECLARE_bool(enable_concurrent_put);
+
+namespace openmldb {
+namespace storage {
+
+static const uint32_t KEY_NUM = 1000;
+
+static std::vector<std::string> GenKeys() {
+    std::vector<std::string> keys;
+    for (uint32_t i = 0; i < KEY_NUM; i++) {
+        keys.push_back("key" + std::to_string(i));
+    }
+    return keys;
+}
+
+static void BM_DataBlockNew(benchmark::State& state) {  // NOLINT
+    std::string value(state.range(0), 'a');
+    for (auto _ : state) {
+        auto* block = new DataBlock(1, value.c_str(), value.length());
+        benchmark::DoNotOptimize(block);
+        delete block;
+    }
+}
+
+static void BM_DataBlockNewInline(benchmark::State& state) {  // NOLINT
+    std::string value(state.range(0), 'a');
+    for (auto _ : state) {
+        auto* block = DataBlock::NewInline(1, value.c_str(), value.length());
+        benchmark::DoNotOptimize(block);
+        delete block;
+    }
+}
+
+// put rows into one segment and report the index and record memory used by each row
+static void BM_SegmentPut(benchmark::State& state) {  // NOLINT
+    std::string value(state.range(0), 'a');
+    auto keys = GenKeys();
+    uint64_t ts = 1;
+    uint64_t row_cnt = 0;
+    uint64_t byte_size = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto* segment = new Segment();
+        state.ResumeTiming();
+        for (uint32_t i = 0; i < KEY_NUM * 10; i++) {
+            segment->Put(Slice(keys[i % KEY_NUM]), ts++, value.c_str(), value.length());
+        }
+        state.PauseTiming();
+        row_cnt += KEY_NUM * 10;
+        byte_size += segment->GetIdxByteSize() + KEY_NUM * 10 * GetRecordSize(value.length());
+        segment->Release();
+        delete segment;
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(row_cnt);
+    state.counters["bytes_per_row"] = row_cnt == 0 ? 0 : static_cast<double>(byte_size) / row_cnt;
+}
+
+// multi writers put into one segment, range(0) selects the concurrent put mode
+static Segment* shared_segment = nullptr;
+static void BM_SegmentMultiThreadPut(benchmark::State& state) {  // NOLINT
+    if (state.thread_index == 0) {
+        FLAGS_enable_concurrent_put = state.range(0) == 1;
+        shared_segment = new Segment();
+    }
+    std::string value(128, 'a');
+    auto keys = GenKeys();
+    uint64_t ts = static_cast<uint64_t>(state.thread_index) << 40;
+    uint32_t idx = state.thread_index;
+    for (auto _ : state) {
+        shared_segment->Put(Slice(keys[idx++ % KEY_NUM]), ts++, value.c_str(), value.length());
+    }
+    state.SetItemsProcessed(state.iterations());
+    if (state.thread_index == 0) {
+        shared_segment->Release();
+        delete shared_segment;
+        shared_segment = nullptr;
+        FLAGS_enable_concurrent_put = false;
+    }
+}
+
+BENCHMARK(BM_DataBlockNew)->Arg(64)->Arg(256)->Arg(1024);
+BENCHMARK(BM_DataBlockNewInline)->Arg(64)->Arg(256)->Arg(1024);
+BENCHMARK(BM_SegmentPut)->Arg(64)->Arg(256)->Arg(1024);
+BENCHMARK(BM_SegmentMultiThreadPut)->Arg(0)->Arg(1)->ThreadRange(1, 64)->UseRealTime();
+
+}  // namespace storage
+}  // namespace openmldb
+
+BENCHMARK_MAIN();
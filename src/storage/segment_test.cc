@@ -16,8 +16,14 @@
 
 #include "storage/segment.h"
 
+#include <gflags/gflags.h>
+
 #include <iostream>
+#include <map>
+#include <memory>
 #include <string>
+#include <thread>  // NOLINT
+#include <vector>
 
 #include "base/glog_wapper.h"  // NOLINT
 #include "base/slice.h"
@@ -26,6 +32,8 @@
 
 using ::openmldb::base::Slice;
 
+DECLARE_bool(enable_concurrent_put);
+
 namespace openmldb {
 namespace storage {
 
@@ -37,7 +45,7 @@ class SegmentTest : public ::testing::Test {
 
 TEST_F(SegmentTest, Size) {
     ASSERT_EQ(16, (int64_t)sizeof(DataBlock));
-    ASSERT_EQ(40, (int64_t)sizeof(KeyEntry));
+    ASSERT_EQ(48, (int64_t)sizeof(KeyEntry));
 }
 
 TEST_F(SegmentTest, DataBlock) {
@@ -51,6 +59,62 @@ TEST_F(SegmentTest, DataBlock) {
     delete db;
 }
 
+TEST_F(SegmentTest, InlineDataBlock) {
+    const char* test = "test";
+    DataBlock* db = DataBlock::NewInline(2, test, 4);
+    ASSERT_TRUE(db->inline_data);
+    ASSERT_EQ(2, (int64_t)db->dim_cnt_down);
+    ASSERT_EQ(4, (int64_t)db->size);
+    ASSERT_EQ(reinterpret_cast<char*>(db) + sizeof(DataBlock), db->data);
+    ASSERT_EQ(std::string(test, 4), std::string(db->data, db->size));
+    delete db;
+}
+
+TEST_F(SegmentTest, CompressedDataBlock) {
+    CompressStat stat;
+    ASSERT_TRUE(DataBlock::NewCompressed(1, "test", 4, &stat) == NULL);
+    std::string value(1024, 'a');
+    DataBlock* db = DataBlock::NewCompressed(1, value.c_str(), value.size(), &stat);
+    ASSERT_TRUE(db != NULL);
+    ASSERT_TRUE(db->compressed);
+    ASSERT_TRUE(db->inline_data);
+    ASSERT_LT(db->size, value.size());
+    ASSERT_EQ(value.size(), db->GetDecodedSize());
+    ASSERT_EQ(1u, stat.record_cnt.load());
+    ASSERT_EQ(value.size() - db->size, stat.saved_byte_size.load());
+
+    Segment segment;
+    segment.SetCompressStat(&stat);
+    Slice pk("pk");
+    segment.Put(pk, 9527, db);
+    DataBlock* raw_db = DataBlock::NewInline(1, "test", 4);
+    segment.Put(pk, 9528, raw_db);
+    Ticket ticket;
+    std::unique_ptr<MemTableIterator> it(segment.NewIterator(pk, ticket));
+    it->SeekToFirst();
+    ASSERT_TRUE(it->Valid());
+    ASSERT_EQ("test", it->GetValue().ToString());
+    it->Next();
+    ASSERT_TRUE(it->Valid());
+    ASSERT_EQ(value, it->GetValue().ToString());
+    it.reset();
+    ticket.Pop();
+
+    uint64_t gc_idx_cnt = 0;
+    uint64_t gc_record_cnt = 0;
+    uint64_t gc_record_byte_size = 0;
+    segment.Gc4TTL(9527, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    ASSERT_EQ(1u, gc_record_cnt);
+    ASSERT_EQ(0u, stat.record_cnt.load());
+    ASSERT_EQ(0u, stat.saved_byte_size.load());
+
+    segment.Put(pk, 9529, DataBlock::NewCompressed(1, value.c_str(), value.size(), &stat));
+    ASSERT_EQ(1u, stat.record_cnt.load());
+    segment.Release();
+    ASSERT_EQ(0u, stat.record_cnt.load());
+    ASSERT_EQ(0u, stat.saved_byte_size.load());
+}
+
 TEST_F(SegmentTest, PutAndGet) {
     Segment segment;
     const char* test = "test";
@@ -407,6 +471,182 @@ TEST_F(SegmentTest, PutAndGetTS) {
     ASSERT_EQ(e, t);
 }
 
+TEST_F(SegmentTest, ConcurrentPut) {
+    FLAGS_enable_concurrent_put = true;
+    Segment segment;
+    std::vector<std::thread> threads;
+    for (uint32_t tid = 0; tid < 4; tid++) {
+        threads.emplace_back([&segment, tid] {
+            for (uint32_t i = 0; i < 1000; i++) {
+                std::string pk = "pk" + std::to_string(i % 10);
+                segment.Put(Slice(pk), i * 4 + tid, "test1", 5);
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    FLAGS_enable_concurrent_put = false;
+    ASSERT_EQ(4000, (int64_t)segment.GetIdxCnt());
+    ASSERT_EQ(10, (int64_t)segment.GetPkCnt());
+    for (uint32_t i = 0; i < 10; i++) {
+        std::string pk = "pk" + std::to_string(i);
+        uint64_t count = 0;
+        ASSERT_EQ(0, segment.GetCount(Slice(pk), count));
+        ASSERT_EQ(400, (int64_t)count);
+    }
+    uint64_t gc_idx_cnt = 0;
+    uint64_t gc_record_cnt = 0;
+    uint64_t gc_record_byte_size = 0;
+    segment.Gc4Head(10, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    ASSERT_EQ(3900, (int64_t)gc_idx_cnt);
+    ASSERT_EQ(100, (int64_t)segment.GetIdxCnt());
+}
+
+TEST_F(SegmentTest, GcWithLimit) {
+    Segment segment;
+    for (int i = 0; i < 100; i++) {
+        std::string pk = "pk" + std::to_string(i);
+        for (uint64_t ts = 1; ts <= 10; ts++) {
+            segment.Put(Slice(pk), ts, "test1", 5);
+        }
+    }
+    ASSERT_EQ(1000, (int64_t)segment.GetIdxCnt());
+    TTLSt ttl_st(0, 2, ::openmldb::storage::kLatestTime);
+    uint64_t gc_idx_cnt = 0;
+    uint64_t gc_record_cnt = 0;
+    uint64_t gc_record_byte_size = 0;
+    segment.SetGcLimit(30, 0);
+    uint32_t step = 0;
+    do {
+        segment.ExecuteGc(ttl_st, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+        step++;
+    } while (segment.IsGcInProgress());
+    ASSERT_EQ(4u, step);
+    ASSERT_EQ(800, (int64_t)gc_idx_cnt);
+    ASSERT_EQ(200, (int64_t)segment.GetIdxCnt());
+    // the next round starts from the first key
+    segment.Put(Slice("pk0"), 11, "test1", 5);
+    segment.SetGcLimit(0, 0);
+    segment.ExecuteGc(ttl_st, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    ASSERT_FALSE(segment.IsGcInProgress());
+    ASSERT_EQ(801, (int64_t)gc_idx_cnt);
+    // the gc returning early drops the cursor, so the next one starts from the first key
+    segment.SetGcLimit(30, 0);
+    segment.ExecuteGc(ttl_st, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    ASSERT_TRUE(segment.IsGcInProgress());
+    segment.ExecuteGc(TTLSt(0, 0, ::openmldb::storage::kLatestTime), gc_idx_cnt, gc_record_cnt,
+                      gc_record_byte_size);
+    ASSERT_FALSE(segment.IsGcInProgress());
+    segment.Put(Slice("pk0"), 12, "test1", 5);
+    segment.SetGcLimit(0, 0);
+    segment.Gc4Head(2, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    uint64_t cnt = 0;
+    ASSERT_EQ(0, segment.GetCount(Slice("pk0"), cnt));
+    ASSERT_EQ(2u, cnt);
+}
+
+class MockSpillTarget : public SpillTarget {
+ public:
+    void Put(const Slice& key, uint64_t time, const Slice& row) override {
+        pending_.emplace_back(key.ToString() + "|" + std::to_string(time), row.ToString());
+    }
+    bool Commit() override {
+        if (fail_) {
+            pending_.clear();
+            return false;
+        }
+        for (const auto& kv : pending_) {
+            rows_[kv.first] = kv.second;
+        }
+        pending_.clear();
+        return true;
+    }
+    bool Contains(const Slice& key) override { return keep_key_; }
+
+    std::map<std::string, std::string> rows_;
+    bool fail_ = false;
+    bool keep_key_ = true;
+
+ private:
+    std::vector<std::pair<std::string, std::string>> pending_;
+};
+
+TEST_F(SegmentTest, Spill) {
+    Segment segment;
+    for (int i = 0; i < 10; i++) {
+        std::string pk = "pk" + std::to_string(i);
+        for (uint64_t ts = 1; ts <= 10; ts++) {
+            segment.Put(Slice(pk), ts, "test1", 5);
+        }
+    }
+    MockSpillTarget target;
+    uint64_t spill_idx_cnt = 0;
+    uint64_t spill_record_cnt = 0;
+    uint64_t spill_record_byte_size = 0;
+    target.fail_ = true;
+    segment.Spill(7, &target, 0, 0, 0, spill_idx_cnt, spill_record_cnt, spill_record_byte_size);
+    ASSERT_EQ(0u, spill_idx_cnt);
+    ASSERT_EQ(100, (int64_t)segment.GetIdxCnt());
+    target.fail_ = false;
+    segment.Spill(7, &target, 0, 0, 0, spill_idx_cnt, spill_record_cnt, spill_record_byte_size);
+    ASSERT_EQ(60u, spill_idx_cnt);
+    ASSERT_EQ(60u, spill_record_cnt);
+    ASSERT_EQ(60u * GetRecordSize(5), spill_record_byte_size);
+    ASSERT_EQ(40, (int64_t)segment.GetIdxCnt());
+    ASSERT_EQ(60u, target.rows_.size());
+    ASSERT_EQ("test1", target.rows_["pk3|6"]);
+    ASSERT_EQ(0u, target.rows_.count("pk3|7"));
+    uint64_t cnt = 0;
+    ASSERT_EQ(0, segment.GetCount(Slice("pk3"), cnt));
+    ASSERT_EQ(4u, cnt);
+    // the key whose rows are all in the target is kept
+    segment.Spill(11, &target, 0, 0, 0, spill_idx_cnt, spill_record_cnt, spill_record_byte_size);
+    ASSERT_EQ(0, (int64_t)segment.GetIdxCnt());
+    ASSERT_EQ(100u, target.rows_.size());
+    ASSERT_EQ(10, (int64_t)segment.GetPkCnt());
+    target.keep_key_ = false;
+    segment.Spill(11, &target, 0, 0, 0, spill_idx_cnt, spill_record_cnt, spill_record_byte_size);
+    segment.IncrGcVersion();
+    segment.IncrGcVersion();
+    uint64_t gc_idx_cnt = 0;
+    uint64_t gc_record_cnt = 0;
+    uint64_t gc_record_byte_size = 0;
+    segment.GcFreeList(gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    ASSERT_EQ(0, (int64_t)segment.GetPkCnt());
+}
+
+TEST_F(SegmentTest, SpillLimit) {
+    Segment segment;
+    for (int i = 0; i < 10; i++) {
+        std::string pk = "pk" + std::to_string(i);
+        for (uint64_t ts = 1; ts <= 10; ts++) {
+            segment.Put(Slice(pk), ts, "test1", 5);
+        }
+    }
+    MockSpillTarget target;
+    uint64_t spill_idx_cnt = 0;
+    uint64_t spill_record_cnt = 0;
+    uint64_t spill_record_byte_size = 0;
+    // stop after 12 rows are moved
+    segment.Spill(7, &target, 0, 12, 0, spill_idx_cnt, spill_record_cnt, spill_record_byte_size);
+    ASSERT_TRUE(segment.IsSpillInProgress());
+    ASSERT_EQ(12u, spill_idx_cnt);
+    // stop after 3 keys are visited
+    segment.Spill(7, &target, 3, 0, 0, spill_idx_cnt, spill_record_cnt, spill_record_byte_size);
+    ASSERT_TRUE(segment.IsSpillInProgress());
+    ASSERT_EQ(30u, spill_idx_cnt);
+    segment.Spill(7, &target, 0, 0, 0, spill_idx_cnt, spill_record_cnt, spill_record_byte_size);
+    ASSERT_FALSE(segment.IsSpillInProgress());
+    ASSERT_EQ(60u, spill_idx_cnt);
+    ASSERT_EQ(60u, target.rows_.size());
+    ASSERT_EQ(40, (int64_t)segment.GetIdxCnt());
+    // the deadline passed stops the spill after one key
+    segment.Spill(11, &target, 0, 0, 1, spill_idx_cnt, spill_record_cnt, spill_record_byte_size);
+    ASSERT_TRUE(segment.IsSpillInProgress());
+    ASSERT_EQ(64u, spill_idx_cnt);
+}
+
 }  // namespace storage
 }  // namespace openmldb
 
@@ -18,6 +18,7 @@
 #include <google/protobuf/io/zero_copy_stream_impl.h>
 #include <google/protobuf/text_format.h>
 #include <sched.h>
+#include <snappy.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <time.h>
@@ -35,6 +36,7 @@
 #include "log/status.h"
 #include "proto/tablet.pb.h"
 #include "storage/binlog.h"
+#include "storage/columnar_snapshot.h"
 #include "storage/mem_table.h"
 #include "storage/mem_table_snapshot.h"
 #include "storage/ticket.h"
@@ -42,6 +44,10 @@
 
 DECLARE_string(db_root_path);
 DECLARE_string(snapshot_compression);
+DECLARE_uint32(load_snapshot_split_mb);
+DECLARE_uint32(load_table_thread_num);
+DECLARE_string(snapshot_format);
+DECLARE_uint32(snapshot_block_rows);
 
 using ::openmldb::api::LogEntry;
 namespace openmldb {
@@ -722,6 +728,71 @@ TEST_F(SnapshotTest, Recover_only_snapshot) {
     ASSERT_FALSE(it->Valid());
 }
 
+TEST_F(SnapshotTest, Recover_snapshot_by_range) {
+    std::string snapshot_dir = FLAGS_db_root_path + "/2_3/snapshot";
+    ::openmldb::base::MkdirRecur(snapshot_dir);
+    std::string snapshot1 = "20170611.sdb";
+    if (FLAGS_snapshot_compression != "off") {
+        snapshot1.append(".");
+        snapshot1.append(FLAGS_snapshot_compression);
+    }
+    uint32_t cnt = 30000;
+    {
+        std::string full_path = snapshot_dir + "/" + snapshot1;
+        FILE* fd_w = fopen(full_path.c_str(), "ab+");
+        ASSERT_TRUE(fd_w != NULL);
+        ::openmldb::log::WritableFile* wf = ::openmldb::log::NewWritableFile(snapshot1, fd_w);
+        ::openmldb::log::Writer writer(FLAGS_snapshot_compression, wf);
+        for (uint32_t i = 0; i < cnt; i++) {
+            // some records are larger than a log block
+            std::string value = "value" + std::to_string(i) + std::string(i % 1000 == 0 ? 10000 : i % 200, 'a');
+            auto entry = ::openmldb::test::PackKVEntry(i + 1, "key" + std::to_string(i % 100), value, i + 1, 1);
+            std::string val;
+            ASSERT_TRUE(entry.SerializeToString(&val));
+            ::openmldb::log::Status status = writer.AddRecord(Slice(val.c_str(), val.size()));
+            ASSERT_TRUE(status.ok());
+        }
+        writer.EndLog();
+    }
+    uint32_t old_split_mb = FLAGS_load_snapshot_split_mb;
+    uint32_t old_thread_num = FLAGS_load_table_thread_num;
+    FLAGS_load_snapshot_split_mb = 1;
+    FLAGS_load_table_thread_num = 3;
+    std::map<std::string, uint32_t> mapping;
+    mapping.insert(std::make_pair("idx0", 0));
+    std::shared_ptr<MemTable> table =
+        std::make_shared<MemTable>("test", 2, 3, 8, mapping, 0, ::openmldb::type::TTLType::kAbsoluteTime);
+    table->Init();
+    LogParts* log_part = new LogParts(12, 4, scmp);
+    MemTableSnapshot snapshot(2, 3, log_part, FLAGS_db_root_path);
+    ASSERT_TRUE(snapshot.Init());
+    ASSERT_EQ(0, snapshot.GenManifest(snapshot1, cnt, cnt, 5));
+    uint64_t offset = 0;
+    ASSERT_TRUE(snapshot.Recover(table, offset));
+    FLAGS_load_snapshot_split_mb = old_split_mb;
+    FLAGS_load_table_thread_num = old_thread_num;
+    ASSERT_EQ(cnt, offset);
+    ASSERT_EQ(cnt, table->GetRecordCnt());
+    ::openmldb::api::RecoverStatus status;
+    snapshot.GetRecoverStatus(&status);
+    ASSERT_EQ(cnt, status.record_cnt());
+    ASSERT_GT(status.byte_size(), 2u * 1024 * 1024);
+    Ticket ticket;
+    std::unique_ptr<TableIterator> it(table->NewIterator("key0", ticket));
+    it->SeekToFirst();
+    uint32_t num = 0;
+    while (it->Valid()) {
+        uint32_t i = cnt - 100 - num * 100;
+        ASSERT_EQ(i + 1, it->GetKey());
+        std::string value_str(it->GetValue().data(), it->GetValue().size());
+        ASSERT_EQ("value" + std::to_string(i) + std::string(i % 1000 == 0 ? 10000 : i % 200, 'a'),
+                  ::openmldb::test::DecodeV(value_str));
+        num++;
+        it->Next();
+    }
+    ASSERT_EQ(cnt / 100, num);
+}
+
 TEST_F(SnapshotTest, MakeSnapshot) {
     LogParts* log_part = new LogParts(12, 4, scmp);
     MemTableSnapshot snapshot(1, 2, log_part, FLAGS_db_root_path);
@@ -854,6 +925,136 @@ TEST_F(SnapshotTest, MakeSnapshot) {
     ASSERT_EQ(7, (int64_t)manifest.term());
 }
 
+TEST_F(SnapshotTest, MakeColumnarSnapshot) {
+    std::string old_format = FLAGS_snapshot_format;
+    uint32_t old_block_rows = FLAGS_snapshot_block_rows;
+    FLAGS_snapshot_format = "columnar";
+    FLAGS_snapshot_block_rows = 7;
+    LogParts* log_part = new LogParts(12, 4, scmp);
+    MemTableSnapshot snapshot(20, 1, log_part, FLAGS_db_root_path);
+    ASSERT_TRUE(snapshot.Init());
+    std::map<std::string, uint32_t> mapping;
+    mapping.insert(std::make_pair("idx0", 0));
+    std::shared_ptr<MemTable> table =
+        std::make_shared<MemTable>("test", 20, 1, 8, mapping, 0, ::openmldb::type::TTLType::kAbsoluteTime);
+    table->Init();
+    uint64_t offset = 0;
+    uint32_t binlog_index = 0;
+    std::string log_path = FLAGS_db_root_path + "/20_1/binlog/";
+    std::string snapshot_path = FLAGS_db_root_path + "/20_1/snapshot/";
+    WriteHandle* wh = NULL;
+    RollWLogFile(&wh, log_part, log_path, binlog_index, offset++);
+    auto write_entries = [&](uint32_t start, uint32_t end) {
+        for (uint32_t i = start; i < end; i++) {
+            auto entry = ::openmldb::test::PackKVEntry(offset, "key" + std::to_string(i % 10),
+                                                       "value" + std::to_string(i), 1000 + i, 1);
+            std::string buffer;
+            entry.SerializeToString(&buffer);
+            ASSERT_TRUE(wh->Write(::openmldb::base::Slice(buffer)).ok());
+            offset++;
+        }
+        wh->Sync();
+    };
+    write_entries(0, 30);
+    uint64_t offset_value = 0;
+    ASSERT_EQ(0, snapshot.MakeSnapshot(table, offset_value, 0));
+    ASSERT_EQ(30u, offset_value);
+    // the second snapshot reads the rows of the first columnar snapshot
+    RollWLogFile(&wh, log_part, log_path, binlog_index, offset);
+    write_entries(30, 40);
+    ASSERT_EQ(0, snapshot.MakeSnapshot(table, offset_value, 0));
+    ASSERT_EQ(40u, offset_value);
+    FLAGS_snapshot_format = old_format;
+    FLAGS_snapshot_block_rows = old_block_rows;
+
+    ::openmldb::api::Manifest manifest;
+    ASSERT_EQ(0, snapshot.GetLocalManifest(snapshot_path + "MANIFEST", manifest));
+    ASSERT_EQ(40u, manifest.count());
+    ASSERT_TRUE(IsColumnarSnapshot(manifest.name()));
+
+    std::shared_ptr<MemTable> new_table =
+        std::make_shared<MemTable>("test", 20, 1, 8, mapping, 0, ::openmldb::type::TTLType::kAbsoluteTime);
+    new_table->Init();
+    MemTableSnapshot new_snapshot(20, 1, log_part, FLAGS_db_root_path);
+    ASSERT_TRUE(new_snapshot.Init());
+    uint64_t latest_offset = 0;
+    ASSERT_TRUE(new_snapshot.Recover(new_table, latest_offset));
+    ASSERT_EQ(40u, latest_offset);
+    ASSERT_EQ(40u, new_table->GetRecordCnt());
+    Ticket ticket;
+    std::unique_ptr<TableIterator> it(new_table->NewIterator("key0", ticket));
+    it->SeekToFirst();
+    for (uint32_t i : {30, 20, 10, 0}) {
+        ASSERT_TRUE(it->Valid());
+        ASSERT_EQ(1000u + i, it->GetKey());
+        std::string value_str(it->GetValue().data(), it->GetValue().size());
+        ASSERT_EQ("value" + std::to_string(i), ::openmldb::test::DecodeV(value_str));
+        it->Next();
+    }
+    ASSERT_FALSE(it->Valid());
+    delete wh;
+}
+
+TEST_F(SnapshotTest, ColumnarBlock) {
+    std::vector<::openmldb::api::LogEntry> entries;
+    auto entry = ::openmldb::test::PackKVEntry(1, "key1", "value1", 1001, 3);
+    entry.set_pk("key1");
+    auto ts_dim = entry.add_ts_dimensions();
+    ts_dim->set_idx(1);
+    ts_dim->set_ts(2001);
+    entries.push_back(entry);
+    entry = ::openmldb::test::PackKVEntry(2, "key0", "value2", 1002, 4);
+    entry.set_method_type(::openmldb::api::MethodType::kDelete);
+    entries.push_back(entry);
+    // the entry without dimensions is put by pk
+    entry.Clear();
+    entry.set_log_index(3);
+    entry.set_pk("key2");
+    entry.set_value("value3");
+    entries.push_back(entry);
+    std::string raw;
+    ASSERT_TRUE(ColumnarBlock::Encode(entries, NULL, &raw));
+    ColumnarBlock block;
+    ASSERT_TRUE(block.Decode(::openmldb::base::Slice(raw)));
+    ASSERT_EQ(3u, block.GetRowCnt());
+    ASSERT_TRUE(block.GetTsColumns().empty());
+    std::map<uint64_t, ::openmldb::api::LogEntry> decoded;
+    for (uint32_t row = 0; row < block.GetRowCnt(); row++) {
+        block.ToLogEntry(row, &entry);
+        decoded.emplace(entry.log_index(), entry);
+    }
+    ASSERT_EQ(3u, decoded.size());
+    for (const auto& expect : entries) {
+        ASSERT_EQ(expect.SerializeAsString(), decoded[expect.log_index()].SerializeAsString());
+    }
+
+    // the truncated or corrupt block fails to be decoded
+    ASSERT_FALSE(block.Decode(::openmldb::base::Slice(raw.data(), raw.size() - 1)));
+    ASSERT_FALSE(block.Decode(::openmldb::base::Slice(raw.data(), 8)));
+    std::string corrupt = raw;
+    uint32_t row_cnt = UINT32_MAX;
+    memcpy(&corrupt[1], &row_cnt, sizeof(row_cnt));
+    ASSERT_FALSE(block.Decode(::openmldb::base::Slice(corrupt)));
+    // the body of a block with one row has a huge dimension count
+    entries.resize(1);
+    ASSERT_TRUE(ColumnarBlock::Encode(entries, NULL, &raw));
+    ColumnarBlock one_row;
+    ASSERT_TRUE(one_row.Decode(::openmldb::base::Slice(raw)));
+    // log_index, time, term, method_type and flags are zero
+    std::string body(3 * 8 + 4 + 1, '\0');
+    uint32_t dim_cnt = 0x40000000;
+    uint32_t ts_dim_cnt = 0;
+    body.append(reinterpret_cast<const char*>(&dim_cnt), sizeof(dim_cnt));
+    body.append(reinterpret_cast<const char*>(&ts_dim_cnt), sizeof(ts_dim_cnt));
+    std::string compressed;
+    snappy::Compress(body.data(), body.size(), &compressed);
+    corrupt = raw.substr(0, 1 + 4 + 1);
+    uint32_t body_size = body.size();
+    corrupt.append(reinterpret_cast<const char*>(&body_size), sizeof(body_size));
+    corrupt.append(compressed);
+    ASSERT_FALSE(one_row.Decode(::openmldb::base::Slice(corrupt)));
+}
+
 TEST_F(SnapshotTest, MakeSnapshot_with_delete_index) {
     LogParts* log_part = new LogParts(12, 4, scmp);
     MemTableSnapshot snapshot(1, 3, log_part, FLAGS_db_root_path);
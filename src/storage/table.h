@@ -20,6 +20,7 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "codec/codec.h"
@@ -38,6 +39,8 @@ using Schema = google::protobuf::RepeatedPtrField<openmldb::common::ColumnDesc>;
 
 enum TableStat { kUndefined = 0, kNormal, kLoading, kMakingSnapshot, kSnapshotPaused };
 
+class WindowAggrCache;
+
 class Table {
  public:
     Table();
@@ -178,6 +181,24 @@ class Table {
 
     virtual int GetCount(uint32_t index, const std::string& pk, uint64_t& count) = 0; // NOLINT
 
+    // get at most limit latest rows of each pk on the index in one batch, the rows are in the ts desc order
+    // and the expired ones are skipped. complete[i] is false if pks[i] has more rows than limit.
+    // return false if the table does not support it, then the pks should be sought one by one
+    virtual bool BatchGet(uint32_t index, const std::vector<std::string>& pks, uint32_t limit,
+                          std::vector<std::vector<std::pair<uint64_t, std::string>>>* rows,
+                          std::vector<bool>* complete) {
+        return false;
+    }
+
+    // the incremental window aggregate of pre-aggr table, it is set by the aggregator which writes the table
+    void SetWindowAggrCache(const std::shared_ptr<WindowAggrCache>& cache) {
+        std::atomic_store_explicit(&window_aggr_cache_, cache, std::memory_order_release);
+    }
+
+    std::shared_ptr<WindowAggrCache> GetWindowAggrCache() {
+        return std::atomic_load_explicit(&window_aggr_cache_, std::memory_order_acquire);
+    }
+
  protected:
     void UpdateTTL();
     bool InitFromMeta();
@@ -197,6 +218,7 @@ class Table {
     std::shared_ptr<std::map<int32_t, std::shared_ptr<Schema>>> version_schema_;
     std::shared_ptr<std::map<int32_t, std::shared_ptr<codec::RowView>>> version_decoder_;
     std::shared_ptr<std::vector<::openmldb::storage::UpdateTTLMeta>> update_ttl_;
+    std::shared_ptr<WindowAggrCache> window_aggr_cache_;
 };
 
 }  // namespace storage
@@ -25,6 +25,7 @@
 #include "common/timer.h"
 #include "gtest/gtest.h"
 #include "storage/mem_table.h"
+#include "storage/record.h"
 #include "storage/ticket.h"
 #include "test/util.h"
 #include "storage/table.h"
@@ -38,6 +39,9 @@ DECLARE_string(ssd_root_path);
 DECLARE_string(hdd_root_path);
 DECLARE_uint32(max_traverse_cnt);
 DECLARE_int32(gc_safe_offset);
+DECLARE_uint32(hot_data_ttl);
+DECLARE_string(cold_tier_root_path);
+DECLARE_uint32(spill_max_rows);
 
 namespace openmldb {
 namespace storage {
@@ -383,7 +387,9 @@ TEST_P(TableTest, SchedGcHead) {
     ASSERT_EQ(1, (int64_t)table->GetRecordCnt());
     ASSERT_EQ(1, (int64_t)table->GetRecordIdxCnt());
     ASSERT_EQ(bytes, table->GetRecordByteSize());
-    ASSERT_EQ(record_idx_bytes, table->GetRecordIdxByteSize());
+    // the second put promotes the inline entry, the time entries list is kept after gc
+    auto mem_table = dynamic_cast<MemTable*>(table);
+    ASSERT_EQ(record_idx_bytes + GetRecordTsListSize(mem_table->GetKeyEntryHeight()), table->GetRecordIdxByteSize());
     delete table;
 }
 
@@ -471,7 +477,9 @@ TEST_P(TableTest, SchedGc) {
         ASSERT_EQ(1, (int64_t)table->GetRecordIdxCnt());
     }
     ASSERT_EQ(bytes, table->GetRecordByteSize());
-    ASSERT_EQ(record_idx_bytes, table->GetRecordIdxByteSize());
+    // the second put promotes the inline entry, the time entries list is kept after gc
+    auto mem_table = dynamic_cast<MemTable*>(table);
+    ASSERT_EQ(record_idx_bytes + GetRecordTsListSize(mem_table->GetKeyEntryHeight()), table->GetRecordIdxByteSize());
 
     Ticket ticket;
     TableIterator* it = table->NewIterator("test", ticket);
@@ -1641,6 +1649,55 @@ TEST_F(TableTest, Release) {
     delete table;
 }
 
+// the rows moved to cold tier are still read by the traverse iterator
+TEST_F(TableTest, TraverseColdTier) {
+    uint32_t old_hot_data_ttl = FLAGS_hot_data_ttl;
+    std::string old_cold_tier_root_path = FLAGS_cold_tier_root_path;
+    uint32_t old_spill_max_rows = FLAGS_spill_max_rows;
+    FLAGS_hot_data_ttl = 1;
+    FLAGS_cold_tier_root_path = FLAGS_hdd_root_path + "/cold_tier";
+    FLAGS_spill_max_rows = 5;
+    std::map<std::string, uint32_t> mapping;
+    mapping.insert(std::make_pair("idx0", 0));
+    MemTable* table = new MemTable("tx_log", ++counter, 1, 8, mapping, 0, ::openmldb::type::kAbsoluteTime);
+    ASSERT_TRUE(table->Init());
+    uint64_t now = ::baidu::common::timer::get_micros() / 1000;
+    for (int i = 0; i < 10; i++) {
+        std::string pk = "pk" + std::to_string(i);
+        table->Put(pk, now, "hot", 3);
+        table->Put(pk, now - 2 * 60 * 60 * 1000, "cold", 4);
+    }
+    for (int round = 1; round <= 2; round++) {
+        // at most spill_max_rows rows are moved in a gc round
+        table->SchedGc();
+        ASSERT_EQ(20 - round * 5, (int64_t)table->GetRecordCnt());
+        TraverseIterator* it = table->NewTraverseIterator(0);
+        it->SeekToFirst();
+        int count = 0;
+        while (it->Valid()) {
+            std::string value(it->GetValue().data(), it->GetValue().size());
+            if (count % 2 == 0) {
+                ASSERT_EQ(now, it->GetKey());
+                ASSERT_EQ("hot", value);
+            } else {
+                ASSERT_EQ(now - 2 * 60 * 60 * 1000, it->GetKey());
+                ASSERT_EQ("cold", value);
+            }
+            count++;
+            it->Next();
+        }
+        ASSERT_EQ(20, count);
+        delete it;
+    }
+    ::openmldb::api::ColdTierStatus status;
+    table->GetColdTierStatus(&status);
+    ASSERT_EQ(10u, status.spill_record_cnt());
+    delete table;
+    FLAGS_hot_data_ttl = old_hot_data_ttl;
+    FLAGS_cold_tier_root_path = old_cold_tier_root_path;
+    FLAGS_spill_max_rows = old_spill_max_rows;
+}
+
 TEST_P(TableTest, TSColIDLength) {
     ::openmldb::common::StorageMode storageMode = GetParam();
     ::openmldb::api::TableMeta table_meta;
@@ -0,0 +1,373 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_STORAGE_TIME_ENTRIES_H_
+#define SRC_STORAGE_TIME_ENTRIES_H_
+
+#include <stdint.h>
+
+#include <atomic>
+
+#include "base/skiplist.h"
+
+namespace openmldb {
+namespace storage {
+
+struct DataBlock;
+
+// the desc time comparator
+struct TimeComparator {
+    int operator()(const uint64_t& a, const uint64_t& b) const {
+        if (a > b) {
+            return -1;
+        } else if (a == b) {
+            return 0;
+        }
+        return 1;
+    }
+};
+
+static const TimeComparator tcmp;
+
+// The time entries of one key sorted by time desc. Most keys of high cardinality
+// tables hold one entry, so the first kInlineSize entries are kept in an inline
+// array and all entries are moved to a skiplist once the array is full or an out
+// of order time comes. The array is frozen after that, so the iterators created
+// before still read valid memory.
+// The inline entries are never moved or overwritten, gc only moves the start of
+// the live ones forward, so the lock-free readers always get a matched pair.
+// Same as Skiplist, the write operations need external synchronized except
+// InsertConcurrently which can only be used if inline is disabled
+class TimeEntries {
+ public:
+    typedef ::openmldb::base::Skiplist<uint64_t, DataBlock*, TimeComparator> List;
+    typedef ::openmldb::base::Node<uint64_t, DataBlock*> ListNode;
+    static constexpr uint8_t kInlineSize = 1;
+
+    TimeEntries(uint8_t max_height, bool enable_inline) : list_(NULL), start_(0), size_(0), max_height_(max_height) {
+        if (!enable_inline) {
+            list_.store(NewList(), std::memory_order_release);
+        }
+    }
+    ~TimeEntries() { delete list_.load(std::memory_order_relaxed); }
+
+    TimeEntries(const TimeEntries&) = delete;
+    TimeEntries& operator=(const TimeEntries&) = delete;
+
+    bool IsInline() const { return list_.load(std::memory_order_acquire) == NULL; }
+
+    // return the height of the skiplist node, 1 for the inline entry
+    uint8_t Insert(uint64_t time, DataBlock*& row) {  // NOLINT
+        List* list = list_.load(std::memory_order_relaxed);
+        if (list == NULL) {
+            uint8_t start = start_.load(std::memory_order_relaxed);
+            uint8_t size = size_.load(std::memory_order_relaxed);
+            // the inline entries are stored in time asc, the latest one is at the end
+            if (size < kInlineSize && (size == start || keys_[size - 1].load(std::memory_order_relaxed) <= time)) {
+                keys_[size].store(time, std::memory_order_relaxed);
+                values_[size].store(row, std::memory_order_relaxed);
+                size_.store(size + 1, std::memory_order_release);
+                return 1;
+            }
+            list = Promote();
+        }
+        return list->Insert(time, row);
+    }
+
+    uint8_t InsertConcurrently(uint64_t time, DataBlock*& row) {  // NOLINT
+        List* list = list_.load(std::memory_order_acquire);
+        assert(list != NULL);
+        return list->InsertConcurrently(time, row);
+    }
+
+    bool IsEmpty() {
+        List* list = list_.load(std::memory_order_acquire);
+        if (list != NULL) {
+            return list->IsEmpty();
+        }
+        return start_.load(std::memory_order_acquire) == size_.load(std::memory_order_acquire);
+    }
+
+    // get the time of the oldest entry
+    bool GetLastTime(uint64_t* time) {
+        List* list = list_.load(std::memory_order_acquire);
+        if (list != NULL) {
+            ListNode* node = list->GetLast();
+            if (node == NULL) {
+                return false;
+            }
+            *time = node->GetKey();
+            return true;
+        }
+        uint8_t start = start_.load(std::memory_order_acquire);
+        if (start == size_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        *time = keys_[start].load(std::memory_order_relaxed);
+        return true;
+    }
+
+    DataBlock* Get(uint64_t time) {
+        List* list = list_.load(std::memory_order_acquire);
+        if (list != NULL) {
+            return list->Get(time);
+        }
+        // the start is loaded first, so it's never larger than the size loaded later
+        int32_t start = start_.load(std::memory_order_acquire);
+        for (int32_t i = size_.load(std::memory_order_acquire) - 1; i >= start; i--) {
+            if (keys_[i].load(std::memory_order_relaxed) == time) {
+                return values_[i].load(std::memory_order_relaxed);
+            }
+        }
+        return NULL;
+    }
+
+    // The Split functions are the same as Skiplist, they return the removed
+    // entries as a linked list which should be deleted by the caller
+    ListNode* Split(uint64_t time) {
+        List* list = list_.load(std::memory_order_relaxed);
+        if (list != NULL) {
+            return list->Split(time);
+        }
+        return RemoveInline(GetInlineNewerCnt(time));
+    }
+
+    ListNode* SplitByPos(uint64_t pos) {
+        List* list = list_.load(std::memory_order_relaxed);
+        if (list != NULL) {
+            return list->SplitByPos(pos);
+        }
+        return RemoveInline(pos);
+    }
+
+    ListNode* SplitByKeyOrPos(uint64_t time, uint64_t pos) {
+        List* list = list_.load(std::memory_order_relaxed);
+        if (list != NULL) {
+            return list->SplitByKeyOrPos(time, pos);
+        }
+        uint64_t keep_cnt = GetInlineNewerCnt(time);
+        return RemoveInline(keep_cnt < pos ? keep_cnt : pos);
+    }
+
+    ListNode* SplitByKeyAndPos(uint64_t time, uint64_t pos) {
+        List* list = list_.load(std::memory_order_relaxed);
+        if (list != NULL) {
+            return list->SplitByKeyAndPos(time, pos);
+        }
+        uint64_t keep_cnt = GetInlineNewerCnt(time);
+        return RemoveInline(keep_cnt > pos ? keep_cnt : pos);
+    }
+
+    // return the count of entries removed
+    uint64_t Clear() {
+        List* list = list_.load(std::memory_order_relaxed);
+        if (list != NULL) {
+            return list->Clear();
+        }
+        uint8_t size = size_.load(std::memory_order_relaxed);
+        uint64_t cnt = size - start_.load(std::memory_order_relaxed);
+        start_.store(size, std::memory_order_release);
+        return cnt;
+    }
+
+    class Iterator {
+     public:
+        explicit Iterator(TimeEntries* entries)
+            : entries_(entries), list_it_(NULL), pos_(0), start_(0), size_(0), key_(0), value_(NULL) {
+            Refresh();
+        }
+        ~Iterator() { delete list_it_; }
+
+        bool Valid() const {
+            if (list_it_ != NULL) {
+                return list_it_->Valid();
+            }
+            return start_ + pos_ < size_;
+        }
+
+        void Next() {
+            if (list_it_ != NULL) {
+                list_it_->Next();
+                return;
+            }
+            assert(Valid());
+            pos_++;
+            Load();
+        }
+
+        const uint64_t& GetKey() const {
+            if (list_it_ != NULL) {
+                return list_it_->GetKey();
+            }
+            assert(Valid());
+            return key_;
+        }
+
+        DataBlock*& GetValue() {
+            if (list_it_ != NULL) {
+                return list_it_->GetValue();
+            }
+            assert(Valid());
+            return value_;
+        }
+
+        void Seek(const uint64_t& time) {
+            Refresh();
+            if (list_it_ != NULL) {
+                list_it_->Seek(time);
+                return;
+            }
+            LoadRange();
+            for (pos_ = 0; start_ + pos_ < size_; pos_++) {
+                if (entries_->keys_[size_ - 1 - pos_].load(std::memory_order_relaxed) <= time) {
+                    break;
+                }
+            }
+            Load();
+        }
+
+        void SeekToFirst() {
+            Refresh();
+            if (list_it_ != NULL) {
+                list_it_->SeekToFirst();
+                return;
+            }
+            LoadRange();
+            pos_ = 0;
+            Load();
+        }
+
+        void SeekToLast() {
+            Refresh();
+            if (list_it_ != NULL) {
+                list_it_->SeekToLast();
+                return;
+            }
+            LoadRange();
+            pos_ = size_ > start_ ? size_ - start_ - 1 : 0;
+            Load();
+        }
+
+        uint32_t GetSize() {
+            if (list_it_ != NULL) {
+                return list_it_->GetSize();
+            }
+            uint8_t start = entries_->start_.load(std::memory_order_acquire);
+            return entries_->size_.load(std::memory_order_acquire) - start;
+        }
+
+     private:
+        // switch to the skiplist if the entries have been promoted
+        void Refresh() {
+            if (list_it_ == NULL) {
+                List* list = entries_->list_.load(std::memory_order_acquire);
+                if (list != NULL) {
+                    list_it_ = list->NewIterator();
+                }
+            }
+        }
+
+        // the start is loaded first, so it's never larger than the size loaded later. The
+        // entries removed after that are still read, the same as the removed skiplist nodes
+        void LoadRange() {
+            start_ = entries_->start_.load(std::memory_order_acquire);
+            size_ = entries_->size_.load(std::memory_order_acquire);
+        }
+
+        void Load() {
+            if (start_ + pos_ < size_) {
+                key_ = entries_->keys_[size_ - 1 - pos_].load(std::memory_order_relaxed);
+                value_ = entries_->values_[size_ - 1 - pos_].load(std::memory_order_relaxed);
+            }
+        }
+
+     private:
+        TimeEntries* entries_;
+        List::Iterator* list_it_;
+        uint32_t pos_;
+        uint32_t start_;
+        uint32_t size_;
+        uint64_t key_;
+        DataBlock* value_;
+    };
+
+    // delete the iterator after it's used
+    Iterator* NewIterator() { return new Iterator(this); }
+
+ private:
+    List* NewList() { return new List(max_height_, 4, tcmp); }
+
+    List* Promote() {
+        List* list = NewList();
+        uint8_t size = size_.load(std::memory_order_relaxed);
+        for (uint8_t i = start_.load(std::memory_order_relaxed); i < size; i++) {
+            uint64_t time = keys_[i].load(std::memory_order_relaxed);
+            DataBlock* row = values_[i].load(std::memory_order_relaxed);
+            // keep the height of inline entry, so the index byte size stays the same
+            list->Insert(time, row, 1);
+        }
+        list_.store(list, std::memory_order_release);
+        return list;
+    }
+
+    // the count of inline entries whose time is larger than the input
+    uint64_t GetInlineNewerCnt(uint64_t time) {
+        uint64_t cnt = 0;
+        int32_t start = start_.load(std::memory_order_relaxed);
+        for (int32_t i = size_.load(std::memory_order_relaxed) - 1; i >= start; i--) {
+            if (keys_[i].load(std::memory_order_relaxed) <= time) {
+                break;
+            }
+            cnt++;
+        }
+        return cnt;
+    }
+
+    // keep the latest keep_cnt inline entries and return the others as a linked list,
+    // the removed ones are skipped by moving the start rather than the live ones
+    ListNode* RemoveInline(uint64_t keep_cnt) {
+        uint8_t start = start_.load(std::memory_order_relaxed);
+        uint8_t size = size_.load(std::memory_order_relaxed);
+        if (keep_cnt >= static_cast<uint64_t>(size - start)) {
+            return NULL;
+        }
+        uint8_t end = size - keep_cnt;
+        ListNode* head = NULL;
+        for (uint8_t i = start; i < end; i++) {
+            uint64_t time = keys_[i].load(std::memory_order_relaxed);
+            DataBlock* row = values_[i].load(std::memory_order_relaxed);
+            ListNode* node = new (1) ListNode(time, row, 1);
+            node->SetNextNoBarrier(0, head);
+            head = node;
+        }
+        start_.store(end, std::memory_order_release);
+        return head;
+    }
+
+ private:
+    std::atomic<List*> list_;
+    // the live inline entries are in [start_, size_), the slots are used once
+    std::atomic<uint8_t> start_;
+    std::atomic<uint8_t> size_;
+    uint8_t const max_height_;
+    std::atomic<uint64_t> keys_[kInlineSize];
+    std::atomic<DataBlock*> values_[kInlineSize];
+};
+
+}  // namespace storage
+}  // namespace openmldb
+
+#endif  // SRC_STORAGE_TIME_ENTRIES_H_
@@ -0,0 +1,218 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "storage/time_entries.h"
+
+#include <atomic>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "storage/segment.h"
+
+namespace openmldb {
+namespace storage {
+
+class TimeEntriesTest : public ::testing::Test {
+ public:
+    TimeEntriesTest() {}
+    ~TimeEntriesTest() {}
+};
+
+static uint64_t FreeNodes(TimeEntries::ListNode* node) {
+    uint64_t cnt = 0;
+    while (node != NULL) {
+        TimeEntries::ListNode* tmp = node;
+        node = node->GetNextNoBarrier(0);
+        delete tmp;
+        cnt++;
+    }
+    return cnt;
+}
+
+static std::vector<uint64_t> GetTimes(TimeEntries* entries) {
+    std::vector<uint64_t> times;
+    TimeEntries::Iterator* it = entries->NewIterator();
+    it->SeekToFirst();
+    while (it->Valid()) {
+        times.push_back(it->GetKey());
+        it->Next();
+    }
+    delete it;
+    return times;
+}
+
+TEST_F(TimeEntriesTest, Inline) {
+    TimeEntries entries(4, true);
+    ASSERT_TRUE(entries.IsEmpty());
+    uint64_t last_time = 0;
+    ASSERT_FALSE(entries.GetLastTime(&last_time));
+    DataBlock* block = reinterpret_cast<DataBlock*>(1);
+    ASSERT_EQ(1, entries.Insert(10, block));
+    ASSERT_TRUE(entries.IsInline());
+    ASSERT_FALSE(entries.IsEmpty());
+    ASSERT_TRUE(entries.GetLastTime(&last_time));
+    ASSERT_EQ(10u, last_time);
+    ASSERT_EQ(block, entries.Get(10));
+    ASSERT_EQ(NULL, entries.Get(20));
+    ASSERT_EQ(std::vector<uint64_t>({10}), GetTimes(&entries));
+
+    TimeEntries::Iterator* it = entries.NewIterator();
+    it->Seek(20);
+    ASSERT_TRUE(it->Valid());
+    ASSERT_EQ(10u, it->GetKey());
+    ASSERT_EQ(block, it->GetValue());
+    it->Seek(5);
+    ASSERT_FALSE(it->Valid());
+    it->SeekToLast();
+    ASSERT_TRUE(it->Valid());
+    ASSERT_EQ(10u, it->GetKey());
+    ASSERT_EQ(1u, it->GetSize());
+
+    ASSERT_EQ(NULL, entries.Split(5));
+    ASSERT_EQ(NULL, entries.SplitByPos(1));
+    ASSERT_EQ(1u, FreeNodes(entries.SplitByPos(0)));
+    ASSERT_TRUE(entries.IsEmpty());
+    ASSERT_TRUE(entries.IsInline());
+    ASSERT_FALSE(entries.GetLastTime(&last_time));
+    ASSERT_EQ(NULL, entries.Get(10));
+    ASSERT_TRUE(GetTimes(&entries).empty());
+    it->SeekToFirst();
+    ASSERT_FALSE(it->Valid());
+    ASSERT_EQ(0u, it->GetSize());
+    delete it;
+    // the inline slot is used once, so the next entry goes to skiplist
+    ASSERT_EQ(NULL, entries.SplitByPos(0));
+    entries.Insert(20, block);
+    ASSERT_FALSE(entries.IsInline());
+    ASSERT_EQ(std::vector<uint64_t>({20}), GetTimes(&entries));
+    ASSERT_EQ(1u, entries.Clear());
+
+    TimeEntries cleared(4, true);
+    cleared.Insert(10, block);
+    ASSERT_EQ(1u, cleared.Clear());
+    ASSERT_TRUE(cleared.IsEmpty());
+    ASSERT_TRUE(cleared.IsInline());
+    ASSERT_EQ(0u, cleared.Clear());
+}
+
+TEST_F(TimeEntriesTest, SplitByKeyAndPos) {
+    DataBlock* block = NULL;
+    TimeEntries or_entries(4, true);
+    or_entries.Insert(10, block);
+    // the entries older than the key or out of pos are removed
+    ASSERT_EQ(NULL, or_entries.SplitByKeyOrPos(5, 1));
+    ASSERT_EQ(1u, FreeNodes(or_entries.SplitByKeyOrPos(15, 1)));
+    ASSERT_TRUE(or_entries.IsEmpty());
+
+    TimeEntries and_entries(4, true);
+    and_entries.Insert(10, block);
+    // the entries older than the key and out of pos are removed
+    ASSERT_EQ(NULL, and_entries.SplitByKeyAndPos(15, 1));
+    ASSERT_EQ(NULL, and_entries.SplitByKeyAndPos(5, 0));
+    ASSERT_EQ(1u, FreeNodes(and_entries.SplitByKeyAndPos(15, 0)));
+    ASSERT_TRUE(and_entries.IsEmpty());
+    ASSERT_TRUE(and_entries.IsInline());
+}
+
+TEST_F(TimeEntriesTest, Promote) {
+    TimeEntries entries(4, true);
+    DataBlock* block = NULL;
+    entries.Insert(20, block);
+    TimeEntries::Iterator* old_it = entries.NewIterator();
+    // the entry beyond the inline array moves the entries into skiplist
+    entries.Insert(30, block);
+    ASSERT_FALSE(entries.IsInline());
+    entries.Insert(10, block);
+    ASSERT_EQ(std::vector<uint64_t>({30, 20, 10}), GetTimes(&entries));
+    for (uint64_t i = 0; i < 10; i++) {
+        entries.Insert(100 + i, block);
+    }
+    ASSERT_EQ(13u, GetTimes(&entries).size());
+    // the iterator created before switches to skiplist when seek
+    old_it->SeekToFirst();
+    ASSERT_TRUE(old_it->Valid());
+    ASSERT_EQ(109u, old_it->GetKey());
+    delete old_it;
+    ASSERT_EQ(3u, FreeNodes(entries.Split(30)));
+    uint64_t last_time = 0;
+    ASSERT_TRUE(entries.GetLastTime(&last_time));
+    ASSERT_EQ(100u, last_time);
+    ASSERT_EQ(10u, entries.Clear());
+    ASSERT_TRUE(entries.IsEmpty());
+}
+
+TEST_F(TimeEntriesTest, ConcurrentGcAndRead) {
+    // the value of an entry is its time, so a reader can check the pair it gets
+    std::atomic<uint64_t> mismatch_cnt(0);
+    for (uint64_t round = 1; round <= 200; round++) {
+        TimeEntries entries(4, true);
+        DataBlock* block = reinterpret_cast<DataBlock*>(round);
+        entries.Insert(round, block);
+        std::atomic<bool> started(false);
+        std::atomic<bool> done(false);
+        std::thread reader([&entries, &started, &done, &mismatch_cnt] {
+            TimeEntries::Iterator* it = entries.NewIterator();
+            while (!done.load(std::memory_order_acquire)) {
+                started.store(true, std::memory_order_release);
+                for (it->SeekToFirst(); it->Valid(); it->Next()) {
+                    if (reinterpret_cast<uint64_t>(it->GetValue()) != it->GetKey()) {
+                        mismatch_cnt.fetch_add(1, std::memory_order_relaxed);
+                    }
+                }
+            }
+            delete it;
+        });
+        // the removed entries are freed after the reader exits, as the segment gc does after the reads
+        std::vector<TimeEntries::ListNode*> removed;
+        while (!started.load(std::memory_order_acquire)) {
+        }
+        removed.push_back(entries.SplitByPos(0));
+        for (uint64_t i = 1; i <= 100; i++) {
+            uint64_t time = round * 1000 + i;
+            block = reinterpret_cast<DataBlock*>(time);
+            entries.Insert(time, block);
+            removed.push_back(entries.SplitByPos(1));
+        }
+        done.store(true, std::memory_order_release);
+        reader.join();
+        for (auto node : removed) {
+            FreeNodes(node);
+        }
+        ASSERT_EQ(1u, GetTimes(&entries).size());
+        entries.Clear();
+    }
+    ASSERT_EQ(0u, mismatch_cnt.load());
+}
+
+TEST_F(TimeEntriesTest, DisableInline) {
+    TimeEntries entries(4, false);
+    ASSERT_FALSE(entries.IsInline());
+    DataBlock* block = NULL;
+    for (uint64_t i = 0; i < 10; i++) {
+        entries.InsertConcurrently(i, block);
+    }
+    ASSERT_EQ(10u, GetTimes(&entries).size());
+    ASSERT_EQ(10u, entries.Clear());
+}
+
+}  // namespace storage
+}  // namespace openmldb
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
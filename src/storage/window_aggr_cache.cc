@@ -0,0 +1,320 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "storage/window_aggr_cache.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+namespace openmldb {
+namespace storage {
+
+WindowAggrCache::WindowAggrCache(AggrType aggr_type, DataType data_type, uint32_t max_rows_per_key,
+                                 uint32_t max_keys)
+    : aggr_type_(aggr_type),
+      data_type_(data_type),
+      max_rows_per_key_(max_rows_per_key),
+      max_keys_(max_keys),
+      mu_(),
+      windows_() {}
+
+bool WindowAggrCache::IsSupported(AggrType aggr_type, DataType data_type) {
+    switch (aggr_type) {
+        case AggrType::kCount:
+            return true;
+        case AggrType::kSum:
+            return data_type == DataType::kSmallInt || data_type == DataType::kInt || data_type == DataType::kBigInt ||
+                   data_type == DataType::kTimestamp || data_type == DataType::kFloat ||
+                   data_type == DataType::kDouble;
+        case AggrType::kAvg:
+            return data_type == DataType::kSmallInt || data_type == DataType::kInt || data_type == DataType::kBigInt ||
+                   data_type == DataType::kFloat || data_type == DataType::kDouble;
+        case AggrType::kMin:
+        case AggrType::kMax:
+            return data_type == DataType::kSmallInt || data_type == DataType::kInt || data_type == DataType::kDate ||
+                   data_type == DataType::kBigInt || data_type == DataType::kTimestamp ||
+                   data_type == DataType::kFloat || data_type == DataType::kDouble;
+        default:
+            return false;
+    }
+}
+
+void WindowAggrCache::Add(const std::string& key, int64_t ts, const AggrBuffer& row) {
+    std::shared_ptr<KeyWindow> window;
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        auto it = windows_.find(key);
+        if (it != windows_.end()) {
+            window = it->second;
+        } else {
+            if (windows_.size() >= max_keys_) {
+                return;
+            }
+            window = std::make_shared<KeyWindow>();
+            // the rows older than ts may be put before the key is cached
+            window->valid_from = ts + 1;
+            window->max_ts = ts;
+            windows_.emplace(key, window);
+        }
+    }
+    std::lock_guard<std::shared_mutex> lock(window->mu);
+    if (ts < window->max_ts) {
+        // the row is out of order, restart the window after it
+        window->entries.clear();
+        window->extremes.clear();
+        window->sum_long = 0;
+        window->sum_double = 0;
+        window->non_null_cnt = 0;
+        window->removed_cnt = 0;
+        window->valid_from = window->max_ts + 1;
+        return;
+    }
+    window->max_ts = ts;
+    Entry entry;
+    entry.ts = ts;
+    memcpy(&entry.val, &row.aggr_val_, sizeof(entry.val));
+    entry.is_null = row.non_null_cnt == 0;
+    Append(entry, window.get());
+    auto& entries = (aggr_type_ == AggrType::kMin || aggr_type_ == AggrType::kMax) ? window->extremes
+                                                                                   : window->entries;
+    while (entries.size() > max_rows_per_key_) {
+        window->valid_from = std::max(window->valid_from, entries.front().ts + 1);
+        Evict(window->valid_from, window.get());
+    }
+}
+
+bool WindowAggrCache::Get(const std::string& key, int64_t start, int64_t end, std::string* aggr_val) {
+    std::shared_ptr<KeyWindow> window;
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        auto it = windows_.find(key);
+        if (it == windows_.end()) {
+            return false;
+        }
+        window = it->second;
+    }
+    std::shared_lock<std::shared_mutex> lock(window->mu);
+    if (start < window->valid_from || end < window->max_ts) {
+        return false;
+    }
+    // the values before start are skipped without evicting them, the window with an earlier start may be got later
+    int64_t non_null_cnt = window->non_null_cnt;
+    int64_t sum_long = window->sum_long;
+    double sum_double = window->sum_double;
+    for (const auto& entry : window->entries) {
+        if (entry.ts >= start) {
+            break;
+        }
+        Remove(entry, &non_null_cnt, &sum_long, &sum_double);
+    }
+    const Entry* extreme = nullptr;
+    for (const auto& entry : window->extremes) {
+        if (entry.ts >= start) {
+            extreme = &entry;
+            break;
+        }
+    }
+    Encode(non_null_cnt, sum_long, sum_double, extreme, aggr_val);
+    return true;
+}
+
+void WindowAggrCache::Clear() {
+    std::lock_guard<std::mutex> lock(mu_);
+    windows_.clear();
+}
+
+uint64_t WindowAggrCache::GetKeyCnt() {
+    std::lock_guard<std::mutex> lock(mu_);
+    return windows_.size();
+}
+
+void WindowAggrCache::Evict(int64_t start, KeyWindow* window) {
+    while (!window->entries.empty() && window->entries.front().ts < start) {
+        const auto& entry = window->entries.front();
+        Remove(entry, &window->non_null_cnt, &window->sum_long, &window->sum_double);
+        if (!entry.is_null) {
+            window->removed_cnt++;
+        }
+        window->entries.pop_front();
+    }
+    if (window->removed_cnt > 0 && window->removed_cnt >= window->entries.size()) {
+        // amortized to O(1) for each value removed
+        RecomputeSum(window);
+    }
+    while (!window->extremes.empty() && window->extremes.front().ts < start) {
+        window->extremes.pop_front();
+    }
+    window->valid_from = std::max(window->valid_from, start);
+}
+
+void WindowAggrCache::Append(const Entry& entry, KeyWindow* window) {
+    if (aggr_type_ == AggrType::kMin || aggr_type_ == AggrType::kMax) {
+        if (entry.is_null) {
+            return;
+        }
+        // the older values which are not better than the new one never become the result
+        while (!window->extremes.empty() && !Prefer(window->extremes.back().val, entry.val)) {
+            window->extremes.pop_back();
+        }
+        window->extremes.push_back(entry);
+        return;
+    }
+    window->entries.push_back(entry);
+    if (entry.is_null) {
+        return;
+    }
+    window->non_null_cnt++;
+    if (aggr_type_ == AggrType::kAvg) {
+        window->sum_double += entry.val.vdouble;
+    } else if (aggr_type_ == AggrType::kSum) {
+        if (data_type_ == DataType::kFloat) {
+            window->sum_double += entry.val.vfloat;
+        } else if (data_type_ == DataType::kDouble) {
+            window->sum_double += entry.val.vdouble;
+        } else {
+            window->sum_long += entry.val.vlong;
+        }
+    }
+}
+
+void WindowAggrCache::Remove(const Entry& entry, int64_t* non_null_cnt, int64_t* sum_long,
+                             double* sum_double) const {
+    if (entry.is_null) {
+        return;
+    }
+    (*non_null_cnt)--;
+    if (aggr_type_ == AggrType::kAvg) {
+        *sum_double -= entry.val.vdouble;
+    } else if (aggr_type_ == AggrType::kSum) {
+        if (data_type_ == DataType::kFloat) {
+            *sum_double -= entry.val.vfloat;
+        } else if (data_type_ == DataType::kDouble) {
+            *sum_double -= entry.val.vdouble;
+        } else {
+            *sum_long -= entry.val.vlong;
+        }
+    }
+}
+
+void WindowAggrCache::RecomputeSum(KeyWindow* window) const {
+    window->removed_cnt = 0;
+    bool sum_float = aggr_type_ == AggrType::kSum && data_type_ == DataType::kFloat;
+    bool sum_double = aggr_type_ == AggrType::kAvg || (aggr_type_ == AggrType::kSum && data_type_ == DataType::kDouble);
+    if (!sum_float && !sum_double) {
+        return;
+    }
+    // the sum of double drifts after the values are added and subtracted many times
+    double sum = 0;
+    for (const auto& entry : window->entries) {
+        if (!entry.is_null) {
+            sum += sum_float ? entry.val.vfloat : entry.val.vdouble;
+        }
+    }
+    window->sum_double = sum;
+}
+
+bool WindowAggrCache::Prefer(const AggrBuffer::AggrVal& lhs, const AggrBuffer::AggrVal& rhs) const {
+    bool is_min = aggr_type_ == AggrType::kMin;
+    switch (data_type_) {
+        case DataType::kSmallInt:
+            return is_min ? lhs.vsmallint < rhs.vsmallint : lhs.vsmallint > rhs.vsmallint;
+        case DataType::kDate:
+        case DataType::kInt:
+            return is_min ? lhs.vint < rhs.vint : lhs.vint > rhs.vint;
+        case DataType::kTimestamp:
+        case DataType::kBigInt:
+            return is_min ? lhs.vlong < rhs.vlong : lhs.vlong > rhs.vlong;
+        case DataType::kFloat:
+            return is_min ? lhs.vfloat < rhs.vfloat : lhs.vfloat > rhs.vfloat;
+        case DataType::kDouble:
+            return is_min ? lhs.vdouble < rhs.vdouble : lhs.vdouble > rhs.vdouble;
+        default:
+            return false;
+    }
+}
+
+void WindowAggrCache::Encode(int64_t non_null_cnt, int64_t sum_long, double sum_double, const Entry* extreme,
+                             std::string* aggr_val) const {
+    aggr_val->clear();
+    switch (aggr_type_) {
+        case AggrType::kCount: {
+            int64_t cnt = non_null_cnt;
+            aggr_val->assign(reinterpret_cast<char*>(&cnt), sizeof(int64_t));
+            break;
+        }
+        case AggrType::kAvg: {
+            if (non_null_cnt == 0) {
+                break;
+            }
+            double sum = sum_double;
+            int64_t cnt = non_null_cnt;
+            aggr_val->assign(reinterpret_cast<char*>(&sum), sizeof(double));
+            aggr_val->append(reinterpret_cast<char*>(&cnt), sizeof(int64_t));
+            break;
+        }
+        case AggrType::kSum: {
+            if (non_null_cnt == 0) {
+                break;
+            }
+            if (data_type_ == DataType::kFloat) {
+                float sum = static_cast<float>(sum_double);
+                aggr_val->assign(reinterpret_cast<char*>(&sum), sizeof(float));
+            } else if (data_type_ == DataType::kDouble) {
+                double sum = sum_double;
+                aggr_val->assign(reinterpret_cast<char*>(&sum), sizeof(double));
+            } else {
+                int64_t sum = sum_long;
+                aggr_val->assign(reinterpret_cast<char*>(&sum), sizeof(int64_t));
+            }
+            break;
+        }
+        case AggrType::kMin:
+        case AggrType::kMax: {
+            if (extreme == nullptr) {
+                break;
+            }
+            const auto& val = extreme->val;
+            switch (data_type_) {
+                case DataType::kSmallInt:
+                    aggr_val->assign(reinterpret_cast<const char*>(&val.vsmallint), sizeof(int16_t));
+                    break;
+                case DataType::kDate:
+                case DataType::kInt:
+                    aggr_val->assign(reinterpret_cast<const char*>(&val.vint), sizeof(int32_t));
+                    break;
+                case DataType::kTimestamp:
+                case DataType::kBigInt:
+                    aggr_val->assign(reinterpret_cast<const char*>(&val.vlong), sizeof(int64_t));
+                    break;
+                case DataType::kFloat:
+                    aggr_val->assign(reinterpret_cast<const char*>(&val.vfloat), sizeof(float));
+                    break;
+                case DataType::kDouble:
+                    aggr_val->assign(reinterpret_cast<const char*>(&val.vdouble), sizeof(double));
+                    break;
+                default:
+                    break;
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+}  // namespace storage
+}  // namespace openmldb
@@ -0,0 +1,107 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_STORAGE_WINDOW_AGGR_CACHE_H_
+#define SRC_STORAGE_WINDOW_AGGR_CACHE_H_
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+#include "storage/aggregator.h"
+
+namespace openmldb {
+namespace storage {
+
+// The sliding window aggregate of each key of a long window, it is updated by the
+// aggregator when the rows are put and read by the request of deployment, so the
+// aggregate of a hot key is got without scanning the window.
+//
+// The values of a key are kept in time order. sum/count/avg are maintained by adding
+// the new value and subtracting the expired one, min/max are maintained by monotonic
+// deques. A key is cached from the first value put after the cache is created, the
+// window whose start is not later than that can not be got from the cache. The values
+// are only evicted by Add, so Get does not change the windows got by the others.
+//
+// The cache is only fed by the aggregator of leader, it needs to be cleared if the rows
+// are not put through the aggregator, e.g. the role is changed or the rows are deleted.
+class WindowAggrCache {
+ public:
+    WindowAggrCache(AggrType aggr_type, DataType data_type, uint32_t max_rows_per_key, uint32_t max_keys);
+    WindowAggrCache(const WindowAggrCache&) = delete;
+    WindowAggrCache& operator=(const WindowAggrCache&) = delete;
+
+    static bool IsSupported(AggrType aggr_type, DataType data_type);
+
+    // row is the aggregate of the single row built by Aggregator::UpdateAggrVal
+    void Add(const std::string& key, int64_t ts, const AggrBuffer& row);
+
+    // get the aggregate of the values of key in [start, end] encoded as the aggr_val
+    // of pre-aggr table, aggr_val is empty if the aggregate is null.
+    // return false if the window can not be got from the cache
+    bool Get(const std::string& key, int64_t start, int64_t end, std::string* aggr_val);
+
+    // drop all the keys, they are cached again from the next value put
+    void Clear();
+
+    uint64_t GetKeyCnt();
+
+ private:
+    struct Entry {
+        int64_t ts;
+        AggrBuffer::AggrVal val;
+        bool is_null;
+    };
+
+    struct KeyWindow {
+        std::shared_mutex mu;
+        std::deque<Entry> entries;
+        // the values of min/max candidates in ts order
+        std::deque<Entry> extremes;
+        // the windows which start from valid_from can be got from the cache
+        int64_t valid_from = 0;
+        int64_t max_ts = 0;
+        int64_t sum_long = 0;
+        double sum_double = 0;
+        int64_t non_null_cnt = 0;
+        // the values removed from sum_double since it is recomputed, which bounds the rounding error
+        uint64_t removed_cnt = 0;
+    };
+
+    void Evict(int64_t start, KeyWindow* window);
+    void Append(const Entry& entry, KeyWindow* window);
+    void Remove(const Entry& entry, int64_t* non_null_cnt, int64_t* sum_long, double* sum_double) const;
+    void RecomputeSum(KeyWindow* window) const;
+    bool Prefer(const AggrBuffer::AggrVal& lhs, const AggrBuffer::AggrVal& rhs) const;
+    // extreme is null if there is no min/max value
+    void Encode(int64_t non_null_cnt, int64_t sum_long, double sum_double, const Entry* extreme,
+                std::string* aggr_val) const;
+
+    const AggrType aggr_type_;
+    const DataType data_type_;
+    const uint32_t max_rows_per_key_;
+    const uint32_t max_keys_;
+    std::mutex mu_;
+    std::unordered_map<std::string, std::shared_ptr<KeyWindow>> windows_;
+};
+
+}  // namespace storage
+}  // namespace openmldb
+
+#endif  // SRC_STORAGE_WINDOW_AGGR_CACHE_H_
@@ -0,0 +1,176 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "storage/window_aggr_cache.h"
+
+#include <string>
+
+#include "gtest/gtest.h"
+
+namespace openmldb {
+namespace storage {
+
+class WindowAggrCacheTest : public ::testing::Test {
+ public:
+    WindowAggrCacheTest() {}
+    ~WindowAggrCacheTest() {}
+};
+
+void AddLong(WindowAggrCache* cache, const std::string& key, int64_t ts, int64_t val) {
+    AggrBuffer buffer;
+    buffer.data_type_ = DataType::kBigInt;
+    buffer.aggr_val_.vlong = val;
+    buffer.non_null_cnt = 1;
+    cache->Add(key, ts, buffer);
+}
+
+int64_t DecodeLong(const std::string& aggr_val) {
+    EXPECT_EQ(sizeof(int64_t), aggr_val.size());
+    return *reinterpret_cast<const int64_t*>(aggr_val.data());
+}
+
+TEST_F(WindowAggrCacheTest, Sum) {
+    WindowAggrCache cache(AggrType::kSum, DataType::kBigInt, 1000, 100);
+    for (int64_t ts = 1; ts <= 100; ts++) {
+        AddLong(&cache, "key1", ts, ts);
+    }
+    std::string aggr_val;
+    // the rows before the key is cached may be missed
+    ASSERT_FALSE(cache.Get("key1", 1, 100, &aggr_val));
+    ASSERT_FALSE(cache.Get("key2", 2, 100, &aggr_val));
+    // the rows newer than the window end are cached
+    ASSERT_FALSE(cache.Get("key1", 2, 99, &aggr_val));
+    ASSERT_TRUE(cache.Get("key1", 2, 100, &aggr_val));
+    ASSERT_EQ(5049, DecodeLong(aggr_val));
+    ASSERT_TRUE(cache.Get("key1", 91, 200, &aggr_val));
+    ASSERT_EQ(955, DecodeLong(aggr_val));
+    // the rows are not evicted by get, so the window with an earlier start can be got too
+    ASSERT_TRUE(cache.Get("key1", 90, 200, &aggr_val));
+    ASSERT_EQ(1045, DecodeLong(aggr_val));
+    AddLong(&cache, "key1", 101, 101);
+    ASSERT_TRUE(cache.Get("key1", 92, 101, &aggr_val));
+    ASSERT_EQ(965, DecodeLong(aggr_val));
+    ASSERT_TRUE(cache.Get("key1", 200, 300, &aggr_val));
+    ASSERT_TRUE(aggr_val.empty());
+}
+
+TEST_F(WindowAggrCacheTest, MinMax) {
+    WindowAggrCache min_cache(AggrType::kMin, DataType::kBigInt, 1000, 100);
+    WindowAggrCache max_cache(AggrType::kMax, DataType::kBigInt, 1000, 100);
+    int64_t vals[] = {5, 3, 8, 1, 9, 7, 2, 6};
+    for (int64_t i = 0; i < 8; i++) {
+        AddLong(&min_cache, "key1", i, vals[i]);
+        AddLong(&max_cache, "key1", i, vals[i]);
+    }
+    std::string aggr_val;
+    ASSERT_TRUE(min_cache.Get("key1", 1, 7, &aggr_val));
+    ASSERT_EQ(1, DecodeLong(aggr_val));
+    ASSERT_TRUE(max_cache.Get("key1", 1, 7, &aggr_val));
+    ASSERT_EQ(9, DecodeLong(aggr_val));
+    ASSERT_TRUE(min_cache.Get("key1", 4, 7, &aggr_val));
+    ASSERT_EQ(2, DecodeLong(aggr_val));
+    ASSERT_TRUE(max_cache.Get("key1", 5, 7, &aggr_val));
+    ASSERT_EQ(7, DecodeLong(aggr_val));
+    ASSERT_TRUE(max_cache.Get("key1", 8, 8, &aggr_val));
+    ASSERT_TRUE(aggr_val.empty());
+}
+
+TEST_F(WindowAggrCacheTest, AvgAndCount) {
+    WindowAggrCache avg_cache(AggrType::kAvg, DataType::kDouble, 1000, 100);
+    WindowAggrCache count_cache(AggrType::kCount, DataType::kDouble, 1000, 100);
+    for (int64_t ts = 0; ts < 10; ts++) {
+        AggrBuffer buffer;
+        buffer.data_type_ = DataType::kDouble;
+        // the odd rows are null
+        if (ts % 2 == 0) {
+            buffer.aggr_val_.vdouble = ts;
+            buffer.non_null_cnt = 1;
+        }
+        avg_cache.Add("key1", ts, buffer);
+        count_cache.Add("key1", ts, buffer);
+    }
+    std::string aggr_val;
+    ASSERT_TRUE(avg_cache.Get("key1", 1, 9, &aggr_val));
+    ASSERT_EQ(sizeof(double) + sizeof(int64_t), aggr_val.size());
+    ASSERT_DOUBLE_EQ(20.0, *reinterpret_cast<const double*>(aggr_val.data()));
+    ASSERT_EQ(4, *reinterpret_cast<const int64_t*>(aggr_val.data() + sizeof(double)));
+    ASSERT_TRUE(count_cache.Get("key1", 5, 9, &aggr_val));
+    ASSERT_EQ(2, DecodeLong(aggr_val));
+}
+
+TEST_F(WindowAggrCacheTest, OutOfOrderAndLimit) {
+    WindowAggrCache cache(AggrType::kSum, DataType::kBigInt, 10, 1);
+    for (int64_t ts = 1; ts <= 20; ts++) {
+        AddLong(&cache, "key1", ts, 1);
+    }
+    // the new key is not cached if the key count reaches the limit
+    AddLong(&cache, "key2", 1, 1);
+    ASSERT_EQ(1u, cache.GetKeyCnt());
+    std::string aggr_val;
+    // only the last 10 rows are kept
+    ASSERT_FALSE(cache.Get("key1", 10, 20, &aggr_val));
+    ASSERT_TRUE(cache.Get("key1", 11, 20, &aggr_val));
+    ASSERT_EQ(10, DecodeLong(aggr_val));
+    // the row older than the latest one restarts the window
+    AddLong(&cache, "key1", 15, 1);
+    ASSERT_FALSE(cache.Get("key1", 12, 20, &aggr_val));
+    AddLong(&cache, "key1", 22, 1);
+    AddLong(&cache, "key1", 23, 1);
+    ASSERT_TRUE(cache.Get("key1", 21, 23, &aggr_val));
+    ASSERT_EQ(2, DecodeLong(aggr_val));
+}
+
+TEST_F(WindowAggrCacheTest, RecomputeDoubleSum) {
+    WindowAggrCache cache(AggrType::kSum, DataType::kDouble, 1, 100);
+    std::string aggr_val;
+    double vals[] = {1e17, 1.0, 2.0};
+    for (int64_t ts = 0; ts < 3; ts++) {
+        AggrBuffer buffer;
+        buffer.data_type_ = DataType::kDouble;
+        buffer.aggr_val_.vdouble = vals[ts];
+        buffer.non_null_cnt = 1;
+        cache.Add("key1", ts, buffer);
+    }
+    // 1e17 + 1.0 - 1e17 is 0 in double, the sum is recomputed after the values are evicted
+    ASSERT_TRUE(cache.Get("key1", 2, 2, &aggr_val));
+    ASSERT_DOUBLE_EQ(2.0, *reinterpret_cast<const double*>(aggr_val.data()));
+}
+
+TEST_F(WindowAggrCacheTest, Clear) {
+    WindowAggrCache cache(AggrType::kSum, DataType::kBigInt, 1000, 100);
+    for (int64_t ts = 1; ts <= 10; ts++) {
+        AddLong(&cache, "key1", ts, ts);
+    }
+    std::string aggr_val;
+    ASSERT_TRUE(cache.Get("key1", 5, 10, &aggr_val));
+    cache.Clear();
+    ASSERT_EQ(0u, cache.GetKeyCnt());
+    ASSERT_FALSE(cache.Get("key1", 5, 10, &aggr_val));
+    // the key is cached again from the next row
+    AddLong(&cache, "key1", 11, 11);
+    AddLong(&cache, "key1", 12, 12);
+    ASSERT_FALSE(cache.Get("key1", 5, 12, &aggr_val));
+    ASSERT_TRUE(cache.Get("key1", 12, 12, &aggr_val));
+    ASSERT_EQ(12, DecodeLong(aggr_val));
+}
+
+}  // namespace storage
+}  // namespace openmldb
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -60,6 +60,7 @@
 #include "tablet/file_sender.h"
 #include "storage/table.h"
 #include "storage/disk_table_snapshot.h"
+#include "storage/window_aggr_cache.h"
 #include "absl/cleanup/cleanup.h"
 
 using google::protobuf::RepeatedPtrField;
@@ -71,6 +72,9 @@ using ::openmldb::storage::DiskTable;
 
 DECLARE_int32(gc_interval);
 DECLARE_int32(gc_pool_size);
+DECLARE_uint32(gc_step_max_keys);
+DECLARE_uint32(gc_step_max_time_ms);
+DECLARE_uint32(gc_step_interval_ms);
 DECLARE_int32(disk_gc_interval);
 DECLARE_int32(statdb_ttl);
 DECLARE_uint32(scan_max_bytes_size);
@@ -96,6 +100,12 @@ DECLARE_uint32(task_check_interval);
 DECLARE_uint32(load_index_max_wait_time);
 DECLARE_bool(use_name);
 DECLARE_bool(enable_distsql);
+DECLARE_bool(enable_window_scan_sharing);
+DECLARE_bool(enable_tiered_jit);
+DECLARE_uint64(jit_tier_up_threshold);
+DECLARE_string(jit_object_cache_dir);
+DECLARE_uint64(jit_object_cache_max_mb);
+DECLARE_uint32(batch_query_parallelism);
 DECLARE_string(snapshot_compression);
 DECLARE_string(file_compression);
 
@@ -108,6 +118,7 @@ DECLARE_int32(zk_keep_alive_check_interval);
 
 DECLARE_int32(binlog_sync_to_disk_interval);
 DECLARE_int32(binlog_delete_interval);
+DECLARE_int32(binlog_sync_wait_time);
 DECLARE_uint32(absolute_ttl_max);
 DECLARE_uint32(latest_ttl_max);
 DECLARE_uint32(max_traverse_cnt);
@@ -205,6 +216,11 @@ bool TabletImpl::Init(const std::string& zk_cluster, const std::string& zk_path,
     } else {
         options.SetClusterOptimized(false);
     }
+    options.SetEnableWindowScanSharing(FLAGS_enable_window_scan_sharing);
+    options.SetEnableTieredJit(FLAGS_enable_tiered_jit);
+    options.SetJitTierUpThreshold(FLAGS_jit_tier_up_threshold);
+    options.jit_options().SetObjectCacheDir(FLAGS_jit_object_cache_dir);
+    options.jit_options().SetObjectCacheMaxSize(FLAGS_jit_object_cache_max_mb * 1024 * 1024);
     engine_ = std::unique_ptr<::hybridse::vm::Engine>(new ::hybridse::vm::Engine(catalog_, options));
     catalog_->SetLocalTablet(
         std::shared_ptr<::hybridse::vm::Tablet>(new ::hybridse::vm::LocalTablet(engine_.get(), sp_cache_)));
@@ -682,6 +698,27 @@ void TabletImpl::Get(RpcController* controller, const ::openmldb::api::GetReques
     }
 }
 
+::openmldb::base::ReturnCode TabletImpl::PutToTable(const std::shared_ptr<Table>& table, uint64_t time,
+                                                    const std::string& value,
+                                                    const ::openmldb::storage::Dimensions& dimensions,
+                                                    std::string* msg) {
+    if (dimensions.empty()) {
+        msg->assign("put failed");
+        return ::openmldb::base::ReturnCode::kPutFailed;
+    }
+    if (CheckDimessionPut(dimensions, table->GetIdxCnt()) != 0) {
+        msg->assign("invalid dimension parameter");
+        return ::openmldb::base::ReturnCode::kInvalidDimensionParameter;
+    }
+    DLOG(INFO) << "put data to tid " << table->GetId() << " pid " << table->GetPid() << " with key "
+               << dimensions.Get(0).key();
+    if (!table->Put(time, value, dimensions)) {
+        msg->assign("put failed");
+        return ::openmldb::base::ReturnCode::kPutFailed;
+    }
+    return ::openmldb::base::ReturnCode::kOk;
+}
+
 void TabletImpl::Put(RpcController* controller, const ::openmldb::api::PutRequest* request,
                      ::openmldb::api::PutResponse* response, Closure* done) {
     brpc::ClosureGuard done_guard(done);
@@ -710,21 +747,11 @@ void TabletImpl::Put(RpcController* controller, const ::openmldb::api::PutReques
         response->set_msg("table is loading");
         return;
     }
-    bool ok = false;
-    if (request->dimensions_size() > 0) {
-        int32_t ret_code = CheckDimessionPut(request, table->GetIdxCnt());
-        if (ret_code != 0) {
-            response->set_code(::openmldb::base::ReturnCode::kInvalidDimensionParameter);
-            response->set_msg("invalid dimension parameter");
-            return;
-        }
-        DLOG(INFO) << "put data to tid " << request->tid() << " pid " << request->pid() << " with key "
-                   << request->dimensions(0).key();
-        ok = table->Put(request->time(), request->value(), request->dimensions());
-    }
-    if (!ok) {
-        response->set_code(::openmldb::base::ReturnCode::kPutFailed);
-        response->set_msg("put failed");
+    std::string msg;
+    auto code = PutToTable(table, request->time(), request->value(), request->dimensions(), &msg);
+    if (code != ::openmldb::base::ReturnCode::kOk) {
+        response->set_code(code);
+        response->set_msg(msg);
         return;
     }
 
@@ -750,8 +777,8 @@ void TabletImpl::Put(RpcController* controller, const ::openmldb::api::PutReques
         replicator->AppendEntry(entry);
     } while (false);
 
-    ok = UpdateAggrs(request->tid(), request->pid(), request->value(),
-                     request->dimensions(), entry.log_index());
+    bool ok = UpdateAggrs(request->tid(), request->pid(), request->value(),
+                          request->dimensions(), entry.log_index());
     if (!ok) {
         response->set_code(::openmldb::base::ReturnCode::kError);
         response->set_msg("update aggr failed");
@@ -789,6 +816,108 @@ void TabletImpl::Put(RpcController* controller, const ::openmldb::api::PutReques
     }
 }
 
+void TabletImpl::BatchPut(RpcController* controller, const ::openmldb::api::BatchPutRequest* request,
+                          ::openmldb::api::BatchPutResponse* response, Closure* done) {
+    brpc::ClosureGuard done_guard(done);
+    brpc::Controller* cntl = static_cast<brpc::Controller*>(controller);
+    response->set_put_cnt(0);
+    if (follower_.load(std::memory_order_relaxed)) {
+        response->set_code(::openmldb::base::ReturnCode::kIsFollowerCluster);
+        response->set_msg("is follower cluster");
+        return;
+    }
+    uint64_t start_time = ::baidu::common::timer::get_micros();
+    uint32_t tid = request->tid();
+    uint32_t pid = request->pid();
+    std::shared_ptr<Table> table = GetTable(tid, pid);
+    if (!table) {
+        PDLOG(WARNING, "table is not exist. tid %u, pid %u", tid, pid);
+        response->set_code(::openmldb::base::ReturnCode::kTableIsNotExist);
+        response->set_msg("table is not exist");
+        return;
+    }
+    if (!table->IsLeader()) {
+        response->set_code(::openmldb::base::ReturnCode::kTableIsFollower);
+        response->set_msg("table is follower");
+        return;
+    }
+    if (table->GetTableStat() == ::openmldb::storage::kLoading) {
+        PDLOG(WARNING, "table is loading. tid %u, pid %u", tid, pid);
+        response->set_code(::openmldb::base::ReturnCode::kTableIsLoading);
+        response->set_msg("table is loading");
+        return;
+    }
+    int row_cnt = request->time_size();
+    uint64_t total_value_size = 0;
+    int total_dimension_cnt = 0;
+    if (request->value_size_size() == row_cnt && request->dimension_cnt_size() == row_cnt) {
+        for (int i = 0; i < row_cnt; i++) {
+            total_value_size += request->value_size(i);
+            total_dimension_cnt += request->dimension_cnt(i);
+        }
+    }
+    const butil::IOBuf& buf = cntl->request_attachment();
+    if (request->value_size_size() != row_cnt || request->dimension_cnt_size() != row_cnt ||
+        total_value_size != buf.size() || total_dimension_cnt != request->dimensions_size()) {
+        response->set_code(::openmldb::base::ReturnCode::kInvalidParameter);
+        response->set_msg("rows are invalid");
+        return;
+    }
+    std::string values = buf.to_string();
+    std::vector<::openmldb::api::LogEntry> entries(row_cnt);
+    size_t put_cnt = 0;
+    uint64_t value_offset = 0;
+    int dimension_pos = 0;
+    for (int i = 0; i < row_cnt; i++) {
+        auto& entry = entries[i];
+        entry.set_ts(request->time(i));
+        entry.set_value(values.data() + value_offset, request->value_size(i));
+        value_offset += request->value_size(i);
+        for (uint32_t j = 0; j < request->dimension_cnt(i); j++) {
+            entry.add_dimensions()->CopyFrom(request->dimensions(dimension_pos++));
+        }
+        std::string msg;
+        auto code = PutToTable(table, entry.ts(), entry.value(), entry.dimensions(), &msg);
+        if (code != ::openmldb::base::ReturnCode::kOk) {
+            response->set_code(code);
+            response->set_msg(msg);
+            break;
+        }
+        put_cnt++;
+    }
+    if (put_cnt == entries.size()) {
+        response->set_code(::openmldb::base::ReturnCode::kOk);
+    }
+    response->set_put_cnt(put_cnt);
+    std::shared_ptr<LogReplicator> replicator = GetReplicator(tid, pid);
+    if (!replicator) {
+        PDLOG(WARNING, "fail to find table tid %u pid %u leader's log replicator", tid, pid);
+    } else if (put_cnt > 0) {
+        uint64_t term = replicator->GetLeaderTerm();
+        for (size_t i = 0; i < put_cnt; i++) {
+            entries[i].set_term(term);
+        }
+        replicator->AppendEntries(entries.data(), put_cnt);
+    }
+    if (!UpdateAggrs(tid, pid, entries, put_cnt)) {
+        response->set_code(::openmldb::base::ReturnCode::kError);
+        response->set_msg("update aggr failed");
+        return;
+    }
+    uint64_t end_time = ::baidu::common::timer::get_micros();
+    if (start_time + FLAGS_put_slow_log_threshold < end_time) {
+        PDLOG(INFO, "slow log[batch put]. row cnt %d time %lu. tid %u, pid %u", row_cnt, end_time - start_time, tid,
+              pid);
+    }
+    if (replicator && FLAGS_binlog_notify_on_put) {
+        replicator->Notify();
+    }
+    if (!IsClusterMode() && table->GetDB() == openmldb::nameserver::INFORMATION_SCHEMA_DB &&
+        table->GetName() == openmldb::nameserver::GLOBAL_VARIABLES) {
+        UpdateGlobalVarTable();
+    }
+}
+
 int TabletImpl::CheckTableMeta(const openmldb::api::TableMeta* table_meta, std::string& msg) {
     msg.clear();
     if (table_meta->name().empty()) {
@@ -1572,6 +1701,7 @@ void TabletImpl::Delete(RpcController* controller, const ::openmldb::api::Delete
         idx = index_def->GetId();
     }
     if (table->Delete(request->key(), idx)) {
+        ClearWindowAggrCache(request->tid(), request->pid());
         response->set_code(::openmldb::base::ReturnCode::kOk);
         response->set_msg("ok");
         DEBUGLOG("delete ok. tid %u, pid %u, key %s", request->tid(), request->pid(), request->key().c_str());
@@ -1642,6 +1772,7 @@ void TabletImpl::ProcessQuery(RpcController* ctrl, const openmldb::api::QueryReq
             session.EnableDebug();
         }
         session.SetParameterSchema(parameter_schema);
+        session.SetParallelism(FLAGS_batch_query_parallelism);
         {
             bool ok = engine_->Get(request->sql(), request->db(), session, status);
             if (!ok) {
@@ -1709,7 +1840,7 @@ void TabletImpl::ProcessQuery(RpcController* ctrl, const openmldb::api::QueryReq
                     return;
                 }
             }
-            session.SetCompileInfo(request_compile_info);
+            session.SetCompileInfo(engine_->GetTieredCompileInfo(request_compile_info));
             session.SetSpName(sp_name);
             RunRequestQuery(ctrl, *request, session, *response, *buf);
         } else {
@@ -1779,7 +1910,7 @@ void TabletImpl::ProcessBatchRequestQuery(RpcController* ctrl,
                 PDLOG(WARNING, status.msg.c_str());
                 return;
             }
-            session.SetCompileInfo(request_compile_info);
+            session.SetCompileInfo(engine_->GetTieredCompileInfo(request_compile_info));
             session.SetSpName(request->sp_name());
         }
     } else {
@@ -1983,6 +2114,8 @@ void TabletImpl::ChangeRole(RpcController* controller, const ::openmldb::api::Ch
             }
         }
         PDLOG(INFO, "change to leader. tid[%u] pid[%u] term[%lu]", tid, pid, request->term());
+        // the rows put as follower are not in the cache
+        ClearWindowAggrCache(tid, pid);
         if (catalog_->AddTable(*(table->GetTableMeta()), table)) {
             LOG(INFO) << "add table " << table->GetName() << " to catalog with db " << table->GetDB();
         } else {
@@ -2017,6 +2150,7 @@ void TabletImpl::ChangeRole(RpcController* controller, const ::openmldb::api::Ch
             table->SetLeader(false);
         }
         PDLOG(INFO, "change to follower. tid[%u] pid[%u]", tid, pid);
+        ClearWindowAggrCache(tid, pid);
         if (!table->GetDB().empty()) {
             catalog_->DeleteTable(table->GetDB(), table->GetName(), pid);
         }
@@ -2196,7 +2330,7 @@ void TabletImpl::AppendEntries(RpcController* controller, const ::openmldb::api:
     response->set_code(::openmldb::base::ReturnCode::kOk);
     response->set_msg("ok");
     uint64_t last_log_offset = replicator->GetOffset();
-    if (request->pre_log_index() == 0 && request->entries_size() == 0) {
+    if (request->pre_log_index() == 0 && request->entries_size() == 0 && request->entry_sizes_size() == 0) {
         response->set_log_offset(last_log_offset);
         if (!FLAGS_zk_cluster.empty() && request->term() > term) {
             replicator->SetLeaderTerm(request->term());
@@ -2207,10 +2341,44 @@ void TabletImpl::AppendEntries(RpcController* controller, const ::openmldb::api:
         PDLOG(INFO, "first sync log_index! log_offset[%lu] tid[%u] pid[%u]", last_log_offset, tid, pid);
         return;
     }
-    for (int32_t i = 0; i < request->entries_size(); i++) {
-        const auto& entry = request->entries(i);
+    const ::google::protobuf::RepeatedPtrField<::openmldb::api::LogEntry>* entries = &request->entries();
+    ::google::protobuf::RepeatedPtrField<::openmldb::api::LogEntry> attached_entries;
+    bool applying = false;
+    absl::Cleanup finish_apply = [&replicator, &applying]() {
+        if (applying) {
+            replicator->FinishApply();
+        }
+    };
+    if (request->entry_sizes_size() > 0) {
+        // the entries are carried by the attachment of pipelined request
+        butil::IOBuf& attachment = static_cast<brpc::Controller*>(controller)->request_attachment();
+        for (int32_t i = 0; i < request->entry_sizes_size(); i++) {
+            butil::IOBuf entry_buf;
+            attachment.cutn(&entry_buf, request->entry_sizes(i));
+            butil::IOBufAsZeroCopyInputStream stream(entry_buf);
+            if (entry_buf.size() != request->entry_sizes(i) ||
+                !attached_entries.Add()->ParseFromZeroCopyStream(&stream)) {
+                PDLOG(WARNING, "bad entry in attachment. tid %u pid %u", tid, pid);
+                response->set_code(::openmldb::base::ReturnCode::kFailToAppendEntriesToReplicator);
+                response->set_msg("bad entry in attachment");
+                return;
+            }
+        }
+        entries = &attached_entries;
+        if (!replicator->WaitApply(request->pre_log_index(), FLAGS_binlog_sync_wait_time)) {
+            PDLOG(WARNING, "entries before pre log index %lu are not applied. cur log_offset %lu tid %u pid %u",
+                  request->pre_log_index(), replicator->GetOffset(), tid, pid);
+            response->set_code(::openmldb::base::ReturnCode::kFailToAppendEntriesToReplicator);
+            response->set_msg("log index is not continuous");
+            response->set_log_offset(replicator->GetOffset());
+            return;
+        }
+        applying = true;
+        last_log_offset = replicator->GetOffset();
+    }
+    for (const auto& entry : *entries) {
         if (entry.log_index() <= last_log_offset) {
-            PDLOG(WARNING, "entry log_index %lu cur log_offset %lu tid %u pid %u", request->entries(i).log_index(),
+            PDLOG(WARNING, "entry log_index %lu cur log_offset %lu tid %u pid %u", entry.log_index(),
                     last_log_offset, tid, pid);
             continue;
         }
@@ -2370,6 +2538,14 @@ void TabletImpl::GetTableStatus(RpcController* controller, const ::openmldb::api
             status->set_record_cnt(table->GetRecordCnt());
             if (table->GetStorageMode() == common::kMemory) {
                 if (MemTable* mem_table = dynamic_cast<MemTable*>(table.get())) {
+                    mem_table->GetGcStatus(status->mutable_gc_status());
+                    mem_table->GetCompressStatus(status->mutable_compress_status());
+                    mem_table->GetColdTierStatus(status->mutable_cold_tier_status());
+                    auto snapshot = GetSnapshotUnLock(table->GetId(), table->GetPid());
+                    if (snapshot) {
+                        std::static_pointer_cast<::openmldb::storage::MemTableSnapshot>(snapshot)->GetRecoverStatus(
+                            status->mutable_recover_status());
+                    }
                     status->set_is_expire(mem_table->GetExpireStatus());
                     status->set_record_byte_size(mem_table->GetRecordByteSize());
                     status->set_record_idx_byte_size(mem_table->GetRecordIdxByteSize());
@@ -2393,6 +2569,8 @@ void TabletImpl::GetTableStatus(RpcController* controller, const ::openmldb::api
                     }
                     status->set_idx_cnt(record_idx_cnt);
                 }
+            } else if (DiskTable* disk_table = dynamic_cast<DiskTable*>(table.get())) {
+                disk_table->GetRowCacheStatus(status->mutable_row_cache_status());
             }
         }
     }
@@ -3094,6 +3272,8 @@ int TabletImpl::LoadTableInternal(uint32_t tid, uint32_t pid, std::shared_ptr<::
                 }
             }
 
+            // the rows recovered are not in the cache
+            ClearWindowAggrCache(tid, pid);
             table->SetTableStat(::openmldb::storage::kNormal);
             replicator->SetOffset(latest_offset);
             replicator->SetSnapshotLogPartIndex(snapshot->GetOffset());
@@ -3436,10 +3616,17 @@ void TabletImpl::GetTableFollower(RpcController* controller, const ::openmldb::a
         response->set_msg("has no follower");
         response->set_code(::openmldb::base::ReturnCode::kNoFollower);
     }
+    std::map<std::string, std::pair<uint64_t, uint64_t>> lag_map;
+    replicator->GetReplicateLag(&lag_map);
     for (const auto& kv : info_map) {
         ::openmldb::api::FollowerInfo* follower_info = response->add_follower_info();
         follower_info->set_endpoint(kv.first);
         follower_info->set_offset(kv.second);
+        auto it = lag_map.find(kv.first);
+        if (it != lag_map.end()) {
+            follower_info->set_lag_entries(it->second.first);
+            follower_info->set_lag_bytes(it->second.second);
+        }
     }
     response->set_msg("ok");
     response->set_code(::openmldb::base::ReturnCode::kOk);
@@ -4066,7 +4253,21 @@ void TabletImpl::GcTable(uint32_t tid, uint32_t pid, bool execute_once) {
     std::shared_ptr<Table> table = GetTable(tid, pid);
     if (table) {
         int32_t gc_interval = table->GetStorageMode() == common::kMemory ? FLAGS_gc_interval : FLAGS_disk_gc_interval;
-        table->SchedGc();
+        MemTable* mem_table = dynamic_cast<MemTable*>(table.get());
+        if (mem_table != NULL && (FLAGS_gc_step_max_keys > 0 || FLAGS_gc_step_max_time_ms > 0)) {
+            uint64_t consumed = ::baidu::common::timer::get_micros();
+            bool finished = mem_table->SchedGcStep(FLAGS_gc_step_max_keys, FLAGS_gc_step_max_time_ms * 1000);
+            if (!finished) {
+                // give way to puts and queries, and back off more if other gc tasks are waiting
+                consumed = (::baidu::common::timer::get_micros() - consumed) / 1000;
+                uint64_t delay = std::max(consumed, static_cast<uint64_t>(FLAGS_gc_step_interval_ms)) *
+                                 (1 + gc_pool_.PendingNum());
+                gc_pool_.DelayTask(delay, boost::bind(&TabletImpl::GcTable, this, tid, pid, execute_once));
+                return;
+            }
+        } else {
+            table->SchedGc();
+        }
         if (!execute_once) {
             gc_pool_.DelayTask(gc_interval * 60 * 1000, boost::bind(&TabletImpl::GcTable, this, tid, pid, false));
         }
@@ -4158,6 +4359,43 @@ bool TabletImpl::UpdateAggrs(uint32_t tid, uint32_t pid, const std::string& valu
     return true;
 }
 
+void TabletImpl::ClearWindowAggrCache(uint32_t tid, uint32_t pid) {
+    auto aggrs = GetAggregators(tid, pid);
+    if (!aggrs) {
+        return;
+    }
+    for (const auto& aggr : *aggrs) {
+        auto cache = aggr->GetWindowAggrCache();
+        if (cache) {
+            cache->Clear();
+        }
+    }
+}
+
+bool TabletImpl::UpdateAggrs(uint32_t tid, uint32_t pid, const std::vector<::openmldb::api::LogEntry>& entries,
+                             size_t cnt) {
+    auto aggrs = GetAggregators(tid, pid);
+    if (!aggrs) {
+        return true;
+    }
+    for (size_t i = 0; i < cnt; i++) {
+        const auto& entry = entries[i];
+        for (const auto& dimension : entry.dimensions()) {
+            for (auto aggr : *aggrs) {
+                if (aggr->GetIndexPos() != dimension.idx()) {
+                    continue;
+                }
+                if (!aggr->Update(dimension.key(), entry.value(), entry.log_index())) {
+                    PDLOG(WARNING, "update aggr failed. tid[%u] pid[%u] index[%u] key[%s]", tid, pid, dimension.idx(),
+                          dimension.key().c_str());
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
 
 void TabletImpl::ShowMemPool(RpcController* controller, const ::openmldb::api::HttpRequest* request,
                              ::openmldb::api::HttpResponse* response, Closure* done) {
@@ -4400,17 +4638,17 @@ bool TabletImpl::RefreshAggrCatalog() {
     return true;
 }
 
-int TabletImpl::CheckDimessionPut(const ::openmldb::api::PutRequest* request, uint32_t idx_cnt) {
-    for (int32_t i = 0; i < request->dimensions_size(); i++) {
-        if (idx_cnt <= request->dimensions(i).idx()) {
+int TabletImpl::CheckDimessionPut(const ::openmldb::storage::Dimensions& dimensions, uint32_t idx_cnt) {
+    for (const auto& dimension : dimensions) {
+        if (idx_cnt <= dimension.idx()) {
             PDLOG(WARNING,
                   "invalid put request dimensions, request idx %u is greater "
                   "than table idx cnt %u",
-                  request->dimensions(i).idx(), idx_cnt);
+                  dimension.idx(), idx_cnt);
             return -1;
         }
-        if (request->dimensions(i).key().length() <= 0) {
-            PDLOG(WARNING, "invalid put request dimension key is empty with idx %u", request->dimensions(i).idx());
+        if (dimension.key().length() <= 0) {
+            PDLOG(WARNING, "invalid put request dimension key is empty with idx %u", dimension.idx());
             return 1;
         }
     }
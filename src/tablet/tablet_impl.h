@@ -86,6 +86,10 @@ class TabletImpl : public ::openmldb::api::TabletServer {
     void Put(RpcController* controller, const ::openmldb::api::PutRequest* request,
              ::openmldb::api::PutResponse* response, Closure* done);
 
+    // put the rows of one partition, the rows are appended into binlog with one group commit
+    void BatchPut(RpcController* controller, const ::openmldb::api::BatchPutRequest* request,
+                  ::openmldb::api::BatchPutResponse* response, Closure* done);
+
     void Get(RpcController* controller, const ::openmldb::api::GetRequest* request,
              ::openmldb::api::GetResponse* response, Closure* done);
 
@@ -375,7 +379,12 @@ class TabletImpl : public ::openmldb::api::TabletServer {
 
     std::shared_ptr<::openmldb::api::TaskInfo> FindMultiTask(const ::openmldb::api::TaskInfo& task_info);
 
-    int CheckDimessionPut(const ::openmldb::api::PutRequest* request, uint32_t idx_cnt);
+    int CheckDimessionPut(const ::openmldb::storage::Dimensions& dimensions, uint32_t idx_cnt);
+
+    // put one row to table, the rows of Put and BatchPut are checked and put the same way
+    ::openmldb::base::ReturnCode PutToTable(const std::shared_ptr<Table>& table, uint64_t time,
+                                           const std::string& value, const ::openmldb::storage::Dimensions& dimensions,
+                                           std::string* msg);
 
     // sync log data from page cache to disk
     void SchedSyncDisk(uint32_t tid, uint32_t pid);
@@ -417,6 +426,12 @@ class TabletImpl : public ::openmldb::api::TabletServer {
     bool UpdateAggrs(uint32_t tid, uint32_t pid, const std::string& value,
                      const ::openmldb::storage::Dimensions& dimensions, uint64_t log_offset);
 
+    // update the aggregators with the first cnt entries
+    bool UpdateAggrs(uint32_t tid, uint32_t pid, const std::vector<::openmldb::api::LogEntry>& entries, size_t cnt);
+
+    // the window aggr cache is fed only by the puts of leader, clear it if the rows are changed otherwise
+    void ClearWindowAggrCache(uint32_t tid, uint32_t pid);
+
     bool CreateAggregatorInternal(const ::openmldb::api::CreateAggregatorRequest* request,
                                   std::string& msg); //NOLINT
 
@@ -2022,6 +2022,76 @@ TEST_P(TabletImplTest, Scan) {
 }
 
 
+TEST_P(TabletImplTest, BatchPut) {
+    ::openmldb::common::StorageMode storage_mode = GetParam();
+    TabletImpl tablet;
+    uint32_t id = counter++;
+    tablet.Init("");
+    ::openmldb::api::CreateTableRequest request;
+    ::openmldb::api::TableMeta* table_meta = request.mutable_table_meta();
+    table_meta->set_name("t0");
+    table_meta->set_tid(id);
+    table_meta->set_pid(1);
+    table_meta->set_storage_mode(storage_mode);
+    AddDefaultSchema(0, 0, ::openmldb::type::TTLType::kAbsoluteTime, table_meta);
+    ::openmldb::api::CreateTableResponse response;
+    MockClosure closure;
+    tablet.CreateTable(NULL, &request, &response, &closure);
+    ASSERT_EQ(0, response.code());
+
+    std::vector<std::string> keys = {"test1", "test1", "test2"};
+    ::openmldb::api::BatchPutRequest prequest;
+    prequest.set_tid(id);
+    prequest.set_pid(1);
+    brpc::Controller cntl;
+    for (size_t i = 0; i < keys.size(); i++) {
+        std::string value = ::openmldb::test::EncodeKV(keys[i], "value" + std::to_string(i));
+        prequest.add_time(9527 + i);
+        prequest.add_value_size(value.size());
+        prequest.add_dimension_cnt(1);
+        auto dim = prequest.add_dimensions();
+        dim->set_idx(0);
+        dim->set_key(keys[i]);
+        cntl.request_attachment().append(value);
+    }
+    {
+        // the row count mismatches
+        ::openmldb::api::BatchPutRequest invalid_request(prequest);
+        invalid_request.add_time(9530);
+        ::openmldb::api::BatchPutResponse presponse;
+        tablet.BatchPut(&cntl, &invalid_request, &presponse, &closure);
+        ASSERT_EQ(::openmldb::base::ReturnCode::kInvalidParameter, presponse.code());
+        ASSERT_EQ(0u, presponse.put_cnt());
+    }
+    ::openmldb::api::BatchPutResponse presponse;
+    tablet.BatchPut(&cntl, &prequest, &presponse, &closure);
+    ASSERT_EQ(0, presponse.code());
+    ASSERT_EQ(3u, presponse.put_cnt());
+
+    ::openmldb::api::ScanRequest sr;
+    sr.set_tid(id);
+    sr.set_pid(1);
+    sr.set_pk("test1");
+    sr.set_st(9530);
+    sr.set_et(0);
+    ::openmldb::api::ScanResponse srp;
+    tablet.Scan(NULL, &sr, &srp, &closure);
+    ASSERT_EQ(0, srp.code());
+    ASSERT_EQ(2, (signed)srp.count());
+    sr.set_pk("test2");
+    tablet.Scan(NULL, &sr, &srp, &closure);
+    ASSERT_EQ(0, srp.code());
+    ASSERT_EQ(1, (signed)srp.count());
+
+    // the rows are checked the same as Put, it stops at the row with invalid dimension
+    ::openmldb::api::BatchPutRequest fail_request(prequest);
+    fail_request.mutable_dimensions(1)->set_idx(5);
+    ::openmldb::api::BatchPutResponse fail_response;
+    tablet.BatchPut(&cntl, &fail_request, &fail_response, &closure);
+    ASSERT_EQ(::openmldb::base::ReturnCode::kInvalidDimensionParameter, fail_response.code());
+    ASSERT_EQ(1u, fail_response.put_cnt());
+}
+
 TEST_P(TabletImplTest, GCWithUpdateLatest) {
     ::openmldb::common::StorageMode storage_mode = GetParam();
     int32_t old_gc_interval = FLAGS_gc_interval;